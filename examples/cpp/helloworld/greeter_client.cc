@@ -36,6 +36,7 @@
 #include <string>
 
 #include <grpc++/grpc++.h>
+#include <grpc/support/span_recorder.h>
 
 #include "helloworld.grpc.pb.h"
 #include "./benchmarkUtils.h"
@@ -51,8 +52,6 @@ using helloworld::HelloRequestComplex;
 using helloworld::HelloReply;
 using helloworld::Greeter;
 
-extern void print_all_profile_stats();
-
 class GreeterClient {
  public:
   GreeterClient(std::shared_ptr<Channel> channel)
@@ -315,14 +314,6 @@ void RecordRoute(long bytesPerPacket,
 };
 
 
-void truncate_result_file()
-{
-  static FILE *fp;
-  static char resultFileName[] = "cs739_grpc_result.csv";
-  fp = fopen(resultFileName, "w"); 
-  fclose(fp);
-}
-
 //! Function to measure the Round Trip time of GRPC with small message size.
 int
 measureRoundTripTime(GreeterClient *pGreeter,
@@ -350,8 +341,9 @@ int main(int argc, char** argv) {
       gccOptimizationMode = atoi(argv[2]);
   }
 
-  // Cleanup result file. 
-  truncate_result_file();
+  // Record spans for every RPC; they are written out as a Chrome trace
+  // (chrome://tracing) when the client is done.
+  gpr_span_recorder_start(1 << 20);
 
   // Instantiate the client. It requires a channel, out of which the actual RPCs
   // are created. This channel models a connection to an endpoint (in this case,
@@ -364,7 +356,9 @@ int main(int argc, char** argv) {
                        servIPPort,
                        gccOptimizationMode,
                        maxAttempts); 
-  print_all_profile_stats();
+  gpr_span_recorder_export_chrome_trace("greeter_client_trace.json");
+  gpr_span_recorder_stop();
+  return rc;
 }
 
 int
@@ -36,6 +36,7 @@
 #include <string>
 
 #include <grpc++/grpc++.h>
+#include <grpc/support/span_recorder.h>
 
 #include "helloworld.grpc.pb.h"
 
@@ -51,18 +52,6 @@ using helloworld::HelloRequestDouble;
 using helloworld::HelloRequestComplex;
 using helloworld::Greeter;
 
-extern uint64_t nanos_since_midnight();
-extern void print_all_profile_stats();
-// extern int add_func_stats(std::string funcName, uint64_t start_ns, uint64_t duration_ns);
-
-void truncate_result_file()
-{
-  static FILE *fp;
-  static char resultFileName[] = "cs739_grpc_result.csv";
-  fp = fopen(resultFileName, "w"); 
-  fclose(fp);
-}
-
 // Logic and data behind the server's behavior.
 class GreeterServiceImpl final : public Greeter::Service {
   Status SayHello(ServerContext* context, const HelloRequest* request,
@@ -127,58 +116,31 @@ class GreeterServiceImpl final : public Greeter::Service {
 };
 
 void RunServer() {
-  uint64_t start, end, start0, end0;
-
-  start0 = nanos_since_midnight();
-  start = nanos_since_midnight();
   std::string server_address("0.0.0.0:50051");
-  end = nanos_since_midnight();
-  add_func_stats("server_address allocator", start, end -start); 
-
-  start = nanos_since_midnight();
   GreeterServiceImpl service;
-  end = nanos_since_midnight();
-  add_func_stats("GreeterServiceImpl service init: generic server, thread pool, msg size: max (64M)-1, compression method", start, end -start);
 
   ServerBuilder builder;
   // Listen on the given address without any authentication mechanism.
-  start = nanos_since_midnight();
   builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
-  end = nanos_since_midnight();
-  add_func_stats("ServerBuilder.AddListeningPort in the namespace", start, end -start);
-
   // Register "service" as the instance through which we'll communicate with
   // clients. In this case it corresponds to an *synchronous* service.
-  start = nanos_since_midnight();
   builder.RegisterService(&service);
-  end = nanos_since_midnight();
-  add_func_stats("ServerBuilder.RegisterService sayHello and its methods in the namespace ", start, end -start);
-
   // Finally assemble the server.
-  start = nanos_since_midnight();
   std::unique_ptr<Server> server(builder.BuildAndStart());
-
-  end = nanos_since_midnight();
-  add_func_stats("assemble the server: check cannot be both async and sync services; create standard thread pool; assign thread pool ownership, completion queue, and start the service", start, end -start);
-
-  end0 = nanos_since_midnight();
-  add_func_stats("Total setup overhead ", start, end -start);
-
   std::cout << "Server listening on " << server_address << std::endl;
 
   // Wait for the server to shutdown. Note that some other thread must be
   // responsible for shutting down the server for this call to ever return.
-
-  add_func_stats("CallOpServerSendStatus() : send_status_available_(false) ", start, end -start);
-
-  print_all_profile_stats(); 
   server->Wait();
 }
 
 int main(int argc, char** argv) {
-  
-  truncate_result_file();
+  // Keep the most recent million spans; they are written out as a Chrome
+  // trace (chrome://tracing) once the server shuts down.
+  gpr_span_recorder_start(1 << 20);
   RunServer();
+  gpr_span_recorder_export_chrome_trace("greeter_server_trace.json");
+  gpr_span_recorder_stop();
 
   return 0;
 }
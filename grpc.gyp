@@ -101,6 +101,7 @@
         'src/core/support/file.c',
         'src/core/support/file_posix.c',
         'src/core/support/file_win32.c',
+        'src/core/support/hdr_histogram.c',
         'src/core/support/histogram.c',
         'src/core/support/host_port.c',
         'src/core/support/log.c',
@@ -111,6 +112,7 @@
         'src/core/support/murmur_hash.c',
         'src/core/support/slice.c',
         'src/core/support/slice_buffer.c',
+        'src/core/support/span_recorder.c',
         'src/core/support/stack_lockfree.c',
         'src/core/support/string.c',
         'src/core/support/string_posix.c',
@@ -122,6 +124,7 @@
         'src/core/support/thd.c',
         'src/core/support/thd_posix.c',
         'src/core/support/thd_win32.c',
+        'src/core/support/thread_rings.c',
         'src/core/support/time.c',
         'src/core/support/time_posix.c',
         'src/core/support/time_win32.c',
@@ -158,6 +161,7 @@
         'src/core/security/credentials_win32.c',
         'src/core/security/google_default_credentials.c',
         'src/core/security/handshake.c',
+        'src/core/security/handshake_executor.c',
         'src/core/security/json_token.c',
         'src/core/security/jwt_verifier.c',
         'src/core/security/secure_endpoint.c',
@@ -198,6 +202,7 @@
         'src/core/client_config/subchannel_factory_decorators/merge_channel_args.c',
         'src/core/client_config/uri_parser.c',
         'src/core/compression/algorithm.c',
+        'src/core/compression/lz4.c',
         'src/core/compression/message_compress.c',
         'src/core/debug/trace.c',
         'src/core/httpcli/format_request.c',
@@ -268,6 +273,7 @@
         'src/core/surface/surface_trace.c',
         'src/core/surface/version.c',
         'src/core/transport/chttp2/alpn.c',
+        'src/core/transport/chttp2/bdp_estimator.c',
         'src/core/transport/chttp2/bin_encoder.c',
         'src/core/transport/chttp2/frame_data.c',
         'src/core/transport/chttp2/frame_goaway.c',
@@ -294,6 +300,7 @@
         'src/core/transport/transport.c',
         'src/core/transport/transport_op_string.c',
         'src/core/census/context.c',
+        'src/core/census/histogram.c',
         'src/core/census/initialize.c',
         'src/core/census/operation.c',
         'src/core/census/tracing.c',
@@ -317,6 +324,7 @@
         'test/core/end2end/fixtures/proxy.c',
         'test/core/iomgr/endpoint_tests.c',
         'test/core/security/oauth2_utils.c',
+        'test/core/util/delayed_endpoint.c',
         'test/core/util/grpc_profiler.c',
         'test/core/util/parse_hexstring.c',
         'test/core/util/port_posix.c',
@@ -339,6 +347,7 @@
         'test/core/end2end/fixtures/proxy.c',
         'test/core/iomgr/endpoint_tests.c',
         'test/core/security/oauth2_utils.c',
+        'test/core/util/delayed_endpoint.c',
         'test/core/util/grpc_profiler.c',
         'test/core/util/parse_hexstring.c',
         'test/core/util/port_posix.c',
@@ -384,6 +393,7 @@
         'src/core/client_config/subchannel_factory_decorators/merge_channel_args.c',
         'src/core/client_config/uri_parser.c',
         'src/core/compression/algorithm.c',
+        'src/core/compression/lz4.c',
         'src/core/compression/message_compress.c',
         'src/core/debug/trace.c',
         'src/core/httpcli/format_request.c',
@@ -454,6 +464,7 @@
         'src/core/surface/surface_trace.c',
         'src/core/surface/version.c',
         'src/core/transport/chttp2/alpn.c',
+        'src/core/transport/chttp2/bdp_estimator.c',
         'src/core/transport/chttp2/bin_encoder.c',
         'src/core/transport/chttp2/frame_data.c',
         'src/core/transport/chttp2/frame_goaway.c',
@@ -480,6 +491,7 @@
         'src/core/transport/transport.c',
         'src/core/transport/transport_op_string.c',
         'src/core/census/context.c',
+        'src/core/census/histogram.c',
         'src/core/census/initialize.c',
         'src/core/census/operation.c',
         'src/core/census/tracing.c',
@@ -1236,6 +1248,21 @@
       ],
     },
     # TODO: Add C++ targets
+    {
+      'target_name': 'end2end_test_write_buffering',
+      'product_prefix': 'lib',
+      'type': 'static_library',
+      'dependencies': [
+        'grpc_test_util_unsecure',
+        'grpc_unsecure',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/end2end/tests/write_buffering.c',
+      ],
+    },
+    # TODO: Add C++ targets
     {
       'target_name': 'end2end_certs',
       'product_prefix': 'lib',
@@ -1302,6 +1329,19 @@
         'test/core/transport/chttp2/alpn_test.c',
       ]
     },
+    {
+      'target_name': 'bidi_streaming_benchmark',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/network_benchmarks/bidi_streaming.c',
+      ]
+    },
     {
       'target_name': 'bin_encoder_test',
       'type': 'executable',
@@ -1315,6 +1355,58 @@
         'test/core/transport/chttp2/bin_encoder_test.c',
       ]
     },
+    {
+      'target_name': 'chttp2_bdp_estimator_test',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/transport/chttp2/bdp_estimator_test.c',
+      ]
+    },
+    {
+      'target_name': 'chttp2_bdp_flow_control_test',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/transport/chttp2/bdp_flow_control_test.c',
+      ]
+    },
+    {
+      'target_name': 'chttp2_frame_data_test',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/transport/chttp2/frame_data_test.c',
+      ]
+    },
+    {
+      'target_name': 'chttp2_hpack_encoder_benchmark',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/transport/chttp2/hpack_encoder_benchmark.c',
+      ]
+    },
     {
       'target_name': 'chttp2_status_conversion_test',
       'type': 'executable',
@@ -1341,6 +1433,19 @@
         'test/core/transport/chttp2/stream_encoder_test.c',
       ]
     },
+    {
+      'target_name': 'chttp2_stream_map_benchmark',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/transport/chttp2/stream_map_benchmark.c',
+      ]
+    },
     {
       'target_name': 'chttp2_stream_map_test',
       'type': 'executable',
@@ -1354,6 +1459,19 @@
         'test/core/transport/chttp2/stream_map_test.c',
       ]
     },
+    {
+      'target_name': 'chttp2_write_fairness_test',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/transport/chttp2/write_fairness_test.c',
+      ]
+    },
     {
       'target_name': 'compression_test',
       'type': 'executable',
@@ -1524,6 +1642,17 @@
         'test/core/support/file_test.c',
       ]
     },
+    {
+      'target_name': 'gpr_hdr_histogram_test',
+      'type': 'executable',
+      'dependencies': [
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/support/hdr_histogram_test.c',
+      ]
+    },
     {
       'target_name': 'gpr_histogram_test',
       'type': 'executable',
@@ -1579,6 +1708,17 @@
         'test/core/support/slice_test.c',
       ]
     },
+    {
+      'target_name': 'gpr_span_recorder_test',
+      'type': 'executable',
+      'dependencies': [
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/support/span_recorder_test.c',
+      ]
+    },
     {
       'target_name': 'gpr_stack_lockfree_test',
       'type': 'executable',
@@ -1623,6 +1763,17 @@
         'test/core/support/thd_test.c',
       ]
     },
+    {
+      'target_name': 'gpr_thread_rings_test',
+      'type': 'executable',
+      'dependencies': [
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/support/thread_rings_test.c',
+      ]
+    },
     {
       'target_name': 'gpr_time_test',
       'type': 'executable',
@@ -1734,6 +1885,19 @@
         'test/core/surface/completion_queue_test.c',
       ]
     },
+    {
+      'target_name': 'grpc_compress_filter_test',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/channel/compress_filter_test.c',
+      ]
+    },
     {
       'target_name': 'grpc_create_jwt',
       'type': 'executable',
@@ -1773,6 +1937,19 @@
         'test/core/security/fetch_oauth2.c',
       ]
     },
+    {
+      'target_name': 'grpc_handshake_storm_test',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/security/handshake_storm_test.c',
+      ]
+    },
     {
       'target_name': 'grpc_json_token_test',
       'type': 'executable',
@@ -1992,6 +2169,19 @@
         'test/core/network_benchmarks/low_level_ping_pong.c',
       ]
     },
+    {
+      'target_name': 'message_compress_benchmark',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/compression/message_compress_benchmark.c',
+      ]
+    },
     {
       'target_name': 'message_compress_test',
       'type': 'executable',
@@ -2055,6 +2245,45 @@
         'test/core/end2end/no_server_test.c',
       ]
     },
+    {
+      'target_name': 'proxy_overhead_benchmark',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/network_benchmarks/proxy_overhead.c',
+      ]
+    },
+    {
+      'target_name': 'receive_cpu_benchmark',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/network_benchmarks/receive_cpu.c',
+      ]
+    },
+    {
+      'target_name': 'registered_call_test',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/surface/registered_call_test.c',
+      ]
+    },
     {
       'target_name': 'resolve_address_test',
       'type': 'executable',
@@ -2094,6 +2323,19 @@
         'test/core/iomgr/sockaddr_utils_test.c',
       ]
     },
+    {
+      'target_name': 'subchannel_pool_test',
+      'type': 'executable',
+      'dependencies': [
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+        'test/core/client_config/subchannel_pool_test.c',
+      ]
+    },
     {
       'target_name': 'tcp_client_posix_test',
       'type': 'executable',
@@ -2732,6 +2974,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_compress_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_compress',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_fakesec_bad_hostname_test',
       'type': 'executable',
@@ -3227,6 +3484,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_fakesec_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_fakesec',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_full_bad_hostname_test',
       'type': 'executable',
@@ -3722,6 +3994,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_full_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_full',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_full+poll_bad_hostname_test',
       'type': 'executable',
@@ -4217,6 +4504,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_full+poll_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_full+poll',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_oauth2_bad_hostname_test',
       'type': 'executable',
@@ -4712,6 +5014,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_oauth2_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_oauth2',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_proxy_bad_hostname_test',
       'type': 'executable',
@@ -5582,6 +5899,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_sockpair_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_sockpair',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_sockpair+trace_bad_hostname_test',
       'type': 'executable',
@@ -6017,6 +6349,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_sockpair+trace_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_sockpair+trace',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_sockpair_1byte_bad_hostname_test',
       'type': 'executable',
@@ -6452,6 +6799,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_sockpair_1byte_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_sockpair_1byte',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_ssl_bad_hostname_test',
       'type': 'executable',
@@ -6947,6 +7309,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_ssl_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_ssl',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_ssl+poll_bad_hostname_test',
       'type': 'executable',
@@ -7442,6 +7819,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_ssl+poll_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_ssl+poll',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_ssl_proxy_bad_hostname_test',
       'type': 'executable',
@@ -8357,6 +8749,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_uds_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_uds',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_uds+poll_bad_hostname_test',
       'type': 'executable',
@@ -8837,6 +9244,21 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_uds+poll_write_buffering_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_uds+poll',
+        'end2end_test_write_buffering',
+        'end2end_certs',
+        'grpc_test_util',
+        'grpc',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_compress_bad_hostname_nosec_test',
       'type': 'executable',
@@ -9285,6 +9707,20 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_compress_write_buffering_nosec_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_compress',
+        'end2end_test_write_buffering',
+        'grpc_test_util_unsecure',
+        'grpc_unsecure',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_full_bad_hostname_nosec_test',
       'type': 'executable',
@@ -9733,6 +10169,20 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_full_write_buffering_nosec_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_full',
+        'end2end_test_write_buffering',
+        'grpc_test_util_unsecure',
+        'grpc_unsecure',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_full+poll_bad_hostname_nosec_test',
       'type': 'executable',
@@ -10181,6 +10631,20 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_full+poll_write_buffering_nosec_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_full+poll',
+        'end2end_test_write_buffering',
+        'grpc_test_util_unsecure',
+        'grpc_unsecure',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_proxy_bad_hostname_nosec_test',
       'type': 'executable',
@@ -10965,6 +11429,20 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_sockpair_write_buffering_nosec_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_sockpair',
+        'end2end_test_write_buffering',
+        'grpc_test_util_unsecure',
+        'grpc_unsecure',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_sockpair+trace_bad_hostname_nosec_test',
       'type': 'executable',
@@ -11357,6 +11835,20 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_sockpair+trace_write_buffering_nosec_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_sockpair+trace',
+        'end2end_test_write_buffering',
+        'grpc_test_util_unsecure',
+        'grpc_unsecure',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_sockpair_1byte_bad_hostname_nosec_test',
       'type': 'executable',
@@ -11749,6 +12241,20 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_sockpair_1byte_write_buffering_nosec_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_sockpair_1byte',
+        'end2end_test_write_buffering',
+        'grpc_test_util_unsecure',
+        'grpc_unsecure',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_uds_bad_hostname_nosec_test',
       'type': 'executable',
@@ -12183,6 +12689,20 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_uds_write_buffering_nosec_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_uds',
+        'end2end_test_write_buffering',
+        'grpc_test_util_unsecure',
+        'grpc_unsecure',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'h2_uds+poll_bad_hostname_nosec_test',
       'type': 'executable',
@@ -12617,6 +13137,20 @@
       'sources': [
       ]
     },
+    {
+      'target_name': 'h2_uds+poll_write_buffering_nosec_test',
+      'type': 'executable',
+      'dependencies': [
+        'end2end_fixture_h2_uds+poll',
+        'end2end_test_write_buffering',
+        'grpc_test_util_unsecure',
+        'grpc_unsecure',
+        'gpr_test_util',
+        'gpr',
+      ],
+      'sources': [
+      ]
+    },
     {
       'target_name': 'connection_prefix_bad_client_test',
       'type': 'executable',
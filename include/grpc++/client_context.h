@@ -59,6 +59,7 @@
 #include <grpc/support/time.h>
 #include <grpc++/security/auth_context.h>
 #include <grpc++/support/config.h>
+#include <grpc++/support/metadata.h>
 #include <grpc++/support/status.h>
 #include <grpc++/support/string_ref.h>
 #include <grpc++/support/time.h>
@@ -176,8 +177,8 @@ class ClientContext {
   /// \param meta_value The metadata value. If its value is binary, it must be
   /// base64-encoding (see https://tools.ietf.org/html/rfc4648#section-4) and \a
   /// meta_key must end in "-bin".
-  void AddMetadata(const grpc::string& meta_key,
-                   const grpc::string& meta_value);
+  void AddMetadata(const grpc::string_ref& meta_key,
+                   const grpc::string_ref& meta_value);
 
   /// Return a collection of initial metadata key-value pairs. Note that keys
   /// may happen more than once (ie, a \a std::multimap is returned).
@@ -190,7 +191,7 @@ class ClientContext {
   const std::multimap<grpc::string_ref, grpc::string_ref>&
   GetServerInitialMetadata() {
     GPR_ASSERT(initial_metadata_received_);
-    return recv_initial_metadata_;
+    return recv_initial_metadata_.map();
   }
 
   /// Return a collection of trailing metadata key-value pairs. Note that keys
@@ -202,6 +203,19 @@ class ClientContext {
   const std::multimap<grpc::string_ref, grpc::string_ref>&
   GetServerTrailingMetadata() {
     // TODO(yangg) check finished
+    return trailing_metadata_.map();
+  }
+
+  /// Same as \a GetServerInitialMetadata(), but returns the entries in the
+  /// order received without building a multimap.
+  const IncomingMetadata& incoming_initial_metadata() const {
+    GPR_ASSERT(initial_metadata_received_);
+    return recv_initial_metadata_;
+  }
+
+  /// Same as \a GetServerTrailingMetadata(), but returns the entries in the
+  /// order received without building a multimap.
+  const IncomingMetadata& incoming_trailing_metadata() const {
     return trailing_metadata_;
   }
 
@@ -321,9 +335,9 @@ class ClientContext {
   std::shared_ptr<Credentials> creds_;
   mutable std::shared_ptr<const AuthContext> auth_context_;
   struct census_context* census_context_;
-  std::multimap<grpc::string, grpc::string> send_initial_metadata_;
-  std::multimap<grpc::string_ref, grpc::string_ref> recv_initial_metadata_;
-  std::multimap<grpc::string_ref, grpc::string_ref> trailing_metadata_;
+  OutgoingMetadata send_initial_metadata_;
+  IncomingMetadata recv_initial_metadata_;
+  IncomingMetadata trailing_metadata_;
 
   grpc_call* propagate_from_call_;
   PropagationOptions propagation_options_;
@@ -144,6 +144,10 @@ class CompletionQueue : public GrpcLibrary {
   /// owership is performed.
   grpc_completion_queue* cq() { return cq_; }
 
+ protected:
+  /// Wrap \a cq, taking ownership of it only if \a take_ownership is true.
+  CompletionQueue(grpc_completion_queue* cq, bool take_ownership);
+
  private:
   // Friend synchronous wrappers so that they can access Pluck(), which is
   // a semi-private API geared towards the synchronous implementation.
@@ -185,7 +189,8 @@ class CompletionQueue : public GrpcLibrary {
   /// Performs a single polling pluck on \a tag.
   void TryPluck(CompletionQueueTag* tag);
 
-  grpc_completion_queue* cq_;  // owned
+  grpc_completion_queue* cq_;  // owned if owned_
+  bool owned_;
 };
 
 /// An interface allowing implementors to process and filter event tags.
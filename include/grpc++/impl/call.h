@@ -41,15 +41,14 @@
 #include <iostream>
 
 #include <grpc/support/alloc.h>
+#include <grpc/support/span_recorder.h>
 #include <grpc++/client_context.h>
 #include <grpc++/completion_queue.h>
 #include <grpc++/impl/serialization_traits.h>
 #include <grpc++/support/config.h>
+#include <grpc++/support/metadata.h>
 #include <grpc++/support/status.h>
 
-extern int add_func_stats(std::string funcName, uint64_t start_ns, uint64_t end_nsec, std::string fName = "", std::string desc = "");
-extern uint64_t nanos_since_midnight();
-
 struct grpc_call;
 struct grpc_op;
 
@@ -58,9 +57,6 @@ namespace grpc {
 class ByteBuffer;
 class Call;
 
-void FillMetadataMap(
-    grpc_metadata_array* arr,
-    std::multimap<grpc::string_ref, grpc::string_ref>* metadata);
 grpc_metadata* FillMetadataArray(
     const std::multimap<grpc::string, grpc::string>& metadata);
 
@@ -150,20 +146,30 @@ class CallNoOp {
 
 class CallOpSendInitialMetadata {
  public:
-  CallOpSendInitialMetadata() : send_(false) {}
+  CallOpSendInitialMetadata() : send_(false), own_metadata_(false) {}
+
+  // \a metadata must outlive the op; its entries are handed to the core
+  // without being copied.
+  void SendInitialMetadata(OutgoingMetadata& metadata) {
+    send_ = true;
+    own_metadata_ = false;
+    initial_metadata_count_ = metadata.size();
+    initial_metadata_ = metadata.c_metadata();
+  }
 
   void SendInitialMetadata(
       const std::multimap<grpc::string, grpc::string>& metadata) {
     send_ = true;
+    own_metadata_ = true;
     initial_metadata_count_ = metadata.size();
     initial_metadata_ = FillMetadataArray(metadata);
   }
 
  protected:
   void AddOp(grpc_op* ops, size_t* nops) {
-	uint64_t start, end;
+    gpr_uint64 start, end;
 
-	start = nanos_since_midnight();
+    start = gpr_span_clock_now();
     if (!send_) return;
     grpc_op* op = &ops[(*nops)++];
     op->op = GRPC_OP_SEND_INITIAL_METADATA;
@@ -171,20 +177,21 @@ class CallOpSendInitialMetadata {
     op->reserved = NULL;
     op->data.send_initial_metadata.count = initial_metadata_count_;
     op->data.send_initial_metadata.metadata = initial_metadata_;
-    end = nanos_since_midnight();
-    add_func_stats("CallOpSendInitialMetadata AddOp", start, end, std::string(__FILE__), "	AddOp after send status changed to true");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpSendInitialMetadata AddOp", start, end, 0);
   }
   void FinishOp(bool* status, int max_message_size) {
-	uint64_t start, end;
-	start = nanos_since_midnight();
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
     if (!send_) return;
-    gpr_free(initial_metadata_);
+    if (own_metadata_) gpr_free(initial_metadata_);
     send_ = false;
-    end = nanos_since_midnight();
-    add_func_stats("CallOpSendInitialMetadata FinishOp", start, end, std::string(__FILE__), "Cleanup on completion of an RPC call.Free metadata buffer and reset state.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpSendInitialMetadata FinishOp", start, end, 0);
   }
 
   bool send_;
+  bool own_metadata_;
   size_t initial_metadata_count_;
   grpc_metadata* initial_metadata_;
 };
@@ -204,9 +211,9 @@ class CallOpSendMessage {
 
  protected:
   void AddOp(grpc_op* ops, size_t* nops) {
-	uint64_t start, end;
+    gpr_uint64 start, end;
 
-	start = nanos_since_midnight();
+    start = gpr_span_clock_now();
     if (send_buf_ == nullptr) return;
     grpc_op* op = &ops[(*nops)++];
     op->op = GRPC_OP_SEND_MESSAGE;
@@ -216,17 +223,16 @@ class CallOpSendMessage {
     // Flags are per-message: clear them after use.
     write_options_.Clear();
 
-    end = nanos_since_midnight();
-    add_func_stats(" CallOpSendMessage AddOp", start, end, std::string(__FILE__), "CallOpSendMessage AddOp: Init send op and set ptr for send_buf. ");
-
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpSendMessage AddOp", start, end, 0);
   }
   void FinishOp(bool* status, int max_message_size) {
-	uint64_t start, end;
-    start = nanos_since_midnight();
-	if (own_buf_) grpc_byte_buffer_destroy(send_buf_);
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
+    if (own_buf_) grpc_byte_buffer_destroy(send_buf_);
     send_buf_ = nullptr;
-    end = nanos_since_midnight();
-    add_func_stats("CallOpSendInitialMetadata FinishOp", start, end, std::string(__FILE__), "Cleanup on completion of an RPC call.Free send byte buffer and reset state.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpSendMessage FinishOp", start, end, 0);
   }
 
  private:
@@ -267,8 +273,8 @@ class CallOpRecvMessage {
   }
 
   void FinishOp(bool* status, int max_message_size) {
-	uint64_t start, end;
-	start = nanos_since_midnight();
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
     if (message_ == nullptr) return;
     if (recv_buf_) {
       if (*status) {
@@ -284,9 +290,8 @@ class CallOpRecvMessage {
       *status = false;
     }
     message_ = nullptr;
-    end = nanos_since_midnight();
-    add_func_stats("CallOpRecvMessage FinishOp", start, end, std::string(__FILE__),
-    		"Cleanup on completion of an RECEIVE message for RPC call. Deserialize recv message, free recv byte buffer and reset state.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpRecvMessage FinishOp", start, end, 0);
   }
 
  private:
@@ -337,8 +342,8 @@ class CallOpGenericRecvMessage {
   }
 
   void FinishOp(bool* status, int max_message_size) {
-	uint64_t start, end;
-	start = nanos_since_midnight();
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
     if (!deserialize_) return;
     if (recv_buf_) {
       if (*status) {
@@ -353,9 +358,8 @@ class CallOpGenericRecvMessage {
       *status = false;
     }
     deserialize_.reset();
-    end = nanos_since_midnight();
-    add_func_stats("CallOpGenericRecvMessage FinishOp", start, end, std::string(__FILE__),
-    		"Cleanup on completion of an RECEIVE message for RPC call. Deserialize recv message, free recv byte buffer and reset state.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpGenericRecvMessage FinishOp", start, end, 0);
   }
 
  private:
@@ -378,12 +382,11 @@ class CallOpClientSendClose {
     op->reserved = NULL;
   }
   void FinishOp(bool* status, int max_message_size) {
-	uint64_t start, end;
-	start = nanos_since_midnight();
-	send_ = false;
-	end = nanos_since_midnight();
-	add_func_stats("CallOpClientSendClose FinishOp", start, end, std::string(__FILE__),
-			"Cleanup on completion of an CleintSendClose message for RPC call. Reset state.");
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
+    send_ = false;
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpClientSendClose FinishOp", start, end, 0);
   }
 
  private:
@@ -392,27 +395,46 @@ class CallOpClientSendClose {
 
 class CallOpServerSendStatus {
  public:
-  CallOpServerSendStatus() : send_status_available_(false) {}
+  CallOpServerSendStatus()
+      : send_status_available_(false), own_trailing_metadata_(false) {}
+
+  // \a trailing_metadata must outlive the op; its entries are handed to the
+  // core without being copied.
+  void ServerSendStatus(OutgoingMetadata& trailing_metadata,
+                        const Status& status) {
+    gpr_uint64 start, end;
+
+    start = gpr_span_clock_now();
+    trailing_metadata_count_ = trailing_metadata.size();
+    trailing_metadata_ = trailing_metadata.c_metadata();
+    own_trailing_metadata_ = false;
+    send_status_available_ = true;
+    send_status_code_ = static_cast<grpc_status_code>(status.error_code());
+    send_status_details_ = status.error_message();
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpServerSendStatus ServerSendStatus", start, end, 0);
+  }
 
   void ServerSendStatus(
       const std::multimap<grpc::string, grpc::string>& trailing_metadata,
       const Status& status) {
-	uint64_t start, end;
+    gpr_uint64 start, end;
 
-	start = nanos_since_midnight();
+    start = gpr_span_clock_now();
     trailing_metadata_count_ = trailing_metadata.size();
     trailing_metadata_ = FillMetadataArray(trailing_metadata);
+    own_trailing_metadata_ = true;
     send_status_available_ = true;
     send_status_code_ = static_cast<grpc_status_code>(status.error_code());
     send_status_details_ = status.error_message();
-    end = nanos_since_midnight();
-    add_func_stats(" CallOpServerSendStatus ServerSendStatus ", start, end, std::string(__FILE__), "ServerSendStatus, file trailing_metadata array, change send_status to true, add send_status code/details");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpServerSendStatus ServerSendStatus", start, end, 0);
   }
 
  protected:
   void AddOp(grpc_op* ops, size_t* nops) {
-	uint64_t start, end;
-	start = nanos_since_midnight();
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
     if (!send_status_available_) return;
     grpc_op* op = &ops[(*nops)++];
     op->op = GRPC_OP_SEND_STATUS_FROM_SERVER;
@@ -424,20 +446,18 @@ class CallOpServerSendStatus {
         send_status_details_.empty() ? nullptr : send_status_details_.c_str();
     op->flags = 0;
     op->reserved = NULL;
-	end = nanos_since_midnight();
-	add_func_stats("CallOpServerSendStatus AddOp", start, end, std::string(__FILE__),
-			"Init ServerSendStatus message OP for RPC call. Setup OP value for metadata count, status buffer to be sent, status code.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpServerSendStatus AddOp", start, end, 0);
   }
 
   void FinishOp(bool* status, int max_message_size) {
-	uint64_t start, end;
-	start = nanos_since_midnight();
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
     if (!send_status_available_) return;
-    gpr_free(trailing_metadata_);
+    if (own_trailing_metadata_) gpr_free(trailing_metadata_);
     send_status_available_ = false;
-	end = nanos_since_midnight();
-	add_func_stats("CallOpServerSendStatus FinishOp", start, end, std::string(__FILE__),
-			"Cleanup on completion of an ServerSendStatus message for RPC call. Free Metadata buffer, Reset send status state.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpServerSendStatus FinishOp", start, end, 0);
   }
 
  private:
@@ -446,6 +466,7 @@ class CallOpServerSendStatus {
   grpc::string send_status_details_;
   size_t trailing_metadata_count_;
   grpc_metadata* trailing_metadata_;
+  bool own_trailing_metadata_;
 };
 
 class CallOpRecvInitialMetadata {
@@ -459,33 +480,28 @@ class CallOpRecvInitialMetadata {
 
  protected:
   void AddOp(grpc_op* ops, size_t* nops) {
-	uint64_t start, end;
-	start = nanos_since_midnight();
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
     if (!recv_initial_metadata_) return;
-    memset(&recv_initial_metadata_arr_, 0, sizeof(recv_initial_metadata_arr_));
     grpc_op* op = &ops[(*nops)++];
     op->op = GRPC_OP_RECV_INITIAL_METADATA;
-    op->data.recv_initial_metadata = &recv_initial_metadata_arr_;
+    op->data.recv_initial_metadata = recv_initial_metadata_->c_array();
     op->flags = 0;
     op->reserved = NULL;
-	end = nanos_since_midnight();
-	add_func_stats("CallOpRecvInitialMetadata AddOp", start, end, std::string(__FILE__),
-			"Setup recv_initial_metadata_arr_, RECV META OP.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpRecvInitialMetadata AddOp", start, end, 0);
   }
   void FinishOp(bool* status, int max_message_size) {
-	uint64_t start, end;
-	start = nanos_since_midnight();
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
     if (recv_initial_metadata_ == nullptr) return;
-    FillMetadataMap(&recv_initial_metadata_arr_, recv_initial_metadata_);
     recv_initial_metadata_ = nullptr;
-	end = nanos_since_midnight();
-	add_func_stats("CallOpRecvInitialMetadata FinishOp", start, end, std::string(__FILE__),
-			"Cleanup on completion of an RecvInitialMetadata message for RPC call. Free recv_initial_metadata_ buffer, Reset recv metadata state.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpRecvInitialMetadata FinishOp", start, end, 0);
   }
 
  private:
-  std::multimap<grpc::string_ref, grpc::string_ref>* recv_initial_metadata_;
-  grpc_metadata_array recv_initial_metadata_arr_;
+  IncomingMetadata* recv_initial_metadata_;
 };
 
 class CallOpClientRecvStatus {
@@ -499,47 +515,41 @@ class CallOpClientRecvStatus {
 
  protected:
   void AddOp(grpc_op* ops, size_t* nops) {
-	uint64_t start, end;
-	start = nanos_since_midnight();
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
     if (recv_status_ == nullptr) return;
-    memset(&recv_trailing_metadata_arr_, 0,
-           sizeof(recv_trailing_metadata_arr_));
     status_details_ = nullptr;
     status_details_capacity_ = 0;
     grpc_op* op = &ops[(*nops)++];
     op->op = GRPC_OP_RECV_STATUS_ON_CLIENT;
     op->data.recv_status_on_client.trailing_metadata =
-        &recv_trailing_metadata_arr_;
+        recv_trailing_metadata_->c_array();
     op->data.recv_status_on_client.status = &status_code_;
     op->data.recv_status_on_client.status_details = &status_details_;
     op->data.recv_status_on_client.status_details_capacity =
         &status_details_capacity_;
     op->flags = 0;
     op->reserved = NULL;
-	end = nanos_since_midnight();
-	add_func_stats("CallOpClientRecvStatus AddOp", start, end, std::string(__FILE__),
-			"Setup CallOpClientRecvStatus message for RPC call. Setup recv trailing_metadata, recv buffer and status code ptr in recv_status_on_client.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpClientRecvStatus AddOp", start, end, 0);
   }
 
   void FinishOp(bool* status, int max_message_size) {
-	uint64_t start, end;
-	start = nanos_since_midnight();
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
     if (recv_status_ == nullptr) return;
-    FillMetadataMap(&recv_trailing_metadata_arr_, recv_trailing_metadata_);
     *recv_status_ = Status(
         static_cast<StatusCode>(status_code_),
         status_details_ ? grpc::string(status_details_) : grpc::string());
     gpr_free(status_details_);
     recv_status_ = nullptr;
-	end = nanos_since_midnight();
-	add_func_stats("CallOpClientRecvStatus FinishOp", start, end, std::string(__FILE__),
-			"Cleanup on completion of an CallOpClientRecvStatus message for RPC call. Free recv_trailing_metadata_arr_ buffer, Reset recv status state.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpClientRecvStatus FinishOp", start, end, 0);
   }
 
  private:
-  std::multimap<grpc::string_ref, grpc::string_ref>* recv_trailing_metadata_;
+  IncomingMetadata* recv_trailing_metadata_;
   Status* recv_status_;
-  grpc_metadata_array recv_trailing_metadata_arr_;
   grpc_status_code status_code_;
   char* status_details_;
   size_t status_details_capacity_;
@@ -584,23 +594,23 @@ class CallOpSet : public CallOpSetInterface,
  public:
   CallOpSet() : return_tag_(this) {}
   void FillOps(grpc_op* ops, size_t* nops) GRPC_OVERRIDE {
-	// Profile function
-	uint64_t start, end;
-	start = nanos_since_midnight();
+    // Profile function
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
     this->Op1::AddOp(ops, nops);
     this->Op2::AddOp(ops, nops);
     this->Op3::AddOp(ops, nops);
     this->Op4::AddOp(ops, nops);
     this->Op5::AddOp(ops, nops);
     this->Op6::AddOp(ops, nops);
-    end = nanos_since_midnight();
-    add_func_stats(" CallOpSet.FillOps", start, end, std::string(__FILE__), "FillOps: Invoke FillOps for all 6 classes.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpSet.FillOps", start, end, 0);
   }
 
   bool FinalizeResult(void** tag, bool* status) GRPC_OVERRIDE {
-	// Profile function
-	uint64_t start, end;
-	start = nanos_since_midnight();
+    // Profile function
+    gpr_uint64 start, end;
+    start = gpr_span_clock_now();
     this->Op1::FinishOp(status, max_message_size_);
     this->Op2::FinishOp(status, max_message_size_);
     this->Op3::FinishOp(status, max_message_size_);
@@ -608,8 +618,8 @@ class CallOpSet : public CallOpSetInterface,
     this->Op5::FinishOp(status, max_message_size_);
     this->Op6::FinishOp(status, max_message_size_);
     *tag = return_tag_;
-    end = nanos_since_midnight();
-    add_func_stats(" CallOpSet.FinalizeResult", start, end, std::string(__FILE__), "FinalizeResult: Invoke FinishOp for all 6 classes.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("CallOpSet.FinalizeResult", start, end, 0);
     return true;
   }
 
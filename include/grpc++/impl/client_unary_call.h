@@ -34,87 +34,74 @@
 #ifndef GRPCXX_IMPL_CLIENT_UNARY_CALL_H
 #define GRPCXX_IMPL_CLIENT_UNARY_CALL_H
 
+#include <grpc++/channel.h>
+#include <grpc++/client_context.h>
+#include <grpc++/completion_queue.h>
 #include <grpc++/impl/call.h>
 #include <grpc++/support/config.h>
 #include <grpc++/support/status.h>
-#include <grpc++/impl/grpc_profiler.h>
-#include <iostream>
-
+#include <grpc/support/span_recorder.h>
 
 namespace grpc {
 
-class Channel;
-class ClientContext;
-class CompletionQueue;
 class RpcMethod;
 
-uint64_t start, end;
-
+// The completion queue of one blocking call. Blocking calls only pluck their
+// own tags, so each thread caches one queue and lends it to all of its
+// blocking calls instead of creating and destroying a queue (and its pollset)
+// per call. The cached queue holds no reference on the library: it is
+// destroyed when the thread exits or by the last grpc_shutdown, whichever
+// comes first. A blocking call started while the thread's queue is lent out
+// (e.g. from a credentials plugin) gets a queue of its own.
+class BlockingCallCompletionQueue GRPC_FINAL : public CompletionQueue {
+ public:
+  BlockingCallCompletionQueue() : CompletionQueue(LendThreadQueue(), false) {}
+  ~BlockingCallCompletionQueue() GRPC_OVERRIDE;
+
+ private:
+  static grpc_completion_queue* LendThreadQueue();
+};
 
 // Wrapper that performs a blocking unary call
 template <class InputMessage, class OutputMessage>
 Status BlockingUnaryCall(Channel* channel, const RpcMethod& method,
                          ClientContext* context, const InputMessage& request,
                          OutputMessage* result) {
-  // Profile function
-  start = nanos_since_midnight();
-  CompletionQueue cq;
+  gpr_uint64 start = gpr_span_clock_now();
+  BlockingCallCompletionQueue cq;
   Call call(channel->CreateCall(method, context, &cq));
-  end = nanos_since_midnight();
-  add_func_stats("Call call(channel->CreateCall(method; context; &cq))", start, end, std::string(__FILE__), "Initializes obj to create a new call to given method.");
+  GPR_SPAN("BlockingUnaryCall: CreateCall", start, gpr_span_clock_now(),
+           call.call());
 
-  // Profile function
-  start = nanos_since_midnight();
+  start = gpr_span_clock_now();
   CallOpSet<CallOpSendInitialMetadata, CallOpSendMessage,
             CallOpRecvInitialMetadata, CallOpRecvMessage<OutputMessage>,
             CallOpClientSendClose, CallOpClientRecvStatus> ops;
-  end = nanos_since_midnight();
-  add_func_stats("CallOpSet<SendInitMetadata;SendMsg; RecvInitMetadata;RecvMsg;ClientSendClose; ClientRecvStatus>", start, end, std::string(__FILE__), "Initializes 6 template classes. Primary implementation of CallOpSetInterface.");
-
-  // Profile function
-  start = nanos_since_midnight();
   Status status = ops.SendMessage(request);
   if (!status.ok()) {
     return status;
   }
-  end = nanos_since_midnight();
-  add_func_stats("ops.SendMessage(request);", start, end, std::string(__FILE__), "Serializes the message and stores in local send buffer.");
+  GPR_SPAN("BlockingUnaryCall: SendMessage", start, gpr_span_clock_now(),
+           call.call());
 
-  start = nanos_since_midnight();
+  start = gpr_span_clock_now();
   ops.SendInitialMetadata(context->send_initial_metadata_);
-  end = nanos_since_midnight();
-  add_func_stats("ops.SendInitialMetadata", start, end, std::string(__FILE__), "ops.SendInitialMetadata  ");
-
-  start = nanos_since_midnight();
   ops.RecvInitialMetadata(context);
-  end = nanos_since_midnight();
-  add_func_stats("ops.RecvInitialMetadata", start, end, std::string(__FILE__), "ops.RecvInitialMetadata  ");
-
-  start = nanos_since_midnight();
   ops.RecvMessage(result);
-  end = nanos_since_midnight();
-  add_func_stats("ops.RecvMessage", start, end, std::string(__FILE__), "ops.RecvMessage  ");
-
-  start = nanos_since_midnight();
   ops.ClientSendClose();
-  end = nanos_since_midnight();
-  add_func_stats("ops.ClientSendClose", start, end, std::string(__FILE__), "ops.ClientSendClose  ");
-
-  start = nanos_since_midnight();
   ops.ClientRecvStatus(context, &status);
-  end = nanos_since_midnight();
-  add_func_stats("ops.ClientRecvStatus", start, end, std::string(__FILE__), "ops.ClientRecvStatus  ");
+  GPR_SPAN("BlockingUnaryCall: fill ops", start, gpr_span_clock_now(),
+           call.call());
 
-  start = nanos_since_midnight();
+  start = gpr_span_clock_now();
   call.PerformOps(&ops);
-  end = nanos_since_midnight();
-  add_func_stats("ops.PerformOps", start, end, std::string(__FILE__), "call.PerformOps  ");
+  GPR_SPAN("BlockingUnaryCall: PerformOps", start, gpr_span_clock_now(),
+           call.call());
 
-  start = nanos_since_midnight();
+  start = gpr_span_clock_now();
   GPR_ASSERT((cq.Pluck(&ops) && ops.got_message) || !status.ok());
-  end = nanos_since_midnight();
-  (" cq.Pluck(&ops)", start, end, std::string(__FILE__), "cq.Pluck(&ops)  ");
-
+  GPR_SPAN("BlockingUnaryCall: Pluck", start, gpr_span_clock_now(),
+           call.call());
   return status;
 }
 
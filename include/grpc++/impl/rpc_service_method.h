@@ -39,16 +39,12 @@
 #include <memory>
 #include <vector>
 
+#include <grpc/support/span_recorder.h>
 #include <grpc++/impl/rpc_method.h>
 #include <grpc++/support/config.h>
 #include <grpc++/support/status.h>
 #include <grpc++/support/sync_stream.h>
 
-extern int add_func_stats(std::string funcName, uint64_t start_ns, uint64_t end_nsec, std::string fName, std::string desc);
-extern uint64_t nanos_since_midnight();
-extern void print_all_profile_stats();
-
-
 namespace grpc {
 class ServerContext;
 class StreamContextInterface;
@@ -86,61 +82,60 @@ class RpcMethodHandler : public MethodHandler {
       : func_(func), service_(service) {}
 
   void RunHandler(const HandlerParameter& param) GRPC_FINAL {
-
-    uint64_t start, end;
+    gpr_uint64 start, end;
     RequestType req;
 
-    //point 1
-    start = nanos_since_midnight();
+    start = gpr_span_clock_now();
     Status status = SerializationTraits<RequestType>::Deserialize(
         param.request, &req, param.max_message_size);
-    end = nanos_since_midnight();
-    add_func_stats("RunHandler->Deserialize", start, end, std::string(__FILE__), " rpc_service_method.h: Deserialize ");
+    end = gpr_span_clock_now();
+    GPR_SPAN("RunHandler: Deserialize", start, end, param.call->call());
 
     ResponseType rsp;
 
-    start = nanos_since_midnight();
+    start = gpr_span_clock_now();
     if (status.ok()) {
       status = func_(service_, param.server_context, &req, &rsp);
     }
-    end = nanos_since_midnight();
-    add_func_stats("func_", start, end, std::string(__FILE__), "func_: ");
+    end = gpr_span_clock_now();
+    GPR_SPAN("RunHandler: func_", start, end, param.call->call());
 
     GPR_ASSERT(!param.server_context->sent_initial_metadata_);
 
-    start = nanos_since_midnight();
+    start = gpr_span_clock_now();
     CallOpSet<CallOpSendInitialMetadata, CallOpSendMessage,
               CallOpServerSendStatus> ops;
-    end = nanos_since_midnight();
-    add_func_stats("CallOpSet<SendInitMetadata, SendMsg, ServerSendStatus> OPS obj creation", start, end, std::string(__FILE__), "OPS obj creation with 3 templated classes");
+    end = gpr_span_clock_now();
+    GPR_SPAN("RunHandler: CallOpSet", start, end, param.call->call());
 
-    start = nanos_since_midnight();
+    start = gpr_span_clock_now();
     ops.SendInitialMetadata(param.server_context->initial_metadata_);
-    end = nanos_since_midnight();
-    add_func_stats(" ops.SendInitialMetadata", start, end, std::string(__FILE__), "ops.SendInitialMetadata. ");
+    end = gpr_span_clock_now();
+    GPR_SPAN("RunHandler: SendInitialMetadata", start, end,
+             param.call->call());
 
     if (status.ok()) {
-      start = nanos_since_midnight();
+      start = gpr_span_clock_now();
       status = ops.SendMessage(rsp);
-      end = nanos_since_midnight();
-      add_func_stats("ops.SendMessage", start, end, std::string(__FILE__), "ops.SendMessage");
+      end = gpr_span_clock_now();
+      GPR_SPAN("RunHandler: SendMessage", start, end, param.call->call());
     }
 
-    start = nanos_since_midnight();
+    start = gpr_span_clock_now();
     ops.ServerSendStatus(param.server_context->trailing_metadata_, status);
-    end = nanos_since_midnight();
-    add_func_stats(" ops.ServerSendStatus", start, end, std::string(__FILE__), "rpc_service_method.h: ops.ServerSendStatus");
+    end = gpr_span_clock_now();
+    GPR_SPAN("RunHandler: ServerSendStatus", start, end,
+             param.call->call());
 
-    start = nanos_since_midnight();
+    start = gpr_span_clock_now();
     param.call->PerformOps(&ops);
-    end = nanos_since_midnight();
-    add_func_stats(" param.call->PerformOps", start, end, std::string(__FILE__), "rpc_service_method.h: param.call->PerformOps, clent get the reply here.");
+    end = gpr_span_clock_now();
+    GPR_SPAN("RunHandler: PerformOps", start, end, param.call->call());
 
-    start = nanos_since_midnight();
+    start = gpr_span_clock_now();
     param.call->cq()->Pluck(&ops);
-    end = nanos_since_midnight();
-    add_func_stats("param.call->cq()->Pluck(&ops)", start, end, std::string(__FILE__), "param.call->cq()->Pluck(&ops), add call the the completion queue.");
-    // print_all_profile_stats();
+    end = gpr_span_clock_now();
+    GPR_SPAN("RunHandler: Pluck", start, end, param.call->call());
   }
 
  private:
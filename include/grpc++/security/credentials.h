@@ -37,6 +37,7 @@
 #include <map>
 #include <memory>
 
+#include <grpc/grpc_security.h>
 #include <grpc++/impl/grpc_library.h>
 #include <grpc++/support/config.h>
 #include <grpc++/support/status.h>
@@ -95,6 +96,20 @@ struct SslCredentialsOptions {
   grpc::string pem_cert_chain;
 };
 
+/// TLS session resumption settings for SslCredentials.
+struct SslSessionCacheOptions {
+  SslSessionCacheOptions()
+      : session_cache_size(GRPC_SSL_DEFAULT_CLIENT_SESSION_CACHE_SIZE),
+        session_timeout_seconds(0) {}
+
+  /// Maximum number of TLS sessions kept for resumption, one per target name.
+  /// 0 disables resumption and makes every connection do a full handshake.
+  size_t session_cache_size;
+
+  /// Lifetime of cached sessions. 0 keeps the TLS library default.
+  int session_timeout_seconds;
+};
+
 // Factories for building different types of Credentials The functions may
 // return empty shared_ptr when credentials cannot be created. If a
 // Credentials pointer is returned, it can still be invalid when used to create
@@ -112,6 +127,12 @@ std::shared_ptr<Credentials> GoogleDefaultCredentials();
 std::shared_ptr<Credentials> SslCredentials(
     const SslCredentialsOptions& options);
 
+/// Builds SSL Credentials given SSL specific options and explicit TLS session
+/// resumption settings.
+std::shared_ptr<Credentials> SslCredentials(
+    const SslCredentialsOptions& options,
+    const SslSessionCacheOptions& session_cache_options);
+
 /// Builds credentials for use when running in GCE
 ///
 /// \warning Only use these credentials when connecting to a Google endpoint.
@@ -37,6 +37,7 @@
 #include <memory>
 #include <vector>
 
+#include <grpc/grpc_security.h>
 #include <grpc++/security/auth_metadata_processor.h>
 #include <grpc++/support/config.h>
 
@@ -69,7 +70,11 @@ class ServerCredentials {
 
 /// Options to create ServerCredentials with SSL
 struct SslServerCredentialsOptions {
-  SslServerCredentialsOptions() : force_client_auth(false) {}
+  SslServerCredentialsOptions()
+      : force_client_auth(false),
+        session_cache_size(GRPC_SSL_DEFAULT_SERVER_SESSION_CACHE_SIZE),
+        session_timeout_seconds(0),
+        enable_session_tickets(true) {}
 
   struct PemKeyCertPair {
     grpc::string private_key;
@@ -78,6 +83,15 @@ struct SslServerCredentialsOptions {
   grpc::string pem_root_certs;
   std::vector<PemKeyCertPair> pem_key_cert_pairs;
   bool force_client_auth;
+  /// Maximum number of TLS sessions kept for resumption by session id.
+  /// 0 disables resumption.
+  size_t session_cache_size;
+  /// Lifetime of cached sessions and session tickets. 0 keeps the TLS library
+  /// default.
+  int session_timeout_seconds;
+  /// Lets clients resume with session tickets, which keeps no per-session
+  /// state on the server.
+  bool enable_session_tickets;
 };
 
 /// Builds SSL ServerCredentials given SSL specific options
@@ -168,7 +168,6 @@ class Server GRPC_FINAL : public GrpcLibrary, private CallHook {
     void* const tag_;
     const bool delete_on_finalize_;
     grpc_call* call_;
-    grpc_metadata_array initial_metadata_array_;
   };
 
   class RegisteredAsyncRequest : public BaseAsyncRequest {
@@ -41,6 +41,7 @@
 #include <grpc/support/time.h>
 #include <grpc++/security/auth_context.h>
 #include <grpc++/support/config.h>
+#include <grpc++/support/metadata.h>
 #include <grpc++/support/string_ref.h>
 #include <grpc++/support/time.h>
 
@@ -99,15 +100,21 @@ class ServerContext {
 
   gpr_timespec raw_deadline() { return deadline_; }
 
-  void AddInitialMetadata(const grpc::string& key, const grpc::string& value);
-  void AddTrailingMetadata(const grpc::string& key, const grpc::string& value);
+  void AddInitialMetadata(const grpc::string_ref& key,
+                          const grpc::string_ref& value);
+  void AddTrailingMetadata(const grpc::string_ref& key,
+                           const grpc::string_ref& value);
 
   bool IsCancelled() const;
 
   const std::multimap<grpc::string_ref, grpc::string_ref>& client_metadata() {
-    return client_metadata_;
+    return client_metadata_.map();
   }
 
+  // Same as client_metadata(), but returns the entries in the order received
+  // without building a multimap.
+  const IncomingMetadata& incoming_metadata() const { return client_metadata_; }
+
   grpc_compression_level compression_level() const {
     return compression_level_;
   }
@@ -172,8 +179,8 @@ class ServerContext {
 
   void BeginCompletionOp(Call* call);
 
-  ServerContext(gpr_timespec deadline, grpc_metadata* metadata,
-                size_t metadata_count);
+  // Takes over the entries of \a metadata, leaving it empty.
+  ServerContext(gpr_timespec deadline, grpc_metadata_array* metadata);
 
   void set_call(grpc_call* call);
 
@@ -186,9 +193,9 @@ class ServerContext {
   CompletionQueue* cq_;
   bool sent_initial_metadata_;
   mutable std::shared_ptr<const AuthContext> auth_context_;
-  std::multimap<grpc::string_ref, grpc::string_ref> client_metadata_;
-  std::multimap<grpc::string, grpc::string> initial_metadata_;
-  std::multimap<grpc::string, grpc::string> trailing_metadata_;
+  IncomingMetadata client_metadata_;
+  OutgoingMetadata initial_metadata_;
+  OutgoingMetadata trailing_metadata_;
 
   grpc_compression_level compression_level_;
   grpc_compression_algorithm compression_algorithm_;
@@ -47,8 +47,18 @@
 #define GRPC_CXX0X_NO_CHRONO 1
 #define GRPC_CXX0X_NO_THREAD 1
 #endif
+// Visual Studio 2015 is 1900.
+#if _MSC_VER < 1900
+#define GRPC_CXX0X_NO_THREAD_LOCAL 1
+#endif
 #endif  // Visual Studio
 
+#ifdef __clang__
+#if !__has_feature(cxx_thread_local)
+#define GRPC_CXX0X_NO_THREAD_LOCAL 1
+#endif
+#endif
+
 #ifndef __clang__
 #ifdef __GNUC__
 // nullptr was added in gcc 4.6
@@ -60,6 +70,10 @@
 #define GRPC_CXX0X_NO_FINAL 1
 #define GRPC_CXX0X_NO_OVERRIDE 1
 #endif
+// thread_local was added in gcc 4.8
+#if (__GNUC__ * 100 + __GNUC_MINOR__ < 408)
+#define GRPC_CXX0X_NO_THREAD_LOCAL 1
+#endif
 #endif
 #endif
 
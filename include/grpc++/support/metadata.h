@@ -0,0 +1,155 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef GRPCXX_SUPPORT_METADATA_H
+#define GRPCXX_SUPPORT_METADATA_H
+
+#include <map>
+
+#include <grpc/grpc.h>
+#include <grpc++/support/config.h>
+#include <grpc++/support/string_ref.h>
+
+namespace grpc {
+
+class CallOpClientRecvStatus;
+class CallOpRecvInitialMetadata;
+class CallOpSendInitialMetadata;
+class CallOpServerSendStatus;
+class Server;
+class ServerContext;
+
+/// Metadata to be sent on a call, kept as a flat array of \a grpc_metadata in
+/// insertion order so that it can be handed to the core as is.
+///
+/// Keys and values are copied into an arena. The first few entries and the
+/// first few hundred bytes live inside the object itself, so a call carrying a
+/// handful of short headers sends them without touching the heap. Larger sets
+/// spill into heap blocks that are never moved, so data handed out earlier
+/// stays valid until the container is destroyed.
+class OutgoingMetadata {
+ public:
+  OutgoingMetadata();
+  ~OutgoingMetadata();
+
+  /// Append the (\a key, \a value) pair. Both are copied.
+  void Add(const grpc::string_ref& key, const grpc::string_ref& value);
+
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+
+  /// Return the key or value of the \a i-th entry, in insertion order.
+  grpc::string_ref key(size_t i) const;
+  grpc::string_ref value(size_t i) const;
+
+ private:
+  friend class CallOpSendInitialMetadata;
+  friend class CallOpServerSendStatus;
+
+  static const size_t kInlineEntries = 8;
+  static const size_t kInlineBytes = 256;
+
+  struct Block;
+
+  // Prevent copying: entries point into the arena.
+  OutgoingMetadata(const OutgoingMetadata&);
+  OutgoingMetadata& operator=(const OutgoingMetadata&);
+
+  // Entries in the layout expected by the core. Valid until the next Add().
+  grpc_metadata* c_metadata() { return entries_; }
+
+  char* CopyToArena(const grpc::string_ref& str);
+
+  grpc_metadata* entries_;
+  size_t count_;
+  size_t capacity_;
+  char* arena_;
+  size_t arena_left_;
+  Block* blocks_;
+  grpc_metadata inline_entries_[kInlineEntries];
+  char inline_bytes_[kInlineBytes];
+};
+
+/// Metadata received on a call. The core fills the underlying
+/// \a grpc_metadata_array directly and entries are read from it in place; keys
+/// and values refer to storage owned by the call and stay valid for its
+/// lifetime.
+///
+/// A multimap view is still available through \a map(), and is only built the
+/// first time it is asked for.
+class IncomingMetadata {
+ public:
+  typedef std::multimap<grpc::string_ref, grpc::string_ref> Map;
+
+  IncomingMetadata();
+  ~IncomingMetadata();
+
+  size_t size() const { return array_.count; }
+  bool empty() const { return array_.count == 0; }
+
+  /// Return the key or value of the \a i-th entry, in the order received.
+  grpc::string_ref key(size_t i) const;
+  grpc::string_ref value(size_t i) const;
+
+  /// Look up the first entry for \a key. Return true and set \a value if one
+  /// was found.
+  bool Find(const grpc::string_ref& key, grpc::string_ref* value) const;
+
+  /// Return all entries as a multimap, building it on first use.
+  const Map& map() const;
+
+ private:
+  friend class CallOpClientRecvStatus;
+  friend class CallOpRecvInitialMetadata;
+  friend class Server;
+  friend class ServerContext;
+
+  // Prevent copying.
+  IncomingMetadata(const IncomingMetadata&);
+  IncomingMetadata& operator=(const IncomingMetadata&);
+
+  // Drop the current entries and return the array for the core to fill.
+  grpc_metadata_array* c_array();
+  // Take over the entries of \a array, leaving it with our old (empty)
+  // storage.
+  void Swap(grpc_metadata_array* array);
+
+  grpc_metadata_array array_;
+  mutable bool map_built_;
+  mutable Map map_;
+};
+
+}  // namespace grpc
+
+#endif  // GRPCXX_SUPPORT_METADATA_H
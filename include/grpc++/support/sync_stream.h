@@ -99,6 +99,40 @@ class WriterInterface {
   ///
   /// \return \a true on success, \a false when the stream has been closed.
   inline bool Write(const W& msg) { return Write(msg, WriteOptions()); }
+
+  /// Blocking write of the messages in [\a first, \a last) to the stream.
+  /// All but the last are written with the buffer hint set, so the library
+  /// completes them without waiting on the transport and can hand them to it
+  /// together, with the last one, instead of one at a time.
+  ///
+  /// \param first, last The range of messages to be written.
+  /// \param options Options affecting each write operation.
+  ///
+  /// \return \a true on success, \a false when the stream has been closed.
+  template <class ForwardIterator>
+  bool WriteAll(ForwardIterator first, ForwardIterator last,
+                const WriteOptions& options) {
+    while (first != last) {
+      const W& msg = *first;
+      WriteOptions msg_options = options;
+      if (++first != last) {
+        msg_options.set_buffer_hint();
+      }
+      if (!Write(msg, msg_options)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// Blocking write of the messages in [\a first, \a last) to the stream
+  /// with default options.
+  ///
+  /// \return \a true on success, \a false when the stream has been closed.
+  template <class ForwardIterator>
+  bool WriteAll(ForwardIterator first, ForwardIterator last) {
+    return WriteAll(first, last, WriteOptions());
+  }
 };
 
 /// Client-side interface for streaming reads of message of type \a R.
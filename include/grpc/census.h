@@ -386,8 +386,9 @@ void census_tag_set_close(census_tag_set_iterator *it);
            counts of events.
          Distribution - statistical distribution information, used for
            recording average, standard deviation etc.
-         Histogram - a histogram of measurements falling in defined bucket
-           boundaries.
+         Histogram - a histogram of measurements, kept to a fixed number of
+           significant digits across its whole range (see
+           census_histogram_options).
          Window - a count of events that happen in reolling time window.
      New aggregation types can be added by the user, if desired (see
      census_register_aggregation()).
@@ -420,6 +421,16 @@ extern census_aggregation_ops census_agg_distribution;
 extern census_aggregation_ops census_agg_histogram;
 extern census_aggregation_ops census_agg_window;
 
+/** Creation argument for census_agg_histogram. Values are recorded as
+    integers in [0, highest_trackable_value], to significant_digits (1..5)
+    decimal digits of precision. A NULL create_arg uses a highest trackable
+    value of 1e12 and 3 significant digits. The data() of a histogram
+    aggregation is a gpr_hdr_histogram (see grpc/support/hdr_histogram.h). */
+typedef struct {
+  gpr_int64 highest_trackable_value;
+  int significant_digits;
+} census_histogram_options;
+
 /** Information needed to instantiate a new aggregation. Used in view
     construction via census_define_view(). */
 typedef struct {
@@ -45,12 +45,21 @@ extern "C" {
 /** To be used in channel arguments */
 #define GRPC_COMPRESSION_ALGORITHM_ARG "grpc.compression_algorithm"
 #define GRPC_COMPRESSION_ALGORITHM_STATE_ARG "grpc.compression_algorithm_state"
+/** Messages shorter than this many bytes are sent uncompressed; defaults to
+    128 */
+#define GRPC_COMPRESSION_MIN_MESSAGE_SIZE_ARG \
+  "grpc.compression_min_message_size"
+/** If non-zero (the default), messages that look incompressible, and methods
+    whose messages haven't been shrinking, are sent uncompressed without
+    first spending the cpu on compressing them */
+#define GRPC_COMPRESSION_ADAPTIVE_ARG "grpc.compression_adaptive"
 
 /* The various compression algorithms supported by GRPC */
 typedef enum {
   GRPC_COMPRESS_NONE = 0,
   GRPC_COMPRESS_DEFLATE,
   GRPC_COMPRESS_GZIP,
+  GRPC_COMPRESS_LZ4,
   /* TODO(ctiller): snappy */
   GRPC_COMPRESS_ALGORITHMS_COUNT
 } grpc_compression_algorithm;
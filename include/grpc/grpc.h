@@ -124,6 +124,40 @@ typedef struct {
 /** Initial sequence number for http2 transports */
 #define GRPC_ARG_HTTP2_INITIAL_SEQUENCE_NUMBER \
   "grpc.http2.initial_sequence_number"
+/** Whether http2 transports probe the bandwidth-delay product with PINGs and
+    size their receive windows to it (boolean integer); defaults to 1 */
+#define GRPC_ARG_HTTP2_BDP_PROBE "grpc.http2.bdp_probe"
+/** Upper bound, in bytes, on the receive window a http2 transport grants
+    across all of its streams when sizing windows to the bandwidth-delay
+    product; defaults to 16MB */
+#define GRPC_ARG_HTTP2_FLOW_CONTROL_BUDGET "grpc.http2.flow_control_budget"
+/** Bytes a http2 stream may write, per unit of write weight, each time the
+    transport's round robin write scheduler visits it (a stream with no
+    other writable stream around may take several quanta); 0 lets the first
+    writable stream use the whole connection window. Defaults to 16KB */
+#define GRPC_ARG_HTTP2_WRITE_QUANTUM "grpc.http2.write_quantum"
+/** Write weight (1-256) of calls that do not set
+    GRPC_WRITE_WEIGHT_METADATA_KEY; defaults to 1 */
+#define GRPC_ARG_HTTP2_DEFAULT_WRITE_WEIGHT "grpc.http2.default_write_weight"
+/** Size, in bytes, of the HPACK table http2 transports decode headers
+    with (advertised as SETTINGS_HEADER_TABLE_SIZE); 4096 to 1MB, defaults to
+    4096 */
+#define GRPC_ARG_HTTP2_HPACK_TABLE_SIZE_DECODER \
+  "grpc.http2.hpack_table_size.decoder"
+/** Largest HPACK table, in bytes, http2 transports encode headers with, if
+    the peer allows it; 0 to 1MB, defaults to 64KB */
+#define GRPC_ARG_HTTP2_HPACK_TABLE_SIZE_ENCODER \
+  "grpc.http2.hpack_table_size.encoder"
+/** Maximum number of connections a subchannel may open to its address.
+    Calls are spread across the connections by least active streams; defaults
+    to 1 */
+#define GRPC_ARG_MAX_SUBCHANNEL_CONNECTIONS "grpc.max_subchannel_connections"
+/** Once every connection of a subchannel carries at least this many active
+    streams, the next call opens another connection (up to
+    GRPC_ARG_MAX_SUBCHANNEL_CONNECTIONS) and is started on it; with 0 every
+    call opens one until the pool is full. Defaults to 1 */
+#define GRPC_ARG_SUBCHANNEL_STREAMS_PER_CONNECTION \
+  "grpc.subchannel_streams_per_connection"
 /** Default authority to pass if none specified on call construction */
 #define GRPC_ARG_DEFAULT_AUTHORITY "grpc.default_authority"
 /** Primary user agent: goes at the start of the user-agent metadata
@@ -141,6 +175,12 @@ typedef struct {
    channel, it will just be ignored. */
 #define GRPC_SSL_TARGET_NAME_OVERRIDE_ARG "grpc.ssl_target_name_override"
 
+/** Initial metadata key whose decimal value (1-256) sets a call's write
+    weight: on a busy http2 connection, a call with weight 4 gets four times
+    the write bandwidth of a call with weight 1. Sent by a client it weighs
+    both the requests and the responses of the call. */
+#define GRPC_WRITE_WEIGHT_METADATA_KEY "grpc-write-weight"
+
 /** Connectivity state of a channel. */
 typedef enum {
   /** channel is idle */
@@ -501,7 +541,8 @@ grpc_call *grpc_channel_create_call(grpc_channel *channel,
                                     const char *method, const char *host,
                                     gpr_timespec deadline, void *reserved);
 
-/** Pre-register a method/host pair on a channel. */
+/** Pre-register a method/host pair on a channel. Registering the same pair
+    again returns the same handle. */
 void *grpc_channel_register_call(grpc_channel *channel, const char *method,
                                  const char *host, void *reserved);
 
@@ -92,6 +92,31 @@ grpc_credentials *grpc_ssl_credentials_create(
     const char *pem_root_certs, grpc_ssl_pem_key_cert_pair *pem_key_cert_pair,
     void *reserved);
 
+/* TLS session resumption settings.
+   - session_cache_size is the maximum number of TLS sessions kept for
+     resumption: one per target name on a client, by session id on a server.
+     0 disables resumption.
+   - session_timeout_seconds is the lifetime of cached sessions and session
+     tickets. 0 keeps the TLS library default.
+   - enable_session_tickets, for servers only, lets clients resume with
+     RFC 5077 session tickets so that the server keeps no per-session state. */
+typedef struct {
+  size_t session_cache_size;
+  int session_timeout_seconds;
+  int enable_session_tickets;
+} grpc_ssl_session_cache_options;
+
+/* Session cache sizes used by the credentials created without explicit
+   session cache options. */
+#define GRPC_SSL_DEFAULT_CLIENT_SESSION_CACHE_SIZE 64
+#define GRPC_SSL_DEFAULT_SERVER_SESSION_CACHE_SIZE 20480
+
+/* Same as grpc_ssl_credentials_create with explicit session resumption
+   settings. session_cache cannot be NULL. */
+grpc_credentials *grpc_ssl_credentials_create_with_session_cache(
+    const char *pem_root_certs, grpc_ssl_pem_key_cert_pair *pem_key_cert_pair,
+    const grpc_ssl_session_cache_options *session_cache, void *reserved);
+
 /* Creates a composite credentials object. */
 grpc_credentials *grpc_composite_credentials_create(grpc_credentials *creds1,
                                                     grpc_credentials *creds2,
@@ -205,6 +230,13 @@ grpc_server_credentials *grpc_ssl_server_credentials_create(
     const char *pem_root_certs, grpc_ssl_pem_key_cert_pair *pem_key_cert_pairs,
     size_t num_key_cert_pairs, int force_client_auth, void *reserved);
 
+/* Same as grpc_ssl_server_credentials_create with explicit session resumption
+   settings. session_cache cannot be NULL. */
+grpc_server_credentials *grpc_ssl_server_credentials_create_with_session_cache(
+    const char *pem_root_certs, grpc_ssl_pem_key_cert_pair *pem_key_cert_pairs,
+    size_t num_key_cert_pairs, int force_client_auth,
+    const grpc_ssl_session_cache_options *session_cache, void *reserved);
+
 /* --- Server-side secure ports. --- */
 
 /* Add a HTTP2 over an encrypted link over tcp listener.
@@ -213,6 +245,20 @@ grpc_server_credentials *grpc_ssl_server_credentials_create(
 int grpc_server_add_secure_http2_port(grpc_server *server, const char *addr,
                                       grpc_server_credentials *creds);
 
+/* --- Security handshakes. --- */
+
+/* Runs the CPU heavy steps of security handshakes (processing the peer's
+   handshake messages and computing the answer) on a dedicated pool of
+   num_threads threads instead of on the I/O thread that received the
+   messages. This keeps established connections responsive while many new
+   ones are being set up. At most max_queued_steps steps wait for a handshake
+   thread; further steps run inline on the I/O thread.
+   num_threads == 0, the default, runs every step inline. The setting applies
+   to all channels and servers of the process. It must not be changed from a
+   callback run by a handshake. */
+void grpc_security_set_handshake_offload(size_t num_threads,
+                                         size_t max_queued_steps);
+
 /* --- Call specific credentials. --- */
 
 /* Sets a credentials to a call. Can only be called on the client side before
@@ -0,0 +1,121 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef GRPC_SUPPORT_HDR_HISTOGRAM_H
+#define GRPC_SUPPORT_HDR_HISTOGRAM_H
+
+#include <grpc/support/port_platform.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A concurrent histogram of non-negative integer values using the HDR
+   (high dynamic range) layout: values are grouped in power-of-two buckets,
+   each split into enough linear sub-buckets that every recorded value is
+   preserved to significant_digits decimal digits of precision.
+
+   Recording is lock-free (a single atomic increment) and may be called from
+   any number of threads concurrently. Everything else (queries, merge,
+   snapshot) may run concurrently with recording, and sees each recorded
+   value either entirely or not at all; queries are computed from the bucket
+   counts, so the minimum, maximum and mean are exact to the histogram's
+   precision. */
+typedef struct gpr_hdr_histogram gpr_hdr_histogram;
+
+/* Create a histogram able to track values in [0, highest_trackable_value]
+   with significant_digits (1..5) decimal digits of precision. Values beyond
+   the trackable range are clamped to it. */
+gpr_hdr_histogram *gpr_hdr_histogram_create(gpr_int64 highest_trackable_value,
+                                            int significant_digits);
+void gpr_hdr_histogram_destroy(gpr_hdr_histogram *h);
+
+/* Record one (or count) occurrences of value. Negative values are recorded
+   as zero. */
+void gpr_hdr_histogram_record(gpr_hdr_histogram *h, gpr_int64 value);
+void gpr_hdr_histogram_record_n(gpr_hdr_histogram *h, gpr_int64 value,
+                                gpr_int64 count);
+
+/* Record value, correcting for coordinated omission: a client that expects
+   to issue a request every expected_interval but was stalled for value
+   could not issue the requests that would have observed the stall, so
+   synthesize them, recording value - expected_interval, value - 2 *
+   expected_interval, ... down to expected_interval. An expected_interval
+   <= 0 disables the correction. */
+void gpr_hdr_histogram_record_corrected(gpr_hdr_histogram *h, gpr_int64 value,
+                                        gpr_int64 expected_interval);
+
+/* Add the contents of src to dst. Both must have been created with the same
+   parameters. Returns 0 on failure, 1 on success. */
+int gpr_hdr_histogram_merge(gpr_hdr_histogram *dst,
+                            const gpr_hdr_histogram *src);
+
+/* Move the contents of h into dst (which must have the same parameters as h)
+   and leave h empty, without blocking concurrent writers to h: each value
+   recorded into h ends up in exactly one of dst or a later snapshot. Returns
+   0 on failure, 1 on success. */
+int gpr_hdr_histogram_snapshot_and_reset(gpr_hdr_histogram *h,
+                                         gpr_hdr_histogram *dst);
+void gpr_hdr_histogram_reset(gpr_hdr_histogram *h);
+
+gpr_int64 gpr_hdr_histogram_count(const gpr_hdr_histogram *h);
+gpr_int64 gpr_hdr_histogram_min(const gpr_hdr_histogram *h);
+gpr_int64 gpr_hdr_histogram_max(const gpr_hdr_histogram *h);
+double gpr_hdr_histogram_mean(const gpr_hdr_histogram *h);
+double gpr_hdr_histogram_stddev(const gpr_hdr_histogram *h);
+/* Return the value below which percentile (0..100) percent of the recorded
+   values fall, to the histogram's precision. */
+gpr_int64 gpr_hdr_histogram_value_at_percentile(const gpr_hdr_histogram *h,
+                                                double percentile);
+
+/* Raw access to the bucket counts, for transferring a histogram between
+   processes: two histograms with the same parameters have the same number of
+   buckets, and bucket i covers values [lowest, highest] as returned by
+   gpr_hdr_histogram_bucket_range. */
+size_t gpr_hdr_histogram_num_buckets(const gpr_hdr_histogram *h);
+gpr_int64 gpr_hdr_histogram_count_at_index(const gpr_hdr_histogram *h,
+                                           size_t index);
+void gpr_hdr_histogram_bucket_range(const gpr_hdr_histogram *h, size_t index,
+                                    gpr_int64 *lowest, gpr_int64 *highest);
+/* Add data_count bucket counts to h. Returns 0 if data_count does not match
+   gpr_hdr_histogram_num_buckets(h), 1 on success. */
+int gpr_hdr_histogram_merge_contents(gpr_hdr_histogram *h,
+                                     const gpr_uint32 *data,
+                                     size_t data_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GRPC_SUPPORT_HDR_HISTOGRAM_H */
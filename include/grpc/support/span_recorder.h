@@ -0,0 +1,103 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef GRPC_SUPPORT_SPAN_RECORDER_H
+#define GRPC_SUPPORT_SPAN_RECORDER_H
+
+/* Span recorder: a low overhead profiler for the time spent in sections of
+   code, meant to be left compiled in.
+
+   A span is a probe (a named section of code), a start time, a duration and
+   the id of the call it was recorded for. Each thread appends its spans to
+   its own fixed size ring buffer without locking; a background thread drains
+   the rings into a bounded log that keeps the most recent spans, which can
+   be exported in the Chrome trace event format (load it in chrome://tracing
+   to see the timeline of each thread). Spans are dropped rather than blocking
+   the recording thread when its ring is full.
+
+   Recording is off until gpr_span_recorder_start is called; while it is off,
+   gpr_span_clock_now and GPR_SPAN cost a call and an atomic load each, and
+   the clock is not read.
+
+   Usage:
+     gpr_uint64 start = gpr_span_clock_now();
+     ...
+     GPR_SPAN("Channel::CreateCall", start, gpr_span_clock_now(), call); */
+
+#include <grpc/support/atm.h>
+#include <grpc/support/port_platform.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Returns the current time of the span clock: the cycle counter where
+   available, or else the monotonic clock in nanoseconds. Returns 0 without
+   reading the clock while recording is off. */
+gpr_uint64 gpr_span_clock_now(void);
+
+/* Starts recording, keeping at most max_spans spans in the log. Spans of a
+   previous recording that have not been exported are discarded. */
+void gpr_span_recorder_start(size_t max_spans);
+
+/* Stops recording. The recorded spans are kept until exported. */
+void gpr_span_recorder_stop(void);
+
+/* Writes the spans of the log in the Chrome trace event JSON format into
+   filename, and clears the log. Returns 1 on success, 0 on failure. */
+int gpr_span_recorder_export_chrome_trace(const char *filename);
+
+/* Records a span of the probe probe_name, from start to end (values of
+   gpr_span_clock_now), unless either was read while recording was off.
+   *probe caches the id of the probe: it must be zero initialized and used
+   only with probe_name, which must be a string literal or otherwise outlive
+   the recorder. Use GPR_SPAN instead. */
+void gpr_span_record(gpr_atm *probe, const char *probe_name, gpr_uint64 start,
+                     gpr_uint64 end, gpr_uintptr call_id);
+
+/* Records a span of the probe probe_name (a string literal) for call_id, the
+   address of the call or 0. */
+#define GPR_SPAN(probe_name, start, end, call_id)                      \
+  do {                                                                 \
+    static gpr_atm gpr_span_probe_ = 0;                                \
+    gpr_span_record(&gpr_span_probe_, probe_name, start, end,          \
+                    (gpr_uintptr)(call_id));                           \
+  } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GRPC_SUPPORT_SPAN_RECORDER_H */
@@ -0,0 +1,137 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <grpc/census.h>
+
+#include <string.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/hdr_histogram.h>
+#include <grpc/support/log.h>
+#include <grpc/support/string_util.h>
+#include "src/core/census/aggregation.h"
+
+/* census_agg_histogram: a concurrent HDR histogram, so that many threads can
+   record against the same view without locking. */
+
+#define DEFAULT_HIGHEST_TRACKABLE_VALUE 1000000000000
+#define DEFAULT_SIGNIFICANT_DIGITS 3
+
+typedef struct {
+  census_histogram_options options;
+  gpr_hdr_histogram *histogram;
+} census_histogram;
+
+static void *histogram_create(const void *create_arg) {
+  census_histogram *h = gpr_malloc(sizeof(census_histogram));
+  if (create_arg != NULL) {
+    h->options = *(const census_histogram_options *)create_arg;
+  } else {
+    h->options.highest_trackable_value = DEFAULT_HIGHEST_TRACKABLE_VALUE;
+    h->options.significant_digits = DEFAULT_SIGNIFICANT_DIGITS;
+  }
+  h->histogram = gpr_hdr_histogram_create(h->options.highest_trackable_value,
+                                          h->options.significant_digits);
+  return h;
+}
+
+static void *histogram_clone(const void *aggregation) {
+  const census_histogram *from = aggregation;
+  census_histogram *h = histogram_create(&from->options);
+  gpr_hdr_histogram_merge(h->histogram, from->histogram);
+  return h;
+}
+
+static void histogram_free(void *aggregation) {
+  census_histogram *h = aggregation;
+  gpr_hdr_histogram_destroy(h->histogram);
+  gpr_free(h);
+}
+
+static void histogram_record(void *aggregation, double value) {
+  census_histogram *h = aggregation;
+  gpr_hdr_histogram_record(h->histogram, (gpr_int64)(value + 0.5));
+}
+
+static void *histogram_data(const void *aggregation) {
+  const census_histogram *from = aggregation;
+  gpr_hdr_histogram *data =
+      gpr_hdr_histogram_create(from->options.highest_trackable_value,
+                               from->options.significant_digits);
+  gpr_hdr_histogram_merge(data, from->histogram);
+  return data;
+}
+
+static void histogram_free_data(void *data) { gpr_hdr_histogram_destroy(data); }
+
+static void histogram_reset(void *aggregation) {
+  census_histogram *h = aggregation;
+  gpr_hdr_histogram_reset(h->histogram);
+}
+
+static void histogram_merge(void *to, const void *from) {
+  census_histogram *dst = to;
+  const census_histogram *src = from;
+  GPR_ASSERT(gpr_hdr_histogram_merge(dst->histogram, src->histogram));
+}
+
+static size_t histogram_print(const void *aggregation, char *buffer,
+                              size_t n) {
+  const census_histogram *h = aggregation;
+  char *text;
+  size_t len;
+  if (n == 0) return 0;
+  gpr_asprintf(
+      &text, "count=%lld min=%lld p50=%lld p90=%lld p99=%lld max=%lld",
+      (long long)gpr_hdr_histogram_count(h->histogram),
+      (long long)gpr_hdr_histogram_min(h->histogram),
+      (long long)gpr_hdr_histogram_value_at_percentile(h->histogram, 50),
+      (long long)gpr_hdr_histogram_value_at_percentile(h->histogram, 90),
+      (long long)gpr_hdr_histogram_value_at_percentile(h->histogram, 99),
+      (long long)gpr_hdr_histogram_max(h->histogram));
+  len = strlen(text);
+  if (len >= n) {
+    memcpy(buffer, text, n - 1);
+    buffer[n - 1] = 0;
+    len = n;
+  } else {
+    memcpy(buffer, text, len + 1);
+  }
+  gpr_free(text);
+  return len;
+}
+
+census_aggregation_ops census_agg_histogram = {
+    histogram_create, histogram_clone, histogram_free,
+    histogram_record, histogram_data,  histogram_free_data,
+    histogram_reset,  histogram_merge, histogram_print};
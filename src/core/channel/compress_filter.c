@@ -32,18 +32,69 @@
  */
 
 #include <assert.h>
+#include <math.h>
 #include <string.h>
 
 #include <grpc/compression.h>
 #include <grpc/support/alloc.h>
+#include <grpc/support/atm.h>
 #include <grpc/support/log.h>
 #include <grpc/support/slice_buffer.h>
+#include <grpc/support/sync.h>
+#include <grpc/support/useful.h>
 
 #include "src/core/channel/compress_filter.h"
 #include "src/core/channel/channel_args.h"
 #include "src/core/compression/message_compress.h"
 #include "src/core/support/string.h"
 
+#define DEFAULT_MIN_MESSAGE_SIZE 128
+
+/* The entropy estimate is only made for messages of at least
+   ENTROPY_MIN_BYTES: it needs that many samples to tell random data apart
+   from merely varied data. Longer messages are sampled in ENTROPY_CHUNKS
+   chunks of ENTROPY_CHUNK_SIZE bytes, spread evenly across the message. */
+#define ENTROPY_MIN_BYTES 1024
+#define ENTROPY_CHUNKS 16
+#define ENTROPY_CHUNK_SIZE 256
+/* Above this many bits per byte, deflate can't save more than about 6% */
+#define INCOMPRESSIBLE_BITS_PER_BYTE 7.5
+
+/* Compression ratios (compressed over raw size) are kept in 1/1024ths. A
+   method whose running ratio is above POOR_RATIO after at least
+   MIN_RATIO_SAMPLES messages sends FIRST_PROBE_INTERVAL messages
+   uncompressed before trying again; the interval doubles, up to
+   MAX_PROBE_INTERVAL, for as long as the retries don't do better. */
+#define RATIO_ONE 1024
+#define POOR_RATIO 922
+#define MIN_RATIO_SAMPLES 4
+#define FIRST_PROBE_INTERVAL 16
+#define MAX_PROBE_INTERVAL 1024
+
+/* Methods tracked per channel; calls to any further methods share one
+   entry */
+#define NUM_METHOD_SLOTS 64
+
+typedef struct method_stats {
+  /** The :path this entry is for (NULL for the shared entry) */
+  grpc_mdstr *method;
+  /** Running compression ratio, in 1/1024ths */
+  gpr_uint32 ratio;
+  /** Messages the ratio has been measured on */
+  gpr_uint32 samples;
+  /** Messages still to be sent uncompressed before trying again */
+  gpr_uint32 skip_remaining;
+  /** What skip_remaining was last set to; 0 while compressing */
+  gpr_uint32 probe_interval;
+} method_stats;
+
+static gpr_atm g_compressed;
+static gpr_atm g_not_smaller;
+static gpr_atm g_skipped_small;
+static gpr_atm g_skipped_entropy;
+static gpr_atm g_skipped_method;
+static gpr_atm g_methods_disabled;
+
 typedef struct call_data {
   gpr_slice_buffer slices; /**< Buffers up input slices to be compressed */
   grpc_linked_mdelem compression_algorithm_storage;
@@ -56,6 +107,17 @@ typedef struct call_data {
   grpc_compression_algorithm compression_algorithm;
   /** If true, contents of \a compression_algorithm are authoritative */
   int has_compression_algorithm;
+  /** Whether the message being sent is to be compressed */
+  int compress_message;
+  /** Compression statistics for this call's method, once it is known */
+  method_stats *method;
+  /** Seen the incoming initial metadata? */
+  int got_initial_metadata;
+  /** recv callback: the incoming initial metadata carries the method on the
+      server side */
+  grpc_stream_op_buffer *recv_ops;
+  grpc_closure *on_done_recv;
+  grpc_closure compress_on_recv;
 } call_data;
 
 typedef struct channel_data {
@@ -73,8 +135,161 @@ typedef struct channel_data {
   grpc_compression_algorithm default_compression_algorithm;
   /** Compression options for the channel */
   grpc_compression_options compression_options;
+  /** Metadata key for the method */
+  grpc_mdstr *mdstr_path_key;
+  /** Messages shorter than this are sent uncompressed */
+  gpr_uint32 min_message_size;
+  /** Whether to skip compression of messages that won't shrink */
+  int adaptive;
+  /** Guards methods and other_methods */
+  gpr_mu mu;
+  /** Per method compression statistics, open addressed by the :path hash */
+  method_stats methods[NUM_METHOD_SLOTS];
+  /** Shared by the methods that don't fit into \a methods */
+  method_stats other_methods;
 } channel_data;
 
+void grpc_compress_filter_get_stats(grpc_compress_filter_stats *stats) {
+  stats->compressed = gpr_atm_no_barrier_load(&g_compressed);
+  stats->not_smaller = gpr_atm_no_barrier_load(&g_not_smaller);
+  stats->skipped_small = gpr_atm_no_barrier_load(&g_skipped_small);
+  stats->skipped_entropy = gpr_atm_no_barrier_load(&g_skipped_entropy);
+  stats->skipped_method = gpr_atm_no_barrier_load(&g_skipped_method);
+  stats->methods_disabled = gpr_atm_no_barrier_load(&g_methods_disabled);
+}
+
+/** Returns the statistics entry for \a method, creating it if need be. */
+static method_stats *find_method_stats(channel_data *channeld,
+                                       grpc_mdstr *method) {
+  size_t i;
+  size_t slot = method->hash % NUM_METHOD_SLOTS;
+  method_stats *stats = &channeld->other_methods;
+  gpr_mu_lock(&channeld->mu);
+  for (i = 0; i < NUM_METHOD_SLOTS; i++) {
+    method_stats *candidate = &channeld->methods[(slot + i) % NUM_METHOD_SLOTS];
+    if (candidate->method == method) {
+      stats = candidate;
+      break;
+    }
+    if (candidate->method == NULL) {
+      candidate->method = GRPC_MDSTR_REF(method);
+      stats = candidate;
+      break;
+    }
+  }
+  gpr_mu_unlock(&channeld->mu);
+  return stats;
+}
+
+/** Returns 1 if the next message of \a stats' method should be compressed,
+ * or 0 if it's one of those sent uncompressed while the method isn't
+ * compressing well. */
+static int method_wants_compression(channel_data *channeld,
+                                    method_stats *stats) {
+  int wants_compression = 1;
+  gpr_mu_lock(&channeld->mu);
+  if (stats->skip_remaining > 0) {
+    stats->skip_remaining--;
+    wants_compression = 0;
+  }
+  gpr_mu_unlock(&channeld->mu);
+  return wants_compression;
+}
+
+/** Folds the compression \a ratio (in 1/1024ths) of a message into \a
+ * stats, and decides whether the method's next messages get compressed. */
+static void record_ratio(channel_data *channeld, method_stats *stats,
+                         gpr_uint32 ratio) {
+  int disabled = 0;
+  gpr_mu_lock(&channeld->mu);
+  if (stats->samples == 0) {
+    stats->ratio = ratio;
+  } else {
+    /* new = 3/4 old + 1/4 ratio */
+    stats->ratio = (3 * stats->ratio + ratio) / 4;
+  }
+  if (stats->samples < MIN_RATIO_SAMPLES) stats->samples++;
+  if (stats->samples >= MIN_RATIO_SAMPLES && stats->ratio > POOR_RATIO) {
+    if (stats->probe_interval == 0) {
+      stats->probe_interval = FIRST_PROBE_INTERVAL;
+      disabled = 1;
+    } else {
+      stats->probe_interval =
+          GPR_MIN(2 * stats->probe_interval, MAX_PROBE_INTERVAL);
+    }
+    stats->skip_remaining = stats->probe_interval;
+  } else {
+    stats->probe_interval = 0;
+  }
+  gpr_mu_unlock(&channeld->mu);
+  if (disabled) gpr_atm_no_barrier_fetch_add(&g_methods_disabled, 1);
+}
+
+/** Adds the \a length bytes at \a offset of \a slices to the \a counts
+ * histogram. (\a slice_index, \a slice_start) is where the slice holding
+ * \a offset is searched from, and is left at the slice holding the last
+ * byte counted: offsets must increase from one call to the next. */
+static void count_bytes(gpr_slice_buffer *slices, size_t *slice_index,
+                        size_t *slice_start, size_t offset, size_t length,
+                        gpr_uint32 *counts) {
+  while (length > 0) {
+    gpr_slice slice = slices->slices[*slice_index];
+    size_t slice_length = GPR_SLICE_LENGTH(slice);
+    const gpr_uint8 *p;
+    size_t n;
+    size_t i;
+    if (offset >= *slice_start + slice_length) {
+      *slice_start += slice_length;
+      ++*slice_index;
+      continue;
+    }
+    p = GPR_SLICE_START_PTR(slice) + (offset - *slice_start);
+    n = GPR_MIN(length, *slice_start + slice_length - offset);
+    for (i = 0; i < n; i++) counts[p[i]]++;
+    offset += n;
+    length -= n;
+  }
+}
+
+/** Returns 1 if an order-0 entropy estimate over a sample of \a slices says
+ * they won't compress, 0 otherwise. */
+static int looks_incompressible(gpr_slice_buffer *slices) {
+  gpr_uint32 counts[256];
+  size_t slice_index = 0;
+  size_t slice_start = 0;
+  size_t sampled;
+  size_t distinct = 0;
+  double sum = 0;
+  double bits_per_byte;
+  size_t i;
+
+  if (slices->length < ENTROPY_MIN_BYTES) return 0;
+  memset(counts, 0, sizeof(counts));
+  if (slices->length <= ENTROPY_CHUNKS * ENTROPY_CHUNK_SIZE) {
+    sampled = slices->length;
+    count_bytes(slices, &slice_index, &slice_start, 0, sampled, counts);
+  } else {
+    sampled = ENTROPY_CHUNKS * ENTROPY_CHUNK_SIZE;
+    for (i = 0; i < ENTROPY_CHUNKS; i++) {
+      count_bytes(slices, &slice_index, &slice_start,
+                  i * (slices->length - ENTROPY_CHUNK_SIZE) /
+                      (ENTROPY_CHUNKS - 1),
+                  ENTROPY_CHUNK_SIZE, counts);
+    }
+  }
+  for (i = 0; i < 256; i++) {
+    if (counts[i] == 0) continue;
+    distinct++;
+    sum += counts[i] * log((double)counts[i]);
+  }
+  /* H = log(n) - sum(c log c) / n, plus the Miller-Madow correction for
+     the bias of estimating from a sample: (distinct - 1) / 2n */
+  bits_per_byte = (log((double)sampled) - sum / (double)sampled +
+                   (double)(distinct - 1) / (2.0 * (double)sampled)) /
+                  log(2.0);
+  return bits_per_byte > INCOMPRESSIBLE_BITS_PER_BYTE;
+}
+
 /** Compress \a slices in place using \a algorithm. Returns 1 if compression did
  * actually happen, 0 otherwise (for example if the compressed output size was
  * larger than the raw input).
@@ -101,6 +316,11 @@ static grpc_mdelem *compression_md_filter(void *user_data, grpc_mdelem *md) {
   call_data *calld = elem->call_data;
   channel_data *channeld = elem->channel_data;
 
+  if (md->key == channeld->mdstr_path_key && calld->method == NULL) {
+    calld->method = find_method_stats(channeld, md->value);
+    return md;
+  }
+
   if (md->key == channeld->mdstr_request_compression_algorithm_key) {
     const char *md_c_str = grpc_mdstr_as_c_string(md->value);
     if (!grpc_compression_algorithm_parse(md_c_str, strlen(md_c_str),
@@ -137,66 +357,105 @@ static int skip_compression(channel_data *channeld, call_data *calld) {
   return channeld->default_compression_algorithm == GRPC_COMPRESS_NONE;
 }
 
-/** Assembles a new grpc_stream_op_buffer with the compressed slices, modifying
- * the associated GRPC_OP_BEGIN_MESSAGE accordingly (new compressed length,
- * flags indicating compression is in effect) and replaces \a send_ops with it.
- * */
-static void finish_compressed_sopb(grpc_stream_op_buffer *send_ops,
-                                   grpc_call_element *elem) {
-  size_t i;
-  call_data *calld = elem->call_data;
-  int new_slices_added = 0; /* GPR_FALSE */
+/** Decides, from what's known before any of its bytes are seen, whether the
+ * \a length byte message about to be sent should be compressed. */
+static int should_compress_message(channel_data *channeld, call_data *calld,
+                                   gpr_uint32 length) {
+  if (skip_compression(channeld, calld)) return 0;
+  if (length < channeld->min_message_size) {
+    gpr_atm_no_barrier_fetch_add(&g_skipped_small, 1);
+    return 0;
+  }
+  if (!channeld->adaptive) return 1;
+  if (calld->method == NULL) calld->method = &channeld->other_methods;
+  if (!method_wants_compression(channeld, calld->method)) {
+    gpr_atm_no_barrier_fetch_add(&g_skipped_method, 1);
+    return 0;
+  }
+  return 1;
+}
+
+/** Compresses the message buffered up in \a calld in place, unless it looks
+ * like it won't compress. Returns 1 if the message was compressed, 0
+ * otherwise. */
+static int compress_message(channel_data *channeld, call_data *calld) {
+  size_t raw_length = calld->slices.length;
+  int did_compress;
+
+  if (channeld->adaptive && looks_incompressible(&calld->slices)) {
+    gpr_atm_no_barrier_fetch_add(&g_skipped_entropy, 1);
+    record_ratio(channeld, calld->method, RATIO_ONE);
+    return 0;
+  }
+  did_compress = compress_send_sb(calld->compression_algorithm, &calld->slices);
+  gpr_atm_no_barrier_fetch_add(did_compress ? &g_compressed : &g_not_smaller,
+                               1);
+  if (channeld->adaptive) {
+    record_ratio(channeld, calld->method,
+                 did_compress ? (gpr_uint32)((double)calld->slices.length *
+                                             RATIO_ONE / (double)raw_length)
+                              : RATIO_ONE);
+  }
+  return did_compress;
+}
+
+/** Appends \a sop to \a send_ops, taking over its metadata. */
+static void append_send_op(grpc_stream_op_buffer *send_ops,
+                           grpc_stream_op *sop) {
   grpc_metadata_batch metadata;
-  grpc_stream_op_buffer new_send_ops;
-  grpc_sopb_init(&new_send_ops);
+  switch (sop->type) {
+    case GRPC_OP_BEGIN_MESSAGE:
+      grpc_sopb_add_begin_message(send_ops, sop->data.begin_message.length,
+                                  sop->data.begin_message.flags);
+      break;
+    case GRPC_OP_SLICE:
+      grpc_sopb_add_slice(send_ops, gpr_slice_ref(sop->data.slice));
+      break;
+    case GRPC_OP_METADATA:
+      grpc_metadata_batch_move(&metadata, &sop->data.metadata);
+      grpc_sopb_add_metadata(send_ops, metadata);
+      break;
+    case GRPC_NO_OP:
+      break;
+  }
+}
 
-  for (i = 0; i < send_ops->nops; i++) {
-    grpc_stream_op *sop = &send_ops->ops[i];
-    switch (sop->type) {
-      case GRPC_OP_BEGIN_MESSAGE:
-        GPR_ASSERT(calld->slices.length <= GPR_UINT32_MAX);
-        grpc_sopb_add_begin_message(
-            &new_send_ops, (gpr_uint32)calld->slices.length,
-            sop->data.begin_message.flags | GRPC_WRITE_INTERNAL_COMPRESS);
-        break;
-      case GRPC_OP_SLICE:
-        /* Once we reach the slices section of the original buffer, simply add
-         * all the new (compressed) slices. We obviously want to do this only
-         * once, hence the "new_slices_added" guard. */
-        if (!new_slices_added) {
-          size_t j;
-          for (j = 0; j < calld->slices.count; ++j) {
-            grpc_sopb_add_slice(&new_send_ops,
-                                gpr_slice_ref(calld->slices.slices[j]));
-          }
-          new_slices_added = 1; /* GPR_TRUE */
-        }
-        break;
-      case GRPC_OP_METADATA:
-        /* move the metadata to the new buffer. */
-        grpc_metadata_batch_move(&metadata, &sop->data.metadata);
-        grpc_sopb_add_metadata(&new_send_ops, metadata);
-        break;
-      case GRPC_NO_OP:
-        break;
-    }
+/** Compresses the message buffered up in \a calld and appends it to \a
+ * send_ops: its GRPC_OP_BEGIN_MESSAGE, with \a flags and, if it was
+ * compressed, the compressed length and GRPC_WRITE_INTERNAL_COMPRESS,
+ * followed by its slices. */
+static void finish_message(channel_data *channeld, call_data *calld,
+                           gpr_uint32 flags, grpc_stream_op_buffer *send_ops) {
+  size_t i;
+  if (compress_message(channeld, calld)) {
+    flags |= GRPC_WRITE_INTERNAL_COMPRESS;
   }
-  grpc_sopb_swap(send_ops, &new_send_ops);
-  grpc_sopb_destroy(&new_send_ops);
+  GPR_ASSERT(calld->slices.length <= GPR_UINT32_MAX);
+  grpc_sopb_add_begin_message(send_ops, (gpr_uint32)calld->slices.length,
+                              flags);
+  for (i = 0; i < calld->slices.count; i++) {
+    grpc_sopb_add_slice(send_ops, gpr_slice_ref(calld->slices.slices[i]));
+  }
+  gpr_slice_buffer_reset_and_unref(&calld->slices);
 }
 
 /** Filter's "main" function, called for any incoming grpc_transport_stream_op
  * instance that holds a non-zero number of send operations, accesible to this
- * function in \a send_ops.  */
+ * function in \a send_ops.
+ *
+ * A batch may carry several messages. Each one to be compressed is buffered
+ * up and compressed on its own; as soon as the first one is met, \a send_ops
+ * is rebuilt with every message in place, compressed or not. */
 static void process_send_ops(grpc_call_element *elem,
                              grpc_stream_op_buffer *send_ops) {
   call_data *calld = elem->call_data;
   channel_data *channeld = elem->channel_data;
   size_t i;
-  int did_compress = 0;
+  size_t j;
+  int rebuilding = 0;
+  gpr_uint32 message_flags = 0;
+  grpc_stream_op_buffer new_send_ops;
 
-  /* In streaming calls, we need to reset the previously accumulated slices */
-  gpr_slice_buffer_reset_and_unref(&calld->slices);
   for (i = 0; i < send_ops->nops; ++i) {
     grpc_stream_op *sop = &send_ops->ops[i];
     switch (sop->type) {
@@ -208,6 +467,26 @@ static void process_send_ops(grpc_call_element *elem,
           calld->has_compression_algorithm = 1; /* GPR_TRUE */
           calld->compression_algorithm = GRPC_COMPRESS_NONE;
         }
+        calld->compress_message = should_compress_message(
+            channeld, calld, sop->data.begin_message.length);
+        if (calld->compress_message) {
+          if (!rebuilding) {
+            grpc_sopb_init(&new_send_ops);
+            for (j = 0; j < i; j++) {
+              append_send_op(&new_send_ops, &send_ops->ops[j]);
+            }
+            rebuilding = 1;
+          }
+          /* the message is appended once all of its slices are in; its
+             ratio is measured on them alone */
+          gpr_slice_buffer_reset_and_unref(&calld->slices);
+          message_flags = sop->data.begin_message.flags;
+          if (calld->remaining_slice_bytes == 0) {
+            finish_message(channeld, calld, message_flags, &new_send_ops);
+            calld->compress_message = 0;
+          }
+          continue;
+        }
         break;
       case GRPC_OP_METADATA:
         if (!calld->written_initial_metadata) {
@@ -238,28 +517,67 @@ static void process_send_ops(grpc_call_element *elem,
         }
         break;
       case GRPC_OP_SLICE:
-        if (skip_compression(channeld, calld)) continue;
+        if (!calld->compress_message) break;
         GPR_ASSERT(calld->remaining_slice_bytes > 0);
         /* Increase input ref count, gpr_slice_buffer_add takes ownership.  */
         gpr_slice_buffer_add(&calld->slices, gpr_slice_ref(sop->data.slice));
-        GPR_ASSERT(GPR_SLICE_LENGTH(sop->data.slice) >=
+        GPR_ASSERT(GPR_SLICE_LENGTH(sop->data.slice) <=
                    calld->remaining_slice_bytes);
         calld->remaining_slice_bytes -=
             (gpr_uint32)GPR_SLICE_LENGTH(sop->data.slice);
         if (calld->remaining_slice_bytes == 0) {
-          did_compress =
-              compress_send_sb(calld->compression_algorithm, &calld->slices);
+          finish_message(channeld, calld, message_flags, &new_send_ops);
+          calld->compress_message = 0;
         }
-        break;
+        continue;
       case GRPC_NO_OP:
         break;
     }
+    if (rebuilding) append_send_op(&new_send_ops, sop);
   }
 
-  /* Modify the send_ops stream_op_buffer depending on whether compression was
-   * carried out */
-  if (did_compress) {
-    finish_compressed_sopb(send_ops, elem);
+  if (rebuilding) {
+    grpc_sopb_swap(send_ops, &new_send_ops);
+    grpc_sopb_destroy(&new_send_ops);
+  }
+}
+
+static void compress_on_recv(grpc_exec_ctx *exec_ctx, void *user_data,
+                             int success) {
+  grpc_call_element *elem = user_data;
+  call_data *calld = elem->call_data;
+  channel_data *channeld = elem->channel_data;
+  if (success) {
+    size_t i;
+    for (i = 0; i < calld->recv_ops->nops; i++) {
+      grpc_stream_op *op = &calld->recv_ops->ops[i];
+      grpc_linked_mdelem *m;
+      if (op->type != GRPC_OP_METADATA) continue;
+      calld->got_initial_metadata = 1;
+      for (m = op->data.metadata.list.head; m != NULL; m = m->next) {
+        if (m->md->key == channeld->mdstr_path_key && calld->method == NULL) {
+          calld->method = find_method_stats(channeld, m->md->value);
+        }
+      }
+    }
+  }
+  calld->on_done_recv->cb(exec_ctx, calld->on_done_recv->cb_arg, success);
+}
+
+static void compress_mutate_op(grpc_call_element *elem,
+                               grpc_transport_stream_op *op) {
+  call_data *calld = elem->call_data;
+  channel_data *channeld = elem->channel_data;
+
+  if (op->send_ops && op->send_ops->nops > 0) {
+    process_send_ops(elem, op->send_ops);
+  }
+  if (channeld->adaptive && op->recv_ops && calld->method == NULL &&
+      !calld->got_initial_metadata) {
+    /* substitute our callback for the higher callback */
+    calld->recv_ops = op->recv_ops;
+    calld->on_done_recv = op->on_done_recv;
+    op->on_done_recv = &calld->compress_on_recv;
   }
 }
 
@@ -271,9 +589,7 @@ static void process_send_ops(grpc_call_element *elem,
 static void compress_start_transport_stream_op(grpc_exec_ctx *exec_ctx,
                                                grpc_call_element *elem,
                                                grpc_transport_stream_op *op) {
-  if (op->send_ops && op->send_ops->nops > 0) {
-    process_send_ops(elem, op->send_ops);
-  }
+  compress_mutate_op(elem, op);
 
   /* pass control down the stack */
   grpc_call_next_op(exec_ctx, elem, op);
@@ -290,12 +606,12 @@ static void init_call_elem(grpc_exec_ctx *exec_ctx, grpc_call_element *elem,
   gpr_slice_buffer_init(&calld->slices);
   calld->has_compression_algorithm = 0;
   calld->written_initial_metadata = 0; /* GPR_FALSE */
+  calld->compress_message = 0;
+  calld->method = NULL;
+  calld->got_initial_metadata = 0;
+  grpc_closure_init(&calld->compress_on_recv, compress_on_recv, elem);
 
-  if (initial_op) {
-    if (initial_op->send_ops && initial_op->send_ops->nops > 0) {
-      process_send_ops(elem, initial_op->send_ops);
-    }
-  }
+  if (initial_op) compress_mutate_op(elem, initial_op);
 }
 
 /* Destructor for call_data */
@@ -317,6 +633,7 @@ static void init_channel_elem(grpc_exec_ctx *exec_ctx,
   size_t supported_algorithms_idx = 0;
   char *accept_encoding_str;
   size_t accept_encoding_str_len;
+  size_t i;
 
   grpc_compression_options_init(&channeld->compression_options);
   channeld->compression_options.enabled_algorithms_bitset =
@@ -330,6 +647,31 @@ static void init_channel_elem(grpc_exec_ctx *exec_ctx,
   channeld->compression_options.default_compression_algorithm =
       channeld->default_compression_algorithm;
 
+  channeld->min_message_size = DEFAULT_MIN_MESSAGE_SIZE;
+  channeld->adaptive = 1;
+  for (i = 0; args != NULL && i < args->num_args; i++) {
+    if (0 == strcmp(args->args[i].key,
+                    GRPC_COMPRESSION_MIN_MESSAGE_SIZE_ARG)) {
+      if (args->args[i].type != GRPC_ARG_INTEGER ||
+          args->args[i].value.integer < 0) {
+        gpr_log(GPR_ERROR, "%s: must be a non-negative integer",
+                GRPC_COMPRESSION_MIN_MESSAGE_SIZE_ARG);
+      } else {
+        channeld->min_message_size = (gpr_uint32)args->args[i].value.integer;
+      }
+    } else if (0 == strcmp(args->args[i].key, GRPC_COMPRESSION_ADAPTIVE_ARG)) {
+      if (args->args[i].type != GRPC_ARG_INTEGER) {
+        gpr_log(GPR_ERROR, "%s: must be an integer",
+                GRPC_COMPRESSION_ADAPTIVE_ARG);
+      } else {
+        channeld->adaptive = args->args[i].value.integer != 0;
+      }
+    }
+  }
+  gpr_mu_init(&channeld->mu);
+  memset(channeld->methods, 0, sizeof(channeld->methods));
+  memset(&channeld->other_methods, 0, sizeof(channeld->other_methods));
+
   channeld->mdstr_request_compression_algorithm_key =
       grpc_mdstr_from_string(mdctx, GRPC_COMPRESS_REQUEST_ALGORITHM_KEY);
 
@@ -339,6 +681,8 @@ static void init_channel_elem(grpc_exec_ctx *exec_ctx,
   channeld->mdstr_compression_capabilities_key =
       grpc_mdstr_from_string(mdctx, "grpc-accept-encoding");
 
+  channeld->mdstr_path_key = grpc_mdstr_from_string(mdctx, ":path");
+
   for (algo_idx = 0; algo_idx < GRPC_COMPRESS_ALGORITHMS_COUNT; ++algo_idx) {
     char *algorithm_name;
     /* skip disabled algorithms */
@@ -376,7 +720,15 @@ static void destroy_channel_elem(grpc_exec_ctx *exec_ctx,
                                  grpc_channel_element *elem) {
   channel_data *channeld = elem->channel_data;
   grpc_compression_algorithm algo_idx;
+  size_t i;
 
+  GRPC_MDSTR_UNREF(channeld->mdstr_path_key);
+  for (i = 0; i < NUM_METHOD_SLOTS; i++) {
+    if (channeld->methods[i].method != NULL) {
+      GRPC_MDSTR_UNREF(channeld->methods[i].method);
+    }
+  }
+  gpr_mu_destroy(&channeld->mu);
   GRPC_MDSTR_UNREF(channeld->mdstr_request_compression_algorithm_key);
   GRPC_MDSTR_UNREF(channeld->mdstr_outgoing_compression_algorithm_key);
   GRPC_MDSTR_UNREF(channeld->mdstr_compression_capabilities_key);
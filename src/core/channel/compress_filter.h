@@ -58,8 +58,37 @@
  * If compression is actually performed, BEGIN_MESSAGE's flag is modified to
  * incorporate GRPC_WRITE_INTERNAL_COMPRESS. Otherwise, and regardless of the
  * aforementioned 'grpc-encoding' metadata value, data will pass through
- * uncompressed. */
+ * uncompressed.
+ *
+ * Which messages get compressed is decided per message:
+ *  - Messages shorter than GRPC_COMPRESSION_MIN_MESSAGE_SIZE_ARG are sent as
+ *    they are.
+ *  - Unless GRPC_COMPRESSION_ADAPTIVE_ARG is 0, larger messages whose sampled
+ *    byte entropy is close to 8 bits per byte (random, encrypted or already
+ *    compressed data) are sent as they are.
+ *  - Unless GRPC_COMPRESSION_ADAPTIVE_ARG is 0, the channel keeps a running
+ *    compression ratio per method (:path). Methods whose messages stop
+ *    shrinking are sent uncompressed, and are compressed again every so
+ *    often (less often each time) to find out whether that changed. */
 
 extern const grpc_channel_filter grpc_compress_filter;
 
+/** Process wide counts of the compress filter's per-message decisions */
+typedef struct grpc_compress_filter_stats {
+  /** Messages sent compressed */
+  gpr_int64 compressed;
+  /** Messages compressed, but sent uncompressed as that wasn't smaller */
+  gpr_int64 not_smaller;
+  /** Messages below the channel's minimum message size */
+  gpr_int64 skipped_small;
+  /** Messages whose entropy estimate said they wouldn't compress */
+  gpr_int64 skipped_entropy;
+  /** Messages of methods that have been failing to compress */
+  gpr_int64 skipped_method;
+  /** Times a method was found to be failing to compress */
+  gpr_int64 methods_disabled;
+} grpc_compress_filter_stats;
+
+void grpc_compress_filter_get_stats(grpc_compress_filter_stats *stats);
+
 #endif /* GRPC_INTERNAL_CORE_CHANNEL_COMPRESS_FILTER_H */
@@ -36,6 +36,7 @@
 #include <string.h>
 
 #include <grpc/support/alloc.h>
+#include <grpc/support/atm.h>
 #include "src/core/transport/connectivity_state.h"
 
 int grpc_lb_round_robin_trace = 0;
@@ -57,6 +58,39 @@ typedef struct ready_list {
   struct ready_list *prev;
 } ready_list;
 
+/** Immutable array of the subchannels in the READY state, in the order in
+ * which they became READY.
+ *
+ * Pickers read the current snapshot without taking the policy mutex. A new
+ * snapshot is published whenever the ready list changes; the previous one is
+ * retired and only freed once no picker can still be looking at it.
+ *
+ * That is tracked with two epochs. Pickers count themselves in the current
+ * epoch's reader count for as long as they use a snapshot. Snapshots retired
+ * during an epoch are freed once the epoch has been flipped and its reader
+ * count has dropped to zero; the epoch only flips when the other epoch's
+ * readers are all gone. Pickers arriving after a flip can't see the retired
+ * snapshots, so the count being waited on drains even under constant load. */
+typedef struct ready_snapshot {
+  grpc_subchannel **subchannels;
+  size_t num_subchannels;
+  /** next retired snapshot awaiting reclamation */
+  struct ready_snapshot *next_retired;
+} ready_snapshot;
+
+/* Layout of round_robin_lb_policy.pick_state: the current epoch in the low
+ * bit, then the reader counts of epochs 0 and 1, then the pick cursor in the
+ * remaining high bits (where it wraps around harmlessly). */
+#define PICK_COUNT_BITS (sizeof(gpr_atm) >= 8 ? 16 : 10)
+#define PICK_COUNT_MASK (((gpr_uintptr)1 << PICK_COUNT_BITS) - 1)
+#define PICK_COUNT_SHIFT(epoch) (1 + (epoch)*PICK_COUNT_BITS)
+#define PICK_COUNT_ONE(epoch) ((gpr_uintptr)1 << PICK_COUNT_SHIFT(epoch))
+#define PICK_COUNT(state, epoch) \
+  (((gpr_uintptr)(state) >> PICK_COUNT_SHIFT(epoch)) & PICK_COUNT_MASK)
+#define PICK_CURSOR_SHIFT (1 + 2 * PICK_COUNT_BITS)
+#define PICK_CURSOR_ONE ((gpr_uintptr)1 << PICK_CURSOR_SHIFT)
+#define PICK_EPOCH(state) ((size_t)((gpr_uintptr)(state)&1))
+
 typedef struct {
   size_t subchannel_idx; /**< Index over p->subchannels */
   void *p;               /**< round_robin_lb_policy instance */
@@ -91,55 +125,28 @@ typedef struct {
 
   /** (Dummy) root of the doubly linked list containing READY subchannels */
   ready_list ready_list;
-  /** Last pick from the ready list. */
-  ready_list *ready_list_last_pick;
+  /** Snapshots retired during the current epoch */
+  ready_snapshot *retired_snapshots;
+  /** Snapshots retired before the last epoch flip, to be freed once the
+   * previous epoch has no readers left */
+  ready_snapshot *previous_retired_snapshots;
 
   /** Subchannel index to ready_list node.
    *
    * Kept in order to remove nodes from the ready list associated with a
    * subchannel */
   ready_list **subchannel_index_to_readylist_node;
-} round_robin_lb_policy;
 
-/** Returns the next subchannel from the connected list or NULL if the list is
- * empty.
- *
- * Note that this function does *not* advance p->ready_list_last_pick. Use \a
- * advance_last_picked_locked() for that. */
-static ready_list *peek_next_connected_locked(const round_robin_lb_policy *p) {
-  ready_list *selected;
-  selected = p->ready_list_last_pick->next;
-
-  while (selected != NULL) {
-    if (selected == &p->ready_list) {
-      GPR_ASSERT(selected->subchannel == NULL);
-      /* skip dummy root */
-      selected = selected->next;
-    } else {
-      GPR_ASSERT(selected->subchannel != NULL);
-      return selected;
-    }
-  }
-  return NULL;
-}
-
-/** Advance the \a ready_list picking head. */
-static void advance_last_picked_locked(round_robin_lb_policy *p) {
-  if (p->ready_list_last_pick->next != NULL) { /* non-empty list */
-    p->ready_list_last_pick = p->ready_list_last_pick->next;
-    if (p->ready_list_last_pick == &p->ready_list) {
-      /* skip dummy root */
-      p->ready_list_last_pick = p->ready_list_last_pick->next;
-    }
-  } else { /* should be an empty list */
-    GPR_ASSERT(p->ready_list_last_pick == &p->ready_list);
-  }
+  /* The members below are accessed without holding mu */
 
-  if (grpc_lb_round_robin_trace) {
-    gpr_log(GPR_DEBUG, "[READYLIST] ADVANCED LAST PICK. NOW AT NODE %p (SC %p)",
-            p->ready_list_last_pick, p->ready_list_last_pick->subchannel);
-  }
-}
+  /** Current ready_snapshot, or 0 if no subchannel is READY */
+  gpr_atm ready_snapshot;
+  /** Epoch, per epoch reader counts and pick cursor: see PICK_COUNT_BITS.
+   * Entering a pick and advancing the cursor is a single update of it. */
+  gpr_atm pick_state;
+  /** Non-zero while either list of retired snapshots is non-empty */
+  gpr_atm have_retired_snapshots;
+} round_robin_lb_policy;
 
 /** Prepends (relative to the root at p->ready_list) the connected subchannel \a
  * csc to the list of ready subchannels. */
@@ -171,11 +178,6 @@ static void remove_disconnected_sc_locked(round_robin_lb_policy *p,
   if (node == NULL) {
     return;
   }
-  if (node == p->ready_list_last_pick) {
-    /* If removing the lastly picked node, reset the last pick pointer to the
-     * dummy root of the list */
-    p->ready_list_last_pick = &p->ready_list;
-  }
 
   /* removing last item */
   if (node->next == &p->ready_list && node->prev == &p->ready_list) {
@@ -200,6 +202,161 @@ static void remove_disconnected_sc_locked(round_robin_lb_policy *p,
   gpr_free(node);
 }
 
+static void free_snapshot(grpc_exec_ctx *exec_ctx, ready_snapshot *snapshot) {
+  size_t i;
+  for (i = 0; i < snapshot->num_subchannels; i++) {
+    GRPC_SUBCHANNEL_UNREF(exec_ctx, snapshot->subchannels[i], "rr_snapshot");
+  }
+  gpr_free(snapshot);
+}
+
+static void free_snapshot_list(grpc_exec_ctx *exec_ctx,
+                               ready_snapshot *snapshot) {
+  while (snapshot != NULL) {
+    ready_snapshot *next = snapshot->next_retired;
+    free_snapshot(exec_ctx, snapshot);
+    snapshot = next;
+  }
+}
+
+/** Frees whatever retired snapshots no picker can still be looking at, and
+ * flips the epoch if that lets the ones retired in the current epoch be freed
+ * later. */
+static void reclaim_retired_snapshots_locked(grpc_exec_ctx *exec_ctx,
+                                             round_robin_lb_policy *p) {
+  gpr_atm state = gpr_atm_acq_load(&p->pick_state);
+  size_t epoch = PICK_EPOCH(state);
+  if (p->previous_retired_snapshots != NULL &&
+      PICK_COUNT(state, 1 - epoch) == 0) {
+    free_snapshot_list(exec_ctx, p->previous_retired_snapshots);
+    p->previous_retired_snapshots = NULL;
+  }
+  if (p->previous_retired_snapshots == NULL && p->retired_snapshots != NULL &&
+      PICK_COUNT(state, 1 - epoch) == 0) {
+    /* readers never touch the epoch bit, so this flips it and nothing else.
+     * Pickers entering from now on use the other epoch, and see a snapshot
+     * published after all of those retired so far. */
+    state = gpr_atm_full_fetch_add(&p->pick_state, epoch == 0 ? 1 : -1);
+    p->previous_retired_snapshots = p->retired_snapshots;
+    p->retired_snapshots = NULL;
+    if (PICK_COUNT(state, epoch) == 0) {
+      free_snapshot_list(exec_ctx, p->previous_retired_snapshots);
+      p->previous_retired_snapshots = NULL;
+    }
+  }
+  gpr_atm_rel_store(&p->have_retired_snapshots,
+                    p->retired_snapshots != NULL ||
+                        p->previous_retired_snapshots != NULL);
+}
+
+/** Unlocks p->mu. A picker leaving the last read-side section of an epoch
+ * while p->mu is held cannot reclaim what that section was holding back, and
+ * leaves it to the holder: so once p->mu is released, look for snapshots no
+ * picker can see any more and take p->mu back to free them. */
+static void unlock_and_reclaim(grpc_exec_ctx *exec_ctx,
+                               round_robin_lb_policy *p) {
+  gpr_atm state;
+  for (;;) {
+    gpr_mu_unlock(&p->mu);
+    /* pairs with the barrier between a picker's leaving its section and its
+     * attempt at p->mu: either it gets p->mu, or we see it gone */
+    gpr_atm_full_barrier();
+    state = gpr_atm_no_barrier_load(&p->pick_state);
+    if (!gpr_atm_acq_load(&p->have_retired_snapshots) ||
+        PICK_COUNT(state, 1 - PICK_EPOCH(state)) != 0 ||
+        !gpr_mu_trylock(&p->mu)) {
+      return;
+    }
+    reclaim_retired_snapshots_locked(exec_ctx, p);
+  }
+}
+
+/** Rebuilds the snapshot of READY subchannels from p->ready_list and makes it
+ * visible to pickers. Must be called after every change to the ready list. */
+static void publish_ready_snapshot_locked(grpc_exec_ctx *exec_ctx,
+                                          round_robin_lb_policy *p) {
+  ready_snapshot *snapshot = NULL;
+  ready_snapshot *old;
+  ready_list *elem;
+  size_t n = 0;
+
+  for (elem = p->ready_list.next; elem != NULL && elem != &p->ready_list;
+       elem = elem->next) {
+    n++;
+  }
+  if (n > 0) {
+    snapshot = gpr_malloc(sizeof(*snapshot) + n * sizeof(grpc_subchannel *));
+    snapshot->subchannels = (grpc_subchannel **)(snapshot + 1);
+    snapshot->num_subchannels = n;
+    snapshot->next_retired = NULL;
+    n = 0;
+    for (elem = p->ready_list.next; elem != &p->ready_list;
+         elem = elem->next) {
+      snapshot->subchannels[n++] = elem->subchannel;
+      GRPC_SUBCHANNEL_REF(elem->subchannel, "rr_snapshot");
+    }
+  }
+
+  old = (ready_snapshot *)gpr_atm_acq_load(&p->ready_snapshot);
+  gpr_atm_rel_store(&p->ready_snapshot, (gpr_atm)snapshot);
+  if (grpc_lb_round_robin_trace) {
+    gpr_log(GPR_DEBUG, "[READYLIST] PUBLISHED SNAPSHOT %p (%d SUBCHANNELS)",
+            snapshot, (int)(snapshot == NULL ? 0 : snapshot->num_subchannels));
+  }
+  if (old != NULL) {
+    old->next_retired = p->retired_snapshots;
+    p->retired_snapshots = old;
+  }
+  reclaim_retired_snapshots_locked(exec_ctx, p);
+}
+
+/** Returns the next subchannel from \a snapshot, advancing the pick cursor */
+static grpc_subchannel *next_from_snapshot(round_robin_lb_policy *p,
+                                           const ready_snapshot *snapshot) {
+  gpr_atm state = gpr_atm_no_barrier_fetch_add(&p->pick_state,
+                                               (gpr_atm)PICK_CURSOR_ONE);
+  size_t idx = (size_t)((gpr_uintptr)state >> PICK_CURSOR_SHIFT);
+  return snapshot->subchannels[idx % snapshot->num_subchannels];
+}
+
+/** Enters the read-side section, returning the current snapshot (which stays
+ * valid until the matching end_snapshot_read()), or NULL if nothing is READY.
+ * \a epoch is set to the epoch to leave, \a cursor to the pick cursor. */
+static const ready_snapshot *begin_snapshot_read(round_robin_lb_policy *p,
+                                                 size_t *epoch,
+                                                 size_t *cursor) {
+  gpr_atm state = gpr_atm_no_barrier_load(&p->pick_state);
+  for (;;) {
+    size_t e = PICK_EPOCH(state);
+    if (gpr_atm_acq_cas(&p->pick_state, state,
+                        (gpr_atm)((gpr_uintptr)state + PICK_CURSOR_ONE +
+                                  PICK_COUNT_ONE(e)))) {
+      *epoch = e;
+      *cursor = (size_t)((gpr_uintptr)state >> PICK_CURSOR_SHIFT);
+      break;
+    }
+    state = gpr_atm_no_barrier_load(&p->pick_state);
+  }
+  return (const ready_snapshot *)gpr_atm_acq_load(&p->ready_snapshot);
+}
+
+/** Leaves the read-side section entered in \a epoch. If nothing was \a
+ * picked, the pick cursor advance done on entry is given back. */
+static void end_snapshot_read(grpc_exec_ctx *exec_ctx, round_robin_lb_policy *p,
+                              size_t epoch, int picked) {
+  gpr_atm state = gpr_atm_full_fetch_add(
+      &p->pick_state,
+      -(gpr_atm)(PICK_COUNT_ONE(epoch) + (picked ? 0 : PICK_CURSOR_ONE)));
+  /* the last reader of an epoch frees what it was holding back, unless
+   * p->mu is held: unlock_and_reclaim() then does it as the holder leaves */
+  if (PICK_COUNT(state, epoch) == 1 &&
+      gpr_atm_acq_load(&p->have_retired_snapshots) &&
+      gpr_mu_trylock(&p->mu)) {
+    reclaim_retired_snapshots_locked(exec_ctx, p);
+    unlock_and_reclaim(exec_ctx, p);
+  }
+}
+
 static void del_interested_parties_locked(grpc_exec_ctx *exec_ctx,
                                           round_robin_lb_policy *p,
                                           const size_t subchannel_idx) {
@@ -227,6 +384,13 @@ void rr_destroy(grpc_exec_ctx *exec_ctx, grpc_lb_policy *pol) {
   gpr_free(p->subchannels);
   gpr_mu_destroy(&p->mu);
 
+  if (gpr_atm_no_barrier_load(&p->ready_snapshot) != 0) {
+    free_snapshot(exec_ctx,
+                  (ready_snapshot *)gpr_atm_no_barrier_load(&p->ready_snapshot));
+  }
+  free_snapshot_list(exec_ctx, p->retired_snapshots);
+  free_snapshot_list(exec_ctx, p->previous_retired_snapshots);
+
   elem = p->ready_list.next;
   while (elem != NULL && elem != &p->ready_list) {
     ready_list *tmp;
@@ -261,7 +425,7 @@ void rr_shutdown(grpc_exec_ctx *exec_ctx, grpc_lb_policy *pol) {
   }
   grpc_connectivity_state_set(exec_ctx, &p->state_tracker,
                               GRPC_CHANNEL_FATAL_FAILURE, "shutdown");
-  gpr_mu_unlock(&p->mu);
+  unlock_and_reclaim(exec_ctx, p);
 }
 
 static void start_picking(grpc_exec_ctx *exec_ctx, round_robin_lb_policy *p) {
@@ -283,7 +447,7 @@ void rr_exit_idle(grpc_exec_ctx *exec_ctx, grpc_lb_policy *pol) {
   if (!p->started_picking) {
     start_picking(exec_ctx, p);
   }
-  gpr_mu_unlock(&p->mu);
+  unlock_and_reclaim(exec_ctx, p);
 }
 
 void rr_pick(grpc_exec_ctx *exec_ctx, grpc_lb_policy *pol,
@@ -292,18 +456,39 @@ void rr_pick(grpc_exec_ctx *exec_ctx, grpc_lb_policy *pol,
   size_t i;
   round_robin_lb_policy *p = (round_robin_lb_policy *)pol;
   pending_pick *pp;
-  ready_list *selected;
+  const ready_snapshot *snapshot;
+  size_t epoch;
+  size_t cursor;
+
+  /* fast path: pick from the published snapshot without taking p->mu. The
+   * read-side section spans on_complete so that the snapshot's ref keeps the
+   * selected subchannel alive until the caller has used it. */
+  if ((snapshot = begin_snapshot_read(p, &epoch, &cursor)) != NULL) {
+    *target = snapshot->subchannels[cursor % snapshot->num_subchannels];
+    if (grpc_lb_round_robin_trace) {
+      gpr_log(GPR_DEBUG, "[RR PICK] TARGET <-- SUBCHANNEL %p (SNAPSHOT %p)",
+              *target, snapshot);
+    }
+    on_complete->cb(exec_ctx, on_complete->cb_arg, 1);
+    end_snapshot_read(exec_ctx, p, epoch, 1);
+    return;
+  }
+  end_snapshot_read(exec_ctx, p, epoch, 0);
+
   gpr_mu_lock(&p->mu);
-  if ((selected = peek_next_connected_locked(p))) {
-    gpr_mu_unlock(&p->mu);
-    *target = selected->subchannel;
+  /* a subchannel may have become READY since we looked: snapshots are only
+   * published under p->mu, so this one cannot be retired while we hold it */
+  snapshot = (const ready_snapshot *)gpr_atm_acq_load(&p->ready_snapshot);
+  if (snapshot != NULL) {
+    *target = next_from_snapshot(p, snapshot);
+    GRPC_SUBCHANNEL_REF(*target, "rr_pick");
+    unlock_and_reclaim(exec_ctx, p);
     if (grpc_lb_round_robin_trace) {
-      gpr_log(GPR_DEBUG, "[RR PICK] TARGET <-- SUBCHANNEL %p (NODE %p)",
-              selected->subchannel, selected);
+      gpr_log(GPR_DEBUG, "[RR PICK] TARGET <-- SUBCHANNEL %p (SNAPSHOT %p)",
+              *target, snapshot);
     }
-    /* only advance the last picked pointer if the selection was used */
-    advance_last_picked_locked(p);
     on_complete->cb(exec_ctx, on_complete->cb_arg, 1);
+    GRPC_SUBCHANNEL_UNREF(exec_ctx, *target, "rr_pick");
   } else {
     if (!p->started_picking) {
       start_picking(exec_ctx, p);
@@ -318,7 +503,7 @@ void rr_pick(grpc_exec_ctx *exec_ctx, grpc_lb_policy *pol,
     pp->target = target;
     pp->on_complete = on_complete;
     p->pending_picks = pp;
-    gpr_mu_unlock(&p->mu);
+    unlock_and_reclaim(exec_ctx, p);
   }
 }
 
@@ -329,7 +514,7 @@ static void rr_connectivity_changed(grpc_exec_ctx *exec_ctx, void *arg,
   /* index over p->subchannels of this cb's subchannel */
   const size_t this_idx = cb_arg->subchannel_idx;
   pending_pick *pp;
-  ready_list *selected;
+  grpc_subchannel *selected;
 
   int unref = 0;
 
@@ -351,24 +536,21 @@ static void rr_connectivity_changed(grpc_exec_ctx *exec_ctx, void *arg,
          * Note that it goes to the "end of the line". */
         p->subchannel_index_to_readylist_node[this_idx] =
             add_connected_sc_locked(p, p->subchannels[this_idx]);
+        publish_ready_snapshot_locked(exec_ctx, p);
         /* at this point we know there's at least one suitable subchannel. Go
-         * ahead and pick one and notify the pending suitors in
+         * ahead and pick one for each of the pending suitors in
          * p->pending_picks. This preemtively replicates rr_pick()'s actions. */
-        selected = peek_next_connected_locked(p);
-        if (p->pending_picks != NULL) {
-          /* if the selected subchannel is going to be used for the pending
-           * picks, update the last picked pointer */
-          advance_last_picked_locked(p);
-        }
         while ((pp = p->pending_picks)) {
           p->pending_picks = pp->next;
-          *pp->target = selected->subchannel;
+          selected = next_from_snapshot(
+              p, (const ready_snapshot *)gpr_atm_no_barrier_load(
+                     &p->ready_snapshot));
+          *pp->target = selected;
           if (grpc_lb_round_robin_trace) {
-            gpr_log(GPR_DEBUG,
-                    "[RR CONN CHANGED] TARGET <-- SUBCHANNEL %p (NODE %p)",
-                    selected->subchannel, selected);
+            gpr_log(GPR_DEBUG, "[RR CONN CHANGED] TARGET <-- SUBCHANNEL %p",
+                    selected);
           }
-          grpc_subchannel_del_interested_party(exec_ctx, selected->subchannel,
+          grpc_subchannel_del_interested_party(exec_ctx, selected,
                                                pp->pollset);
           grpc_exec_ctx_enqueue(exec_ctx, pp->on_complete, 1);
           gpr_free(pp);
@@ -397,6 +579,7 @@ static void rr_connectivity_changed(grpc_exec_ctx *exec_ctx, void *arg,
           remove_disconnected_sc_locked(
               p, p->subchannel_index_to_readylist_node[this_idx]);
           p->subchannel_index_to_readylist_node[this_idx] = NULL;
+          publish_ready_snapshot_locked(exec_ctx, p);
         }
         grpc_connectivity_state_set(exec_ctx, &p->state_tracker,
                                     GRPC_CHANNEL_TRANSIENT_FAILURE,
@@ -408,6 +591,7 @@ static void rr_connectivity_changed(grpc_exec_ctx *exec_ctx, void *arg,
           remove_disconnected_sc_locked(
               p, p->subchannel_index_to_readylist_node[this_idx]);
           p->subchannel_index_to_readylist_node[this_idx] = NULL;
+          publish_ready_snapshot_locked(exec_ctx, p);
         }
 
         GPR_SWAP(grpc_subchannel *, p->subchannels[this_idx],
@@ -435,7 +619,7 @@ static void rr_connectivity_changed(grpc_exec_ctx *exec_ctx, void *arg,
     } /* switch */
   }   /* !unref */
 
-  gpr_mu_unlock(&p->mu);
+  unlock_and_reclaim(exec_ctx, p);
 
   if (unref) {
     GRPC_LB_POLICY_UNREF(exec_ctx, &p->base, "round_robin_connectivity");
@@ -456,7 +640,7 @@ static void rr_broadcast(grpc_exec_ctx *exec_ctx, grpc_lb_policy *pol,
     subchannels[i] = p->subchannels[i];
     GRPC_SUBCHANNEL_REF(subchannels[i], "rr_broadcast");
   }
-  gpr_mu_unlock(&p->mu);
+  unlock_and_reclaim(exec_ctx, p);
 
   for (i = 0; i < n; i++) {
     grpc_subchannel_process_transport_op(exec_ctx, subchannels[i], op);
@@ -471,7 +655,7 @@ static grpc_connectivity_state rr_check_connectivity(grpc_exec_ctx *exec_ctx,
   grpc_connectivity_state st;
   gpr_mu_lock(&p->mu);
   st = grpc_connectivity_state_check(&p->state_tracker);
-  gpr_mu_unlock(&p->mu);
+  unlock_and_reclaim(exec_ctx, p);
   return st;
 }
 
@@ -483,7 +667,7 @@ static void rr_notify_on_state_change(grpc_exec_ctx *exec_ctx,
   gpr_mu_lock(&p->mu);
   grpc_connectivity_state_notify_on_state_change(exec_ctx, &p->state_tracker,
                                                  current, notify);
-  gpr_mu_unlock(&p->mu);
+  unlock_and_reclaim(exec_ctx, p);
 }
 
 static const grpc_lb_policy_vtable round_robin_lb_policy_vtable = {
@@ -533,7 +717,6 @@ static grpc_lb_policy *create_round_robin(grpc_lb_policy_factory *factory,
   p->ready_list.subchannel = NULL;
   p->ready_list.prev = NULL;
   p->ready_list.next = NULL;
-  p->ready_list_last_pick = &p->ready_list;
 
   p->subchannel_index_to_readylist_node =
       gpr_malloc(sizeof(grpc_subchannel *) * args->num_subchannels);
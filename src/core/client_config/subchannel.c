@@ -36,6 +36,7 @@
 #include <string.h>
 
 #include <grpc/support/alloc.h>
+#include <grpc/support/log.h>
 
 #include "src/core/channel/channel_args.h"
 #include "src/core/channel/client_channel.h"
@@ -49,6 +50,8 @@
 #define GRPC_SUBCHANNEL_RECONNECT_BACKOFF_MULTIPLIER 1.6
 #define GRPC_SUBCHANNEL_RECONNECT_MAX_BACKOFF_SECONDS 120
 #define GRPC_SUBCHANNEL_RECONNECT_JITTER 0.2
+#define GRPC_SUBCHANNEL_DEFAULT_MAX_CONNECTIONS 1
+#define GRPC_SUBCHANNEL_DEFAULT_STREAMS_PER_CONNECTION 1
 
 typedef struct {
   /* all fields protected by subchannel->mu */
@@ -56,12 +59,17 @@ typedef struct {
   int refs;
   /** parent subchannel */
   grpc_subchannel *subchannel;
+  /** number of subchannel calls created on this connection and not yet
+      destroyed */
+  int active_calls;
+  /** is this connection in the subchannel's pool (ie. can new calls be
+      started on it)? */
+  int in_pool;
 } connection;
 
 typedef struct {
   grpc_closure closure;
-  size_t version;
-  grpc_subchannel *subchannel;
+  connection *connection;
   grpc_connectivity_state connectivity_state;
 } state_watcher;
 
@@ -110,10 +118,16 @@ struct grpc_subchannel {
   /** mutex protecting remaining elements */
   gpr_mu mu;
 
-  /** active connection */
-  connection *active;
-  /** version number for the active connection */
-  size_t active_version;
+  /** connections new calls can be started on */
+  connection **pool;
+  size_t num_connections;
+  /** maximum size of pool */
+  size_t max_connections;
+  /** open another connection once each pooled connection carries this
+      many calls */
+  int streams_per_connection;
+  /** don't try to grow the pool again before this time */
+  gpr_timespec next_grow_attempt;
   /** refcount */
   int refs;
   /** are we connecting */
@@ -217,7 +231,7 @@ static grpc_subchannel *connection_unref_locked(
   if (subchannel_unref_locked(c->subchannel REF_PASS_ARGS)) {
     destroy = c->subchannel;
   }
-  if (--c->refs == 0 && c->subchannel->active != c) {
+  if (--c->refs == 0 && !c->in_pool) {
     connection_destroy(exec_ctx, c);
   }
   return destroy;
@@ -255,9 +269,11 @@ void grpc_subchannel_unref(grpc_exec_ctx *exec_ctx,
 }
 
 static void subchannel_destroy(grpc_exec_ctx *exec_ctx, grpc_subchannel *c) {
-  if (c->active != NULL) {
-    connection_destroy(exec_ctx, c->active);
+  size_t i;
+  for (i = 0; i < c->num_connections; i++) {
+    connection_destroy(exec_ctx, c->pool[i]);
   }
+  gpr_free(c->pool);
   gpr_free((void *)c->filters);
   grpc_channel_args_destroy(c->args);
   gpr_free(c->addr);
@@ -283,6 +299,32 @@ static gpr_uint32 random_seed() {
   return (gpr_uint32)(gpr_time_to_millis(gpr_now(GPR_CLOCK_MONOTONIC)));
 }
 
+static void read_pool_args(grpc_subchannel *c) {
+  size_t i;
+  c->max_connections = GRPC_SUBCHANNEL_DEFAULT_MAX_CONNECTIONS;
+  c->streams_per_connection = GRPC_SUBCHANNEL_DEFAULT_STREAMS_PER_CONNECTION;
+  if (c->args == NULL) return;
+  for (i = 0; i < c->args->num_args; i++) {
+    const grpc_arg *arg = &c->args->args[i];
+    if (0 == strcmp(arg->key, GRPC_ARG_MAX_SUBCHANNEL_CONNECTIONS)) {
+      if (arg->type != GRPC_ARG_INTEGER || arg->value.integer < 1) {
+        gpr_log(GPR_ERROR, "%s ignored: it must be an integer >= 1",
+                GRPC_ARG_MAX_SUBCHANNEL_CONNECTIONS);
+      } else {
+        c->max_connections = (size_t)arg->value.integer;
+      }
+    } else if (0 ==
+               strcmp(arg->key, GRPC_ARG_SUBCHANNEL_STREAMS_PER_CONNECTION)) {
+      if (arg->type != GRPC_ARG_INTEGER || arg->value.integer < 0) {
+        gpr_log(GPR_ERROR, "%s ignored: it must be an integer >= 0",
+                GRPC_ARG_SUBCHANNEL_STREAMS_PER_CONNECTION);
+      } else {
+        c->streams_per_connection = arg->value.integer;
+      }
+    }
+  }
+}
+
 grpc_subchannel *grpc_subchannel_create(grpc_connector *connector,
                                         grpc_subchannel_args *args) {
   grpc_subchannel *c = gpr_malloc(sizeof(*c));
@@ -304,6 +346,8 @@ grpc_subchannel *grpc_subchannel_create(grpc_connector *connector,
   c->master = args->master;
   c->pollset_set = grpc_client_channel_get_connecting_pollset_set(parent_elem);
   c->random = random_seed();
+  read_pool_args(c);
+  c->pool = gpr_malloc(sizeof(*c->pool) * c->max_connections);
   grpc_mdctx_ref(c->mdctx);
   grpc_closure_init(&c->connected, subchannel_connected, c);
   grpc_connectivity_state_init(&c->state_tracker, GRPC_CHANNEL_IDLE,
@@ -343,15 +387,48 @@ static void continue_creating_call(grpc_exec_ctx *exec_ctx, void *arg,
   gpr_free(w4c);
 }
 
+/* Returns the pooled connection carrying the fewest calls, or NULL if the
+   pool is empty */
+static connection *pick_connection_locked(grpc_subchannel *c) {
+  connection *best = NULL;
+  size_t i;
+  for (i = 0; i < c->num_connections; i++) {
+    if (best == NULL || c->pool[i]->active_calls < best->active_calls) {
+      best = c->pool[i];
+    }
+  }
+  return best;
+}
+
+/* Decide whether to open another connection to spread calls over, given
+   that the least loaded pooled connection carries least_active_calls.
+   Returns 1 if the caller should start_connect once the lock is dropped. */
+static int maybe_grow_pool_locked(grpc_subchannel *c, int least_active_calls) {
+  if (c->disconnected || c->connecting || c->num_connections == 0 ||
+      c->num_connections >= c->max_connections ||
+      least_active_calls < c->streams_per_connection ||
+      gpr_time_cmp(gpr_now(GPR_CLOCK_MONOTONIC), c->next_grow_attempt) < 0) {
+    return 0;
+  }
+  c->connecting = 1;
+  /* released by connection */
+  SUBCHANNEL_REF_LOCKED(c, "connecting");
+  GRPC_CHANNEL_INTERNAL_REF(c->master, "connecting");
+  return 1;
+}
+
 void grpc_subchannel_create_call(grpc_exec_ctx *exec_ctx, grpc_subchannel *c,
                                  grpc_pollset *pollset,
                                  grpc_subchannel_call **target,
                                  grpc_closure *notify) {
   connection *con;
+  int grow;
   gpr_mu_lock(&c->mu);
-  if (c->active != NULL) {
-    con = c->active;
+  con = pick_connection_locked(c);
+  grow = con != NULL && maybe_grow_pool_locked(c, con->active_calls);
+  if (con != NULL && !grow) {
     CONNECTION_REF_LOCKED(con, "call");
+    con->active_calls++;
     gpr_mu_unlock(&c->mu);
 
     *target = create_call(exec_ctx, con);
@@ -367,8 +444,15 @@ void grpc_subchannel_create_call(grpc_exec_ctx *exec_ctx, grpc_subchannel *c,
     SUBCHANNEL_REF_LOCKED(c, "waiting_for_connect");
     grpc_closure_init(&w4c->continuation, continue_creating_call, w4c);
     c->waiting = w4c;
+    /* a call that grows the pool waits for the new connection: this keeps
+       someone polling the connection attempt, and lands the call on the
+       idle transport */
     grpc_subchannel_add_interested_party(exec_ctx, c, pollset);
-    if (!c->connecting) {
+    if (grow) {
+      gpr_mu_unlock(&c->mu);
+
+      start_connect(exec_ctx, c);
+    } else if (!c->connecting) {
       c->connecting = 1;
       connectivity_state_changed_locked(exec_ctx, c, "create_call");
       /* released by connection */
@@ -416,13 +500,20 @@ void grpc_subchannel_notify_on_state_change(grpc_exec_ctx *exec_ctx,
 void grpc_subchannel_process_transport_op(grpc_exec_ctx *exec_ctx,
                                           grpc_subchannel *c,
                                           grpc_transport_op *op) {
-  connection *con = NULL;
-  grpc_subchannel *destroy;
+  connection **cons = NULL;
+  size_t num_cons;
+  size_t i;
+  grpc_transport_op secondary_op;
+  grpc_subchannel *destroy = NULL;
   int cancel_alarm = 0;
   gpr_mu_lock(&c->mu);
-  if (c->active != NULL) {
-    con = c->active;
-    CONNECTION_REF_LOCKED(con, "transport-op");
+  num_cons = c->num_connections;
+  if (num_cons > 0) {
+    cons = gpr_malloc(sizeof(*cons) * num_cons);
+    for (i = 0; i < num_cons; i++) {
+      cons[i] = c->pool[i];
+      CONNECTION_REF_LOCKED(cons[i], "transport-op");
+    }
   }
   if (op->disconnect) {
     c->disconnected = 1;
@@ -433,15 +524,32 @@ void grpc_subchannel_process_transport_op(grpc_exec_ctx *exec_ctx,
   }
   gpr_mu_unlock(&c->mu);
 
-  if (con != NULL) {
-    grpc_channel_stack *channel_stack = CHANNEL_STACK_FROM_CONNECTION(con);
+  /* the first connection gets the op as is; the rest of the pool only sees
+     the parts that carry no one-shot callbacks */
+  memset(&secondary_op, 0, sizeof(secondary_op));
+  secondary_op.disconnect = op->disconnect;
+  secondary_op.send_goaway = op->send_goaway;
+  secondary_op.goaway_status = op->goaway_status;
+  secondary_op.goaway_message = op->goaway_message;
+  secondary_op.bind_pollset = op->bind_pollset;
+  secondary_op.bind_pollset_set = op->bind_pollset_set;
+  for (i = 0; i < num_cons; i++) {
+    grpc_channel_stack *channel_stack = CHANNEL_STACK_FROM_CONNECTION(cons[i]);
     grpc_channel_element *top_elem =
         grpc_channel_stack_element(channel_stack, 0);
-    top_elem->filter->start_transport_op(exec_ctx, top_elem, op);
+    top_elem->filter->start_transport_op(exec_ctx, top_elem,
+                                         i == 0 ? op : &secondary_op);
+  }
 
+  if (num_cons > 0) {
     gpr_mu_lock(&c->mu);
-    destroy = CONNECTION_UNREF_LOCKED(exec_ctx, con, "transport-op");
+    for (i = 0; i < num_cons; i++) {
+      if (CONNECTION_UNREF_LOCKED(exec_ctx, cons[i], "transport-op")) {
+        destroy = c;
+      }
+    }
     gpr_mu_unlock(&c->mu);
+    gpr_free(cons);
     if (destroy) {
       subchannel_destroy(exec_ctx, destroy);
     }
@@ -456,21 +564,32 @@ void grpc_subchannel_process_transport_op(grpc_exec_ctx *exec_ctx,
   }
 }
 
+static void remove_from_pool_locked(grpc_subchannel *c, connection *con) {
+  size_t i;
+  for (i = 0; i < c->num_connections; i++) {
+    if (c->pool[i] == con) {
+      c->pool[i] = c->pool[--c->num_connections];
+      con->in_pool = 0;
+      return;
+    }
+  }
+}
+
 static void on_state_changed(grpc_exec_ctx *exec_ctx, void *p,
                              int iomgr_success) {
   state_watcher *sw = p;
-  grpc_subchannel *c = sw->subchannel;
+  connection *con = sw->connection;
+  grpc_subchannel *c = con->subchannel;
   gpr_mu *mu = &c->mu;
-  int destroy;
+  grpc_subchannel *destroy;
   grpc_transport_op op;
   grpc_channel_element *elem;
-  connection *destroy_connection = NULL;
 
   gpr_mu_lock(mu);
 
-  /* if we failed or there is a version number mismatch, just leave
+  /* if we failed or the connection has already left the pool, just leave
      this closure */
-  if (!iomgr_success || sw->subchannel->active_version != sw->version) {
+  if (!iomgr_success || !con->in_pool) {
     goto done;
   }
 
@@ -482,37 +601,33 @@ static void on_state_changed(grpc_exec_ctx *exec_ctx, void *p,
       memset(&op, 0, sizeof(op));
       op.connectivity_state = &sw->connectivity_state;
       op.on_connectivity_state_change = &sw->closure;
-      elem = grpc_channel_stack_element(
-          CHANNEL_STACK_FROM_CONNECTION(c->active), 0);
+      elem = grpc_channel_stack_element(CHANNEL_STACK_FROM_CONNECTION(con), 0);
       elem->filter->start_transport_op(exec_ctx, elem, &op);
       /* early out */
       gpr_mu_unlock(mu);
       return;
     case GRPC_CHANNEL_FATAL_FAILURE:
     case GRPC_CHANNEL_TRANSIENT_FAILURE:
-      /* things have gone wrong, deactivate and enter idle */
-      if (sw->subchannel->active->refs == 0) {
-        destroy_connection = sw->subchannel->active;
+      /* things have gone wrong, deactivate; once the pool is empty enter
+         idle */
+      remove_from_pool_locked(c, con);
+      if (c->num_connections == 0) {
+        grpc_connectivity_state_set(exec_ctx, &c->state_tracker,
+                                    c->disconnected
+                                        ? GRPC_CHANNEL_FATAL_FAILURE
+                                        : GRPC_CHANNEL_TRANSIENT_FAILURE,
+                                    "connection_failed");
       }
-      sw->subchannel->active = NULL;
-      grpc_connectivity_state_set(exec_ctx, &c->state_tracker,
-                                  c->disconnected
-                                      ? GRPC_CHANNEL_FATAL_FAILURE
-                                      : GRPC_CHANNEL_TRANSIENT_FAILURE,
-                                  "connection_failed");
       break;
   }
 
 done:
   connectivity_state_changed_locked(exec_ctx, c, "transport_state_changed");
-  destroy = SUBCHANNEL_UNREF_LOCKED(c, "state_watcher");
+  destroy = CONNECTION_UNREF_LOCKED(exec_ctx, con, "state_watcher");
   gpr_free(sw);
   gpr_mu_unlock(mu);
   if (destroy) {
-    subchannel_destroy(exec_ctx, c);
-  }
-  if (destroy_connection != NULL) {
-    connection_destroy(exec_ctx, destroy_connection);
+    subchannel_destroy(exec_ctx, destroy);
   }
 }
 
@@ -525,7 +640,6 @@ static void publish_transport(grpc_exec_ctx *exec_ctx, grpc_subchannel *c) {
   waiting_for_connect *w4c;
   grpc_transport_op op;
   state_watcher *sw;
-  connection *destroy_connection = NULL;
   grpc_channel_element *elem;
 
   /* build final filter list */
@@ -542,6 +656,8 @@ static void publish_transport(grpc_exec_ctx *exec_ctx, grpc_subchannel *c) {
   stk = (grpc_channel_stack *)(con + 1);
   con->refs = 0;
   con->subchannel = c;
+  con->active_calls = 0;
+  con->in_pool = 1;
   grpc_channel_stack_init(exec_ctx, filters, num_filters, c->master, c->args,
                           c->mdctx, stk);
   grpc_connected_channel_bind_transport(stk, c->connecting_result.transport);
@@ -551,7 +667,7 @@ static void publish_transport(grpc_exec_ctx *exec_ctx, grpc_subchannel *c) {
   /* initialize state watcher */
   sw = gpr_malloc(sizeof(*sw));
   grpc_closure_init(&sw->closure, on_state_changed, sw);
-  sw->subchannel = c;
+  sw->connection = con;
   sw->connectivity_state = GRPC_CHANNEL_READY;
 
   gpr_mu_lock(&c->mu);
@@ -566,26 +682,22 @@ static void publish_transport(grpc_exec_ctx *exec_ctx, grpc_subchannel *c) {
     return;
   }
 
-  /* publish */
-  if (c->active != NULL && c->active->refs == 0) {
-    destroy_connection = c->active;
-  }
-  c->active = con;
-  c->active_version++;
-  sw->version = c->active_version;
+  /* publish: only one connection attempt runs at a time, and attempts only
+     start while the pool has room */
+  GPR_ASSERT(c->num_connections < c->max_connections);
+  c->pool[c->num_connections++] = con;
   c->connecting = 0;
 
   /* watch for changes; subchannel ref for connecting is donated
-     to the state watcher */
+     to the state watcher (via its connection ref) */
   memset(&op, 0, sizeof(op));
   op.connectivity_state = &sw->connectivity_state;
   op.on_connectivity_state_change = &sw->closure;
   op.bind_pollset_set = c->pollset_set;
-  SUBCHANNEL_REF_LOCKED(c, "state_watcher");
+  CONNECTION_REF_LOCKED(con, "state_watcher");
   GRPC_CHANNEL_INTERNAL_UNREF(exec_ctx, c->master, "connecting");
   GPR_ASSERT(!SUBCHANNEL_UNREF_LOCKED(c, "connecting"));
-  elem =
-      grpc_channel_stack_element(CHANNEL_STACK_FROM_CONNECTION(c->active), 0);
+  elem = grpc_channel_stack_element(stk, 0);
   elem->filter->start_transport_op(exec_ctx, elem, &op);
 
   /* signal completion */
@@ -602,10 +714,6 @@ static void publish_transport(grpc_exec_ctx *exec_ctx, grpc_subchannel *c) {
   }
 
   gpr_free((void *)filters);
-
-  if (destroy_connection != NULL) {
-    connection_destroy(exec_ctx, destroy_connection);
-  }
 }
 
 /* Generate a random number between 0 and 1. */
@@ -663,6 +771,26 @@ static void subchannel_connected(grpc_exec_ctx *exec_ctx, void *arg,
   } else {
     gpr_timespec now = gpr_now(GPR_CLOCK_MONOTONIC);
     gpr_mu_lock(&c->mu);
+    if (c->num_connections > 0 && !c->disconnected) {
+      /* failed to grow the pool: let the waiting calls use the connections
+         we have, and try again later */
+      waiting_for_connect *w4c = c->waiting;
+      c->waiting = NULL;
+      c->connecting = 0;
+      c->next_grow_attempt = gpr_time_add(
+          now, gpr_time_from_seconds(
+                   GRPC_SUBCHANNEL_INITIAL_CONNECT_BACKOFF_SECONDS,
+                   GPR_TIMESPAN));
+      gpr_mu_unlock(&c->mu);
+      while (w4c != NULL) {
+        waiting_for_connect *next = w4c->next;
+        grpc_exec_ctx_enqueue(exec_ctx, &w4c->continuation, 1);
+        w4c = next;
+      }
+      GRPC_CHANNEL_INTERNAL_UNREF(exec_ctx, c->master, "connecting");
+      GRPC_SUBCHANNEL_UNREF(exec_ctx, c, "connecting");
+      return;
+    }
     GPR_ASSERT(!c->have_alarm);
     c->have_alarm = 1;
     connectivity_state_changed_locked(exec_ctx, c, "connect_failed");
@@ -686,15 +814,15 @@ static grpc_connectivity_state compute_connectivity_locked(grpc_subchannel *c) {
   if (c->disconnected) {
     return GRPC_CHANNEL_FATAL_FAILURE;
   }
+  if (c->num_connections > 0) {
+    return GRPC_CHANNEL_READY;
+  }
   if (c->connecting) {
     if (c->have_alarm) {
       return GRPC_CHANNEL_TRANSIENT_FAILURE;
     }
     return GRPC_CHANNEL_CONNECTING;
   }
-  if (c->active) {
-    return GRPC_CHANNEL_READY;
-  }
   return GRPC_CHANNEL_IDLE;
 }
 
@@ -722,6 +850,7 @@ void grpc_subchannel_call_unref(grpc_exec_ctx *exec_ctx,
     grpc_subchannel *destroy;
     grpc_call_stack_destroy(exec_ctx, SUBCHANNEL_CALL_TO_CALL_STACK(c));
     gpr_mu_lock(mu);
+    c->connection->active_calls--;
     destroy = CONNECTION_UNREF_LOCKED(exec_ctx, c->connection, "call");
     gpr_mu_unlock(mu);
     gpr_free(c);
@@ -52,6 +52,8 @@ int grpc_compression_algorithm_parse(const char *name, size_t name_length,
     *algorithm = GRPC_COMPRESS_GZIP;
   } else if (strncmp(name, "deflate", name_length) == 0) {
     *algorithm = GRPC_COMPRESS_DEFLATE;
+  } else if (strncmp(name, "lz4", name_length) == 0) {
+    *algorithm = GRPC_COMPRESS_LZ4;
   } else {
     return 0;
   }
@@ -70,6 +72,9 @@ int grpc_compression_algorithm_name(grpc_compression_algorithm algorithm,
     case GRPC_COMPRESS_GZIP:
       *name = "gzip";
       break;
+    case GRPC_COMPRESS_LZ4:
+      *name = "lz4";
+      break;
     default:
       return 0;
   }
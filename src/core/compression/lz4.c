@@ -0,0 +1,549 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "src/core/compression/lz4.h"
+
+#include <string.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/log.h>
+#include <grpc/support/useful.h>
+
+#define FRAME_MAGIC 0x184D2204u
+/* Frame descriptor flags. */
+#define FLG_VERSION 0x40
+#define FLG_VERSION_MASK 0xc0
+#define FLG_BLOCK_INDEPENDENCE 0x20
+#define FLG_BLOCK_CHECKSUM 0x10
+#define FLG_CONTENT_SIZE 0x08
+#define FLG_CONTENT_CHECKSUM 0x04
+#define FLG_RESERVED 0x02
+#define FLG_DICT_ID 0x01
+/* Block descriptor: bits 4 to 6 give the maximum block size. */
+#define BD_RESERVED 0x8f
+#define BD_64KB 0x40
+/* A block size with this bit set is that of a block stored uncompressed. */
+#define BLOCK_UNCOMPRESSED 0x80000000u
+
+/* Size of the blocks we write: matches can then reach back to any byte of
+   their block. */
+#define BLOCK_SIZE (64 * 1024)
+/* Magic, FLG, BD, content size and header checksum. */
+#define HEADER_SIZE (4 + 2 + 8 + 1)
+
+/* Block format constraints. */
+#define MIN_MATCH 4
+/* The last bytes of a block are literals ... */
+#define LAST_LITERALS 5
+/* ... and the last match starts at least that far from its end. */
+#define MF_LIMIT 12
+#define MAX_OFFSET 65535
+
+#define HASH_BITS 12
+
+#define PRIME32_1 2654435761u
+#define PRIME32_2 2246822519u
+#define PRIME32_3 3266489917u
+#define PRIME32_4 668265263u
+#define PRIME32_5 374761393u
+
+static gpr_uint32 read_le32(const gpr_uint8 *p) {
+  return (gpr_uint32)p[0] | ((gpr_uint32)p[1] << 8) |
+         ((gpr_uint32)p[2] << 16) | ((gpr_uint32)p[3] << 24);
+}
+
+static void write_le32(gpr_uint8 *p, gpr_uint32 v) {
+  p[0] = (gpr_uint8)v;
+  p[1] = (gpr_uint8)(v >> 8);
+  p[2] = (gpr_uint8)(v >> 16);
+  p[3] = (gpr_uint8)(v >> 24);
+}
+
+static gpr_uint32 rotl32(gpr_uint32 x, int r) {
+  return (x << r) | (x >> (32 - r));
+}
+
+static gpr_uint32 xxh32_round(gpr_uint32 acc, const gpr_uint8 *p) {
+  return rotl32(acc + read_le32(p) * PRIME32_2, 13) * PRIME32_1;
+}
+
+/* xxHash32, which the frame format uses for its checksums. */
+static gpr_uint32 xxh32(const gpr_uint8 *p, size_t len, gpr_uint32 seed) {
+  const gpr_uint8 *end = p + len;
+  gpr_uint32 h;
+
+  if (len >= 16) {
+    gpr_uint32 v1 = seed + PRIME32_1 + PRIME32_2;
+    gpr_uint32 v2 = seed + PRIME32_2;
+    gpr_uint32 v3 = seed;
+    gpr_uint32 v4 = seed - PRIME32_1;
+    do {
+      v1 = xxh32_round(v1, p);
+      v2 = xxh32_round(v2, p + 4);
+      v3 = xxh32_round(v3, p + 8);
+      v4 = xxh32_round(v4, p + 12);
+      p += 16;
+    } while (end - p >= 16);
+    h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+  } else {
+    h = seed + PRIME32_5;
+  }
+  h += (gpr_uint32)len;
+  for (; end - p >= 4; p += 4) {
+    h = rotl32(h + read_le32(p) * PRIME32_3, 17) * PRIME32_4;
+  }
+  for (; p < end; p++) {
+    h = rotl32(h + *p * PRIME32_5, 11) * PRIME32_1;
+  }
+  h ^= h >> 15;
+  h *= PRIME32_2;
+  h ^= h >> 13;
+  h *= PRIME32_3;
+  h ^= h >> 16;
+  return h;
+}
+
+static size_t hash4(const gpr_uint8 *p) {
+  return (size_t)((read_le32(p) * PRIME32_1) >> (32 - HASH_BITS));
+}
+
+/* Writes an LZ4 length continuation: 'length' is what exceeds the 15 that
+   fit in the token. */
+static gpr_uint8 *write_length(gpr_uint8 *op, size_t length) {
+  for (; length >= 255; length -= 255) *op++ = 255;
+  *op++ = (gpr_uint8)length;
+  return op;
+}
+
+/* Writes a sequence of 'num_literals' literals, followed by a match unless
+   match_length is 0. Returns NULL if that would go past 'out_end'. */
+static gpr_uint8 *write_sequence(gpr_uint8 *op, gpr_uint8 *out_end,
+                                 const gpr_uint8 *literals,
+                                 size_t num_literals, size_t offset,
+                                 size_t match_length) {
+  gpr_uint8 *token = op;
+  size_t needed = 1 + num_literals + num_literals / 255 + 1;
+  if (match_length > 0) needed += 2 + (match_length - MIN_MATCH) / 255 + 1;
+  if (needed > (size_t)(out_end - op)) return NULL;
+
+  op++;
+  if (num_literals >= 15) {
+    *token = 15 << 4;
+    op = write_length(op, num_literals - 15);
+  } else {
+    *token = (gpr_uint8)(num_literals << 4);
+  }
+  memcpy(op, literals, num_literals);
+  op += num_literals;
+  if (match_length == 0) return op;
+
+  *op++ = (gpr_uint8)offset;
+  *op++ = (gpr_uint8)(offset >> 8);
+  match_length -= MIN_MATCH;
+  if (match_length >= 15) {
+    *token |= 15;
+    op = write_length(op, match_length - 15);
+  } else {
+    *token |= (gpr_uint8)match_length;
+  }
+  return op;
+}
+
+/* Compresses the 'length' bytes at 'in' into an LZ4 block at 'out', which
+   has room for 'capacity' bytes. Returns the size of the block, or 0 if it
+   does not fit. */
+static size_t compress_block(const gpr_uint8 *in, size_t length,
+                             gpr_uint8 *out, size_t capacity) {
+  gpr_uint16 table[1 << HASH_BITS];
+  const gpr_uint8 *ip = in;
+  const gpr_uint8 *anchor = in;
+  const gpr_uint8 *const in_end = in + length;
+  gpr_uint8 *op = out;
+  gpr_uint8 *const out_end = out + capacity;
+
+  GPR_ASSERT(length <= BLOCK_SIZE);
+  if (length > MF_LIMIT) {
+    const gpr_uint8 *const match_start_limit = in_end - MF_LIMIT;
+    const gpr_uint8 *const match_end_limit = in_end - LAST_LITERALS;
+    memset(table, 0, sizeof(table));
+    table[hash4(ip)] = 0;
+    ip++;
+    while (ip <= match_start_limit) {
+      size_t h = hash4(ip);
+      const gpr_uint8 *ref = in + table[h];
+      table[h] = (gpr_uint16)(ip - in);
+      if (ip - ref <= MAX_OFFSET && read_le32(ref) == read_le32(ip)) {
+        size_t match_length = MIN_MATCH;
+        while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+          ip--;
+          ref--;
+          match_length++;
+        }
+        while (ip + match_length < match_end_limit &&
+               ip[match_length] == ref[match_length]) {
+          match_length++;
+        }
+        op = write_sequence(op, out_end, anchor, (size_t)(ip - anchor),
+                            (size_t)(ip - ref), match_length);
+        if (op == NULL) return 0;
+        ip += match_length;
+        anchor = ip;
+        if (ip <= match_start_limit) {
+          table[hash4(ip - 2)] = (gpr_uint16)(ip - 2 - in);
+        }
+      } else {
+        /* Take longer strides the longer we go without a match, so that
+           incompressible data is skipped over quickly. */
+        ip += 1 + ((ip - anchor) >> 6);
+      }
+    }
+  }
+  op = write_sequence(op, out_end, anchor, (size_t)(in_end - anchor), 0, 0);
+  return op == NULL ? 0 : (size_t)(op - out);
+}
+
+/* Position in a slice buffer. */
+typedef struct {
+  gpr_slice_buffer *sb;
+  size_t slice;
+  size_t offset;
+} cursor;
+
+/* Returns a pointer to the next 'length' bytes of the cursor, copying them
+   into 'scratch' if they span several slices. */
+static const gpr_uint8 *next_bytes(cursor *c, size_t length,
+                                   gpr_uint8 *scratch) {
+  gpr_slice *s;
+  size_t copied = 0;
+
+  while (GPR_SLICE_LENGTH(c->sb->slices[c->slice]) == c->offset) {
+    c->slice++;
+    c->offset = 0;
+  }
+  s = &c->sb->slices[c->slice];
+  if (GPR_SLICE_LENGTH(*s) - c->offset >= length) {
+    const gpr_uint8 *p = GPR_SLICE_START_PTR(*s) + c->offset;
+    c->offset += length;
+    return p;
+  }
+  while (copied < length) {
+    size_t n;
+    s = &c->sb->slices[c->slice];
+    n = GPR_MIN(length - copied, GPR_SLICE_LENGTH(*s) - c->offset);
+    memcpy(scratch + copied, GPR_SLICE_START_PTR(*s) + c->offset, n);
+    copied += n;
+    c->offset += n;
+    if (c->offset == GPR_SLICE_LENGTH(*s)) {
+      c->slice++;
+      c->offset = 0;
+    }
+  }
+  return scratch;
+}
+
+int grpc_lz4_compress(gpr_slice_buffer *input, gpr_slice_buffer *output) {
+  size_t num_blocks = (input->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  /* Frames not smaller than the input are given up on. */
+  size_t capacity = input->length;
+  gpr_slice frame;
+  gpr_uint8 *start;
+  gpr_uint8 *op;
+  gpr_uint8 *end;
+  gpr_uint8 *scratch = NULL;
+  cursor c;
+  size_t remaining = input->length;
+  gpr_uint64 content_size = input->length;
+  int i;
+
+  if (capacity < HEADER_SIZE + 4 * num_blocks + 4) return 0;
+  frame = gpr_slice_malloc(capacity);
+  start = op = GPR_SLICE_START_PTR(frame);
+  end = start + capacity;
+  /* Blocks spanning several input slices are gathered here. */
+  if (input->count > 1) scratch = gpr_malloc(BLOCK_SIZE);
+
+  write_le32(op, FRAME_MAGIC);
+  op[4] = FLG_VERSION | FLG_BLOCK_INDEPENDENCE | FLG_CONTENT_SIZE;
+  op[5] = BD_64KB;
+  for (i = 0; i < 8; i++) {
+    op[6 + i] = (gpr_uint8)(content_size >> (8 * i));
+  }
+  op[14] = (gpr_uint8)(xxh32(op + 4, 10, 0) >> 8);
+  op += HEADER_SIZE;
+
+  c.sb = input;
+  c.slice = 0;
+  c.offset = 0;
+  while (remaining > 0) {
+    size_t block_length = GPR_MIN(remaining, BLOCK_SIZE);
+    const gpr_uint8 *block;
+    size_t compressed_length;
+    /* Leave room for the end mark. */
+    size_t room = (size_t)(end - op);
+
+    if (room < 4 + 4) goto fail;
+    room -= 4 + 4;
+    block = next_bytes(&c, block_length, scratch);
+    /* Blocks that do not shrink are stored. */
+    compressed_length = compress_block(block, block_length, op + 4,
+                                       GPR_MIN(room, block_length - 1));
+    if (compressed_length > 0) {
+      write_le32(op, (gpr_uint32)compressed_length);
+      op += 4 + compressed_length;
+    } else {
+      if (room < block_length) goto fail;
+      write_le32(op, (gpr_uint32)block_length | BLOCK_UNCOMPRESSED);
+      memcpy(op + 4, block, block_length);
+      op += 4 + block_length;
+    }
+    remaining -= block_length;
+  }
+  if (end - op < 4) goto fail;
+  write_le32(op, 0);
+  op += 4;
+  if ((size_t)(op - start) >= input->length) goto fail;
+
+  gpr_free(scratch);
+  GPR_SLICE_SET_LENGTH(frame, (size_t)(op - start));
+  gpr_slice_buffer_add(output, frame);
+  return 1;
+
+fail:
+  gpr_free(scratch);
+  gpr_slice_unref(frame);
+  return 0;
+}
+
+/* Decoded output, grown as needed. */
+typedef struct {
+  gpr_uint8 *data;
+  size_t length;
+  size_t capacity;
+} out_buffer;
+
+static void reserve(out_buffer *out, size_t extra) {
+  if (out->capacity - out->length >= extra) return;
+  out->capacity = GPR_MAX(2 * out->capacity, out->length + extra);
+  out->data = gpr_realloc(out->data, out->capacity);
+}
+
+/* Decodes the LZ4 block of 'length' bytes at 'in', appending at most
+   'max_output' bytes to 'out'. Matches may reach back to 'history_start' in
+   'out'. Returns 0 if the block is malformed. */
+static int decompress_block(const gpr_uint8 *in, size_t length,
+                            out_buffer *out, size_t max_output,
+                            size_t history_start) {
+  const gpr_uint8 *ip = in;
+  const gpr_uint8 *const in_end = in + length;
+  gpr_uint8 *op;
+  gpr_uint8 *out_end;
+
+  reserve(out, max_output);
+  op = out->data + out->length;
+  out_end = op + max_output;
+  for (;;) {
+    size_t num_literals;
+    size_t match_length;
+    size_t offset;
+    const gpr_uint8 *match;
+    gpr_uint8 token;
+    gpr_uint8 b;
+
+    if (ip == in_end) return 0;
+    token = *ip++;
+    num_literals = (size_t)(token >> 4);
+    if (num_literals == 15) {
+      do {
+        if (ip == in_end) return 0;
+        b = *ip++;
+        num_literals += b;
+      } while (b == 255);
+    }
+    if (num_literals > (size_t)(in_end - ip) ||
+        num_literals > (size_t)(out_end - op)) {
+      return 0;
+    }
+    memcpy(op, ip, num_literals);
+    op += num_literals;
+    ip += num_literals;
+    /* The last sequence of a block has no match. */
+    if (ip == in_end) break;
+
+    if (in_end - ip < 2) return 0;
+    offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - (out->data + history_start))) {
+      return 0;
+    }
+    match_length = (size_t)(token & 15);
+    if (match_length == 15) {
+      do {
+        if (ip == in_end) return 0;
+        b = *ip++;
+        match_length += b;
+      } while (b == 255);
+    }
+    match_length += MIN_MATCH;
+    if (match_length > (size_t)(out_end - op)) return 0;
+    match = op - offset;
+    if (offset >= match_length) {
+      memcpy(op, match, match_length);
+      op += match_length;
+    } else {
+      /* Overlapping matches repeat the last 'offset' bytes: everything
+         between match and op already holds that pattern, so copy it in
+         chunks that double each time instead of byte by byte. */
+      while (match_length > 0) {
+        size_t n = (size_t)(op - match);
+        if (n > match_length) n = match_length;
+        memcpy(op, match, n);
+        op += n;
+        match_length -= n;
+      }
+    }
+  }
+  out->length = (size_t)(op - out->data);
+  return 1;
+}
+
+static int decompress_frame(const gpr_uint8 *p, size_t length,
+                            out_buffer *out) {
+  const gpr_uint8 *const end = p + length;
+  gpr_uint8 flg;
+  gpr_uint8 bd;
+  size_t descriptor_length;
+  size_t max_block;
+  gpr_uint64 content_size = 0;
+  int i;
+
+  if (length < 7 || read_le32(p) != FRAME_MAGIC) return 0;
+  flg = p[4];
+  bd = p[5];
+  if ((flg & FLG_VERSION_MASK) != FLG_VERSION || (flg & FLG_RESERVED) ||
+      (flg & FLG_DICT_ID) || (bd & BD_RESERVED) || (bd >> 4) < 4) {
+    return 0;
+  }
+  max_block = (size_t)1 << (8 + 2 * (bd >> 4));
+  descriptor_length = 2 + ((flg & FLG_CONTENT_SIZE) ? 8 : 0);
+  if ((size_t)(end - p) < 4 + descriptor_length + 1 ||
+      p[4 + descriptor_length] !=
+          (gpr_uint8)(xxh32(p + 4, descriptor_length, 0) >> 8)) {
+    return 0;
+  }
+  if (flg & FLG_CONTENT_SIZE) {
+    for (i = 0; i < 8; i++) {
+      content_size |= (gpr_uint64)p[6 + i] << (8 * i);
+    }
+    /* Trust the declared size for the initial allocation only as far as the
+       input could plausibly expand to. */
+    if (content_size <= 255 * (gpr_uint64)length) {
+      reserve(out, (size_t)content_size);
+    }
+  }
+  p += 4 + descriptor_length + 1;
+
+  for (;;) {
+    gpr_uint32 block_size;
+    int uncompressed;
+
+    if (end - p < 4) return 0;
+    block_size = read_le32(p);
+    p += 4;
+    if (block_size == 0) break;
+    uncompressed = (block_size & BLOCK_UNCOMPRESSED) != 0;
+    block_size &= ~BLOCK_UNCOMPRESSED;
+    if (block_size > max_block || (size_t)(end - p) < block_size) return 0;
+    if (flg & FLG_BLOCK_CHECKSUM) {
+      if ((size_t)(end - p) - block_size < 4 ||
+          read_le32(p + block_size) != xxh32(p, block_size, 0)) {
+        return 0;
+      }
+    }
+    if (uncompressed) {
+      reserve(out, block_size);
+      memcpy(out->data + out->length, p, block_size);
+      out->length += block_size;
+    } else if (!decompress_block(p, block_size, out, max_block,
+                                 (flg & FLG_BLOCK_INDEPENDENCE)
+                                     ? out->length
+                                     : 0)) {
+      return 0;
+    }
+    p += block_size + ((flg & FLG_BLOCK_CHECKSUM) ? 4 : 0);
+  }
+
+  if (flg & FLG_CONTENT_CHECKSUM) {
+    if (end - p < 4 ||
+        read_le32(p) != xxh32(out->data, out->length, 0)) {
+      return 0;
+    }
+    p += 4;
+  }
+  return p == end &&
+         (!(flg & FLG_CONTENT_SIZE) || content_size == out->length);
+}
+
+int grpc_lz4_decompress(gpr_slice_buffer *input, gpr_slice_buffer *output) {
+  out_buffer out;
+  gpr_uint8 *flat = NULL;
+  const gpr_uint8 *frame;
+  int r;
+
+  if (input->length == 0) return 0;
+  if (input->count == 1) {
+    frame = GPR_SLICE_START_PTR(input->slices[0]);
+  } else {
+    cursor c;
+    c.sb = input;
+    c.slice = 0;
+    c.offset = 0;
+    flat = gpr_malloc(input->length);
+    frame = next_bytes(&c, input->length, flat);
+  }
+
+  out.data = NULL;
+  out.length = 0;
+  out.capacity = 0;
+  r = decompress_frame(frame, input->length, &out);
+  gpr_free(flat);
+  if (!r) {
+    gpr_free(out.data);
+    return 0;
+  }
+  if (out.length > 0) {
+    gpr_slice_buffer_add(output, gpr_slice_new(out.data, out.length, gpr_free));
+  } else {
+    gpr_free(out.data);
+  }
+  return 1;
+}
@@ -0,0 +1,55 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef GRPC_INTERNAL_CORE_COMPRESSION_LZ4_H
+#define GRPC_INTERNAL_CORE_COMPRESSION_LZ4_H
+
+#include <grpc/support/slice_buffer.h>
+
+/* LZ4, as specified by the LZ4 frame and block format documents of the lz4
+   project. It trades compression ratio for speed: compression runs several
+   times faster than deflate and decompression faster still.
+
+   Frames written here are made of independent 64KB blocks and carry the
+   content size. Frames written by other implementations are read as long as
+   they do not need a dictionary. */
+
+/* Appends the LZ4 frame of 'input' to 'output' and returns 1. If the frame
+   would not be smaller than 'input', output is unchanged and returns 0. */
+int grpc_lz4_compress(gpr_slice_buffer *input, gpr_slice_buffer *output);
+
+/* Appends the contents of the LZ4 frame in 'input' to 'output' and returns 1.
+   If 'input' is not a valid frame, output is unchanged and returns 0. */
+int grpc_lz4_decompress(gpr_slice_buffer *input, gpr_slice_buffer *output);
+
+#endif /* GRPC_INTERNAL_CORE_COMPRESSION_LZ4_H */
@@ -40,6 +40,8 @@
 
 #include <zlib.h>
 
+#include "src/core/compression/lz4.h"
+
 #define OUTPUT_BLOCK_SIZE 1024
 
 static int zlib_body(z_stream* zs, gpr_slice_buffer* input,
@@ -161,6 +163,8 @@ int compress_inner(grpc_compression_algorithm algorithm,
       return zlib_compress(input, output, 0);
     case GRPC_COMPRESS_GZIP:
       return zlib_compress(input, output, 1);
+    case GRPC_COMPRESS_LZ4:
+      return grpc_lz4_compress(input, output);
     case GRPC_COMPRESS_ALGORITHMS_COUNT:
       break;
   }
@@ -186,6 +190,8 @@ int grpc_msg_decompress(grpc_compression_algorithm algorithm,
       return zlib_decompress(input, output, 0);
     case GRPC_COMPRESS_GZIP:
       return zlib_decompress(input, output, 1);
+    case GRPC_COMPRESS_LZ4:
+      return grpc_lz4_decompress(input, output);
     case GRPC_COMPRESS_ALGORITHMS_COUNT:
       break;
   }
@@ -43,6 +43,26 @@
 #include <grpc/support/sync.h>
 #include <grpc/support/thd.h>
 #include <stdio.h>
+#include <string.h>
+
+#include "src/core/support/env.h"
+#include "src/core/support/thread_rings.h"
+
+/* By default each thread buffers its marks and prints them to stdout when its
+   buffer fills. If GRPC_LATENCY_TRACE names a file, each thread instead
+   appends its marks to a ring that a collector thread drains into that file in
+   the binary format below, so that recording never blocks.
+
+   The file starts with the 8 bytes "GRPCLAT1", followed by records whose
+   first byte gives their kind. Integers are little endian.
+     's': u32 string id, u16 length, the string.
+     'd': u32 thread, u64 number of marks of the thread dropped so far.
+     '{', '}', '.', '!': u32 thread, u32 tag, u32 tag string id,
+          u32 file string id, u32 line, u64 id, u64 time in nanoseconds.
+   A string is defined before its first use. Threads are numbered from 1 in
+   the order they start marking; the marks of thread 0 are those of the
+   threads that could not get a ring. tools/profile_analyzer reads both this
+   and the stdout format. */
 
 typedef enum {
   BEGIN = '{',
@@ -63,13 +83,39 @@ typedef struct grpc_timer_entry {
 
 #define MAX_COUNT (1024 * 1024 / sizeof(grpc_timer_entry))
 
-static __thread grpc_timer_entry log[MAX_COUNT];
+/* Marks in the ring of each thread, a power of 2. */
+#define RING_SIZE 16384
+/* Threads alive at once beyond this number do not record, which bounds the
+   memory used. */
+#define MAX_RINGS 256
+/* Period of the collector. A thread adding more than RING_SIZE marks during
+   that period drops marks. */
+#define COLLECT_PERIOD_MS 10
+
+typedef enum { LOG_STDOUT = 0, LOG_RING, LOG_OFF } log_mode;
+
+static __thread grpc_timer_entry thread_log[MAX_COUNT];
 static __thread int count;
 
+static gpr_atm g_mode = LOG_STDOUT;
+
+/* Protects the rings, and everything below as the collector writes it. */
+static gpr_mu g_mu;
+static gpr_thread_rings *g_rings;
+
+static FILE *g_out;
+/* Strings already written to g_out, by address: string literals are all that
+   is ever passed in. Open addressing, g_strings_capacity is a power of 2. The
+   id of g_strings[i] is g_string_ids[i]. */
+static const char **g_strings;
+static gpr_uint32 *g_string_ids;
+static size_t g_num_strings;
+static size_t g_strings_capacity;
+
 static void log_report() {
   int i;
   for (i = 0; i < count; i++) {
-    grpc_timer_entry *entry = &(log[i]);
+    grpc_timer_entry *entry = &(thread_log[i]);
     printf("GRPC_LAT_PROF %ld.%09d  %p %c %d(%s) %p %s %d\n", entry->tm.tv_sec,
            entry->tm.tv_nsec, (void *)(gpr_intptr)gpr_thd_currentid(),
            entry->type, entry->tag, entry->tagstr, entry->id, entry->file,
@@ -83,14 +129,24 @@ static void log_report() {
 static void grpc_timers_log_add(int tag, const char *tagstr, marker_type type,
                                 void *id, const char *file, int line) {
   grpc_timer_entry *entry;
+  gpr_thread_ring *r = NULL;
+  gpr_atm mode = gpr_atm_acq_load(&g_mode);
 
-  /* TODO (vpai) : Improve concurrency */
-  if (count == MAX_COUNT) {
-    log_report();
+  switch (mode) {
+    case LOG_STDOUT:
+      if (count == MAX_COUNT) {
+        log_report();
+      }
+      entry = &thread_log[count++];
+      break;
+    case LOG_RING:
+      entry = gpr_thread_rings_reserve(g_rings, &r);
+      if (entry == NULL) return;
+      break;
+    default:
+      return;
   }
 
-  entry = &log[count++];
-
   entry->tm = gpr_now(GPR_CLOCK_PRECISE);
   entry->tag = tag;
   entry->tagstr = tagstr;
@@ -98,8 +154,100 @@ static void grpc_timers_log_add(int tag, const char *tagstr, marker_type type,
   entry->id = id;
   entry->file = file;
   entry->line = line;
+
+  if (mode == LOG_RING) {
+    gpr_thread_rings_commit(r);
+  }
+}
+
+/* Collector. */
+
+static void put_u8(int v) { putc(v, g_out); }
+
+static void put_u16(gpr_uint32 v) {
+  put_u8((int)(v & 0xff));
+  put_u8((int)((v >> 8) & 0xff));
+}
+
+static void put_u32(gpr_uint32 v) {
+  put_u16(v & 0xffff);
+  put_u16(v >> 16);
+}
+
+static void put_u64(gpr_uint64 v) {
+  put_u32((gpr_uint32)v);
+  put_u32((gpr_uint32)(v >> 32));
+}
+
+static size_t string_slot(const char *str) {
+  size_t mask = g_strings_capacity - 1;
+  size_t i = ((size_t)(gpr_uintptr)str >> 3) & mask;
+  while (g_strings[i] != NULL && g_strings[i] != str) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+/* Returns the id of str, writing its definition if it is new. */
+static gpr_uint32 string_id(const char *str) {
+  size_t i;
+  size_t len;
+  if (2 * (g_num_strings + 1) > g_strings_capacity) {
+    const char **old = g_strings;
+    gpr_uint32 *old_ids = g_string_ids;
+    size_t old_capacity = g_strings_capacity;
+    g_strings_capacity = old_capacity == 0 ? 64 : 2 * old_capacity;
+    g_strings = gpr_malloc(g_strings_capacity * sizeof(*g_strings));
+    g_string_ids = gpr_malloc(g_strings_capacity * sizeof(*g_string_ids));
+    memset((void *)g_strings, 0, g_strings_capacity * sizeof(*g_strings));
+    for (i = 0; i < old_capacity; i++) {
+      if (old[i] != NULL) {
+        size_t j = string_slot(old[i]);
+        g_strings[j] = old[i];
+        g_string_ids[j] = old_ids[i];
+      }
+    }
+    gpr_free((void *)old);
+    gpr_free(old_ids);
+  }
+  i = string_slot(str);
+  if (g_strings[i] == NULL) {
+    g_strings[i] = str;
+    g_string_ids[i] = (gpr_uint32)g_num_strings++;
+    len = strlen(str);
+    if (len > 0xffff) len = 0xffff;
+    put_u8('s');
+    put_u32(g_string_ids[i]);
+    put_u16((gpr_uint32)len);
+    fwrite(str, 1, len, g_out);
+  }
+  return g_string_ids[i];
+}
+
+static void write_entry(void *arg, gpr_uint32 thread, const void *e) {
+  const grpc_timer_entry *entry = e;
+  gpr_uint32 tagstr = string_id(entry->tagstr);
+  gpr_uint32 file = string_id(entry->file);
+  put_u8(entry->type);
+  put_u32(thread);
+  put_u32((gpr_uint32)entry->tag);
+  put_u32(tagstr);
+  put_u32(file);
+  put_u32((gpr_uint32)entry->line);
+  put_u64((gpr_uint64)(gpr_uintptr)entry->id);
+  put_u64((gpr_uint64)entry->tm.tv_sec * GPR_NS_PER_SEC +
+          (gpr_uint64)entry->tm.tv_nsec);
+}
+
+static void write_dropped(void *arg, gpr_uint32 thread, gpr_uint64 dropped,
+                          gpr_uint64 total) {
+  put_u8('d');
+  put_u32(thread);
+  put_u64(total);
 }
 
+static void flush(void *arg) { fflush(g_out); }
+
 /* Latency profiler API implementation. */
 void grpc_timer_add_mark(int tag, const char *tagstr, void *id,
                          const char *file, int line) {
@@ -130,9 +278,60 @@ void grpc_timer_end(int tag, const char *tagstr, void *id, const char *file,
 }
 
 /* Basic profiler specific API functions. */
-void grpc_timers_global_init(void) {}
+static gpr_once g_once = GPR_ONCE_INIT;
 
-void grpc_timers_global_destroy(void) {}
+static void init(void) {
+  gpr_thread_rings_config config;
+  gpr_mu_init(&g_mu);
+  memset(&config, 0, sizeof(config));
+  config.entry_size = sizeof(grpc_timer_entry);
+  config.ring_size = RING_SIZE;
+  config.max_rings = MAX_RINGS;
+  config.mu = &g_mu;
+  config.on_entry = write_entry;
+  config.on_dropped = write_dropped;
+  config.on_drained = flush;
+  g_rings = gpr_thread_rings_create(&config);
+}
+
+void grpc_timers_global_init(void) {
+  char *path = gpr_getenv("GRPC_LATENCY_TRACE");
+
+  if (path == NULL) return;
+  gpr_once_init(&g_once, init);
+  gpr_mu_lock(&g_mu);
+  GPR_ASSERT(g_out == NULL);
+  g_out = fopen(path, "wb");
+  if (g_out == NULL) {
+    gpr_log(GPR_ERROR, "Could not open latency trace file %s", path);
+    gpr_mu_unlock(&g_mu);
+    gpr_free(path);
+    return;
+  }
+  gpr_free(path);
+  fwrite("GRPCLAT1", 1, 8, g_out);
+  /* Forget the marks recorded since the previous trace was closed. */
+  gpr_thread_rings_discard_locked(g_rings);
+  gpr_thread_rings_start_drainer_locked(g_rings, COLLECT_PERIOD_MS);
+  gpr_atm_rel_store(&g_mode, LOG_RING);
+  gpr_mu_unlock(&g_mu);
+}
+
+void grpc_timers_global_destroy(void) {
+  if (gpr_atm_acq_load(&g_mode) != LOG_RING) return;
+  gpr_mu_lock(&g_mu);
+  gpr_atm_rel_store(&g_mode, LOG_OFF);
+  gpr_mu_unlock(&g_mu);
+  gpr_thread_rings_stop_drainer(g_rings);
+  fclose(g_out);
+  g_out = NULL;
+  gpr_free((void *)g_strings);
+  gpr_free(g_string_ids);
+  g_strings = NULL;
+  g_string_ids = NULL;
+  g_num_strings = 0;
+  g_strings_capacity = 0;
+}
 
 #else  /* !GRPC_BASIC_PROFILER */
 void grpc_timers_global_init(void) {}
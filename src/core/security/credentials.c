@@ -260,9 +260,11 @@ static void ssl_copy_key_material(const char *input, unsigned char **output,
   memcpy(*output, input, *output_size);
 }
 
-static void ssl_build_config(const char *pem_root_certs,
-                             grpc_ssl_pem_key_cert_pair *pem_key_cert_pair,
-                             grpc_ssl_config *config) {
+static void ssl_build_config(
+    const char *pem_root_certs, grpc_ssl_pem_key_cert_pair *pem_key_cert_pair,
+    const grpc_ssl_session_cache_options *session_cache,
+    grpc_ssl_config *config) {
+  config->session_cache = *session_cache;
   if (pem_root_certs != NULL) {
     ssl_copy_key_material(pem_root_certs, &config->pem_root_certs,
                           &config->pem_root_certs_size);
@@ -282,9 +284,11 @@ static void ssl_build_config(const char *pem_root_certs,
 static void ssl_build_server_config(
     const char *pem_root_certs, grpc_ssl_pem_key_cert_pair *pem_key_cert_pairs,
     size_t num_key_cert_pairs, int force_client_auth,
+    const grpc_ssl_session_cache_options *session_cache,
     grpc_ssl_server_config *config) {
   size_t i;
   config->force_client_auth = force_client_auth;
+  config->session_cache = *session_cache;
   if (pem_root_certs != NULL) {
     ssl_copy_key_material(pem_root_certs, &config->pem_root_certs,
                           &config->pem_root_certs_size);
@@ -316,28 +320,55 @@ static void ssl_build_server_config(
 grpc_credentials *grpc_ssl_credentials_create(
     const char *pem_root_certs, grpc_ssl_pem_key_cert_pair *pem_key_cert_pair,
     void *reserved) {
+  grpc_ssl_session_cache_options session_cache;
+  memset(&session_cache, 0, sizeof(session_cache));
+  session_cache.session_cache_size = GRPC_SSL_DEFAULT_CLIENT_SESSION_CACHE_SIZE;
+  return grpc_ssl_credentials_create_with_session_cache(
+      pem_root_certs, pem_key_cert_pair, &session_cache, reserved);
+}
+
+grpc_credentials *grpc_ssl_credentials_create_with_session_cache(
+    const char *pem_root_certs, grpc_ssl_pem_key_cert_pair *pem_key_cert_pair,
+    const grpc_ssl_session_cache_options *session_cache, void *reserved) {
   grpc_ssl_credentials *c = gpr_malloc(sizeof(grpc_ssl_credentials));
   GPR_ASSERT(reserved == NULL);
+  GPR_ASSERT(session_cache != NULL);
   memset(c, 0, sizeof(grpc_ssl_credentials));
   c->base.type = GRPC_CREDENTIALS_TYPE_SSL;
   c->base.vtable = &ssl_vtable;
   gpr_ref_init(&c->base.refcount, 1);
-  ssl_build_config(pem_root_certs, pem_key_cert_pair, &c->config);
+  ssl_build_config(pem_root_certs, pem_key_cert_pair, session_cache,
+                   &c->config);
   return &c->base;
 }
 
 grpc_server_credentials *grpc_ssl_server_credentials_create(
     const char *pem_root_certs, grpc_ssl_pem_key_cert_pair *pem_key_cert_pairs,
     size_t num_key_cert_pairs, int force_client_auth, void *reserved) {
+  grpc_ssl_session_cache_options session_cache;
+  memset(&session_cache, 0, sizeof(session_cache));
+  session_cache.session_cache_size = GRPC_SSL_DEFAULT_SERVER_SESSION_CACHE_SIZE;
+  session_cache.enable_session_tickets = 1;
+  return grpc_ssl_server_credentials_create_with_session_cache(
+      pem_root_certs, pem_key_cert_pairs, num_key_cert_pairs,
+      force_client_auth, &session_cache, reserved);
+}
+
+grpc_server_credentials *grpc_ssl_server_credentials_create_with_session_cache(
+    const char *pem_root_certs, grpc_ssl_pem_key_cert_pair *pem_key_cert_pairs,
+    size_t num_key_cert_pairs, int force_client_auth,
+    const grpc_ssl_session_cache_options *session_cache, void *reserved) {
   grpc_ssl_server_credentials *c =
       gpr_malloc(sizeof(grpc_ssl_server_credentials));
   GPR_ASSERT(reserved == NULL);
+  GPR_ASSERT(session_cache != NULL);
   memset(c, 0, sizeof(grpc_ssl_server_credentials));
   c->base.type = GRPC_CREDENTIALS_TYPE_SSL;
   gpr_ref_init(&c->base.refcount, 1);
   c->base.vtable = &ssl_server_vtable;
   ssl_build_server_config(pem_root_certs, pem_key_cert_pairs,
-                          num_key_cert_pairs, force_client_auth, &c->config);
+                          num_key_cert_pairs, force_client_auth, session_cache,
+                          &c->config);
   return &c->base;
 }
 
@@ -35,6 +35,7 @@
 
 #include <string.h>
 
+#include "src/core/security/handshake_executor.h"
 #include "src/core/security/secure_endpoint.h"
 #include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
@@ -56,6 +57,7 @@ typedef struct {
   void *user_data;
   grpc_closure on_handshake_data_sent_to_peer;
   grpc_closure on_handshake_data_received_from_peer;
+  grpc_closure process_handshake_data;
 } grpc_security_handshake;
 
 static void on_handshake_data_received_from_peer(grpc_exec_ctx *exec_ctx,
@@ -173,8 +175,11 @@ static void send_handshake_bytes_to_peer(grpc_exec_ctx *exec_ctx,
                       &h->on_handshake_data_sent_to_peer);
 }
 
-static void on_handshake_data_received_from_peer(grpc_exec_ctx *exec_ctx,
-                                                 void *handshake, int success) {
+/* Feeds the received bytes to the handshaker and moves on to the next step.
+   This is where the handshake spends its CPU time, so it runs on the
+   handshake executor when offloading is enabled. */
+static void process_handshake_data(grpc_exec_ctx *exec_ctx, void *handshake,
+                                   int success) {
   grpc_security_handshake *h = handshake;
   size_t consumed_slice_size = 0;
   tsi_result result = TSI_OK;
@@ -182,12 +187,6 @@ static void on_handshake_data_received_from_peer(grpc_exec_ctx *exec_ctx,
   size_t num_left_overs;
   int has_left_overs_in_current_slice = 0;
 
-  if (!success) {
-    gpr_log(GPR_ERROR, "Read failed.");
-    security_handshake_done(exec_ctx, h, 0);
-    return;
-  }
-
   for (i = 0; i < h->incoming.count; i++) {
     consumed_slice_size = GPR_SLICE_LENGTH(h->incoming.slices[i]);
     result = tsi_handshaker_process_bytes_from_peer(
@@ -239,6 +238,21 @@ static void on_handshake_data_received_from_peer(grpc_exec_ctx *exec_ctx,
   check_peer(exec_ctx, h);
 }
 
+static void on_handshake_data_received_from_peer(grpc_exec_ctx *exec_ctx,
+                                                 void *handshake, int success) {
+  grpc_security_handshake *h = handshake;
+
+  if (!success) {
+    gpr_log(GPR_ERROR, "Read failed.");
+    security_handshake_done(exec_ctx, h, 0);
+    return;
+  }
+
+  if (!grpc_handshake_executor_try_push(&h->process_handshake_data, 1)) {
+    process_handshake_data(exec_ctx, h, 1);
+  }
+}
+
 /* If handshake is NULL, the handshake is done. */
 static void on_handshake_data_sent_to_peer(grpc_exec_ctx *exec_ctx,
                                            void *handshake, int success) {
@@ -281,6 +295,7 @@ void grpc_do_security_handshake(grpc_exec_ctx *exec_ctx,
                     on_handshake_data_sent_to_peer, h);
   grpc_closure_init(&h->on_handshake_data_received_from_peer,
                     on_handshake_data_received_from_peer, h);
+  grpc_closure_init(&h->process_handshake_data, process_handshake_data, h);
   gpr_slice_buffer_init(&h->left_overs);
   gpr_slice_buffer_init(&h->outgoing);
   gpr_slice_buffer_init(&h->incoming);
@@ -0,0 +1,157 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "src/core/security/handshake_executor.h"
+
+#include <grpc/grpc_security.h>
+#include <grpc/support/alloc.h>
+#include <grpc/support/log.h>
+#include <grpc/support/sync.h>
+#include <grpc/support/thd.h>
+#include <grpc/support/time.h>
+
+#include "src/core/iomgr/exec_ctx.h"
+
+typedef struct {
+  gpr_mu mu;
+  gpr_cv cv;
+  /* Configuration, see grpc_security_set_handshake_offload. */
+  size_t num_threads;
+  size_t max_queued;
+  /* Running threads, 0 until the first step is offloaded. */
+  gpr_thd_id *threads;
+  size_t num_running_threads;
+  grpc_closure_list queue;
+  size_t num_queued;
+  int shutting_down;
+} handshake_executor;
+
+static handshake_executor g_executor;
+static gpr_once g_executor_once = GPR_ONCE_INIT;
+
+static void executor_init(void) {
+  gpr_mu_init(&g_executor.mu);
+  gpr_cv_init(&g_executor.cv);
+}
+
+static void executor_thread(void *arg) {
+  for (;;) {
+    grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+    grpc_closure *closure;
+    gpr_mu_lock(&g_executor.mu);
+    while (grpc_closure_list_empty(g_executor.queue) &&
+           !g_executor.shutting_down) {
+      gpr_cv_wait(&g_executor.cv, &g_executor.mu,
+                  gpr_inf_future(GPR_CLOCK_REALTIME));
+    }
+    if (grpc_closure_list_empty(g_executor.queue)) {
+      /* Shutting down and drained. */
+      gpr_mu_unlock(&g_executor.mu);
+      return;
+    }
+    closure = g_executor.queue.head;
+    g_executor.queue.head = closure->next;
+    if (g_executor.queue.head == NULL) g_executor.queue.tail = NULL;
+    g_executor.num_queued--;
+    gpr_mu_unlock(&g_executor.mu);
+
+    closure->cb(&exec_ctx, closure->cb_arg, closure->success);
+    grpc_exec_ctx_finish(&exec_ctx);
+  }
+}
+
+static void start_threads_locked(void) {
+  size_t i;
+  gpr_thd_options options = gpr_thd_options_default();
+  gpr_thd_options_set_joinable(&options);
+  g_executor.threads = gpr_malloc(sizeof(gpr_thd_id) * g_executor.num_threads);
+  for (i = 0; i < g_executor.num_threads; i++) {
+    GPR_ASSERT(gpr_thd_new(&g_executor.threads[i], executor_thread, NULL,
+                           &options));
+  }
+  g_executor.num_running_threads = g_executor.num_threads;
+}
+
+/* Stops and joins the running threads, once they have run the queued
+   steps. Called with mu held, which is released while joining. */
+static void stop_threads_locked(void) {
+  gpr_thd_id *threads = g_executor.threads;
+  size_t num_threads = g_executor.num_running_threads;
+  size_t i;
+  if (num_threads == 0) return;
+  g_executor.threads = NULL;
+  g_executor.num_running_threads = 0;
+  g_executor.shutting_down = 1;
+  gpr_cv_broadcast(&g_executor.cv);
+  gpr_mu_unlock(&g_executor.mu);
+  for (i = 0; i < num_threads; i++) {
+    gpr_thd_join(threads[i]);
+  }
+  gpr_free(threads);
+  gpr_mu_lock(&g_executor.mu);
+  GPR_ASSERT(grpc_closure_list_empty(g_executor.queue));
+  g_executor.shutting_down = 0;
+}
+
+void grpc_security_set_handshake_offload(size_t num_threads,
+                                         size_t max_queued_steps) {
+  gpr_once_init(&g_executor_once, executor_init);
+  gpr_mu_lock(&g_executor.mu);
+  stop_threads_locked();
+  g_executor.num_threads = num_threads;
+  g_executor.max_queued = max_queued_steps;
+  gpr_mu_unlock(&g_executor.mu);
+}
+
+void grpc_handshake_executor_shutdown(void) {
+  gpr_once_init(&g_executor_once, executor_init);
+  gpr_mu_lock(&g_executor.mu);
+  stop_threads_locked();
+  gpr_mu_unlock(&g_executor.mu);
+}
+
+int grpc_handshake_executor_try_push(grpc_closure *closure, int success) {
+  gpr_once_init(&g_executor_once, executor_init);
+  gpr_mu_lock(&g_executor.mu);
+  if (g_executor.num_threads == 0 || g_executor.shutting_down ||
+      g_executor.num_queued >= g_executor.max_queued) {
+    gpr_mu_unlock(&g_executor.mu);
+    return 0;
+  }
+  if (g_executor.num_running_threads == 0) start_threads_locked();
+  grpc_closure_list_add(&g_executor.queue, closure, success);
+  g_executor.num_queued++;
+  gpr_cv_signal(&g_executor.cv);
+  gpr_mu_unlock(&g_executor.mu);
+  return 1;
+}
@@ -0,0 +1,55 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef GRPC_INTERNAL_CORE_SECURITY_HANDSHAKE_EXECUTOR_H
+#define GRPC_INTERNAL_CORE_SECURITY_HANDSHAKE_EXECUTOR_H
+
+#include <stddef.h>
+
+#include "src/core/iomgr/closure.h"
+
+/* A bounded pool of threads running the CPU heavy steps of security
+   handshakes, so that a burst of new connections does not stall the I/O
+   threads serving established ones. The pool is disabled until configured
+   through grpc_security_set_handshake_offload and its threads are started on
+   first use. */
+
+/* Runs the queued steps and joins the threads. Called by grpc_shutdown. */
+void grpc_handshake_executor_shutdown(void);
+
+/* Queues closure to run on a handshake thread, with its own exec_ctx.
+   Returns 0 without queueing if offloading is disabled or if the queue is
+   full, in which case the caller runs the step inline. */
+int grpc_handshake_executor_try_push(grpc_closure *closure, int success);
+
+#endif /* GRPC_INTERNAL_CORE_SECURITY_HANDSHAKE_EXECUTOR_H */
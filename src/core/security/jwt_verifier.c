@@ -38,6 +38,7 @@
 
 #include "src/core/httpcli/httpcli.h"
 #include "src/core/security/base64.h"
+#include "src/core/support/murmur_hash.h"
 
 #include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
@@ -188,9 +189,18 @@ struct grpc_jwt_claims {
 
   grpc_json *json;
   gpr_slice buffer;
+
+  /* Claims are shared between the token cache and the callers. */
+  gpr_refcount refs;
 };
 
+static grpc_jwt_claims *jwt_claims_ref(grpc_jwt_claims *claims) {
+  gpr_ref(&claims->refs);
+  return claims;
+}
+
 void grpc_jwt_claims_destroy(grpc_jwt_claims *claims) {
+  if (!gpr_unref(&claims->refs)) return;
   grpc_json_destroy(claims->json);
   gpr_slice_unref(claims->buffer);
   gpr_free(claims);
@@ -243,6 +253,7 @@ grpc_jwt_claims *grpc_jwt_claims_from_json(grpc_json *json, gpr_slice buffer) {
   memset(claims, 0, sizeof(grpc_jwt_claims));
   claims->json = json;
   claims->buffer = buffer;
+  gpr_ref_init(&claims->refs, 1);
   claims->iat = gpr_inf_past(GPR_CLOCK_REALTIME);
   claims->nbf = gpr_inf_past(GPR_CLOCK_REALTIME);
   claims->exp = gpr_inf_future(GPR_CLOCK_REALTIME);
@@ -323,6 +334,7 @@ typedef struct {
   grpc_pollset *pollset;
   jose_header *header;
   grpc_jwt_claims *claims;
+  char *jwt;
   char *audience;
   gpr_slice signature;
   gpr_slice signed_data;
@@ -341,6 +353,7 @@ static verifier_cb_ctx *verifier_cb_ctx_create(
   ctx->verifier = verifier;
   ctx->pollset = pollset;
   ctx->header = header;
+  ctx->jwt = gpr_strdup(signed_jwt);
   ctx->audience = gpr_strdup(audience);
   ctx->claims = claims;
   ctx->signature = signature;
@@ -351,6 +364,7 @@ static verifier_cb_ctx *verifier_cb_ctx_create(
 }
 
 void verifier_cb_ctx_destroy(verifier_cb_ctx *ctx) {
+  gpr_free(ctx->jwt);
   if (ctx->audience != NULL) gpr_free(ctx->audience);
   if (ctx->claims != NULL) grpc_jwt_claims_destroy(ctx->claims);
   gpr_slice_unref(ctx->signature);
@@ -368,18 +382,250 @@ gpr_timespec grpc_jwt_verifier_clock_skew = {60, 0, GPR_TIMESPAN};
 /* Max delay defaults to one minute. */
 gpr_timespec grpc_jwt_verifier_max_delay = {60, 0, GPR_TIMESPAN};
 
+/* Token cache size defaults to 1024 tokens. */
+size_t grpc_jwt_verifier_token_cache_size = 1024;
+
+/* Key cache lifetime defaults to one hour. */
+gpr_timespec grpc_jwt_verifier_key_cache_lifetime = {3600, 0, GPR_TIMESPAN};
+
+/* The issuers of the key cache come from tokens that are not verified yet, so
+   their number is bounded. */
+#define MAX_CACHED_KEY_SETS 32
+
 typedef struct {
   char *email_domain;
   char *key_url_prefix;
 } email_key_mapping;
 
+/* Keys fetched from an issuer. */
+typedef struct key_set {
+  gpr_refcount refs;
+  char *issuer;
+  char *body; /* The json points into it. */
+  grpc_json *json;
+  gpr_timespec expiration;
+  struct key_set *next;
+} key_set;
+
+/* A successfully verified token, in a hash bucket and in the LRU list. */
+typedef struct token_cache_entry {
+  char *jwt;
+  char *audience;
+  gpr_uint32 hash;
+  grpc_jwt_claims *claims;
+  struct token_cache_entry *bucket_next;
+  struct token_cache_entry *lru_prev;
+  struct token_cache_entry *lru_next;
+} token_cache_entry;
+
 struct grpc_jwt_verifier {
   email_key_mapping *mappings;
   size_t num_mappings; /* Should be very few, linear search ok. */
   size_t allocated_mappings;
   grpc_httpcli_context http_ctx;
+
+  /* Protects the caches below: verifications complete on any thread. */
+  gpr_mu mu;
+  /* Verified tokens. lru_head is the most recently used. */
+  token_cache_entry **token_buckets;
+  size_t num_token_buckets; /* A power of 2. */
+  size_t num_tokens;
+  size_t max_tokens;
+  token_cache_entry *lru_head;
+  token_cache_entry *lru_tail;
+  /* Key sets by issuer, linear search ok. */
+  key_set *key_sets;
+  size_t num_key_sets;
 };
 
+/* --- Token cache. --- */
+
+static gpr_uint32 token_hash(const char *jwt, const char *audience) {
+  return gpr_murmur_hash3(jwt, strlen(jwt),
+                          gpr_murmur_hash3(audience, strlen(audience), 0));
+}
+
+static token_cache_entry **token_bucket(grpc_jwt_verifier *v,
+                                        gpr_uint32 hash) {
+  return &v->token_buckets[hash & (v->num_token_buckets - 1)];
+}
+
+static void lru_unlink(grpc_jwt_verifier *v, token_cache_entry *e) {
+  if (e->lru_prev != NULL) {
+    e->lru_prev->lru_next = e->lru_next;
+  } else {
+    v->lru_head = e->lru_next;
+  }
+  if (e->lru_next != NULL) {
+    e->lru_next->lru_prev = e->lru_prev;
+  } else {
+    v->lru_tail = e->lru_prev;
+  }
+  e->lru_prev = e->lru_next = NULL;
+}
+
+static void lru_push_front(grpc_jwt_verifier *v, token_cache_entry *e) {
+  e->lru_next = v->lru_head;
+  if (v->lru_head != NULL) v->lru_head->lru_prev = e;
+  v->lru_head = e;
+  if (v->lru_tail == NULL) v->lru_tail = e;
+}
+
+static void token_cache_entry_destroy(token_cache_entry *e) {
+  gpr_free(e->jwt);
+  gpr_free(e->audience);
+  grpc_jwt_claims_destroy(e->claims);
+  gpr_free(e);
+}
+
+/* Requires mu. */
+static void token_cache_remove(grpc_jwt_verifier *v, token_cache_entry *e) {
+  token_cache_entry **p = token_bucket(v, e->hash);
+  while (*p != e) p = &(*p)->bucket_next;
+  *p = e->bucket_next;
+  lru_unlink(v, e);
+  v->num_tokens--;
+  token_cache_entry_destroy(e);
+}
+
+/* Requires mu. */
+static token_cache_entry *token_cache_find(grpc_jwt_verifier *v,
+                                           const char *jwt,
+                                           const char *audience,
+                                           gpr_uint32 hash) {
+  token_cache_entry *e;
+  for (e = *token_bucket(v, hash); e != NULL; e = e->bucket_next) {
+    if (e->hash == hash && strcmp(e->jwt, jwt) == 0 &&
+        strcmp(e->audience, audience) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+/* Returns 1 if jwt was verified before for audience, along with the status of
+   its time constraints and, if they are still met, a reference to its
+   claims. */
+static int token_cache_lookup(grpc_jwt_verifier *v, const char *jwt,
+                              const char *audience,
+                              grpc_jwt_verifier_status *status,
+                              grpc_jwt_claims **claims) {
+  gpr_uint32 hash;
+  token_cache_entry *e;
+  if (v->max_tokens == 0) return 0;
+  hash = token_hash(jwt, audience);
+  gpr_mu_lock(&v->mu);
+  e = token_cache_find(v, jwt, audience, hash);
+  if (e == NULL) {
+    gpr_mu_unlock(&v->mu);
+    return 0;
+  }
+  *status = grpc_jwt_claims_check(e->claims, audience);
+  if (*status == GRPC_JWT_VERIFIER_OK) {
+    *claims = jwt_claims_ref(e->claims);
+    lru_unlink(v, e);
+    lru_push_front(v, e);
+  } else {
+    *claims = NULL;
+    token_cache_remove(v, e);
+  }
+  gpr_mu_unlock(&v->mu);
+  return 1;
+}
+
+static void token_cache_add(grpc_jwt_verifier *v, const char *jwt,
+                            const char *audience, grpc_jwt_claims *claims) {
+  gpr_uint32 hash;
+  token_cache_entry *e;
+  token_cache_entry **bucket;
+  if (v->max_tokens == 0) return;
+  hash = token_hash(jwt, audience);
+  gpr_mu_lock(&v->mu);
+  if (token_cache_find(v, jwt, audience, hash) == NULL) {
+    if (v->num_tokens == v->max_tokens) token_cache_remove(v, v->lru_tail);
+    e = gpr_malloc(sizeof(token_cache_entry));
+    memset(e, 0, sizeof(token_cache_entry));
+    e->jwt = gpr_strdup(jwt);
+    e->audience = gpr_strdup(audience);
+    e->hash = hash;
+    e->claims = jwt_claims_ref(claims);
+    bucket = token_bucket(v, hash);
+    e->bucket_next = *bucket;
+    *bucket = e;
+    lru_push_front(v, e);
+    v->num_tokens++;
+  }
+  gpr_mu_unlock(&v->mu);
+}
+
+/* --- Key cache. --- */
+
+static key_set *key_set_ref(key_set *keys) {
+  gpr_ref(&keys->refs);
+  return keys;
+}
+
+static void key_set_unref(key_set *keys) {
+  if (!gpr_unref(&keys->refs)) return;
+  grpc_json_destroy(keys->json);
+  gpr_free(keys->body);
+  gpr_free(keys->issuer);
+  gpr_free(keys);
+}
+
+/* Returns a reference to the unexpired keys of issuer, or NULL. */
+static key_set *key_cache_get(grpc_jwt_verifier *v, const char *issuer) {
+  key_set **p;
+  key_set *result = NULL;
+  gpr_mu_lock(&v->mu);
+  for (p = &v->key_sets; *p != NULL; p = &(*p)->next) {
+    if (strcmp((*p)->issuer, issuer) != 0) continue;
+    if (gpr_time_cmp(gpr_now(GPR_CLOCK_REALTIME), (*p)->expiration) < 0) {
+      result = key_set_ref(*p);
+    } else {
+      key_set *expired = *p;
+      *p = expired->next;
+      v->num_key_sets--;
+      key_set_unref(expired);
+    }
+    break;
+  }
+  gpr_mu_unlock(&v->mu);
+  return result;
+}
+
+/* Replaces the keys of the same issuer if any, or else evicts the keys
+   expiring first when the cache is full. */
+static void key_cache_put(grpc_jwt_verifier *v, key_set *keys) {
+  key_set **p;
+  key_set **victim = NULL;
+  gpr_mu_lock(&v->mu);
+  for (p = &v->key_sets; *p != NULL; p = &(*p)->next) {
+    if (strcmp((*p)->issuer, keys->issuer) == 0) {
+      victim = p;
+      break;
+    }
+  }
+  if (victim == NULL && v->num_key_sets == MAX_CACHED_KEY_SETS) {
+    for (p = &v->key_sets; *p != NULL; p = &(*p)->next) {
+      if (victim == NULL ||
+          gpr_time_cmp((*p)->expiration, (*victim)->expiration) < 0) {
+        victim = p;
+      }
+    }
+  }
+  if (victim != NULL) {
+    key_set *evicted = *victim;
+    *victim = evicted->next;
+    v->num_key_sets--;
+    key_set_unref(evicted);
+  }
+  keys->next = v->key_sets;
+  v->key_sets = key_set_ref(keys);
+  v->num_key_sets++;
+  gpr_mu_unlock(&v->mu);
+}
+
 static grpc_json *json_from_http(const grpc_httpcli_response *response) {
   grpc_json *json = NULL;
 
@@ -569,45 +815,81 @@ end:
   return result;
 }
 
-static void on_keys_retrieved(grpc_exec_ctx *exec_ctx, void *user_data,
-                              const grpc_httpcli_response *response) {
-  grpc_json *json = json_from_http(response);
-  verifier_cb_ctx *ctx = (verifier_cb_ctx *)user_data;
-  EVP_PKEY *verification_key = NULL;
-  grpc_jwt_verifier_status status = GRPC_JWT_VERIFIER_GENERIC_ERROR;
+/* Verifies the token of ctx with the matching key of keys, calls the user
+   callback and destroys ctx. Returns 0 and leaves ctx untouched if keys has
+   no key for the token. */
+static int verify_with_keys(verifier_cb_ctx *ctx, const grpc_json *keys) {
+  EVP_PKEY *verification_key =
+      find_verification_key(keys, ctx->header->alg, ctx->header->kid);
+  grpc_jwt_verifier_status status;
   grpc_jwt_claims *claims = NULL;
 
-  if (json == NULL) {
-    status = GRPC_JWT_VERIFIER_KEY_RETRIEVAL_ERROR;
-    goto end;
-  }
-  verification_key =
-      find_verification_key(json, ctx->header->alg, ctx->header->kid);
-  if (verification_key == NULL) {
-    gpr_log(GPR_ERROR, "Could not find verification key with kid %s.",
-            ctx->header->kid);
-    status = GRPC_JWT_VERIFIER_KEY_RETRIEVAL_ERROR;
-    goto end;
-  }
-
+  if (verification_key == NULL) return 0;
   if (!verify_jwt_signature(verification_key, ctx->header->alg, ctx->signature,
                             ctx->signed_data)) {
     status = GRPC_JWT_VERIFIER_BAD_SIGNATURE;
-    goto end;
+  } else {
+    status = grpc_jwt_claims_check(ctx->claims, ctx->audience);
   }
-
-  status = grpc_jwt_claims_check(ctx->claims, ctx->audience);
   if (status == GRPC_JWT_VERIFIER_OK) {
     /* Pass ownership. */
     claims = ctx->claims;
     ctx->claims = NULL;
+    token_cache_add(ctx->verifier, ctx->jwt, ctx->audience, claims);
   }
-
-end:
-  if (json != NULL) grpc_json_destroy(json);
-  if (verification_key != NULL) EVP_PKEY_free(verification_key);
+  EVP_PKEY_free(verification_key);
   ctx->user_cb(ctx->user_data, status, claims);
   verifier_cb_ctx_destroy(ctx);
+  return 1;
+}
+
+static key_set *key_set_from_http(const char *issuer,
+                                  const grpc_httpcli_response *response) {
+  grpc_httpcli_response copy;
+  key_set *keys;
+  grpc_json *json;
+
+  if (response == NULL) {
+    gpr_log(GPR_ERROR, "HTTP response is NULL.");
+    return NULL;
+  }
+  /* The response goes away with the callback, parse a copy. */
+  copy = *response;
+  copy.body = gpr_malloc(response->body_length);
+  memcpy(copy.body, response->body, response->body_length);
+  json = json_from_http(&copy);
+  if (json == NULL) {
+    gpr_free(copy.body);
+    return NULL;
+  }
+  keys = gpr_malloc(sizeof(key_set));
+  memset(keys, 0, sizeof(key_set));
+  gpr_ref_init(&keys->refs, 1);
+  keys->issuer = gpr_strdup(issuer);
+  keys->body = copy.body;
+  keys->json = json;
+  keys->expiration = gpr_time_add(gpr_now(GPR_CLOCK_REALTIME),
+                                  grpc_jwt_verifier_key_cache_lifetime);
+  return keys;
+}
+
+static void on_keys_retrieved(grpc_exec_ctx *exec_ctx, void *user_data,
+                              const grpc_httpcli_response *response) {
+  verifier_cb_ctx *ctx = (verifier_cb_ctx *)user_data;
+  key_set *keys = key_set_from_http(ctx->claims->iss, response);
+
+  if (keys != NULL) {
+    key_cache_put(ctx->verifier, keys);
+    if (verify_with_keys(ctx, keys->json)) {
+      key_set_unref(keys);
+      return;
+    }
+    key_set_unref(keys);
+    gpr_log(GPR_ERROR, "Could not find verification key with kid %s.",
+            ctx->header->kid);
+  }
+  ctx->user_cb(ctx->user_data, GRPC_JWT_VERIFIER_KEY_RETRIEVAL_ERROR, NULL);
+  verifier_cb_ctx_destroy(ctx);
 }
 
 static void on_openid_config_retrieved(grpc_exec_ctx *exec_ctx, void *user_data,
@@ -618,7 +900,7 @@ static void on_openid_config_retrieved(grpc_exec_ctx *exec_ctx, void *user_data,
   grpc_httpcli_request req;
   const char *jwks_uri;
 
-  /* TODO(jboeuf): Cache the jwks_uri in order to avoid this hop next time. */
+  /* Skipped, along with the keys hop, while the issuer's keys are cached. */
   if (json == NULL) goto error;
   cur = find_property_by_name(json, "jwks_uri");
   if (cur == NULL) {
@@ -688,6 +970,7 @@ static void retrieve_key_and_verify(grpc_exec_ctx *exec_ctx,
   grpc_httpcli_response_cb http_cb;
   char *path_prefix = NULL;
   const char *iss;
+  key_set *keys;
   grpc_httpcli_request req;
   memset(&req, 0, sizeof(grpc_httpcli_request));
   req.handshaker = &grpc_httpcli_ssl;
@@ -703,6 +986,14 @@ static void retrieve_key_and_verify(grpc_exec_ctx *exec_ctx,
     goto error;
   }
 
+  keys = key_cache_get(ctx->verifier, iss);
+  if (keys != NULL) {
+    int verified = verify_with_keys(ctx, keys->json);
+    key_set_unref(keys);
+    if (verified) return;
+    /* The issuer may have rotated its keys, fetch them again. */
+  }
+
   /* This code relies on:
      https://openid.net/specs/openid-connect-discovery-1_0.html
      Nobody seems to implement the account/email/webfinger part 2. of the spec
@@ -771,8 +1062,13 @@ void grpc_jwt_verifier_verify(grpc_exec_ctx *exec_ctx,
   gpr_slice signature;
   size_t signed_jwt_len;
   const char *cur = jwt;
+  grpc_jwt_verifier_status cached_status;
 
   GPR_ASSERT(verifier != NULL && jwt != NULL && audience != NULL && cb != NULL);
+  if (token_cache_lookup(verifier, jwt, audience, &cached_status, &claims)) {
+    cb(user_data, cached_status, claims);
+    return;
+  }
   dot = strchr(cur, '.');
   if (dot == NULL) goto error;
   json = parse_json_part_from_jwt(cur, (size_t)(dot - cur), &header_buffer);
@@ -810,6 +1106,14 @@ grpc_jwt_verifier *grpc_jwt_verifier_create(
   grpc_jwt_verifier *v = gpr_malloc(sizeof(grpc_jwt_verifier));
   memset(v, 0, sizeof(grpc_jwt_verifier));
   grpc_httpcli_context_init(&v->http_ctx);
+  gpr_mu_init(&v->mu);
+  v->max_tokens = grpc_jwt_verifier_token_cache_size;
+  v->num_token_buckets = 1;
+  while (v->num_token_buckets < v->max_tokens) v->num_token_buckets <<= 1;
+  v->token_buckets =
+      gpr_malloc(v->num_token_buckets * sizeof(token_cache_entry *));
+  memset(v->token_buckets, 0,
+         v->num_token_buckets * sizeof(token_cache_entry *));
 
   /* We know at least of one mapping. */
   v->allocated_mappings = 1 + num_mappings;
@@ -831,6 +1135,14 @@ void grpc_jwt_verifier_destroy(grpc_jwt_verifier *v) {
   size_t i;
   if (v == NULL) return;
   grpc_httpcli_context_destroy(&v->http_ctx);
+  while (v->lru_head != NULL) token_cache_remove(v, v->lru_head);
+  gpr_free(v->token_buckets);
+  while (v->key_sets != NULL) {
+    key_set *keys = v->key_sets;
+    v->key_sets = keys->next;
+    key_set_unref(keys);
+  }
+  gpr_mu_destroy(&v->mu);
   if (v->mappings != NULL) {
     for (i = 0; i < v->num_mappings; i++) {
       gpr_free(v->mappings[i].email_domain);
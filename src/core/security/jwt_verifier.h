@@ -98,6 +98,15 @@ typedef struct {
 extern gpr_timespec grpc_jwt_verifier_clock_skew;
 extern gpr_timespec grpc_jwt_verifier_max_delay;
 
+/* A verifier remembers the claims of the last
+   grpc_jwt_verifier_token_cache_size tokens it verified successfully, and
+   the keys it fetched from each issuer for
+   grpc_jwt_verifier_key_cache_lifetime. The time constraints of a cached token
+   are checked again each time it is verified. The token cache size is read
+   when the verifier is created, 0 disables it. */
+extern size_t grpc_jwt_verifier_token_cache_size;
+extern gpr_timespec grpc_jwt_verifier_key_cache_lifetime;
+
 /* The verifier can be created with some custom mappings to help with key
    discovery in the case where the issuer is an email address.
    mappings can be NULL in which case num_mappings MUST be 0.
@@ -41,7 +41,15 @@
 #include "src/core/tsi/transport_security_interface.h"
 #include "src/core/debug/trace.h"
 
+/* Staging buffers are sized after the amount of data being processed so that
+   large reads and writes are protected into a few large slices instead of
+   many small ones. */
 #define STAGING_BUFFER_SIZE 8192
+#define MAX_STAGING_BUFFER_SIZE (256 * 1024)
+/* Protected frames are a little larger than the data they carry. Reserve
+   1/64th of the plaintext size plus a fixed slack for framing overhead. */
+#define PROTECTED_SIZE_ESTIMATE(unprotected_size) \
+  ((unprotected_size) + (unprotected_size) / 64 + 1024)
 
 typedef struct {
   grpc_endpoint base;
@@ -117,10 +125,39 @@ static void secure_endpoint_unref(grpc_exec_ctx *exec_ctx,
 static void secure_endpoint_ref(secure_endpoint *ep) { gpr_ref(&ep->ref); }
 #endif
 
+static size_t staging_buffer_size(size_t wanted) {
+  if (wanted < STAGING_BUFFER_SIZE) return STAGING_BUFFER_SIZE;
+  if (wanted > MAX_STAGING_BUFFER_SIZE) return MAX_STAGING_BUFFER_SIZE;
+  return wanted;
+}
+
+/* Makes sure *staging has room for wanted bytes (within staging_buffer_size
+   bounds), replacing it with a larger slice if needed. */
+static void reserve_staging_buffer(gpr_slice *staging, size_t wanted) {
+  size_t size = staging_buffer_size(wanted);
+  if (GPR_SLICE_LENGTH(*staging) < size) {
+    gpr_slice_unref(*staging);
+    *staging = gpr_slice_malloc(size);
+  }
+}
+
+/* Called once a read or write is done with *staging. Slices handed out of a
+   staging buffer share its allocation with what is left of it, so keeping
+   the tail of one grown for a large message would pin that whole allocation
+   for as long as the connection lives. Such a tail is dropped instead, and
+   the next read or write allocates afresh: an idle connection holds at most
+   STAGING_BUFFER_SIZE per direction. */
+static void release_staging_buffer(gpr_slice *staging, size_t reserved) {
+  if (reserved > STAGING_BUFFER_SIZE) {
+    gpr_slice_unref(*staging);
+    *staging = gpr_empty_slice();
+  }
+}
+
 static void flush_read_staging_buffer(secure_endpoint *ep, gpr_uint8 **cur,
-                                      gpr_uint8 **end) {
+                                      gpr_uint8 **end, size_t wanted) {
   gpr_slice_buffer_add(ep->read_buffer, ep->read_staging_buffer);
-  ep->read_staging_buffer = gpr_slice_malloc(STAGING_BUFFER_SIZE);
+  ep->read_staging_buffer = gpr_slice_malloc(staging_buffer_size(wanted));
   *cur = GPR_SLICE_START_PTR(ep->read_staging_buffer);
   *end = GPR_SLICE_END_PTR(ep->read_staging_buffer);
 }
@@ -146,8 +183,11 @@ static void on_read(grpc_exec_ctx *exec_ctx, void *user_data, int success) {
   gpr_uint8 keep_looping = 0;
   tsi_result result = TSI_OK;
   secure_endpoint *ep = (secure_endpoint *)user_data;
-  gpr_uint8 *cur = GPR_SLICE_START_PTR(ep->read_staging_buffer);
-  gpr_uint8 *end = GPR_SLICE_END_PTR(ep->read_staging_buffer);
+  /* Protected bytes not handed to the protector yet. Unprotected data is never
+     larger than its protected form, so this bounds the staging space needed. */
+  size_t remaining = ep->source_buffer.length;
+  gpr_uint8 *cur;
+  gpr_uint8 *end;
 
   if (!success) {
     gpr_slice_buffer_reset_and_unref(ep->read_buffer);
@@ -155,6 +195,10 @@ static void on_read(grpc_exec_ctx *exec_ctx, void *user_data, int success) {
     return;
   }
 
+  reserve_staging_buffer(&ep->read_staging_buffer, remaining);
+  cur = GPR_SLICE_START_PTR(ep->read_staging_buffer);
+  end = GPR_SLICE_END_PTR(ep->read_staging_buffer);
+
   /* TODO(yangg) check error, maybe bail out early */
   for (i = 0; i < ep->source_buffer.count; i++) {
     gpr_slice encrypted = ep->source_buffer.slices[i];
@@ -176,10 +220,11 @@ static void on_read(grpc_exec_ctx *exec_ctx, void *user_data, int success) {
       }
       message_bytes += processed_message_size;
       message_size -= processed_message_size;
+      remaining -= processed_message_size;
       cur += unprotected_buffer_size_written;
 
       if (cur == end) {
-        flush_read_staging_buffer(ep, &cur, &end);
+        flush_read_staging_buffer(ep, &cur, &end, remaining);
         /* Force to enter the loop again to extract buffered bytes in protector.
            The bytes could be buffered because of running out of staging_buffer.
            If this happens at the end of all slices, doing another unprotect
@@ -201,6 +246,8 @@ static void on_read(grpc_exec_ctx *exec_ctx, void *user_data, int success) {
             &ep->read_staging_buffer,
             (size_t)(cur - GPR_SLICE_START_PTR(ep->read_staging_buffer))));
   }
+  release_staging_buffer(&ep->read_staging_buffer,
+                         staging_buffer_size(ep->source_buffer.length));
 
   /* TODO(yangg) experiment with moving this block after read_cb to see if it
      helps latency */
@@ -235,9 +282,9 @@ static void endpoint_read(grpc_exec_ctx *exec_ctx, grpc_endpoint *secure_ep,
 }
 
 static void flush_write_staging_buffer(secure_endpoint *ep, gpr_uint8 **cur,
-                                       gpr_uint8 **end) {
+                                       gpr_uint8 **end, size_t wanted) {
   gpr_slice_buffer_add(&ep->output_buffer, ep->write_staging_buffer);
-  ep->write_staging_buffer = gpr_slice_malloc(STAGING_BUFFER_SIZE);
+  ep->write_staging_buffer = gpr_slice_malloc(staging_buffer_size(wanted));
   *cur = GPR_SLICE_START_PTR(ep->write_staging_buffer);
   *end = GPR_SLICE_END_PTR(ep->write_staging_buffer);
 }
@@ -247,10 +294,16 @@ static void endpoint_write(grpc_exec_ctx *exec_ctx, grpc_endpoint *secure_ep,
   unsigned i;
   tsi_result result = TSI_OK;
   secure_endpoint *ep = (secure_endpoint *)secure_ep;
-  gpr_uint8 *cur = GPR_SLICE_START_PTR(ep->write_staging_buffer);
-  gpr_uint8 *end = GPR_SLICE_END_PTR(ep->write_staging_buffer);
+  /* Unprotected bytes not handed to the protector yet. */
+  size_t remaining = slices->length;
+  gpr_uint8 *cur;
+  gpr_uint8 *end;
 
   gpr_slice_buffer_reset_and_unref(&ep->output_buffer);
+  reserve_staging_buffer(&ep->write_staging_buffer,
+                         PROTECTED_SIZE_ESTIMATE(remaining));
+  cur = GPR_SLICE_START_PTR(ep->write_staging_buffer);
+  end = GPR_SLICE_END_PTR(ep->write_staging_buffer);
 
   if (grpc_trace_secure_endpoint) {
     for (i = 0; i < slices->count; i++) {
@@ -280,10 +333,12 @@ static void endpoint_write(grpc_exec_ctx *exec_ctx, grpc_endpoint *secure_ep,
       }
       message_bytes += processed_message_size;
       message_size -= processed_message_size;
+      remaining -= processed_message_size;
       cur += protected_buffer_size_to_send;
 
       if (cur == end) {
-        flush_write_staging_buffer(ep, &cur, &end);
+        flush_write_staging_buffer(ep, &cur, &end,
+                                   PROTECTED_SIZE_ESTIMATE(remaining));
       }
     }
     if (result != TSI_OK) break;
@@ -300,7 +355,7 @@ static void endpoint_write(grpc_exec_ctx *exec_ctx, grpc_endpoint *secure_ep,
       if (result != TSI_OK) break;
       cur += protected_buffer_size_to_send;
       if (cur == end) {
-        flush_write_staging_buffer(ep, &cur, &end);
+        flush_write_staging_buffer(ep, &cur, &end, still_pending_size);
       }
     } while (still_pending_size > 0);
     if (cur != GPR_SLICE_START_PTR(ep->write_staging_buffer)) {
@@ -311,6 +366,9 @@ static void endpoint_write(grpc_exec_ctx *exec_ctx, grpc_endpoint *secure_ep,
               (size_t)(cur - GPR_SLICE_START_PTR(ep->write_staging_buffer))));
     }
   }
+  release_staging_buffer(&ep->write_staging_buffer,
+                         staging_buffer_size(PROTECTED_SIZE_ESTIMATE(
+                             slices->length)));
 
   if (result != TSI_OK) {
     /* TODO(yangg) do different things according to the error type? */
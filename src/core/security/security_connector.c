@@ -579,6 +579,17 @@ size_t grpc_get_default_ssl_roots(const unsigned char **pem_root_certs) {
   return GPR_SLICE_LENGTH(default_pem_root_certs);
 }
 
+static tsi_result ssl_set_session_cache_options(
+    tsi_ssl_handshaker_factory *factory,
+    const grpc_ssl_session_cache_options *session_cache) {
+  tsi_ssl_session_cache_options options;
+  options.session_cache_size = session_cache->session_cache_size;
+  options.session_timeout_seconds = session_cache->session_timeout_seconds;
+  options.enable_session_tickets = session_cache->enable_session_tickets;
+  return tsi_ssl_handshaker_factory_set_session_cache_options(factory,
+                                                              &options);
+}
+
 grpc_security_status grpc_ssl_channel_security_connector_create(
     grpc_credentials *request_metadata_creds, const grpc_ssl_config *config,
     const char *target_name, const char *overridden_target_name,
@@ -640,6 +651,10 @@ grpc_security_status grpc_ssl_channel_security_connector_create(
       pem_root_certs_size, ssl_cipher_suites(), alpn_protocol_strings,
       alpn_protocol_string_lengths, (uint16_t)num_alpn_protocols,
       &c->handshaker_factory);
+  if (result == TSI_OK) {
+    result = ssl_set_session_cache_options(c->handshaker_factory,
+                                           &config->session_cache);
+  }
   if (result != TSI_OK) {
     gpr_log(GPR_ERROR, "Handshaker factory creation failed with %s.",
             tsi_result_to_string(result));
@@ -695,6 +710,10 @@ grpc_security_status grpc_ssl_server_security_connector_create(
       config->force_client_auth, ssl_cipher_suites(), alpn_protocol_strings,
       alpn_protocol_string_lengths, (uint16_t)num_alpn_protocols,
       &c->handshaker_factory);
+  if (result == TSI_OK) {
+    result = ssl_set_session_cache_options(c->handshaker_factory,
+                                           &config->session_cache);
+  }
   if (result != TSI_OK) {
     gpr_log(GPR_ERROR, "Handshaker factory creation failed with %s.",
             tsi_result_to_string(result));
@@ -181,6 +181,7 @@ typedef struct {
   size_t pem_cert_chain_size;
   unsigned char *pem_root_certs;
   size_t pem_root_certs_size;
+  grpc_ssl_session_cache_options session_cache;
 } grpc_ssl_config;
 
 /* Creates an SSL channel_security_connector.
@@ -214,6 +215,7 @@ typedef struct {
   unsigned char *pem_root_certs;
   size_t pem_root_certs_size;
   int force_client_auth;
+  grpc_ssl_session_cache_options session_cache;
 } grpc_ssl_server_config;
 
 /* Creates an SSL server_security_connector.
@@ -84,12 +84,26 @@
    with both writer_lock and reader_lock held. These locks are subsequently
    released by enable_access() to enable access to the block.
 
+   Per-thread mode (census_log_initialize_per_thread()):
+
+   Instead of sharing core-local blocks, each writing thread owns its current
+   block outright: it keeps the block's writer_lock for as long as it writes
+   to it, so census_log_start_write() and census_log_end_write() touch no
+   shared state beyond the block's bytes_committed. Free blocks are taken
+   from free_block_list up to CL_THREAD_BLOCK_BATCH at a time, so g_log.lock
+   is taken once per batch. A full block is pushed, without locking, onto
+   the handoff stack; the reader moves everything on the stack to the tail
+   of dirty_block_list in one go. Thread states live on g_log.threads, and
+   census_log_read_next() reads the current block of each after the dirty
+   list, just as it reads core_local_blocks[] otherwise.
+
    A note on naming: Most function/struct names are prepended by cl_
    (shorthand for census_log). Further, functions that manipulate structures
    include the name of the structure, which will be passed as the first
    argument. E.g. cl_block_initialize() will initialize a cl_block.
 */
 #include "src/core/statistics/census_log.h"
+#include <stdio.h>
 #include <string.h>
 #include <grpc/support/alloc.h>
 #include <grpc/support/atm.h>
@@ -97,6 +111,8 @@
 #include <grpc/support/log.h>
 #include <grpc/support/port_platform.h>
 #include <grpc/support/sync.h>
+#include <grpc/support/thd.h>
+#include <grpc/support/tls.h>
 #include <grpc/support/useful.h>
 
 /* End of platform specific code */
@@ -170,8 +186,28 @@ typedef struct census_log_core_local_block {
 #endif
 } cl_core_local_block;
 
+/* Most free blocks a thread takes from free_block_list at a time. */
+#define CL_THREAD_BLOCK_BATCH 4
+
+/* Per-thread mode: blocks owned by one writing thread. Allocated cacheline
+   aligned to avoid false sharing. */
+typedef struct census_log_thread_state {
+  /* Block being written, with writer_lock held; read by the reader. */
+  gpr_atm block;
+  /* Free blocks taken but not yet written to; access is disabled on them. */
+  cl_block *free_blocks[CL_THREAD_BLOCK_BATCH];
+  int num_free_blocks;
+  /* Links in g_log.threads; guarded by g_log.lock. */
+  struct census_log_thread_state *next;
+  struct census_log_thread_state *prev;
+} cl_thread_state;
+
 struct census_log {
   int discard_old_records;
+  /* Non-zero if initialized by census_log_initialize_per_thread(). */
+  int per_thread;
+  /* Distinguishes thread states created for this log from stale ones. */
+  gpr_intptr generation;
   /* Number of cores (aka hardware-contexts) */
   unsigned num_cores;
   /* number of CENSUS_LOG_2_MAX_RECORD_SIZE blocks in log */
@@ -193,11 +229,23 @@ struct census_log {
   cl_block_list free_block_list;
   cl_block_list dirty_block_list;
   gpr_atm out_of_space_count;
+  /* Per-thread mode: full blocks handed off by writers, newest first, linked
+     through link.next. Moved to dirty_block_list by cl_drain_handoff(). */
+  gpr_atm handoff;
+  /* Per-thread mode: writing threads, and the next one whose block
+     census_log_read_next() will read. */
+  cl_thread_state *threads;
+  cl_thread_state *thread_read_iterator;
 };
 
 /* Single internal log */
 static struct census_log g_log;
 
+/* Per-thread mode: the calling thread's state, valid iff the generation
+   matches g_log.generation. */
+GPR_TLS_DECL(g_thread_state);
+GPR_TLS_DECL(g_thread_state_generation);
+
 /* Functions that operate on an atomic memory location used as a lock */
 
 /* Returns non-zero if lock is acquired */
@@ -423,6 +471,153 @@ static cl_block *cl_get_block(void *record) {
   return &g_log.blocks[index];
 }
 
+/* Per-thread mode functions */
+
+/* Hands a block off to the reader. Lock free; may be called without
+   g_log.lock. */
+static void cl_handoff_push(cl_block *block) {
+  gpr_atm head;
+  do {
+    head = gpr_atm_acq_load(&g_log.handoff);
+    block->link.next = head == 0 ? NULL : &((cl_block *)head)->link;
+  } while (!gpr_atm_rel_cas(&g_log.handoff, head, (gpr_atm)block));
+}
+
+/* Moves all handed off blocks to the tail of dirty_block_list, oldest
+   first. Requires g_log.lock. */
+static void cl_drain_handoff(void) {
+  gpr_atm head;
+  cl_block *reversed = NULL;
+  do {
+    head = gpr_atm_acq_load(&g_log.handoff);
+  } while (head != 0 && !gpr_atm_acq_cas(&g_log.handoff, head, 0));
+  while (head != 0) {
+    cl_block *block = (cl_block *)head;
+    head = block->link.next == NULL ? 0 : (gpr_atm)block->link.next->block;
+    block->link.next = reversed == NULL ? NULL : &reversed->link;
+    reversed = block;
+  }
+  while (reversed != NULL) {
+    cl_block *block = reversed;
+    reversed = block->link.next == NULL ? NULL : block->link.next->block;
+    cl_block_list_insert_at_tail(&g_log.dirty_block_list, block);
+  }
+}
+
+/* Returns the calling thread's state, creating it on first use. */
+static cl_thread_state *cl_get_thread_state(void) {
+  cl_thread_state *ts = (cl_thread_state *)gpr_tls_get(&g_thread_state);
+  if (ts != NULL &&
+      gpr_tls_get(&g_thread_state_generation) == g_log.generation) {
+    return ts;
+  }
+  ts = (cl_thread_state *)gpr_malloc_aligned(sizeof(cl_thread_state),
+                                             GPR_CACHELINE_SIZE_LOG);
+  memset(ts, 0, sizeof(cl_thread_state));
+  gpr_mu_lock(&g_log.lock);
+  ts->next = g_log.threads;
+  if (ts->next != NULL) {
+    ts->next->prev = ts;
+  }
+  g_log.threads = ts;
+  gpr_mu_unlock(&g_log.lock);
+  gpr_tls_set(&g_thread_state, (gpr_intptr)ts);
+  gpr_tls_set(&g_thread_state_generation, g_log.generation);
+  return ts;
+}
+
+/* Gives up the thread's current block, if any, to the reader. */
+static void cl_thread_state_retire_block(cl_thread_state *ts) {
+  cl_block *block = (cl_block *)gpr_atm_no_barrier_load(&ts->block);
+  if (block != NULL) {
+    gpr_atm_rel_store(&ts->block, 0);
+    cl_unlock(&block->writer_lock);
+    cl_handoff_push(block);
+  }
+}
+
+/* Makes a free block the thread's current block, first taking a batch of
+   free blocks from the log if it has none. Returns NULL if out-of-space. */
+static cl_block *cl_thread_state_next_block(cl_thread_state *ts) {
+  cl_block *block;
+  if (ts->num_free_blocks == 0) {
+    int batch;
+    if (gpr_atm_acq_load(&g_log.is_full)) {
+      return NULL;
+    }
+    gpr_mu_lock(&g_log.lock);
+    cl_drain_handoff();
+    /* Leave some free blocks for the other threads. */
+    batch = GPR_MAX(1, GPR_MIN(CL_THREAD_BLOCK_BATCH,
+                               g_log.free_block_list.count /
+                                   (gpr_int32)g_log.num_cores));
+    while (ts->num_free_blocks < batch) {
+      block = cl_allocate_block();
+      if (block == NULL) {
+        break;
+      }
+      ts->free_blocks[ts->num_free_blocks++] = block;
+    }
+    if (ts->num_free_blocks == 0) {
+      gpr_atm_rel_store(&g_log.is_full, 1);
+    }
+    gpr_mu_unlock(&g_log.lock);
+    if (ts->num_free_blocks == 0) {
+      return NULL;
+    }
+  }
+  block = ts->free_blocks[--ts->num_free_blocks];
+  /* Let the reader in; the writer_lock stays with this thread. */
+  cl_unlock(&block->reader_lock);
+  gpr_atm_rel_store(&ts->block, (gpr_atm)block);
+  return block;
+}
+
+static void *cl_thread_start_write(size_t size) {
+  cl_thread_state *ts = cl_get_thread_state();
+  cl_block *block = (cl_block *)gpr_atm_no_barrier_load(&ts->block);
+  if (block != NULL) {
+    gpr_int32 bytes_committed = cl_block_get_bytes_committed(block);
+    if (bytes_committed + size <= CENSUS_LOG_MAX_RECORD_SIZE) {
+      return block->buffer + bytes_committed;
+    }
+    cl_thread_state_retire_block(ts);
+  }
+  block = cl_thread_state_next_block(ts);
+  if (block == NULL) {
+    gpr_atm_no_barrier_fetch_add(&g_log.out_of_space_count, 1);
+    return NULL;
+  }
+  return block->buffer;
+}
+
+/* Returns the thread's blocks to the log and frees its state. Requires
+   g_log.lock. */
+static void cl_thread_state_destroy(cl_thread_state *ts) {
+  cl_block *block = (cl_block *)gpr_atm_no_barrier_load(&ts->block);
+  if (block != NULL) {
+    cl_unlock(&block->writer_lock);
+    cl_block_list_insert_at_tail(&g_log.dirty_block_list, block);
+  }
+  while (ts->num_free_blocks > 0) {
+    cl_block_list_insert_at_head(&g_log.free_block_list,
+                                 ts->free_blocks[--ts->num_free_blocks]);
+    gpr_atm_rel_store(&g_log.is_full, 0);
+  }
+  if (g_log.thread_read_iterator == ts) {
+    g_log.thread_read_iterator = ts->next;
+  }
+  if (ts->prev != NULL) {
+    ts->prev->next = ts->next;
+  } else {
+    g_log.threads = ts->next;
+  }
+  if (ts->next != NULL) {
+    ts->next->prev = ts->prev;
+  }
+  gpr_free_aligned(ts);
+}
+
 /* Gets the next block to read and tries to free 'prev' block (if not NULL).
    Returns NULL if reached the end. */
 static cl_block *cl_next_block_to_read(cl_block *prev) {
@@ -445,7 +640,19 @@ static cl_block *cl_next_block_to_read(cl_block *prev) {
     if (block != NULL) {
       return block;
     }
-    /* We are done with the dirty list; moving on to core-local blocks. */
+    /* We are done with the dirty list; moving on to core-local blocks, or to
+       the threads' blocks in per-thread mode. */
+    if (g_log.per_thread) {
+      g_log.read_iterator_state = 0;
+    }
+  }
+  while (g_log.thread_read_iterator != NULL) {
+    cl_thread_state *ts = g_log.thread_read_iterator;
+    g_log.thread_read_iterator = ts->next;
+    block = (cl_block *)gpr_atm_acq_load(&ts->block);
+    if (block != NULL) {
+      return block;
+    }
   }
   while (g_log.read_iterator_state > 0) {
     g_log.read_iterator_state--;
@@ -459,7 +666,8 @@ static cl_block *cl_next_block_to_read(cl_block *prev) {
 }
 
 /* External functions: primary stats_log interface */
-void census_log_initialize(size_t size_in_mb, int discard_old_records) {
+static void cl_initialize(size_t size_in_mb, int discard_old_records,
+                          int per_thread) {
   gpr_int32 ix;
   /* Check cacheline alignment. */
   GPR_ASSERT(sizeof(cl_block) % GPR_CACHELINE_SIZE == 0);
@@ -493,11 +701,48 @@ void census_log_initialize(size_t size_in_mb, int discard_old_records) {
     cl_block_list_insert_at_tail(&g_log.free_block_list, block);
   }
   gpr_atm_rel_store(&g_log.out_of_space_count, 0);
+  g_log.per_thread = per_thread;
+  g_log.generation++;
+  gpr_atm_rel_store(&g_log.handoff, 0);
+  g_log.threads = NULL;
+  g_log.thread_read_iterator = NULL;
+  gpr_tls_init(&g_thread_state);
+  gpr_tls_init(&g_thread_state_generation);
   g_log.initialized = 1;
 }
 
+void census_log_initialize(size_t size_in_mb, int discard_old_records) {
+  cl_initialize(size_in_mb, discard_old_records, 0);
+}
+
+void census_log_initialize_per_thread(size_t size_in_mb,
+                                      int discard_old_records) {
+  cl_initialize(size_in_mb, discard_old_records, 1);
+}
+
+void census_log_end_thread(void) {
+  cl_thread_state *ts;
+  GPR_ASSERT(g_log.initialized);
+  ts = (cl_thread_state *)gpr_tls_get(&g_thread_state);
+  if (!g_log.per_thread || ts == NULL ||
+      gpr_tls_get(&g_thread_state_generation) != g_log.generation) {
+    return;
+  }
+  gpr_mu_lock(&g_log.lock);
+  cl_thread_state_destroy(ts);
+  gpr_mu_unlock(&g_log.lock);
+  gpr_tls_set(&g_thread_state, 0);
+}
+
 void census_log_shutdown(void) {
   GPR_ASSERT(g_log.initialized);
+  while (g_log.threads != NULL) {
+    cl_thread_state *ts = g_log.threads;
+    g_log.threads = ts->next;
+    gpr_free_aligned(ts);
+  }
+  gpr_tls_destroy(&g_thread_state);
+  gpr_tls_destroy(&g_thread_state_generation);
   gpr_mu_destroy(&g_log.lock);
   gpr_free_aligned(g_log.core_local_blocks);
   g_log.core_local_blocks = NULL;
@@ -517,6 +762,9 @@ void *census_log_start_write(size_t size) {
   if (size > CENSUS_LOG_MAX_RECORD_SIZE) {
     return NULL;
   }
+  if (g_log.per_thread) {
+    return cl_thread_start_write(size);
+  }
   do {
     int allocated;
     void *record = NULL;
@@ -547,8 +795,16 @@ void *census_log_start_write(size_t size) {
 }
 
 void census_log_end_write(void *record, size_t bytes_written) {
+  cl_block *block;
   GPR_ASSERT(g_log.initialized);
-  cl_block_end_write(cl_get_block(record), bytes_written);
+  block = cl_get_block(record);
+  if (g_log.per_thread) {
+    /* The writing thread keeps the block's writer_lock. */
+    cl_block_set_bytes_committed(
+        block, cl_block_get_bytes_committed(block) + bytes_written);
+  } else {
+    cl_block_end_write(block, bytes_written);
+  }
 }
 
 void census_log_init_reader(void) {
@@ -560,6 +816,11 @@ void census_log_init_reader(void) {
     g_log.block_being_read = NULL;
   }
   g_log.read_iterator_state = g_log.num_cores;
+  g_log.thread_read_iterator = NULL;
+  if (g_log.per_thread) {
+    cl_drain_handoff();
+    g_log.thread_read_iterator = g_log.threads;
+  }
   gpr_mu_unlock(&g_log.lock);
 }
 
@@ -569,6 +830,9 @@ const void *census_log_read_next(size_t *bytes_available) {
   if (g_log.block_being_read != NULL) {
     cl_block_end_read(g_log.block_being_read);
   }
+  if (g_log.per_thread) {
+    cl_drain_handoff();
+  }
   do {
     g_log.block_being_read = cl_next_block_to_read(g_log.block_being_read);
     if (g_log.block_being_read != NULL) {
@@ -602,3 +866,75 @@ int census_log_out_of_space_count(void) {
   GPR_ASSERT(g_log.initialized);
   return gpr_atm_acq_load(&g_log.out_of_space_count);
 }
+
+/* Streaming export */
+
+struct census_log_exporter {
+  census_log_export_func func;
+  void *arg;
+  gpr_timespec interval;
+  gpr_mu mu;
+  gpr_cv cv;
+  int shutdown;
+  gpr_thd_id thd;
+};
+
+static void cl_export_available(census_log_exporter *exporter) {
+  const void *data;
+  size_t bytes_available;
+  census_log_init_reader();
+  while ((data = census_log_read_next(&bytes_available)) != NULL) {
+    exporter->func(exporter->arg, data, bytes_available);
+  }
+}
+
+static void cl_exporter_thread(void *arg) {
+  census_log_exporter *exporter = arg;
+  gpr_mu_lock(&exporter->mu);
+  while (!exporter->shutdown) {
+    gpr_cv_wait(&exporter->cv, &exporter->mu,
+                gpr_time_add(gpr_now(GPR_CLOCK_REALTIME), exporter->interval));
+    if (exporter->shutdown) {
+      break;
+    }
+    gpr_mu_unlock(&exporter->mu);
+    cl_export_available(exporter);
+    gpr_mu_lock(&exporter->mu);
+  }
+  gpr_mu_unlock(&exporter->mu);
+  /* Whatever was written before census_log_exporter_stop(). */
+  cl_export_available(exporter);
+}
+
+census_log_exporter *census_log_exporter_start(census_log_export_func func,
+                                               void *arg,
+                                               gpr_timespec interval) {
+  census_log_exporter *exporter = gpr_malloc(sizeof(census_log_exporter));
+  gpr_thd_options options = gpr_thd_options_default();
+  GPR_ASSERT(g_log.initialized);
+  exporter->func = func;
+  exporter->arg = arg;
+  exporter->interval = interval;
+  gpr_mu_init(&exporter->mu);
+  gpr_cv_init(&exporter->cv);
+  exporter->shutdown = 0;
+  gpr_thd_options_set_joinable(&options);
+  GPR_ASSERT(gpr_thd_new(&exporter->thd, cl_exporter_thread, exporter,
+                         &options));
+  return exporter;
+}
+
+void census_log_exporter_stop(census_log_exporter *exporter) {
+  gpr_mu_lock(&exporter->mu);
+  exporter->shutdown = 1;
+  gpr_cv_signal(&exporter->cv);
+  gpr_mu_unlock(&exporter->mu);
+  gpr_thd_join(exporter->thd);
+  gpr_cv_destroy(&exporter->cv);
+  gpr_mu_destroy(&exporter->mu);
+  gpr_free(exporter);
+}
+
+void census_log_export_to_file(void *file, const void *data, size_t size) {
+  GPR_ASSERT(fwrite(data, 1, size, (FILE *)file) == size);
+}
@@ -36,6 +36,8 @@
 
 #include <stddef.h>
 
+#include <grpc/support/time.h>
+
 /* Maximum record size, in bytes. */
 #define CENSUS_LOG_2_MAX_RECORD_SIZE 14 /* 2^14 = 16KB */
 #define CENSUS_LOG_MAX_RECORD_SIZE (1 << CENSUS_LOG_2_MAX_RECORD_SIZE)
@@ -49,6 +51,20 @@
 */
 void census_log_initialize(size_t size_in_mb, int discard_old_records);
 
+/* As census_log_initialize(), but each writing thread gets blocks of its own
+   rather than sharing per-core blocks, so writes need no atomic operations
+   and the shared lock is only taken to fetch a batch of free blocks. A
+   thread may have only one incomplete record at a time, and should call
+   census_log_end_thread() once it stops writing so its blocks can be
+   reused. */
+void census_log_initialize_per_thread(size_t size_in_mb,
+                                      int discard_old_records);
+
+/* In per-thread mode, returns the calling thread's blocks to the log; its
+   unread data stays readable. The thread must have no incomplete record.
+   Does nothing otherwise. */
+void census_log_end_thread(void);
+
 /* Shutdown the logging subsystem. Caller must ensure that:
    - no in progress or future call to any census_log functions
    - no incomplete records
@@ -88,4 +104,21 @@ size_t census_log_remaining_space(void);
    out-of-space. */
 int census_log_out_of_space_count(void);
 
+/* Streaming export: a thread that, every 'interval', reads everything
+   available in the log and passes it to 'func', without holding up writers.
+   It owns the reader while it runs: no census_log_init_reader() or
+   census_log_read_next() calls may be made until census_log_exporter_stop(),
+   which exports whatever is left before returning. */
+typedef struct census_log_exporter census_log_exporter;
+typedef void (*census_log_export_func)(void *arg, const void *data,
+                                       size_t size);
+
+census_log_exporter *census_log_exporter_start(census_log_export_func func,
+                                               void *arg,
+                                               gpr_timespec interval);
+void census_log_exporter_stop(census_log_exporter *exporter);
+
+/* A census_log_export_func that appends to 'file', a FILE*. */
+void census_log_export_to_file(void *file, const void *data, size_t size);
+
 #endif /* GRPC_INTERNAL_CORE_STATISTICS_CENSUS_LOG_H */
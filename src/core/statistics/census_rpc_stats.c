@@ -41,23 +41,71 @@
 #include "src/core/support/murmur_hash.h"
 #include "src/core/support/string.h"
 #include <grpc/support/alloc.h>
+#include <grpc/support/atm.h>
+#include <grpc/support/cpu.h>
 #include <grpc/support/log.h>
+#include <grpc/support/string_util.h>
 #include <grpc/support/sync.h>
+#include <grpc/support/useful.h>
 
 #define NUM_INTERVALS 3
 #define MINUTE_INTERVAL 0
 #define HOUR_INTERVAL 1
 #define TOTAL_INTERVAL 2
 
+#define CLIENT_STATS 0
+#define SERVER_STATS 1
+#define NUM_SIDES 2
+
 /* for easier typing */
 typedef census_per_method_rpc_stats per_method_stats;
 
+/* Stats recorded for one method on one shard and not yet folded into the
+   method's window stats. */
+typedef struct {
+  census_rpc_stats sum;
+  /* time of the first record in 'sum'; the whole sum is attributed to it */
+  gpr_timespec oldest;
+  int has_stats;
+} pending_stats;
+
+/* Recording goes to the shard of the current cpu, so concurrent RPCs rarely
+   contend on a shard's lock; pending stats are folded into the shared window
+   stats, under g_mu, lazily: at read time or once they get older than
+   pending_flush_interval. Each shard is allocated on its own cache line.
+   Shards are created by the first census_stats_store_init() and never freed,
+   so recorders can reach them without g_mu; shutdown empties each one under
+   its lock, which also waits out any recorder still holding it. */
+typedef struct {
+  gpr_mu mu;
+  /* indexed by method id; 'capacity' entries each */
+  pending_stats *pending[NUM_SIDES];
+  size_t capacity;
+} stats_shard;
+
+typedef struct {
+  char *name;
+  /* NULL until stats are first folded in for that side */
+  struct census_window_stats *window_stats[NUM_SIDES];
+} method_entry;
+
 /* Ensure mu is only initialized once. */
 static gpr_once g_stats_store_mu_init = GPR_ONCE_INIT;
-/* Guards two stats stores. */
+/* Guards the method registry and the window stats. */
 static gpr_mu g_mu;
-static census_ht *g_client_stats_store = NULL;
-static census_ht *g_server_stats_store = NULL;
+/* Maps method names to (id + 1); non-NULL iff the store is initialized. */
+static census_ht *g_method_ids = NULL;
+static method_entry *g_methods = NULL;
+static size_t g_methods_capacity = 0;
+/* Number of registered methods, readable without g_mu: recording with an id
+   at or above it, including any id once the store is shut down, is a noop. */
+static gpr_atm g_num_methods = 0;
+/* Set once, under g_mu, before the first method is registered. */
+static stats_shard **g_shards = NULL;
+static unsigned g_num_shards = 0;
+
+/* Half the width of a minute-interval bucket. */
+static const gpr_timespec pending_flush_interval = {1, 0, GPR_TIMESPAN};
 
 static void init_mutex(void) { gpr_mu_init(&g_mu); }
 
@@ -77,16 +125,11 @@ static gpr_uint64 simple_hash(const void *k) {
          gpr_murmur_hash3((const char *)k + len / 2, len - len / 2, 0);
 }
 
-static void delete_stats(void *stats) {
-  census_window_stats_destroy((struct census_window_stats *)stats);
-}
-
-static void delete_key(void *key) { gpr_free(key); }
-
+/* Keys are the names owned by g_methods, values are ids + 1. */
 static const census_ht_option ht_opt = {
     CENSUS_HT_POINTER /* key type */, 1999 /* n_of_buckets */,
     simple_hash /* hash function */,  cmp_str_keys /* key comparator */,
-    delete_stats /* data deleter */,  delete_key /* key deleter */
+    NULL /* data deleter */,          NULL /* key deleter */
 };
 
 static void init_rpc_stats(void *stats) {
@@ -111,7 +154,9 @@ static void stat_add(void *base, const void *addme) {
 }
 
 static gpr_timespec min_hour_total_intervals[3] = {
-    {60, 0}, {3600, 0}, {36000000, 0}};
+    {60, 0, GPR_TIMESPAN},
+    {3600, 0, GPR_TIMESPAN},
+    {36000000, 0, GPR_TIMESPAN}};
 
 static const census_window_stats_stat_info window_stats_settings = {
     sizeof(census_rpc_stats), init_rpc_stats, stat_add, stat_add_proportion};
@@ -137,97 +182,231 @@ void census_aggregated_rpc_stats_set_empty(census_aggregated_rpc_stats *data) {
   data->stats = NULL;
 }
 
-static void record_stats(census_ht *store, census_op_id op_id,
-                         const census_rpc_stats *stats) {
+/* Requires g_mu and a live store. */
+static int register_method_locked(const char *method) {
+  census_ht_key key;
+  void *found;
+  size_t id;
+  key.ptr = (void *)method;
+  found = census_ht_find(g_method_ids, key);
+  if (found != NULL) {
+    return (int)((gpr_intptr)found - 1);
+  }
+  id = (size_t)gpr_atm_no_barrier_load(&g_num_methods);
+  if (id == g_methods_capacity) {
+    g_methods_capacity = GPR_MAX(8, 2 * g_methods_capacity);
+    g_methods = gpr_realloc(g_methods,
+                            g_methods_capacity * sizeof(method_entry));
+  }
+  memset(&g_methods[id], 0, sizeof(method_entry));
+  g_methods[id].name = gpr_strdup(method);
+  key.ptr = g_methods[id].name;
+  census_ht_insert(g_method_ids, key, (void *)(gpr_intptr)(id + 1));
+  gpr_atm_rel_store(&g_num_methods, (gpr_atm)(id + 1));
+  return (int)id;
+}
+
+int census_register_rpc_method(const char *method) {
+  int id = -1;
+  if (method == NULL) {
+    return -1;
+  }
+  init_mutex_once();
   gpr_mu_lock(&g_mu);
-  if (store != NULL) {
-    census_trace_obj *trace = NULL;
-    census_internal_lock_trace_store();
-    trace = census_get_trace_obj_locked(op_id);
-    if (trace != NULL) {
-      const char *method_name = census_get_trace_method_name(trace);
-      struct census_window_stats *window_stats = NULL;
-      census_ht_key key;
-      key.ptr = (void *)method_name;
-      window_stats = census_ht_find(store, key);
-      census_internal_unlock_trace_store();
-      if (window_stats == NULL) {
-        window_stats = census_window_stats_create(3, min_hour_total_intervals,
-                                                  30, &window_stats_settings);
-        key.ptr = gpr_strdup(key.ptr);
-        census_ht_insert(store, key, (void *)window_stats);
-      }
-      census_window_stats_add(window_stats, gpr_now(GPR_CLOCK_REALTIME), stats);
-    } else {
-      census_internal_unlock_trace_store();
-    }
+  if (g_method_ids != NULL) {
+    id = register_method_locked(method);
   }
   gpr_mu_unlock(&g_mu);
+  return id;
+}
+
+/* Adds 'p' to the window stats of method 'id'. Requires g_mu. Ids left over
+   from before a shutdown may be out of range and are dropped. */
+static void fold_pending_locked(int side, size_t id, const pending_stats *p) {
+  method_entry *m;
+  if (id >= (size_t)gpr_atm_no_barrier_load(&g_num_methods)) {
+    return;
+  }
+  m = &g_methods[id];
+  if (m->window_stats[side] == NULL) {
+    m->window_stats[side] = census_window_stats_create(
+        NUM_INTERVALS, min_hour_total_intervals, 30, &window_stats_settings);
+  }
+  census_window_stats_add(m->window_stats[side], p->oldest, &p->sum);
+}
+
+static void record_stats_by_id(int side, int method_id,
+                               const census_rpc_stats *stats) {
+  size_t num_methods = (size_t)gpr_atm_acq_load(&g_num_methods);
+  size_t id = (size_t)method_id;
+  gpr_timespec now;
+  stats_shard *shard;
+  pending_stats *p;
+  pending_stats flush;
+  if (method_id < 0 || id >= num_methods) {
+    return;
+  }
+  now = gpr_now(GPR_CLOCK_REALTIME);
+  shard = g_shards[gpr_cpu_current_cpu() % g_num_shards];
+  gpr_mu_lock(&shard->mu);
+  /* The store may have been shut down since the check above; shutdown
+     empties this shard under its lock, so checking again here is enough. */
+  num_methods = (size_t)gpr_atm_acq_load(&g_num_methods);
+  if (id >= num_methods) {
+    gpr_mu_unlock(&shard->mu);
+    return;
+  }
+  if (id >= shard->capacity) {
+    size_t old_capacity = shard->capacity;
+    int i;
+    shard->capacity = GPR_MAX(num_methods, 2 * old_capacity);
+    for (i = 0; i < NUM_SIDES; i++) {
+      shard->pending[i] = gpr_realloc(shard->pending[i],
+                                      shard->capacity * sizeof(pending_stats));
+      memset(shard->pending[i] + old_capacity, 0,
+             (shard->capacity - old_capacity) * sizeof(pending_stats));
+    }
+  }
+  p = &shard->pending[side][id];
+  if (!p->has_stats) {
+    p->oldest = now;
+    p->has_stats = 1;
+  }
+  stat_add(&p->sum, stats);
+  flush.has_stats = 0;
+  if (gpr_time_cmp(gpr_time_sub(now, p->oldest), pending_flush_interval) >=
+      0) {
+    flush = *p;
+    memset(p, 0, sizeof(*p));
+  }
+  gpr_mu_unlock(&shard->mu);
+  if (flush.has_stats) {
+    gpr_mu_lock(&g_mu);
+    fold_pending_locked(side, id, &flush);
+    gpr_mu_unlock(&g_mu);
+  }
+}
+
+static void record_stats(int side, census_op_id op_id,
+                         const census_rpc_stats *stats) {
+  int id = -1;
+  census_trace_obj *trace = NULL;
+  census_internal_lock_trace_store();
+  trace = census_get_trace_obj_locked(op_id);
+  if (trace != NULL) {
+    id = census_get_trace_method_id(trace);
+  }
+  census_internal_unlock_trace_store();
+  record_stats_by_id(side, id, stats);
 }
 
 void census_record_rpc_client_stats(census_op_id op_id,
                                     const census_rpc_stats *stats) {
-  record_stats(g_client_stats_store, op_id, stats);
+  record_stats(CLIENT_STATS, op_id, stats);
 }
 
 void census_record_rpc_server_stats(census_op_id op_id,
                                     const census_rpc_stats *stats) {
-  record_stats(g_server_stats_store, op_id, stats);
+  record_stats(SERVER_STATS, op_id, stats);
+}
+
+void census_record_rpc_client_stats_by_id(int method_id,
+                                          const census_rpc_stats *stats) {
+  record_stats_by_id(CLIENT_STATS, method_id, stats);
+}
+
+void census_record_rpc_server_stats_by_id(int method_id,
+                                          const census_rpc_stats *stats) {
+  record_stats_by_id(SERVER_STATS, method_id, stats);
+}
+
+/* Folds every shard's pending stats into the window stats. Requires g_mu. */
+static void fold_all_pending_locked(void) {
+  unsigned i;
+  size_t id;
+  int side;
+  for (i = 0; i < g_num_shards; i++) {
+    stats_shard *shard = g_shards[i];
+    gpr_mu_lock(&shard->mu);
+    for (side = 0; side < NUM_SIDES; side++) {
+      for (id = 0; id < shard->capacity; id++) {
+        pending_stats *p = &shard->pending[side][id];
+        if (p->has_stats) {
+          fold_pending_locked(side, id, p);
+          memset(p, 0, sizeof(*p));
+        }
+      }
+    }
+    gpr_mu_unlock(&shard->mu);
+  }
 }
 
-/* Get stats from input stats store */
-static void get_stats(census_ht *store, census_aggregated_rpc_stats *data) {
+/* Get stats for one side of the store */
+static void get_stats(int side, census_aggregated_rpc_stats *data) {
   GPR_ASSERT(data != NULL);
   if (data->num_entries != 0) {
     census_aggregated_rpc_stats_set_empty(data);
   }
+  init_mutex_once();
   gpr_mu_lock(&g_mu);
-  if (store != NULL) {
-    size_t n;
-    unsigned i, j;
+  if (g_method_ids != NULL) {
+    size_t n = (size_t)gpr_atm_no_barrier_load(&g_num_methods);
+    size_t i;
+    int j;
     gpr_timespec now = gpr_now(GPR_CLOCK_REALTIME);
-    census_ht_kv *kv = census_ht_get_all_elements(store, &n);
-    if (kv != NULL) {
-      data->num_entries = n;
-      data->stats =
-          (per_method_stats *)gpr_malloc(sizeof(per_method_stats) * n);
-      for (i = 0; i < n; i++) {
-        census_window_stats_sums sums[NUM_INTERVALS];
-        for (j = 0; j < NUM_INTERVALS; j++) {
-          sums[j].statistic = (void *)census_rpc_stats_create_empty();
-        }
-        data->stats[i].method = gpr_strdup(kv[i].k.ptr);
-        census_window_stats_get_sums(kv[i].v, now, sums);
-        data->stats[i].minute_stats =
-            *(census_rpc_stats *)sums[MINUTE_INTERVAL].statistic;
-        data->stats[i].hour_stats =
-            *(census_rpc_stats *)sums[HOUR_INTERVAL].statistic;
-        data->stats[i].total_stats =
-            *(census_rpc_stats *)sums[TOTAL_INTERVAL].statistic;
-        for (j = 0; j < NUM_INTERVALS; j++) {
-          gpr_free(sums[j].statistic);
-        }
+    fold_all_pending_locked();
+    for (i = 0; i < n; i++) {
+      struct census_window_stats *window_stats =
+          g_methods[i].window_stats[side];
+      census_window_stats_sums sums[NUM_INTERVALS];
+      per_method_stats *out;
+      if (window_stats == NULL) continue;
+      if (data->stats == NULL) {
+        data->stats =
+            (per_method_stats *)gpr_malloc(sizeof(per_method_stats) * n);
+      }
+      out = &data->stats[data->num_entries++];
+      for (j = 0; j < NUM_INTERVALS; j++) {
+        sums[j].statistic = (void *)census_rpc_stats_create_empty();
+      }
+      out->method = gpr_strdup(g_methods[i].name);
+      census_window_stats_get_sums(window_stats, now, sums);
+      out->minute_stats =
+          *(census_rpc_stats *)sums[MINUTE_INTERVAL].statistic;
+      out->hour_stats = *(census_rpc_stats *)sums[HOUR_INTERVAL].statistic;
+      out->total_stats = *(census_rpc_stats *)sums[TOTAL_INTERVAL].statistic;
+      for (j = 0; j < NUM_INTERVALS; j++) {
+        gpr_free(sums[j].statistic);
       }
-      gpr_free(kv);
     }
   }
   gpr_mu_unlock(&g_mu);
 }
 
 void census_get_client_stats(census_aggregated_rpc_stats *data) {
-  get_stats(g_client_stats_store, data);
+  get_stats(CLIENT_STATS, data);
 }
 
 void census_get_server_stats(census_aggregated_rpc_stats *data) {
-  get_stats(g_server_stats_store, data);
+  get_stats(SERVER_STATS, data);
 }
 
 void census_stats_store_init(void) {
+  unsigned i;
   init_mutex_once();
   gpr_mu_lock(&g_mu);
-  if (g_client_stats_store == NULL && g_server_stats_store == NULL) {
-    g_client_stats_store = census_ht_create(&ht_opt);
-    g_server_stats_store = census_ht_create(&ht_opt);
+  if (g_method_ids == NULL) {
+    g_method_ids = census_ht_create(&ht_opt);
+    if (g_shards == NULL) {
+      g_num_shards = GPR_MAX(1, gpr_cpu_num_cores());
+      g_shards = gpr_malloc(g_num_shards * sizeof(stats_shard *));
+      for (i = 0; i < g_num_shards; i++) {
+        g_shards[i] = gpr_malloc_aligned(sizeof(stats_shard),
+                                         GPR_CACHELINE_SIZE_LOG);
+        memset(g_shards[i], 0, sizeof(stats_shard));
+        gpr_mu_init(&g_shards[i]->mu);
+      }
+    }
   } else {
     gpr_log(GPR_ERROR, "Census stats store already initialized.");
   }
@@ -235,19 +414,38 @@ void census_stats_store_init(void) {
 }
 
 void census_stats_store_shutdown(void) {
+  size_t i;
+  int side;
   init_mutex_once();
   gpr_mu_lock(&g_mu);
-  if (g_client_stats_store != NULL) {
-    census_ht_destroy(g_client_stats_store);
-    g_client_stats_store = NULL;
-  } else {
-    gpr_log(GPR_ERROR, "Census server stats store not initialized.");
-  }
-  if (g_server_stats_store != NULL) {
-    census_ht_destroy(g_server_stats_store);
-    g_server_stats_store = NULL;
+  if (g_method_ids != NULL) {
+    size_t n = (size_t)gpr_atm_no_barrier_load(&g_num_methods);
+    gpr_atm_rel_store(&g_num_methods, 0);
+    for (i = 0; i < g_num_shards; i++) {
+      stats_shard *shard = g_shards[i];
+      gpr_mu_lock(&shard->mu);
+      for (side = 0; side < NUM_SIDES; side++) {
+        gpr_free(shard->pending[side]);
+        shard->pending[side] = NULL;
+      }
+      shard->capacity = 0;
+      gpr_mu_unlock(&shard->mu);
+    }
+    for (i = 0; i < n; i++) {
+      for (side = 0; side < NUM_SIDES; side++) {
+        if (g_methods[i].window_stats[side] != NULL) {
+          census_window_stats_destroy(g_methods[i].window_stats[side]);
+        }
+      }
+      gpr_free(g_methods[i].name);
+    }
+    gpr_free(g_methods);
+    g_methods = NULL;
+    g_methods_capacity = 0;
+    census_ht_destroy(g_method_ids);
+    g_method_ids = NULL;
   } else {
-    gpr_log(GPR_ERROR, "Census client stats store not initialized.");
+    gpr_log(GPR_ERROR, "Census stats store not initialized.");
   }
   gpr_mu_unlock(&g_mu);
 }
@@ -70,7 +70,15 @@ typedef struct census_aggregated_rpc_stats {
 /* Initializes an aggregated rpc stats object to an empty state. */
 void census_aggregated_rpc_stats_set_empty(census_aggregated_rpc_stats *data);
 
-/* Records client side stats of a rpc. */
+/* Registers 'method' with the stats store and returns its id, for use with
+   census_record_rpc_*_stats_by_id(). Registering a name again returns the
+   same id. Ids are valid until census_stats_store_shutdown(); returns -1 if
+   the store is not initialized. */
+int census_register_rpc_method(const char *method);
+
+/* Records client side stats of a rpc. The op's method is resolved to its id
+   by census_add_method_tag(), so ops tagged while the store is not
+   initialized are not recorded. */
 void census_record_rpc_client_stats(census_op_id op_id,
                                     const census_rpc_stats *stats);
 
@@ -78,6 +86,15 @@ void census_record_rpc_client_stats(census_op_id op_id,
 void census_record_rpc_server_stats(census_op_id op_id,
                                     const census_rpc_stats *stats);
 
+/* As above, but for a method id from census_register_rpc_method(). These
+   skip the trace store and method name lookup and record to a per-cpu
+   shard, so they rarely contend; prefer them on hot paths. Unknown ids are
+   ignored. */
+void census_record_rpc_client_stats_by_id(int method_id,
+                                          const census_rpc_stats *stats);
+void census_record_rpc_server_stats_by_id(int method_id,
+                                          const census_rpc_stats *stats);
+
 /* The following two functions are intended for inprocess query of
    per-service per-method stats from grpc implementations. */
 
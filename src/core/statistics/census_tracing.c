@@ -32,6 +32,7 @@
  */
 
 #include "src/core/statistics/census_interface.h"
+#include "src/core/statistics/census_rpc_stats.h"
 #include "src/core/statistics/census_tracing.h"
 
 #include <stdio.h>
@@ -42,6 +43,7 @@
 #include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
 #include <grpc/support/port_platform.h>
+#include <grpc/support/string_util.h>
 #include <grpc/support/sync.h>
 
 void census_trace_obj_destroy(census_trace_obj *obj) {
@@ -97,6 +99,7 @@ census_op_id census_tracing_start_op(void) {
     g_id++;
     memcpy(&ret->id, &g_id, sizeof(census_op_id));
     ret->rpc_stats.cnt = 1;
+    ret->method_id = -1;
     ret->ts = gpr_now(GPR_CLOCK_REALTIME);
     census_ht_insert(g_trace_store, op_id_as_key(&ret->id), (void *)ret);
     gpr_log(GPR_DEBUG, "Start tracing for id %lu", g_id);
@@ -108,12 +111,16 @@ census_op_id census_tracing_start_op(void) {
 int census_add_method_tag(census_op_id op_id, const char *method) {
   int ret = 0;
   census_trace_obj *trace = NULL;
+  /* Resolved here, once per op, so recording the op's stats never has to
+     take the stats store lock. */
+  int method_id = census_register_rpc_method(method);
   gpr_mu_lock(&g_mu);
   trace = census_ht_find(g_trace_store, op_id_as_key(&op_id));
   if (trace == NULL) {
     ret = 1;
   } else {
     trace->method = gpr_strdup(method);
+    trace->method_id = method_id;
   }
   gpr_mu_unlock(&g_mu);
   return ret;
@@ -196,6 +203,10 @@ const char *census_get_trace_method_name(const census_trace_obj *trace) {
   return trace->method;
 }
 
+int census_get_trace_method_id(const census_trace_obj *trace) {
+  return trace->method_id;
+}
+
 static census_trace_annotation *dup_annotation_chain(
     census_trace_annotation *from) {
   census_trace_annotation *ret = NULL;
@@ -216,6 +227,7 @@ static census_trace_obj *trace_obj_dup(census_trace_obj *from) {
   to->ts = from->ts;
   to->rpc_stats = from->rpc_stats;
   to->method = gpr_strdup(from->method);
+  to->method_id = from->method_id;
   to->annotations = dup_annotation_chain(from->annotations);
   return to;
 }
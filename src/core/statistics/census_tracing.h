@@ -58,6 +58,8 @@ typedef struct census_trace_obj {
   gpr_timespec ts;
   census_rpc_stats rpc_stats;
   char *method;
+  /* id of 'method' in the rpc stats store, or -1 */
+  int method_id;
   census_trace_annotation *annotations;
 } census_trace_obj;
 
@@ -83,6 +85,10 @@ void census_internal_unlock_trace_store(void);
 /* Gets method name associated with the input trace object. */
 const char *census_get_trace_method_name(const census_trace_obj *trace);
 
+/* Gets the rpc stats store id of the trace object's method, or -1 if it has
+   none. */
+int census_get_trace_method_id(const census_trace_obj *trace);
+
 /* Returns an array of pointers to trace objects of currently active operations
    and fills in number of active operations. Returns NULL if there are no active
    operations.
@@ -0,0 +1,345 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <grpc/support/hdr_histogram.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/atm.h>
+#include <grpc/support/log.h>
+#include <grpc/support/useful.h>
+
+/* The layout follows HdrHistogram: the value range is split into
+   bucket_count power-of-two buckets, and each bucket into sub_bucket_count
+   linear sub-buckets, where sub_bucket_count is the smallest power of two
+   that resolves 2 * 10**significant_digits distinct values. Bucket 0 covers
+   [0, sub_bucket_count) at unit resolution; bucket b >= 1 covers
+   [sub_bucket_count << (b - 1), sub_bucket_count << b) with each sub-bucket
+   2**b wide. The lower half of every bucket above 0 overlaps the bucket
+   below it, so only the upper half is stored, giving
+   (bucket_count + 1) * sub_bucket_count / 2 counters in total. */
+
+struct gpr_hdr_histogram {
+  gpr_int64 highest_trackable_value;
+  int significant_digits;
+  /* log2(sub_bucket_count / 2) */
+  int sub_bucket_half_count_magnitude;
+  gpr_int64 sub_bucket_count;
+  gpr_int64 sub_bucket_half_count;
+  /* values with no bits set outside this mask land in bucket 0 */
+  gpr_int64 sub_bucket_mask;
+  int bucket_count;
+  size_t counts_len;
+  /* one counter per sub-bucket, updated with atomic increments only */
+  gpr_atm *counts;
+};
+
+static int count_leading_zeros(gpr_uint64 x) {
+#if defined(__GNUC__)
+  return x == 0 ? 64 : __builtin_clzll(x);
+#else
+  int n = 0;
+  if (x == 0) return 64;
+  while (!(x & ((gpr_uint64)1 << 63))) {
+    x <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+static int bucket_index_for(const gpr_hdr_histogram *h, gpr_int64 value) {
+  int pow2_ceiling =
+      64 - count_leading_zeros((gpr_uint64)(value | h->sub_bucket_mask));
+  return pow2_ceiling - (h->sub_bucket_half_count_magnitude + 1);
+}
+
+static size_t counts_index_for(const gpr_hdr_histogram *h, gpr_int64 value) {
+  int bucket_index = bucket_index_for(h, value);
+  gpr_int64 sub_bucket_index = value >> bucket_index;
+  return (size_t)(((gpr_int64)(bucket_index + 1)
+                   << h->sub_bucket_half_count_magnitude) +
+                  (sub_bucket_index - h->sub_bucket_half_count));
+}
+
+void gpr_hdr_histogram_bucket_range(const gpr_hdr_histogram *h, size_t index,
+                                    gpr_int64 *lowest, gpr_int64 *highest) {
+  int bucket_index =
+      (int)(index >> h->sub_bucket_half_count_magnitude) - 1;
+  gpr_int64 sub_bucket_index =
+      (gpr_int64)(index & (size_t)(h->sub_bucket_half_count - 1)) +
+      h->sub_bucket_half_count;
+  if (bucket_index < 0) {
+    sub_bucket_index -= h->sub_bucket_half_count;
+    bucket_index = 0;
+  }
+  *lowest = sub_bucket_index << bucket_index;
+  *highest = *lowest + ((gpr_int64)1 << bucket_index) - 1;
+}
+
+gpr_hdr_histogram *gpr_hdr_histogram_create(gpr_int64 highest_trackable_value,
+                                            int significant_digits) {
+  gpr_hdr_histogram *h = gpr_malloc(sizeof(gpr_hdr_histogram));
+  gpr_int64 largest_single_unit_value = 2;
+  gpr_int64 smallest_untrackable_value;
+  int sub_bucket_count_magnitude = 0;
+  int i;
+
+  GPR_ASSERT(significant_digits >= 1 && significant_digits <= 5);
+  GPR_ASSERT(highest_trackable_value >= 2);
+
+  for (i = 0; i < significant_digits; i++) {
+    largest_single_unit_value *= 10;
+  }
+  while (((gpr_int64)1 << sub_bucket_count_magnitude) <
+         largest_single_unit_value) {
+    sub_bucket_count_magnitude++;
+  }
+
+  h->highest_trackable_value = highest_trackable_value;
+  h->significant_digits = significant_digits;
+  h->sub_bucket_half_count_magnitude = sub_bucket_count_magnitude - 1;
+  h->sub_bucket_count = (gpr_int64)1 << sub_bucket_count_magnitude;
+  h->sub_bucket_half_count = h->sub_bucket_count / 2;
+  h->sub_bucket_mask = h->sub_bucket_count - 1;
+
+  h->bucket_count = 1;
+  smallest_untrackable_value = h->sub_bucket_count;
+  while (smallest_untrackable_value <= highest_trackable_value) {
+    h->bucket_count++;
+    if (smallest_untrackable_value > GPR_INT64_MAX / 2) break;
+    smallest_untrackable_value <<= 1;
+  }
+  h->counts_len =
+      (size_t)((h->bucket_count + 1) * h->sub_bucket_half_count);
+  h->counts = gpr_malloc(sizeof(gpr_atm) * h->counts_len);
+  memset(h->counts, 0, sizeof(gpr_atm) * h->counts_len);
+  GPR_ASSERT(counts_index_for(h, highest_trackable_value) < h->counts_len);
+  return h;
+}
+
+void gpr_hdr_histogram_destroy(gpr_hdr_histogram *h) {
+  gpr_free(h->counts);
+  gpr_free(h);
+}
+
+void gpr_hdr_histogram_record_n(gpr_hdr_histogram *h, gpr_int64 value,
+                                gpr_int64 count) {
+  size_t index =
+      counts_index_for(h, GPR_CLAMP(value, 0, h->highest_trackable_value));
+  gpr_atm_no_barrier_fetch_add(&h->counts[index], (gpr_atm)count);
+}
+
+void gpr_hdr_histogram_record(gpr_hdr_histogram *h, gpr_int64 value) {
+  gpr_hdr_histogram_record_n(h, value, 1);
+}
+
+void gpr_hdr_histogram_record_corrected(gpr_hdr_histogram *h, gpr_int64 value,
+                                        gpr_int64 expected_interval) {
+  gpr_int64 missing;
+  gpr_hdr_histogram_record(h, value);
+  if (expected_interval <= 0) return;
+  for (missing = value - expected_interval; missing >= expected_interval;
+       missing -= expected_interval) {
+    gpr_hdr_histogram_record(h, missing);
+  }
+}
+
+static int same_layout(const gpr_hdr_histogram *a,
+                       const gpr_hdr_histogram *b) {
+  return a->highest_trackable_value == b->highest_trackable_value &&
+         a->significant_digits == b->significant_digits;
+}
+
+static gpr_int64 load_count(const gpr_hdr_histogram *h, size_t index) {
+  return (gpr_int64)gpr_atm_no_barrier_load(&h->counts[index]);
+}
+
+int gpr_hdr_histogram_merge(gpr_hdr_histogram *dst,
+                            const gpr_hdr_histogram *src) {
+  size_t i;
+  gpr_atm v;
+  if (!same_layout(dst, src)) return 0;
+  for (i = 0; i < src->counts_len; i++) {
+    v = gpr_atm_no_barrier_load(&src->counts[i]);
+    if (v != 0) gpr_atm_no_barrier_fetch_add(&dst->counts[i], v);
+  }
+  return 1;
+}
+
+int gpr_hdr_histogram_snapshot_and_reset(gpr_hdr_histogram *h,
+                                         gpr_hdr_histogram *dst) {
+  size_t i;
+  gpr_atm v;
+  if (!same_layout(h, dst)) return 0;
+  for (i = 0; i < h->counts_len; i++) {
+    /* subtract (rather than store zero) what we saw, so that increments
+       landing between the load and the subtraction stay in h */
+    v = gpr_atm_no_barrier_load(&h->counts[i]);
+    if (v != 0) {
+      gpr_atm_no_barrier_fetch_add(&h->counts[i], -v);
+      gpr_atm_no_barrier_fetch_add(&dst->counts[i], v);
+    }
+  }
+  return 1;
+}
+
+void gpr_hdr_histogram_reset(gpr_hdr_histogram *h) {
+  size_t i;
+  gpr_atm v;
+  for (i = 0; i < h->counts_len; i++) {
+    v = gpr_atm_no_barrier_load(&h->counts[i]);
+    if (v != 0) gpr_atm_no_barrier_fetch_add(&h->counts[i], -v);
+  }
+}
+
+gpr_int64 gpr_hdr_histogram_count(const gpr_hdr_histogram *h) {
+  gpr_int64 total = 0;
+  size_t i;
+  for (i = 0; i < h->counts_len; i++) {
+    total += load_count(h, i);
+  }
+  return total;
+}
+
+gpr_int64 gpr_hdr_histogram_min(const gpr_hdr_histogram *h) {
+  gpr_int64 lowest, highest;
+  size_t i;
+  for (i = 0; i < h->counts_len; i++) {
+    if (load_count(h, i) != 0) {
+      gpr_hdr_histogram_bucket_range(h, i, &lowest, &highest);
+      return lowest;
+    }
+  }
+  return 0;
+}
+
+gpr_int64 gpr_hdr_histogram_max(const gpr_hdr_histogram *h) {
+  gpr_int64 lowest, highest;
+  size_t i;
+  for (i = h->counts_len; i > 0; i--) {
+    if (load_count(h, i - 1) != 0) {
+      gpr_hdr_histogram_bucket_range(h, i - 1, &lowest, &highest);
+      return GPR_MIN(highest, h->highest_trackable_value);
+    }
+  }
+  return 0;
+}
+
+/* Each sub-bucket is represented by its midpoint when computing moments */
+static double bucket_midpoint(const gpr_hdr_histogram *h, size_t index) {
+  gpr_int64 lowest, highest;
+  gpr_hdr_histogram_bucket_range(h, index, &lowest, &highest);
+  return (double)lowest + (double)(highest - lowest) / 2.0;
+}
+
+double gpr_hdr_histogram_mean(const gpr_hdr_histogram *h) {
+  double sum = 0;
+  double count = 0;
+  gpr_int64 c;
+  size_t i;
+  for (i = 0; i < h->counts_len; i++) {
+    c = load_count(h, i);
+    if (c != 0) {
+      sum += (double)c * bucket_midpoint(h, i);
+      count += (double)c;
+    }
+  }
+  return count == 0 ? 0 : sum / count;
+}
+
+double gpr_hdr_histogram_stddev(const gpr_hdr_histogram *h) {
+  double mean = gpr_hdr_histogram_mean(h);
+  double sum_sq = 0;
+  double count = 0;
+  double dev;
+  gpr_int64 c;
+  size_t i;
+  for (i = 0; i < h->counts_len; i++) {
+    c = load_count(h, i);
+    if (c != 0) {
+      dev = bucket_midpoint(h, i) - mean;
+      sum_sq += (double)c * dev * dev;
+      count += (double)c;
+    }
+  }
+  return count == 0 ? 0 : sqrt(sum_sq / count);
+}
+
+gpr_int64 gpr_hdr_histogram_value_at_percentile(const gpr_hdr_histogram *h,
+                                                double percentile) {
+  gpr_int64 total = gpr_hdr_histogram_count(h);
+  gpr_int64 target;
+  gpr_int64 seen = 0;
+  gpr_int64 lowest, highest;
+  size_t i;
+
+  if (total == 0) return 0;
+  percentile = GPR_CLAMP(percentile, 0.0, 100.0);
+  target = (gpr_int64)ceil(percentile / 100.0 * (double)total);
+  target = GPR_CLAMP(target, 1, total);
+  for (i = 0; i < h->counts_len; i++) {
+    seen += load_count(h, i);
+    if (seen >= target) {
+      gpr_hdr_histogram_bucket_range(h, i, &lowest, &highest);
+      return GPR_MIN(highest, h->highest_trackable_value);
+    }
+  }
+  /* writers raced us and the total shrank under a concurrent reset */
+  return gpr_hdr_histogram_max(h);
+}
+
+size_t gpr_hdr_histogram_num_buckets(const gpr_hdr_histogram *h) {
+  return h->counts_len;
+}
+
+gpr_int64 gpr_hdr_histogram_count_at_index(const gpr_hdr_histogram *h,
+                                           size_t index) {
+  GPR_ASSERT(index < h->counts_len);
+  return load_count(h, index);
+}
+
+int gpr_hdr_histogram_merge_contents(gpr_hdr_histogram *h,
+                                     const gpr_uint32 *data,
+                                     size_t data_count) {
+  size_t i;
+  if (data_count != h->counts_len) return 0;
+  for (i = 0; i < data_count; i++) {
+    if (data[i] != 0) {
+      gpr_atm_no_barrier_fetch_add(&h->counts[i], (gpr_atm)data[i]);
+    }
+  }
+  return 1;
+}
@@ -0,0 +1,293 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <grpc/support/span_recorder.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/log.h>
+#include <grpc/support/sync.h>
+#include <grpc/support/time.h>
+#include <grpc/support/useful.h>
+
+#include "src/core/support/thread_rings.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_CYCLE_COUNTER 1
+static gpr_uint64 read_cycle_counter(void) {
+  gpr_uint32 lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((gpr_uint64)hi << 32) | lo;
+}
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+static gpr_uint64 read_cycle_counter(void) { return __rdtsc(); }
+#endif
+
+/* Spans in the ring of each thread, a power of 2. */
+#define RING_SIZE 2048
+/* Threads alive at once beyond this number do not record, which bounds the
+   memory used. */
+#define MAX_RINGS 256
+/* Period of the drainer. A thread recording more than RING_SIZE spans during
+   that period drops spans. */
+#define DRAIN_PERIOD_MS 10
+
+typedef struct {
+  gpr_uint64 start;
+  gpr_uint64 duration;
+  gpr_uint64 call_id;
+  gpr_uint32 probe;
+  gpr_uint32 thread;
+} span;
+
+static gpr_once g_once = GPR_ONCE_INIT;
+static gpr_atm g_enabled;
+
+/* Everything below is protected by g_mu, which also protects the rings. */
+static gpr_mu g_mu;
+static gpr_thread_rings *g_rings;
+static gpr_uint64 g_dropped;
+
+/* Probe names, the id of a probe is its index + 1. */
+static const char **g_probes;
+static size_t g_num_probes;
+static size_t g_probes_capacity;
+
+/* Circular log of the most recent spans. */
+static span *g_log;
+static size_t g_log_capacity;
+static size_t g_log_first;
+static size_t g_log_count;
+static gpr_uint64 g_overwritten;
+
+static int g_running;
+
+/* Span clock values and times at the last start, to convert between them. */
+static gpr_uint64 g_origin_ticks;
+static gpr_timespec g_origin_time;
+
+static gpr_uint64 span_clock(void) {
+#ifdef HAVE_CYCLE_COUNTER
+  return read_cycle_counter();
+#else
+  gpr_timespec now = gpr_now(GPR_CLOCK_MONOTONIC);
+  return (gpr_uint64)now.tv_sec * GPR_NS_PER_SEC + (gpr_uint64)now.tv_nsec;
+#endif
+}
+
+gpr_uint64 gpr_span_clock_now(void) {
+  return gpr_atm_no_barrier_load(&g_enabled) ? span_clock() : 0;
+}
+
+static void log_append_locked(const span *s) {
+  if (g_log_capacity == 0) {
+    g_overwritten++;
+  } else if (g_log_count == g_log_capacity) {
+    g_log[g_log_first] = *s;
+    g_log_first = (g_log_first + 1) % g_log_capacity;
+    g_overwritten++;
+  } else {
+    g_log[(g_log_first + g_log_count) % g_log_capacity] = *s;
+    g_log_count++;
+  }
+}
+
+static void drain_span(void *arg, gpr_uint32 thread, const void *entry) {
+  span s = *(const span *)entry;
+  s.thread = thread;
+  log_append_locked(&s);
+}
+
+static void count_dropped(void *arg, gpr_uint32 thread, gpr_uint64 dropped,
+                          gpr_uint64 total) {
+  g_dropped += dropped;
+}
+
+static void init(void) {
+  gpr_thread_rings_config config;
+  gpr_mu_init(&g_mu);
+  memset(&config, 0, sizeof(config));
+  config.entry_size = sizeof(span);
+  config.ring_size = RING_SIZE;
+  config.max_rings = MAX_RINGS;
+  config.mu = &g_mu;
+  config.on_entry = drain_span;
+  config.on_dropped = count_dropped;
+  g_rings = gpr_thread_rings_create(&config);
+}
+
+static gpr_atm intern_probe(const char *name) {
+  size_t i;
+  gpr_mu_lock(&g_mu);
+  for (i = 0; i < g_num_probes; i++) {
+    if (strcmp(g_probes[i], name) == 0) break;
+  }
+  if (i == g_num_probes) {
+    if (g_num_probes == g_probes_capacity) {
+      g_probes_capacity = GPR_MAX(16u, 2 * g_probes_capacity);
+      g_probes =
+          gpr_realloc((void *)g_probes, g_probes_capacity * sizeof(*g_probes));
+    }
+    g_probes[g_num_probes++] = name;
+  }
+  gpr_mu_unlock(&g_mu);
+  return (gpr_atm)(i + 1);
+}
+
+void gpr_span_record(gpr_atm *probe, const char *probe_name, gpr_uint64 start,
+                     gpr_uint64 end, gpr_uintptr call_id) {
+  gpr_thread_ring *r;
+  gpr_atm probe_id;
+  span *s;
+
+  if (!gpr_atm_acq_load(&g_enabled)) return;
+  /* The span began or ended while recording was off. */
+  if (start == 0 || end < start) return;
+  s = gpr_thread_rings_reserve(g_rings, &r);
+  if (s == NULL) return;
+  probe_id = gpr_atm_acq_load(probe);
+  if (probe_id == 0) {
+    probe_id = intern_probe(probe_name);
+    gpr_atm_rel_store(probe, probe_id);
+  }
+  s->start = start;
+  s->duration = end - start;
+  s->call_id = call_id;
+  s->probe = (gpr_uint32)probe_id;
+  gpr_thread_rings_commit(r);
+}
+
+void gpr_span_recorder_start(size_t max_spans) {
+  gpr_span_recorder_stop();
+  gpr_mu_lock(&g_mu);
+  gpr_free(g_log);
+  g_log = gpr_malloc(max_spans * sizeof(span));
+  g_log_capacity = max_spans;
+  g_log_first = 0;
+  g_log_count = 0;
+  g_overwritten = 0;
+  /* Forget the spans recorded after the previous recording was stopped. */
+  gpr_thread_rings_discard_locked(g_rings);
+  g_dropped = 0;
+  g_origin_time = gpr_now(GPR_CLOCK_MONOTONIC);
+  g_origin_ticks = span_clock();
+
+  g_running = 1;
+  gpr_thread_rings_start_drainer_locked(g_rings, DRAIN_PERIOD_MS);
+  gpr_atm_rel_store(&g_enabled, 1);
+  gpr_mu_unlock(&g_mu);
+}
+
+void gpr_span_recorder_stop(void) {
+  gpr_once_init(&g_once, init);
+  gpr_mu_lock(&g_mu);
+  if (!g_running) {
+    gpr_mu_unlock(&g_mu);
+    return;
+  }
+  gpr_atm_rel_store(&g_enabled, 0);
+  g_running = 0;
+  gpr_mu_unlock(&g_mu);
+  gpr_thread_rings_stop_drainer(g_rings);
+}
+
+/* Span clock ticks per microsecond. */
+static double ticks_per_us_locked(void) {
+#ifdef HAVE_CYCLE_COUNTER
+  gpr_uint64 ticks = span_clock() - g_origin_ticks;
+  gpr_timespec elapsed =
+      gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), g_origin_time);
+  double us = 1e6 * (double)elapsed.tv_sec + 1e-3 * elapsed.tv_nsec;
+  return us > 0 ? (double)ticks / us : 1.0;
+#else
+  return 1e3;
+#endif
+}
+
+static void write_json_string(FILE *f, const char *s) {
+  fputc('"', f);
+  for (; *s != '\0'; s++) {
+    if (*s == '"' || *s == '\\') {
+      fprintf(f, "\\%c", *s);
+    } else if ((unsigned char)*s < 0x20) {
+      fprintf(f, "\\u%04x", (unsigned)(unsigned char)*s);
+    } else {
+      fputc(*s, f);
+    }
+  }
+  fputc('"', f);
+}
+
+int gpr_span_recorder_export_chrome_trace(const char *filename) {
+  FILE *f;
+  size_t i;
+  double ticks_per_us;
+
+  gpr_once_init(&g_once, init);
+  f = fopen(filename, "w");
+  if (f == NULL) {
+    gpr_log(GPR_ERROR, "Could not open %s for writing.", filename);
+    return 0;
+  }
+  gpr_mu_lock(&g_mu);
+  gpr_thread_rings_drain_locked(g_rings);
+  ticks_per_us = ticks_per_us_locked();
+  fprintf(f, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_spans\":"
+             "\"%llu\",\"overwritten_spans\":\"%llu\"},\"traceEvents\":[",
+          (unsigned long long)g_dropped, (unsigned long long)g_overwritten);
+  for (i = 0; i < g_log_count; i++) {
+    const span *s = &g_log[(g_log_first + i) % g_log_capacity];
+    double ts = (double)(gpr_int64)(s->start - g_origin_ticks) / ticks_per_us;
+    fprintf(f, "%s\n{\"name\":", i == 0 ? "" : ",");
+    write_json_string(f, g_probes[s->probe - 1]);
+    fprintf(f, ",\"cat\":\"grpc\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,"
+               "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"call\":\"0x%llx\"}}",
+            (unsigned)s->thread, ts, (double)s->duration / ticks_per_us,
+            (unsigned long long)s->call_id);
+  }
+  fprintf(f, "\n]}\n");
+  g_log_first = 0;
+  g_log_count = 0;
+  g_overwritten = 0;
+  gpr_mu_unlock(&g_mu);
+  if (fclose(f) != 0) {
+    gpr_log(GPR_ERROR, "Error writing %s.", filename);
+    return 0;
+  }
+  return 1;
+}
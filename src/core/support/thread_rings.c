@@ -0,0 +1,327 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "src/core/support/thread_rings.h"
+
+#include <string.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/atm.h>
+#include <grpc/support/log.h>
+#include <grpc/support/thd.h>
+#include <grpc/support/time.h>
+#include <grpc/support/tls.h>
+
+#ifdef GPR_POSIX_SYNC
+#include <pthread.h>
+#endif
+
+struct gpr_thread_ring {
+  gpr_atm head; /* Number of entries written, by the thread only. */
+  gpr_atm tail; /* Number of entries read, by the drainer only. */
+  gpr_atm dropped;
+  /* Set when the thread exits, after which the ring is recycled. */
+  gpr_atm exited;
+  /* Everything below is protected by mu. */
+  gpr_uint64 reported_dropped;
+  gpr_uint32 thread;
+  /* Next ring of the active or the free list. */
+  gpr_thread_ring *next;
+  char *entries;
+};
+
+struct gpr_thread_rings {
+  gpr_thread_rings_config config;
+  /* Everything below is protected by mu, except no_ring_dropped. */
+  gpr_thread_ring *active;
+  gpr_thread_ring *free;
+  size_t num_rings;
+  gpr_uint32 num_threads;
+  /* Entries of the threads without a ring. */
+  gpr_atm no_ring_dropped;
+  gpr_uint64 no_ring_reported_dropped;
+
+  gpr_cv cv;
+  int drain_period_ms;
+  int drainer_running;
+  int drainer_stopping;
+  gpr_thd_id drainer;
+};
+
+/* The ring a thread has of a gpr_thread_rings, NULL if there was none left.
+   The slots of a thread are chained from g_thread_slots. */
+typedef struct thread_slot {
+  gpr_thread_rings *rings;
+  gpr_thread_ring *ring;
+  struct thread_slot *next;
+} thread_slot;
+
+static gpr_once g_once = GPR_ONCE_INIT;
+GPR_TLS_DECL(g_thread_slots);
+/* The slots of the threads that have exited: entries they reserve from
+   destructors that run after ours are dropped. */
+static thread_slot g_exited;
+
+/* Threads tell us that they exit through the destructor of a pthread key, or
+   the callback of a fiber local on Windows. Elsewhere rings are not
+   recycled. */
+#ifdef GPR_POSIX_SYNC
+static pthread_key_t g_exit_key;
+#elif defined(GPR_WIN32)
+static DWORD g_exit_key;
+#endif
+
+static void thread_exited(void *chain) {
+  thread_slot *slot = chain;
+  gpr_tls_set(&g_thread_slots, (gpr_intptr)&g_exited);
+  while (slot != NULL) {
+    thread_slot *next = slot->next;
+    /* The ring may be recycled as soon as this is stored. */
+    if (slot->ring != NULL) gpr_atm_rel_store(&slot->ring->exited, 1);
+    gpr_free(slot);
+    slot = next;
+  }
+}
+
+#ifdef GPR_WIN32
+static VOID WINAPI fiber_local_destroyed(PVOID chain) { thread_exited(chain); }
+#endif
+
+static void init(void) {
+  gpr_tls_init(&g_thread_slots);
+#ifdef GPR_POSIX_SYNC
+  GPR_ASSERT(0 == pthread_key_create(&g_exit_key, thread_exited));
+#elif defined(GPR_WIN32)
+  g_exit_key = FlsAlloc(fiber_local_destroyed);
+  GPR_ASSERT(g_exit_key != FLS_OUT_OF_INDEXES);
+#endif
+}
+
+static void set_thread_slots(thread_slot *slots) {
+  gpr_tls_set(&g_thread_slots, (gpr_intptr)slots);
+#ifdef GPR_POSIX_SYNC
+  GPR_ASSERT(0 == pthread_setspecific(g_exit_key, slots));
+#elif defined(GPR_WIN32)
+  GPR_ASSERT(FlsSetValue(g_exit_key, slots));
+#endif
+}
+
+gpr_thread_rings *gpr_thread_rings_create(
+    const gpr_thread_rings_config *config) {
+  gpr_thread_rings *rings = gpr_malloc(sizeof(gpr_thread_rings));
+  GPR_ASSERT(config->ring_size > 0 &&
+             (config->ring_size & (config->ring_size - 1)) == 0);
+  gpr_once_init(&g_once, init);
+  memset(rings, 0, sizeof(gpr_thread_rings));
+  rings->config = *config;
+  gpr_cv_init(&rings->cv);
+  return rings;
+}
+
+static void report_dropped_locked(gpr_thread_rings *rings, gpr_uint32 thread,
+                                  gpr_atm *dropped,
+                                  gpr_uint64 *reported_dropped) {
+  gpr_uint64 total = (gpr_uint64)gpr_atm_no_barrier_load(dropped);
+  if (total != *reported_dropped) {
+    rings->config.on_dropped(rings->config.arg, thread,
+                             total - *reported_dropped, total);
+    *reported_dropped = total;
+  }
+}
+
+static void drain_ring_locked(gpr_thread_rings *rings, gpr_thread_ring *r) {
+  const gpr_thread_rings_config *config = &rings->config;
+  gpr_atm tail = gpr_atm_no_barrier_load(&r->tail);
+  gpr_atm head = gpr_atm_acq_load(&r->head);
+  for (; tail != head; tail++) {
+    config->on_entry(
+        config->arg, r->thread,
+        r->entries + (size_t)(tail & (gpr_atm)(config->ring_size - 1)) *
+                         config->entry_size);
+  }
+  gpr_atm_rel_store(&r->tail, tail);
+  report_dropped_locked(rings, r->thread, &r->dropped, &r->reported_dropped);
+}
+
+/* Drains the rings, only those of the threads that have exited if
+   exited_only, and moves the latter to the free list. */
+static void drain_rings_locked(gpr_thread_rings *rings, int exited_only) {
+  gpr_thread_ring **link = &rings->active;
+  while (*link != NULL) {
+    gpr_thread_ring *r = *link;
+    /* Loaded before draining: once the thread has exited, this drain gets
+       all that is left. */
+    int exited = (int)gpr_atm_acq_load(&r->exited);
+    if (exited || !exited_only) drain_ring_locked(rings, r);
+    if (exited) {
+      *link = r->next;
+      r->next = rings->free;
+      rings->free = r;
+    } else {
+      link = &r->next;
+    }
+  }
+}
+
+void gpr_thread_rings_drain_locked(gpr_thread_rings *rings) {
+  drain_rings_locked(rings, 0);
+  report_dropped_locked(rings, 0, &rings->no_ring_dropped,
+                        &rings->no_ring_reported_dropped);
+  if (rings->config.on_drained != NULL) {
+    rings->config.on_drained(rings->config.arg);
+  }
+}
+
+static gpr_thread_ring *acquire_ring(gpr_thread_rings *rings) {
+  gpr_thread_ring *r;
+  gpr_mu_lock(rings->config.mu);
+  if (rings->free == NULL && rings->num_rings == rings->config.max_rings) {
+    /* Rather than wait for the drainer to recycle them */
+    drain_rings_locked(rings, 1);
+  }
+  r = rings->free;
+  if (r != NULL) {
+    rings->free = r->next;
+  } else if (rings->num_rings < rings->config.max_rings) {
+    r = gpr_malloc(sizeof(gpr_thread_ring));
+    r->entries = gpr_malloc(rings->config.ring_size * rings->config.entry_size);
+    rings->num_rings++;
+  }
+  if (r != NULL) {
+    gpr_atm_no_barrier_store(&r->head, 0);
+    gpr_atm_no_barrier_store(&r->tail, 0);
+    gpr_atm_no_barrier_store(&r->dropped, 0);
+    gpr_atm_no_barrier_store(&r->exited, 0);
+    r->reported_dropped = 0;
+    r->thread = ++rings->num_threads;
+    r->next = rings->active;
+    rings->active = r;
+  }
+  gpr_mu_unlock(rings->config.mu);
+  return r;
+}
+
+static gpr_thread_ring *thread_ring_slow(gpr_thread_rings *rings,
+                                         thread_slot *slots) {
+  thread_slot *slot;
+  if (slots == &g_exited) return NULL;
+  for (slot = slots; slot != NULL; slot = slot->next) {
+    if (slot->rings == rings) return slot->ring;
+  }
+  slot = gpr_malloc(sizeof(thread_slot));
+  slot->rings = rings;
+  slot->ring = acquire_ring(rings);
+  slot->next = slots;
+  set_thread_slots(slot);
+  return slot->ring;
+}
+
+void *gpr_thread_rings_reserve(gpr_thread_rings *rings,
+                               gpr_thread_ring **ring) {
+  thread_slot *slots = (thread_slot *)gpr_tls_get(&g_thread_slots);
+  gpr_thread_ring *r;
+  gpr_atm head;
+
+  if (slots != NULL && slots->rings == rings) {
+    r = slots->ring;
+  } else {
+    r = thread_ring_slow(rings, slots);
+  }
+  if (r == NULL) {
+    gpr_atm_no_barrier_fetch_add(&rings->no_ring_dropped, 1);
+    return NULL;
+  }
+  head = gpr_atm_no_barrier_load(&r->head);
+  if (head - gpr_atm_acq_load(&r->tail) == (gpr_atm)rings->config.ring_size) {
+    gpr_atm_no_barrier_fetch_add(&r->dropped, 1);
+    return NULL;
+  }
+  *ring = r;
+  return r->entries + (size_t)(head & (gpr_atm)(rings->config.ring_size - 1)) *
+                          rings->config.entry_size;
+}
+
+void gpr_thread_rings_commit(gpr_thread_ring *ring) {
+  gpr_atm_rel_store(&ring->head, gpr_atm_no_barrier_load(&ring->head) + 1);
+}
+
+void gpr_thread_rings_discard_locked(gpr_thread_rings *rings) {
+  gpr_thread_ring *r;
+  for (r = rings->active; r != NULL; r = r->next) {
+    gpr_atm_rel_store(&r->tail, gpr_atm_acq_load(&r->head));
+    gpr_atm_no_barrier_store(&r->dropped, 0);
+    r->reported_dropped = 0;
+  }
+  gpr_atm_no_barrier_store(&rings->no_ring_dropped, 0);
+  rings->no_ring_reported_dropped = 0;
+}
+
+static void drainer(void *arg) {
+  gpr_thread_rings *rings = arg;
+  gpr_timespec period =
+      gpr_time_from_millis(rings->drain_period_ms, GPR_TIMESPAN);
+  gpr_mu_lock(rings->config.mu);
+  while (!rings->drainer_stopping) {
+    gpr_thread_rings_drain_locked(rings);
+    gpr_cv_wait(&rings->cv, rings->config.mu,
+                gpr_time_add(gpr_now(GPR_CLOCK_REALTIME), period));
+  }
+  gpr_thread_rings_drain_locked(rings);
+  gpr_mu_unlock(rings->config.mu);
+}
+
+void gpr_thread_rings_start_drainer_locked(gpr_thread_rings *rings,
+                                           int period_ms) {
+  gpr_thd_options options = gpr_thd_options_default();
+  GPR_ASSERT(!rings->drainer_running);
+  rings->drain_period_ms = period_ms;
+  rings->drainer_running = 1;
+  rings->drainer_stopping = 0;
+  gpr_thd_options_set_joinable(&options);
+  GPR_ASSERT(gpr_thd_new(&rings->drainer, drainer, rings, &options));
+}
+
+void gpr_thread_rings_stop_drainer(gpr_thread_rings *rings) {
+  gpr_thd_id drainer_id;
+  gpr_mu_lock(rings->config.mu);
+  if (!rings->drainer_running) {
+    gpr_mu_unlock(rings->config.mu);
+    return;
+  }
+  rings->drainer_running = 0;
+  rings->drainer_stopping = 1;
+  drainer_id = rings->drainer;
+  gpr_cv_signal(&rings->cv);
+  gpr_mu_unlock(rings->config.mu);
+  gpr_thd_join(drainer_id);
+}
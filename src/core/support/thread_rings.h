@@ -0,0 +1,101 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef GRPC_INTERNAL_CORE_SUPPORT_THREAD_RINGS_H
+#define GRPC_INTERNAL_CORE_SUPPORT_THREAD_RINGS_H
+
+#include <stddef.h>
+
+#include <grpc/support/port_platform.h>
+#include <grpc/support/sync.h>
+
+/* Per-thread rings: each thread appends fixed size entries to a ring of its
+   own without locking, and a drainer hands them over in batches, so that
+   recording never blocks. Entries are dropped, and counted, when the ring of
+   their thread is full.
+
+   A thread gets a ring the first time it reserves an entry. When it exits,
+   its ring goes back to a free list once its last entries have been drained,
+   so only the threads alive at once count towards max_rings. Threads that
+   come when max_rings rings are taken do not record. */
+
+typedef struct gpr_thread_rings gpr_thread_rings;
+typedef struct gpr_thread_ring gpr_thread_ring;
+
+typedef struct {
+  /* Size of an entry */
+  size_t entry_size;
+  /* Entries in a ring, a power of 2 */
+  size_t ring_size;
+  /* Rings in use at once */
+  size_t max_rings;
+  /* Protects the rings. The callbacks below are called with it held, so it
+     can protect what they write to as well. */
+  gpr_mu *mu;
+  /* Called for each entry drained, in the order each thread reserved them.
+     'thread' numbers the threads in the order they got a ring, from 1. */
+  void (*on_entry)(void *arg, gpr_uint32 thread, const void *entry);
+  /* Called when 'thread' dropped 'dropped' more entries, 'total' since the
+     thread got its ring. Thread 0 stands for the threads without a ring. */
+  void (*on_dropped)(void *arg, gpr_uint32 thread, gpr_uint64 dropped,
+                     gpr_uint64 total);
+  /* Called after each drain, or NULL */
+  void (*on_drained)(void *arg);
+  void *arg;
+} gpr_thread_rings_config;
+
+/* Rings are never destroyed, since threads may still hold theirs. */
+gpr_thread_rings *gpr_thread_rings_create(
+    const gpr_thread_rings_config *config);
+
+/* Returns where to write the next entry of the calling thread, or NULL if the
+   entry is dropped. Publish it with gpr_thread_rings_commit(*ring). */
+void *gpr_thread_rings_reserve(gpr_thread_rings *rings, gpr_thread_ring **ring);
+void gpr_thread_rings_commit(gpr_thread_ring *ring);
+
+/* Drains all the rings. Called with mu held. */
+void gpr_thread_rings_drain_locked(gpr_thread_rings *rings);
+
+/* Discards the entries not drained yet and resets the counts of dropped
+   entries. Called with mu held. */
+void gpr_thread_rings_discard_locked(gpr_thread_rings *rings);
+
+/* Starts a thread draining the rings every period_ms. Called with mu held. */
+void gpr_thread_rings_start_drainer_locked(gpr_thread_rings *rings,
+                                           int period_ms);
+
+/* Stops the drainer thread after a last drain, if it is running. Called
+   without mu held. */
+void gpr_thread_rings_stop_drainer(gpr_thread_rings *rings);
+
+#endif /* GRPC_INTERNAL_CORE_SUPPORT_THREAD_RINGS_H */
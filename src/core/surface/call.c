@@ -38,6 +38,7 @@
 #include <grpc/compression.h>
 #include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
+#include <grpc/support/span_recorder.h>
 #include <grpc/support/string_util.h>
 #include <grpc/support/useful.h>
 
@@ -49,7 +50,6 @@
 #include "src/core/surface/call.h"
 #include "src/core/surface/channel.h"
 #include "src/core/surface/completion_queue.h"
- #include "grpc/support/grpc_profiler_c.h"
 #include <string.h>
 
 
@@ -77,6 +77,11 @@ typedef struct {
 
 #define MAX_SEND_INITIAL_METADATA_COUNT 3
 
+/* Messages written with GRPC_WRITE_BUFFER_HINT are completed as soon as
+   they're copied to the call, until this many bytes are waiting for a write
+   without the hint (or a close) to take them to the transport. */
+#define MAX_BUFFERED_SEND_BYTES 65536
+
 typedef struct {
   /* Overall status of the operation: starts OK, may degrade to
      non-OK */
@@ -253,6 +258,10 @@ struct grpc_call {
 
   grpc_stream_op_buffer send_ops;
   grpc_stream_op_buffer recv_ops;
+  /* messages sent with GRPC_WRITE_BUFFER_HINT, already completed but not yet
+     passed to the transport, and the number of bytes of message in them */
+  grpc_stream_op_buffer buffered_send_ops;
+  size_t buffered_send_bytes;
   grpc_stream_state recv_state;
 
   gpr_slice_buffer incoming_message;
@@ -285,6 +294,7 @@ static void set_deadline_alarm(grpc_exec_ctx *exec_ctx, grpc_call *call,
 static void call_on_done_recv(grpc_exec_ctx *exec_ctx, void *call, int success);
 static void call_on_done_send(grpc_exec_ctx *exec_ctx, void *call, int success);
 static int fill_send_ops(grpc_call *call, grpc_transport_stream_op *op);
+static void buffer_send_message(grpc_call *call);
 static void execute_op(grpc_exec_ctx *exec_ctx, grpc_call *call,
                        grpc_transport_stream_op *op);
 static void recv_metadata(grpc_exec_ctx *exec_ctx, grpc_call *call,
@@ -309,8 +319,8 @@ grpc_call *grpc_call_create(grpc_channel *channel, grpc_call *parent_call,
   grpc_transport_stream_op *initial_op_ptr = NULL;
   grpc_channel_stack *channel_stack = grpc_channel_get_channel_stack(channel);
   grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
-  grpc_call *call =
-      gpr_malloc(sizeof(grpc_call) + channel_stack->call_stack_size);
+  grpc_call *call = grpc_channel_alloc_call(
+      channel, sizeof(grpc_call) + channel_stack->call_stack_size);
   memset(call, 0, sizeof(grpc_call));
   gpr_mu_init(&call->mu);
   gpr_mu_init(&call->completion_mu);
@@ -338,6 +348,7 @@ grpc_call *grpc_call_create(grpc_channel *channel, grpc_call *parent_call,
   call->metadata_context = grpc_channel_get_metadata_context(channel);
   grpc_sopb_init(&call->send_ops);
   grpc_sopb_init(&call->recv_ops);
+  grpc_sopb_init(&call->buffered_send_ops);
   gpr_slice_buffer_init(&call->incoming_message);
   grpc_closure_init(&call->on_done_recv, call_on_done_recv, call);
   grpc_closure_init(&call->on_done_send, call_on_done_send, call);
@@ -459,8 +470,8 @@ void grpc_call_internal_ref(grpc_call *c) {
 static void destroy_call(grpc_exec_ctx *exec_ctx, grpc_call *call) {
   size_t i;
   grpc_call *c = call;
+  grpc_channel *channel = c->channel;
   grpc_call_stack_destroy(exec_ctx, CALL_STACK_FROM_CALL(c));
-  GRPC_CHANNEL_INTERNAL_UNREF(exec_ctx, c->channel, "call");
   gpr_mu_destroy(&c->mu);
   gpr_mu_destroy(&c->completion_mu);
   for (i = 0; i < STATUS_SOURCE_COUNT; i++) {
@@ -485,12 +496,15 @@ static void destroy_call(grpc_exec_ctx *exec_ctx, grpc_call *call) {
   }
   grpc_sopb_destroy(&c->send_ops);
   grpc_sopb_destroy(&c->recv_ops);
+  grpc_sopb_destroy(&c->buffered_send_ops);
   grpc_bbq_destroy(&c->incoming_queue);
   gpr_slice_buffer_destroy(&c->incoming_message);
   if (c->cq) {
     GRPC_CQ_INTERNAL_UNREF(c->cq, "bind");
   }
-  gpr_free(c);
+  /* the memory goes back to the channel, so drop our ref only afterwards */
+  grpc_channel_free_call(channel, c);
+  GRPC_CHANNEL_INTERNAL_UNREF(exec_ctx, channel, "call");
 }
 
 #ifdef GRPC_CALL_REF_COUNT_DEBUG
@@ -640,6 +654,8 @@ static void unlock(grpc_exec_ctx *exec_ctx, grpc_call *call) {
     }
   }
 
+  buffer_send_message(call);
+
   if (!call->sending) {
     if (fill_send_ops(call, &op)) {
       call->sending = 1;
@@ -1104,6 +1120,14 @@ static int fill_send_ops(grpc_call *call, grpc_transport_stream_op *op) {
       call->send_initial_metadata_count = 0;
     /* fall through intended */
     case WRITE_STATE_STARTED:
+      /* buffered messages ride along with anything else that's sent */
+      if (call->buffered_send_ops.nops > 0 &&
+          (op->send_ops != NULL || is_op_live(call, GRPC_IOREQ_SEND_MESSAGE) ||
+           is_op_live(call, GRPC_IOREQ_SEND_CLOSE))) {
+        grpc_sopb_move_to(&call->buffered_send_ops, &call->send_ops);
+        call->buffered_send_bytes = 0;
+        op->send_ops = &call->send_ops;
+      }
       if (is_op_live(call, GRPC_IOREQ_SEND_MESSAGE)) {
         size_t length;
         data = call->request_data[GRPC_IOREQ_SEND_MESSAGE];
@@ -1157,6 +1181,37 @@ static int fill_send_ops(grpc_call *call, grpc_transport_stream_op *op) {
   return op->send_ops != NULL;
 }
 
+/* If the pending message was written with GRPC_WRITE_BUFFER_HINT and there's
+   room, copy it aside for fill_send_ops to pick up with the next unbuffered
+   send, and complete it now rather than after a transport round trip */
+static void buffer_send_message(grpc_call *call) {
+  grpc_ioreq_data data;
+  gpr_uint32 flags;
+  size_t length;
+
+  if (!is_op_live(call, GRPC_IOREQ_SEND_MESSAGE) ||
+      (call->last_send_contains & (1 << GRPC_IOREQ_SEND_MESSAGE)) ||
+      call->write_state == WRITE_STATE_WRITE_CLOSED) {
+    return;
+  }
+  flags = call->request_flags[GRPC_IOREQ_SEND_MESSAGE];
+  if ((flags & GRPC_WRITE_BUFFER_HINT) == 0) {
+    return;
+  }
+  data = call->request_data[GRPC_IOREQ_SEND_MESSAGE];
+  length = grpc_byte_buffer_length(data.send_message);
+  if (call->buffered_send_bytes + length > MAX_BUFFERED_SEND_BYTES) {
+    /* full: send it (and everything before it) the usual way */
+    return;
+  }
+  GPR_ASSERT(length <= GPR_UINT32_MAX);
+  grpc_sopb_add_begin_message(&call->buffered_send_ops, (gpr_uint32)length,
+                              flags);
+  copy_byte_buffer_to_stream_ops(data.send_message, &call->buffered_send_ops);
+  call->buffered_send_bytes += length;
+  finish_live_ioreq_op(call, GRPC_IOREQ_SEND_MESSAGE, 1);
+}
+
 static grpc_call_error start_ioreq_error(grpc_call *call,
                                          gpr_uint32 mutated_ops,
                                          grpc_call_error ret) {
@@ -1583,9 +1638,9 @@ grpc_call_error grpc_call_start_batch(grpc_call *call, const grpc_op *ops,
   void (*finish_func)(grpc_exec_ctx *, grpc_call *, int, void *) = finish_batch;
   grpc_call_error error;
   grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
-  uint64_t start, start2, end;
+  gpr_uint64 start, start2, end;
 
-  start = nanos_since_midnight_c();
+  start = gpr_span_clock_now();
 
   if (reserved != NULL) {
     error = GRPC_CALL_ERROR;
@@ -1602,11 +1657,10 @@ grpc_call_error grpc_call_start_batch(grpc_call *call, const grpc_op *ops,
     error = GRPC_CALL_OK;
     goto done;
   }
-  end = nanos_since_midnight_c();
-  add_func_stats_c("grpc_call_start_batch: if (nops==0)", start, end, " ",
-      "grpc_call_start_batch: if (nops==0): Sends begin_op and end_op if NOPS==0");
+  end = gpr_span_clock_now();
+  GPR_SPAN("grpc_call_start_batch: if (nops==0)", start, end, call);
 
-  start2 = nanos_since_midnight_c();
+  start2 = gpr_span_clock_now();
   /* rewrite batch ops into ioreq ops */
   for (in = 0, out = 0; in < nops; in++) {
     op = &ops[in];
@@ -1616,7 +1670,7 @@ grpc_call_error grpc_call_start_batch(grpc_call *call, const grpc_op *ops,
     }
     switch (op->op) {
       case GRPC_OP_SEND_INITIAL_METADATA:
-        start = nanos_since_midnight_c();
+        start = gpr_span_clock_now();
 
          /* Flag validation: currently allow no flags */
         if (op->flags != 0) {
@@ -1634,12 +1688,12 @@ grpc_call_error grpc_call_start_batch(grpc_call *call, const grpc_op *ops,
             op->data.send_initial_metadata.metadata;
         req->flags = op->flags;
 
-        end = nanos_since_midnight_c();
-        add_func_stats_c("grpc_call_start_batch: Construct GRPC_OP_SEND_INITIAL_METADATA:", start, end, " ",
-              "grpc_call_start_batch: Construct GRPC_OP_SEND_INITIAL_METADATA: grpc_ioreq");
+        end = gpr_span_clock_now();
+        GPR_SPAN("grpc_call_start_batch: GRPC_OP_SEND_INITIAL_METADATA", start,
+                 end, call);
         break;
       case GRPC_OP_SEND_MESSAGE:
-        start = nanos_since_midnight_c();
+        start = gpr_span_clock_now();
 
         if (!are_write_flags_valid(op->flags)) {
           error = GRPC_CALL_ERROR_INVALID_FLAGS;
@@ -1658,12 +1712,12 @@ grpc_call_error grpc_call_start_batch(grpc_call *call, const grpc_op *ops,
         req->data.send_message = op->data.send_message;
         req->flags = op->flags;
 
-        end = nanos_since_midnight_c();
-        add_func_stats_c("grpc_call_start_batch: Construct GRPC_OP_SEND_MESSAGE:", start, end, " ",
-              "grpc_call_start_batch: Construct GRPC_OP_SEND_MESSAGE: grpc_ioreq");
+        end = gpr_span_clock_now();
+        GPR_SPAN("grpc_call_start_batch: GRPC_OP_SEND_MESSAGE", start, end,
+                 call);
         break;
       case GRPC_OP_SEND_CLOSE_FROM_CLIENT:
-        start = nanos_since_midnight_c();
+        start = gpr_span_clock_now();
 
         /* Flag validation: currently allow no flags */
         if (op->flags != 0) {
@@ -1682,12 +1736,12 @@ grpc_call_error grpc_call_start_batch(grpc_call *call, const grpc_op *ops,
         req->op = GRPC_IOREQ_SEND_CLOSE;
         req->flags = op->flags;
 
-        end = nanos_since_midnight_c();
-        add_func_stats_c("grpc_call_start_batch: Construct GRPC_OP_SEND_CLOSE_FROM_CLIENT:", start, end, " ",
-              "grpc_call_start_batch: Construct GRPC_OP_SEND_CLOSE_FROM_CLIENT: grpc_ioreq");
+        end = gpr_span_clock_now();
+        GPR_SPAN("grpc_call_start_batch: GRPC_OP_SEND_CLOSE_FROM_CLIENT", start,
+                 end, call);
         break;
       case GRPC_OP_SEND_STATUS_FROM_SERVER:
-        start = nanos_since_midnight_c();
+        start = gpr_span_clock_now();
         /* Flag validation: currently allow no flags */
         if (op->flags != 0) {
           error = GRPC_CALL_ERROR_INVALID_FLAGS;
@@ -1728,12 +1782,12 @@ grpc_call_error grpc_call_start_batch(grpc_call *call, const grpc_op *ops,
         }
         req->op = GRPC_IOREQ_SEND_CLOSE;
 
-        end = nanos_since_midnight_c();
-        add_func_stats_c("grpc_call_start_batch: Construct GRPC_OP_SEND_STATUS_FROM_SERVER:", start, end, " ",
-              "grpc_call_start_batch: Construct GRPC_OP_SEND_STATUS_FROM_SERVER: grpc_ioreq");
+        end = gpr_span_clock_now();
+        GPR_SPAN("grpc_call_start_batch: GRPC_OP_SEND_STATUS_FROM_SERVER",
+                 start, end, call);
         break;
       case GRPC_OP_RECV_INITIAL_METADATA:
-          start = nanos_since_midnight_c();
+        start = gpr_span_clock_now();
         /* Flag validation: currently allow no flags */
         if (op->flags != 0) {
           error = GRPC_CALL_ERROR_INVALID_FLAGS;
@@ -1753,12 +1807,12 @@ grpc_call_error grpc_call_start_batch(grpc_call *call, const grpc_op *ops,
         req->data.recv_metadata->count = 0;
         req->flags = op->flags;
 
-        end = nanos_since_midnight_c();
-        add_func_stats_c("grpc_call_start_batch: Construct GRPC_OP_RECV_INITIAL_METADATA:", start, end, " ",
-              "grpc_call_start_batch: Construct GRPC_OP_RECV_INITIAL_METADATA: grpc_ioreq");
+        end = gpr_span_clock_now();
+        GPR_SPAN("grpc_call_start_batch: GRPC_OP_RECV_INITIAL_METADATA", start,
+                 end, call);
         break;
       case GRPC_OP_RECV_MESSAGE:
-        start = nanos_since_midnight_c();
+        start = gpr_span_clock_now();
         /* Flag validation: currently allow no flags */
         if (op->flags != 0) {
           error = GRPC_CALL_ERROR_INVALID_FLAGS;
@@ -1773,12 +1827,12 @@ grpc_call_error grpc_call_start_batch(grpc_call *call, const grpc_op *ops,
         req->data.recv_message = op->data.recv_message;
         req->flags = op->flags;
 
-        end = nanos_since_midnight_c();
-        add_func_stats_c("grpc_call_start_batch: Construct GRPC_OP_RECV_MESSAGE:", start, end, " ",
-              "grpc_call_start_batch: Construct GRPC_OP_RECV_MESSAGE: grpc_ioreq");
+        end = gpr_span_clock_now();
+        GPR_SPAN("grpc_call_start_batch: GRPC_OP_RECV_MESSAGE", start, end,
+                 call);
         break;
       case GRPC_OP_RECV_STATUS_ON_CLIENT:
-          start = nanos_since_midnight_c();
+        start = gpr_span_clock_now();
         /* Flag validation: currently allow no flags */
         if (op->flags != 0) {
           error = GRPC_CALL_ERROR_INVALID_FLAGS;
@@ -1824,12 +1878,12 @@ grpc_call_error grpc_call_start_batch(grpc_call *call, const grpc_op *ops,
         req->op = GRPC_IOREQ_RECV_CLOSE;
         finish_func = finish_batch_with_close;
 
-        end = nanos_since_midnight_c();
-        add_func_stats_c("grpc_call_start_batch: Construct GRPC_OP_RECV_STATUS_ON_CLIENT:", start, end, " ",
-              "grpc_call_start_batch: Construct GRPC_OP_RECV_STATUS_ON_CLIENT: grpc_ioreq");
+        end = gpr_span_clock_now();
+        GPR_SPAN("grpc_call_start_batch: GRPC_OP_RECV_STATUS_ON_CLIENT", start,
+                 end, call);
         break;
       case GRPC_OP_RECV_CLOSE_ON_SERVER:
-        start = nanos_since_midnight_c();
+        start = gpr_span_clock_now();
         /* Flag validation: currently allow no flags */
         if (op->flags != 0) {
           error = GRPC_CALL_ERROR_INVALID_FLAGS;
@@ -1853,34 +1907,35 @@ grpc_call_error grpc_call_start_batch(grpc_call *call, const grpc_op *ops,
         req->op = GRPC_IOREQ_RECV_CLOSE;
         finish_func = finish_batch_with_close;
 
-        end = nanos_since_midnight_c();
-        add_func_stats_c("grpc_call_start_batch: Construct GRPC_OP_RECV_CLOSE_ON_SERVER:", start, end, " ",
-              "grpc_call_start_batch: Construct GRPC_OP_RECV_CLOSE_ON_SERVER: grpc_ioreq");
+        end = gpr_span_clock_now();
+        GPR_SPAN("grpc_call_start_batch: GRPC_OP_RECV_CLOSE_ON_SERVER", start,
+                 end, call);
         break;
     }
   }
 
-  end = nanos_since_midnight_c();
-  add_func_stats_c("grpc_call_start_batch: Time to construct all grpc_ioreq objs", start2, end, " ",
-          "grpc_call_start_batch: Time to construct all grpc_ioreq objs");
+  end = gpr_span_clock_now();
+  GPR_SPAN("grpc_call_start_batch: Time to construct all grpc_ioreq objs",
+           start2, end, call);
 
-  start = nanos_since_midnight_c();
+  start = gpr_span_clock_now();
   GRPC_CALL_INTERNAL_REF(call, "completion");
   grpc_cq_begin_op(call->cq);
 
-  end = nanos_since_midnight_c();
-  add_func_stats_c("grpc_call_start_batch: grpc_cq_begin_op(call->cq)", start, end, " ", "* Does CQ BEGIN OP here: grpc_cq_begin_op(call->cq)");
+  end = gpr_span_clock_now();
+  GPR_SPAN("grpc_call_start_batch: grpc_cq_begin_op(call->cq)", start, end,
+           call);
 
 
-  start = nanos_since_midnight_c();
+  start = gpr_span_clock_now();
   error = grpc_call_start_ioreq_and_call_back(&exec_ctx, call, reqs, out,
                                               finish_func, tag);
 done:
   grpc_exec_ctx_finish(&exec_ctx);
 
-  end = nanos_since_midnight_c();
-  add_func_stats_c("grpc_call_start_batch: grpc_call_start_ioreq_and_call_back", start, end, " ",
-          "* Call and exec of all the IOREQ packet is done here: grpc_call_start_ioreq_and_call_back execution() + grpc_exec_ctx_finish(&exec_ctx);");
+  end = gpr_span_clock_now();
+  GPR_SPAN("grpc_call_start_batch: grpc_call_start_ioreq_and_call_back", start,
+           end, call);
   return error;
 }
 
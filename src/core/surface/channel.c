@@ -53,12 +53,21 @@
  *  (OK, Cancelled, Unknown). */
 #define NUM_CACHED_STATUS_ELEMS 3
 
+/** Upper bound on the number of released call allocations a channel keeps
+ *  around for reuse. */
+#define MAX_FREE_CALLS 32
+
 typedef struct registered_call {
   grpc_mdelem *path;
   grpc_mdelem *authority;
   struct registered_call *next;
 } registered_call;
 
+/** A released call allocation, threaded through its first bytes. */
+typedef struct free_call {
+  struct free_call *next;
+} free_call;
+
 struct grpc_channel {
   int is_client;
   gpr_refcount refs;
@@ -77,6 +86,15 @@ struct grpc_channel {
 
   gpr_mu registered_call_mu;
   registered_call *registered_calls;
+
+  /** Every call on a channel has the same size (the surface call followed by
+      the call stack), so released allocations are kept here and handed to
+      the next call instead of going back to the allocator. */
+  gpr_mu free_calls_mu;
+  free_call *free_calls;
+  size_t free_call_count;
+  size_t call_size;
+
   char *target;
 };
 
@@ -121,6 +139,7 @@ grpc_channel *grpc_channel_create_from_filters(
   channel->authority_string = grpc_mdstr_from_string(mdctx, ":authority");
   gpr_mu_init(&channel->registered_call_mu);
   channel->registered_calls = NULL;
+  gpr_mu_init(&channel->free_calls_mu);
 
   channel->max_message_length = DEFAULT_MAX_MESSAGE_LENGTH;
   if (args) {
@@ -229,21 +248,40 @@ grpc_call *grpc_channel_create_call(grpc_channel *channel,
 
 void *grpc_channel_register_call(grpc_channel *channel, const char *method,
                                  const char *host, void *reserved) {
-  registered_call *rc = gpr_malloc(sizeof(registered_call));
+  registered_call *rc;
+  grpc_mdelem *path;
+  grpc_mdelem *authority;
   GPR_ASSERT(!reserved);
-  rc->path = grpc_mdelem_from_metadata_strings(
+  path = grpc_mdelem_from_metadata_strings(
       channel->metadata_context, GRPC_MDSTR_REF(channel->path_string),
       grpc_mdstr_from_string(channel->metadata_context, method));
-  rc->authority =
+  authority =
       host ? grpc_mdelem_from_metadata_strings(
                  channel->metadata_context,
                  GRPC_MDSTR_REF(channel->authority_string),
                  grpc_mdstr_from_string(channel->metadata_context, host))
            : NULL;
   gpr_mu_lock(&channel->registered_call_mu);
-  rc->next = channel->registered_calls;
-  channel->registered_calls = rc;
+  /* mdelems are interned, so a method registered before (typically by an
+     earlier stub on the same channel) has the very same path and authority */
+  for (rc = channel->registered_calls; rc != NULL; rc = rc->next) {
+    if (rc->path == path && rc->authority == authority) break;
+  }
+  if (rc == NULL) {
+    rc = gpr_malloc(sizeof(registered_call));
+    rc->path = path;
+    rc->authority = authority;
+    rc->next = channel->registered_calls;
+    channel->registered_calls = rc;
+    path = authority = NULL;
+  }
   gpr_mu_unlock(&channel->registered_call_mu);
+  if (path != NULL) {
+    GRPC_MDELEM_UNREF(path);
+  }
+  if (authority != NULL) {
+    GRPC_MDELEM_UNREF(authority);
+  }
   return rc;
 }
 
@@ -290,11 +328,17 @@ static void destroy_channel(grpc_exec_ctx *exec_ctx, grpc_channel *channel) {
     }
     gpr_free(rc);
   }
+  while (channel->free_calls) {
+    free_call *fc = channel->free_calls;
+    channel->free_calls = fc->next;
+    gpr_free(fc);
+  }
   if (channel->default_authority != NULL) {
     GRPC_MDELEM_UNREF(channel->default_authority);
   }
   grpc_mdctx_unref(channel->metadata_context);
   gpr_mu_destroy(&channel->registered_call_mu);
+  gpr_mu_destroy(&channel->free_calls_mu);
   gpr_free(channel->target);
   gpr_free(channel);
 }
@@ -331,6 +375,33 @@ grpc_channel_stack *grpc_channel_get_channel_stack(grpc_channel *channel) {
   return CHANNEL_STACK_FROM_CHANNEL(channel);
 }
 
+void *grpc_channel_alloc_call(grpc_channel *channel, size_t size) {
+  free_call *fc = NULL;
+  gpr_mu_lock(&channel->free_calls_mu);
+  GPR_ASSERT(channel->call_size == 0 || channel->call_size == size);
+  channel->call_size = size;
+  if (channel->free_calls != NULL) {
+    fc = channel->free_calls;
+    channel->free_calls = fc->next;
+    channel->free_call_count--;
+  }
+  gpr_mu_unlock(&channel->free_calls_mu);
+  return fc != NULL ? (void *)fc : gpr_malloc(size);
+}
+
+void grpc_channel_free_call(grpc_channel *channel, void *call) {
+  free_call *fc = call;
+  gpr_mu_lock(&channel->free_calls_mu);
+  if (channel->free_call_count < MAX_FREE_CALLS) {
+    fc->next = channel->free_calls;
+    channel->free_calls = fc;
+    channel->free_call_count++;
+    fc = NULL;
+  }
+  gpr_mu_unlock(&channel->free_calls_mu);
+  gpr_free(fc);
+}
+
 grpc_mdctx *grpc_channel_get_metadata_context(grpc_channel *channel) {
   return channel->metadata_context;
 }
@@ -45,6 +45,15 @@ grpc_channel *grpc_channel_create_from_filters(
 /** Get a (borrowed) pointer to this channels underlying channel stack */
 grpc_channel_stack *grpc_channel_get_channel_stack(grpc_channel *channel);
 
+/** Allocate \a size bytes for a call on this channel, reusing memory released
+    by an earlier call when there is some. All calls on a channel must ask for
+    the same size. */
+void *grpc_channel_alloc_call(grpc_channel *channel, size_t size);
+
+/** Release memory obtained from grpc_channel_alloc_call. The caller must
+    still hold a ref to the channel. */
+void grpc_channel_free_call(grpc_channel *channel, void *call);
+
 /** Get a (borrowed) pointer to the channel wide metadata context */
 grpc_mdctx *grpc_channel_get_metadata_context(grpc_channel *channel);
 
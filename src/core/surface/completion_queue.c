@@ -44,6 +44,7 @@
 #include <grpc/support/alloc.h>
 #include <grpc/support/atm.h>
 #include <grpc/support/log.h>
+#include <grpc/support/sync.h>
 
 typedef struct {
   grpc_pollset_worker *worker;
@@ -354,3 +355,56 @@ grpc_pollset *grpc_cq_pollset(grpc_completion_queue *cc) {
 void grpc_cq_mark_server_cq(grpc_completion_queue *cc) { cc->is_server_cq = 1; }
 
 int grpc_cq_is_server_cq(grpc_completion_queue *cc) { return cc->is_server_cq; }
+
+static gpr_once g_thread_caches_once = GPR_ONCE_INIT;
+static gpr_mu g_thread_caches_mu;
+/* sentinel of the list of caches holding a queue */
+static grpc_cq_thread_cache g_thread_caches;
+
+static void init_thread_caches(void) {
+  gpr_mu_init(&g_thread_caches_mu);
+  g_thread_caches.next = g_thread_caches.prev = &g_thread_caches;
+}
+
+grpc_completion_queue *grpc_cq_thread_cache_get(grpc_cq_thread_cache *cache) {
+  /* the caller holds a grpc_init ref, so the last grpc_shutdown cannot be
+     clearing cache->cq under our feet */
+  if (cache->cq != NULL) {
+    return cache->cq;
+  }
+  gpr_once_init(&g_thread_caches_once, init_thread_caches);
+  gpr_mu_lock(&g_thread_caches_mu);
+  cache->cq = grpc_completion_queue_create(NULL);
+  cache->next = &g_thread_caches;
+  cache->prev = g_thread_caches.prev;
+  cache->next->prev = cache->prev->next = cache;
+  gpr_mu_unlock(&g_thread_caches_mu);
+  return cache->cq;
+}
+
+/* Called with g_thread_caches_mu held: the last grpc_shutdown waits for it
+   before tearing down iomgr, so the library is still up */
+static void destroy_thread_cache_locked(grpc_cq_thread_cache *cache) {
+  cache->next->prev = cache->prev;
+  cache->prev->next = cache->next;
+  grpc_completion_queue_destroy(cache->cq);
+  cache->cq = NULL;
+}
+
+void grpc_cq_thread_cache_destroy(grpc_cq_thread_cache *cache) {
+  gpr_once_init(&g_thread_caches_once, init_thread_caches);
+  gpr_mu_lock(&g_thread_caches_mu);
+  if (cache->cq != NULL) {
+    destroy_thread_cache_locked(cache);
+  }
+  gpr_mu_unlock(&g_thread_caches_mu);
+}
+
+void grpc_cq_thread_caches_shutdown(void) {
+  gpr_once_init(&g_thread_caches_once, init_thread_caches);
+  gpr_mu_lock(&g_thread_caches_mu);
+  while (g_thread_caches.next != &g_thread_caches) {
+    destroy_thread_cache_locked(g_thread_caches.next);
+  }
+  gpr_mu_unlock(&g_thread_caches_mu);
+}
@@ -39,6 +39,10 @@
 #include "src/core/iomgr/pollset.h"
 #include <grpc/grpc.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef struct grpc_cq_completion {
   /** user supplied tag */
   void *tag;
@@ -83,4 +87,29 @@ grpc_pollset *grpc_cq_pollset(grpc_completion_queue *cc);
 void grpc_cq_mark_server_cq(grpc_completion_queue *cc);
 int grpc_cq_is_server_cq(grpc_completion_queue *cc);
 
+/* A queue a thread keeps for its blocking calls, which only pluck their own
+   tags, so that they need not create and destroy a queue (and its pollset)
+   each. The cached queue holds no grpc_init ref: the last grpc_shutdown
+   destroys every cached queue before tearing iomgr down, so that neither the
+   queue nor the fds its pollset has seen outlive the library. */
+typedef struct grpc_cq_thread_cache {
+  /* NULL until first used, and again once the library has shut down */
+  grpc_completion_queue *cq;
+  /* links in the list of caches holding a queue */
+  struct grpc_cq_thread_cache *next;
+  struct grpc_cq_thread_cache *prev;
+} grpc_cq_thread_cache;
+
+/* Returns the cache's queue, creating it if there is none. The library must
+   be initialized, and only the owning thread may call this. */
+grpc_completion_queue *grpc_cq_thread_cache_get(grpc_cq_thread_cache *cache);
+/* Destroys the cache's queue if it still has one; call on thread exit */
+void grpc_cq_thread_cache_destroy(grpc_cq_thread_cache *cache);
+/* Destroys the queues of all caches; called by the last grpc_shutdown */
+void grpc_cq_thread_caches_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* GRPC_INTERNAL_CORE_SURFACE_COMPLETION_QUEUE_H */
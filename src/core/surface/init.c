@@ -50,6 +50,7 @@
 #include "src/core/iomgr/iomgr.h"
 #include "src/core/profiling/timers.h"
 #include "src/core/surface/call.h"
+#include "src/core/surface/completion_queue.h"
 #include "src/core/surface/init.h"
 #include "src/core/surface/surface_trace.h"
 #include "src/core/transport/chttp2_transport.h"
@@ -127,6 +128,8 @@ void grpc_shutdown(void) {
   int i;
   gpr_mu_lock(&g_init_mu);
   if (--g_initializations == 0) {
+    grpc_cq_thread_caches_shutdown();
+    grpc_security_shutdown();
     grpc_iomgr_shutdown();
     census_shutdown();
     grpc_timers_global_destroy();
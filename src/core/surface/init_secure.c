@@ -33,6 +33,7 @@
 
 #include "src/core/surface/init.h"
 #include "src/core/debug/trace.h"
+#include "src/core/security/handshake_executor.h"
 #include "src/core/security/secure_endpoint.h"
 #include "src/core/tsi/transport_security_interface.h"
 
@@ -40,3 +41,5 @@ void grpc_security_pre_init(void) {
   grpc_register_tracer("secure_endpoint", &grpc_trace_secure_endpoint);
   grpc_register_tracer("transport_security", &tsi_tracing_enabled);
 }
+
+void grpc_security_shutdown(void) { grpc_handshake_executor_shutdown(); }
@@ -34,3 +34,5 @@
 #include "src/core/surface/init.h"
 
 void grpc_security_pre_init(void) {}
+
+void grpc_security_shutdown(void) {}
@@ -0,0 +1,99 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "src/core/transport/chttp2/bdp_estimator.h"
+
+#include <grpc/support/log.h>
+#include <grpc/support/useful.h>
+
+const gpr_uint8 grpc_chttp2_bdp_ping_id[8] = {'g', 'r', 'p', 'c',
+                                              'b', 'd', 'p', 0};
+
+void grpc_chttp2_bdp_estimator_init(grpc_chttp2_bdp_estimator *estimator,
+                                    gpr_int64 min_estimate,
+                                    gpr_int64 max_estimate) {
+  GPR_ASSERT(min_estimate > 0);
+  GPR_ASSERT(min_estimate <= max_estimate);
+  estimator->estimate = min_estimate;
+  estimator->min_estimate = min_estimate;
+  estimator->max_estimate = max_estimate;
+  estimator->accumulator = 0;
+  estimator->bw_est = 0;
+  estimator->ping_outstanding = 0;
+  estimator->ping_start = gpr_inf_past(GPR_CLOCK_MONOTONIC);
+}
+
+int grpc_chttp2_bdp_estimator_add_incoming_bytes(
+    grpc_chttp2_bdp_estimator *estimator, gpr_int64 bytes) {
+  estimator->accumulator += bytes;
+  return !estimator->ping_outstanding;
+}
+
+void grpc_chttp2_bdp_estimator_start_ping(grpc_chttp2_bdp_estimator *estimator,
+                                          gpr_timespec now) {
+  GPR_ASSERT(!estimator->ping_outstanding);
+  estimator->ping_outstanding = 1;
+  estimator->ping_start = now;
+}
+
+int grpc_chttp2_bdp_estimator_complete_ping(
+    grpc_chttp2_bdp_estimator *estimator, gpr_timespec now) {
+  gpr_timespec rtt_ts;
+  double rtt;
+  double bw;
+  gpr_int64 old_estimate = estimator->estimate;
+
+  if (!estimator->ping_outstanding) {
+    return 0;
+  }
+  rtt_ts = gpr_time_sub(now, estimator->ping_start);
+  rtt = (double)rtt_ts.tv_sec + 1e-9 * (double)rtt_ts.tv_nsec;
+  if (rtt < 1e-6) rtt = 1e-6;
+  bw = (double)estimator->accumulator / rtt;
+
+  if (estimator->accumulator > 2 * estimator->estimate / 3 &&
+      bw > estimator->bw_est) {
+    estimator->estimate =
+        GPR_MIN(estimator->max_estimate,
+                GPR_MAX(estimator->accumulator, 2 * estimator->estimate));
+    estimator->bw_est = bw;
+  } else if (estimator->accumulator < estimator->estimate / 4) {
+    estimator->estimate =
+        GPR_MAX(estimator->min_estimate, estimator->estimate / 2);
+    estimator->bw_est = bw;
+  }
+
+  estimator->accumulator = 0;
+  estimator->ping_outstanding = 0;
+  return estimator->estimate != old_estimate;
+}
@@ -0,0 +1,87 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef GRPC_INTERNAL_CORE_TRANSPORT_CHTTP2_BDP_ESTIMATOR_H
+#define GRPC_INTERNAL_CORE_TRANSPORT_CHTTP2_BDP_ESTIMATOR_H
+
+#include <grpc/support/port_platform.h>
+#include <grpc/support/time.h>
+
+/* Estimates the bandwidth-delay product of a connection from the amount of
+   data that arrives while a PING is in flight.
+
+   The first DATA bytes seen while no probe is outstanding start a probe: the
+   caller sends a PING and every byte received until its ACK is accumulated.
+   A sample that fills most of the current estimate while also improving the
+   observed bandwidth doubles the estimate (the window was the bottleneck);
+   a sample that uses less than a quarter of it halves the estimate, so that
+   slow or idle peers stop being granted memory they do not use. */
+typedef struct {
+  /** current estimate, in bytes */
+  gpr_int64 estimate;
+  /** bounds for estimate */
+  gpr_int64 min_estimate;
+  gpr_int64 max_estimate;
+  /** bytes received since the outstanding probe was sent */
+  gpr_int64 accumulator;
+  /** best bandwidth seen at the current estimate, in bytes/second */
+  double bw_est;
+  /** is a probe ping in flight? */
+  gpr_uint8 ping_outstanding;
+  /** when the outstanding probe was sent */
+  gpr_timespec ping_start;
+} grpc_chttp2_bdp_estimator;
+
+void grpc_chttp2_bdp_estimator_init(grpc_chttp2_bdp_estimator *estimator,
+                                    gpr_int64 min_estimate,
+                                    gpr_int64 max_estimate);
+
+/* Account for incoming DATA bytes. Returns 1 if no probe is in flight and the
+   caller should send one (and then call
+   grpc_chttp2_bdp_estimator_start_ping), 0 otherwise. */
+int grpc_chttp2_bdp_estimator_add_incoming_bytes(
+    grpc_chttp2_bdp_estimator *estimator, gpr_int64 bytes);
+
+/* Note that the probe ping was sent at \a now. */
+void grpc_chttp2_bdp_estimator_start_ping(grpc_chttp2_bdp_estimator *estimator,
+                                          gpr_timespec now);
+
+/* Note that the probe ping was acknowledged at \a now. Returns 1 if the
+   estimate changed. */
+int grpc_chttp2_bdp_estimator_complete_ping(
+    grpc_chttp2_bdp_estimator *estimator, gpr_timespec now);
+
+/* The opaque payload used for probe pings; only one is ever outstanding */
+extern const gpr_uint8 grpc_chttp2_bdp_ping_id[8];
+
+#endif /* GRPC_INTERNAL_CORE_TRANSPORT_CHTTP2_BDP_ESTIMATOR_H */
@@ -72,7 +72,10 @@ grpc_chttp2_parse_error grpc_chttp2_data_parser_begin_frame(
     grpc_chttp2_data_parser *parser, gpr_uint8 flags);
 
 /* handle a slice of a data frame - is_last indicates the last slice of a
-   frame */
+   frame. Message payloads are added to incoming_sopb as references into
+   slice, not copies: a message within one read becomes one slice of it, a
+   message spanning reads one slice per read. Only pieces short enough to be
+   inlined are copied. */
 grpc_chttp2_parse_error grpc_chttp2_data_parser_parse(
     grpc_exec_ctx *exec_ctx, void *parser,
     grpc_chttp2_transport_parsing *transport_parsing,
@@ -87,14 +87,23 @@ grpc_chttp2_parse_error grpc_chttp2_ping_parser_parse(
   if (p->byte == 8) {
     GPR_ASSERT(is_last);
     if (p->is_ack) {
+      if (0 == memcmp(p->opaque_8bytes, grpc_chttp2_bdp_ping_id, 8)) {
+        if (grpc_chttp2_bdp_estimator_complete_ping(
+                &transport_parsing->bdp_estimator,
+                gpr_now(GPR_CLOCK_MONOTONIC))) {
+          transport_parsing->bdp_estimate_updated = 1;
+        }
+        return GRPC_CHTTP2_PARSE_OK;
+      }
       for (ping = transport_parsing->pings.next;
            ping != &transport_parsing->pings; ping = ping->next) {
         if (0 == memcmp(p->opaque_8bytes, ping->id, 8)) {
           grpc_exec_ctx_enqueue(exec_ctx, ping->on_recv, 1);
+          ping->next->prev = ping->prev;
+          ping->prev->next = ping->next;
+          gpr_free(ping);
+          break;
         }
-        ping->next->prev = ping->prev;
-        ping->prev->next = ping->next;
-        gpr_free(ping);
       }
     } else {
       gpr_slice_buffer_add(&transport_parsing->qbuf,
@@ -36,6 +36,7 @@
 #include <assert.h>
 #include <string.h>
 
+#include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
 #include "src/core/support/murmur_hash.h"
 
@@ -170,14 +171,22 @@ static struct {
 };
 
 void grpc_chttp2_hptbl_init(grpc_chttp2_hptbl *tbl, grpc_mdctx *mdctx) {
-  size_t i;
-
   memset(tbl, 0, sizeof(*tbl));
   tbl->mdctx = mdctx;
   tbl->max_bytes = GRPC_CHTTP2_INITIAL_HPACK_TABLE_SIZE;
+  tbl->max_bytes_limit = GRPC_CHTTP2_INITIAL_HPACK_TABLE_SIZE;
+  tbl->cap_entries =
+      (gpr_uint16)GRPC_CHTTP2_TABLE_COUNT_FOR_SIZE(tbl->max_bytes);
+  tbl->ents = gpr_malloc(sizeof(*tbl->ents) * tbl->cap_entries);
+  grpc_chttp2_hptbl_create_static_elems(mdctx, tbl->static_ents);
+}
+
+void grpc_chttp2_hptbl_create_static_elems(grpc_mdctx *mdctx,
+                                           grpc_mdelem **ents) {
+  size_t i;
   for (i = 1; i <= GRPC_CHTTP2_LAST_STATIC_ENTRY; i++) {
-    tbl->static_ents[i - 1] = grpc_mdelem_from_strings(
-        mdctx, static_table[i].key, static_table[i].value);
+    ents[i - 1] = grpc_mdelem_from_strings(mdctx, static_table[i].key,
+                                           static_table[i].value);
   }
 }
 
@@ -187,8 +196,34 @@ void grpc_chttp2_hptbl_destroy(grpc_chttp2_hptbl *tbl) {
     GRPC_MDELEM_UNREF(tbl->static_ents[i]);
   }
   for (i = 0; i < tbl->num_ents; i++) {
-    GRPC_MDELEM_UNREF(
-        tbl->ents[(tbl->first_ent + i) % GRPC_CHTTP2_MAX_TABLE_COUNT]);
+    GRPC_MDELEM_UNREF(tbl->ents[(tbl->first_ent + i) % tbl->cap_entries]);
+  }
+  gpr_free(tbl->ents);
+}
+
+/* Resize ents, keeping the live entries in order */
+static void rebuild_ents(grpc_chttp2_hptbl *tbl, gpr_uint32 new_cap) {
+  grpc_mdelem **ents = gpr_malloc(sizeof(*ents) * new_cap);
+  gpr_uint32 i;
+
+  GPR_ASSERT(new_cap >= tbl->num_ents);
+  for (i = 0; i < tbl->num_ents; i++) {
+    ents[i] = tbl->ents[(tbl->first_ent + i) % tbl->cap_entries];
+  }
+  gpr_free(tbl->ents);
+  tbl->ents = ents;
+  tbl->cap_entries = (gpr_uint16)new_cap;
+  tbl->first_ent = 0;
+  tbl->last_ent = (gpr_uint16)(tbl->num_ents % new_cap);
+}
+
+void grpc_chttp2_hptbl_set_max_bytes_limit(grpc_chttp2_hptbl *tbl,
+                                           gpr_uint32 max_bytes_limit) {
+  gpr_uint32 cap = GRPC_CHTTP2_TABLE_COUNT_FOR_SIZE(max_bytes_limit);
+  GPR_ASSERT(max_bytes_limit <= GRPC_CHTTP2_MAX_HPACK_TABLE_SIZE);
+  tbl->max_bytes_limit = max_bytes_limit;
+  if (cap > tbl->cap_entries) {
+    rebuild_ents(tbl, cap);
   }
 }
 
@@ -201,8 +236,8 @@ grpc_mdelem *grpc_chttp2_hptbl_lookup(const grpc_chttp2_hptbl *tbl,
   /* Otherwise, find the value in the list of valid entries */
   tbl_index -= (GRPC_CHTTP2_LAST_STATIC_ENTRY + 1);
   if (tbl_index < tbl->num_ents) {
-    gpr_uint32 offset = (tbl->num_ents - 1u - tbl_index + tbl->first_ent) %
-                        GRPC_CHTTP2_MAX_TABLE_COUNT;
+    gpr_uint32 offset =
+        (tbl->num_ents - 1u - tbl_index + tbl->first_ent) % tbl->cap_entries;
     return tbl->ents[offset];
   }
   /* Invalid entry: return error */
@@ -216,13 +251,29 @@ static void evict1(grpc_chttp2_hptbl *tbl) {
                       GPR_SLICE_LENGTH(first_ent->value->slice) +
                       GRPC_CHTTP2_HPACK_ENTRY_OVERHEAD;
   GPR_ASSERT(elem_bytes <= tbl->mem_used);
-  tbl->mem_used = (gpr_uint16)(tbl->mem_used - elem_bytes);
-  tbl->first_ent =
-      (gpr_uint16)((tbl->first_ent + 1) % GRPC_CHTTP2_MAX_TABLE_COUNT);
+  tbl->mem_used = (gpr_uint32)(tbl->mem_used - elem_bytes);
+  tbl->first_ent = (gpr_uint16)((tbl->first_ent + 1) % tbl->cap_entries);
   tbl->num_ents--;
   GRPC_MDELEM_UNREF(first_ent);
 }
 
+int grpc_chttp2_hptbl_set_max_bytes(grpc_chttp2_hptbl *tbl,
+                                    gpr_uint32 max_bytes) {
+  if (max_bytes > tbl->max_bytes_limit) {
+    gpr_log(GPR_ERROR, "Attempt to make hpack table %d bytes when max is %d",
+            max_bytes, tbl->max_bytes_limit);
+    return 0;
+  }
+  while (tbl->mem_used > max_bytes) {
+    evict1(tbl);
+  }
+  tbl->max_bytes = max_bytes;
+  if (GRPC_CHTTP2_TABLE_COUNT_FOR_SIZE(max_bytes) > tbl->cap_entries) {
+    rebuild_ents(tbl, GRPC_CHTTP2_TABLE_COUNT_FOR_SIZE(max_bytes));
+  }
+  return 1;
+}
+
 void grpc_chttp2_hptbl_add(grpc_chttp2_hptbl *tbl, grpc_mdelem *md) {
   /* determine how many bytes of buffer this entry represents */
   size_t elem_bytes = GPR_SLICE_LENGTH(md->key->slice) +
@@ -255,10 +306,9 @@ void grpc_chttp2_hptbl_add(grpc_chttp2_hptbl *tbl, grpc_mdelem *md) {
   tbl->ents[tbl->last_ent] = md;
 
   /* update accounting values */
-  tbl->last_ent =
-      (gpr_uint16)((tbl->last_ent + 1) % GRPC_CHTTP2_MAX_TABLE_COUNT);
+  tbl->last_ent = (gpr_uint16)((tbl->last_ent + 1) % tbl->cap_entries);
   tbl->num_ents++;
-  tbl->mem_used = (gpr_uint16)(tbl->mem_used + elem_bytes);
+  tbl->mem_used = (gpr_uint32)(tbl->mem_used + elem_bytes);
 }
 
 grpc_chttp2_hptbl_find_result grpc_chttp2_hptbl_find(
@@ -279,8 +329,7 @@ grpc_chttp2_hptbl_find_result grpc_chttp2_hptbl_find(
   for (i = 0; i < tbl->num_ents; i++) {
     gpr_uint16 idx =
         (gpr_uint16)(tbl->num_ents - i + GRPC_CHTTP2_LAST_STATIC_ENTRY);
-    grpc_mdelem *ent =
-        tbl->ents[(tbl->first_ent + i) % GRPC_CHTTP2_MAX_TABLE_COUNT];
+    grpc_mdelem *ent = tbl->ents[(tbl->first_ent + i) % tbl->cap_entries];
     if (md->key != ent->key) continue;
     r.index = idx;
     r.has_value = md->value == ent->value;
@@ -46,13 +46,13 @@
 /* Initial table size as per the spec */
 #define GRPC_CHTTP2_INITIAL_HPACK_TABLE_SIZE 4096
 /* Maximum table size that we'll use */
-#define GRPC_CHTTP2_MAX_HPACK_TABLE_SIZE GRPC_CHTTP2_INITIAL_HPACK_TABLE_SIZE
+#define GRPC_CHTTP2_MAX_HPACK_TABLE_SIZE (1024 * 1024)
 /* Per entry overhead bytes as per the spec */
 #define GRPC_CHTTP2_HPACK_ENTRY_OVERHEAD 32
-/* Maximum number of entries we could possibly fit in the table, given defined
-   overheads */
-#define GRPC_CHTTP2_MAX_TABLE_COUNT                                            \
-  ((GRPC_CHTTP2_MAX_HPACK_TABLE_SIZE + GRPC_CHTTP2_HPACK_ENTRY_OVERHEAD - 1) / \
+/* Maximum number of entries we could possibly fit in a table of some size,
+   given defined overheads */
+#define GRPC_CHTTP2_TABLE_COUNT_FOR_SIZE(size)       \
+  (((size) + GRPC_CHTTP2_HPACK_ENTRY_OVERHEAD - 1) / \
    GRPC_CHTTP2_HPACK_ENTRY_OVERHEAD)
 
 /* hpack decoder table */
@@ -64,15 +64,20 @@ typedef struct {
   gpr_uint16 last_ent;
   /* how many entries are in the table */
   gpr_uint16 num_ents;
+  /* how many entries fit in ents */
+  gpr_uint16 cap_entries;
   /* the amount of memory used by the table, according to the hpack algorithm */
-  gpr_uint16 mem_used;
+  gpr_uint32 mem_used;
   /* the max memory allowed to be used by the table, according to the hpack
-     algorithm */
-  gpr_uint16 max_bytes;
+     algorithm: the encoder moves this with dynamic table size updates */
+  gpr_uint32 max_bytes;
+  /* the largest max_bytes the encoder may ask for: our
+     SETTINGS_HEADER_TABLE_SIZE */
+  gpr_uint32 max_bytes_limit;
   /* a circular buffer of headers - this is stored in the opposite order to
      what hpack specifies, in order to simplify table management a little...
      meaning lookups need to SUBTRACT from the end position */
-  grpc_mdelem *ents[GRPC_CHTTP2_MAX_TABLE_COUNT];
+  grpc_mdelem **ents;
   grpc_mdelem *static_ents[GRPC_CHTTP2_LAST_STATIC_ENTRY];
 } grpc_chttp2_hptbl;
 
@@ -80,6 +85,20 @@ typedef struct {
 void grpc_chttp2_hptbl_init(grpc_chttp2_hptbl *tbl, grpc_mdctx *mdctx);
 void grpc_chttp2_hptbl_destroy(grpc_chttp2_hptbl *tbl);
 
+/* create the elements of the static table, in index order (index 1 first),
+   into ents, which must have room for GRPC_CHTTP2_LAST_STATIC_ENTRY */
+void grpc_chttp2_hptbl_create_static_elems(grpc_mdctx *mdctx,
+                                           grpc_mdelem **ents);
+
+/* set the SETTINGS_HEADER_TABLE_SIZE we advertise; must be at most
+   GRPC_CHTTP2_MAX_HPACK_TABLE_SIZE */
+void grpc_chttp2_hptbl_set_max_bytes_limit(grpc_chttp2_hptbl *tbl,
+                                           gpr_uint32 max_bytes_limit);
+/* apply a dynamic table size update from the encoder: returns 0 if it asks
+   for more than max_bytes_limit */
+int grpc_chttp2_hptbl_set_max_bytes(grpc_chttp2_hptbl *tbl,
+                                    gpr_uint32 max_bytes);
+
 /* lookup a table entry based on its hpack index */
 grpc_mdelem *grpc_chttp2_hptbl_lookup(const grpc_chttp2_hptbl *tbl,
                                       gpr_uint32 index);
@@ -38,6 +38,7 @@
 #include "src/core/transport/chttp2/frame.h"
 #include "src/core/transport/chttp2/frame_data.h"
 #include "src/core/transport/chttp2/frame_goaway.h"
+#include "src/core/transport/chttp2/bdp_estimator.h"
 #include "src/core/transport/chttp2/frame_ping.h"
 #include "src/core/transport/chttp2/frame_rst_stream.h"
 #include "src/core/transport/chttp2/frame_settings.h"
@@ -123,6 +124,9 @@ typedef enum {
 #define GRPC_CHTTP2_WRITING_DATA 1
 #define GRPC_CHTTP2_WRITING_WINDOW 2
 
+/* Largest write weight a stream may ask for */
+#define GRPC_CHTTP2_MAX_WRITE_WEIGHT 256
+
 typedef enum {
   GRPC_DONT_SEND_CLOSED = 0,
   GRPC_SEND_CLOSED,
@@ -170,6 +174,18 @@ typedef struct {
   gpr_uint32 incoming_window;
   /** how much window would we like to have for incoming_window */
   gpr_uint32 connection_window_target;
+  /** how much window would we like each stream to have, regardless of how
+      much the application has asked to read (from the bdp estimate) */
+  gpr_uint32 stream_window_target;
+  /** upper bound on incoming window granted across all streams */
+  gpr_uint32 flow_control_budget;
+  /** bytes a stream may write per unit of write weight each time the write
+      scheduler visits it; zero lets each stream take the whole window */
+  gpr_uint32 write_quantum;
+  /** write weight of streams that do not ask for one */
+  gpr_uint32 default_write_weight;
+  /** metadata key through which a stream asks for a write weight */
+  grpc_mdstr *str_grpc_write_weight;
 
   /** have we seen a goaway */
   gpr_uint8 seen_goaway;
@@ -233,6 +249,7 @@ struct grpc_chttp2_transport_parsing {
   gpr_slice_buffer qbuf;
   /* metadata object cache */
   grpc_mdstr *str_grpc_timeout;
+  grpc_mdstr *str_grpc_write_weight;
   /** parser for headers */
   grpc_chttp2_hpack_parser hpack_parser;
   /** simple one shot parsers */
@@ -280,8 +297,16 @@ struct grpc_chttp2_transport_parsing {
 
   gpr_int64 outgoing_window_update;
 
-  /** pings awaiting responses */
+  /** pings awaiting responses: moved here from the global state for the
+      duration of parsing */
   grpc_chttp2_outstanding_ping pings;
+
+  /** bandwidth-delay product estimation */
+  grpc_chttp2_bdp_estimator bdp_estimator;
+  /** are we probing the bdp? */
+  gpr_uint8 bdp_probing;
+  /** did the bdp estimate change? */
+  gpr_uint8 bdp_estimate_updated;
 };
 
 struct grpc_chttp2_transport {
@@ -363,6 +388,9 @@ typedef struct {
 
   /** window available for us to send to peer */
   gpr_int64 outgoing_window;
+  /** share of each write scheduler round this stream may use, in units of
+      write_quantum */
+  gpr_uint32 write_weight;
   /** The number of bytes the upper layers have offered to receive.
       As the upper layer offers more bytes, this value increases.
       As bytes are read, this value decreases. */
@@ -438,6 +466,8 @@ struct grpc_chttp2_stream_parsing {
   gpr_uint32 rst_stream_reason;
   /* amount of window given */
   gpr_uint64 outgoing_window_update;
+  /** write weight asked for by the peer, or zero */
+  gpr_uint32 write_weight;
 
   /** incoming metadata */
   grpc_chttp2_incoming_metadata_buffer incoming_metadata;
@@ -475,6 +505,9 @@ void grpc_chttp2_terminate_writing(grpc_exec_ctx *exec_ctx,
 void grpc_chttp2_cleanup_writing(grpc_exec_ctx *exec_ctx,
                                  grpc_chttp2_transport_global *global,
                                  grpc_chttp2_transport_writing *writing);
+/** Parse a write weight metadata value; returns 0 if it is not a number
+    between 1 and GRPC_CHTTP2_MAX_WRITE_WEIGHT */
+int grpc_chttp2_parse_write_weight(grpc_mdstr *value, gpr_uint32 *weight);
 
 void grpc_chttp2_prepare_to_read(grpc_chttp2_transport_global *global,
                                  grpc_chttp2_transport_parsing *parsing);
@@ -500,6 +533,8 @@ int grpc_chttp2_list_pop_writable_stream(
     grpc_chttp2_transport_writing *transport_writing,
     grpc_chttp2_stream_global **stream_global,
     grpc_chttp2_stream_writing **stream_writing);
+int grpc_chttp2_list_have_writable_streams(
+    grpc_chttp2_transport_global *transport_global);
 void grpc_chttp2_list_remove_writable_stream(
     grpc_chttp2_transport_global *transport_global,
     grpc_chttp2_stream_global *stream_global);
@@ -62,6 +62,17 @@ static int parse_frame_slice(grpc_exec_ctx *exec_ctx,
                              grpc_chttp2_transport_parsing *transport_parsing,
                              gpr_slice slice, int is_last);
 
+/* Append every ping in the list headed by from to the list headed by to */
+static void move_pings(grpc_chttp2_outstanding_ping *from,
+                       grpc_chttp2_outstanding_ping *to) {
+  if (from->next == from) return;
+  from->next->prev = to->prev;
+  from->prev->next = to;
+  to->prev->next = from->next;
+  to->prev = from->prev;
+  from->next = from->prev = from;
+}
+
 void grpc_chttp2_prepare_to_read(
     grpc_chttp2_transport_global *transport_global,
     grpc_chttp2_transport_parsing *transport_parsing) {
@@ -70,6 +81,9 @@ void grpc_chttp2_prepare_to_read(
 
   transport_parsing->next_stream_id = transport_global->next_stream_id;
 
+  /* outstanding pings are matched against acks while parsing */
+  move_pings(&transport_global->pings, &transport_parsing->pings);
+
   /* update the parsing view of incoming window */
   if (transport_parsing->incoming_window != transport_global->incoming_window) {
     GRPC_CHTTP2_FLOWCTL_TRACE_TRANSPORT(
@@ -113,6 +127,9 @@ void grpc_chttp2_publish_reads(
   /* copy parsing qbuf to global qbuf */
   gpr_slice_buffer_move_into(&transport_parsing->qbuf, &transport_global->qbuf);
 
+  /* return unacknowledged pings to the global state */
+  move_pings(&transport_parsing->pings, &transport_global->pings);
+
   /* update global settings */
   if (transport_parsing->settings_updated) {
     memcpy(transport_global->settings[GRPC_PEER_SETTINGS],
@@ -185,6 +202,11 @@ void grpc_chttp2_publish_reads(
       grpc_chttp2_list_add_writable_stream(transport_global, stream_global);
     }
 
+    if (stream_parsing->write_weight) {
+      stream_global->write_weight = stream_parsing->write_weight;
+      stream_parsing->write_weight = 0;
+    }
+
     /* update outgoing flow control window */
     if (stream_parsing->outgoing_window_update) {
       int was_zero = stream_global->outgoing_window <= 0;
@@ -544,6 +566,19 @@ static grpc_chttp2_parse_error update_incoming_window(
       transport_parsing->incoming_frame_size;
   grpc_chttp2_list_add_parsing_seen_stream(transport_parsing, stream_parsing);
 
+  /* data arriving while no probe is in flight starts a new bdp probe */
+  if (transport_parsing->bdp_probing &&
+      transport_parsing->incoming_frame_size > 0 &&
+      grpc_chttp2_bdp_estimator_add_incoming_bytes(
+          &transport_parsing->bdp_estimator,
+          transport_parsing->incoming_frame_size)) {
+    grpc_chttp2_bdp_estimator_start_ping(&transport_parsing->bdp_estimator,
+                                         gpr_now(GPR_CLOCK_MONOTONIC));
+    gpr_slice_buffer_add(
+        &transport_parsing->qbuf,
+        grpc_chttp2_ping_create(0, (gpr_uint8 *)grpc_chttp2_bdp_ping_id));
+  }
+
   return GRPC_CHTTP2_PARSE_OK;
 }
 
@@ -617,6 +652,14 @@ static void on_header(void *tp, grpc_mdelem *md) {
         gpr_time_add(gpr_now(GPR_CLOCK_MONOTONIC), *cached_timeout));
     GRPC_MDELEM_UNREF(md);
   } else {
+    /* the peer's write weight also weighs what we send back on the stream */
+    if (md->key == transport_parsing->str_grpc_write_weight &&
+        !grpc_chttp2_parse_write_weight(md->value,
+                                        &stream_parsing->write_weight)) {
+      gpr_log(GPR_ERROR, "Ignoring bad %s value '%s'",
+              GRPC_WRITE_WEIGHT_METADATA_KEY,
+              grpc_mdstr_as_c_string(md->value));
+    }
     grpc_chttp2_incoming_metadata_buffer_add(&stream_parsing->incoming_metadata,
                                              md);
   }
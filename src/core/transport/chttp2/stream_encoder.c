@@ -36,23 +36,34 @@
 #include <assert.h>
 #include <string.h>
 
+#include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
 #include <grpc/support/useful.h>
 #include "src/core/transport/chttp2/bin_encoder.h"
-#include "src/core/transport/chttp2/hpack_table.h"
 #include "src/core/transport/chttp2/timeout_encoding.h"
 #include "src/core/transport/chttp2/varint.h"
 
 #define HASH_FRAGMENT_1(x) ((x)&255)
-#define HASH_FRAGMENT_2(x) ((x >> 8) & 255)
-#define HASH_FRAGMENT_3(x) ((x >> 16) & 255)
-#define HASH_FRAGMENT_4(x) ((x >> 24) & 255)
+#define HASH_FRAGMENT_2(x) ((x >> 8) & (GRPC_CHTTP2_HPACKC_NUM_VALUES - 1))
+#define HASH_FRAGMENT_3(x)                            \
+  ((x >> (8 + GRPC_CHTTP2_HPACKC_NUM_VALUES_BITS)) & \
+   (GRPC_CHTTP2_HPACKC_NUM_VALUES - 1))
+#define STATIC_SLOT(x) ((x) & (GRPC_CHTTP2_HPACKC_NUM_STATIC_SLOTS - 1))
+#define SEEN_ELEM_BIT(x) ((x) >> 19)
 
 /* if the probability of this item being seen again is < 1/x then don't add
    it to the table */
 #define ONE_ON_ADD_PROBABILITY 128
-/* don't consider adding anything bigger than this to the hpack table */
-#define MAX_DECODER_SPACE_USAGE 512
+/* don't consider adding anything bigger than 1/x of the table to the hpack
+   table */
+#define ONE_ON_MAX_DECODER_SPACE_USAGE 8
+/* a key is high entropy once its novelty - new values less repeated ones -
+   reaches this, and its values are then never indexed */
+#define HIGH_ENTROPY_KEY_NOVELTY 8
+#define MAX_KEY_NOVELTY (2 * HIGH_ENTROPY_KEY_NOVELTY)
+/* forget which elements we've seen after marking this many: keeps the set
+   sparse enough that a new element rarely looks like an old one */
+#define SEEN_ELEMS_RESET (GRPC_CHTTP2_HPACKC_SEEN_ELEMS_BITS / 8)
 
 /* what kind of frame our we encoding? */
 typedef enum { HEADER, DATA, NONE } frame_type;
@@ -181,6 +192,19 @@ static gpr_uint8 *add_tiny_header_data(framer_state *st, size_t len) {
   return gpr_slice_buffer_tiny_add(st->output, len);
 }
 
+/* drop the oldest entry of the decoder table */
+static void evict_entry(grpc_chttp2_hpack_compressor *c) {
+  c->tail_remote_index++;
+  GPR_ASSERT(c->tail_remote_index > 0);
+  GPR_ASSERT(c->table_size >=
+             c->table_elem_size[c->tail_remote_index % c->max_table_elems]);
+  GPR_ASSERT(c->table_elems > 0);
+  c->table_size = (gpr_uint32)(
+      c->table_size -
+      c->table_elem_size[c->tail_remote_index % c->max_table_elems]);
+  c->table_elems--;
+}
+
 /* add an element to the decoder table: returns metadata element to unref */
 static grpc_mdelem *add_elem(grpc_chttp2_hpack_compressor *c,
                              grpc_mdelem *elem) {
@@ -196,24 +220,13 @@ static grpc_mdelem *add_elem(grpc_chttp2_hpack_compressor *c,
   /* Reserve space for this element in the remote table: if this overflows
      the current table, drop elements until it fits, matching the decompressor
      algorithm */
-  /* TODO(ctiller): constant */
-  while (c->table_size + elem_size > 4096) {
-    c->tail_remote_index++;
-    GPR_ASSERT(c->tail_remote_index > 0);
-    GPR_ASSERT(c->table_size >=
-               c->table_elem_size[c->tail_remote_index %
-                                  GRPC_CHTTP2_HPACKC_MAX_TABLE_ELEMS]);
-    GPR_ASSERT(c->table_elems > 0);
-    c->table_size =
-        (gpr_uint16)(c->table_size -
-                     c->table_elem_size[c->tail_remote_index %
-                                        GRPC_CHTTP2_HPACKC_MAX_TABLE_ELEMS]);
-    c->table_elems--;
-  }
-  GPR_ASSERT(c->table_elems < GRPC_CHTTP2_HPACKC_MAX_TABLE_ELEMS);
-  c->table_elem_size[new_index % GRPC_CHTTP2_HPACKC_MAX_TABLE_ELEMS] =
-      (gpr_uint16)elem_size;
-  c->table_size = (gpr_uint16)(c->table_size + elem_size);
+  GPR_ASSERT(elem_size <= c->max_table_size);
+  while (c->table_size + elem_size > c->max_table_size) {
+    evict_entry(c);
+  }
+  GPR_ASSERT(c->table_elems < c->max_table_elems);
+  c->table_elem_size[new_index % c->max_table_elems] = (gpr_uint16)elem_size;
+  c->table_size = (gpr_uint32)(c->table_size + elem_size);
   c->table_elems++;
 
   /* Store this element into {entries,indices}_elem */
@@ -304,7 +317,7 @@ static void emit_lithdr_incidx(grpc_chttp2_hpack_compressor *c,
   len_val_len = GRPC_CHTTP2_VARINT_LENGTH((gpr_uint32)len_val, 1);
   GRPC_CHTTP2_WRITE_VARINT(key_index, 2, 0x40,
                            add_tiny_header_data(st, len_pfx), len_pfx);
-  GRPC_CHTTP2_WRITE_VARINT((gpr_uint32)len_val, 1, 0x00,
+  GRPC_CHTTP2_WRITE_VARINT((gpr_uint32)len_val, 1, huffman_prefix,
                            add_tiny_header_data(st, len_val_len), len_val_len);
   add_header_data(st, gpr_slice_ref(value_slice));
 }
@@ -321,7 +334,7 @@ static void emit_lithdr_noidx(grpc_chttp2_hpack_compressor *c,
   len_val_len = GRPC_CHTTP2_VARINT_LENGTH((gpr_uint32)len_val, 1);
   GRPC_CHTTP2_WRITE_VARINT(key_index, 4, 0x00,
                            add_tiny_header_data(st, len_pfx), len_pfx);
-  GRPC_CHTTP2_WRITE_VARINT((gpr_uint32)len_val, 1, 0x00,
+  GRPC_CHTTP2_WRITE_VARINT((gpr_uint32)len_val, 1, huffman_prefix,
                            add_tiny_header_data(st, len_val_len), len_val_len);
   add_header_data(st, gpr_slice_ref(value_slice));
 }
@@ -364,12 +377,82 @@ static void emit_lithdr_noidx_v(grpc_chttp2_hpack_compressor *c,
   add_header_data(st, gpr_slice_ref(value_slice));
 }
 
+static void emit_lithdr_nvridx(grpc_chttp2_hpack_compressor *c,
+                               gpr_uint32 key_index, grpc_mdelem *elem,
+                               framer_state *st) {
+  gpr_uint32 len_pfx = GRPC_CHTTP2_VARINT_LENGTH(key_index, 4);
+  gpr_uint8 huffman_prefix;
+  gpr_slice value_slice = get_wire_value(elem, &huffman_prefix);
+  size_t len_val = GPR_SLICE_LENGTH(value_slice);
+  gpr_uint32 len_val_len;
+  GPR_ASSERT(len_val <= GPR_UINT32_MAX);
+  len_val_len = GRPC_CHTTP2_VARINT_LENGTH((gpr_uint32)len_val, 1);
+  GRPC_CHTTP2_WRITE_VARINT(key_index, 4, 0x10,
+                           add_tiny_header_data(st, len_pfx), len_pfx);
+  GRPC_CHTTP2_WRITE_VARINT((gpr_uint32)len_val, 1, huffman_prefix,
+                           add_tiny_header_data(st, len_val_len), len_val_len);
+  add_header_data(st, gpr_slice_ref(value_slice));
+}
+
+static void emit_lithdr_nvridx_v(grpc_chttp2_hpack_compressor *c,
+                                 grpc_mdelem *elem, framer_state *st) {
+  gpr_uint32 len_key = (gpr_uint32)GPR_SLICE_LENGTH(elem->key->slice);
+  gpr_uint8 huffman_prefix;
+  gpr_slice value_slice = get_wire_value(elem, &huffman_prefix);
+  gpr_uint32 len_val = (gpr_uint32)GPR_SLICE_LENGTH(value_slice);
+  gpr_uint32 len_key_len = GRPC_CHTTP2_VARINT_LENGTH(len_key, 1);
+  gpr_uint32 len_val_len = GRPC_CHTTP2_VARINT_LENGTH(len_val, 1);
+  GPR_ASSERT(len_key <= GPR_UINT32_MAX);
+  GPR_ASSERT(GPR_SLICE_LENGTH(value_slice) <= GPR_UINT32_MAX);
+  *add_tiny_header_data(st, 1) = 0x10;
+  GRPC_CHTTP2_WRITE_VARINT(len_key, 1, 0x00,
+                           add_tiny_header_data(st, len_key_len), len_key_len);
+  add_header_data(st, gpr_slice_ref(elem->key->slice));
+  GRPC_CHTTP2_WRITE_VARINT(len_val, 1, huffman_prefix,
+                           add_tiny_header_data(st, len_val_len), len_val_len);
+  add_header_data(st, gpr_slice_ref(value_slice));
+}
+
+static void emit_advertise_table_size_change(grpc_chttp2_hpack_compressor *c,
+                                             framer_state *st) {
+  gpr_uint32 len = GRPC_CHTTP2_VARINT_LENGTH(c->max_table_size, 3);
+  GRPC_CHTTP2_WRITE_VARINT(c->max_table_size, 3, 0x20,
+                           add_tiny_header_data(st, len), len);
+  c->advertise_table_size_change = 0;
+}
+
 static gpr_uint32 dynidx(grpc_chttp2_hpack_compressor *c,
 			 gpr_uint32 elem_index) {
   return 1 + GRPC_CHTTP2_LAST_STATIC_ENTRY + c->tail_remote_index +
          c->table_elems - elem_index;
 }
 
+/* static table index of elem, or 0 if it's not there */
+static gpr_uint32 static_elem_index(grpc_chttp2_hpack_compressor *c,
+                                    grpc_mdelem *elem, gpr_uint32 elem_hash) {
+  gpr_uint32 slot = STATIC_SLOT(elem_hash);
+  while (c->static_slot_elems[slot] != NULL) {
+    if (c->static_slot_elems[slot] == elem) {
+      return c->static_slot_elem_index[slot];
+    }
+    slot = STATIC_SLOT(slot + 1);
+  }
+  return 0;
+}
+
+/* lowest static table index with key, or 0 if it's not there */
+static gpr_uint32 static_key_index(grpc_chttp2_hpack_compressor *c,
+                                   grpc_mdstr *key) {
+  gpr_uint32 slot = STATIC_SLOT(key->hash);
+  while (c->static_slot_keys[slot] != NULL) {
+    if (c->static_slot_keys[slot] == key) {
+      return c->static_slot_key_index[slot];
+    }
+    slot = STATIC_SLOT(slot + 1);
+  }
+  return 0;
+}
+
 /* encode an mdelem; returns metadata element to unref */
 static grpc_mdelem *hpack_enc(grpc_chttp2_hpack_compressor *c,
                               grpc_mdelem *elem, framer_state *st) {
@@ -377,6 +460,12 @@ static grpc_mdelem *hpack_enc(grpc_chttp2_hpack_compressor *c,
   gpr_uint32 elem_hash = GRPC_MDSTR_KV_HASH(key_hash, elem->value->hash);
   size_t decoder_space_usage;
   gpr_uint32 indices_key;
+  gpr_uint32 key_index;
+  gpr_uint32 static_index;
+  gpr_uint8 *novelty;
+  gpr_uint8 *seen_byte;
+  gpr_uint8 seen_mask;
+  int high_entropy;
   int should_add_elem;
 
   GPR_ASSERT(GPR_SLICE_LENGTH(elem->key->slice) > 0);
@@ -390,6 +479,32 @@ static grpc_mdelem *hpack_enc(grpc_chttp2_hpack_compressor *c,
 
   inc_filter(HASH_FRAGMENT_1(elem_hash), &c->filter_elems_sum, c->filter_elems);
 
+  /* a value we've not seen lately makes its key look more random; a repeated
+     one makes it look less so */
+  novelty = &c->key_novelty[HASH_FRAGMENT_2(key_hash)];
+  seen_byte = &c->seen_elems[SEEN_ELEM_BIT(elem_hash) / 8];
+  seen_mask = (gpr_uint8)(1 << (SEEN_ELEM_BIT(elem_hash) % 8));
+  if ((*seen_byte & seen_mask) == 0) {
+    if (*novelty < MAX_KEY_NOVELTY) (*novelty)++;
+    if (++c->seen_elems_count == SEEN_ELEMS_RESET) {
+      memset(c->seen_elems, 0, sizeof(c->seen_elems));
+      c->seen_elems_count = 0;
+    }
+    *seen_byte |= seen_mask;
+  } else if (*novelty > 0) {
+    (*novelty)--;
+  }
+  high_entropy = *novelty >= HIGH_ENTROPY_KEY_NOVELTY;
+
+  /* is this elem in the static table? */
+
+  static_index = static_elem_index(c, elem, elem_hash);
+  if (static_index != 0) {
+    /* HIT: static element */
+    emit_indexed(c, static_index, st);
+    return elem;
+  }
+
   /* is this elem currently in the decoders table? */
 
   if (c->entries_elems[HASH_FRAGMENT_2(elem_hash)] == elem &&
@@ -411,38 +526,52 @@ static grpc_mdelem *hpack_enc(grpc_chttp2_hpack_compressor *c,
   /* should this elem be in the table? */
   decoder_space_usage = 32 + GPR_SLICE_LENGTH(elem->key->slice) +
                         GPR_SLICE_LENGTH(elem->value->slice);
-  should_add_elem = decoder_space_usage < MAX_DECODER_SPACE_USAGE &&
-                    c->filter_elems[HASH_FRAGMENT_1(elem_hash)] >=
-                        c->filter_elems_sum / ONE_ON_ADD_PROBABILITY;
+  should_add_elem =
+      !high_entropy &&
+      decoder_space_usage <
+          c->max_table_size / ONE_ON_MAX_DECODER_SPACE_USAGE &&
+      c->filter_elems[HASH_FRAGMENT_1(elem_hash)] >=
+          c->filter_elems_sum / ONE_ON_ADD_PROBABILITY;
 
   /* no hits for the elem... maybe there's a key? */
 
+  key_index = 0;
   indices_key = c->indices_keys[HASH_FRAGMENT_2(key_hash)];
   if (c->entries_keys[HASH_FRAGMENT_2(key_hash)] == elem->key &&
       indices_key > c->tail_remote_index) {
     /* HIT: key (first cuckoo hash) */
-    if (should_add_elem) {
-      emit_lithdr_incidx(c, dynidx(c, indices_key), elem, st);
-      return add_elem(c, elem);
+    key_index = dynidx(c, indices_key);
+  } else {
+    indices_key = c->indices_keys[HASH_FRAGMENT_3(key_hash)];
+    if (c->entries_keys[HASH_FRAGMENT_3(key_hash)] == elem->key &&
+        indices_key > c->tail_remote_index) {
+      /* HIT: key (second cuckoo hash) */
+      key_index = dynidx(c, indices_key);
     } else {
-      emit_lithdr_noidx(c, dynidx(c, indices_key), elem, st);
-      return elem;
+      /* HIT: key (static table), or no key at all */
+      key_index = static_key_index(c, elem->key);
     }
-    abort();
   }
 
-  indices_key = c->indices_keys[HASH_FRAGMENT_3(key_hash)];
-  if (c->entries_keys[HASH_FRAGMENT_3(key_hash)] == elem->key &&
-      indices_key > c->tail_remote_index) {
-    /* HIT: key (first cuckoo hash) */
+  if (key_index == 0 && high_entropy &&
+      decoder_space_usage <
+          c->max_table_size / ONE_ON_MAX_DECODER_SPACE_USAGE) {
+    /* the value isn't worth indexing, but its key is: index this element
+       for the sake of the key alone, so the values that follow can refer
+       to it */
+    should_add_elem = 1;
+  }
+
+  if (key_index != 0) {
     if (should_add_elem) {
-      emit_lithdr_incidx(c, dynidx(c, indices_key), elem, st);
+      emit_lithdr_incidx(c, key_index, elem, st);
       return add_elem(c, elem);
+    } else if (high_entropy) {
+      emit_lithdr_nvridx(c, key_index, elem, st);
     } else {
-      emit_lithdr_noidx(c, dynidx(c, indices_key), elem, st);
-      return elem;
+      emit_lithdr_noidx(c, key_index, elem, st);
     }
-    abort();
+    return elem;
   }
 
   /* no elem, key in the table... fall back to literal emission */
@@ -450,11 +579,12 @@ static grpc_mdelem *hpack_enc(grpc_chttp2_hpack_compressor *c,
   if (should_add_elem) {
     emit_lithdr_incidx_v(c, elem, st);
     return add_elem(c, elem);
+  } else if (high_entropy) {
+    emit_lithdr_nvridx_v(c, elem, st);
   } else {
     emit_lithdr_noidx_v(c, elem, st);
-    return elem;
   }
-  abort();
+  return elem;
 }
 
 #define STRLEN_LIT(x) (sizeof(x) - 1)
@@ -481,9 +611,40 @@ gpr_slice grpc_chttp2_data_frame_create_empty_close(gpr_uint32 id) {
 
 void grpc_chttp2_hpack_compressor_init(grpc_chttp2_hpack_compressor *c,
                                        grpc_mdctx *ctx) {
+  gpr_uint32 i;
+  gpr_uint32 slot;
+  grpc_mdelem *elem;
   memset(c, 0, sizeof(*c));
   c->mdctx = ctx;
   c->timeout_key_str = grpc_mdstr_from_string(ctx, "grpc-timeout");
+  c->max_table_size = GRPC_CHTTP2_INITIAL_HPACK_TABLE_SIZE;
+  c->max_usable_size = GRPC_CHTTP2_HPACKC_DEFAULT_MAX_USABLE_SIZE;
+  c->max_table_elems =
+      GRPC_CHTTP2_TABLE_COUNT_FOR_SIZE(GRPC_CHTTP2_INITIAL_HPACK_TABLE_SIZE);
+  c->table_elem_size =
+      gpr_malloc(sizeof(*c->table_elem_size) * c->max_table_elems);
+  memset(c->table_elem_size, 0,
+         sizeof(*c->table_elem_size) * c->max_table_elems);
+
+  /* hash the static table: a key is found at the first index it appears at */
+  grpc_chttp2_hptbl_create_static_elems(ctx, c->static_elems);
+  for (i = 0; i < GRPC_CHTTP2_LAST_STATIC_ENTRY; i++) {
+    elem = c->static_elems[i];
+    slot = STATIC_SLOT(GRPC_MDSTR_KV_HASH(elem->key->hash, elem->value->hash));
+    while (c->static_slot_elems[slot] != NULL) {
+      slot = STATIC_SLOT(slot + 1);
+    }
+    c->static_slot_elems[slot] = elem;
+    c->static_slot_elem_index[slot] = (gpr_uint8)(i + 1);
+    if (static_key_index(c, elem->key) == 0) {
+      slot = STATIC_SLOT(elem->key->hash);
+      while (c->static_slot_keys[slot] != NULL) {
+        slot = STATIC_SLOT(slot + 1);
+      }
+      c->static_slot_keys[slot] = elem->key;
+      c->static_slot_key_index[slot] = (gpr_uint8)(i + 1);
+    }
+  }
 }
 
 void grpc_chttp2_hpack_compressor_destroy(grpc_chttp2_hpack_compressor *c) {
@@ -492,7 +653,55 @@ void grpc_chttp2_hpack_compressor_destroy(grpc_chttp2_hpack_compressor *c) {
     if (c->entries_keys[i]) GRPC_MDSTR_UNREF(c->entries_keys[i]);
     if (c->entries_elems[i]) GRPC_MDELEM_UNREF(c->entries_elems[i]);
   }
+  for (i = 0; i < GRPC_CHTTP2_LAST_STATIC_ENTRY; i++) {
+    GRPC_MDELEM_UNREF(c->static_elems[i]);
+  }
   GRPC_MDSTR_UNREF(c->timeout_key_str);
+  gpr_free(c->table_elem_size);
+}
+
+void grpc_chttp2_hpack_compressor_set_max_usable_size(
+    grpc_chttp2_hpack_compressor *c, gpr_uint32 max_usable_size) {
+  c->max_usable_size = max_usable_size;
+  if (c->max_table_size > max_usable_size) {
+    grpc_chttp2_hpack_compressor_set_max_table_size(c, max_usable_size);
+  }
+}
+
+static void rebuild_elems(grpc_chttp2_hpack_compressor *c, gpr_uint32 new_cap) {
+  gpr_uint16 *table_elem_size = gpr_malloc(sizeof(*table_elem_size) * new_cap);
+  gpr_uint32 i;
+
+  memset(table_elem_size, 0, sizeof(*table_elem_size) * new_cap);
+  GPR_ASSERT(c->table_elems <= new_cap);
+
+  for (i = 0; i < c->table_elems; i++) {
+    gpr_uint32 ofs = c->tail_remote_index + i + 1;
+    table_elem_size[ofs % new_cap] =
+        c->table_elem_size[ofs % c->max_table_elems];
+  }
+
+  c->max_table_elems = new_cap;
+  gpr_free(c->table_elem_size);
+  c->table_elem_size = table_elem_size;
+}
+
+void grpc_chttp2_hpack_compressor_set_max_table_size(
+    grpc_chttp2_hpack_compressor *c, gpr_uint32 max_table_size) {
+  gpr_uint32 new_cap;
+  max_table_size = GPR_MIN(max_table_size, c->max_usable_size);
+  if (max_table_size == c->max_table_size) {
+    return;
+  }
+  while (c->table_size > 0 && c->table_size > max_table_size) {
+    evict_entry(c);
+  }
+  c->max_table_size = max_table_size;
+  new_cap = GPR_MAX(GRPC_CHTTP2_TABLE_COUNT_FOR_SIZE(max_table_size), 1);
+  if (new_cap > c->max_table_elems) {
+    rebuild_elems(c, new_cap);
+  }
+  c->advertise_table_size_change = 1;
 }
 
 gpr_uint32 grpc_chttp2_preencode(grpc_stream_op *inops, size_t *inops_count,
@@ -612,6 +821,9 @@ void grpc_chttp2_encode(grpc_stream_op *ops, size_t ops_count, int eof,
            slot. THIS MAY NOT BE THE SAME ELEMENT (if a decoder table slot got
            updated). After this loop, we'll do a batch unref of elements. */
         begin_new_frame(&st, HEADER);
+        if (compressor->advertise_table_size_change) {
+          emit_advertise_table_size_change(compressor, &st);
+        }
         need_unref |= op->data.metadata.garbage.head != NULL;
         grpc_metadata_batch_assert_ok(&op->data.metadata);
         for (l = op->data.metadata.list.head; l; l = l->next) {
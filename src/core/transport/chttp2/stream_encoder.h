@@ -35,6 +35,7 @@
 #define GRPC_INTERNAL_CORE_TRANSPORT_CHTTP2_STREAM_ENCODER_H
 
 #include "src/core/transport/chttp2/frame.h"
+#include "src/core/transport/chttp2/hpack_table.h"
 #include "src/core/transport/metadata.h"
 #include "src/core/transport/stream_op.h"
 #include <grpc/support/port_platform.h>
@@ -42,15 +43,30 @@
 #include <grpc/support/slice_buffer.h>
 
 #define GRPC_CHTTP2_HPACKC_NUM_FILTERS 256
-#define GRPC_CHTTP2_HPACKC_NUM_VALUES 256
-#define GRPC_CHTTP2_HPACKC_MAX_TABLE_ELEMS (4096 / 32)
+#define GRPC_CHTTP2_HPACKC_NUM_VALUES_BITS 10
+#define GRPC_CHTTP2_HPACKC_NUM_VALUES (1 << GRPC_CHTTP2_HPACKC_NUM_VALUES_BITS)
+/* slots in the lookup tables for the static table's keys and elements */
+#define GRPC_CHTTP2_HPACKC_NUM_STATIC_SLOTS 128
+/* bits in the set of recently seen elements: indexed by the top 13 bits of
+   an element's hash */
+#define GRPC_CHTTP2_HPACKC_SEEN_ELEMS_BITS 8192
+/* largest table we'll use by default, if the peer lets us */
+#define GRPC_CHTTP2_HPACKC_DEFAULT_MAX_USABLE_SIZE (64 * 1024)
 
 typedef struct {
   gpr_uint32 filter_elems_sum;
+  /* the size of the decoder's table, as last told to it */
+  gpr_uint32 max_table_size;
+  /* how many entries fit in table_elem_size */
+  gpr_uint32 max_table_elems;
+  /* the largest max_table_size we're prepared to use */
+  gpr_uint32 max_usable_size;
   /* one before the lowest usable table index */
   gpr_uint32 tail_remote_index;
-  gpr_uint16 table_size;
-  gpr_uint16 table_elems;
+  gpr_uint32 table_size;
+  gpr_uint32 table_elems;
+  /* max_table_size changed: the next header block must start by saying so */
+  gpr_uint8 advertise_table_size_change;
 
   /* filter tables for elems: this tables provides an approximate
      popularity count for particular hashes, and are used to determine whether
@@ -58,6 +74,15 @@ typedef struct {
      They track a single integer that counts how often a particular value has
      been seen. When that count reaches max (255), all values are halved. */
   gpr_uint8 filter_elems[GRPC_CHTTP2_HPACKC_NUM_FILTERS];
+  /* per key hash: how many more of the key's recent values were new than
+     were repeats. Keys whose values keep changing (request ids, trace
+     contexts, timeouts) are emitted as never indexed literals rather than
+     flushing the table. */
+  gpr_uint8 key_novelty[GRPC_CHTTP2_HPACKC_NUM_VALUES];
+  /* which elements (by hash) have been seen lately, and how many bits have
+     been set since the set was last cleared */
+  gpr_uint8 seen_elems[GRPC_CHTTP2_HPACKC_SEEN_ELEMS_BITS / 8];
+  gpr_uint32 seen_elems_count;
 
   /* metadata context */
   grpc_mdctx *mdctx;
@@ -71,13 +96,30 @@ typedef struct {
   gpr_uint32 indices_keys[GRPC_CHTTP2_HPACKC_NUM_VALUES];
   gpr_uint32 indices_elems[GRPC_CHTTP2_HPACKC_NUM_VALUES];
 
-  gpr_uint16 table_elem_size[GRPC_CHTTP2_HPACKC_MAX_TABLE_ELEMS];
+  /* the static table, hashed by key and by element; indices are 0 for empty
+     slots */
+  grpc_mdelem *static_elems[GRPC_CHTTP2_LAST_STATIC_ENTRY];
+  grpc_mdstr *static_slot_keys[GRPC_CHTTP2_HPACKC_NUM_STATIC_SLOTS];
+  gpr_uint8 static_slot_key_index[GRPC_CHTTP2_HPACKC_NUM_STATIC_SLOTS];
+  grpc_mdelem *static_slot_elems[GRPC_CHTTP2_HPACKC_NUM_STATIC_SLOTS];
+  gpr_uint8 static_slot_elem_index[GRPC_CHTTP2_HPACKC_NUM_STATIC_SLOTS];
+
+  /* sizes of the entries in the decoder's table, by index modulo
+     max_table_elems */
+  gpr_uint16 *table_elem_size;
 } grpc_chttp2_hpack_compressor;
 
 void grpc_chttp2_hpack_compressor_init(grpc_chttp2_hpack_compressor *c,
                                        grpc_mdctx *mdctx);
 void grpc_chttp2_hpack_compressor_destroy(grpc_chttp2_hpack_compressor *c);
 
+/* limit the table to max_usable_size bytes, whatever the peer allows */
+void grpc_chttp2_hpack_compressor_set_max_usable_size(
+    grpc_chttp2_hpack_compressor *c, gpr_uint32 max_usable_size);
+/* the peer's SETTINGS_HEADER_TABLE_SIZE changed */
+void grpc_chttp2_hpack_compressor_set_max_table_size(
+    grpc_chttp2_hpack_compressor *c, gpr_uint32 max_table_size);
+
 /* select stream ops to be encoded, moving them from inops to outops, and
    moving subsequent ops in inops forward in the queue */
 gpr_uint32 grpc_chttp2_preencode(grpc_stream_op *inops, size_t *inops_count,
@@ -184,6 +184,12 @@ int grpc_chttp2_list_pop_writable_stream(
   return r;
 }
 
+int grpc_chttp2_list_have_writable_streams(
+    grpc_chttp2_transport_global *transport_global) {
+  return !stream_list_empty(TRANSPORT_FROM_GLOBAL(transport_global),
+                            GRPC_CHTTP2_LIST_WRITABLE);
+}
+
 void grpc_chttp2_list_remove_writable_stream(
     grpc_chttp2_transport_global *transport_global,
     grpc_chttp2_stream_global *stream_global) {
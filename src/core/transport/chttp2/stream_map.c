@@ -39,14 +39,65 @@
 #include <grpc/support/log.h>
 #include <grpc/support/useful.h>
 
+/* Fibonacci hashing: stream ids are sequential, and the multiplication
+   spreads them across the table */
+static size_t home_slot(grpc_chttp2_stream_map *map, gpr_uint32 key) {
+  gpr_uint32 h = key * 2654435761u;
+  return (size_t)(h ^ (h >> 16)) & (map->capacity - 1);
+}
+
+static void alloc_table(grpc_chttp2_stream_map *map, size_t capacity) {
+  map->keys = gpr_malloc(sizeof(gpr_uint32) * capacity);
+  memset(map->keys, 0, sizeof(gpr_uint32) * capacity);
+  map->values = gpr_malloc(sizeof(void *) * capacity);
+  map->capacity = capacity;
+}
+
+static void insert(grpc_chttp2_stream_map *map, gpr_uint32 key, void *value) {
+  size_t mask = map->capacity - 1;
+  size_t i = home_slot(map, key);
+  while (map->keys[i] != 0) {
+    i = (i + 1) & mask;
+  }
+  map->keys[i] = key;
+  map->values[i] = value;
+  map->count++;
+}
+
+/* keep the table at most 3/4 full */
+static void reserve(grpc_chttp2_stream_map *map, size_t count) {
+  gpr_uint32 *keys = map->keys;
+  void **values = map->values;
+  size_t capacity = map->capacity;
+  size_t new_capacity = capacity;
+  size_t i;
+
+  while (count > new_capacity / 4 * 3) {
+    new_capacity *= 2;
+  }
+  if (new_capacity == capacity) return;
+
+  alloc_table(map, new_capacity);
+  map->count = 0;
+  for (i = 0; i < capacity; i++) {
+    if (keys[i] != 0) {
+      insert(map, keys[i], values[i]);
+    }
+  }
+  gpr_free(keys);
+  gpr_free(values);
+}
+
 void grpc_chttp2_stream_map_init(grpc_chttp2_stream_map *map,
                                  size_t initial_capacity) {
+  size_t capacity = 2;
   GPR_ASSERT(initial_capacity > 1);
-  map->keys = gpr_malloc(sizeof(gpr_uint32) * initial_capacity);
-  map->values = gpr_malloc(sizeof(void *) * initial_capacity);
+  while (capacity < initial_capacity) {
+    capacity *= 2;
+  }
+  alloc_table(map, capacity);
   map->count = 0;
-  map->free = 0;
-  map->capacity = initial_capacity;
+  map->max_key = 0;
 }
 
 void grpc_chttp2_stream_map_destroy(grpc_chttp2_stream_map *map) {
@@ -54,134 +105,89 @@ void grpc_chttp2_stream_map_destroy(grpc_chttp2_stream_map *map) {
   gpr_free(map->values);
 }
 
-static size_t compact(gpr_uint32 *keys, void **values, size_t count) {
-  size_t i, out;
-
-  for (i = 0, out = 0; i < count; i++) {
-    if (values[i]) {
-      keys[out] = keys[i];
-      values[out] = values[i];
-      out++;
-    }
-  }
-
-  return out;
-}
-
 void grpc_chttp2_stream_map_add(grpc_chttp2_stream_map *map, gpr_uint32 key,
                                 void *value) {
-  size_t count = map->count;
-  size_t capacity = map->capacity;
-  gpr_uint32 *keys = map->keys;
-  void **values = map->values;
-
-  GPR_ASSERT(count == 0 || keys[count - 1] < key);
+  GPR_ASSERT(key > map->max_key);
   GPR_ASSERT(value);
 
-  if (count == capacity) {
-    if (map->free > capacity / 4) {
-      count = compact(keys, values, count);
-      map->free = 0;
-    } else {
-      /* resize when less than 25% of the table is free, because compaction
-         won't help much */
-      map->capacity = capacity = 3 * capacity / 2;
-      map->keys = keys = gpr_realloc(keys, capacity * sizeof(gpr_uint32));
-      map->values = values = gpr_realloc(values, capacity * sizeof(void *));
-    }
-  }
-
-  keys[count] = key;
-  values[count] = value;
-  map->count = count + 1;
+  reserve(map, map->count + 1);
+  insert(map, key, value);
+  map->max_key = key;
 }
 
 void grpc_chttp2_stream_map_move_into(grpc_chttp2_stream_map *src,
                                       grpc_chttp2_stream_map *dst) {
+  size_t i;
   /* if src is empty we dont need to do anything */
-  if (src->count == src->free) {
+  if (src->count == 0) {
     return;
   }
   /* if dst is empty we simply need to swap */
-  if (dst->count == dst->free) {
+  if (dst->count == 0) {
     GPR_SWAP(grpc_chttp2_stream_map, *src, *dst);
+    src->max_key = dst->max_key;
     return;
   }
-  /* the first element of src must be greater than the last of dst...
-   * however the maps may need compacting for this property to hold */
-  if (src->keys[0] <= dst->keys[dst->count - 1]) {
-    src->count = compact(src->keys, src->values, src->count);
-    src->free = 0;
-    dst->count = compact(dst->keys, dst->values, dst->count);
-    dst->free = 0;
-  }
-  GPR_ASSERT(src->keys[0] > dst->keys[dst->count - 1]);
-  /* if dst doesn't have capacity, resize */
-  if (dst->count + src->count > dst->capacity) {
-    dst->capacity = GPR_MAX(dst->capacity * 3 / 2, dst->count + src->count);
-    dst->keys = gpr_realloc(dst->keys, dst->capacity * sizeof(gpr_uint32));
-    dst->values = gpr_realloc(dst->values, dst->capacity * sizeof(void *));
+  reserve(dst, dst->count + src->count);
+  for (i = 0; i < src->capacity; i++) {
+    if (src->keys[i] != 0) {
+      GPR_ASSERT(src->keys[i] > dst->max_key);
+      insert(dst, src->keys[i], src->values[i]);
+      src->keys[i] = 0;
+    }
   }
-  memcpy(dst->keys + dst->count, src->keys, src->count * sizeof(gpr_uint32));
-  memcpy(dst->values + dst->count, src->values, src->count * sizeof(void *));
-  dst->count += src->count;
-  dst->free += src->free;
+  dst->max_key = src->max_key;
   src->count = 0;
-  src->free = 0;
 }
 
-static void **find(grpc_chttp2_stream_map *map, gpr_uint32 key) {
-  size_t min_idx = 0;
-  size_t max_idx = map->count;
-  size_t mid_idx;
-  gpr_uint32 *keys = map->keys;
-  void **values = map->values;
-  gpr_uint32 mid_key;
-
-  if (max_idx == 0) return NULL;
-
-  while (min_idx < max_idx) {
-    /* find the midpoint, avoiding overflow */
-    mid_idx = min_idx + ((max_idx - min_idx) / 2);
-    mid_key = keys[mid_idx];
-
-    if (mid_key < key) {
-      min_idx = mid_idx + 1;
-    } else if (mid_key > key) {
-      max_idx = mid_idx;
-    } else /* mid_key == key */
-    {
-      return &values[mid_idx];
+/* Returns the slot holding key, or capacity if it is absent */
+static size_t find(grpc_chttp2_stream_map *map, gpr_uint32 key) {
+  size_t mask = map->capacity - 1;
+  size_t i;
+
+  if (key == 0 || map->count == 0) return map->capacity;
+
+  for (i = home_slot(map, key); map->keys[i] != 0; i = (i + 1) & mask) {
+    if (map->keys[i] == key) {
+      return i;
     }
   }
 
-  return NULL;
+  return map->capacity;
 }
 
 void *grpc_chttp2_stream_map_delete(grpc_chttp2_stream_map *map,
                                     gpr_uint32 key) {
-  void **pvalue = find(map, key);
-  void *out = NULL;
-  if (pvalue != NULL) {
-    out = *pvalue;
-    *pvalue = NULL;
-    map->free += (out != NULL);
-    /* recognize complete emptyness and ensure we can skip
-     * defragmentation later */
-    if (map->free == map->count) {
-      map->free = map->count = 0;
+  size_t mask = map->capacity - 1;
+  size_t hole = find(map, key);
+  size_t i;
+  void *out;
+
+  if (hole == map->capacity) return NULL;
+
+  out = map->values[hole];
+  map->keys[hole] = 0;
+  map->count--;
+  /* pull later members of the probe run back into the hole whenever the hole
+     lies on their probe path, so that finds never stop short of them */
+  for (i = (hole + 1) & mask; map->keys[i] != 0; i = (i + 1) & mask) {
+    if (((i - home_slot(map, map->keys[i])) & mask) >= ((i - hole) & mask)) {
+      map->keys[hole] = map->keys[i];
+      map->values[hole] = map->values[i];
+      map->keys[i] = 0;
+      hole = i;
     }
   }
   return out;
 }
 
 void *grpc_chttp2_stream_map_find(grpc_chttp2_stream_map *map, gpr_uint32 key) {
-  void **pvalue = find(map, key);
-  return pvalue != NULL ? *pvalue : NULL;
+  size_t i = find(map, key);
+  return i != map->capacity ? map->values[i] : NULL;
 }
 
 size_t grpc_chttp2_stream_map_size(grpc_chttp2_stream_map *map) {
-  return map->count - map->free;
+  return map->count;
 }
 
 void grpc_chttp2_stream_map_for_each(grpc_chttp2_stream_map *map,
@@ -190,8 +196,8 @@ void grpc_chttp2_stream_map_for_each(grpc_chttp2_stream_map *map,
                                      void *user_data) {
   size_t i;
 
-  for (i = 0; i < map->count; i++) {
-    if (map->values[i]) {
+  for (i = 0; i < map->capacity; i++) {
+    if (map->keys[i] != 0) {
       f(user_data, map->keys[i], map->values[i]);
     }
   }
@@ -40,16 +40,20 @@
 
 /* Data structure to map a gpr_uint32 to a data object (represented by a void*)
 
-   Represented as a sorted array of keys, and a corresponding array of values.
-   Lookups are performed with binary search.
+   Represented as an open addressing hash table with linear probing: a key
+   array (0 marks an empty slot; http2 never uses stream id 0) and a
+   corresponding array of values. Deletion shifts the rest of a probe run
+   back, so there are no tombstones, and finds, adds and deletes take
+   constant time however many streams are live.
    Adds are restricted to strictly higher keys than previously seen (this is
    guaranteed by http2). */
 typedef struct {
   gpr_uint32 *keys;
   void **values;
   size_t count;
-  size_t free;
+  /* always a power of two */
   size_t capacity;
+  gpr_uint32 max_key;
 } grpc_chttp2_stream_map;
 
 void grpc_chttp2_stream_map_init(grpc_chttp2_stream_map *map,
@@ -76,7 +80,8 @@ void *grpc_chttp2_stream_map_find(grpc_chttp2_stream_map *map, gpr_uint32 key);
 /* How many (populated) entries are in the stream map? */
 size_t grpc_chttp2_stream_map_size(grpc_chttp2_stream_map *map);
 
-/* Callback on each stream */
+/* Callback on each stream, in no particular order; f must not change the
+   map */
 void grpc_chttp2_stream_map_for_each(grpc_chttp2_stream_map *map,
                                      void (*f)(void *user_data, gpr_uint32 key,
                                                void *value),
@@ -36,11 +36,36 @@
 #include <limits.h>
 
 #include <grpc/support/log.h>
+#include <grpc/support/useful.h>
 
+#include "src/core/support/string.h"
 #include "src/core/transport/chttp2/http2_errors.h"
 
 static void finalize_outbuf(grpc_chttp2_transport_writing *transport_writing);
 
+/* How many quanta a stream with no other writable stream around may take in
+   one write. Every write costs a round through the endpoint, so a lone bulk
+   stream held to a single quantum per write loses most of the link, while a
+   stream that shows up later still only queues behind one modest write. */
+#define LONE_STREAM_QUANTA 8
+
+/* How many flow controlled bytes a stream may take on one visit of the write
+   scheduler. Writable streams are visited round robin, and a stream with
+   more to send goes back to the end of the list, so with a non-zero quantum
+   every stream gets a share of the connection in proportion to its weight
+   (deficit round robin, where no deficit needs carrying over since DATA can
+   be split at any byte). */
+static gpr_int64 write_allowance(grpc_chttp2_transport_global *transport_global,
+                                 grpc_chttp2_stream_global *stream_global,
+                                 int contended) {
+  if (transport_global->write_quantum == 0) {
+    return GPR_UINT32_MAX;
+  }
+  return (gpr_int64)transport_global->write_quantum *
+         (contended ? stream_global->write_weight
+                    : GPR_MAX(stream_global->write_weight, LONE_STREAM_QUANTA));
+}
+
 int grpc_chttp2_unlocking_check_writes(
     grpc_chttp2_transport_global *transport_global,
     grpc_chttp2_transport_writing *transport_writing) {
@@ -48,6 +73,7 @@ int grpc_chttp2_unlocking_check_writes(
   grpc_chttp2_stream_writing *stream_writing;
   grpc_chttp2_stream_global *first_reinserted_stream = NULL;
   gpr_uint32 window_delta;
+  int contended;
 
   /* simple writes are queued to qbuf, and flushed here */
   gpr_slice_buffer_swap(&transport_global->qbuf, &transport_writing->outbuf);
@@ -66,6 +92,13 @@ int grpc_chttp2_unlocking_check_writes(
     transport_global->sent_local_settings = 1;
   }
 
+  /* the peer may have changed the size of its decoder table: header blocks
+     we write from here on must respect it (and will announce it) */
+  grpc_chttp2_hpack_compressor_set_max_table_size(
+      &transport_writing->hpack_compressor,
+      transport_global->settings[GRPC_PEER_SETTINGS]
+                                [GRPC_CHTTP2_SETTINGS_HEADER_TABLE_SIZE]);
+
   /* for each grpc_chttp2_stream that's become writable, frame it's data
      (according to available window sizes) and add to the output buffer */
   while (grpc_chttp2_list_pop_writable_stream(
@@ -76,6 +109,8 @@ int grpc_chttp2_unlocking_check_writes(
                                                  stream_global);
       break;
     }
+    /* nobody else is waiting if the list is empty once this stream is off */
+    contended = grpc_chttp2_list_have_writable_streams(transport_global);
 
     stream_writing->id = stream_global->id;
     stream_writing->send_closed = GRPC_DONT_SEND_CLOSED;
@@ -84,9 +119,12 @@ int grpc_chttp2_unlocking_check_writes(
       window_delta = grpc_chttp2_preencode(
           stream_global->outgoing_sopb->ops,
           &stream_global->outgoing_sopb->nops,
-          (gpr_uint32)GPR_MIN(GPR_MIN(transport_global->outgoing_window,
-                                      stream_global->outgoing_window),
-                              GPR_UINT32_MAX),
+          (gpr_uint32)GPR_MIN(
+              GPR_MIN(GPR_MIN(transport_global->outgoing_window,
+                              stream_global->outgoing_window),
+                      write_allowance(transport_global, stream_global,
+                                      contended)),
+              GPR_UINT32_MAX),
           &stream_writing->sopb);
       GRPC_CHTTP2_FLOWCTL_TRACE_TRANSPORT(
           "write", transport_global, outgoing_window, -(gpr_int64)window_delta);
@@ -108,8 +146,12 @@ int grpc_chttp2_unlocking_check_writes(
       if (stream_global->outgoing_window > 0 &&
           stream_global->outgoing_sopb->nops != 0) {
         grpc_chttp2_list_add_writable_stream(transport_global, stream_global);
+        /* a stream's frames go out together, so with a write quantum each
+           stream gets one turn per write: the next turn goes in the next
+           write, after everybody else's */
         if (first_reinserted_stream == NULL &&
-            transport_global->outgoing_window == 0) {
+            (transport_global->outgoing_window == 0 ||
+             transport_global->write_quantum != 0)) {
           first_reinserted_stream = stream_global;
         }
       }
@@ -237,5 +279,16 @@ void grpc_chttp2_cleanup_writing(
     grpc_chttp2_list_add_read_write_state_changed(transport_global,
                                                   stream_global);
   }
-  gpr_slice_buffer_reset_and_unref(&transport_writing->outbuf);
+}
+
+int grpc_chttp2_parse_write_weight(grpc_mdstr *value, gpr_uint32 *weight) {
+  gpr_slice slice = value->slice;
+  gpr_uint32 parsed;
+  if (!gpr_parse_bytes_to_uint32((const char *)GPR_SLICE_START_PTR(slice),
+                                 GPR_SLICE_LENGTH(slice), &parsed) ||
+      parsed == 0 || parsed > GRPC_CHTTP2_MAX_WRITE_WEIGHT) {
+    return 0;
+  }
+  *weight = parsed;
+  return 1;
 }
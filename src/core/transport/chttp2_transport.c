@@ -53,6 +53,9 @@
 
 #define DEFAULT_WINDOW 65535
 #define DEFAULT_CONNECTION_WINDOW_TARGET (1024 * 1024)
+#define DEFAULT_FLOW_CONTROL_BUDGET (16 * 1024 * 1024)
+/* one full DATA frame per unit of weight per round */
+#define DEFAULT_WRITE_QUANTUM GRPC_CHTTP2_MAX_PAYLOAD_LENGTH
 #define MAX_WINDOW 0x7fffffffu
 
 #define MAX_CLIENT_STREAM_ID 0x7fffffffu
@@ -151,6 +154,8 @@ static void destruct_transport(grpc_exec_ctx *exec_ctx,
   grpc_chttp2_goaway_parser_destroy(&t->parsing.goaway_parser);
 
   GRPC_MDSTR_UNREF(t->parsing.str_grpc_timeout);
+  GRPC_MDSTR_UNREF(t->parsing.str_grpc_write_weight);
+  GRPC_MDSTR_UNREF(t->global.str_grpc_write_weight);
 
   for (i = 0; i < STREAM_LIST_COUNT; i++) {
     GPR_ASSERT(t->lists[i].head == NULL);
@@ -239,11 +244,20 @@ static void init_transport(grpc_exec_ctx *exec_ctx, grpc_chttp2_transport *t,
   t->global.outgoing_window = DEFAULT_WINDOW;
   t->global.incoming_window = DEFAULT_WINDOW;
   t->global.connection_window_target = DEFAULT_CONNECTION_WINDOW_TARGET;
+  t->global.flow_control_budget = DEFAULT_FLOW_CONTROL_BUDGET;
+  t->global.write_quantum = DEFAULT_WRITE_QUANTUM;
+  t->global.default_write_weight = 1;
+  t->global.str_grpc_write_weight = grpc_mdstr_from_string(
+      t->metadata_context, GRPC_WRITE_WEIGHT_METADATA_KEY);
   t->global.ping_counter = 1;
   t->global.pings.next = t->global.pings.prev = &t->global.pings;
   t->parsing.is_client = is_client;
+  t->parsing.pings.next = t->parsing.pings.prev = &t->parsing.pings;
+  t->parsing.bdp_probing = 1;
   t->parsing.str_grpc_timeout =
       grpc_mdstr_from_string(t->metadata_context, "grpc-timeout");
+  t->parsing.str_grpc_write_weight = grpc_mdstr_from_string(
+      t->metadata_context, GRPC_WRITE_WEIGHT_METADATA_KEY);
   t->parsing.deframe_state =
       is_client ? GRPC_DTS_FH_0 : GRPC_DTS_CLIENT_PREFIX_0;
   t->writing.is_client = is_client;
@@ -329,9 +343,92 @@ static void init_transport(grpc_exec_ctx *exec_ctx, grpc_chttp2_transport *t,
           t->global.next_stream_id =
               (gpr_uint32)channel_args->args[i].value.integer;
         }
+      } else if (0 == strcmp(channel_args->args[i].key,
+                             GRPC_ARG_HTTP2_BDP_PROBE)) {
+        if (channel_args->args[i].type != GRPC_ARG_INTEGER) {
+          gpr_log(GPR_ERROR, "%s: must be an integer",
+                  GRPC_ARG_HTTP2_BDP_PROBE);
+        } else {
+          t->parsing.bdp_probing = channel_args->args[i].value.integer != 0;
+        }
+      } else if (0 == strcmp(channel_args->args[i].key,
+                             GRPC_ARG_HTTP2_FLOW_CONTROL_BUDGET)) {
+        if (channel_args->args[i].type != GRPC_ARG_INTEGER) {
+          gpr_log(GPR_ERROR, "%s: must be an integer",
+                  GRPC_ARG_HTTP2_FLOW_CONTROL_BUDGET);
+        } else if (channel_args->args[i].value.integer < DEFAULT_WINDOW ||
+                   (gpr_uint32)channel_args->args[i].value.integer >
+                       MAX_WINDOW) {
+          gpr_log(GPR_ERROR, "%s: must be between %d and %u",
+                  GRPC_ARG_HTTP2_FLOW_CONTROL_BUDGET, DEFAULT_WINDOW,
+                  MAX_WINDOW);
+        } else {
+          t->global.flow_control_budget =
+              (gpr_uint32)channel_args->args[i].value.integer;
+        }
+      } else if (0 == strcmp(channel_args->args[i].key,
+                             GRPC_ARG_HTTP2_WRITE_QUANTUM)) {
+        if (channel_args->args[i].type != GRPC_ARG_INTEGER ||
+            channel_args->args[i].value.integer < 0) {
+          gpr_log(GPR_ERROR, "%s: must be a non-negative integer",
+                  GRPC_ARG_HTTP2_WRITE_QUANTUM);
+        } else {
+          t->global.write_quantum =
+              (gpr_uint32)channel_args->args[i].value.integer;
+        }
+      } else if (0 == strcmp(channel_args->args[i].key,
+                             GRPC_ARG_HTTP2_DEFAULT_WRITE_WEIGHT)) {
+        if (channel_args->args[i].type != GRPC_ARG_INTEGER ||
+            channel_args->args[i].value.integer < 1 ||
+            channel_args->args[i].value.integer >
+                GRPC_CHTTP2_MAX_WRITE_WEIGHT) {
+          gpr_log(GPR_ERROR, "%s: must be an integer between 1 and %d",
+                  GRPC_ARG_HTTP2_DEFAULT_WRITE_WEIGHT,
+                  GRPC_CHTTP2_MAX_WRITE_WEIGHT);
+        } else {
+          t->global.default_write_weight =
+              (gpr_uint32)channel_args->args[i].value.integer;
+        }
+      } else if (0 == strcmp(channel_args->args[i].key,
+                             GRPC_ARG_HTTP2_HPACK_TABLE_SIZE_DECODER)) {
+        if (channel_args->args[i].type != GRPC_ARG_INTEGER ||
+            channel_args->args[i].value.integer <
+                GRPC_CHTTP2_INITIAL_HPACK_TABLE_SIZE ||
+            channel_args->args[i].value.integer >
+                GRPC_CHTTP2_MAX_HPACK_TABLE_SIZE) {
+          gpr_log(GPR_ERROR, "%s: must be an integer between %d and %d",
+                  GRPC_ARG_HTTP2_HPACK_TABLE_SIZE_DECODER,
+                  GRPC_CHTTP2_INITIAL_HPACK_TABLE_SIZE,
+                  GRPC_CHTTP2_MAX_HPACK_TABLE_SIZE);
+        } else {
+          grpc_chttp2_hptbl_set_max_bytes_limit(
+              &t->parsing.hpack_parser.table,
+              (gpr_uint32)channel_args->args[i].value.integer);
+          push_setting(t, GRPC_CHTTP2_SETTINGS_HEADER_TABLE_SIZE,
+                       (gpr_uint32)channel_args->args[i].value.integer);
+        }
+      } else if (0 == strcmp(channel_args->args[i].key,
+                             GRPC_ARG_HTTP2_HPACK_TABLE_SIZE_ENCODER)) {
+        if (channel_args->args[i].type != GRPC_ARG_INTEGER ||
+            channel_args->args[i].value.integer < 0 ||
+            channel_args->args[i].value.integer >
+                GRPC_CHTTP2_MAX_HPACK_TABLE_SIZE) {
+          gpr_log(GPR_ERROR, "%s: must be an integer between 0 and %d",
+                  GRPC_ARG_HTTP2_HPACK_TABLE_SIZE_ENCODER,
+                  GRPC_CHTTP2_MAX_HPACK_TABLE_SIZE);
+        } else {
+          grpc_chttp2_hpack_compressor_set_max_usable_size(
+              &t->writing.hpack_compressor,
+              (gpr_uint32)channel_args->args[i].value.integer);
+        }
       }
     }
   }
+
+  /* windows start out at their defaults, and are doubled as the estimate
+     grows; see update_bdp_windows_locked */
+  grpc_chttp2_bdp_estimator_init(&t->parsing.bdp_estimator, DEFAULT_WINDOW / 2,
+                                 t->global.flow_control_budget / 2);
 }
 
 static void destroy_transport(grpc_exec_ctx *exec_ctx, grpc_transport *gt) {
@@ -410,6 +507,7 @@ static int init_stream(grpc_exec_ctx *exec_ctx, grpc_transport *gt,
 
   lock(t);
   grpc_chttp2_register_stream(t, s);
+  s->global.write_weight = t->global.default_write_weight;
   if (server_data) {
     GPR_ASSERT(t->parsing_active);
     s->global.id = (gpr_uint32)(gpr_uintptr)server_data;
@@ -505,7 +603,15 @@ grpc_chttp2_stream_parsing *grpc_chttp2_parsing_accept_stream(
    from above,
    and in response to data being received from below. New data to be written
    is always queued, as are callbacks to process data. During unlock() we
-   check our todo lists and initiate callbacks and flush writes. */
+   check our todo lists and initiate callbacks and flush writes.
+
+   The lock only guards t->global (stream lifecycle, settings, flow control
+   accounting). Parsing and framing run outside it: the chain of execution
+   that set parsing_active owns t->parsing, t->parsing_stream_map and
+   t->read_buffer, and the one that set writing_active owns t->writing, so a
+   connection can parse on one thread while it frames and writes on another.
+   Each side only takes the lock to exchange state with t->global: before and
+   after parsing a read, and before and after writing a batch. */
 
 static void lock(grpc_chttp2_transport *t) { gpr_mu_lock(&t->mu); }
 
@@ -546,6 +652,10 @@ void grpc_chttp2_terminate_writing(grpc_exec_ctx *exec_ctx,
   grpc_chttp2_transport_writing *transport_writing = transport_writing_ptr;
   grpc_chttp2_transport *t = TRANSPORT_FROM_WRITING(transport_writing);
 
+  /* the written bytes are owned by the writing chain (writing_active is still
+     set): release them before contending with the parser for the lock */
+  gpr_slice_buffer_reset_and_unref(&transport_writing->outbuf);
+
   lock(t);
 
   allow_endpoint_shutdown_locked(exec_ctx, t);
@@ -639,6 +749,37 @@ static void maybe_start_some_streams(
   }
 }
 
+/** Pick up a write weight from the initial metadata of a stream */
+static void set_write_weight_from_metadata(
+    grpc_chttp2_transport_global *transport_global,
+    grpc_chttp2_stream_global *stream_global, grpc_stream_op_buffer *sopb) {
+  size_t i;
+  grpc_linked_mdelem *l;
+  for (i = 0; i < sopb->nops; i++) {
+    if (sopb->ops[i].type != GRPC_OP_METADATA) continue;
+    for (l = sopb->ops[i].data.metadata.list.head; l; l = l->next) {
+      if (l->md->key == transport_global->str_grpc_write_weight &&
+          !grpc_chttp2_parse_write_weight(l->md->value,
+                                          &stream_global->write_weight)) {
+        gpr_log(GPR_ERROR, "Ignoring bad %s value '%s'",
+                GRPC_WRITE_WEIGHT_METADATA_KEY,
+                grpc_mdstr_as_c_string(l->md->value));
+      }
+    }
+    return;
+  }
+}
+
+/** How much window to offer a stream ahead of the application: the bdp
+    target, but never more than an even share of the flow control budget */
+static gpr_uint32 stream_window_target(
+    grpc_chttp2_transport_global *transport_global) {
+  gpr_uint32 share =
+      transport_global->flow_control_budget /
+      GPR_MAX(1, transport_global->concurrent_stream_count);
+  return GPR_MIN(transport_global->stream_window_target, share);
+}
+
 static void perform_stream_op_locked(
     grpc_exec_ctx *exec_ctx, grpc_chttp2_transport_global *transport_global,
     grpc_chttp2_stream_global *stream_global, grpc_transport_stream_op *op) {
@@ -655,6 +796,10 @@ static void perform_stream_op_locked(
     GPR_ASSERT(stream_global->outgoing_sopb == NULL);
     stream_global->send_done_closure = op->on_done_send;
     if (!stream_global->cancelled) {
+      if (!stream_global->written_anything) {
+        set_write_weight_from_metadata(transport_global, stream_global,
+                                       op->send_ops);
+      }
       stream_global->written_anything = 1;
       stream_global->outgoing_sopb = op->send_ops;
       if (op->is_last_send &&
@@ -687,6 +832,10 @@ static void perform_stream_op_locked(
     stream_global->publish_state = op->recv_state;
     /* clamp max recv bytes */
     op->max_recv_bytes = GPR_MIN(op->max_recv_bytes, GPR_UINT32_MAX);
+    /* offer at least the stream's share of the bdp window, so that a single
+       stream can fill a long fat pipe */
+    op->max_recv_bytes =
+        GPR_MAX(op->max_recv_bytes, stream_window_target(transport_global));
     if (stream_global->max_recv_bytes < op->max_recv_bytes) {
       GRPC_CHTTP2_FLOWCTL_TRACE_STREAM(
           "op", transport_global, stream_global, max_recv_bytes,
@@ -1097,6 +1246,20 @@ static void read_error_locked(grpc_exec_ctx *exec_ctx,
   }
 }
 
+/** Size the connection and stream windows at twice the estimated
+    bandwidth-delay product, so that the peer is never stalled waiting for a
+    window update while data is in flight */
+static void update_bdp_windows_locked(grpc_chttp2_transport *t) {
+  gpr_int64 target = 2 * t->parsing.bdp_estimator.estimate;
+  GRPC_CHTTP2_IF_TRACING(
+      gpr_log(GPR_DEBUG, "HTTP:%s: bdp estimate now %lld bytes",
+              t->global.is_client ? "CLI" : "SVR",
+              (long long)t->parsing.bdp_estimator.estimate));
+  t->global.connection_window_target =
+      (gpr_uint32)GPR_MAX(DEFAULT_CONNECTION_WINDOW_TARGET, target);
+  t->global.stream_window_target = (gpr_uint32)target;
+}
+
 /* tcp read callback */
 static void recv_data(grpc_exec_ctx *exec_ctx, void *tp, int success) {
   size_t i;
@@ -1134,6 +1297,10 @@ static void recv_data(grpc_exec_ctx *exec_ctx, void *tp, int success) {
     }
     /* handle higher level things */
     grpc_chttp2_publish_reads(exec_ctx, &t->global, &t->parsing);
+    if (t->parsing.bdp_estimate_updated) {
+      update_bdp_windows_locked(t);
+      t->parsing.bdp_estimate_updated = 0;
+    }
     t->parsing_active = 0;
   }
   if (!success || i != t->read_buffer.count) {
@@ -1144,9 +1311,12 @@ static void recv_data(grpc_exec_ctx *exec_ctx, void *tp, int success) {
     REF_TRANSPORT(t, "keep_reading");
     prevent_endpoint_shutdown(t);
   }
-  gpr_slice_buffer_reset_and_unref(&t->read_buffer);
   unlock(exec_ctx, t);
 
+  /* read_buffer belongs to the reading chain until the next read is issued,
+     so it can be released outside the lock */
+  gpr_slice_buffer_reset_and_unref(&t->read_buffer);
+
   if (keep_reading) {
     grpc_endpoint_read(exec_ctx, t->ep, &t->read_buffer, &t->recv_data);
     allow_endpoint_shutdown_unlocked(exec_ctx, t);
@@ -35,6 +35,7 @@
 
 #include <limits.h>
 #include <string.h>
+#include <time.h>
 
 #include <grpc/support/log.h>
 #include <grpc/support/sync.h>
@@ -51,9 +52,16 @@
 
 /* --- Constants. ---*/
 
-#define TSI_SSL_MAX_PROTECTED_FRAME_SIZE_UPPER_BOUND 16384
+/* The upper bound leaves room for a full TLS record (16KB of plaintext) plus
+   the protection overhead, so that bulk transfers use maximum size records. */
+#define TSI_SSL_MAX_PROTECTED_FRAME_SIZE_UPPER_BOUND \
+  (16384 + TSI_SSL_MAX_PROTECTION_OVERHEAD)
 #define TSI_SSL_MAX_PROTECTED_FRAME_SIZE_LOWER_BOUND 1024
 
+/* Session id context of server sessions: sessions are only resumed by the
+   server handshaker factory that created them. */
+#define TSI_SSL_SESSION_ID_CONTEXT "grpc"
+
 /* Putting a macro like this and littering the source file with #if is really
    bad practice.
    TODO(jboeuf): refactor all the #if / #endif in a separate module. */
@@ -71,14 +79,40 @@ struct tsi_ssl_handshaker_factory {
   tsi_result (*create_handshaker)(tsi_ssl_handshaker_factory *self,
                                   const char *server_name_indication,
                                   tsi_handshaker **handshaker);
+  tsi_result (*set_session_cache_options)(
+      tsi_ssl_handshaker_factory *self,
+      const tsi_ssl_session_cache_options *options);
   void (*destroy)(tsi_ssl_handshaker_factory *self);
 };
 
+/* Client-side cached session, keyed by the server name it was negotiated
+   with. Entries form a doubly linked list in most recently used order.
+   Sessions are kept serialized: the SSL_SESSION object handed out by OpenSSL
+   stays shared with its connection, which marks it as not resumable when the
+   connection is freed without a TLS shutdown. */
+typedef struct tsi_ssl_session_cache_entry {
+  char *server_name;
+  unsigned char *session_data;
+  size_t session_data_size;
+  long expiration_time; /* In seconds since the epoch. */
+  struct tsi_ssl_session_cache_entry *prev;
+  struct tsi_ssl_session_cache_entry *next;
+} tsi_ssl_session_cache_entry;
+
 typedef struct {
   tsi_ssl_handshaker_factory base;
   SSL_CTX *ssl_context;
   unsigned char *alpn_protocol_list;
   size_t alpn_protocol_list_length;
+
+  /* Session cache used for resumption: sessions are added by
+     client_handshaker_factory_new_session_callback and offered to the server
+     by new handshakers for the same server name. */
+  gpr_mu session_cache_mu;
+  tsi_ssl_session_cache_entry *session_cache_head; /* Most recently used. */
+  tsi_ssl_session_cache_entry *session_cache_tail; /* Least recently used. */
+  size_t session_cache_count;
+  size_t session_cache_size; /* 0 if resumption is disabled. */
 } tsi_ssl_client_handshaker_factory;
 
 typedef struct {
@@ -116,6 +150,8 @@ typedef struct {
 
 static gpr_once init_openssl_once = GPR_ONCE_INIT;
 static gpr_mu *openssl_mutexes = NULL;
+/* Index of the SSL_CTX ex data pointing back to the client factory. */
+static int g_ssl_ctx_ex_factory_index = -1;
 
 static void openssl_locking_cb(int mode, int type, const char *file, int line) {
   if (mode & CRYPTO_LOCK) {
@@ -144,6 +180,9 @@ static void init_openssl(void) {
   }
   CRYPTO_set_locking_callback(openssl_locking_cb);
   CRYPTO_set_id_callback(openssl_thread_id_cb);
+  g_ssl_ctx_ex_factory_index =
+      SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+  GPR_ASSERT(g_ssl_ctx_ex_factory_index != -1);
 }
 
 /* --- Ssl utils. ---*/
@@ -401,7 +440,8 @@ static tsi_result do_ssl_read(SSL *ssl, unsigned char *unprotected_bytes,
 }
 
 /* Performs an SSL_write and handle errors. */
-static tsi_result do_ssl_write(SSL *ssl, unsigned char *unprotected_bytes,
+static tsi_result do_ssl_write(SSL *ssl,
+                               const unsigned char *unprotected_bytes,
                                size_t unprotected_bytes_size) {
   int ssl_write_result;
   GPR_ASSERT(unprotected_bytes_size <= INT_MAX);
@@ -683,21 +723,32 @@ static tsi_result ssl_protector_protect(tsi_frame_protector *self,
     return TSI_OK;
   }
 
-  /* Now see if we can send a complete frame. */
-  available = impl->buffer_size - impl->buffer_offset;
-  if (available > *unprotected_bytes_size) {
-    /* If we cannot, just copy the data in our internal buffer. */
-    memcpy(impl->buffer + impl->buffer_offset, unprotected_bytes,
-           *unprotected_bytes_size);
-    impl->buffer_offset += *unprotected_bytes_size;
-    *protected_output_frames_size = 0;
-    return TSI_OK;
-  }
+  /* Full frames are encrypted directly from the caller's bytes, without going
+     through our internal buffer. */
+  if (impl->buffer_offset == 0 &&
+      *unprotected_bytes_size >= impl->buffer_size) {
+    result = do_ssl_write(impl->ssl, unprotected_bytes, impl->buffer_size);
+    if (result != TSI_OK) return result;
+    *unprotected_bytes_size = impl->buffer_size;
+  } else {
+    /* Now see if we can send a complete frame. */
+    available = impl->buffer_size - impl->buffer_offset;
+    if (available > *unprotected_bytes_size) {
+      /* If we cannot, just copy the data in our internal buffer. */
+      memcpy(impl->buffer + impl->buffer_offset, unprotected_bytes,
+             *unprotected_bytes_size);
+      impl->buffer_offset += *unprotected_bytes_size;
+      *protected_output_frames_size = 0;
+      return TSI_OK;
+    }
 
-  /* If we can, prepare the buffer, send it to SSL_write and read. */
-  memcpy(impl->buffer + impl->buffer_offset, unprotected_bytes, available);
-  result = do_ssl_write(impl->ssl, impl->buffer, impl->buffer_size);
-  if (result != TSI_OK) return result;
+    /* If we can, prepare the buffer, send it to SSL_write and read. */
+    memcpy(impl->buffer + impl->buffer_offset, unprotected_bytes, available);
+    result = do_ssl_write(impl->ssl, impl->buffer, impl->buffer_size);
+    if (result != TSI_OK) return result;
+    *unprotected_bytes_size = available;
+    impl->buffer_offset = 0;
+  }
 
   GPR_ASSERT(*protected_output_frames_size <= INT_MAX);
   read_from_ssl = BIO_read(impl->from_ssl, protected_output_frames,
@@ -707,8 +758,6 @@ static tsi_result ssl_protector_protect(tsi_frame_protector *self,
     return TSI_INTERNAL_ERROR;
   }
   *protected_output_frames_size = (size_t)read_from_ssl;
-  *unprotected_bytes_size = available;
-  impl->buffer_offset = 0;
   return TSI_OK;
 }
 
@@ -729,7 +778,10 @@ static tsi_result ssl_protector_protect_flush(
   pending = BIO_pending(impl->from_ssl);
   GPR_ASSERT(pending >= 0);
   *still_pending_size = (size_t)pending;
-  if (*still_pending_size == 0) return TSI_OK;
+  if (*still_pending_size == 0) {
+    *protected_output_frames_size = 0;
+    return TSI_OK;
+  }
 
   GPR_ASSERT(*protected_output_frames_size <= INT_MAX);
   read_from_ssl = BIO_read(impl->from_ssl, protected_output_frames,
@@ -790,7 +842,13 @@ static tsi_result ssl_protector_unprotect(
 static void ssl_protector_destroy(tsi_frame_protector *self) {
   tsi_ssl_frame_protector *impl = (tsi_ssl_frame_protector *)self;
   if (impl->buffer != NULL) free(impl->buffer);
-  if (impl->ssl != NULL) SSL_free(impl->ssl);
+  if (impl->ssl != NULL) {
+    /* Connections are closed without a TLS close_notify. Mark the shutdown as
+       clean so that OpenSSL does not evict the session from the server cache
+       when freeing the connection. */
+    SSL_set_shutdown(impl->ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+    SSL_free(impl->ssl);
+  }
   free(self);
 }
 
@@ -880,11 +938,35 @@ static tsi_result ssl_handshaker_process_bytes_from_peer(
   }
 }
 
+static tsi_result add_string_property_to_peer(tsi_peer *peer, const char *name,
+                                              const char *value,
+                                              size_t value_length) {
+  size_t i;
+  tsi_result result;
+  tsi_peer_property *new_properties =
+      calloc(1, sizeof(tsi_peer_property) * (peer->property_count + 1));
+  if (new_properties == NULL) return TSI_OUT_OF_RESOURCES;
+  for (i = 0; i < peer->property_count; i++) {
+    new_properties[i] = peer->properties[i];
+  }
+  result = tsi_construct_string_peer_property(
+      name, value, value_length, &new_properties[peer->property_count]);
+  if (result != TSI_OK) {
+    free(new_properties);
+    return result;
+  }
+  if (peer->properties != NULL) free(peer->properties);
+  peer->property_count++;
+  peer->properties = new_properties;
+  return TSI_OK;
+}
+
 static tsi_result ssl_handshaker_extract_peer(tsi_handshaker *self,
                                               tsi_peer *peer) {
   tsi_result result = TSI_OK;
   const unsigned char *alpn_selected = NULL;
   unsigned int alpn_selected_len;
+  const char *session_reused;
   tsi_ssl_handshaker *impl = (tsi_ssl_handshaker *)self;
   X509 *peer_cert = SSL_get_peer_certificate(impl->ssl);
   if (peer_cert != NULL) {
@@ -901,25 +983,15 @@ static tsi_result ssl_handshaker_extract_peer(tsi_handshaker *self,
                                    &alpn_selected_len);
   }
   if (alpn_selected != NULL) {
-    size_t i;
-    tsi_peer_property *new_properties =
-        calloc(1, sizeof(tsi_peer_property) * (peer->property_count + 1));
-    if (new_properties == NULL) return TSI_OUT_OF_RESOURCES;
-    for (i = 0; i < peer->property_count; i++) {
-      new_properties[i] = peer->properties[i];
-    }
-    result = tsi_construct_string_peer_property(
-        TSI_SSL_ALPN_SELECTED_PROTOCOL, (const char *)alpn_selected,
-        alpn_selected_len, &new_properties[peer->property_count]);
-    if (result != TSI_OK) {
-      free(new_properties);
-      return result;
-    }
-    if (peer->properties != NULL) free(peer->properties);
-    peer->property_count++;
-    peer->properties = new_properties;
+    result = add_string_property_to_peer(
+        peer, TSI_SSL_ALPN_SELECTED_PROTOCOL, (const char *)alpn_selected,
+        alpn_selected_len);
+    if (result != TSI_OK) return result;
   }
-  return result;
+  session_reused = SSL_session_reused(impl->ssl) ? "true" : "false";
+  return add_string_property_to_peer(peer,
+                                     TSI_SSL_SESSION_REUSED_PEER_PROPERTY,
+                                     session_reused, strlen(session_reused));
 }
 
 static tsi_result ssl_handshaker_create_frame_protector(
@@ -992,14 +1064,29 @@ tsi_result tsi_ssl_handshaker_factory_create_handshaker(
   return self->create_handshaker(self, server_name_indication, handshaker);
 }
 
+tsi_result tsi_ssl_handshaker_factory_set_session_cache_options(
+    tsi_ssl_handshaker_factory *self,
+    const tsi_ssl_session_cache_options *options) {
+  if (self == NULL || options == NULL || options->session_timeout_seconds < 0) {
+    return TSI_INVALID_ARGUMENT;
+  }
+  return self->set_session_cache_options(self, options);
+}
+
 void tsi_ssl_handshaker_factory_destroy(tsi_ssl_handshaker_factory *self) {
   if (self == NULL) return;
   self->destroy(self);
 }
 
-static tsi_result create_tsi_ssl_handshaker(SSL_CTX *ctx, int is_client,
-                                            const char *server_name_indication,
-                                            tsi_handshaker **handshaker) {
+/* Forward declaration: resumes a cached session for the handshaker. */
+static void client_handshaker_factory_resume_session(
+    tsi_ssl_client_handshaker_factory *factory, SSL *ssl,
+    const char *server_name);
+
+static tsi_result create_tsi_ssl_handshaker(
+    SSL_CTX *ctx, int is_client, const char *server_name_indication,
+    tsi_ssl_client_handshaker_factory *client_factory,
+    tsi_handshaker **handshaker) {
   SSL *ssl = SSL_new(ctx);
   BIO *into_ssl = NULL;
   BIO *from_ssl = NULL;
@@ -1034,6 +1121,10 @@ static tsi_result create_tsi_ssl_handshaker(SSL_CTX *ctx, int is_client,
         SSL_free(ssl);
         return TSI_INTERNAL_ERROR;
       }
+      if (client_factory != NULL) {
+        client_handshaker_factory_resume_session(client_factory, ssl,
+                                                 server_name_indication);
+      }
     }
     ssl_result = SSL_do_handshake(ssl);
     ssl_result = SSL_get_error(ssl, ssl_result);
@@ -1090,19 +1181,169 @@ static int select_protocol_list(const unsigned char **out,
 
 /* --- tsi_ssl__client_handshaker_factory methods implementation. --- */
 
+static void session_cache_unlink_locked(
+    tsi_ssl_client_handshaker_factory *impl,
+    tsi_ssl_session_cache_entry *entry) {
+  if (entry->prev != NULL) {
+    entry->prev->next = entry->next;
+  } else {
+    impl->session_cache_head = entry->next;
+  }
+  if (entry->next != NULL) {
+    entry->next->prev = entry->prev;
+  } else {
+    impl->session_cache_tail = entry->prev;
+  }
+  entry->prev = entry->next = NULL;
+  impl->session_cache_count--;
+}
+
+static void session_cache_push_front_locked(
+    tsi_ssl_client_handshaker_factory *impl,
+    tsi_ssl_session_cache_entry *entry) {
+  entry->prev = NULL;
+  entry->next = impl->session_cache_head;
+  if (impl->session_cache_head != NULL) {
+    impl->session_cache_head->prev = entry;
+  } else {
+    impl->session_cache_tail = entry;
+  }
+  impl->session_cache_head = entry;
+  impl->session_cache_count++;
+}
+
+static void session_cache_entry_destroy(tsi_ssl_session_cache_entry *entry) {
+  free(entry->session_data);
+  free(entry->server_name);
+  free(entry);
+}
+
+static tsi_ssl_session_cache_entry *session_cache_find_locked(
+    tsi_ssl_client_handshaker_factory *impl, const char *server_name) {
+  tsi_ssl_session_cache_entry *entry;
+  for (entry = impl->session_cache_head; entry != NULL; entry = entry->next) {
+    if (strcmp(entry->server_name, server_name) == 0) return entry;
+  }
+  return NULL;
+}
+
+static void session_cache_shrink_locked(
+    tsi_ssl_client_handshaker_factory *impl, size_t max_size) {
+  while (impl->session_cache_count > max_size) {
+    tsi_ssl_session_cache_entry *lru = impl->session_cache_tail;
+    session_cache_unlink_locked(impl, lru);
+    session_cache_entry_destroy(lru);
+  }
+}
+
+static void client_handshaker_factory_resume_session(
+    tsi_ssl_client_handshaker_factory *factory, SSL *ssl,
+    const char *server_name) {
+  tsi_ssl_session_cache_entry *entry;
+  SSL_SESSION *session = NULL;
+  gpr_mu_lock(&factory->session_cache_mu);
+  entry = session_cache_find_locked(factory, server_name);
+  if (entry != NULL) {
+    session_cache_unlink_locked(factory, entry);
+    if ((long)time(NULL) >= entry->expiration_time) {
+      /* Expired: the server would not accept it anyway. */
+      session_cache_entry_destroy(entry);
+    } else {
+      const unsigned char *data = entry->session_data;
+      session_cache_push_front_locked(factory, entry);
+      session = d2i_SSL_SESSION(NULL, &data, (long)entry->session_data_size);
+    }
+  }
+  gpr_mu_unlock(&factory->session_cache_mu);
+  if (session == NULL) return;
+  if (!SSL_set_session(ssl, session)) {
+    gpr_log(GPR_INFO, "Could not resume TLS session for %s.", server_name);
+  }
+  SSL_SESSION_free(session);
+}
+
+/* Called by OpenSSL when the client obtains a new session (or ticket). The
+   session is serialized into the cache and stays owned by OpenSSL. */
+static int client_handshaker_factory_new_session_callback(
+    SSL *ssl, SSL_SESSION *session) {
+  tsi_ssl_client_handshaker_factory *impl =
+      (tsi_ssl_client_handshaker_factory *)SSL_CTX_get_ex_data(
+          SSL_get_SSL_CTX(ssl), g_ssl_ctx_ex_factory_index);
+  const char *server_name = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+  tsi_ssl_session_cache_entry *entry;
+  unsigned char *session_data;
+  unsigned char *p;
+  int session_data_size;
+  if (impl == NULL || server_name == NULL) return 0;
+
+  session_data_size = i2d_SSL_SESSION(session, NULL);
+  if (session_data_size <= 0) return 0;
+  session_data = malloc((size_t)session_data_size);
+  if (session_data == NULL) return 0;
+  p = session_data;
+  i2d_SSL_SESSION(session, &p);
+
+  gpr_mu_lock(&impl->session_cache_mu);
+  if (impl->session_cache_size == 0) {
+    gpr_mu_unlock(&impl->session_cache_mu);
+    free(session_data);
+    return 0;
+  }
+  entry = session_cache_find_locked(impl, server_name);
+  if (entry != NULL) {
+    session_cache_unlink_locked(impl, entry);
+    free(entry->session_data);
+  } else {
+    entry = calloc(1, sizeof(tsi_ssl_session_cache_entry));
+    if (entry != NULL) entry->server_name = malloc(strlen(server_name) + 1);
+    if (entry == NULL || entry->server_name == NULL) {
+      gpr_mu_unlock(&impl->session_cache_mu);
+      free(entry);
+      free(session_data);
+      return 0;
+    }
+    strcpy(entry->server_name, server_name);
+  }
+  entry->session_data = session_data;
+  entry->session_data_size = (size_t)session_data_size;
+  entry->expiration_time =
+      SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session);
+  session_cache_push_front_locked(impl, entry);
+  session_cache_shrink_locked(impl, impl->session_cache_size);
+  gpr_mu_unlock(&impl->session_cache_mu);
+  return 0;
+}
+
 static tsi_result ssl_client_handshaker_factory_create_handshaker(
     tsi_ssl_handshaker_factory *self, const char *server_name_indication,
     tsi_handshaker **handshaker) {
   tsi_ssl_client_handshaker_factory *impl =
       (tsi_ssl_client_handshaker_factory *)self;
   return create_tsi_ssl_handshaker(impl->ssl_context, 1, server_name_indication,
-                                   handshaker);
+                                   impl, handshaker);
+}
+
+static tsi_result ssl_client_handshaker_factory_set_session_cache_options(
+    tsi_ssl_handshaker_factory *self,
+    const tsi_ssl_session_cache_options *options) {
+  tsi_ssl_client_handshaker_factory *impl =
+      (tsi_ssl_client_handshaker_factory *)self;
+  if (options->session_timeout_seconds > 0) {
+    SSL_CTX_set_timeout(impl->ssl_context, options->session_timeout_seconds);
+  }
+  gpr_mu_lock(&impl->session_cache_mu);
+  impl->session_cache_size = options->session_cache_size;
+  session_cache_shrink_locked(impl, impl->session_cache_size);
+  gpr_mu_unlock(&impl->session_cache_mu);
+  return TSI_OK;
 }
 
 static void ssl_client_handshaker_factory_destroy(
     tsi_ssl_handshaker_factory *self) {
   tsi_ssl_client_handshaker_factory *impl =
       (tsi_ssl_client_handshaker_factory *)self;
+  session_cache_shrink_locked(impl, 0);
+  gpr_mu_destroy(&impl->session_cache_mu);
   if (impl->ssl_context != NULL) SSL_CTX_free(impl->ssl_context);
   if (impl->alpn_protocol_list != NULL) free(impl->alpn_protocol_list);
   free(impl);
@@ -1132,7 +1373,34 @@ static tsi_result ssl_server_handshaker_factory_create_handshaker(
   }
   /* Create the handshaker with the first context. We will switch if needed
      because of SNI in ssl_server_handshaker_factory_servername_callback.  */
-  return create_tsi_ssl_handshaker(impl->ssl_contexts[0], 0, NULL, handshaker);
+  return create_tsi_ssl_handshaker(impl->ssl_contexts[0], 0, NULL, NULL,
+                                   handshaker);
+}
+
+static tsi_result ssl_server_handshaker_factory_set_session_cache_options(
+    tsi_ssl_handshaker_factory *self,
+    const tsi_ssl_session_cache_options *options) {
+  tsi_ssl_server_handshaker_factory *impl =
+      (tsi_ssl_server_handshaker_factory *)self;
+  size_t i;
+  for (i = 0; i < impl->ssl_context_count; i++) {
+    SSL_CTX *ctx = impl->ssl_contexts[i];
+    if (options->session_cache_size > 0) {
+      SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+      SSL_CTX_sess_set_cache_size(ctx, (long)options->session_cache_size);
+    } else {
+      SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    }
+    if (options->session_timeout_seconds > 0) {
+      SSL_CTX_set_timeout(ctx, options->session_timeout_seconds);
+    }
+    if (options->enable_session_tickets) {
+      SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+    } else {
+      SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
+  }
+  return TSI_OK;
 }
 
 static void ssl_server_handshaker_factory_destroy(
@@ -1276,6 +1544,7 @@ tsi_result tsi_create_ssl_client_handshaker_factory(
     return TSI_OUT_OF_RESOURCES;
   }
   impl->ssl_context = ssl_context;
+  gpr_mu_init(&impl->session_cache_mu);
 
   do {
     result =
@@ -1319,8 +1588,19 @@ tsi_result tsi_create_ssl_client_handshaker_factory(
   SSL_CTX_set_verify(ssl_context, SSL_VERIFY_PEER, NULL);
   /* TODO(jboeuf): Add revocation verification. */
 
+  /* Sessions are stored in our own cache, keyed by server name, since
+     OpenSSL does not look up client sessions itself. The cache stays empty
+     until tsi_ssl_handshaker_factory_set_session_cache_options enables it. */
+  SSL_CTX_set_ex_data(ssl_context, g_ssl_ctx_ex_factory_index, impl);
+  SSL_CTX_set_session_cache_mode(
+      ssl_context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(ssl_context,
+                          client_handshaker_factory_new_session_callback);
+
   impl->base.create_handshaker =
       ssl_client_handshaker_factory_create_handshaker;
+  impl->base.set_session_cache_options =
+      ssl_client_handshaker_factory_set_session_cache_options;
   impl->base.destroy = ssl_client_handshaker_factory_destroy;
   *factory = &impl->base;
   return TSI_OK;
@@ -1352,6 +1632,8 @@ tsi_result tsi_create_ssl_server_handshaker_factory(
   if (impl == NULL) return TSI_OUT_OF_RESOURCES;
   impl->base.create_handshaker =
       ssl_server_handshaker_factory_create_handshaker;
+  impl->base.set_session_cache_options =
+      ssl_server_handshaker_factory_set_session_cache_options;
   impl->base.destroy = ssl_server_handshaker_factory_destroy;
   impl->ssl_contexts = calloc(key_cert_pair_count, sizeof(SSL_CTX *));
   impl->ssl_context_x509_subject_names =
@@ -1418,6 +1700,11 @@ tsi_result tsi_create_ssl_server_handshaker_factory(
       SSL_CTX_set_next_protos_advertised_cb(
           impl->ssl_contexts[i],
           server_handshaker_factory_npn_advertised_callback, impl);
+      /* Required for resuming sessions of authenticated clients. */
+      SSL_CTX_set_session_id_context(
+          impl->ssl_contexts[i],
+          (const unsigned char *)TSI_SSL_SESSION_ID_CONTEXT,
+          (unsigned int)strlen(TSI_SSL_SESSION_ID_CONTEXT));
     } while (0);
 
     if (result != TSI_OK) {
@@ -50,6 +50,10 @@ extern "C" {
 
 #define TSI_SSL_ALPN_SELECTED_PROTOCOL "ssl_alpn_selected_protocol"
 
+/* This property is of type TSI_PEER_PROPERTY_STRING and is either "true" or
+   "false" depending on whether the handshake resumed a previous session.  */
+#define TSI_SSL_SESSION_REUSED_PEER_PROPERTY "ssl_session_reused"
+
 /* --- tsi_ssl_handshaker_factory object ---
 
    This object creates tsi_handshaker objects implemented in terms of the
@@ -154,6 +158,30 @@ tsi_result tsi_ssl_handshaker_factory_create_handshaker(
     tsi_ssl_handshaker_factory *self, const char *server_name_indication,
     tsi_handshaker **handshaker);
 
+/* Session resumption settings of a handshaker factory.
+   - session_cache_size is the maximum number of sessions kept for resumption.
+     A client factory caches one session per server name indication, a server
+     factory caches sessions by id. 0 disables resumption (the default for
+     newly created factories).
+   - session_timeout_seconds is the lifetime of new sessions and tickets. 0
+     keeps the OpenSSL default.
+   - enable_session_tickets, on a server factory, enables RFC 5077 session
+     tickets so that clients can resume without server-side state. It is
+     ignored by client factories which always accept tickets.  */
+typedef struct {
+  size_t session_cache_size;
+  long session_timeout_seconds;
+  int enable_session_tickets;
+} tsi_ssl_session_cache_options;
+
+/* Configures session resumption for handshakers subsequently created by the
+   factory.
+   - This method returns TSI_OK on success or TSI_INVALID_PARAMETER in the case
+     where a parameter is invalid.  */
+tsi_result tsi_ssl_handshaker_factory_set_session_cache_options(
+    tsi_ssl_handshaker_factory *self,
+    const tsi_ssl_session_cache_options *options);
+
 /* Destroys the handshaker factory. WARNING: it is unsafe to destroy a factory
    while handshakers created with this factory are still in use.  */
 void tsi_ssl_handshaker_factory_destroy(tsi_ssl_handshaker_factory *self);
@@ -38,6 +38,7 @@
 #include <grpc/grpc.h>
 #include <grpc/support/log.h>
 #include <grpc/support/slice.h>
+#include <grpc/support/span_recorder.h>
 #include <grpc++/client_context.h>
 #include <grpc++/completion_queue.h>
 #include <grpc++/security/credentials.h>
@@ -61,8 +62,8 @@ Call Channel::CreateCall(const RpcMethod& method, ClientContext* context,
   const bool kRegistered = method.channel_tag() && context->authority().empty();
   grpc_call* c_call = NULL;
 
-  uint64_t start, end;
-  start = nanos_since_midnight();
+  gpr_uint64 start, end;
+  start = gpr_span_clock_now();
   if (kRegistered) {
     c_call = grpc_channel_create_registered_call(
         c_channel_, context->propagate_from_call_,
@@ -84,9 +85,8 @@ Call Channel::CreateCall(const RpcMethod& method, ClientContext* context,
   GRPC_TIMER_MARK(GRPC_PTAG_CPP_CALL_CREATED, c_call);
   context->set_call(c_call, shared_from_this());
 
-  end = nanos_since_midnight();
-  add_func_stats("Channel::CreateCall", start, end, std::string(__FILE__),
-    		"Does grpc_channel_create_registered_call() / grpc_channel_create_call(); and grpc_channel_create_call(context->propagation_options_, method.name(),context->raw_deadline()), cops, nops, ops, nullptr)");
+  end = gpr_span_clock_now();
+  GPR_SPAN("Channel::CreateCall", start, end, c_call);
 
   return Call(c_call, this, cq);
 }
@@ -96,15 +96,15 @@ void Channel::PerformOpsOnCall(CallOpSetInterface* ops, Call* call) {
   size_t nops = 0;
   grpc_op cops[MAX_OPS];
 
-  uint64_t start, end;
-  start = nanos_since_midnight();
+  gpr_uint64 start, end;
+  start = gpr_span_clock_now();
   GRPC_TIMER_BEGIN(GRPC_PTAG_CPP_PERFORM_OPS, call->call());
   ops->FillOps(cops, &nops);
   GPR_ASSERT(GRPC_CALL_OK ==
              grpc_call_start_batch(call->call(), cops, nops, ops, nullptr));
   GRPC_TIMER_END(GRPC_PTAG_CPP_PERFORM_OPS, call->call());
-  end = nanos_since_midnight();
-  add_func_stats("Channel::PerformOpsOnCall", start, end, std::string(__FILE__), "Does ops->FillOps(cops, nops); and GRPC_CALL_OK == grpc_call_start_batch(call(); cops; nops; ops; nullptr)");
+  end = gpr_span_clock_now();
+  GPR_SPAN("Channel::PerformOpsOnCall", start, end, call->call());
 }
 
 void* Channel::RegisterMethod(const char* method) {
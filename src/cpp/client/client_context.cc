@@ -65,9 +65,9 @@ std::unique_ptr<ClientContext> ClientContext::FromServerContext(
   return ctx;
 }
 
-void ClientContext::AddMetadata(const grpc::string& meta_key,
-                                const grpc::string& meta_value) {
-  send_initial_metadata_.insert(std::make_pair(meta_key, meta_value));
+void ClientContext::AddMetadata(const grpc::string_ref& meta_key,
+                                const grpc::string_ref& meta_value) {
+  send_initial_metadata_.Add(meta_key, meta_value);
 }
 
 void ClientContext::set_call(grpc_call* call,
@@ -0,0 +1,80 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <grpc++/impl/client_unary_call.h>
+
+#include <string.h>
+
+#include "src/core/surface/completion_queue.h"
+
+namespace grpc {
+
+#ifndef GRPC_CXX0X_NO_THREAD_LOCAL
+namespace {
+
+struct ThreadCompletionQueue {
+  ThreadCompletionQueue() : lent(false) { memset(&cache, 0, sizeof(cache)); }
+  ~ThreadCompletionQueue() { grpc_cq_thread_cache_destroy(&cache); }
+
+  grpc_cq_thread_cache cache;  // Its queue is created on first use.
+  bool lent;
+};
+
+thread_local ThreadCompletionQueue g_thread_cq;
+
+}  // namespace
+#endif  // !GRPC_CXX0X_NO_THREAD_LOCAL
+
+// The caller holds a channel, and with it the library, for as long as the
+// queue is lent.
+grpc_completion_queue* BlockingCallCompletionQueue::LendThreadQueue() {
+#ifndef GRPC_CXX0X_NO_THREAD_LOCAL
+  if (!g_thread_cq.lent) {
+    g_thread_cq.lent = true;
+    return grpc_cq_thread_cache_get(&g_thread_cq.cache);
+  }
+#endif  // !GRPC_CXX0X_NO_THREAD_LOCAL
+  return grpc_completion_queue_create(nullptr);
+}
+
+BlockingCallCompletionQueue::~BlockingCallCompletionQueue() {
+#ifndef GRPC_CXX0X_NO_THREAD_LOCAL
+  if (g_thread_cq.lent && cq() == g_thread_cq.cache.cq) {
+    g_thread_cq.lent = false;
+    return;
+  }
+#endif  // !GRPC_CXX0X_NO_THREAD_LOCAL
+  grpc_completion_queue_destroy(cq());
+}
+
+}  // namespace grpc
@@ -70,13 +70,23 @@ std::shared_ptr<Credentials> GoogleDefaultCredentials() {
 // Builds SSL Credentials given SSL specific options
 std::shared_ptr<Credentials> SslCredentials(
     const SslCredentialsOptions& options) {
+  return SslCredentials(options, SslSessionCacheOptions());
+}
+
+std::shared_ptr<Credentials> SslCredentials(
+    const SslCredentialsOptions& options,
+    const SslSessionCacheOptions& session_cache_options) {
   GrpcLibrary init;  // To call grpc_init().
   grpc_ssl_pem_key_cert_pair pem_key_cert_pair = {
       options.pem_private_key.c_str(), options.pem_cert_chain.c_str()};
+  grpc_ssl_session_cache_options session_cache = {
+      session_cache_options.session_cache_size,
+      session_cache_options.session_timeout_seconds, 0};
 
-  grpc_credentials* c_creds = grpc_ssl_credentials_create(
+  grpc_credentials* c_creds = grpc_ssl_credentials_create_with_session_cache(
       options.pem_root_certs.empty() ? nullptr : options.pem_root_certs.c_str(),
-      options.pem_private_key.empty() ? nullptr : &pem_key_cert_pair, nullptr);
+      options.pem_private_key.empty() ? nullptr : &pem_key_cert_pair,
+      &session_cache, nullptr);
   return WrapCredentials(c_creds);
 }
 
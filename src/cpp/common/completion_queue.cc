@@ -36,20 +36,27 @@
 
 #include <grpc/grpc.h>
 #include <grpc/support/log.h>
+#include <grpc/support/span_recorder.h>
 #include <grpc++/support/time.h>
 
-extern int add_func_stats(std::string funcName, uint64_t start_ns, uint64_t end_nsec, std::string fName = "", std::string desc = "");
-extern uint64_t nanos_since_midnight();
-
 namespace grpc {
 
-CompletionQueue::CompletionQueue() {
+CompletionQueue::CompletionQueue() : owned_(true) {
   cq_ = grpc_completion_queue_create(nullptr);
 }
 
-CompletionQueue::CompletionQueue(grpc_completion_queue* take) : cq_(take) {}
+CompletionQueue::CompletionQueue(grpc_completion_queue* take)
+    : cq_(take), owned_(true) {}
+
+CompletionQueue::CompletionQueue(grpc_completion_queue* cq,
+                                 bool take_ownership)
+    : cq_(cq), owned_(take_ownership) {}
 
-CompletionQueue::~CompletionQueue() { grpc_completion_queue_destroy(cq_); }
+CompletionQueue::~CompletionQueue() {
+  if (owned_) {
+    grpc_completion_queue_destroy(cq_);
+  }
+}
 
 void CompletionQueue::Shutdown() { grpc_completion_queue_shutdown(cq_); }
 
@@ -75,29 +82,19 @@ CompletionQueue::NextStatus CompletionQueue::AsyncNextInternal(
 }
 
 bool CompletionQueue::Pluck(CompletionQueueTag* tag) {
-  uint64_t start, end;
-
-  start = nanos_since_midnight();
+  gpr_uint64 start = gpr_span_clock_now();
   auto deadline = gpr_inf_future(GPR_CLOCK_REALTIME);
-  end = nanos_since_midnight();
-  add_func_stats("CompletionQueue::Pluck -> gpr_inf_future(GPR_CLOCK_REALTIME);", start, end, std::string(__FILE__),
-		  "gpr_inf_future(GPR_CLOCK_REALTIME): Obtain Time deadline");
-
-  start = nanos_since_midnight();
   auto ev = grpc_completion_queue_pluck(cq_, tag, deadline, nullptr);
   bool ok = ev.success != 0;
-  end = nanos_since_midnight();
-    add_func_stats("CompletionQueue::Pluck -> grpc_completion_queue_pluck(cq_; deadline);", start, end, std::string(__FILE__),
-    		"grpc_completion_queue_pluck(cq_; deadline): Keep Polling the completion queue for result");
+  gpr_uint64 end = gpr_span_clock_now();
+  GPR_SPAN("CompletionQueue::Pluck", start, end, 0);
 
   void* ignored = tag;
-
-  start = nanos_since_midnight();
+  start = gpr_span_clock_now();
   GPR_ASSERT(tag->FinalizeResult(&ignored, &ok));
   GPR_ASSERT(ignored == tag);
-  end = nanos_since_midnight();
-    add_func_stats("CompletionQueue::Pluck -> tag->FinalizeResult(&ignored; &ok);", start, end, std::string(__FILE__),
-    		"tag->FinalizeResult(&ignored; &ok): Finalise the result");
+  GPR_SPAN("CompletionQueue::Pluck: FinalizeResult", start,
+           gpr_span_clock_now(), 0);
 
   // Ignore mutations by FinalizeResult: Pluck returns the C API status
   return ev.success != 0;
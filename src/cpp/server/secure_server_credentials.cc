@@ -132,10 +132,16 @@ std::shared_ptr<ServerCredentials> SslServerCredentials(
                                     key_cert_pair->cert_chain.c_str()};
     pem_key_cert_pairs.push_back(p);
   }
-  grpc_server_credentials* c_creds = grpc_ssl_server_credentials_create(
-      options.pem_root_certs.empty() ? nullptr : options.pem_root_certs.c_str(),
-      pem_key_cert_pairs.empty() ? nullptr : &pem_key_cert_pairs[0],
-      pem_key_cert_pairs.size(), options.force_client_auth, nullptr);
+  grpc_ssl_session_cache_options session_cache = {
+      options.session_cache_size, options.session_timeout_seconds,
+      options.enable_session_tickets ? 1 : 0};
+  grpc_server_credentials* c_creds =
+      grpc_ssl_server_credentials_create_with_session_cache(
+          options.pem_root_certs.empty() ? nullptr
+                                         : options.pem_root_certs.c_str(),
+          pem_key_cert_pairs.empty() ? nullptr : &pem_key_cert_pairs[0],
+          pem_key_cert_pairs.size(), options.force_client_auth,
+          &session_cache, nullptr);
   return std::shared_ptr<ServerCredentials>(
       new SecureServerCredentials(c_creds));
 }
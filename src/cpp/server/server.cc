@@ -38,6 +38,7 @@
 #include <grpc/grpc.h>
 #include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
+#include <grpc/support/span_recorder.h>
 #include <grpc++/completion_queue.h>
 #include <grpc++/generic/async_generic_service.h>
 #include <grpc++/impl/rpc_service_method.h>
@@ -49,9 +50,6 @@
 #include "src/core/profiling/timers.h"
 #include "src/cpp/server/thread_pool_interface.h"
 
-extern int add_func_stats(std::string funcName, uint64_t start_ns, uint64_t end_nsec, std::string fName, std::string desc);
-extern uint64_t nanos_since_midnight();
-
 namespace grpc {
 
 class Server::UnimplementedAsyncRequestContext {
@@ -204,8 +202,7 @@ class Server::SyncRequest GRPC_FINAL : public CompletionQueueTag {
     explicit CallData(Server* server, SyncRequest* mrd)
         : cq_(mrd->cq_),
           call_(mrd->call_, server, &cq_, server->max_message_size_),
-          ctx_(mrd->deadline_, mrd->request_metadata_.metadata,
-               mrd->request_metadata_.count),
+          ctx_(mrd->deadline_, &mrd->request_metadata_),
           has_request_payload_(mrd->has_request_payload_),
           request_payload_(mrd->request_payload_),
           method_(mrd->method_) {
@@ -213,7 +210,6 @@ class Server::SyncRequest GRPC_FINAL : public CompletionQueueTag {
       ctx_.cq_ = &cq_;
       GPR_ASSERT(mrd->in_flight_);
       mrd->in_flight_ = false;
-      mrd->request_metadata_.count = 0;
     }
 
     ~CallData() {
@@ -424,17 +420,17 @@ void Server::Wait() {
 
 void Server::PerformOpsOnCall(CallOpSetInterface* ops, Call* call) {
 
-  uint64_t start, end;
+  gpr_uint64 start, end;
   static const size_t MAX_OPS = 8;
 
-  start = nanos_since_midnight();
+  start = gpr_span_clock_now();
   size_t nops = 0;
   grpc_op cops[MAX_OPS];
   ops->FillOps(cops, &nops);
   auto result = grpc_call_start_batch(call->call(), cops, nops, ops, nullptr);
   GPR_ASSERT(GRPC_CALL_OK == result);
-  end = nanos_since_midnight();
-  add_func_stats("Server::PerformOpsOnCall", start, end, std::string(__FILE__), "Does ops->FillOps(cops, &nops); and result = grpc_call_start_batch(call->call(), cops, nops, ops, nullptr);");
+  end = gpr_span_clock_now();
+  GPR_SPAN("Server::PerformOpsOnCall", start, end, call->call());
 }
 
 Server::BaseAsyncRequest::BaseAsyncRequest(
@@ -447,24 +443,15 @@ Server::BaseAsyncRequest::BaseAsyncRequest(
       call_cq_(call_cq),
       tag_(tag),
       delete_on_finalize_(delete_on_finalize),
-      call_(nullptr) {
-  memset(&initial_metadata_array_, 0, sizeof(initial_metadata_array_));
-}
+      call_(nullptr) {}
 
 Server::BaseAsyncRequest::~BaseAsyncRequest() {}
 
 bool Server::BaseAsyncRequest::FinalizeResult(void** tag, bool* status) {
-  if (*status) {
-    for (size_t i = 0; i < initial_metadata_array_.count; i++) {
-      context_->client_metadata_.insert(
-          std::pair<grpc::string_ref, grpc::string_ref>(
-              initial_metadata_array_.metadata[i].key,
-              grpc::string_ref(
-                  initial_metadata_array_.metadata[i].value,
-                  initial_metadata_array_.metadata[i].value_length)));
-    }
+  if (!*status) {
+    // Drop whatever the failed request may have left in the array.
+    context_->client_metadata_.c_array();
   }
-  grpc_metadata_array_destroy(&initial_metadata_array_);
   context_->set_call(call_);
   context_->cq_ = call_cq_;
   Call call(call_, server_, call_cq_, server_->max_message_size_);
@@ -490,8 +477,8 @@ void Server::RegisteredAsyncRequest::IssueRequest(
     ServerCompletionQueue* notification_cq) {
   grpc_server_request_registered_call(
       server_->server_, registered_method, &call_, &context_->deadline_,
-      &initial_metadata_array_, payload, call_cq_->cq(), notification_cq->cq(),
-      this);
+      context_->client_metadata_.c_array(), payload, call_cq_->cq(),
+      notification_cq->cq(), this);
 }
 
 Server::GenericAsyncRequest::GenericAsyncRequest(
@@ -504,7 +491,7 @@ Server::GenericAsyncRequest::GenericAsyncRequest(
   GPR_ASSERT(notification_cq);
   GPR_ASSERT(call_cq);
   grpc_server_request_call(server->server_, &call_, &call_details_,
-                           &initial_metadata_array_, call_cq->cq(),
+                           context->client_metadata_.c_array(), call_cq->cq(),
                            notification_cq->cq(), this);
 }
 
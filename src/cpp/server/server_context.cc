@@ -126,8 +126,8 @@ ServerContext::ServerContext()
       cq_(nullptr),
       sent_initial_metadata_(false) {}
 
-ServerContext::ServerContext(gpr_timespec deadline, grpc_metadata* metadata,
-                             size_t metadata_count)
+ServerContext::ServerContext(gpr_timespec deadline,
+                             grpc_metadata_array* metadata)
     : completion_op_(nullptr),
       has_notify_when_done_tag_(false),
       async_notify_when_done_tag_(nullptr),
@@ -135,11 +135,7 @@ ServerContext::ServerContext(gpr_timespec deadline, grpc_metadata* metadata,
       call_(nullptr),
       cq_(nullptr),
       sent_initial_metadata_(false) {
-  for (size_t i = 0; i < metadata_count; i++) {
-    client_metadata_.insert(std::pair<grpc::string_ref, grpc::string_ref>(
-        metadata[i].key,
-        grpc::string_ref(metadata[i].value, metadata[i].value_length)));
-  }
+  client_metadata_.Swap(metadata);
 }
 
 ServerContext::~ServerContext() {
@@ -160,14 +156,19 @@ void ServerContext::BeginCompletionOp(Call* call) {
   call->PerformOps(completion_op_);
 }
 
-void ServerContext::AddInitialMetadata(const grpc::string& key,
-                                       const grpc::string& value) {
-  initial_metadata_.insert(std::make_pair(key, value));
+void ServerContext::AddInitialMetadata(const grpc::string_ref& key,
+                                       const grpc::string_ref& value) {
+  if (sent_initial_metadata_) {
+    // The entries are in use by the core until the send completes.
+    gpr_log(GPR_ERROR, "Initial metadata has already been sent.");
+    return;
+  }
+  initial_metadata_.Add(key, value);
 }
 
-void ServerContext::AddTrailingMetadata(const grpc::string& key,
-                                        const grpc::string& value) {
-  trailing_metadata_.insert(std::make_pair(key, value));
+void ServerContext::AddTrailingMetadata(const grpc::string_ref& key,
+                                        const grpc::string_ref& value) {
+  trailing_metadata_.Add(key, value);
 }
 
 bool ServerContext::IsCancelled() const {
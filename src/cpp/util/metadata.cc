@@ -0,0 +1,169 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <grpc++/support/metadata.h>
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <grpc/support/alloc.h>
+
+namespace grpc {
+
+namespace {
+const size_t kMinBlockSize = 1024;
+}  // namespace
+
+// Heap storage used once the inline arena is full. Blocks are chained so that
+// they can be freed together; data is never moved once written.
+struct OutgoingMetadata::Block {
+  Block* next;
+};
+
+OutgoingMetadata::OutgoingMetadata()
+    : entries_(inline_entries_),
+      count_(0),
+      capacity_(kInlineEntries),
+      arena_(inline_bytes_),
+      arena_left_(kInlineBytes),
+      blocks_(nullptr) {}
+
+OutgoingMetadata::~OutgoingMetadata() {
+  if (entries_ != inline_entries_) {
+    gpr_free(entries_);
+  }
+  while (blocks_ != nullptr) {
+    Block* next = blocks_->next;
+    gpr_free(blocks_);
+    blocks_ = next;
+  }
+}
+
+char* OutgoingMetadata::CopyToArena(const grpc::string_ref& str) {
+  size_t needed = str.size() + 1;
+  if (needed > arena_left_) {
+    size_t block_size = std::max(needed, kMinBlockSize);
+    Block* block =
+        static_cast<Block*>(gpr_malloc(sizeof(Block) + block_size));
+    block->next = blocks_;
+    blocks_ = block;
+    arena_ = reinterpret_cast<char*>(block + 1);
+    arena_left_ = block_size;
+  }
+  char* dest = arena_;
+  memcpy(dest, str.data(), str.size());
+  dest[str.size()] = '\0';
+  arena_ += needed;
+  arena_left_ -= needed;
+  return dest;
+}
+
+void OutgoingMetadata::Add(const grpc::string_ref& key,
+                           const grpc::string_ref& value) {
+  if (count_ == capacity_) {
+    capacity_ *= 2;
+    if (entries_ == inline_entries_) {
+      entries_ = static_cast<grpc_metadata*>(
+          gpr_malloc(capacity_ * sizeof(grpc_metadata)));
+      memcpy(entries_, inline_entries_, count_ * sizeof(grpc_metadata));
+    } else {
+      entries_ = static_cast<grpc_metadata*>(
+          gpr_realloc(entries_, capacity_ * sizeof(grpc_metadata)));
+    }
+  }
+  grpc_metadata* md = &entries_[count_++];
+  md->key = CopyToArena(key);
+  md->value = CopyToArena(value);
+  md->value_length = value.size();
+  md->flags = 0;
+}
+
+grpc::string_ref OutgoingMetadata::key(size_t i) const {
+  return grpc::string_ref(entries_[i].key);
+}
+
+grpc::string_ref OutgoingMetadata::value(size_t i) const {
+  return grpc::string_ref(entries_[i].value, entries_[i].value_length);
+}
+
+IncomingMetadata::IncomingMetadata() : map_built_(false) {
+  grpc_metadata_array_init(&array_);
+}
+
+IncomingMetadata::~IncomingMetadata() { grpc_metadata_array_destroy(&array_); }
+
+grpc::string_ref IncomingMetadata::key(size_t i) const {
+  return grpc::string_ref(array_.metadata[i].key);
+}
+
+grpc::string_ref IncomingMetadata::value(size_t i) const {
+  return grpc::string_ref(array_.metadata[i].value,
+                          array_.metadata[i].value_length);
+}
+
+bool IncomingMetadata::Find(const grpc::string_ref& key,
+                            grpc::string_ref* value) const {
+  for (size_t i = 0; i < array_.count; i++) {
+    if (key == array_.metadata[i].key) {
+      *value = this->value(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+const IncomingMetadata::Map& IncomingMetadata::map() const {
+  if (!map_built_) {
+    for (size_t i = 0; i < array_.count; i++) {
+      map_.insert(std::make_pair(key(i), value(i)));
+    }
+    map_built_ = true;
+  }
+  return map_;
+}
+
+grpc_metadata_array* IncomingMetadata::c_array() {
+  array_.count = 0;
+  map_.clear();
+  map_built_ = false;
+  return &array_;
+}
+
+void IncomingMetadata::Swap(grpc_metadata_array* array) {
+  c_array();
+  std::swap(array_, *array);
+}
+
+}  // namespace grpc
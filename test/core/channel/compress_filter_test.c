@@ -0,0 +1,554 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "src/core/channel/compress_filter.h"
+
+#include <string.h>
+
+#include <grpc/compression.h>
+#include <grpc/support/alloc.h>
+#include <grpc/support/log.h>
+#include <grpc/support/string_util.h>
+#include <grpc/support/useful.h>
+
+#include "src/core/transport/stream_op.h"
+#include "test/core/util/test_config.h"
+
+#define MESSAGE_SIZE 65536
+#define MAX_BATCH_MESSAGES 8
+
+/* Payloads, as the interop test services fill them in: COMPRESSABLE ones are
+   all zeros, UNCOMPRESSABLE ones are random bytes. */
+typedef enum { COMPRESSABLE, UNCOMPRESSABLE } payload_type;
+
+/* What the filter below the compress filter saw of the messages of the last
+   batch, and of the receive the call was started with */
+typedef struct {
+  size_t messages;
+  gpr_uint32 flags[MAX_BATCH_MESSAGES];
+  gpr_uint32 length[MAX_BATCH_MESSAGES];
+  grpc_stream_op_buffer *recv_ops;
+  grpc_closure *on_done_recv;
+} sent_message;
+
+static void capture_func(grpc_exec_ctx *exec_ctx, grpc_call_element *elem,
+                         grpc_transport_stream_op *op) {
+  sent_message *sent = elem->call_data;
+  size_t i;
+  gpr_uint32 remaining = 0;
+  if (op->send_ops == NULL) return;
+  sent->messages = 0;
+  for (i = 0; i < op->send_ops->nops; i++) {
+    grpc_stream_op *sop = &op->send_ops->ops[i];
+    switch (sop->type) {
+      case GRPC_OP_BEGIN_MESSAGE:
+        /* every message's slices follow its own BEGIN_MESSAGE */
+        GPR_ASSERT(remaining == 0);
+        GPR_ASSERT(sent->messages < MAX_BATCH_MESSAGES);
+        sent->flags[sent->messages] = sop->data.begin_message.flags;
+        sent->length[sent->messages] = sop->data.begin_message.length;
+        sent->messages++;
+        remaining = sop->data.begin_message.length;
+        break;
+      case GRPC_OP_SLICE:
+        GPR_ASSERT(GPR_SLICE_LENGTH(sop->data.slice) <= remaining);
+        remaining -= (gpr_uint32)GPR_SLICE_LENGTH(sop->data.slice);
+        break;
+      case GRPC_OP_METADATA:
+      case GRPC_NO_OP:
+        break;
+    }
+  }
+  GPR_ASSERT(remaining == 0);
+}
+
+static void capture_channel_func(grpc_exec_ctx *exec_ctx,
+                                 grpc_channel_element *elem,
+                                 grpc_transport_op *op) {}
+
+static void capture_init_call_elem(grpc_exec_ctx *exec_ctx,
+                                   grpc_call_element *elem,
+                                   const void *server_transport_data,
+                                   grpc_transport_stream_op *initial_op) {
+  sent_message *sent = elem->call_data;
+  memset(sent, 0, sizeof(*sent));
+  if (initial_op != NULL) {
+    sent->recv_ops = initial_op->recv_ops;
+    sent->on_done_recv = initial_op->on_done_recv;
+  }
+}
+
+static void capture_destroy_call_elem(grpc_exec_ctx *exec_ctx,
+                                      grpc_call_element *elem) {}
+
+static void capture_init_channel_elem(grpc_exec_ctx *exec_ctx,
+                                      grpc_channel_element *elem,
+                                      grpc_channel *master,
+                                      const grpc_channel_args *args,
+                                      grpc_mdctx *metadata_context,
+                                      int is_first, int is_last) {
+  GPR_ASSERT(is_last);
+}
+
+static void capture_destroy_channel_elem(grpc_exec_ctx *exec_ctx,
+                                         grpc_channel_element *elem) {}
+
+static char *capture_get_peer(grpc_exec_ctx *exec_ctx,
+                              grpc_call_element *elem) {
+  return gpr_strdup("peer");
+}
+
+static const grpc_channel_filter capture_filter = {
+    capture_func,
+    capture_channel_func,
+    sizeof(sent_message),
+    capture_init_call_elem,
+    capture_destroy_call_elem,
+    0,
+    capture_init_channel_elem,
+    capture_destroy_channel_elem,
+    capture_get_peer,
+    "capture"};
+
+typedef struct {
+  grpc_mdctx *mdctx;
+  grpc_channel_stack *channel_stack;
+} test_channel;
+
+typedef struct {
+  test_channel *channel;
+  grpc_call_stack *call_stack;
+  grpc_linked_mdelem path_storage;
+  const char *method;
+  int is_server;
+  int sent_metadata;
+  /* server calls: where the incoming initial metadata is received */
+  grpc_stream_op_buffer recv_ops;
+  grpc_closure on_done_recv;
+  int got_recv;
+} test_call;
+
+static void create_channel(test_channel *channel, int min_message_size,
+                           int adaptive) {
+  const grpc_channel_filter *filters[] = {&grpc_compress_filter,
+                                          &capture_filter};
+  grpc_arg args[3];
+  grpc_channel_args channel_args;
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+
+  args[0].type = GRPC_ARG_INTEGER;
+  args[0].key = GRPC_COMPRESSION_ALGORITHM_ARG;
+  args[0].value.integer = GRPC_COMPRESS_GZIP;
+  args[1].type = GRPC_ARG_INTEGER;
+  args[1].key = GRPC_COMPRESSION_MIN_MESSAGE_SIZE_ARG;
+  args[1].value.integer = min_message_size;
+  args[2].type = GRPC_ARG_INTEGER;
+  args[2].key = GRPC_COMPRESSION_ADAPTIVE_ARG;
+  args[2].value.integer = adaptive;
+  channel_args.num_args = GPR_ARRAY_SIZE(args);
+  channel_args.args = args;
+
+  channel->mdctx = grpc_mdctx_create();
+  channel->channel_stack =
+      gpr_malloc(grpc_channel_stack_size(filters, GPR_ARRAY_SIZE(filters)));
+  grpc_channel_stack_init(&exec_ctx, filters, GPR_ARRAY_SIZE(filters), NULL,
+                          &channel_args, channel->mdctx,
+                          channel->channel_stack);
+  grpc_exec_ctx_finish(&exec_ctx);
+}
+
+static void destroy_channel(test_channel *channel) {
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  grpc_channel_stack_destroy(&exec_ctx, channel->channel_stack);
+  gpr_free(channel->channel_stack);
+  grpc_exec_ctx_finish(&exec_ctx);
+  grpc_mdctx_unref(channel->mdctx);
+}
+
+static void start_call(test_call *call, test_channel *channel,
+                       const char *method) {
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  call->channel = channel;
+  call->method = method;
+  call->is_server = 0;
+  call->sent_metadata = 0;
+  call->call_stack = gpr_malloc(channel->channel_stack->call_stack_size);
+  grpc_call_stack_init(&exec_ctx, channel->channel_stack, NULL, NULL,
+                       call->call_stack);
+  grpc_exec_ctx_finish(&exec_ctx);
+}
+
+static void on_done_recv(grpc_exec_ctx *exec_ctx, void *arg, int success) {
+  test_call *call = arg;
+  GPR_ASSERT(success);
+  call->got_recv = 1;
+}
+
+/* Starts a server call, which learns its method from the :path of the
+   incoming initial metadata rather than from what it sends */
+static void start_server_call(test_call *call, test_channel *channel,
+                              const char *method) {
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  grpc_transport_stream_op initial_op;
+  sent_message *sent;
+  grpc_metadata_batch metadata;
+
+  call->channel = channel;
+  call->method = method;
+  call->is_server = 1;
+  call->sent_metadata = 0;
+  call->got_recv = 0;
+  grpc_sopb_init(&call->recv_ops);
+  grpc_closure_init(&call->on_done_recv, on_done_recv, call);
+
+  /* as the server does, the call starts out receiving */
+  memset(&initial_op, 0, sizeof(initial_op));
+  initial_op.recv_ops = &call->recv_ops;
+  initial_op.on_done_recv = &call->on_done_recv;
+  call->call_stack = gpr_malloc(channel->channel_stack->call_stack_size);
+  grpc_call_stack_init(&exec_ctx, channel->channel_stack, NULL, &initial_op,
+                       call->call_stack);
+
+  /* play the transport: deliver the initial metadata to what was passed
+     down */
+  sent = grpc_call_stack_element(call->call_stack, 1)->call_data;
+  GPR_ASSERT(sent->recv_ops == &call->recv_ops);
+  GPR_ASSERT(sent->on_done_recv != &call->on_done_recv);
+  grpc_metadata_batch_init(&metadata);
+  grpc_metadata_batch_add_tail(
+      &metadata, &call->path_storage,
+      grpc_mdelem_from_strings(channel->mdctx, ":path", method));
+  grpc_sopb_add_metadata(sent->recv_ops, metadata);
+  sent->on_done_recv->cb(&exec_ctx, sent->on_done_recv->cb_arg, 1);
+  grpc_exec_ctx_finish(&exec_ctx);
+  GPR_ASSERT(call->got_recv);
+}
+
+static void finish_call(test_call *call) {
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  grpc_call_stack_destroy(&exec_ctx, call->call_stack);
+  gpr_free(call->call_stack);
+  grpc_exec_ctx_finish(&exec_ctx);
+  if (call->is_server) grpc_sopb_destroy(&call->recv_ops);
+}
+
+static gpr_slice make_payload(payload_type type, size_t length) {
+  gpr_slice slice = gpr_slice_malloc(length);
+  gpr_uint8 *p = GPR_SLICE_START_PTR(slice);
+  gpr_uint32 state = 1;
+  size_t i;
+  for (i = 0; i < length; i++) {
+    state = state * 1103515245 + 12345;
+    p[i] = type == UNCOMPRESSABLE ? (gpr_uint8)(state >> 24) : 0;
+  }
+  return slice;
+}
+
+/* Sends \a n messages of \a length bytes, of payload \a types, on \a call
+   in one batch, and sets compressed[i] to whether the filter compressed the
+   i-th of them. Messages of COMPRESSABLE payload are split into two
+   slices. */
+static void send_batch(test_call *call, const payload_type *types, size_t n,
+                       size_t length, int *compressed) {
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  grpc_call_element *elem = grpc_call_stack_element(call->call_stack, 0);
+  sent_message *sent =
+      grpc_call_stack_element(call->call_stack, 1)->call_data;
+  grpc_stream_op_buffer sopb;
+  grpc_transport_stream_op op;
+  size_t i;
+
+  grpc_sopb_init(&sopb);
+  if (!call->sent_metadata) {
+    grpc_metadata_batch metadata;
+    grpc_metadata_batch_init(&metadata);
+    if (!call->is_server) {
+      grpc_metadata_batch_add_tail(
+          &metadata, &call->path_storage,
+          grpc_mdelem_from_strings(call->channel->mdctx, ":path",
+                                   call->method));
+    }
+    grpc_sopb_add_metadata(&sopb, metadata);
+    call->sent_metadata = 1;
+  }
+  for (i = 0; i < n; i++) {
+    gpr_slice payload = make_payload(types[i], length);
+    grpc_sopb_add_begin_message(&sopb, (gpr_uint32)length, 0);
+    if (types[i] == COMPRESSABLE) {
+      grpc_sopb_add_slice(&sopb, gpr_slice_split_head(&payload, length / 2));
+    }
+    grpc_sopb_add_slice(&sopb, payload);
+  }
+
+  memset(&op, 0, sizeof(op));
+  op.send_ops = &sopb;
+  elem->filter->start_transport_stream_op(&exec_ctx, elem, &op);
+  grpc_exec_ctx_finish(&exec_ctx);
+  grpc_sopb_destroy(&sopb);
+
+  GPR_ASSERT(sent->messages == n);
+  for (i = 0; i < n; i++) {
+    compressed[i] = (sent->flags[i] & GRPC_WRITE_INTERNAL_COMPRESS) != 0;
+    if (compressed[i]) {
+      GPR_ASSERT(sent->length[i] < length);
+    } else {
+      GPR_ASSERT(sent->length[i] == length);
+    }
+  }
+}
+
+/* Sends one message of \a length bytes on \a call, and returns whether the
+   filter compressed it */
+static int send_message(test_call *call, payload_type type, size_t length) {
+  int compressed;
+  send_batch(call, &type, 1, length, &compressed);
+  return compressed;
+}
+
+static grpc_compress_filter_stats stats_since(
+    const grpc_compress_filter_stats *before) {
+  grpc_compress_filter_stats now;
+  grpc_compress_filter_get_stats(&now);
+  now.compressed -= before->compressed;
+  now.not_smaller -= before->not_smaller;
+  now.skipped_small -= before->skipped_small;
+  now.skipped_entropy -= before->skipped_entropy;
+  now.skipped_method -= before->skipped_method;
+  now.methods_disabled -= before->methods_disabled;
+  return now;
+}
+
+static void test_small_messages_are_not_compressed(void) {
+  test_channel channel;
+  test_call call;
+  grpc_compress_filter_stats before;
+  grpc_compress_filter_stats delta;
+
+  gpr_log(GPR_INFO, "test_small_messages_are_not_compressed");
+  grpc_compress_filter_get_stats(&before);
+  create_channel(&channel, 1024, 1);
+  start_call(&call, &channel, "/foo/small");
+  GPR_ASSERT(!send_message(&call, COMPRESSABLE, 1023));
+  GPR_ASSERT(send_message(&call, COMPRESSABLE, 1024));
+  finish_call(&call);
+  destroy_channel(&channel);
+
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.skipped_small == 1);
+  GPR_ASSERT(delta.compressed == 1);
+}
+
+static void test_uncompressable_payloads_are_not_compressed(void) {
+  test_channel channel;
+  test_call call;
+  grpc_compress_filter_stats before;
+  grpc_compress_filter_stats delta;
+
+  gpr_log(GPR_INFO, "test_uncompressable_payloads_are_not_compressed");
+  grpc_compress_filter_get_stats(&before);
+  create_channel(&channel, 0, 1);
+  start_call(&call, &channel, "/foo/uncompressable");
+  GPR_ASSERT(!send_message(&call, UNCOMPRESSABLE, MESSAGE_SIZE));
+  finish_call(&call);
+  destroy_channel(&channel);
+
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.skipped_entropy == 1);
+  GPR_ASSERT(delta.not_smaller == 0);
+  GPR_ASSERT(delta.compressed == 0);
+}
+
+static void test_methods_that_stop_compressing_are_skipped(void) {
+  test_channel channel;
+  test_call call;
+  test_call other_call;
+  grpc_compress_filter_stats before;
+  grpc_compress_filter_stats delta;
+  int i;
+
+  gpr_log(GPR_INFO, "test_methods_that_stop_compressing_are_skipped");
+  grpc_compress_filter_get_stats(&before);
+  create_channel(&channel, 0, 1);
+  start_call(&call, &channel, "/foo/files");
+  start_call(&other_call, &channel, "/foo/zeros");
+
+  /* Small enough to escape the entropy estimate, so these are compressed
+     before the method learns not to bother */
+  for (i = 0; i < 4; i++) {
+    GPR_ASSERT(!send_message(&call, UNCOMPRESSABLE, 512));
+  }
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.not_smaller == 4);
+  GPR_ASSERT(delta.methods_disabled == 1);
+
+  /* Now the method's messages go uncompressed, even compressable ones, until
+     it's time to check again; other methods aren't affected */
+  for (i = 0; i < 16; i++) {
+    GPR_ASSERT(!send_message(&call, COMPRESSABLE, MESSAGE_SIZE));
+    GPR_ASSERT(send_message(&other_call, COMPRESSABLE, MESSAGE_SIZE));
+  }
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.skipped_method == 16);
+  GPR_ASSERT(delta.compressed == 16);
+
+  /* The retry compresses well, so the method is compressed again */
+  GPR_ASSERT(send_message(&call, COMPRESSABLE, MESSAGE_SIZE));
+  GPR_ASSERT(send_message(&call, COMPRESSABLE, MESSAGE_SIZE));
+
+  /* A new call to the method shares what was learned on the channel: it
+     takes six poor messages to outweigh the two good ones */
+  finish_call(&call);
+  start_call(&call, &channel, "/foo/files");
+  for (i = 0; i < 6; i++) {
+    GPR_ASSERT(!send_message(&call, UNCOMPRESSABLE, MESSAGE_SIZE));
+  }
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.methods_disabled == 2);
+  GPR_ASSERT(!send_message(&call, COMPRESSABLE, MESSAGE_SIZE));
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.skipped_entropy == 6);
+  GPR_ASSERT(delta.methods_disabled == 2);
+  GPR_ASSERT(delta.skipped_method == 17);
+
+  finish_call(&call);
+  finish_call(&other_call);
+  destroy_channel(&channel);
+}
+
+static void test_adaptive_compression_can_be_disabled(void) {
+  test_channel channel;
+  test_call call;
+  grpc_compress_filter_stats before;
+  grpc_compress_filter_stats delta;
+  int i;
+
+  gpr_log(GPR_INFO, "test_adaptive_compression_can_be_disabled");
+  grpc_compress_filter_get_stats(&before);
+  create_channel(&channel, 0, 0);
+  start_call(&call, &channel, "/foo/uncompressable");
+  for (i = 0; i < 8; i++) {
+    GPR_ASSERT(!send_message(&call, UNCOMPRESSABLE, MESSAGE_SIZE));
+  }
+  GPR_ASSERT(send_message(&call, COMPRESSABLE, MESSAGE_SIZE));
+  finish_call(&call);
+  destroy_channel(&channel);
+
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.not_smaller == 8);
+  GPR_ASSERT(delta.compressed == 1);
+  GPR_ASSERT(delta.skipped_entropy == 0);
+  GPR_ASSERT(delta.skipped_method == 0);
+}
+
+static void test_server_learns_method_from_incoming_metadata(void) {
+  test_channel channel;
+  test_call call;
+  test_call other_call;
+  grpc_compress_filter_stats before;
+  grpc_compress_filter_stats delta;
+  int i;
+
+  gpr_log(GPR_INFO, "test_server_learns_method_from_incoming_metadata");
+  grpc_compress_filter_get_stats(&before);
+  create_channel(&channel, 0, 1);
+  start_server_call(&call, &channel, "/bar/files");
+  start_server_call(&other_call, &channel, "/bar/zeros");
+
+  for (i = 0; i < 4; i++) {
+    GPR_ASSERT(!send_message(&call, UNCOMPRESSABLE, 512));
+  }
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.methods_disabled == 1);
+
+  /* Had the calls not told their methods apart, the shared entry would now
+     skip both */
+  GPR_ASSERT(!send_message(&call, COMPRESSABLE, MESSAGE_SIZE));
+  GPR_ASSERT(send_message(&other_call, COMPRESSABLE, MESSAGE_SIZE));
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.skipped_method == 1);
+  GPR_ASSERT(delta.compressed == 1);
+
+  finish_call(&call);
+  finish_call(&other_call);
+  destroy_channel(&channel);
+}
+
+static void test_batched_messages_are_compressed_separately(void) {
+  static const payload_type mixed[] = {COMPRESSABLE, UNCOMPRESSABLE,
+                                       COMPRESSABLE};
+  static const payload_type poor[] = {
+      UNCOMPRESSABLE, UNCOMPRESSABLE, UNCOMPRESSABLE, UNCOMPRESSABLE,
+      UNCOMPRESSABLE, UNCOMPRESSABLE, UNCOMPRESSABLE, UNCOMPRESSABLE};
+  test_channel channel;
+  test_call call;
+  grpc_compress_filter_stats before;
+  grpc_compress_filter_stats delta;
+  int compressed[MAX_BATCH_MESSAGES];
+
+  gpr_log(GPR_INFO, "test_batched_messages_are_compressed_separately");
+  grpc_compress_filter_get_stats(&before);
+  create_channel(&channel, 0, 1);
+  start_call(&call, &channel, "/foo/batched");
+
+  /* each message is decided on, and compressed, on its own */
+  send_batch(&call, mixed, GPR_ARRAY_SIZE(mixed), MESSAGE_SIZE, compressed);
+  GPR_ASSERT(compressed[0] && !compressed[1] && compressed[2]);
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.compressed == 2);
+  GPR_ASSERT(delta.skipped_entropy == 1);
+
+  /* and is one sample of the method's compression ratio: it takes eight
+     poor messages, small enough to escape the entropy estimate, to turn
+     compression off */
+  send_batch(&call, poor, GPR_ARRAY_SIZE(poor), 512, compressed);
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.not_smaller == 8);
+  GPR_ASSERT(delta.methods_disabled == 1);
+  GPR_ASSERT(!send_message(&call, COMPRESSABLE, MESSAGE_SIZE));
+  delta = stats_since(&before);
+  GPR_ASSERT(delta.skipped_method == 1);
+
+  finish_call(&call);
+  destroy_channel(&channel);
+}
+
+int main(int argc, char **argv) {
+  grpc_test_init(argc, argv);
+  test_small_messages_are_not_compressed();
+  test_uncompressable_payloads_are_not_compressed();
+  test_methods_that_stop_compressing_are_skipped();
+  test_adaptive_compression_can_be_disabled();
+  test_server_learns_method_from_incoming_metadata();
+  test_batched_messages_are_compressed_separately();
+  return 0;
+}
@@ -0,0 +1,269 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+/* Measures the throughput of round_robin picks issued concurrently from many
+   threads against a single policy whose subchannels are all READY.
+
+   Subchannels are connected through an in-process connector (an endpoint pair
+   per subchannel) so that no network activity is involved: only the cost of
+   the pick path itself is measured. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <grpc/grpc.h>
+#include <grpc/support/alloc.h>
+#include <grpc/support/cmdline.h>
+#include <grpc/support/log.h>
+#include <grpc/support/sync.h>
+#include <grpc/support/thd.h>
+#include <grpc/support/time.h>
+
+#include "src/core/client_config/lb_policy_registry.h"
+#include "src/core/client_config/subchannel.h"
+#include "src/core/iomgr/endpoint_pair.h"
+#include "src/core/iomgr/sockaddr.h"
+#include "src/core/surface/channel.h"
+#include "src/core/transport/chttp2_transport.h"
+#include "test/core/util/test_config.h"
+
+#define MAX_SUBCHANNELS 64
+
+/* Connector handing out chttp2 transports over in-process endpoint pairs */
+typedef struct {
+  grpc_connector base;
+  grpc_mdctx *mdctx;
+  gpr_mu mu;
+  /* the server sides of the endpoint pairs, kept open until teardown */
+  grpc_endpoint *server_endpoints[MAX_SUBCHANNELS];
+  size_t num_server_endpoints;
+} pair_connector;
+
+static void pair_connector_ref(grpc_connector *con) {}
+
+static void pair_connector_unref(grpc_exec_ctx *exec_ctx,
+                                 grpc_connector *con) {}
+
+static void pair_connector_shutdown(grpc_exec_ctx *exec_ctx,
+                                    grpc_connector *con) {}
+
+static void pair_connector_connect(grpc_exec_ctx *exec_ctx,
+                                   grpc_connector *con,
+                                   const grpc_connect_in_args *in_args,
+                                   grpc_connect_out_args *out_args,
+                                   grpc_closure *notify) {
+  pair_connector *c = (pair_connector *)con;
+  grpc_endpoint_pair pair =
+      grpc_iomgr_create_endpoint_pair("rr_pick_benchmark", 65536);
+  gpr_mu_lock(&c->mu);
+  GPR_ASSERT(c->num_server_endpoints < MAX_SUBCHANNELS);
+  c->server_endpoints[c->num_server_endpoints++] = pair.server;
+  gpr_mu_unlock(&c->mu);
+  out_args->transport = grpc_create_chttp2_transport(
+      exec_ctx, in_args->channel_args, pair.client, c->mdctx, 1);
+  grpc_chttp2_transport_start_reading(exec_ctx, out_args->transport, NULL, 0);
+  out_args->filters = NULL;
+  out_args->num_filters = 0;
+  grpc_exec_ctx_enqueue(exec_ctx, notify, 1);
+}
+
+static const grpc_connector_vtable pair_connector_vtable = {
+    pair_connector_ref, pair_connector_unref, pair_connector_shutdown,
+    pair_connector_connect};
+
+typedef struct {
+  grpc_lb_policy *policy;
+  grpc_pollset *pollset;
+  int picks;
+  gpr_event *start;
+  gpr_event done;
+} picker_args;
+
+static void on_pick_done(grpc_exec_ctx *exec_ctx, void *arg, int success) {
+  GPR_ASSERT(success);
+}
+
+static void picker_thread(void *arg) {
+  picker_args *a = arg;
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  grpc_closure on_complete;
+  grpc_subchannel *target;
+  int i;
+
+  grpc_closure_init(&on_complete, on_pick_done, NULL);
+  gpr_event_wait(a->start, gpr_inf_future(GPR_CLOCK_REALTIME));
+  for (i = 0; i < a->picks; i++) {
+    target = NULL;
+    grpc_lb_policy_pick(&exec_ctx, a->policy, a->pollset, NULL, &target,
+                        &on_complete);
+    GPR_ASSERT(target != NULL);
+  }
+  grpc_exec_ctx_finish(&exec_ctx);
+  gpr_event_set(&a->done, (void *)1);
+}
+
+/* Runs picks_per_thread picks on each of num_threads threads, returning the
+   aggregate number of picks per second */
+static double run_picks(grpc_lb_policy *policy, grpc_pollset *pollset,
+                        int num_threads, int picks_per_thread) {
+  picker_args *args = gpr_malloc(sizeof(*args) * (size_t)num_threads);
+  gpr_event start;
+  gpr_timespec begin;
+  double elapsed;
+  int i;
+
+  gpr_event_init(&start);
+  for (i = 0; i < num_threads; i++) {
+    gpr_thd_id id;
+    args[i].policy = policy;
+    args[i].pollset = pollset;
+    args[i].picks = picks_per_thread;
+    args[i].start = &start;
+    gpr_event_init(&args[i].done);
+    GPR_ASSERT(gpr_thd_new(&id, picker_thread, &args[i], NULL));
+  }
+  begin = gpr_now(GPR_CLOCK_MONOTONIC);
+  gpr_event_set(&start, (void *)1);
+  for (i = 0; i < num_threads; i++) {
+    gpr_event_wait(&args[i].done, gpr_inf_future(GPR_CLOCK_REALTIME));
+  }
+  elapsed = gpr_timespec_to_micros(
+                gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), begin)) /
+            1e6;
+  gpr_free(args);
+  return (double)num_threads * picks_per_thread / elapsed;
+}
+
+static void wait_for_ready(grpc_lb_policy *policy) {
+  gpr_timespec deadline = GRPC_TIMEOUT_SECONDS_TO_DEADLINE(10);
+  for (;;) {
+    grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+    grpc_connectivity_state state =
+        grpc_lb_policy_check_connectivity(&exec_ctx, policy);
+    grpc_exec_ctx_finish(&exec_ctx);
+    if (state == GRPC_CHANNEL_READY) return;
+    GPR_ASSERT(gpr_time_cmp(gpr_now(GPR_CLOCK_REALTIME), deadline) < 0);
+    gpr_sleep_until(GRPC_TIMEOUT_MILLIS_TO_DEADLINE(10));
+  }
+}
+
+static void do_nothing(grpc_exec_ctx *exec_ctx, void *arg, int success) {}
+
+int main(int argc, char **argv) {
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  int num_subchannels = 8;
+  int max_threads = 16;
+  int picks_per_thread = 1000000;
+  gpr_cmdline *cl;
+  grpc_channel *master;
+  pair_connector connector;
+  grpc_subchannel *subchannels[MAX_SUBCHANNELS];
+  grpc_subchannel_args sc_args;
+  grpc_lb_policy_args lb_args;
+  grpc_lb_policy *policy;
+  grpc_pollset pollset;
+  grpc_closure destroyed;
+  grpc_transport_op disconnect;
+  struct sockaddr_in addr;
+  int threads;
+  size_t i;
+
+  grpc_test_init(argc, argv);
+
+  cl = gpr_cmdline_create("round_robin pick benchmark");
+  gpr_cmdline_add_int(cl, "subchannels", "Number of READY subchannels",
+                      &num_subchannels);
+  gpr_cmdline_add_int(cl, "max_threads", "Largest number of picking threads",
+                      &max_threads);
+  gpr_cmdline_add_int(cl, "picks_per_thread", "Picks issued by each thread",
+                      &picks_per_thread);
+  gpr_cmdline_parse(cl, argc, argv);
+  gpr_cmdline_destroy(cl);
+  GPR_ASSERT(num_subchannels > 0 && num_subchannels <= MAX_SUBCHANNELS);
+
+  grpc_init();
+  grpc_pollset_init(&pollset);
+
+  /* subchannels need a master client channel to hang off */
+  master = grpc_insecure_channel_create("ipv4:127.0.0.1:1", NULL, NULL);
+
+  memset(&connector, 0, sizeof(connector));
+  connector.base.vtable = &pair_connector_vtable;
+  connector.mdctx = grpc_channel_get_metadata_context(master);
+  gpr_mu_init(&connector.mu);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  memset(&sc_args, 0, sizeof(sc_args));
+  sc_args.addr = (struct sockaddr *)&addr;
+  sc_args.addr_len = sizeof(addr);
+  sc_args.mdctx = connector.mdctx;
+  sc_args.master = master;
+  for (i = 0; i < (size_t)num_subchannels; i++) {
+    subchannels[i] = grpc_subchannel_create(&connector.base, &sc_args);
+  }
+  lb_args.subchannels = subchannels;
+  lb_args.num_subchannels = (size_t)num_subchannels;
+  policy = grpc_lb_policy_create("round_robin", &lb_args);
+  GPR_ASSERT(policy != NULL);
+  grpc_lb_policy_exit_idle(&exec_ctx, policy);
+  grpc_exec_ctx_finish(&exec_ctx);
+  wait_for_ready(policy);
+
+  for (threads = 1; threads <= max_threads; threads *= 2) {
+    double rate = run_picks(policy, &pollset, threads, picks_per_thread);
+    printf("threads=%d subchannels=%d picks/s=%.0f picks/s/thread=%.0f\n",
+           threads, num_subchannels, rate, rate / threads);
+  }
+
+  /* disconnect the subchannels, as a client channel going away does: that
+     fails them, which releases the policy's connectivity watches and lets
+     the transports (and their client endpoints) go */
+  memset(&disconnect, 0, sizeof(disconnect));
+  disconnect.disconnect = 1;
+  grpc_lb_policy_broadcast(&exec_ctx, policy, &disconnect);
+  grpc_lb_policy_shutdown(&exec_ctx, policy);
+  GRPC_LB_POLICY_UNREF(&exec_ctx, policy, "benchmark");
+  for (i = 0; i < connector.num_server_endpoints; i++) {
+    grpc_endpoint_destroy(&exec_ctx, connector.server_endpoints[i]);
+  }
+  grpc_closure_init(&destroyed, do_nothing, NULL);
+  grpc_pollset_shutdown(&exec_ctx, &pollset, &destroyed);
+  grpc_exec_ctx_finish(&exec_ctx);
+  grpc_pollset_destroy(&pollset);
+  grpc_channel_destroy(master);
+  gpr_mu_destroy(&connector.mu);
+  grpc_shutdown();
+  return 0;
+}
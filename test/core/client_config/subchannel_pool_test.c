@@ -0,0 +1,255 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string.h>
+
+#include <grpc/grpc.h>
+#include <grpc/support/alloc.h>
+#include <grpc/support/host_port.h>
+#include <grpc/support/log.h>
+#include <grpc/support/time.h>
+
+#include "test/core/end2end/cq_verifier.h"
+#include "test/core/util/port.h"
+#include "test/core/util/test_config.h"
+
+#define MAX_CALLS_PER_ROUND 16
+#define MAX_ROUNDS 50
+
+typedef struct fixture {
+  grpc_server *server;
+  grpc_channel *client;
+  grpc_completion_queue *cq;
+  /* distinct client addresses seen by the server: one per connection */
+  char *peers[MAX_CALLS_PER_ROUND * MAX_ROUNDS];
+  size_t num_peers;
+} fixture;
+
+static void *tag(gpr_intptr t) { return (void *)t; }
+
+static void record_peer(fixture *f, char *peer) {
+  size_t i;
+  for (i = 0; i < f->num_peers; i++) {
+    if (0 == strcmp(f->peers[i], peer)) {
+      gpr_free(peer);
+      return;
+    }
+  }
+  f->peers[f->num_peers++] = peer;
+}
+
+static void setup(fixture *f, int max_connections,
+                  int streams_per_connection) {
+  char *hostport;
+  grpc_arg args[2];
+  grpc_channel_args client_args;
+  int port = grpc_pick_unused_port_or_die();
+
+  memset(f, 0, sizeof(*f));
+  gpr_join_host_port(&hostport, "127.0.0.1", port);
+  f->cq = grpc_completion_queue_create(NULL);
+  f->server = grpc_server_create(NULL, NULL);
+  grpc_server_register_completion_queue(f->server, f->cq, NULL);
+  GPR_ASSERT(grpc_server_add_insecure_http2_port(f->server, hostport) == port);
+  grpc_server_start(f->server);
+
+  args[0].type = GRPC_ARG_INTEGER;
+  args[0].key = GRPC_ARG_MAX_SUBCHANNEL_CONNECTIONS;
+  args[0].value.integer = max_connections;
+  args[1].type = GRPC_ARG_INTEGER;
+  args[1].key = GRPC_ARG_SUBCHANNEL_STREAMS_PER_CONNECTION;
+  args[1].value.integer = streams_per_connection;
+  client_args.num_args = 2;
+  client_args.args = args;
+  f->client = grpc_insecure_channel_create(hostport, &client_args, NULL);
+  gpr_free(hostport);
+}
+
+static void teardown(fixture *f) {
+  size_t i;
+  grpc_event ev;
+  grpc_channel_destroy(f->client);
+  grpc_server_shutdown_and_notify(f->server, f->cq, tag(10000));
+  GPR_ASSERT(grpc_completion_queue_pluck(
+                 f->cq, tag(10000), GRPC_TIMEOUT_SECONDS_TO_DEADLINE(5), NULL)
+                 .type == GRPC_OP_COMPLETE);
+  grpc_server_destroy(f->server);
+  grpc_completion_queue_shutdown(f->cq);
+  do {
+    ev = grpc_completion_queue_next(f->cq, GRPC_TIMEOUT_SECONDS_TO_DEADLINE(5),
+                                    NULL);
+  } while (ev.type != GRPC_QUEUE_SHUTDOWN);
+  grpc_completion_queue_destroy(f->cq);
+  for (i = 0; i < f->num_peers; i++) {
+    gpr_free(f->peers[i]);
+  }
+}
+
+/* Runs num_calls calls that are all active on the server at the same time,
+   recording which connection each one arrived on. */
+static void run_round(fixture *f, size_t num_calls) {
+  grpc_call *client_calls[MAX_CALLS_PER_ROUND];
+  grpc_call *server_calls[MAX_CALLS_PER_ROUND];
+  grpc_call_details call_details[MAX_CALLS_PER_ROUND];
+  grpc_metadata_array request_metadata[MAX_CALLS_PER_ROUND];
+  grpc_metadata_array initial_metadata_recv[MAX_CALLS_PER_ROUND];
+  grpc_metadata_array trailing_metadata_recv[MAX_CALLS_PER_ROUND];
+  grpc_status_code status[MAX_CALLS_PER_ROUND];
+  char *details[MAX_CALLS_PER_ROUND];
+  size_t details_capacity[MAX_CALLS_PER_ROUND];
+  int was_cancelled[MAX_CALLS_PER_ROUND];
+  cq_verifier *cqv = cq_verifier_create(f->cq);
+  gpr_timespec deadline = GRPC_TIMEOUT_SECONDS_TO_DEADLINE(10);
+  grpc_op ops[4];
+  grpc_op *op;
+  size_t i;
+
+  GPR_ASSERT(num_calls <= MAX_CALLS_PER_ROUND);
+  memset(ops, 0, sizeof(ops));
+  for (i = 0; i < num_calls; i++) {
+    grpc_metadata_array_init(&initial_metadata_recv[i]);
+    grpc_metadata_array_init(&trailing_metadata_recv[i]);
+    grpc_metadata_array_init(&request_metadata[i]);
+    grpc_call_details_init(&call_details[i]);
+    details[i] = NULL;
+    details_capacity[i] = 0;
+    client_calls[i] =
+        grpc_channel_create_call(f->client, NULL, GRPC_PROPAGATE_DEFAULTS,
+                                 f->cq, "/foo", "foo.test.google.fr", deadline,
+                                 NULL);
+    GPR_ASSERT(client_calls[i]);
+    op = ops;
+    op->op = GRPC_OP_SEND_INITIAL_METADATA;
+    op->data.send_initial_metadata.count = 0;
+    op++;
+    op->op = GRPC_OP_SEND_CLOSE_FROM_CLIENT;
+    op++;
+    op->op = GRPC_OP_RECV_INITIAL_METADATA;
+    op->data.recv_initial_metadata = &initial_metadata_recv[i];
+    op++;
+    op->op = GRPC_OP_RECV_STATUS_ON_CLIENT;
+    op->data.recv_status_on_client.trailing_metadata =
+        &trailing_metadata_recv[i];
+    op->data.recv_status_on_client.status = &status[i];
+    op->data.recv_status_on_client.status_details = &details[i];
+    op->data.recv_status_on_client.status_details_capacity =
+        &details_capacity[i];
+    op++;
+    GPR_ASSERT(GRPC_CALL_OK ==
+               grpc_call_start_batch(client_calls[i], ops,
+                                     (size_t)(op - ops), tag(1 + (int)i),
+                                     NULL));
+    GPR_ASSERT(GRPC_CALL_OK ==
+               grpc_server_request_call(f->server, &server_calls[i],
+                                        &call_details[i], &request_metadata[i],
+                                        f->cq, f->cq, tag(100 + (int)i)));
+    cq_expect_completion(cqv, tag(100 + (int)i), 1);
+  }
+  cq_verify(cqv);
+
+  memset(ops, 0, sizeof(ops));
+  for (i = 0; i < num_calls; i++) {
+    record_peer(f, grpc_call_get_peer(server_calls[i]));
+    op = ops;
+    op->op = GRPC_OP_SEND_INITIAL_METADATA;
+    op->data.send_initial_metadata.count = 0;
+    op++;
+    op->op = GRPC_OP_SEND_STATUS_FROM_SERVER;
+    op->data.send_status_from_server.trailing_metadata_count = 0;
+    op->data.send_status_from_server.status = GRPC_STATUS_OK;
+    op->data.send_status_from_server.status_details = "xyz";
+    op++;
+    op->op = GRPC_OP_RECV_CLOSE_ON_SERVER;
+    op->data.recv_close_on_server.cancelled = &was_cancelled[i];
+    op++;
+    GPR_ASSERT(GRPC_CALL_OK ==
+               grpc_call_start_batch(server_calls[i], ops, (size_t)(op - ops),
+                                     tag(200 + (int)i), NULL));
+    cq_expect_completion(cqv, tag(200 + (int)i), 1);
+    cq_expect_completion(cqv, tag(1 + (int)i), 1);
+  }
+  cq_verify(cqv);
+
+  for (i = 0; i < num_calls; i++) {
+    GPR_ASSERT(status[i] == GRPC_STATUS_OK);
+    grpc_call_destroy(client_calls[i]);
+    grpc_call_destroy(server_calls[i]);
+    grpc_metadata_array_destroy(&initial_metadata_recv[i]);
+    grpc_metadata_array_destroy(&trailing_metadata_recv[i]);
+    grpc_metadata_array_destroy(&request_metadata[i]);
+    grpc_call_details_destroy(&call_details[i]);
+    gpr_free(details[i]);
+  }
+  cq_verifier_destroy(cqv);
+}
+
+/* Keeps num_calls calls in flight per round until the server has seen
+   expected_peers connections, and checks it never sees more. */
+static void test_pool(int max_connections, int streams_per_connection,
+                      size_t num_calls, size_t expected_peers) {
+  fixture f;
+  int round;
+  gpr_log(GPR_INFO,
+          "test_pool: max_connections=%d streams_per_connection=%d "
+          "num_calls=%d",
+          max_connections, streams_per_connection, (int)num_calls);
+  setup(&f, max_connections, streams_per_connection);
+  for (round = 0; round < MAX_ROUNDS; round++) {
+    run_round(&f, num_calls);
+    if (f.num_peers >= expected_peers) break;
+  }
+  /* a few more rounds must not open anything beyond the limit */
+  run_round(&f, num_calls);
+  run_round(&f, num_calls);
+  gpr_log(GPR_INFO, "saw %d connections after %d rounds", (int)f.num_peers,
+          round + 3);
+  GPR_ASSERT(f.num_peers == expected_peers);
+  teardown(&f);
+}
+
+int main(int argc, char **argv) {
+  grpc_test_init(argc, argv);
+  grpc_init();
+
+  /* default: a single connection no matter how busy */
+  test_pool(1, 1, 8, 1);
+  /* calls spread out once every connection is busy */
+  test_pool(4, 1, 8, 4);
+  /* eager pool */
+  test_pool(3, 0, 3, 3);
+  /* never saturated: stays on one connection */
+  test_pool(4, 100, 8, 1);
+
+  grpc_shutdown();
+  return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Measures compression and decompression throughput and compression ratio of
+   every message compression algorithm. Payloads are either COMPRESSABLE ones
+   as the test services fill them (all zero bytes, see messages.proto and
+   qpstest.proto) or text, which is closer to what real messages hold. Each
+   message is decompressed again and checked against the original. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <grpc/compression.h>
+#include <grpc/support/alloc.h>
+#include <grpc/support/cmdline.h>
+#include <grpc/support/log.h>
+#include <grpc/support/time.h>
+#include <grpc/support/useful.h>
+
+#include "src/core/compression/message_compress.h"
+#include "test/core/util/test_config.h"
+
+/* Words the text payload is made of. */
+static const char *words[] = {
+    "the",     "of",        "message", "request", "response", "stream",
+    "channel", "call",      "status",  "deadline", "metadata", "server",
+    "client",  "user_id",   "2015",    "payload",  "error",    "timeout",
+    "name",    "resources", "{",       "}",        ":",        "\"",
+    "id",      "12345678",  "true",    "false",    "null",     "value"};
+
+static gpr_slice make_payload(int text, size_t length) {
+  gpr_slice slice = gpr_slice_malloc(length);
+  gpr_uint8 *p = GPR_SLICE_START_PTR(slice);
+  gpr_uint32 state = 1;
+  size_t i = 0;
+
+  if (!text) {
+    memset(p, 0, length);
+    return slice;
+  }
+  while (i < length) {
+    const char *word;
+    size_t n;
+    state = state * 1103515245 + 12345;
+    word = words[(state >> 16) % GPR_ARRAY_SIZE(words)];
+    n = strlen(word);
+    for (; n > 0 && i < length; n--) p[i++] = (gpr_uint8)*word++;
+    if (i < length) p[i++] = ' ';
+  }
+  return slice;
+}
+
+static double seconds_since(gpr_timespec start) {
+  return gpr_timespec_to_micros(
+             gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), start)) /
+         1e6;
+}
+
+static void run(grpc_compression_algorithm algorithm, const char *payload_name,
+                gpr_slice payload, size_t num_messages) {
+  gpr_slice_buffer input;
+  gpr_slice_buffer compressed;
+  gpr_slice_buffer output;
+  char *name;
+  size_t compressed_bytes = 0;
+  double compress_seconds = 0;
+  double decompress_seconds = 0;
+  double megabytes =
+      (double)GPR_SLICE_LENGTH(payload) * (double)num_messages / 1e6;
+  size_t i;
+  size_t j;
+
+  GPR_ASSERT(grpc_compression_algorithm_name(algorithm, &name));
+  gpr_slice_buffer_init(&input);
+  gpr_slice_buffer_init(&compressed);
+  gpr_slice_buffer_init(&output);
+  gpr_slice_buffer_add(&input, gpr_slice_ref(payload));
+  for (i = 0; i < num_messages; i++) {
+    gpr_timespec start = gpr_now(GPR_CLOCK_MONOTONIC);
+    int did_compress = grpc_msg_compress(algorithm, &input, &compressed);
+    compress_seconds += seconds_since(start);
+    compressed_bytes += compressed.length;
+
+    start = gpr_now(GPR_CLOCK_MONOTONIC);
+    GPR_ASSERT(grpc_msg_decompress(
+        did_compress ? algorithm : GRPC_COMPRESS_NONE, &compressed, &output));
+    decompress_seconds += seconds_since(start);
+
+    GPR_ASSERT(output.length == GPR_SLICE_LENGTH(payload));
+    {
+      size_t offset = 0;
+      for (j = 0; j < output.count; j++) {
+        GPR_ASSERT(0 == memcmp(GPR_SLICE_START_PTR(payload) + offset,
+                               GPR_SLICE_START_PTR(output.slices[j]),
+                               GPR_SLICE_LENGTH(output.slices[j])));
+        offset += GPR_SLICE_LENGTH(output.slices[j]);
+      }
+    }
+    gpr_slice_buffer_reset_and_unref(&compressed);
+    gpr_slice_buffer_reset_and_unref(&output);
+  }
+  printf("%-8s %-12s %8.1f MB/s compress %8.1f MB/s decompress %8.2f ratio\n",
+         name, payload_name, megabytes / compress_seconds,
+         megabytes / decompress_seconds,
+         (double)GPR_SLICE_LENGTH(payload) * (double)num_messages /
+             (double)compressed_bytes);
+  gpr_slice_buffer_destroy(&input);
+  gpr_slice_buffer_destroy(&compressed);
+  gpr_slice_buffer_destroy(&output);
+}
+
+int main(int argc, char **argv) {
+  int message_size = 64 * 1024;
+  int megabytes = 64;
+  gpr_cmdline *cl;
+  gpr_slice payloads[2];
+  static const char *payload_names[] = {"compressable", "text"};
+  size_t num_messages;
+  int i;
+  int algorithm;
+
+  grpc_test_init(argc, argv);
+  cl = gpr_cmdline_create("message compression benchmark");
+  gpr_cmdline_add_int(cl, "message_size", "Size of each message in bytes",
+                      &message_size);
+  gpr_cmdline_add_int(cl, "megabytes", "Payload compressed for each run",
+                      &megabytes);
+  gpr_cmdline_parse(cl, argc, argv);
+  gpr_cmdline_destroy(cl);
+  GPR_ASSERT(message_size > 0 && megabytes > 0);
+
+  num_messages = (size_t)megabytes * 1000000 / (size_t)message_size;
+  if (num_messages == 0) num_messages = 1;
+  for (i = 0; i < 2; i++) {
+    payloads[i] = make_payload(i, (size_t)message_size);
+  }
+  for (i = 0; i < 2; i++) {
+    for (algorithm = GRPC_COMPRESS_NONE + 1;
+         algorithm < GRPC_COMPRESS_ALGORITHMS_COUNT; algorithm++) {
+      run((grpc_compression_algorithm)algorithm, payload_names[i], payloads[i],
+          num_messages);
+    }
+  }
+  for (i = 0; i < 2; i++) {
+    gpr_slice_unref(payloads[i]);
+  }
+  return 0;
+}
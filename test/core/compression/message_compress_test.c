@@ -42,7 +42,13 @@
 #include <grpc/support/useful.h>
 #include "test/core/util/slice_splitter.h"
 
-typedef enum { ONE_A = 0, ONE_KB_A, ONE_MB_A, TEST_VALUE_COUNT } test_value;
+typedef enum {
+  ONE_A = 0,
+  ONE_KB_A,
+  ONE_MB_A,
+  MIXED_200KB,
+  TEST_VALUE_COUNT
+} test_value;
 
 typedef enum {
   SHOULD_NOT_COMPRESS,
@@ -115,6 +121,25 @@ static gpr_slice repeated(char c, size_t length) {
   return out;
 }
 
+/* Runs of text with varying repeat distances, interleaved with stretches of
+   pseudo-random bytes, crossing several 64KB boundaries. */
+static gpr_slice mixed(size_t length) {
+  static const char text[] = "the quick brown fox jumps over the lazy dog ";
+  gpr_slice out = gpr_slice_malloc(length);
+  gpr_uint8 *p = GPR_SLICE_START_PTR(out);
+  gpr_uint32 state = 12345;
+  size_t i;
+  for (i = 0; i < length; i++) {
+    state = state * 1103515245 + 12345;
+    if ((i / 4096) % 3 == 2) {
+      p[i] = (gpr_uint8)(state >> 16);
+    } else {
+      p[i] = (gpr_uint8)text[(i + i / 997) % (sizeof(text) - 1)];
+    }
+  }
+  return out;
+}
+
 static compressability get_compressability(
     test_value id, grpc_compression_algorithm algorithm) {
   if (algorithm == GRPC_COMPRESS_NONE) return SHOULD_NOT_COMPRESS;
@@ -123,6 +148,7 @@ static compressability get_compressability(
       return SHOULD_NOT_COMPRESS;
     case ONE_KB_A:
     case ONE_MB_A:
+    case MIXED_200KB:
       return SHOULD_COMPRESS;
     case TEST_VALUE_COUNT:
       abort();
@@ -139,6 +165,8 @@ static gpr_slice create_test_value(test_value id) {
       return repeated('a', 1024);
     case ONE_MB_A:
       return repeated('a', 1024 * 1024);
+    case MIXED_200KB:
+      return mixed(200 * 1024);
     case TEST_VALUE_COUNT:
       abort();
       break;
@@ -166,6 +194,151 @@ static void test_bad_data(void) {
   gpr_slice_buffer_destroy(&output);
 }
 
+/* "gRPC gRPC gRPC gRPC gRPC gRPC, lz4 lz4 lz4 lz4 lz4 lz4 lz4!\n" as the
+   reference lz4 tool (v1.9.4) writes it with "lz4 -BX --content-size": the
+   content size, one compressed block with its checksum, the end mark and the
+   content checksum. */
+#define LZ4_REFERENCE_TEXT \
+  "gRPC gRPC gRPC gRPC gRPC gRPC, lz4 lz4 lz4 lz4 lz4 lz4 lz4!\n"
+static const gpr_uint8 lz4_reference_frame[] = {
+    0x04, 0x22, 0x4d, 0x18, 0x7c, 0x40, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x97, 0x18, 0x00, 0x00, 0x00, 0x5f, 0x67, 0x52, 0x50, 0x43,
+    0x20, 0x05, 0x00, 0x05, 0x5f, 0x2c, 0x20, 0x6c, 0x7a, 0x34, 0x04, 0x00,
+    0x02, 0x50, 0x6c, 0x7a, 0x34, 0x21, 0x0a, 0xd9, 0xd7, 0xb0, 0xd5, 0x00,
+    0x00, 0x00, 0x00, 0x7a, 0xf3, 0x31, 0x3a
+};
+/* Where things are in lz4_reference_frame */
+#define LZ4_CONTENT_SIZE_OFFSET 6
+#define LZ4_HEADER_CHECKSUM_OFFSET 14
+#define LZ4_BLOCK_SIZE_OFFSET 15
+#define LZ4_BLOCK_OFFSET 19
+
+/* Header of a frame with 64KB independent blocks and no checksums or content
+   size, so that the blocks that follow are all there is to get wrong */
+static const gpr_uint8 lz4_plain_header[] = {0x04, 0x22, 0x4d, 0x18,
+                                             0x60, 0x40, 0x82};
+
+/* Decompresses the LZ4 frame in 'frame' and returns whether it was accepted,
+   checking that accepted frames decode to 'expected' and that rejected ones
+   leave nothing behind */
+static int lz4_accepts(const gpr_uint8 *frame, size_t length,
+                       const char *expected) {
+  gpr_slice_buffer input;
+  gpr_slice_buffer output;
+  int accepted;
+
+  gpr_slice_buffer_init(&input);
+  gpr_slice_buffer_init(&output);
+  gpr_slice_buffer_add(
+      &input, gpr_slice_from_copied_buffer((const char *)frame, length));
+  accepted = grpc_msg_decompress(GRPC_COMPRESS_LZ4, &input, &output);
+  if (accepted) {
+    gpr_slice decompressed = grpc_slice_merge(output.slices, output.count);
+    GPR_ASSERT(0 == gpr_slice_str_cmp(decompressed, expected));
+    gpr_slice_unref(decompressed);
+  } else {
+    GPR_ASSERT(0 == output.count);
+  }
+  gpr_slice_buffer_destroy(&input);
+  gpr_slice_buffer_destroy(&output);
+  return accepted;
+}
+
+/* Wraps the single LZ4 'block' in a frame with lz4_plain_header and returns
+   whether it was accepted */
+static int lz4_accepts_block(const gpr_uint8 *block, size_t length,
+                             const char *expected) {
+  gpr_uint8 frame[64];
+  size_t n = sizeof(lz4_plain_header);
+
+  GPR_ASSERT(n + 4 + length + 4 <= sizeof(frame));
+  memcpy(frame, lz4_plain_header, n);
+  frame[n++] = (gpr_uint8)length;
+  frame[n++] = 0;
+  frame[n++] = 0;
+  frame[n++] = 0;
+  memcpy(frame + n, block, length);
+  n += length;
+  memset(frame + n, 0, 4);
+  n += 4;
+  return lz4_accepts(frame, n, expected);
+}
+
+static void test_lz4_reference_frame(void) {
+  gpr_uint8 frame[sizeof(lz4_reference_frame)];
+
+  GPR_ASSERT(lz4_accepts(lz4_reference_frame, sizeof(lz4_reference_frame),
+                         LZ4_REFERENCE_TEXT));
+
+  /* bad header checksum */
+  memcpy(frame, lz4_reference_frame, sizeof(frame));
+  frame[LZ4_HEADER_CHECKSUM_OFFSET] ^= 1;
+  GPR_ASSERT(!lz4_accepts(frame, sizeof(frame), NULL));
+
+  /* block longer than what is left of the frame */
+  memcpy(frame, lz4_reference_frame, sizeof(frame));
+  frame[LZ4_BLOCK_SIZE_OFFSET] =
+      (gpr_uint8)(sizeof(frame) - LZ4_BLOCK_OFFSET + 1);
+  GPR_ASSERT(!lz4_accepts(frame, sizeof(frame), NULL));
+
+  /* bad block checksum */
+  memcpy(frame, lz4_reference_frame, sizeof(frame));
+  frame[LZ4_BLOCK_OFFSET + 1] ^= 1;
+  GPR_ASSERT(!lz4_accepts(frame, sizeof(frame), NULL));
+
+  /* bad content checksum */
+  memcpy(frame, lz4_reference_frame, sizeof(frame));
+  frame[sizeof(frame) - 1] ^= 1;
+  GPR_ASSERT(!lz4_accepts(frame, sizeof(frame), NULL));
+
+  /* content size one short of and one past the real one, with the header
+     checksum fixed up to match */
+  memcpy(frame, lz4_reference_frame, sizeof(frame));
+  frame[LZ4_CONTENT_SIZE_OFFSET] = sizeof(LZ4_REFERENCE_TEXT) - 2;
+  frame[LZ4_HEADER_CHECKSUM_OFFSET] = 0xda;
+  GPR_ASSERT(!lz4_accepts(frame, sizeof(frame), NULL));
+  frame[LZ4_CONTENT_SIZE_OFFSET] = sizeof(LZ4_REFERENCE_TEXT);
+  frame[LZ4_HEADER_CHECKSUM_OFFSET] = 0xe1;
+  GPR_ASSERT(!lz4_accepts(frame, sizeof(frame), NULL));
+
+  /* truncated anywhere */
+  GPR_ASSERT(!lz4_accepts(lz4_reference_frame, LZ4_BLOCK_OFFSET + 8, NULL));
+  GPR_ASSERT(
+      !lz4_accepts(lz4_reference_frame, sizeof(lz4_reference_frame) - 1, NULL));
+}
+
+static void test_lz4_malformed_blocks(void) {
+  /* "abcd", a match of 4 at offset 4, then "efghi" */
+  static const gpr_uint8 good[] = {0x40, 'a', 'b', 'c', 'd', 0x04, 0x00,
+                                   0x50, 'e', 'f', 'g', 'h', 'i'};
+  static const gpr_uint8 zero_offset[] = {0x40, 'a', 'b', 'c', 'd', 0x00,
+                                          0x00, 0x50, 'e', 'f', 'g', 'h',
+                                          'i'};
+  static const gpr_uint8 offset_before_start[] = {
+      0x40, 'a', 'b', 'c', 'd', 0x05, 0x00, 0x50, 'e', 'f', 'g', 'h', 'i'};
+  /* as good, but the match length of 15 + 0 + 4 takes a continuation byte */
+  static const gpr_uint8 long_match[] = {0x4f, 'a', 'b', 'c', 'd', 0x04, 0x00,
+                                         0x00, 0x50, 'e', 'f', 'g', 'h', 'i'};
+  static const gpr_uint8 truncated_match_length[] = {0x4f, 'a',  'b', 'c',
+                                                     'd',  0x04, 0x00};
+  static const gpr_uint8 truncated_literal_length[] = {0xf0, 0xff};
+  static const gpr_uint8 literals_past_block[] = {0x50, 'a', 'b'};
+
+  GPR_ASSERT(lz4_accepts_block(good, sizeof(good), "abcdabcdefghi"));
+  GPR_ASSERT(!lz4_accepts_block(zero_offset, sizeof(zero_offset), NULL));
+  GPR_ASSERT(!lz4_accepts_block(offset_before_start,
+                                sizeof(offset_before_start), NULL));
+  GPR_ASSERT(lz4_accepts_block(long_match, sizeof(long_match),
+                               "abcdabcdabcdabcdabcdabcefghi"));
+  GPR_ASSERT(!lz4_accepts_block(truncated_match_length,
+                                sizeof(truncated_match_length), NULL));
+  GPR_ASSERT(!lz4_accepts_block(truncated_literal_length,
+                                sizeof(truncated_literal_length), NULL));
+  GPR_ASSERT(
+      !lz4_accepts_block(literals_past_block, sizeof(literals_past_block),
+                         NULL));
+}
+
 int main(int argc, char **argv) {
   unsigned i, j, k, m;
   grpc_slice_split_mode uncompressed_split_modes[] = {
@@ -189,6 +362,8 @@ int main(int argc, char **argv) {
   }
 
   test_bad_data();
+  test_lz4_reference_frame();
+  test_lz4_malformed_blocks();
 
   return 0;
 }
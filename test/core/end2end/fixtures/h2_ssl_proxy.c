@@ -79,7 +79,7 @@ static grpc_channel *create_proxy_client(const char *target) {
 }
 
 static const grpc_end2end_proxy_def proxy_def = {create_proxy_server,
-                                                 create_proxy_client};
+                                                 create_proxy_client, 0};
 
 static grpc_end2end_test_fixture chttp2_create_fixture_secure_fullstack(
     grpc_channel_args *client_args, grpc_channel_args *server_args) {
@@ -36,6 +36,7 @@
 #include <string.h>
 
 #include <grpc/support/alloc.h>
+#include <grpc/support/cpu.h>
 #include <grpc/support/host_port.h>
 #include <grpc/support/log.h>
 #include <grpc/support/sync.h>
@@ -44,20 +45,28 @@
 
 #include "test/core/util/port.h"
 
-struct grpc_end2end_proxy {
+typedef struct proxy_worker {
+  grpc_end2end_proxy *proxy;
   gpr_thd_id thd;
-  char *proxy_port;
-  char *server_port;
   grpc_completion_queue *cq;
-  grpc_server *server;
-  grpc_channel *client;
 
+  /* only touched by this worker's thread */
   int shutdown;
 
   /* requested call */
   grpc_call *new_call;
   grpc_call_details new_call_details;
   grpc_metadata_array new_call_metadata;
+} proxy_worker;
+
+struct grpc_end2end_proxy {
+  char *proxy_port;
+  char *server_port;
+  grpc_server *server;
+  grpc_channel *client;
+
+  size_t num_workers;
+  proxy_worker *workers;
 };
 
 typedef struct {
@@ -65,9 +74,38 @@ typedef struct {
   void *arg;
 } closure;
 
+typedef struct proxy_call proxy_call;
+
+/* Forwards messages in one direction, from src to dst. At most one message
+   is being sent on dst at a time; while it is, the next message may be
+   received from src, but no further reads are started until the send
+   completes. */
 typedef struct {
+  proxy_call *pc;
+  grpc_call *src;
+  grpc_call *dst;
+  /* target of the outstanding receive */
+  grpc_byte_buffer *recv_msg;
+  /* message being sent */
+  grpc_byte_buffer *send_msg;
+  /* message received while a send was in progress */
+  grpc_byte_buffer *next_msg;
+  int recving;
+  int sending;
+  /* src will produce no more messages */
+  int src_done;
+  /* src ended cleanly (rather than failing) */
+  int src_ok;
+  /* a send to dst failed: drop anything else from src */
+  int dst_failed;
+  int finished;
+  /* called once all messages have been forwarded (or dropped) */
+  void (*on_finished)(proxy_call *pc);
+} proxy_pipe;
+
+struct proxy_call {
   gpr_refcount refs;
-  grpc_end2end_proxy *proxy;
+  proxy_worker *worker;
 
   grpc_call *c2p;
   grpc_call *p2s;
@@ -75,25 +113,27 @@ typedef struct {
   grpc_metadata_array c2p_initial_metadata;
   grpc_metadata_array p2s_initial_metadata;
 
-  grpc_byte_buffer *c2p_msg;
-  grpc_byte_buffer *p2s_msg;
+  proxy_pipe c2s;
+  proxy_pipe s2c;
 
   grpc_metadata_array p2s_trailing_metadata;
   grpc_status_code p2s_status;
   char *p2s_status_details;
   size_t p2s_status_details_capacity;
+  int p2s_status_received;
 
   int c2p_server_cancelled;
-} proxy_call;
+};
 
 static void thread_main(void *arg);
-static void request_call(grpc_end2end_proxy *proxy);
+static void request_call(proxy_worker *worker);
 
 grpc_end2end_proxy *grpc_end2end_proxy_create(
     const grpc_end2end_proxy_def *def) {
   gpr_thd_options opt = gpr_thd_options_default();
   int proxy_port = grpc_pick_unused_port_or_die();
   int server_port = grpc_pick_unused_port_or_die();
+  size_t i;
 
   grpc_end2end_proxy *proxy = gpr_malloc(sizeof(*proxy));
   memset(proxy, 0, sizeof(*proxy));
@@ -104,17 +144,28 @@ grpc_end2end_proxy *grpc_end2end_proxy_create(
   gpr_log(GPR_DEBUG, "PROXY ADDR:%s BACKEND:%s", proxy->proxy_port,
           proxy->server_port);
 
-  proxy->cq = grpc_completion_queue_create(NULL);
+  proxy->num_workers =
+      def->num_threads > 0 ? (size_t)def->num_threads : gpr_cpu_num_cores();
+  proxy->workers = gpr_malloc(sizeof(proxy_worker) * proxy->num_workers);
+  memset(proxy->workers, 0, sizeof(proxy_worker) * proxy->num_workers);
+
   proxy->server = def->create_server(proxy->proxy_port);
   proxy->client = def->create_client(proxy->server_port);
 
-  grpc_server_register_completion_queue(proxy->server, proxy->cq, NULL);
+  for (i = 0; i < proxy->num_workers; i++) {
+    proxy->workers[i].proxy = proxy;
+    proxy->workers[i].cq = grpc_completion_queue_create(NULL);
+    grpc_server_register_completion_queue(proxy->server, proxy->workers[i].cq,
+                                          NULL);
+  }
   grpc_server_start(proxy->server);
 
   gpr_thd_options_set_joinable(&opt);
-  GPR_ASSERT(gpr_thd_new(&proxy->thd, thread_main, proxy, &opt));
-
-  request_call(proxy);
+  for (i = 0; i < proxy->num_workers; i++) {
+    GPR_ASSERT(gpr_thd_new(&proxy->workers[i].thd, thread_main,
+                           &proxy->workers[i], &opt));
+    request_call(&proxy->workers[i]);
+  }
 
   return proxy;
 }
@@ -126,22 +177,33 @@ static closure *new_closure(void (*func)(void *arg, int success), void *arg) {
   return cl;
 }
 
+/* Runs on each worker's own thread, so no further batches are started on
+   its completion queue after this */
 static void shutdown_complete(void *arg, int success) {
-  grpc_end2end_proxy *proxy = arg;
-  proxy->shutdown = 1;
-  grpc_completion_queue_shutdown(proxy->cq);
+  proxy_worker *worker = arg;
+  worker->shutdown = 1;
+  grpc_completion_queue_shutdown(worker->cq);
 }
 
 void grpc_end2end_proxy_destroy(grpc_end2end_proxy *proxy) {
-  grpc_server_shutdown_and_notify(proxy->server, proxy->cq,
-                                  new_closure(shutdown_complete, proxy));
-  gpr_thd_join(proxy->thd);
+  size_t i;
+  for (i = 0; i < proxy->num_workers; i++) {
+    grpc_server_shutdown_and_notify(
+        proxy->server, proxy->workers[i].cq,
+        new_closure(shutdown_complete, &proxy->workers[i]));
+  }
+  for (i = 0; i < proxy->num_workers; i++) {
+    gpr_thd_join(proxy->workers[i].thd);
+  }
   gpr_free(proxy->proxy_port);
   gpr_free(proxy->server_port);
   grpc_server_destroy(proxy->server);
   grpc_channel_destroy(proxy->client);
-  grpc_completion_queue_destroy(proxy->cq);
-  grpc_call_details_destroy(&proxy->new_call_details);
+  for (i = 0; i < proxy->num_workers; i++) {
+    grpc_completion_queue_destroy(proxy->workers[i].cq);
+    grpc_call_details_destroy(&proxy->workers[i].new_call_details);
+  }
+  gpr_free(proxy->workers);
   gpr_free(proxy);
 }
 
@@ -159,157 +221,183 @@ static void unrefpc(proxy_call *pc, const char *reason) {
 
 static void refpc(proxy_call *pc, const char *reason) { gpr_ref(&pc->refs); }
 
-static void on_c2p_sent_initial_metadata(void *arg, int success) {
-  proxy_call *pc = arg;
-  unrefpc(pc, "on_c2p_sent_initial_metadata");
+static void start_op(proxy_call *pc, grpc_call *call, grpc_op *op,
+                     void (*func)(void *arg, int success), void *arg,
+                     const char *reason) {
+  grpc_call_error err;
+  op->flags = 0;
+  op->reserved = NULL;
+  refpc(pc, reason);
+  err = grpc_call_start_batch(call, op, 1, new_closure(func, arg), NULL);
+  GPR_ASSERT(err == GRPC_CALL_OK);
 }
 
-static void on_p2s_recv_initial_metadata(void *arg, int success) {
-  proxy_call *pc = arg;
-  grpc_op op;
-  grpc_call_error err;
+static void on_pipe_recv(void *arg, int success);
+static void on_pipe_sent(void *arg, int success);
 
-  if (!pc->proxy->shutdown) {
-    op.op = GRPC_OP_SEND_INITIAL_METADATA;
-    op.flags = 0;
-    op.reserved = NULL;
-    op.data.send_initial_metadata.count = pc->p2s_initial_metadata.count;
-    op.data.send_initial_metadata.metadata = pc->p2s_initial_metadata.metadata;
-    refpc(pc, "on_c2p_sent_initial_metadata");
-    err = grpc_call_start_batch(
-        pc->c2p, &op, 1, new_closure(on_c2p_sent_initial_metadata, pc), NULL);
-    GPR_ASSERT(err == GRPC_CALL_OK);
-  }
+static void pipe_start_recv(proxy_pipe *p) {
+  grpc_op op;
+  op.op = GRPC_OP_RECV_MESSAGE;
+  op.data.recv_message = &p->recv_msg;
+  p->recving = 1;
+  start_op(p->pc, p->src, &op, on_pipe_recv, p, "on_pipe_recv");
+}
 
-  unrefpc(pc, "on_p2s_recv_initial_metadata");
+static void pipe_start_send(proxy_pipe *p, grpc_byte_buffer *msg) {
+  grpc_op op;
+  op.op = GRPC_OP_SEND_MESSAGE;
+  op.data.send_message = msg;
+  p->send_msg = msg;
+  p->sending = 1;
+  start_op(p->pc, p->dst, &op, on_pipe_sent, p, "on_pipe_sent");
 }
 
-static void on_p2s_sent_initial_metadata(void *arg, int success) {
-  proxy_call *pc = arg;
-  unrefpc(pc, "on_p2s_sent_initial_metadata");
+static void pipe_maybe_finish(proxy_pipe *p) {
+  if (p->src_done && !p->recving && !p->sending && p->next_msg == NULL &&
+      !p->finished) {
+    p->finished = 1;
+    p->on_finished(p->pc);
+  }
 }
 
-static void on_c2p_recv_msg(void *arg, int success);
+static void on_pipe_recv(void *arg, int success) {
+  proxy_pipe *p = arg;
+  proxy_call *pc = p->pc;
+  grpc_byte_buffer *msg = p->recv_msg;
+
+  p->recving = 0;
+  p->recv_msg = NULL;
+  if (pc->worker->shutdown || !success || msg == NULL || p->dst_failed) {
+    p->src_done = 1;
+    p->src_ok = success && msg == NULL;
+    if (msg != NULL) grpc_byte_buffer_destroy(msg);
+  } else if (!p->sending) {
+    /* the byte buffer is handed over as is: its slices are referenced, not
+       copied, by the send */
+    pipe_start_send(p, msg);
+    pipe_start_recv(p);
+  } else {
+    /* dst is busy: hold this message, and stop reading until it drains */
+    p->next_msg = msg;
+  }
+  pipe_maybe_finish(p);
 
-static void on_p2s_sent_message(void *arg, int success) {
-  proxy_call *pc = arg;
-  grpc_op op;
-  grpc_call_error err;
+  unrefpc(pc, "on_pipe_recv");
+}
 
-  grpc_byte_buffer_destroy(pc->c2p_msg);
-  if (!pc->proxy->shutdown && success) {
-    op.op = GRPC_OP_RECV_MESSAGE;
-    op.flags = 0;
-    op.reserved = NULL;
-    op.data.recv_message = &pc->c2p_msg;
-    refpc(pc, "on_c2p_recv_msg");
-    err = grpc_call_start_batch(pc->c2p, &op, 1,
-                                new_closure(on_c2p_recv_msg, pc), NULL);
-    GPR_ASSERT(err == GRPC_CALL_OK);
+static void on_pipe_sent(void *arg, int success) {
+  proxy_pipe *p = arg;
+  proxy_call *pc = p->pc;
+  grpc_byte_buffer *next = p->next_msg;
+
+  grpc_byte_buffer_destroy(p->send_msg);
+  p->send_msg = NULL;
+  p->sending = 0;
+  p->next_msg = NULL;
+  if (pc->worker->shutdown || !success) {
+    p->dst_failed = 1;
+    if (next != NULL) {
+      grpc_byte_buffer_destroy(next);
+      /* the receive that produced it completed: src may have more */
+      p->src_done = 1;
+      p->src_ok = 0;
+    }
+  } else if (next != NULL) {
+    pipe_start_send(p, next);
+    pipe_start_recv(p);
   }
+  pipe_maybe_finish(p);
 
-  unrefpc(pc, "on_p2s_sent_message");
+  unrefpc(pc, "on_pipe_sent");
 }
 
-static void on_p2s_sent_close(void *arg, int success) {
+static void pipe_init(proxy_pipe *p, proxy_call *pc, grpc_call *src,
+                      grpc_call *dst, void (*on_finished)(proxy_call *pc)) {
+  p->pc = pc;
+  p->src = src;
+  p->dst = dst;
+  p->on_finished = on_finished;
+}
+
+static void on_c2p_sent_initial_metadata(void *arg, int success) {
   proxy_call *pc = arg;
-  unrefpc(pc, "on_p2s_sent_close");
+  unrefpc(pc, "on_c2p_sent_initial_metadata");
 }
 
-static void on_c2p_recv_msg(void *arg, int success) {
+static void on_c2p_sent_status(void *arg, int success) {
   proxy_call *pc = arg;
+  unrefpc(pc, "on_c2p_sent_status");
+}
+
+/* The status must follow every message forwarded to the client, so it is
+   sent once both the backend's status has arrived and the s2c pipe has
+   drained. */
+static void maybe_send_status(proxy_call *pc) {
   grpc_op op;
-  grpc_call_error err;
 
-  if (!pc->proxy->shutdown && success) {
-    if (pc->c2p_msg != NULL) {
-      op.op = GRPC_OP_SEND_MESSAGE;
-      op.flags = 0;
-      op.reserved = NULL;
-      op.data.send_message = pc->c2p_msg;
-      refpc(pc, "on_p2s_sent_message");
-      err = grpc_call_start_batch(pc->p2s, &op, 1,
-                                  new_closure(on_p2s_sent_message, pc), NULL);
-      GPR_ASSERT(err == GRPC_CALL_OK);
-    } else {
-      op.op = GRPC_OP_SEND_CLOSE_FROM_CLIENT;
-      op.flags = 0;
-      op.reserved = NULL;
-      refpc(pc, "on_p2s_sent_close");
-      err = grpc_call_start_batch(pc->p2s, &op, 1,
-                                  new_closure(on_p2s_sent_close, pc), NULL);
-      GPR_ASSERT(err == GRPC_CALL_OK);
-    }
+  if (pc->worker->shutdown || !pc->p2s_status_received ||
+      !pc->s2c.finished) {
+    return;
   }
-
-  unrefpc(pc, "on_c2p_recv_msg");
+  op.op = GRPC_OP_SEND_STATUS_FROM_SERVER;
+  op.data.send_status_from_server.trailing_metadata_count =
+      pc->p2s_trailing_metadata.count;
+  op.data.send_status_from_server.trailing_metadata =
+      pc->p2s_trailing_metadata.metadata;
+  op.data.send_status_from_server.status = pc->p2s_status;
+  op.data.send_status_from_server.status_details = pc->p2s_status_details;
+  start_op(pc, pc->c2p, &op, on_c2p_sent_status, pc, "on_c2p_sent_status");
 }
 
-static void on_p2s_recv_msg(void *arg, int success);
+static void on_s2c_finished(proxy_call *pc) { maybe_send_status(pc); }
 
-static void on_c2p_sent_message(void *arg, int success) {
+static void on_p2s_sent_close(void *arg, int success) {
   proxy_call *pc = arg;
+  unrefpc(pc, "on_p2s_sent_close");
+}
+
+static void on_c2s_finished(proxy_call *pc) {
   grpc_op op;
-  grpc_call_error err;
 
-  grpc_byte_buffer_destroy(pc->p2s_msg);
-  if (!pc->proxy->shutdown && success) {
-    op.op = GRPC_OP_RECV_MESSAGE;
-    op.flags = 0;
-    op.reserved = NULL;
-    op.data.recv_message = &pc->p2s_msg;
-    refpc(pc, "on_p2s_recv_msg");
-    err = grpc_call_start_batch(pc->p2s, &op, 1,
-                                new_closure(on_p2s_recv_msg, pc), NULL);
-    GPR_ASSERT(err == GRPC_CALL_OK);
+  if (!pc->worker->shutdown && pc->c2s.src_ok) {
+    op.op = GRPC_OP_SEND_CLOSE_FROM_CLIENT;
+    start_op(pc, pc->p2s, &op, on_p2s_sent_close, pc, "on_p2s_sent_close");
   }
-
-  unrefpc(pc, "on_c2p_sent_message");
 }
 
-static void on_p2s_recv_msg(void *arg, int success) {
+static void on_p2s_recv_initial_metadata(void *arg, int success) {
   proxy_call *pc = arg;
   grpc_op op;
-  grpc_call_error err;
 
-  if (!pc->proxy->shutdown && success && pc->p2s_msg) {
-    op.op = GRPC_OP_SEND_MESSAGE;
-    op.flags = 0;
-    op.reserved = NULL;
-    op.data.send_message = pc->p2s_msg;
-    refpc(pc, "on_c2p_sent_message");
-    err = grpc_call_start_batch(pc->c2p, &op, 1,
-                                new_closure(on_c2p_sent_message, pc), NULL);
-    GPR_ASSERT(err == GRPC_CALL_OK);
+  if (!pc->worker->shutdown) {
+    op.op = GRPC_OP_SEND_INITIAL_METADATA;
+    op.data.send_initial_metadata.count = pc->p2s_initial_metadata.count;
+    op.data.send_initial_metadata.metadata = pc->p2s_initial_metadata.metadata;
+    start_op(pc, pc->c2p, &op, on_c2p_sent_initial_metadata, pc,
+             "on_c2p_sent_initial_metadata");
+    /* only start forwarding responses once they can follow the initial
+       metadata */
+    pipe_start_recv(&pc->s2c);
+  } else {
+    pc->s2c.src_done = 1;
+    pipe_maybe_finish(&pc->s2c);
   }
-  unrefpc(pc, "on_p2s_recv_msg");
+
+  unrefpc(pc, "on_p2s_recv_initial_metadata");
 }
 
-static void on_c2p_sent_status(void *arg, int success) {
+static void on_p2s_sent_initial_metadata(void *arg, int success) {
   proxy_call *pc = arg;
-  unrefpc(pc, "on_c2p_sent_status");
+  unrefpc(pc, "on_p2s_sent_initial_metadata");
 }
 
 static void on_p2s_status(void *arg, int success) {
   proxy_call *pc = arg;
-  grpc_op op;
-  grpc_call_error err;
 
-  if (!pc->proxy->shutdown) {
+  if (!pc->worker->shutdown) {
     GPR_ASSERT(success);
-    op.op = GRPC_OP_SEND_STATUS_FROM_SERVER;
-    op.flags = 0;
-    op.reserved = NULL;
-    op.data.send_status_from_server.trailing_metadata_count =
-        pc->p2s_trailing_metadata.count;
-    op.data.send_status_from_server.trailing_metadata =
-        pc->p2s_trailing_metadata.metadata;
-    op.data.send_status_from_server.status = pc->p2s_status;
-    op.data.send_status_from_server.status_details = pc->p2s_status_details;
-    refpc(pc, "on_c2p_sent_status");
-    err = grpc_call_start_batch(pc->c2p, &op, 1,
-                                new_closure(on_c2p_sent_status, pc), NULL);
-    GPR_ASSERT(err == GRPC_CALL_OK);
+    pc->p2s_status_received = 1;
+    maybe_send_status(pc);
   }
 
   unrefpc(pc, "on_p2s_status");
@@ -321,54 +409,36 @@ static void on_c2p_closed(void *arg, int success) {
 }
 
 static void on_new_call(void *arg, int success) {
-  grpc_end2end_proxy *proxy = arg;
-  grpc_call_error err;
+  proxy_worker *worker = arg;
 
   if (success) {
     grpc_op op;
     proxy_call *pc = gpr_malloc(sizeof(*pc));
     memset(pc, 0, sizeof(*pc));
-    pc->proxy = proxy;
+    pc->worker = worker;
     GPR_SWAP(grpc_metadata_array, pc->c2p_initial_metadata,
-             proxy->new_call_metadata);
-    pc->c2p = proxy->new_call;
+             worker->new_call_metadata);
+    pc->c2p = worker->new_call;
     pc->p2s = grpc_channel_create_call(
-        proxy->client, pc->c2p, GRPC_PROPAGATE_DEFAULTS, proxy->cq,
-        proxy->new_call_details.method, proxy->new_call_details.host,
-        proxy->new_call_details.deadline, NULL);
+        worker->proxy->client, pc->c2p, GRPC_PROPAGATE_DEFAULTS, worker->cq,
+        worker->new_call_details.method, worker->new_call_details.host,
+        worker->new_call_details.deadline, NULL);
     gpr_ref_init(&pc->refs, 1);
-
-    op.flags = 0;
-    op.reserved = NULL;
+    pipe_init(&pc->c2s, pc, pc->c2p, pc->p2s, on_c2s_finished);
+    pipe_init(&pc->s2c, pc, pc->p2s, pc->c2p, on_s2c_finished);
 
     op.op = GRPC_OP_RECV_INITIAL_METADATA;
     op.data.recv_initial_metadata = &pc->p2s_initial_metadata;
-    refpc(pc, "on_p2s_recv_initial_metadata");
-    err = grpc_call_start_batch(
-        pc->p2s, &op, 1, new_closure(on_p2s_recv_initial_metadata, pc), NULL);
-    GPR_ASSERT(err == GRPC_CALL_OK);
+    start_op(pc, pc->p2s, &op, on_p2s_recv_initial_metadata, pc,
+             "on_p2s_recv_initial_metadata");
 
     op.op = GRPC_OP_SEND_INITIAL_METADATA;
     op.data.send_initial_metadata.count = pc->c2p_initial_metadata.count;
     op.data.send_initial_metadata.metadata = pc->c2p_initial_metadata.metadata;
-    refpc(pc, "on_p2s_sent_initial_metadata");
-    err = grpc_call_start_batch(
-        pc->p2s, &op, 1, new_closure(on_p2s_sent_initial_metadata, pc), NULL);
-    GPR_ASSERT(err == GRPC_CALL_OK);
-
-    op.op = GRPC_OP_RECV_MESSAGE;
-    op.data.recv_message = &pc->c2p_msg;
-    refpc(pc, "on_c2p_recv_msg");
-    err = grpc_call_start_batch(pc->c2p, &op, 1,
-                                new_closure(on_c2p_recv_msg, pc), NULL);
-    GPR_ASSERT(err == GRPC_CALL_OK);
-
-    op.op = GRPC_OP_RECV_MESSAGE;
-    op.data.recv_message = &pc->p2s_msg;
-    refpc(pc, "on_p2s_recv_msg");
-    err = grpc_call_start_batch(pc->p2s, &op, 1,
-                                new_closure(on_p2s_recv_msg, pc), NULL);
-    GPR_ASSERT(err == GRPC_CALL_OK);
+    start_op(pc, pc->p2s, &op, on_p2s_sent_initial_metadata, pc,
+             "on_p2s_sent_initial_metadata");
+
+    pipe_start_recv(&pc->c2s);
 
     op.op = GRPC_OP_RECV_STATUS_ON_CLIENT;
     op.data.recv_status_on_client.trailing_metadata =
@@ -377,41 +447,35 @@ static void on_new_call(void *arg, int success) {
     op.data.recv_status_on_client.status_details = &pc->p2s_status_details;
     op.data.recv_status_on_client.status_details_capacity =
         &pc->p2s_status_details_capacity;
-    refpc(pc, "on_p2s_status");
-    err = grpc_call_start_batch(pc->p2s, &op, 1, new_closure(on_p2s_status, pc),
-                                NULL);
-    GPR_ASSERT(err == GRPC_CALL_OK);
+    start_op(pc, pc->p2s, &op, on_p2s_status, pc, "on_p2s_status");
 
     op.op = GRPC_OP_RECV_CLOSE_ON_SERVER;
     op.data.recv_close_on_server.cancelled = &pc->c2p_server_cancelled;
-    refpc(pc, "on_c2p_closed");
-    err = grpc_call_start_batch(pc->c2p, &op, 1, new_closure(on_c2p_closed, pc),
-                                NULL);
-    GPR_ASSERT(err == GRPC_CALL_OK);
+    start_op(pc, pc->c2p, &op, on_c2p_closed, pc, "on_c2p_closed");
 
-    request_call(proxy);
+    request_call(worker);
 
     unrefpc(pc, "init");
   } else {
-    GPR_ASSERT(proxy->new_call == NULL);
+    GPR_ASSERT(worker->new_call == NULL);
   }
 }
 
-static void request_call(grpc_end2end_proxy *proxy) {
-  proxy->new_call = NULL;
+static void request_call(proxy_worker *worker) {
+  worker->new_call = NULL;
   GPR_ASSERT(GRPC_CALL_OK == grpc_server_request_call(
-                                 proxy->server, &proxy->new_call,
-                                 &proxy->new_call_details,
-                                 &proxy->new_call_metadata, proxy->cq,
-                                 proxy->cq, new_closure(on_new_call, proxy)));
+                                 worker->proxy->server, &worker->new_call,
+                                 &worker->new_call_details,
+                                 &worker->new_call_metadata, worker->cq,
+                                 worker->cq, new_closure(on_new_call, worker)));
 }
 
 static void thread_main(void *arg) {
-  grpc_end2end_proxy *proxy = arg;
+  proxy_worker *worker = arg;
   closure *cl;
   for (;;) {
     grpc_event ev = grpc_completion_queue_next(
-        proxy->cq, gpr_inf_future(GPR_CLOCK_MONOTONIC), NULL);
+        worker->cq, gpr_inf_future(GPR_CLOCK_MONOTONIC), NULL);
     switch (ev.type) {
       case GRPC_QUEUE_TIMEOUT:
         gpr_log(GPR_ERROR, "Should never reach here");
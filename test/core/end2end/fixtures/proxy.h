@@ -36,13 +36,26 @@
 
 #include <grpc/grpc.h>
 
-/* proxy service for _with_proxy fixtures */
+/* Generic proxy service, used by the _with_proxy fixtures and the proxy
+   benchmark. Calls arriving at the proxy's server are forwarded to a
+   backend over the proxy's client channel, without interpreting messages.
+
+   The proxy runs one thread and completion queue per worker; each proxied
+   call (both of its legs) lives entirely on one worker, so forwarding needs
+   no locking. Messages are forwarded by handing the received byte buffer
+   straight to the other leg, so payload bytes are never copied. Each
+   direction keeps at most one message in flight on the sending leg plus one
+   received and waiting for it: reading from one leg stops while the other
+   leg cannot accept data, so flow control on either connection propagates
+   back to the peer. */
 
 typedef struct grpc_end2end_proxy grpc_end2end_proxy;
 
 typedef struct grpc_end2end_proxy_def {
   grpc_server *(*create_server)(const char *port);
   grpc_channel *(*create_client)(const char *target);
+  /* number of worker threads; 0 for one per core */
+  int num_threads;
 } grpc_end2end_proxy_def;
 
 grpc_end2end_proxy *grpc_end2end_proxy_create(
@@ -101,6 +101,7 @@ END2END_TESTS = {
     'simple_delayed_request': connectivity_test_options,
     'simple_request': default_test_options,
     'high_initial_seqno': default_test_options,
+    'write_buffering': default_test_options._replace(proxyable=False),
 }
 
 
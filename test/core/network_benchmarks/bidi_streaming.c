@@ -0,0 +1,280 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Measures bidirectional streaming throughput over a single HTTP/2
+   connection: client and server stream messages at each other on one call,
+   each side driven by its own thread and completion queue, so that reading
+   and writing of the connection can overlap. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <grpc/grpc.h>
+#include <grpc/support/alloc.h>
+#include <grpc/support/cmdline.h>
+#include <grpc/support/host_port.h>
+#include <grpc/support/log.h>
+#include <grpc/support/thd.h>
+#include <grpc/support/time.h>
+
+#include "test/core/util/port.h"
+#include "test/core/util/test_config.h"
+
+#define TAG_START ((void *)1)
+#define TAG_SEND ((void *)2)
+#define TAG_RECV ((void *)3)
+#define TAG_FINISH ((void *)4)
+
+typedef struct {
+  int is_client;
+  grpc_call *call;
+  grpc_completion_queue *cq;
+  int num_messages;
+  size_t message_size;
+  /* server only: the call arrives through these */
+  grpc_server *server;
+  grpc_call_details call_details;
+  grpc_metadata_array request_metadata;
+} side;
+
+static void start_op(side *s, grpc_op *op, void *tag) {
+  GPR_ASSERT(GRPC_CALL_OK == grpc_call_start_batch(s->call, op, 1, tag, NULL));
+}
+
+static void start_send(side *s, grpc_byte_buffer *payload) {
+  grpc_op op;
+  memset(&op, 0, sizeof(op));
+  op.op = GRPC_OP_SEND_MESSAGE;
+  op.data.send_message = payload;
+  start_op(s, &op, TAG_SEND);
+}
+
+static void start_recv(side *s, grpc_byte_buffer **payload) {
+  grpc_op op;
+  memset(&op, 0, sizeof(op));
+  op.op = GRPC_OP_RECV_MESSAGE;
+  op.data.recv_message = payload;
+  start_op(s, &op, TAG_RECV);
+}
+
+static void next_event(side *s, void *tag) {
+  grpc_event ev = grpc_completion_queue_next(
+      s->cq, gpr_inf_future(GPR_CLOCK_REALTIME), NULL);
+  GPR_ASSERT(ev.type == GRPC_OP_COMPLETE);
+  GPR_ASSERT(ev.success);
+  GPR_ASSERT(tag == NULL || ev.tag == tag);
+}
+
+static void run_side(void *arg) {
+  side *s = arg;
+  grpc_metadata_array initial_metadata;
+  grpc_metadata_array trailing_metadata;
+  grpc_byte_buffer *incoming = NULL;
+  grpc_byte_buffer *outgoing;
+  grpc_status_code status;
+  char *details = NULL;
+  size_t details_capacity = 0;
+  int was_cancelled;
+  int sent = 0;
+  int received = 0;
+  int pending = 0;
+  grpc_op ops[2];
+  gpr_slice slice = gpr_slice_malloc(s->message_size);
+
+  memset(GPR_SLICE_START_PTR(slice), 'x', s->message_size);
+  outgoing = grpc_raw_byte_buffer_create(&slice, 1);
+  grpc_metadata_array_init(&initial_metadata);
+  grpc_metadata_array_init(&trailing_metadata);
+  memset(ops, 0, sizeof(ops));
+
+  if (!s->is_client) {
+    next_event(s, TAG_START);
+  }
+  ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+  if (s->is_client) {
+    ops[1].op = GRPC_OP_RECV_INITIAL_METADATA;
+    ops[1].data.recv_initial_metadata = &initial_metadata;
+  }
+  GPR_ASSERT(GRPC_CALL_OK == grpc_call_start_batch(s->call, ops,
+                                                   s->is_client ? 2 : 1,
+                                                   TAG_START, NULL));
+  next_event(s, TAG_START);
+
+  start_send(s, outgoing);
+  start_recv(s, &incoming);
+  pending = 2;
+  while (pending > 0) {
+    grpc_event ev = grpc_completion_queue_next(
+        s->cq, gpr_inf_future(GPR_CLOCK_REALTIME), NULL);
+    GPR_ASSERT(ev.type == GRPC_OP_COMPLETE && ev.success);
+    pending--;
+    if (ev.tag == TAG_SEND) {
+      if (++sent < s->num_messages) {
+        start_send(s, outgoing);
+        pending++;
+      }
+    } else {
+      GPR_ASSERT(ev.tag == TAG_RECV);
+      GPR_ASSERT(incoming != NULL);
+      grpc_byte_buffer_destroy(incoming);
+      incoming = NULL;
+      if (++received < s->num_messages) {
+        start_recv(s, &incoming);
+        pending++;
+      }
+    }
+  }
+
+  memset(ops, 0, sizeof(ops));
+  if (s->is_client) {
+    ops[0].op = GRPC_OP_SEND_CLOSE_FROM_CLIENT;
+    ops[1].op = GRPC_OP_RECV_STATUS_ON_CLIENT;
+    ops[1].data.recv_status_on_client.trailing_metadata = &trailing_metadata;
+    ops[1].data.recv_status_on_client.status = &status;
+    ops[1].data.recv_status_on_client.status_details = &details;
+    ops[1].data.recv_status_on_client.status_details_capacity =
+        &details_capacity;
+  } else {
+    ops[0].op = GRPC_OP_SEND_STATUS_FROM_SERVER;
+    ops[0].data.send_status_from_server.status = GRPC_STATUS_OK;
+    ops[0].data.send_status_from_server.status_details = "";
+    ops[1].op = GRPC_OP_RECV_CLOSE_ON_SERVER;
+    ops[1].data.recv_close_on_server.cancelled = &was_cancelled;
+  }
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_call_start_batch(s->call, ops, 2, TAG_FINISH, NULL));
+  next_event(s, TAG_FINISH);
+  if (s->is_client) {
+    GPR_ASSERT(status == GRPC_STATUS_OK);
+  }
+
+  gpr_free(details);
+  grpc_metadata_array_destroy(&initial_metadata);
+  grpc_metadata_array_destroy(&trailing_metadata);
+  grpc_byte_buffer_destroy(outgoing);
+  gpr_slice_unref(slice);
+}
+
+static void drain_and_destroy(grpc_completion_queue *cq) {
+  grpc_completion_queue_shutdown(cq);
+  while (grpc_completion_queue_next(cq, gpr_inf_future(GPR_CLOCK_REALTIME),
+                                    NULL)
+             .type != GRPC_QUEUE_SHUTDOWN)
+    ;
+  grpc_completion_queue_destroy(cq);
+}
+
+int main(int argc, char **argv) {
+  int num_messages = 20000;
+  int message_size = 4096;
+  int port = grpc_pick_unused_port_or_die();
+  char *addr;
+  gpr_cmdline *cl;
+  side client;
+  side server;
+  gpr_thd_id client_thd;
+  gpr_thd_id server_thd;
+  gpr_thd_options options = gpr_thd_options_default();
+  gpr_timespec start;
+  double elapsed;
+
+  grpc_test_init(argc, argv);
+  cl = gpr_cmdline_create("bidirectional streaming throughput benchmark");
+  gpr_cmdline_add_int(cl, "messages", "Messages sent in each direction",
+                      &num_messages);
+  gpr_cmdline_add_int(cl, "message_size", "Size of each message in bytes",
+                      &message_size);
+  gpr_cmdline_parse(cl, argc, argv);
+  gpr_cmdline_destroy(cl);
+  GPR_ASSERT(num_messages > 0 && message_size > 0);
+
+  grpc_init();
+  gpr_join_host_port(&addr, "127.0.0.1", port);
+
+  memset(&server, 0, sizeof(server));
+  server.num_messages = num_messages;
+  server.message_size = (size_t)message_size;
+  server.cq = grpc_completion_queue_create(NULL);
+  server.server = grpc_server_create(NULL, NULL);
+  grpc_server_register_completion_queue(server.server, server.cq, NULL);
+  GPR_ASSERT(grpc_server_add_insecure_http2_port(server.server, addr) == port);
+  grpc_server_start(server.server);
+  grpc_call_details_init(&server.call_details);
+  grpc_metadata_array_init(&server.request_metadata);
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_server_request_call(server.server, &server.call,
+                                      &server.call_details,
+                                      &server.request_metadata, server.cq,
+                                      server.cq, TAG_START));
+
+  memset(&client, 0, sizeof(client));
+  client.is_client = 1;
+  client.num_messages = num_messages;
+  client.message_size = (size_t)message_size;
+  client.cq = grpc_completion_queue_create(NULL);
+  {
+    grpc_channel *channel = grpc_insecure_channel_create(addr, NULL, NULL);
+    client.call = grpc_channel_create_call(
+        channel, NULL, GRPC_PROPAGATE_DEFAULTS, client.cq, "/bidi",
+        "localhost", gpr_inf_future(GPR_CLOCK_REALTIME), NULL);
+
+    gpr_thd_options_set_joinable(&options);
+    start = gpr_now(GPR_CLOCK_MONOTONIC);
+    GPR_ASSERT(gpr_thd_new(&server_thd, run_side, &server, &options));
+    GPR_ASSERT(gpr_thd_new(&client_thd, run_side, &client, &options));
+    gpr_thd_join(client_thd);
+    gpr_thd_join(server_thd);
+    elapsed = gpr_timespec_to_micros(
+                  gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), start)) /
+              1e6;
+
+    printf("%d x %d byte messages each way: %.3fs, %.0f messages/s, %.1f MB/s\n",
+           num_messages, message_size, elapsed, 2 * num_messages / elapsed,
+           2.0 * num_messages * message_size / elapsed / 1e6);
+
+    grpc_call_destroy(client.call);
+    grpc_call_destroy(server.call);
+    grpc_channel_destroy(channel);
+  }
+
+  grpc_server_shutdown_and_notify(server.server, server.cq, TAG_FINISH);
+  next_event(&server, TAG_FINISH);
+  grpc_server_destroy(server.server);
+  grpc_call_details_destroy(&server.call_details);
+  grpc_metadata_array_destroy(&server.request_metadata);
+  drain_and_destroy(server.cq);
+  drain_and_destroy(client.cq);
+  gpr_free(addr);
+  grpc_shutdown();
+  return 0;
+}
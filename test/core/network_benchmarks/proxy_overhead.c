@@ -0,0 +1,414 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Measures the cost of forwarding calls through grpc_end2end_proxy: unary
+   round trip latency and streaming echo throughput are measured against an
+   echo server directly, and then through a proxy in front of it. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <grpc/grpc.h>
+#include <grpc/support/alloc.h>
+#include <grpc/support/cmdline.h>
+#include <grpc/support/hdr_histogram.h>
+#include <grpc/support/log.h>
+#include <grpc/support/thd.h>
+#include <grpc/support/time.h>
+
+#include "test/core/end2end/fixtures/proxy.h"
+#include "test/core/util/test_config.h"
+
+#define TAG_NEW_CALL ((void *)1)
+#define TAG_SEND ((void *)2)
+#define TAG_RECV ((void *)3)
+#define TAG_DONE ((void *)4)
+
+typedef struct {
+  double p50_us;
+  double p90_us;
+  double p99_us;
+  double messages_per_sec;
+} results;
+
+static void next_event(grpc_completion_queue *cq, void *tag) {
+  grpc_event ev =
+      grpc_completion_queue_next(cq, gpr_inf_future(GPR_CLOCK_REALTIME), NULL);
+  GPR_ASSERT(ev.type == GRPC_OP_COMPLETE);
+  GPR_ASSERT(ev.success);
+  GPR_ASSERT(ev.tag == tag);
+}
+
+static void start_batch(grpc_call *call, grpc_op *ops, size_t nops,
+                        void *tag) {
+  GPR_ASSERT(GRPC_CALL_OK == grpc_call_start_batch(call, ops, nops, tag, NULL));
+}
+
+/* echo server: serves one call at a time, sending each message back */
+
+typedef struct {
+  grpc_server *server;
+  grpc_completion_queue *cq;
+  gpr_thd_id thd;
+} echo_server;
+
+static void echo_server_thread(void *arg) {
+  echo_server *es = arg;
+  for (;;) {
+    grpc_call *call = NULL;
+    grpc_call_details details;
+    grpc_metadata_array request_metadata;
+    grpc_byte_buffer *msg = NULL;
+    grpc_event ev;
+    grpc_op ops[2];
+    int was_cancelled;
+
+    grpc_call_details_init(&details);
+    grpc_metadata_array_init(&request_metadata);
+    GPR_ASSERT(GRPC_CALL_OK ==
+               grpc_server_request_call(es->server, &call, &details,
+                                        &request_metadata, es->cq, es->cq,
+                                        TAG_NEW_CALL));
+    ev = grpc_completion_queue_next(es->cq,
+                                    gpr_inf_future(GPR_CLOCK_REALTIME), NULL);
+    GPR_ASSERT(ev.type == GRPC_OP_COMPLETE && ev.tag == TAG_NEW_CALL);
+    if (!ev.success) {
+      /* server shutting down */
+      grpc_call_details_destroy(&details);
+      grpc_metadata_array_destroy(&request_metadata);
+      return;
+    }
+
+    memset(ops, 0, sizeof(ops));
+    ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+    start_batch(call, ops, 1, TAG_SEND);
+    next_event(es->cq, TAG_SEND);
+    for (;;) {
+      memset(ops, 0, sizeof(ops));
+      ops[0].op = GRPC_OP_RECV_MESSAGE;
+      ops[0].data.recv_message = &msg;
+      start_batch(call, ops, 1, TAG_RECV);
+      next_event(es->cq, TAG_RECV);
+      if (msg == NULL) break;
+      memset(ops, 0, sizeof(ops));
+      ops[0].op = GRPC_OP_SEND_MESSAGE;
+      ops[0].data.send_message = msg;
+      start_batch(call, ops, 1, TAG_SEND);
+      next_event(es->cq, TAG_SEND);
+      grpc_byte_buffer_destroy(msg);
+      msg = NULL;
+    }
+    memset(ops, 0, sizeof(ops));
+    ops[0].op = GRPC_OP_SEND_STATUS_FROM_SERVER;
+    ops[0].data.send_status_from_server.status = GRPC_STATUS_OK;
+    ops[0].data.send_status_from_server.status_details = "";
+    ops[1].op = GRPC_OP_RECV_CLOSE_ON_SERVER;
+    ops[1].data.recv_close_on_server.cancelled = &was_cancelled;
+    start_batch(call, ops, 2, TAG_DONE);
+    next_event(es->cq, TAG_DONE);
+
+    grpc_call_destroy(call);
+    grpc_call_details_destroy(&details);
+    grpc_metadata_array_destroy(&request_metadata);
+  }
+}
+
+static grpc_server *create_insecure_server(const char *addr) {
+  grpc_server *server = grpc_server_create(NULL, NULL);
+  GPR_ASSERT(grpc_server_add_insecure_http2_port(server, addr));
+  return server;
+}
+
+static grpc_channel *create_insecure_channel(const char *target) {
+  return grpc_insecure_channel_create(target, NULL, NULL);
+}
+
+/* client side */
+
+static grpc_byte_buffer *make_payload(size_t size) {
+  gpr_slice slice = gpr_slice_malloc(size);
+  grpc_byte_buffer *bb;
+  memset(GPR_SLICE_START_PTR(slice), 'x', size);
+  bb = grpc_raw_byte_buffer_create(&slice, 1);
+  gpr_slice_unref(slice);
+  return bb;
+}
+
+static void run_unary(grpc_channel *channel, grpc_completion_queue *cq,
+                      int num_calls, size_t message_size, results *r) {
+  gpr_hdr_histogram *latencies = gpr_hdr_histogram_create(60000000000, 3);
+  grpc_byte_buffer *payload = make_payload(message_size);
+  int i;
+
+  for (i = 0; i < num_calls; i++) {
+    grpc_metadata_array initial_metadata;
+    grpc_metadata_array trailing_metadata;
+    grpc_byte_buffer *response = NULL;
+    grpc_status_code status;
+    char *details = NULL;
+    size_t details_capacity = 0;
+    grpc_op ops[6];
+    gpr_timespec start = gpr_now(GPR_CLOCK_MONOTONIC);
+    grpc_call *call = grpc_channel_create_call(
+        channel, NULL, GRPC_PROPAGATE_DEFAULTS, cq, "/echo", "localhost",
+        gpr_inf_future(GPR_CLOCK_REALTIME), NULL);
+
+    grpc_metadata_array_init(&initial_metadata);
+    grpc_metadata_array_init(&trailing_metadata);
+    memset(ops, 0, sizeof(ops));
+    ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+    ops[1].op = GRPC_OP_SEND_MESSAGE;
+    ops[1].data.send_message = payload;
+    ops[2].op = GRPC_OP_SEND_CLOSE_FROM_CLIENT;
+    ops[3].op = GRPC_OP_RECV_INITIAL_METADATA;
+    ops[3].data.recv_initial_metadata = &initial_metadata;
+    ops[4].op = GRPC_OP_RECV_MESSAGE;
+    ops[4].data.recv_message = &response;
+    ops[5].op = GRPC_OP_RECV_STATUS_ON_CLIENT;
+    ops[5].data.recv_status_on_client.trailing_metadata = &trailing_metadata;
+    ops[5].data.recv_status_on_client.status = &status;
+    ops[5].data.recv_status_on_client.status_details = &details;
+    ops[5].data.recv_status_on_client.status_details_capacity =
+        &details_capacity;
+    start_batch(call, ops, 6, TAG_DONE);
+    next_event(cq, TAG_DONE);
+    GPR_ASSERT(status == GRPC_STATUS_OK);
+    GPR_ASSERT(response != NULL);
+    gpr_hdr_histogram_record(
+        latencies,
+        (gpr_int64)(gpr_timespec_to_micros(gpr_time_sub(
+                        gpr_now(GPR_CLOCK_MONOTONIC), start)) *
+                    1000));
+
+    grpc_byte_buffer_destroy(response);
+    grpc_metadata_array_destroy(&initial_metadata);
+    grpc_metadata_array_destroy(&trailing_metadata);
+    gpr_free(details);
+    grpc_call_destroy(call);
+  }
+
+  r->p50_us =
+      (double)gpr_hdr_histogram_value_at_percentile(latencies, 50) / 1000;
+  r->p90_us =
+      (double)gpr_hdr_histogram_value_at_percentile(latencies, 90) / 1000;
+  r->p99_us =
+      (double)gpr_hdr_histogram_value_at_percentile(latencies, 99) / 1000;
+  grpc_byte_buffer_destroy(payload);
+  gpr_hdr_histogram_destroy(latencies);
+}
+
+/* Streams num_messages messages to the echo server, keeping one send and
+   one receive outstanding, and measures how quickly the echoes return. */
+static void run_streaming(grpc_channel *channel, grpc_completion_queue *cq,
+                          int num_messages, size_t message_size,
+                          results *r) {
+  grpc_byte_buffer *payload = make_payload(message_size);
+  grpc_byte_buffer *response = NULL;
+  grpc_metadata_array initial_metadata;
+  grpc_metadata_array trailing_metadata;
+  grpc_status_code status;
+  char *details = NULL;
+  size_t details_capacity = 0;
+  grpc_op ops[2];
+  int sent = 0;
+  int received = 0;
+  int pending;
+  gpr_timespec start = gpr_now(GPR_CLOCK_MONOTONIC);
+  double elapsed;
+  grpc_call *call = grpc_channel_create_call(
+      channel, NULL, GRPC_PROPAGATE_DEFAULTS, cq, "/echo", "localhost",
+      gpr_inf_future(GPR_CLOCK_REALTIME), NULL);
+
+  grpc_metadata_array_init(&initial_metadata);
+  grpc_metadata_array_init(&trailing_metadata);
+  memset(ops, 0, sizeof(ops));
+  ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+  ops[1].op = GRPC_OP_RECV_INITIAL_METADATA;
+  ops[1].data.recv_initial_metadata = &initial_metadata;
+  start_batch(call, ops, 2, TAG_DONE);
+  next_event(cq, TAG_DONE);
+
+  memset(ops, 0, sizeof(ops));
+  ops[0].op = GRPC_OP_SEND_MESSAGE;
+  ops[0].data.send_message = payload;
+  start_batch(call, ops, 1, TAG_SEND);
+  ops[0].op = GRPC_OP_RECV_MESSAGE;
+  ops[0].data.recv_message = &response;
+  start_batch(call, ops, 1, TAG_RECV);
+  pending = 2;
+  while (pending > 0) {
+    grpc_event ev = grpc_completion_queue_next(
+        cq, gpr_inf_future(GPR_CLOCK_REALTIME), NULL);
+    GPR_ASSERT(ev.type == GRPC_OP_COMPLETE && ev.success);
+    pending--;
+    memset(ops, 0, sizeof(ops));
+    if (ev.tag == TAG_SEND) {
+      if (++sent < num_messages) {
+        ops[0].op = GRPC_OP_SEND_MESSAGE;
+        ops[0].data.send_message = payload;
+        start_batch(call, ops, 1, TAG_SEND);
+        pending++;
+      }
+    } else {
+      GPR_ASSERT(ev.tag == TAG_RECV);
+      GPR_ASSERT(response != NULL);
+      grpc_byte_buffer_destroy(response);
+      response = NULL;
+      if (++received < num_messages) {
+        ops[0].op = GRPC_OP_RECV_MESSAGE;
+        ops[0].data.recv_message = &response;
+        start_batch(call, ops, 1, TAG_RECV);
+        pending++;
+      }
+    }
+  }
+  elapsed = gpr_timespec_to_micros(
+                gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), start)) /
+            1e6;
+  r->messages_per_sec = num_messages / elapsed;
+
+  memset(ops, 0, sizeof(ops));
+  ops[0].op = GRPC_OP_SEND_CLOSE_FROM_CLIENT;
+  ops[1].op = GRPC_OP_RECV_STATUS_ON_CLIENT;
+  ops[1].data.recv_status_on_client.trailing_metadata = &trailing_metadata;
+  ops[1].data.recv_status_on_client.status = &status;
+  ops[1].data.recv_status_on_client.status_details = &details;
+  ops[1].data.recv_status_on_client.status_details_capacity =
+      &details_capacity;
+  start_batch(call, ops, 2, TAG_DONE);
+  next_event(cq, TAG_DONE);
+  GPR_ASSERT(status == GRPC_STATUS_OK);
+
+  grpc_metadata_array_destroy(&initial_metadata);
+  grpc_metadata_array_destroy(&trailing_metadata);
+  gpr_free(details);
+  grpc_call_destroy(call);
+  grpc_byte_buffer_destroy(payload);
+}
+
+static void run_client(const char *name, const char *target, int num_calls,
+                       int num_messages, size_t message_size, results *r) {
+  grpc_channel *channel = grpc_insecure_channel_create(target, NULL, NULL);
+  grpc_completion_queue *cq = grpc_completion_queue_create(NULL);
+
+  /* warm up the connection */
+  run_unary(channel, cq, 10, message_size, r);
+  run_unary(channel, cq, num_calls, message_size, r);
+  run_streaming(channel, cq, num_messages, message_size, r);
+  printf("%-7s unary latency p50/p90/p99: %.1f/%.1f/%.1f us, "
+         "streaming: %.0f messages/s\n",
+         name, r->p50_us, r->p90_us, r->p99_us, r->messages_per_sec);
+
+  grpc_channel_destroy(channel);
+  grpc_completion_queue_shutdown(cq);
+  while (grpc_completion_queue_next(cq, gpr_inf_future(GPR_CLOCK_REALTIME),
+                                    NULL)
+             .type != GRPC_QUEUE_SHUTDOWN)
+    ;
+  grpc_completion_queue_destroy(cq);
+}
+
+int main(int argc, char **argv) {
+  int num_calls = 2000;
+  int num_messages = 20000;
+  int message_size = 1024;
+  int proxy_threads = 0;
+  grpc_end2end_proxy_def proxy_def;
+  grpc_end2end_proxy *proxy;
+  echo_server es;
+  grpc_completion_queue *shutdown_cq;
+  gpr_thd_options options = gpr_thd_options_default();
+  results direct;
+  results proxied;
+  gpr_cmdline *cl;
+
+  grpc_test_init(argc, argv);
+  cl = gpr_cmdline_create("proxy overhead benchmark");
+  gpr_cmdline_add_int(cl, "calls", "Unary calls to time", &num_calls);
+  gpr_cmdline_add_int(cl, "messages", "Messages to stream", &num_messages);
+  gpr_cmdline_add_int(cl, "message_size", "Size of each message in bytes",
+                      &message_size);
+  gpr_cmdline_add_int(cl, "proxy_threads",
+                      "Proxy worker threads (0 for one per core)",
+                      &proxy_threads);
+  gpr_cmdline_parse(cl, argc, argv);
+  gpr_cmdline_destroy(cl);
+  GPR_ASSERT(num_calls > 0 && num_messages > 0 && message_size > 0);
+
+  grpc_init();
+
+  proxy_def.create_server = create_insecure_server;
+  proxy_def.create_client = create_insecure_channel;
+  proxy_def.num_threads = proxy_threads;
+  proxy = grpc_end2end_proxy_create(&proxy_def);
+
+  /* the echo server is the proxy's backend */
+  es.server =
+      create_insecure_server(grpc_end2end_proxy_get_server_port(proxy));
+  es.cq = grpc_completion_queue_create(NULL);
+  grpc_server_register_completion_queue(es.server, es.cq, NULL);
+  grpc_server_start(es.server);
+  gpr_thd_options_set_joinable(&options);
+  GPR_ASSERT(gpr_thd_new(&es.thd, echo_server_thread, &es, &options));
+
+  run_client("direct", grpc_end2end_proxy_get_server_port(proxy), num_calls,
+             num_messages, (size_t)message_size, &direct);
+  run_client("proxied", grpc_end2end_proxy_get_client_target(proxy),
+             num_calls, num_messages, (size_t)message_size, &proxied);
+  printf("proxy added latency p50/p90/p99: %.1f/%.1f/%.1f us, "
+         "streaming throughput: %.1f%% of direct\n",
+         proxied.p50_us - direct.p50_us, proxied.p90_us - direct.p90_us,
+         proxied.p99_us - direct.p99_us,
+         100.0 * proxied.messages_per_sec / direct.messages_per_sec);
+
+  grpc_end2end_proxy_destroy(proxy);
+  shutdown_cq = grpc_completion_queue_create(NULL);
+  grpc_server_shutdown_and_notify(es.server, shutdown_cq, TAG_DONE);
+  next_event(shutdown_cq, TAG_DONE);
+  gpr_thd_join(es.thd);
+  grpc_server_destroy(es.server);
+  grpc_completion_queue_shutdown(es.cq);
+  while (grpc_completion_queue_next(es.cq, gpr_inf_future(GPR_CLOCK_REALTIME),
+                                    NULL)
+             .type != GRPC_QUEUE_SHUTDOWN)
+    ;
+  grpc_completion_queue_destroy(es.cq);
+  grpc_completion_queue_shutdown(shutdown_cq);
+  while (grpc_completion_queue_next(shutdown_cq,
+                                    gpr_inf_future(GPR_CLOCK_REALTIME), NULL)
+             .type != GRPC_QUEUE_SHUTDOWN)
+    ;
+  grpc_completion_queue_destroy(shutdown_cq);
+  grpc_shutdown();
+  return 0;
+}
@@ -0,0 +1,283 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Measures the CPU time the receiving side of a connection spends per MB of
+   message payload, for messages from 64KB to 4MB. A client streams messages
+   to a server whose completion queue is polled by a single thread; that
+   thread reads and parses everything the server side of the connection
+   receives, so its CPU time is the cost of receiving. Payloads are delivered
+   as references to the read buffers, so the number of slices per message is
+   also reported. */
+
+#include <grpc/support/port_platform.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <grpc/byte_buffer.h>
+#include <grpc/grpc.h>
+#include <grpc/support/alloc.h>
+#include <grpc/support/cmdline.h>
+#include <grpc/support/host_port.h>
+#include <grpc/support/log.h>
+#include <grpc/support/thd.h>
+#include <grpc/support/time.h>
+
+#include "test/core/util/port.h"
+#include "test/core/util/test_config.h"
+
+#define TAG_START ((void *)1)
+#define TAG_MESSAGE ((void *)2)
+#define TAG_FINISH ((void *)3)
+
+typedef struct {
+  grpc_server *server;
+  grpc_completion_queue *cq;
+  int num_calls;
+} server_args;
+
+static void next_event(grpc_completion_queue *cq, void *tag) {
+  grpc_event ev =
+      grpc_completion_queue_next(cq, gpr_inf_future(GPR_CLOCK_REALTIME), NULL);
+  GPR_ASSERT(ev.type == GRPC_OP_COMPLETE);
+  GPR_ASSERT(ev.success);
+  GPR_ASSERT(ev.tag == tag);
+}
+
+static double thread_cpu_seconds(void) {
+  struct timespec ts;
+  GPR_ASSERT(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+/* Receives one call and reports what receiving its messages cost. */
+static void receive_call(server_args *args) {
+  grpc_call *call;
+  grpc_call_details call_details;
+  grpc_metadata_array request_metadata;
+  grpc_byte_buffer *message;
+  grpc_op ops[2];
+  int was_cancelled;
+  size_t num_messages = 0;
+  size_t num_slices = 0;
+  size_t num_bytes = 0;
+  double cpu;
+
+  grpc_call_details_init(&call_details);
+  grpc_metadata_array_init(&request_metadata);
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_server_request_call(args->server, &call, &call_details,
+                                      &request_metadata, args->cq, args->cq,
+                                      TAG_START));
+  next_event(args->cq, TAG_START);
+
+  cpu = thread_cpu_seconds();
+  memset(ops, 0, sizeof(ops));
+  ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_call_start_batch(call, ops, 1, TAG_START, NULL));
+  next_event(args->cq, TAG_START);
+  for (;;) {
+    memset(ops, 0, sizeof(ops));
+    ops[0].op = GRPC_OP_RECV_MESSAGE;
+    ops[0].data.recv_message = &message;
+    GPR_ASSERT(GRPC_CALL_OK ==
+               grpc_call_start_batch(call, ops, 1, TAG_MESSAGE, NULL));
+    next_event(args->cq, TAG_MESSAGE);
+    if (message == NULL) break;
+    num_messages++;
+    num_slices += message->data.raw.slice_buffer.count;
+    num_bytes += grpc_byte_buffer_length(message);
+    grpc_byte_buffer_destroy(message);
+  }
+  cpu = thread_cpu_seconds() - cpu;
+
+  memset(ops, 0, sizeof(ops));
+  ops[0].op = GRPC_OP_SEND_STATUS_FROM_SERVER;
+  ops[0].data.send_status_from_server.status = GRPC_STATUS_OK;
+  ops[0].data.send_status_from_server.status_details = "";
+  ops[1].op = GRPC_OP_RECV_CLOSE_ON_SERVER;
+  ops[1].data.recv_close_on_server.cancelled = &was_cancelled;
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_call_start_batch(call, ops, 2, TAG_FINISH, NULL));
+  next_event(args->cq, TAG_FINISH);
+
+  GPR_ASSERT(num_messages > 0);
+  printf("%8lu byte messages: %6lu received, %8.1f us cpu/MB, "
+         "%6.1f slices/message\n",
+         (unsigned long)(num_bytes / num_messages),
+         (unsigned long)num_messages, 1e6 * cpu / ((double)num_bytes / 1e6),
+         (double)num_slices / (double)num_messages);
+  fflush(stdout);
+
+  grpc_call_destroy(call);
+  grpc_call_details_destroy(&call_details);
+  grpc_metadata_array_destroy(&request_metadata);
+}
+
+static void run_server(void *arg) {
+  server_args *args = arg;
+  int i;
+  for (i = 0; i < args->num_calls; i++) {
+    receive_call(args);
+  }
+}
+
+/* Streams num_messages messages of message_size bytes on one call. */
+static void send_call(grpc_channel *channel, grpc_completion_queue *cq,
+                      size_t message_size, size_t num_messages) {
+  grpc_call *call = grpc_channel_create_call(
+      channel, NULL, GRPC_PROPAGATE_DEFAULTS, cq, "/receive_cpu", "localhost",
+      gpr_inf_future(GPR_CLOCK_REALTIME), NULL);
+  gpr_slice slice = gpr_slice_malloc(message_size);
+  grpc_byte_buffer *payload;
+  grpc_metadata_array initial_metadata;
+  grpc_metadata_array trailing_metadata;
+  grpc_status_code status;
+  char *details = NULL;
+  size_t details_capacity = 0;
+  grpc_op ops[2];
+  size_t i;
+
+  memset(GPR_SLICE_START_PTR(slice), 'x', message_size);
+  payload = grpc_raw_byte_buffer_create(&slice, 1);
+  grpc_metadata_array_init(&initial_metadata);
+  grpc_metadata_array_init(&trailing_metadata);
+
+  memset(ops, 0, sizeof(ops));
+  ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+  ops[1].op = GRPC_OP_RECV_INITIAL_METADATA;
+  ops[1].data.recv_initial_metadata = &initial_metadata;
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_call_start_batch(call, ops, 2, TAG_START, NULL));
+  next_event(cq, TAG_START);
+
+  for (i = 0; i < num_messages; i++) {
+    memset(ops, 0, sizeof(ops));
+    ops[0].op = GRPC_OP_SEND_MESSAGE;
+    ops[0].data.send_message = payload;
+    GPR_ASSERT(GRPC_CALL_OK ==
+               grpc_call_start_batch(call, ops, 1, TAG_MESSAGE, NULL));
+    next_event(cq, TAG_MESSAGE);
+  }
+
+  memset(ops, 0, sizeof(ops));
+  ops[0].op = GRPC_OP_SEND_CLOSE_FROM_CLIENT;
+  ops[1].op = GRPC_OP_RECV_STATUS_ON_CLIENT;
+  ops[1].data.recv_status_on_client.trailing_metadata = &trailing_metadata;
+  ops[1].data.recv_status_on_client.status = &status;
+  ops[1].data.recv_status_on_client.status_details = &details;
+  ops[1].data.recv_status_on_client.status_details_capacity =
+      &details_capacity;
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_call_start_batch(call, ops, 2, TAG_FINISH, NULL));
+  next_event(cq, TAG_FINISH);
+  GPR_ASSERT(status == GRPC_STATUS_OK);
+
+  gpr_free(details);
+  grpc_metadata_array_destroy(&initial_metadata);
+  grpc_metadata_array_destroy(&trailing_metadata);
+  grpc_byte_buffer_destroy(payload);
+  gpr_slice_unref(slice);
+  grpc_call_destroy(call);
+}
+
+static void drain_and_destroy(grpc_completion_queue *cq) {
+  grpc_completion_queue_shutdown(cq);
+  while (grpc_completion_queue_next(cq, gpr_inf_future(GPR_CLOCK_REALTIME),
+                                    NULL)
+             .type != GRPC_QUEUE_SHUTDOWN)
+    ;
+  grpc_completion_queue_destroy(cq);
+}
+
+int main(int argc, char **argv) {
+  int megabytes = 256;
+  int min_size = 64 * 1024;
+  int max_size = 4 * 1024 * 1024;
+  int port = grpc_pick_unused_port_or_die();
+  char *addr;
+  gpr_cmdline *cl;
+  server_args server;
+  grpc_channel *channel;
+  grpc_completion_queue *client_cq;
+  gpr_thd_id server_thd;
+  gpr_thd_options options = gpr_thd_options_default();
+  size_t size;
+
+  grpc_test_init(argc, argv);
+  cl = gpr_cmdline_create("receive side cpu per MB benchmark");
+  gpr_cmdline_add_int(cl, "megabytes", "Payload sent for each message size",
+                      &megabytes);
+  gpr_cmdline_add_int(cl, "min_size", "Smallest message size in bytes",
+                      &min_size);
+  gpr_cmdline_add_int(cl, "max_size", "Largest message size in bytes",
+                      &max_size);
+  gpr_cmdline_parse(cl, argc, argv);
+  gpr_cmdline_destroy(cl);
+  GPR_ASSERT(megabytes > 0 && min_size > 0 && max_size >= min_size);
+
+  grpc_init();
+  gpr_join_host_port(&addr, "127.0.0.1", port);
+
+  memset(&server, 0, sizeof(server));
+  for (size = (size_t)min_size; size <= (size_t)max_size; size *= 4) {
+    server.num_calls++;
+  }
+  server.cq = grpc_completion_queue_create(NULL);
+  server.server = grpc_server_create(NULL, NULL);
+  grpc_server_register_completion_queue(server.server, server.cq, NULL);
+  GPR_ASSERT(grpc_server_add_insecure_http2_port(server.server, addr) == port);
+  grpc_server_start(server.server);
+  gpr_thd_options_set_joinable(&options);
+  GPR_ASSERT(gpr_thd_new(&server_thd, run_server, &server, &options));
+
+  client_cq = grpc_completion_queue_create(NULL);
+  channel = grpc_insecure_channel_create(addr, NULL, NULL);
+  for (size = (size_t)min_size; size <= (size_t)max_size; size *= 4) {
+    size_t num_messages = (size_t)megabytes * 1024 * 1024 / size;
+    send_call(channel, client_cq, size, num_messages > 0 ? num_messages : 1);
+  }
+  gpr_thd_join(server_thd);
+  grpc_channel_destroy(channel);
+
+  grpc_server_shutdown_and_notify(server.server, server.cq, TAG_FINISH);
+  next_event(server.cq, TAG_FINISH);
+  grpc_server_destroy(server.server);
+  drain_and_destroy(server.cq);
+  drain_and_destroy(client_cq);
+  gpr_free(addr);
+  grpc_shutdown();
+  return 0;
+}
@@ -33,8 +33,21 @@
 
 #include "src/core/profiling/timers.h"
 #include <stdlib.h>
+#include <grpc/support/log.h>
+#include <grpc/support/sync.h>
+#include <grpc/support/thd.h>
 #include "test/core/util/test_config.h"
 
+#define STATE_0 (GRPC_PTAG_OTHER_BASE + 0)
+#define STATE_1 (GRPC_PTAG_OTHER_BASE + 1)
+#define STATE_2 (GRPC_PTAG_OTHER_BASE + 2)
+#define OUTER_BLOCK (GRPC_PTAG_OTHER_BASE + 3)
+#define INNER_BLOCK (GRPC_PTAG_OTHER_BASE + 4)
+
+#define NUM_THREADS 8
+/* More than the profiler keeps rings for at once */
+#define NUM_SHORT_LIVED_THREADS 300
+
 void test_log_events(size_t num_seqs) {
   size_t start = 0;
   size_t *state;
@@ -74,10 +87,85 @@ void test_log_events(size_t num_seqs) {
   free(state);
 }
 
+typedef struct {
+  gpr_event *start;
+  size_t num_blocks;
+  gpr_mu *mu;
+  gpr_cv *done_cv;
+  int *threads_left;
+} thread_args;
+
+static void log_blocks(void *arg) {
+  thread_args *args = arg;
+  size_t i;
+  gpr_event_wait(args->start, gpr_inf_future(GPR_CLOCK_REALTIME));
+  for (i = 0; i < args->num_blocks; i++) {
+    GRPC_TIMER_BEGIN(OUTER_BLOCK, i);
+    GRPC_TIMER_BEGIN(INNER_BLOCK, i);
+    GRPC_TIMER_END(INNER_BLOCK, i);
+    GRPC_TIMER_IMPORTANT_MARK(STATE_0, i);
+    GRPC_TIMER_END(OUTER_BLOCK, i);
+  }
+  gpr_mu_lock(args->mu);
+  if (--*args->threads_left == 0) gpr_cv_signal(args->done_cv);
+  gpr_mu_unlock(args->mu);
+}
+
+/* Logs nested blocks from several threads at once. */
+void test_log_blocks_from_threads(size_t num_blocks) {
+  gpr_event start;
+  gpr_mu mu;
+  gpr_cv done_cv;
+  int threads_left = NUM_THREADS;
+  thread_args args;
+  gpr_thd_id id;
+  int i;
+
+  gpr_event_init(&start);
+  gpr_mu_init(&mu);
+  gpr_cv_init(&done_cv);
+  args.start = &start;
+  args.num_blocks = num_blocks;
+  args.mu = &mu;
+  args.done_cv = &done_cv;
+  args.threads_left = &threads_left;
+  for (i = 0; i < NUM_THREADS; i++) {
+    GPR_ASSERT(gpr_thd_new(&id, log_blocks, &args, NULL));
+  }
+  gpr_event_set(&start, (void *)1);
+  gpr_mu_lock(&mu);
+  while (threads_left > 0) {
+    gpr_cv_wait(&done_cv, &mu, gpr_inf_future(GPR_CLOCK_REALTIME));
+  }
+  gpr_mu_unlock(&mu);
+  gpr_cv_destroy(&done_cv);
+  gpr_mu_destroy(&mu);
+}
+
+static void log_block(void *arg) {
+  GRPC_TIMER_BEGIN(OUTER_BLOCK, arg);
+  GRPC_TIMER_END(OUTER_BLOCK, arg);
+}
+
+/* Logs from threads started one after the other. */
+void test_log_from_short_lived_threads(void) {
+  gpr_thd_options options = gpr_thd_options_default();
+  gpr_thd_id id;
+  gpr_intptr i;
+
+  gpr_thd_options_set_joinable(&options);
+  for (i = 0; i < NUM_SHORT_LIVED_THREADS; i++) {
+    GPR_ASSERT(gpr_thd_new(&id, log_block, (void *)i, &options));
+    gpr_thd_join(id);
+  }
+}
+
 int main(int argc, char **argv) {
   grpc_test_init(argc, argv);
   grpc_timers_global_init();
   test_log_events(1000000);
+  test_log_blocks_from_threads(100000);
+  test_log_from_short_lived_threads();
   grpc_timers_global_destroy();
   return 0;
 }
@@ -0,0 +1,330 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Measures the latency of unary calls on an established secure channel while
+   a burst of new secure channels connects to the same server, whose I/O is
+   polled by a single thread. Runs once with handshakes processed inline and
+   once with handshakes offloaded. */
+
+#include <string.h>
+
+#include <grpc/grpc.h>
+#include <grpc/grpc_security.h>
+#include <grpc/support/alloc.h>
+#include <grpc/support/atm.h>
+#include <grpc/support/histogram.h>
+#include <grpc/support/host_port.h>
+#include <grpc/support/log.h>
+#include <grpc/support/sync.h>
+#include <grpc/support/thd.h>
+#include <grpc/support/time.h>
+
+#include "test/core/end2end/data/ssl_test_data.h"
+#include "test/core/util/port.h"
+#include "test/core/util/test_config.h"
+
+#define NUM_IDLE_CALLS 200
+#define NUM_STORM_CHANNELS 100
+
+typedef struct {
+  grpc_call *call;
+  grpc_call_details details;
+  grpc_metadata_array request_metadata;
+  int cancelled;
+  int replying;
+} server_call;
+
+typedef struct {
+  grpc_server *server;
+  grpc_completion_queue *cq;
+  gpr_thd_id thd;
+} test_server;
+
+typedef struct {
+  char *addr;
+  grpc_credentials *creds;
+  grpc_channel_args *args;
+  gpr_atm done;
+  size_t num_ready;
+} storm;
+
+static gpr_timespec deadline_after(int seconds) {
+  return GRPC_TIMEOUT_SECONDS_TO_DEADLINE(seconds);
+}
+
+static void request_call(test_server *s) {
+  server_call *sc = gpr_malloc(sizeof(*sc));
+  memset(sc, 0, sizeof(*sc));
+  grpc_call_details_init(&sc->details);
+  grpc_metadata_array_init(&sc->request_metadata);
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_server_request_call(s->server, &sc->call, &sc->details,
+                                      &sc->request_metadata, s->cq, s->cq,
+                                      sc));
+}
+
+static void reply(server_call *sc) {
+  grpc_op ops[3];
+  memset(ops, 0, sizeof(ops));
+  ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+  ops[1].op = GRPC_OP_SEND_STATUS_FROM_SERVER;
+  ops[1].data.send_status_from_server.status = GRPC_STATUS_OK;
+  ops[1].data.send_status_from_server.status_details = "";
+  ops[2].op = GRPC_OP_RECV_CLOSE_ON_SERVER;
+  ops[2].data.recv_close_on_server.cancelled = &sc->cancelled;
+  sc->replying = 1;
+  GPR_ASSERT(GRPC_CALL_OK == grpc_call_start_batch(sc->call, ops, 3, sc, NULL));
+}
+
+static void destroy_server_call(server_call *sc) {
+  if (sc->call != NULL) grpc_call_destroy(sc->call);
+  grpc_call_details_destroy(&sc->details);
+  grpc_metadata_array_destroy(&sc->request_metadata);
+  gpr_free(sc);
+}
+
+/* The only thread polling the server: it accepts connections, runs their
+   handshakes when they are not offloaded and answers every call. */
+static void server_thread(void *arg) {
+  test_server *s = arg;
+  for (;;) {
+    grpc_event ev = grpc_completion_queue_next(
+        s->cq, gpr_inf_future(GPR_CLOCK_MONOTONIC), NULL);
+    server_call *sc = ev.tag;
+    if (ev.type == GRPC_QUEUE_SHUTDOWN) break;
+    GPR_ASSERT(ev.type == GRPC_OP_COMPLETE);
+    if (sc == NULL) continue; /* server shutdown notification */
+    if (!ev.success || sc->replying) {
+      destroy_server_call(sc);
+      continue;
+    }
+    request_call(s);
+    reply(sc);
+  }
+}
+
+static void start_server(test_server *s, char *addr) {
+  grpc_ssl_pem_key_cert_pair pem_key_cert_pair = {test_server1_key,
+                                                   test_server1_cert};
+  grpc_server_credentials *creds =
+      grpc_ssl_server_credentials_create(NULL, &pem_key_cert_pair, 1, 0, NULL);
+  gpr_thd_options options = gpr_thd_options_default();
+  s->cq = grpc_completion_queue_create(NULL);
+  s->server = grpc_server_create(NULL, NULL);
+  grpc_server_register_completion_queue(s->server, s->cq, NULL);
+  GPR_ASSERT(grpc_server_add_secure_http2_port(s->server, addr, creds));
+  grpc_server_credentials_release(creds);
+  grpc_server_start(s->server);
+  request_call(s);
+  gpr_thd_options_set_joinable(&options);
+  GPR_ASSERT(gpr_thd_new(&s->thd, server_thread, s, &options));
+}
+
+static void stop_server(test_server *s) {
+  grpc_server_shutdown_and_notify(s->server, s->cq, NULL);
+  grpc_server_cancel_all_calls(s->server);
+  grpc_completion_queue_shutdown(s->cq);
+  gpr_thd_join(s->thd);
+  grpc_server_destroy(s->server);
+  grpc_completion_queue_destroy(s->cq);
+}
+
+static grpc_channel_args *create_channel_args(void) {
+  grpc_channel_args *args = gpr_malloc(sizeof(*args));
+  args->num_args = 1;
+  args->args = gpr_malloc(sizeof(grpc_arg));
+  args->args[0].type = GRPC_ARG_STRING;
+  args->args[0].key = GRPC_SSL_TARGET_NAME_OVERRIDE_ARG;
+  args->args[0].value.string = "foo.test.google.fr";
+  return args;
+}
+
+static void destroy_channel_args(grpc_channel_args *args) {
+  gpr_free(args->args);
+  gpr_free(args);
+}
+
+/* Performs one unary call and returns its latency in microseconds. */
+static double do_call(grpc_channel *channel, grpc_completion_queue *cq) {
+  gpr_timespec start = gpr_now(GPR_CLOCK_MONOTONIC);
+  gpr_timespec elapsed;
+  grpc_call *call;
+  grpc_op ops[4];
+  grpc_metadata_array initial_metadata;
+  grpc_metadata_array trailing_metadata;
+  grpc_status_code status;
+  char *details = NULL;
+  size_t details_capacity = 0;
+  grpc_event ev;
+
+  grpc_metadata_array_init(&initial_metadata);
+  grpc_metadata_array_init(&trailing_metadata);
+  call = grpc_channel_create_call(channel, NULL, GRPC_PROPAGATE_DEFAULTS, cq,
+                                  "/foo", "foo.test.google.fr",
+                                  deadline_after(10), NULL);
+  memset(ops, 0, sizeof(ops));
+  ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+  ops[1].op = GRPC_OP_SEND_CLOSE_FROM_CLIENT;
+  ops[2].op = GRPC_OP_RECV_INITIAL_METADATA;
+  ops[2].data.recv_initial_metadata = &initial_metadata;
+  ops[3].op = GRPC_OP_RECV_STATUS_ON_CLIENT;
+  ops[3].data.recv_status_on_client.trailing_metadata = &trailing_metadata;
+  ops[3].data.recv_status_on_client.status = &status;
+  ops[3].data.recv_status_on_client.status_details = &details;
+  ops[3].data.recv_status_on_client.status_details_capacity =
+      &details_capacity;
+  GPR_ASSERT(GRPC_CALL_OK == grpc_call_start_batch(call, ops, 4, call, NULL));
+  ev = grpc_completion_queue_next(cq, deadline_after(15), NULL);
+  GPR_ASSERT(ev.type == GRPC_OP_COMPLETE);
+  GPR_ASSERT(ev.tag == call);
+  GPR_ASSERT(ev.success);
+  GPR_ASSERT(status == GRPC_STATUS_OK);
+  elapsed = gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), start);
+
+  grpc_call_destroy(call);
+  grpc_metadata_array_destroy(&initial_metadata);
+  grpc_metadata_array_destroy(&trailing_metadata);
+  gpr_free(details);
+  return 1e6 * (double)elapsed.tv_sec + 1e-3 * elapsed.tv_nsec;
+}
+
+/* Connects NUM_STORM_CHANNELS new channels at once and waits until all of them
+   are ready. */
+static void storm_thread(void *arg) {
+  storm *st = arg;
+  grpc_completion_queue *cq = grpc_completion_queue_create(NULL);
+  grpc_channel *channels[NUM_STORM_CHANNELS];
+  size_t i;
+
+  for (i = 0; i < NUM_STORM_CHANNELS; i++) {
+    channels[i] = grpc_secure_channel_create(st->creds, st->addr, st->args,
+                                             NULL);
+    grpc_channel_watch_connectivity_state(
+        channels[i], grpc_channel_check_connectivity_state(channels[i], 1),
+        deadline_after(30), cq, channels[i]);
+  }
+  while (st->num_ready < NUM_STORM_CHANNELS) {
+    grpc_event ev = grpc_completion_queue_next(cq, deadline_after(40), NULL);
+    grpc_channel *channel = ev.tag;
+    grpc_connectivity_state state;
+    GPR_ASSERT(ev.type == GRPC_OP_COMPLETE);
+    GPR_ASSERT(ev.success);
+    state = grpc_channel_check_connectivity_state(channel, 1);
+    if (state == GRPC_CHANNEL_READY) {
+      st->num_ready++;
+    } else {
+      grpc_channel_watch_connectivity_state(channel, state, deadline_after(30),
+                                            cq, channel);
+    }
+  }
+  gpr_atm_rel_store(&st->done, 1);
+
+  for (i = 0; i < NUM_STORM_CHANNELS; i++) {
+    grpc_channel_destroy(channels[i]);
+  }
+  grpc_completion_queue_shutdown(cq);
+  while (grpc_completion_queue_next(cq, gpr_inf_future(GPR_CLOCK_REALTIME),
+                                    NULL).type != GRPC_QUEUE_SHUTDOWN)
+    ;
+  grpc_completion_queue_destroy(cq);
+}
+
+static void log_latencies(const char *mode, const char *phase,
+                          gpr_histogram *h) {
+  gpr_log(GPR_INFO, "%s handshakes, %s: %d calls, p50 %.0fus, p99 %.0fus, "
+                    "max %.0fus",
+          mode, phase, (int)gpr_histogram_count(h),
+          gpr_histogram_percentile(h, 50), gpr_histogram_percentile(h, 99),
+          gpr_histogram_maximum(h));
+}
+
+static void run_storm(const char *mode) {
+  test_server s;
+  storm st;
+  grpc_channel *channel;
+  grpc_completion_queue *cq;
+  gpr_histogram *idle = gpr_histogram_create(0.01, 60e6);
+  gpr_histogram *busy = gpr_histogram_create(0.01, 60e6);
+  gpr_thd_options options = gpr_thd_options_default();
+  gpr_thd_id thd;
+  int port = grpc_pick_unused_port_or_die();
+  int i;
+
+  memset(&st, 0, sizeof(st));
+  gpr_join_host_port(&st.addr, "localhost", port);
+  st.creds = grpc_ssl_credentials_create(test_root_cert, NULL, NULL);
+  st.args = create_channel_args();
+  start_server(&s, st.addr);
+
+  cq = grpc_completion_queue_create(NULL);
+  channel = grpc_secure_channel_create(st.creds, st.addr, st.args, NULL);
+  do_call(channel, cq); /* connects the measured channel */
+  for (i = 0; i < NUM_IDLE_CALLS; i++) {
+    gpr_histogram_add(idle, do_call(channel, cq));
+  }
+
+  gpr_thd_options_set_joinable(&options);
+  GPR_ASSERT(gpr_thd_new(&thd, storm_thread, &st, &options));
+  while (!gpr_atm_acq_load(&st.done)) {
+    gpr_histogram_add(busy, do_call(channel, cq));
+  }
+  gpr_thd_join(thd);
+  GPR_ASSERT(st.num_ready == NUM_STORM_CHANNELS);
+
+  log_latencies(mode, "idle", idle);
+  log_latencies(mode, "connection storm", busy);
+
+  grpc_channel_destroy(channel);
+  grpc_completion_queue_shutdown(cq);
+  while (grpc_completion_queue_next(cq, gpr_inf_future(GPR_CLOCK_REALTIME),
+                                    NULL).type != GRPC_QUEUE_SHUTDOWN)
+    ;
+  grpc_completion_queue_destroy(cq);
+  stop_server(&s);
+  grpc_credentials_release(st.creds);
+  destroy_channel_args(st.args);
+  gpr_free(st.addr);
+  gpr_histogram_destroy(idle);
+  gpr_histogram_destroy(busy);
+}
+
+int main(int argc, char **argv) {
+  grpc_test_init(argc, argv);
+  grpc_init();
+  run_storm("inline");
+  grpc_security_set_handshake_offload(4, 1024);
+  run_storm("offloaded");
+  grpc_security_set_handshake_offload(0, 0);
+  grpc_shutdown();
+  return 0;
+}
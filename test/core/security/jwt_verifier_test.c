@@ -562,6 +562,65 @@ static void test_jwt_verifier_bad_format(void) {
   grpc_exec_ctx_finish(&exec_ctx);
 }
 
+static void on_verification_time_constraint_failure(
+    void *user_data, grpc_jwt_verifier_status status,
+    grpc_jwt_claims *claims) {
+  GPR_ASSERT(status == GRPC_JWT_VERIFIER_TIME_CONSTRAINT_FAILURE);
+  GPR_ASSERT(claims == NULL);
+  GPR_ASSERT(user_data == (void *)expected_user_data);
+}
+
+static void test_jwt_verifier_caches(void) {
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  grpc_jwt_verifier *verifier = grpc_jwt_verifier_create(NULL, 0);
+  gpr_timespec other_lifetime = {1800, 0, GPR_TIMESPAN};
+  gpr_timespec saved_clock_skew = grpc_jwt_verifier_clock_skew;
+  gpr_timespec future_clock_skew = {-7200, 0, GPR_TIMESPAN};
+  char *jwt = NULL;
+  char *other_jwt = NULL;
+  char *key_str = json_key_str(json_key_str_part3_for_url_issuer);
+  grpc_auth_json_key key = grpc_auth_json_key_create_from_string(key_str);
+  gpr_free(key_str);
+  GPR_ASSERT(grpc_auth_json_key_is_valid(&key));
+  jwt = grpc_jwt_encode_and_sign(&key, expected_audience, expected_lifetime,
+                                 NULL);
+  other_jwt =
+      grpc_jwt_encode_and_sign(&key, expected_audience, other_lifetime, NULL);
+  grpc_auth_json_key_destruct(&key);
+  GPR_ASSERT(jwt != NULL && other_jwt != NULL);
+
+  /* The first verification fetches the openid config and the keys. */
+  grpc_httpcli_set_override(httpcli_get_openid_config,
+                            httpcli_post_should_not_be_called);
+  grpc_jwt_verifier_verify(&exec_ctx, verifier, NULL, jwt, expected_audience,
+                           on_verification_success, (void *)expected_user_data);
+
+  /* The same token is then found in the token cache and another token of the
+     same issuer is checked with the cached keys. */
+  grpc_httpcli_set_override(httpcli_get_should_not_be_called,
+                            httpcli_post_should_not_be_called);
+  grpc_jwt_verifier_verify(&exec_ctx, verifier, NULL, jwt, expected_audience,
+                           on_verification_success, (void *)expected_user_data);
+  grpc_jwt_verifier_verify(&exec_ctx, verifier, NULL, other_jwt,
+                           expected_audience, on_verification_success,
+                           (void *)expected_user_data);
+
+  /* A cached token is not accepted past its expiration. */
+  grpc_jwt_verifier_clock_skew = future_clock_skew;
+  grpc_jwt_verifier_verify(&exec_ctx, verifier, NULL, jwt, expected_audience,
+                           on_verification_time_constraint_failure,
+                           (void *)expected_user_data);
+  grpc_jwt_verifier_clock_skew = saved_clock_skew;
+  grpc_jwt_verifier_verify(&exec_ctx, verifier, NULL, jwt, expected_audience,
+                           on_verification_success, (void *)expected_user_data);
+
+  gpr_free(jwt);
+  gpr_free(other_jwt);
+  grpc_jwt_verifier_destroy(verifier);
+  grpc_httpcli_set_override(NULL, NULL);
+  grpc_exec_ctx_finish(&exec_ctx);
+}
+
 /* find verification key: bad jks, cannot find key in jks */
 /* bad signature custom provided email*/
 /* bad key */
@@ -579,5 +638,6 @@ int main(int argc, char **argv) {
   test_jwt_verifier_bad_json_key();
   test_jwt_verifier_bad_signature();
   test_jwt_verifier_bad_format();
+  test_jwt_verifier_caches();
   return 0;
 }
@@ -0,0 +1,290 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+/* Measures the throughput of TLS protected bulk transfers between two secure
+   endpoints connected through a loopback socket pair.
+
+   The TLS handshake is done in memory, after which the server endpoint sends
+   --megabytes of data to the client in --write_size writes. Both endpoints are
+   driven from the same pollset, so the reported CPU time covers both the
+   encryption and the decryption side. */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <grpc/grpc.h>
+#include <grpc/support/cmdline.h>
+#include <grpc/support/log.h>
+#include <grpc/support/time.h>
+
+#include "src/core/iomgr/endpoint_pair.h"
+#include "src/core/security/secure_endpoint.h"
+#include "src/core/tsi/ssl_transport_security.h"
+#include "test/core/end2end/data/ssl_test_data.h"
+#include "test/core/util/test_config.h"
+
+#define BULK_SLICE_SIZE 65536
+
+typedef struct {
+  grpc_endpoint *read_ep;
+  grpc_endpoint *write_ep;
+  gpr_slice bulk_slice;
+  size_t target_bytes;
+  size_t bytes_written;
+  size_t bytes_read;
+  size_t write_size;
+  int read_done;
+  int write_done;
+  gpr_slice_buffer incoming;
+  gpr_slice_buffer outgoing;
+  grpc_closure done_read;
+  grpc_closure done_write;
+} transfer_state;
+
+static grpc_pollset g_pollset;
+
+/* Moves the pending handshake bytes of one side into the other. Returns the
+   number of bytes moved. */
+static size_t transfer_handshake_bytes(tsi_handshaker *from,
+                                       tsi_handshaker *to) {
+  unsigned char buf[4096];
+  size_t moved = 0;
+  for (;;) {
+    size_t buf_size = sizeof(buf);
+    size_t consumed;
+    tsi_result result =
+        tsi_handshaker_get_bytes_to_send_to_peer(from, buf, &buf_size);
+    GPR_ASSERT(result == TSI_OK || result == TSI_INCOMPLETE_DATA);
+    if (buf_size == 0) break;
+    consumed = buf_size;
+    result = tsi_handshaker_process_bytes_from_peer(to, buf, &consumed);
+    GPR_ASSERT(result == TSI_OK || result == TSI_INCOMPLETE_DATA);
+    GPR_ASSERT(consumed == buf_size);
+    moved += buf_size;
+  }
+  return moved;
+}
+
+static void create_protectors(tsi_frame_protector **client_protector,
+                              tsi_frame_protector **server_protector) {
+  static const unsigned char *alpn_protocol = (const unsigned char *)"h2";
+  static const unsigned char alpn_protocol_length = 2;
+  const unsigned char *key = (const unsigned char *)test_server1_key;
+  const unsigned char *cert = (const unsigned char *)test_server1_cert;
+  size_t key_size = strlen(test_server1_key);
+  size_t cert_size = strlen(test_server1_cert);
+  tsi_ssl_handshaker_factory *client_factory = NULL;
+  tsi_ssl_handshaker_factory *server_factory = NULL;
+  tsi_handshaker *client = NULL;
+  tsi_handshaker *server = NULL;
+
+  GPR_ASSERT(tsi_create_ssl_client_handshaker_factory(
+                 NULL, 0, NULL, 0, (const unsigned char *)test_root_cert,
+                 strlen(test_root_cert), NULL, &alpn_protocol,
+                 &alpn_protocol_length, 1, &client_factory) == TSI_OK);
+  GPR_ASSERT(tsi_create_ssl_server_handshaker_factory(
+                 &key, &key_size, &cert, &cert_size, 1, NULL, 0, 0, NULL,
+                 &alpn_protocol, &alpn_protocol_length, 1,
+                 &server_factory) == TSI_OK);
+  GPR_ASSERT(tsi_ssl_handshaker_factory_create_handshaker(
+                 client_factory, "foo.test.google.fr", &client) == TSI_OK);
+  GPR_ASSERT(tsi_ssl_handshaker_factory_create_handshaker(
+                 server_factory, NULL, &server) == TSI_OK);
+  while (tsi_handshaker_is_in_progress(client) ||
+         tsi_handshaker_is_in_progress(server)) {
+    size_t moved = transfer_handshake_bytes(client, server);
+    moved += transfer_handshake_bytes(server, client);
+    GPR_ASSERT(moved > 0);
+  }
+  GPR_ASSERT(tsi_handshaker_get_result(client) == TSI_OK);
+  GPR_ASSERT(tsi_handshaker_get_result(server) == TSI_OK);
+  GPR_ASSERT(tsi_handshaker_create_frame_protector(
+                 client, NULL, client_protector) == TSI_OK);
+  GPR_ASSERT(tsi_handshaker_create_frame_protector(
+                 server, NULL, server_protector) == TSI_OK);
+  tsi_handshaker_destroy(client);
+  tsi_handshaker_destroy(server);
+  tsi_ssl_handshaker_factory_destroy(client_factory);
+  tsi_ssl_handshaker_factory_destroy(server_factory);
+}
+
+static void mark_done(int *done) {
+  gpr_mu_lock(GRPC_POLLSET_MU(&g_pollset));
+  *done = 1;
+  grpc_pollset_kick(&g_pollset, NULL);
+  gpr_mu_unlock(GRPC_POLLSET_MU(&g_pollset));
+}
+
+static void on_read(grpc_exec_ctx *exec_ctx, void *arg, int success) {
+  transfer_state *state = arg;
+  GPR_ASSERT(success);
+  state->bytes_read += state->incoming.length;
+  gpr_slice_buffer_reset_and_unref(&state->incoming);
+  if (state->bytes_read >= state->target_bytes) {
+    mark_done(&state->read_done);
+    return;
+  }
+  grpc_endpoint_read(exec_ctx, state->read_ep, &state->incoming,
+                     &state->done_read);
+}
+
+static void on_write(grpc_exec_ctx *exec_ctx, void *arg, int success) {
+  transfer_state *state = arg;
+  size_t write_size = state->write_size;
+  GPR_ASSERT(success);
+  if (state->bytes_written >= state->target_bytes) {
+    mark_done(&state->write_done);
+    return;
+  }
+  if (write_size > state->target_bytes - state->bytes_written) {
+    write_size = state->target_bytes - state->bytes_written;
+  }
+  state->bytes_written += write_size;
+  gpr_slice_buffer_reset_and_unref(&state->outgoing);
+  while (write_size > 0) {
+    size_t n = write_size < BULK_SLICE_SIZE ? write_size : BULK_SLICE_SIZE;
+    gpr_slice_buffer_add(&state->outgoing,
+                         gpr_slice_sub(state->bulk_slice, 0, n));
+    write_size -= n;
+  }
+  grpc_endpoint_write(exec_ctx, state->write_ep, &state->outgoing,
+                      &state->done_write);
+}
+
+static void run_transfer(int megabytes, int write_size) {
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  tsi_frame_protector *client_protector;
+  tsi_frame_protector *server_protector;
+  grpc_endpoint_pair tcp;
+  transfer_state state;
+  gpr_timespec start;
+  gpr_timespec elapsed;
+  clock_t cpu_start;
+  double seconds;
+  double cpu_seconds;
+  double megabytes_moved;
+
+  create_protectors(&client_protector, &server_protector);
+  tcp = grpc_iomgr_create_endpoint_pair("secure_endpoint_benchmark",
+                                        BULK_SLICE_SIZE);
+  grpc_endpoint_add_to_pollset(&exec_ctx, tcp.client, &g_pollset);
+  grpc_endpoint_add_to_pollset(&exec_ctx, tcp.server, &g_pollset);
+
+  memset(&state, 0, sizeof(state));
+  state.read_ep =
+      grpc_secure_endpoint_create(client_protector, tcp.client, NULL, 0);
+  state.write_ep =
+      grpc_secure_endpoint_create(server_protector, tcp.server, NULL, 0);
+  state.bulk_slice = gpr_slice_malloc(BULK_SLICE_SIZE);
+  memset(GPR_SLICE_START_PTR(state.bulk_slice), 'a', BULK_SLICE_SIZE);
+  state.target_bytes = (size_t)megabytes * 1024 * 1024;
+  state.write_size = (size_t)write_size;
+  gpr_slice_buffer_init(&state.incoming);
+  gpr_slice_buffer_init(&state.outgoing);
+  grpc_closure_init(&state.done_read, on_read, &state);
+  grpc_closure_init(&state.done_write, on_write, &state);
+
+  start = gpr_now(GPR_CLOCK_MONOTONIC);
+  cpu_start = clock();
+  grpc_endpoint_read(&exec_ctx, state.read_ep, &state.incoming,
+                     &state.done_read);
+  on_write(&exec_ctx, &state, 1);
+  grpc_exec_ctx_finish(&exec_ctx);
+
+  gpr_mu_lock(GRPC_POLLSET_MU(&g_pollset));
+  while (!state.read_done || !state.write_done) {
+    grpc_pollset_worker worker;
+    grpc_pollset_work(&exec_ctx, &g_pollset, &worker,
+                      gpr_now(GPR_CLOCK_MONOTONIC),
+                      gpr_inf_future(GPR_CLOCK_MONOTONIC));
+  }
+  gpr_mu_unlock(GRPC_POLLSET_MU(&g_pollset));
+  grpc_exec_ctx_finish(&exec_ctx);
+  elapsed = gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), start);
+  cpu_seconds = (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+  seconds = (double)elapsed.tv_sec + 1e-9 * elapsed.tv_nsec;
+  megabytes_moved = (double)state.bytes_read / (1024.0 * 1024.0);
+
+  printf("write_size=%d: %.1f MB/s, %.1f MB/s per core\n", write_size,
+         megabytes_moved / seconds,
+         cpu_seconds > 0 ? megabytes_moved / cpu_seconds : 0.0);
+
+  gpr_slice_unref(state.bulk_slice);
+  gpr_slice_buffer_destroy(&state.incoming);
+  gpr_slice_buffer_destroy(&state.outgoing);
+  grpc_endpoint_destroy(&exec_ctx, state.read_ep);
+  grpc_endpoint_destroy(&exec_ctx, state.write_ep);
+  grpc_exec_ctx_finish(&exec_ctx);
+}
+
+static void destroy_pollset(grpc_exec_ctx *exec_ctx, void *p, int success) {
+  grpc_pollset_destroy(p);
+}
+
+int main(int argc, char **argv) {
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  grpc_closure destroyed;
+  int megabytes = 256;
+  int write_size = 0;
+  gpr_cmdline *cl;
+
+  grpc_test_init(argc, argv);
+
+  cl = gpr_cmdline_create("secure endpoint throughput benchmark");
+  gpr_cmdline_add_int(cl, "megabytes", "Megabytes transferred per run",
+                      &megabytes);
+  gpr_cmdline_add_int(cl, "write_size",
+                      "Bytes per endpoint write (0 for a sweep)", &write_size);
+  gpr_cmdline_parse(cl, argc, argv);
+  gpr_cmdline_destroy(cl);
+  GPR_ASSERT(megabytes > 0 && write_size >= 0);
+
+  grpc_init();
+  grpc_pollset_init(&g_pollset);
+
+  if (write_size > 0) {
+    run_transfer(megabytes, write_size);
+  } else {
+    for (write_size = 4096; write_size <= 4 * 1024 * 1024; write_size *= 4) {
+      run_transfer(megabytes, write_size);
+    }
+  }
+
+  grpc_closure_init(&destroyed, destroy_pollset, &g_pollset);
+  grpc_pollset_shutdown(&exec_ctx, &g_pollset, &destroyed);
+  grpc_exec_ctx_finish(&exec_ctx);
+  grpc_shutdown();
+  return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Measures census_log write throughput with several writers at once, in the
+   default per-core mode and in per-thread mode, while an exporter drains the
+   log concurrently. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/cmdline.h>
+#include <grpc/support/log.h>
+#include <grpc/support/sync.h>
+#include <grpc/support/thd.h>
+#include <grpc/support/time.h>
+
+#include "src/core/statistics/census_log.h"
+#include "test/core/util/test_config.h"
+
+typedef struct {
+  int records;
+  size_t record_size;
+  gpr_event *start;
+  int written;
+} writer_arg;
+
+static void writer_thread(void *p) {
+  writer_arg *arg = p;
+  int i;
+  gpr_event_wait(arg->start, gpr_inf_future(GPR_CLOCK_REALTIME));
+  for (i = 0; i < arg->records; i++) {
+    void *record = census_log_start_write(arg->record_size);
+    if (record != NULL) {
+      memset(record, i, arg->record_size);
+      census_log_end_write(record, arg->record_size);
+      arg->written++;
+    }
+  }
+  census_log_end_thread();
+}
+
+static void count_bytes(void *arg, const void *data, size_t size) {
+  *(size_t *)arg += size;
+}
+
+static void run(int per_thread, int threads, int records, size_t record_size,
+                int size_mb) {
+  gpr_thd_id *thds = gpr_malloc(sizeof(gpr_thd_id) * (size_t)threads);
+  writer_arg *args = gpr_malloc(sizeof(writer_arg) * (size_t)threads);
+  gpr_thd_options options = gpr_thd_options_default();
+  census_log_exporter *exporter;
+  size_t exported = 0;
+  gpr_event start;
+  gpr_timespec begin;
+  double elapsed_us;
+  int written = 0;
+  int i;
+
+  if (per_thread) {
+    census_log_initialize_per_thread((size_t)size_mb, 1);
+  } else {
+    census_log_initialize((size_t)size_mb, 1);
+  }
+  exporter = census_log_exporter_start(count_bytes, &exported,
+                                       gpr_time_from_millis(1, GPR_TIMESPAN));
+  gpr_event_init(&start);
+  gpr_thd_options_set_joinable(&options);
+  for (i = 0; i < threads; i++) {
+    args[i].records = records;
+    args[i].record_size = record_size;
+    args[i].start = &start;
+    args[i].written = 0;
+    GPR_ASSERT(gpr_thd_new(&thds[i], writer_thread, &args[i], &options));
+  }
+  begin = gpr_now(GPR_CLOCK_MONOTONIC);
+  gpr_event_set(&start, (void *)1);
+  for (i = 0; i < threads; i++) {
+    gpr_thd_join(thds[i]);
+    written += args[i].written;
+  }
+  elapsed_us = (double)gpr_timespec_to_micros(
+      gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), begin));
+  census_log_exporter_stop(exporter);
+  census_log_shutdown();
+
+  printf("%s threads=%d record_size=%d records/s=%.0f ns/record=%.1f "
+         "written=%d exported_bytes=%lu\n",
+         per_thread ? "per_thread" : "per_core", threads, (int)record_size,
+         written / elapsed_us * 1e6, elapsed_us * 1e3 / written, written,
+         (unsigned long)exported);
+
+  gpr_free(args);
+  gpr_free(thds);
+}
+
+int main(int argc, char **argv) {
+  int threads = 8;
+  int records = 1000000;
+  int record_size = 16;
+  int size_mb = 16;
+  gpr_cmdline *cl;
+
+  grpc_test_init(argc, argv);
+
+  cl = gpr_cmdline_create("census log benchmark");
+  gpr_cmdline_add_int(cl, "threads", "Number of writer threads", &threads);
+  gpr_cmdline_add_int(cl, "records", "Records per writer", &records);
+  gpr_cmdline_add_int(cl, "record_size", "Bytes per record", &record_size);
+  gpr_cmdline_add_int(cl, "size_mb", "Log size in MB", &size_mb);
+  gpr_cmdline_parse(cl, argc, argv);
+  gpr_cmdline_destroy(cl);
+  GPR_ASSERT(threads > 0 && records > 0 && record_size > 0 &&
+             record_size <= CENSUS_LOG_MAX_RECORD_SIZE);
+
+  run(0, threads, records, (size_t)record_size, size_mb);
+  run(1, threads, records, (size_t)record_size, size_mb);
+  return 0;
+}
@@ -202,7 +202,9 @@ static void writer_thread(void *arg) {
       gpr_sleep_until(GRPC_TIMEOUT_MILLIS_TO_DEADLINE(10));
     }
   }
-  /* Done. Decrement count and signal. */
+  /* Done; a no-op unless the log is in per-thread mode. */
+  census_log_end_thread();
+  /* Decrement count and signal. */
   gpr_mu_lock(args->mu);
   (*args->count)--;
   gpr_cv_broadcast(args->done);
@@ -589,3 +591,99 @@ void test_performance(void) {
         (write_size * nrecords) / write_time_micro / 1000);
   }
 }
+
+/* Fills per-thread logs, circular and not, with records that may straddle
+   the end of a block. */
+void test_fill_log_per_thread(void) {
+  int circular;
+  printf("Starting test: fill log per thread\n");
+  for (circular = 0; circular <= 1; circular++) {
+    census_log_initialize_per_thread(LOG_SIZE_IN_MB, circular);
+    GPR_ASSERT(census_log_remaining_space() == LOG_SIZE_IN_BYTES);
+    fill_log(LOG_SIZE_IN_BYTES, 0 /* block straddling records */, circular);
+    census_log_end_thread();
+    census_log_shutdown();
+  }
+}
+
+/* Multiple writers and a single reader on a per-thread log that keeps old
+   records. */
+void test_multiple_writers_per_thread(void) {
+  const int circular = 0;
+  printf("Starting test: multiple writers per thread\n");
+  census_log_initialize_per_thread(LOG_SIZE_IN_MB, circular);
+  multiple_writers_single_reader(circular);
+  census_log_shutdown();
+}
+
+typedef struct export_state {
+  size_t record_size;
+  gpr_int32 records;
+} export_state;
+
+static void count_exported_records(void *arg, const void *data, size_t size) {
+  export_state *state = arg;
+  gpr_int32 num_records;
+  read_records(state->record_size, data, size, &num_records);
+  state->records += num_records;
+}
+
+/* Writers fill a small log many times over while an exporter drains it. */
+void test_exporter(void) {
+  static const gpr_int32 EXPORT_RECORD_SIZE = 16;
+  static const gpr_int32 EXPORT_RECORDS_PER_WRITER = 100000;
+  int ix;
+  gpr_thd_id id;
+  gpr_cv writers_done;
+  int writers_count = NUM_WRITERS;
+  gpr_mu writers_mu;
+  writer_thread_args writers[NUM_WRITERS];
+  export_state state;
+  census_log_exporter *exporter;
+  FILE *file;
+  void *record;
+  printf("Starting test: exporter\n");
+  census_log_initialize_per_thread(LOG_SIZE_IN_MB, 0);
+  state.record_size = EXPORT_RECORD_SIZE;
+  state.records = 0;
+  exporter = census_log_exporter_start(count_exported_records, &state,
+                                       gpr_time_from_millis(1, GPR_TIMESPAN));
+  gpr_cv_init(&writers_done);
+  gpr_mu_init(&writers_mu);
+  for (ix = 0; ix < NUM_WRITERS; ++ix) {
+    writers[ix].index = ix;
+    writers[ix].record_size = EXPORT_RECORD_SIZE;
+    writers[ix].num_records = EXPORT_RECORDS_PER_WRITER;
+    writers[ix].done = &writers_done;
+    writers[ix].count = &writers_count;
+    writers[ix].mu = &writers_mu;
+    gpr_thd_new(&id, &writer_thread, &writers[ix], NULL);
+  }
+  gpr_mu_lock(&writers_mu);
+  while (writers_count != 0) {
+    gpr_cv_wait(&writers_done, &writers_mu, gpr_inf_future(GPR_CLOCK_REALTIME));
+  }
+  gpr_mu_unlock(&writers_mu);
+  gpr_mu_destroy(&writers_mu);
+  gpr_cv_destroy(&writers_done);
+  census_log_exporter_stop(exporter);
+  GPR_ASSERT(state.records == NUM_WRITERS * EXPORT_RECORDS_PER_WRITER);
+  assert_log_empty();
+
+  /* Export to a file. */
+  file = tmpfile();
+  GPR_ASSERT(file != NULL);
+  exporter = census_log_exporter_start(census_log_export_to_file, file,
+                                       gpr_time_from_millis(1, GPR_TIMESPAN));
+  for (ix = 0; ix < 1000; ++ix) {
+    record = census_log_start_write((size_t)EXPORT_RECORD_SIZE);
+    GPR_ASSERT(record != NULL);
+    write_record(record, (size_t)EXPORT_RECORD_SIZE);
+    census_log_end_write(record, (size_t)EXPORT_RECORD_SIZE);
+  }
+  census_log_exporter_stop(exporter);
+  GPR_ASSERT(ftell(file) == 1000 * EXPORT_RECORD_SIZE);
+  fclose(file);
+  census_log_end_thread();
+  census_log_shutdown();
+}
@@ -47,5 +47,8 @@ void test_multiple_writers_circular_log();
 void test_multiple_writers();
 void test_performance();
 void test_small_log();
+void test_fill_log_per_thread();
+void test_multiple_writers_per_thread();
+void test_exporter();
 
 #endif /* GRPC_TEST_CORE_STATISTICS_CENSUS_LOG_TESTS_H */
@@ -50,5 +50,7 @@ int main(int argc, char **argv) {
   test_fill_circular_log_no_fragmentation();
   test_fill_log_with_straddling_records();
   test_fill_circular_log_with_straddling_records();
+  test_fill_log_per_thread();
+  test_exporter();
   return 0;
 }
@@ -0,0 +1,154 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Measures the cost of recording census rpc stats from many threads at
+   once, through both the op_id interface (trace store lookup plus method
+   name lookup) and the registered method id interface. */
+
+#include <stdio.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/cmdline.h>
+#include <grpc/support/log.h>
+#include <grpc/support/string_util.h>
+#include <grpc/support/sync.h>
+#include <grpc/support/thd.h>
+#include <grpc/support/time.h>
+#include <grpc/support/useful.h>
+
+#include "src/core/statistics/census_interface.h"
+#include "src/core/statistics/census_rpc_stats.h"
+#include "src/core/statistics/census_tracing.h"
+#include "test/core/util/test_config.h"
+
+typedef struct {
+  int by_id;
+  int method_id;
+  int records;
+  gpr_event *start;
+} thread_arg;
+
+static void record_thread(void *p) {
+  thread_arg *arg = p;
+  census_rpc_stats stats = {1, 0, 0, 1.5, 100, 120, 200, 230};
+  census_op_id op_id = {0, 0};
+  char *method;
+  int i;
+  if (!arg->by_id) {
+    gpr_asprintf(&method, "/bench.Service/Method%d", arg->method_id);
+    op_id = census_tracing_start_op();
+    census_add_method_tag(op_id, method);
+    gpr_free(method);
+  }
+  gpr_event_wait(arg->start, gpr_inf_future(GPR_CLOCK_REALTIME));
+  for (i = 0; i < arg->records; i++) {
+    if (arg->by_id) {
+      census_record_rpc_server_stats_by_id(arg->method_id, &stats);
+    } else {
+      census_record_rpc_server_stats(op_id, &stats);
+    }
+  }
+  if (!arg->by_id) {
+    census_tracing_end_op(op_id);
+  }
+}
+
+static void run(int by_id, int threads, int methods, int records) {
+  gpr_thd_id *thds = gpr_malloc(sizeof(gpr_thd_id) * (size_t)threads);
+  thread_arg *args = gpr_malloc(sizeof(thread_arg) * (size_t)threads);
+  gpr_thd_options options = gpr_thd_options_default();
+  census_aggregated_rpc_stats agg_stats = {0, NULL};
+  gpr_event start;
+  gpr_timespec begin;
+  double elapsed_ns;
+  char *method;
+  int i;
+
+  census_init();
+  gpr_event_init(&start);
+  gpr_thd_options_set_joinable(&options);
+  for (i = 0; i < threads; i++) {
+    args[i].by_id = by_id;
+    args[i].method_id = i % methods;
+    args[i].records = records;
+    args[i].start = &start;
+    if (by_id) {
+      gpr_asprintf(&method, "/bench.Service/Method%d", i % methods);
+      args[i].method_id = census_register_rpc_method(method);
+      gpr_free(method);
+    }
+    GPR_ASSERT(gpr_thd_new(&thds[i], record_thread, &args[i], &options));
+  }
+  begin = gpr_now(GPR_CLOCK_MONOTONIC);
+  gpr_event_set(&start, (void *)1);
+  for (i = 0; i < threads; i++) {
+    gpr_thd_join(thds[i]);
+  }
+  elapsed_ns = gpr_timespec_to_micros(
+                   gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), begin)) *
+               1e3;
+
+  census_get_server_stats(&agg_stats);
+  GPR_ASSERT(agg_stats.num_entries == GPR_MIN(threads, methods));
+  census_aggregated_rpc_stats_set_empty(&agg_stats);
+  census_shutdown();
+
+  printf("%s threads=%d methods=%d records/s=%.0f ns/record=%.1f\n",
+         by_id ? "by_id" : "by_op_id", threads, methods,
+         (double)threads * records / elapsed_ns * 1e9,
+         elapsed_ns / threads / records);
+
+  gpr_free(args);
+  gpr_free(thds);
+}
+
+int main(int argc, char **argv) {
+  int threads = 32;
+  int methods = 16;
+  int records = 100000;
+  gpr_cmdline *cl;
+
+  grpc_test_init(argc, argv);
+
+  cl = gpr_cmdline_create("census rpc stats benchmark");
+  gpr_cmdline_add_int(cl, "threads", "Number of recording threads", &threads);
+  gpr_cmdline_add_int(cl, "methods", "Number of distinct methods", &methods);
+  gpr_cmdline_add_int(cl, "records", "Records per thread", &records);
+  gpr_cmdline_parse(cl, argc, argv);
+  gpr_cmdline_destroy(cl);
+  GPR_ASSERT(threads > 0 && methods > 0 && records > 0);
+
+  run(0, threads, methods, records);
+  run(1, threads, methods, records);
+  return 0;
+}
@@ -39,7 +39,8 @@
 #include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
 #include <grpc/support/port_platform.h>
-#include <grpc/support/string.h>
+#include <grpc/support/string_util.h>
+#include <grpc/support/sync.h>
 #include <grpc/support/thd.h>
 #include <grpc/support/time.h>
 #include "test/core/util/test_config.h"
@@ -187,6 +188,118 @@ static void test_record_stats_with_trace_store_uninitialized(void) {
   census_stats_store_shutdown();
 }
 
+/* Test recording by registered method id, from several threads at once. */
+#define NUM_RECORDING_THREADS 8
+#define RECORDS_PER_THREAD 10000
+
+static void record_by_id_thread(void *arg) {
+  int id = *(int *)arg;
+  census_rpc_stats stats = {1, 0, 0, 1, 0, 0, 0, 1};
+  int i;
+  for (i = 0; i < RECORDS_PER_THREAD; i++) {
+    census_record_rpc_server_stats_by_id(id, &stats);
+  }
+}
+
+static void test_record_stats_by_method_id(void) {
+  census_rpc_stats stats = {1, 2, 3, 4, 5.1, 6.2, 7.3, 8.4};
+  census_aggregated_rpc_stats agg_stats = {0, NULL};
+  gpr_thd_id thds[NUM_RECORDING_THREADS];
+  gpr_thd_options options = gpr_thd_options_default();
+  int id;
+  int i;
+
+  /* Nothing to register with before init. */
+  GPR_ASSERT(census_register_rpc_method("m") == -1);
+  census_init();
+  id = census_register_rpc_method("m");
+  GPR_ASSERT(id >= 0);
+  GPR_ASSERT(census_register_rpc_method("m") == id);
+  GPR_ASSERT(census_register_rpc_method("n") != id);
+  /* Unknown ids are ignored. */
+  census_record_rpc_client_stats_by_id(-1, &stats);
+  census_record_rpc_client_stats_by_id(id + 2, &stats);
+  census_get_client_stats(&agg_stats);
+  GPR_ASSERT(agg_stats.num_entries == 0);
+
+  gpr_thd_options_set_joinable(&options);
+  for (i = 0; i < NUM_RECORDING_THREADS; i++) {
+    GPR_ASSERT(gpr_thd_new(&thds[i], record_by_id_thread, &id, &options));
+  }
+  for (i = 0; i < NUM_RECORDING_THREADS; i++) {
+    gpr_thd_join(thds[i]);
+  }
+  census_get_server_stats(&agg_stats);
+  GPR_ASSERT(agg_stats.num_entries == 1);
+  GPR_ASSERT(strcmp(agg_stats.stats[0].method, "m") == 0);
+  GPR_ASSERT(agg_stats.stats[0].minute_stats.cnt ==
+                 NUM_RECORDING_THREADS * RECORDS_PER_THREAD &&
+             agg_stats.stats[0].total_stats.cnt ==
+                 NUM_RECORDING_THREADS * RECORDS_PER_THREAD);
+  ASSERT_NEAR(agg_stats.stats[0].total_stats.wire_response_bytes,
+              (double)(NUM_RECORDING_THREADS * RECORDS_PER_THREAD));
+  census_aggregated_rpc_stats_set_empty(&agg_stats);
+
+  /* The op_id interface records against the same registry. */
+  census_record_rpc_client_stats_by_id(id, &stats);
+  census_get_client_stats(&agg_stats);
+  GPR_ASSERT(agg_stats.num_entries == 1);
+  GPR_ASSERT(agg_stats.stats[0].total_stats.app_error_cnt == 3);
+  census_aggregated_rpc_stats_set_empty(&agg_stats);
+  census_shutdown();
+
+  /* Ids don't survive shutdown. */
+  census_init();
+  census_record_rpc_server_stats_by_id(id, &stats);
+  census_get_server_stats(&agg_stats);
+  GPR_ASSERT(agg_stats.num_entries == 0);
+  census_shutdown();
+}
+
+/* Test that shutting the store down under concurrent recorders is safe. */
+typedef struct {
+  int id;
+  gpr_event *stop;
+} racing_recorder_arg;
+
+static void racing_recorder_thread(void *arg) {
+  racing_recorder_arg *a = arg;
+  census_rpc_stats stats = {1, 0, 0, 1, 0, 0, 0, 1};
+  while (gpr_event_get(a->stop) == NULL) {
+    census_record_rpc_client_stats_by_id(a->id, &stats);
+  }
+}
+
+static void test_shutdown_while_recording(void) {
+  census_aggregated_rpc_stats agg_stats = {0, NULL};
+  gpr_thd_id thds[NUM_RECORDING_THREADS];
+  gpr_thd_options options = gpr_thd_options_default();
+  gpr_event stop;
+  racing_recorder_arg arg;
+  int i;
+
+  census_init();
+  gpr_event_init(&stop);
+  arg.id = census_register_rpc_method("m");
+  arg.stop = &stop;
+  gpr_thd_options_set_joinable(&options);
+  for (i = 0; i < NUM_RECORDING_THREADS; i++) {
+    GPR_ASSERT(gpr_thd_new(&thds[i], racing_recorder_thread, &arg, &options));
+  }
+  gpr_sleep_until(GRPC_TIMEOUT_MILLIS_TO_DEADLINE(100));
+  census_stats_store_shutdown();
+  census_stats_store_init();
+  gpr_sleep_until(GRPC_TIMEOUT_MILLIS_TO_DEADLINE(100));
+  gpr_event_set(&stop, (void *)1);
+  for (i = 0; i < NUM_RECORDING_THREADS; i++) {
+    gpr_thd_join(thds[i]);
+  }
+  /* Nothing recorded with the old id reaches the new store. */
+  census_get_client_stats(&agg_stats);
+  GPR_ASSERT(agg_stats.num_entries == 0);
+  census_shutdown();
+}
+
 int main(int argc, char **argv) {
   grpc_test_init(argc, argv);
   test_init_shutdown();
@@ -194,5 +307,7 @@ int main(int argc, char **argv) {
   test_record_and_get_stats();
   test_record_stats_on_unknown_op_id();
   test_record_stats_with_trace_store_uninitialized();
+  test_record_stats_by_method_id();
+  test_shutdown_while_recording();
   return 0;
 }
@@ -0,0 +1,332 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <grpc/support/hdr_histogram.h>
+
+#include <stdlib.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/log.h>
+#include <grpc/support/sync.h>
+#include <grpc/support/thd.h>
+#include "test/core/util/test_config.h"
+
+#define LOG_TEST(x) gpr_log(GPR_INFO, "%s", x);
+
+#define NUM_THREADS 8
+#define VALUES_PER_THREAD 100000
+
+static void test_no_op(void) {
+  gpr_hdr_histogram_destroy(gpr_hdr_histogram_create(3600000000, 3));
+}
+
+static void expect_percentile(gpr_hdr_histogram *h, double percentile,
+                              gpr_int64 min_expect, gpr_int64 max_expect) {
+  gpr_int64 got = gpr_hdr_histogram_value_at_percentile(h, percentile);
+  gpr_log(GPR_INFO, "@%f%%, expect %lld <= %lld <= %lld", percentile,
+          (long long)min_expect, (long long)got, (long long)max_expect);
+  GPR_ASSERT(min_expect <= got);
+  GPR_ASSERT(got <= max_expect);
+}
+
+static void test_simple(void) {
+  gpr_hdr_histogram *h;
+
+  LOG_TEST("test_simple");
+
+  h = gpr_hdr_histogram_create(3600000000, 3);
+  gpr_hdr_histogram_record(h, 10000);
+  gpr_hdr_histogram_record(h, 10000);
+  gpr_hdr_histogram_record(h, 11000);
+  gpr_hdr_histogram_record(h, 11000);
+
+  GPR_ASSERT(gpr_hdr_histogram_count(h) == 4);
+  expect_percentile(h, 50, 10000, 10010);
+  expect_percentile(h, 100, 11000, 11010);
+  GPR_ASSERT(gpr_hdr_histogram_min(h) == 10000);
+  GPR_ASSERT(gpr_hdr_histogram_max(h) >= 11000);
+  GPR_ASSERT(gpr_hdr_histogram_max(h) <= 11010);
+  GPR_ASSERT(gpr_hdr_histogram_mean(h) >= 10500);
+  GPR_ASSERT(gpr_hdr_histogram_mean(h) <= 10510);
+
+  gpr_hdr_histogram_destroy(h);
+}
+
+/* every value must be preserved to the requested number of significant
+   digits, across the whole trackable range */
+static void test_precision(void) {
+  gpr_hdr_histogram *h;
+  gpr_int64 value;
+  gpr_int64 got;
+  int digits;
+
+  LOG_TEST("test_precision");
+
+  for (digits = 1; digits <= 5; digits++) {
+    gpr_int64 scale = 1;
+    int i;
+    for (i = 0; i < digits; i++) scale *= 10;
+    h = gpr_hdr_histogram_create(1000000000000, digits);
+    for (value = 1; value <= 1000000000000; value = value * 3 + 1) {
+      gpr_hdr_histogram_reset(h);
+      gpr_hdr_histogram_record(h, value);
+      got = gpr_hdr_histogram_value_at_percentile(h, 50);
+      GPR_ASSERT(got >= value);
+      GPR_ASSERT((got - value) * scale <= value);
+      GPR_ASSERT(gpr_hdr_histogram_min(h) <= value);
+      GPR_ASSERT((value - gpr_hdr_histogram_min(h)) * scale <= value);
+    }
+    gpr_hdr_histogram_destroy(h);
+  }
+}
+
+static void test_percentile(void) {
+  gpr_hdr_histogram *h;
+  gpr_int64 last;
+  gpr_int64 cur;
+  gpr_int64 i;
+  double p;
+
+  LOG_TEST("test_percentile");
+
+  h = gpr_hdr_histogram_create(1000000, 2);
+  for (i = 1; i <= 100; i++) {
+    gpr_hdr_histogram_record(h, i);
+  }
+
+  expect_percentile(h, -10, 1, 1);
+  expect_percentile(h, 0, 1, 1);
+  expect_percentile(h, 25, 25, 25);
+  expect_percentile(h, 50, 50, 50);
+  expect_percentile(h, 99, 99, 99);
+  expect_percentile(h, 100, 100, 100);
+  expect_percentile(h, 110, 100, 100);
+  GPR_ASSERT(gpr_hdr_histogram_mean(h) == 50.5);
+
+  /* out of range values are clamped */
+  gpr_hdr_histogram_record(h, -5);
+  gpr_hdr_histogram_record(h, 1000000000);
+  GPR_ASSERT(gpr_hdr_histogram_count(h) == 102);
+  GPR_ASSERT(gpr_hdr_histogram_min(h) == 0);
+  GPR_ASSERT(gpr_hdr_histogram_max(h) == 1000000);
+
+  /* test monotonicity */
+  last = 0;
+  for (p = 0; p < 100.0; p += 0.01) {
+    cur = gpr_hdr_histogram_value_at_percentile(h, p);
+    GPR_ASSERT(cur >= last);
+    last = cur;
+  }
+
+  gpr_hdr_histogram_destroy(h);
+}
+
+static void test_record_corrected(void) {
+  gpr_hdr_histogram *h;
+
+  LOG_TEST("test_record_corrected");
+
+  h = gpr_hdr_histogram_create(1000000, 3);
+  /* one 1000 unit stall at an expected interval of 100 hides nine requests
+     that would have seen 900, 800, ... 100 */
+  gpr_hdr_histogram_record_corrected(h, 1000, 100);
+  GPR_ASSERT(gpr_hdr_histogram_count(h) == 10);
+  GPR_ASSERT(gpr_hdr_histogram_min(h) == 100);
+  GPR_ASSERT(gpr_hdr_histogram_max(h) == 1000);
+  expect_percentile(h, 50, 500, 500);
+
+  /* values at or below the interval need no correction */
+  gpr_hdr_histogram_reset(h);
+  gpr_hdr_histogram_record_corrected(h, 100, 100);
+  gpr_hdr_histogram_record_corrected(h, 50, 100);
+  gpr_hdr_histogram_record_corrected(h, 5000, 0);
+  GPR_ASSERT(gpr_hdr_histogram_count(h) == 3);
+
+  gpr_hdr_histogram_destroy(h);
+}
+
+static void test_merge(void) {
+  gpr_hdr_histogram *h1, *h2;
+  gpr_uint32 *contents;
+  size_t i;
+
+  LOG_TEST("test_merge");
+
+  h1 = gpr_hdr_histogram_create(1000000000, 3);
+  gpr_hdr_histogram_record(h1, 3);
+  gpr_hdr_histogram_record(h1, 8);
+  gpr_hdr_histogram_record_n(h1, 5000, 2);
+
+  h2 = gpr_hdr_histogram_create(1000000000, 2);
+  GPR_ASSERT(gpr_hdr_histogram_merge(h1, h2) == 0);
+  gpr_hdr_histogram_destroy(h2);
+
+  h2 = gpr_hdr_histogram_create(10000000000, 3);
+  GPR_ASSERT(gpr_hdr_histogram_merge(h1, h2) == 0);
+  gpr_hdr_histogram_destroy(h2);
+
+  h2 = gpr_hdr_histogram_create(1000000000, 3);
+  GPR_ASSERT(gpr_hdr_histogram_merge(h1, h2) == 1);
+  GPR_ASSERT(gpr_hdr_histogram_count(h1) == 4);
+  gpr_hdr_histogram_record(h2, 1);
+  gpr_hdr_histogram_record(h2, 900000000);
+  GPR_ASSERT(gpr_hdr_histogram_merge(h1, h2) == 1);
+  GPR_ASSERT(gpr_hdr_histogram_count(h1) == 6);
+  GPR_ASSERT(gpr_hdr_histogram_min(h1) == 1);
+  GPR_ASSERT(gpr_hdr_histogram_max(h1) >= 900000000);
+  GPR_ASSERT(gpr_hdr_histogram_max(h1) <= 900000000 + 900000);
+  expect_percentile(h1, 50, 8, 8);
+
+  /* round trip through the raw bucket counts */
+  GPR_ASSERT(gpr_hdr_histogram_num_buckets(h1) ==
+             gpr_hdr_histogram_num_buckets(h2));
+  contents = gpr_malloc(sizeof(gpr_uint32) *
+                        gpr_hdr_histogram_num_buckets(h1));
+  for (i = 0; i < gpr_hdr_histogram_num_buckets(h1); i++) {
+    contents[i] = (gpr_uint32)gpr_hdr_histogram_count_at_index(h1, i);
+  }
+  gpr_hdr_histogram_reset(h2);
+  GPR_ASSERT(gpr_hdr_histogram_merge_contents(h2, contents, 3) == 0);
+  GPR_ASSERT(gpr_hdr_histogram_merge_contents(
+                 h2, contents, gpr_hdr_histogram_num_buckets(h1)) == 1);
+  for (i = 0; i < gpr_hdr_histogram_num_buckets(h1); i++) {
+    GPR_ASSERT(gpr_hdr_histogram_count_at_index(h1, i) ==
+               gpr_hdr_histogram_count_at_index(h2, i));
+  }
+  gpr_free(contents);
+
+  gpr_hdr_histogram_destroy(h1);
+  gpr_hdr_histogram_destroy(h2);
+}
+
+typedef struct {
+  gpr_hdr_histogram *h;
+  gpr_int64 first_value;
+} writer_arg;
+
+static void writer_thread(void *arg) {
+  writer_arg *w = arg;
+  gpr_int64 i;
+  for (i = 0; i < VALUES_PER_THREAD; i++) {
+    gpr_hdr_histogram_record(w->h, w->first_value + i);
+  }
+}
+
+static void start_writers(gpr_hdr_histogram *h, gpr_thd_id *threads,
+                          writer_arg *args) {
+  gpr_thd_options options = gpr_thd_options_default();
+  int i;
+  gpr_thd_options_set_joinable(&options);
+  for (i = 0; i < NUM_THREADS; i++) {
+    args[i].h = h;
+    args[i].first_value = (gpr_int64)i * VALUES_PER_THREAD;
+    GPR_ASSERT(gpr_thd_new(&threads[i], writer_thread, &args[i], &options));
+  }
+}
+
+static void join_writers(gpr_thd_id *threads) {
+  int i;
+  for (i = 0; i < NUM_THREADS; i++) {
+    gpr_thd_join(threads[i]);
+  }
+}
+
+/* concurrent writers into one histogram lose nothing */
+static void test_concurrent_record(void) {
+  gpr_hdr_histogram *h;
+  gpr_thd_id threads[NUM_THREADS];
+  writer_arg args[NUM_THREADS];
+
+  LOG_TEST("test_concurrent_record");
+
+  h = gpr_hdr_histogram_create(1000000000, 3);
+  start_writers(h, threads, args);
+  join_writers(threads);
+  GPR_ASSERT(gpr_hdr_histogram_count(h) ==
+             (gpr_int64)NUM_THREADS * VALUES_PER_THREAD);
+  GPR_ASSERT(gpr_hdr_histogram_min(h) == 0);
+  expect_percentile(h, 50, NUM_THREADS * VALUES_PER_THREAD / 2,
+                    NUM_THREADS * VALUES_PER_THREAD / 2 + 500);
+  gpr_hdr_histogram_destroy(h);
+}
+
+/* snapshots taken while writers are running partition the recorded values:
+   every value lands in exactly one snapshot */
+static void test_snapshot_while_recording(void) {
+  gpr_hdr_histogram *h;
+  gpr_hdr_histogram *snapshot;
+  gpr_hdr_histogram *total;
+  gpr_thd_id threads[NUM_THREADS];
+  writer_arg args[NUM_THREADS];
+  int snapshots = 0;
+
+  LOG_TEST("test_snapshot_while_recording");
+
+  h = gpr_hdr_histogram_create(1000000000, 3);
+  snapshot = gpr_hdr_histogram_create(1000000000, 3);
+  total = gpr_hdr_histogram_create(1000000000, 3);
+  start_writers(h, threads, args);
+  while (gpr_hdr_histogram_count(total) <
+         (gpr_int64)NUM_THREADS * VALUES_PER_THREAD) {
+    GPR_ASSERT(gpr_hdr_histogram_snapshot_and_reset(h, snapshot));
+    GPR_ASSERT(gpr_hdr_histogram_merge(total, snapshot));
+    gpr_hdr_histogram_reset(snapshot);
+    snapshots++;
+  }
+  join_writers(threads);
+  gpr_log(GPR_INFO, "took %d snapshots", snapshots);
+  GPR_ASSERT(gpr_hdr_histogram_count(total) ==
+             (gpr_int64)NUM_THREADS * VALUES_PER_THREAD);
+  GPR_ASSERT(gpr_hdr_histogram_count(h) == 0);
+  gpr_hdr_histogram_destroy(snapshot);
+
+  snapshot = gpr_hdr_histogram_create(1000, 3);
+  GPR_ASSERT(gpr_hdr_histogram_snapshot_and_reset(h, snapshot) == 0);
+
+  gpr_hdr_histogram_destroy(h);
+  gpr_hdr_histogram_destroy(snapshot);
+  gpr_hdr_histogram_destroy(total);
+}
+
+int main(int argc, char **argv) {
+  grpc_test_init(argc, argv);
+  test_no_op();
+  test_simple();
+  test_precision();
+  test_percentile();
+  test_record_corrected();
+  test_merge();
+  test_concurrent_record();
+  test_snapshot_while_recording();
+  return 0;
+}
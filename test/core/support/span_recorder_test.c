@@ -0,0 +1,185 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <grpc/support/span_recorder.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/log.h>
+#include <grpc/support/slice.h>
+#include <grpc/support/string_util.h>
+#include <grpc/support/thd.h>
+#include "src/core/support/file.h"
+#include "test/core/util/test_config.h"
+
+#define LOG_TEST_NAME(x) gpr_log(GPR_INFO, "%s", x)
+
+#define NUM_THREADS 4
+#define SPANS_PER_THREAD 1000
+/* More than the recorder has rings. */
+#define SHORT_LIVED_THREADS 300
+
+static void record_spans(void *arg) {
+  gpr_uintptr call_id = (gpr_uintptr)arg;
+  int i;
+  for (i = 0; i < SPANS_PER_THREAD; i++) {
+    gpr_uint64 start = gpr_span_clock_now();
+    GPR_SPAN("span_recorder_test: \"quoted\"", start, gpr_span_clock_now(),
+             call_id);
+  }
+}
+
+static void record_from_threads(void) {
+  gpr_thd_options options = gpr_thd_options_default();
+  gpr_thd_id threads[NUM_THREADS];
+  gpr_uintptr i;
+  gpr_thd_options_set_joinable(&options);
+  for (i = 0; i < NUM_THREADS; i++) {
+    GPR_ASSERT(gpr_thd_new(&threads[i], record_spans, (void *)(i + 1),
+                           &options));
+  }
+  for (i = 0; i < NUM_THREADS; i++) {
+    gpr_thd_join(threads[i]);
+  }
+}
+
+/* Exports the recorded spans and returns the trace, to be freed by the
+   caller. */
+static char *export_trace(void) {
+  char *filename;
+  char *trace;
+  gpr_slice contents;
+  FILE *f = gpr_tmpfile("span_recorder_test", &filename);
+  GPR_ASSERT(f != NULL);
+  fclose(f);
+  GPR_ASSERT(gpr_span_recorder_export_chrome_trace(filename));
+  contents = gpr_load_file(filename, 1, NULL);
+  trace = gpr_strdup((const char *)GPR_SLICE_START_PTR(contents));
+  gpr_slice_unref(contents);
+  remove(filename);
+  gpr_free(filename);
+  return trace;
+}
+
+static size_t count_occurrences(const char *s, const char *needle) {
+  size_t n = 0;
+  while ((s = strstr(s, needle)) != NULL) {
+    n++;
+    s += strlen(needle);
+  }
+  return n;
+}
+
+static void test_records_all_threads(void) {
+  char *trace;
+  LOG_TEST_NAME("test_records_all_threads");
+  gpr_span_recorder_start(NUM_THREADS * SPANS_PER_THREAD);
+  record_from_threads();
+  gpr_span_recorder_stop();
+  trace = export_trace();
+  GPR_ASSERT(count_occurrences(trace, "\"ph\":\"X\"") ==
+             NUM_THREADS * SPANS_PER_THREAD);
+  GPR_ASSERT(count_occurrences(trace, "span_recorder_test: \\\"quoted\\\"") ==
+             NUM_THREADS * SPANS_PER_THREAD);
+  GPR_ASSERT(count_occurrences(trace, "\"call\":\"0x1\"") ==
+             SPANS_PER_THREAD);
+  GPR_ASSERT(count_occurrences(trace, "\"call\":\"0x4\"") ==
+             SPANS_PER_THREAD);
+  GPR_ASSERT(strstr(trace, "\"overwritten_spans\":\"0\"") != NULL);
+  gpr_free(trace);
+
+  /* The log was cleared by the export. */
+  trace = export_trace();
+  GPR_ASSERT(count_occurrences(trace, "\"ph\":\"X\"") == 0);
+  gpr_free(trace);
+}
+
+static void test_keeps_most_recent_spans(void) {
+  char *trace;
+  LOG_TEST_NAME("test_keeps_most_recent_spans");
+  gpr_span_recorder_start(100);
+  record_from_threads();
+  gpr_span_recorder_stop();
+  trace = export_trace();
+  GPR_ASSERT(count_occurrences(trace, "\"ph\":\"X\"") == 100);
+  GPR_ASSERT(strstr(trace, "\"overwritten_spans\":\"3900\"") != NULL);
+  gpr_free(trace);
+}
+
+static void record_span(void *arg) {
+  gpr_uint64 start = gpr_span_clock_now();
+  GPR_SPAN("span_recorder_test: short lived", start, gpr_span_clock_now(),
+           arg);
+}
+
+static void test_records_short_lived_threads(void) {
+  gpr_thd_options options = gpr_thd_options_default();
+  gpr_thd_id thread;
+  char *trace;
+  int i;
+  LOG_TEST_NAME("test_records_short_lived_threads");
+  gpr_thd_options_set_joinable(&options);
+  gpr_span_recorder_start(SHORT_LIVED_THREADS);
+  /* More threads than there are rings: those of exited threads are reused. */
+  for (i = 0; i < SHORT_LIVED_THREADS; i++) {
+    GPR_ASSERT(gpr_thd_new(&thread, record_span, NULL, &options));
+    gpr_thd_join(thread);
+  }
+  gpr_span_recorder_stop();
+  trace = export_trace();
+  GPR_ASSERT(count_occurrences(trace, "short lived") == SHORT_LIVED_THREADS);
+  GPR_ASSERT(strstr(trace, "\"dropped_spans\":\"0\"") != NULL);
+  gpr_free(trace);
+}
+
+static void test_stopped_recorder_ignores_spans(void) {
+  char *trace;
+  LOG_TEST_NAME("test_stopped_recorder_ignores_spans");
+  /* The clock is not even read. */
+  GPR_ASSERT(gpr_span_clock_now() == 0);
+  record_from_threads();
+  trace = export_trace();
+  GPR_ASSERT(count_occurrences(trace, "\"ph\":\"X\"") == 0);
+  gpr_free(trace);
+}
+
+int main(int argc, char **argv) {
+  grpc_test_init(argc, argv);
+  test_records_all_threads();
+  test_keeps_most_recent_spans();
+  test_records_short_lived_threads();
+  test_stopped_recorder_ignores_spans();
+  return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "src/core/support/thread_rings.h"
+
+#include <string.h>
+
+#include <grpc/support/log.h>
+#include <grpc/support/sync.h>
+#include <grpc/support/thd.h>
+#include "test/core/util/test_config.h"
+
+#define LOG_TEST_NAME(x) gpr_log(GPR_INFO, "%s", x)
+
+#define RING_SIZE 16
+#define MAX_THREADS 16
+
+/* What the callbacks were given, protected by mu. Each test has its own, in
+   static storage like its rings, which are never destroyed. */
+typedef struct {
+  gpr_mu mu;
+  gpr_uint32 entries[MAX_THREADS + 1];
+  gpr_uint32 next_value[MAX_THREADS + 1];
+  gpr_uint64 dropped[MAX_THREADS + 1];
+  gpr_uint64 total_dropped[MAX_THREADS + 1];
+  int drains;
+} collected;
+
+/* Entries are numbered from 0 by each thread */
+static void on_entry(void *arg, gpr_uint32 thread, const void *entry) {
+  collected *c = arg;
+  GPR_ASSERT(thread >= 1 && thread <= MAX_THREADS);
+  GPR_ASSERT(*(const gpr_uint32 *)entry == c->next_value[thread]);
+  c->next_value[thread]++;
+  c->entries[thread]++;
+}
+
+static void on_dropped(void *arg, gpr_uint32 thread, gpr_uint64 dropped,
+                       gpr_uint64 total) {
+  collected *c = arg;
+  GPR_ASSERT(thread <= MAX_THREADS);
+  c->dropped[thread] += dropped;
+  GPR_ASSERT(c->dropped[thread] == total);
+  c->total_dropped[thread] = total;
+}
+
+static void on_drained(void *arg) {
+  collected *c = arg;
+  c->drains++;
+}
+
+static gpr_thread_rings *create_rings(collected *c, size_t max_rings) {
+  gpr_thread_rings_config config;
+  memset(c, 0, sizeof(*c));
+  gpr_mu_init(&c->mu);
+  memset(&config, 0, sizeof(config));
+  config.entry_size = sizeof(gpr_uint32);
+  config.ring_size = RING_SIZE;
+  config.max_rings = max_rings;
+  config.mu = &c->mu;
+  config.on_entry = on_entry;
+  config.on_dropped = on_dropped;
+  config.on_drained = on_drained;
+  config.arg = c;
+  return gpr_thread_rings_create(&config);
+}
+
+static void drain(gpr_thread_rings *rings, collected *c) {
+  gpr_mu_lock(&c->mu);
+  gpr_thread_rings_drain_locked(rings);
+  gpr_mu_unlock(&c->mu);
+}
+
+/* Returns the number of entries that were not dropped */
+static int add_entries(gpr_thread_rings *rings, int count) {
+  int added = 0;
+  int i;
+  for (i = 0; i < count; i++) {
+    gpr_thread_ring *ring;
+    gpr_uint32 *entry = gpr_thread_rings_reserve(rings, &ring);
+    if (entry == NULL) continue;
+    *entry = (gpr_uint32)added++;
+    gpr_thread_rings_commit(ring);
+  }
+  return added;
+}
+
+typedef struct {
+  gpr_thread_rings *rings;
+  int count;
+  int added;
+  /* set once the entries are added */
+  gpr_event written;
+  /* if not NULL, waited for before returning */
+  gpr_event *done;
+} writer_args;
+
+static void writer(void *arg) {
+  writer_args *args = arg;
+  args->added = add_entries(args->rings, args->count);
+  gpr_event_set(&args->written, (void *)1);
+  if (args->done != NULL) {
+    GPR_ASSERT(gpr_event_wait(args->done, gpr_inf_future(GPR_CLOCK_REALTIME)));
+  }
+}
+
+static void start_writer(gpr_thd_id *id, writer_args *args,
+                         gpr_thread_rings *rings, int count, gpr_event *done) {
+  gpr_thd_options options = gpr_thd_options_default();
+  gpr_thd_options_set_joinable(&options);
+  args->rings = rings;
+  args->count = count;
+  args->done = done;
+  gpr_event_init(&args->written);
+  GPR_ASSERT(gpr_thd_new(id, writer, args, &options));
+}
+
+static void test_recycles_rings_of_exited_threads(void) {
+  static collected c;
+  static gpr_thread_rings *rings;
+  writer_args args;
+  gpr_thd_id id;
+  gpr_uint32 i;
+
+  LOG_TEST_NAME("test_recycles_rings_of_exited_threads");
+  rings = create_rings(&c, 2);
+  /* More threads than rings, one after the other and without draining in
+     between: each gets the ring of a thread that has exited. */
+  for (i = 1; i <= MAX_THREADS; i++) {
+    start_writer(&id, &args, rings, RING_SIZE, NULL);
+    gpr_thd_join(id);
+    GPR_ASSERT(args.added == RING_SIZE);
+  }
+  drain(rings, &c);
+  for (i = 1; i <= MAX_THREADS; i++) {
+    GPR_ASSERT(c.entries[i] == RING_SIZE);
+  }
+  for (i = 0; i <= MAX_THREADS; i++) {
+    GPR_ASSERT(c.total_dropped[i] == 0);
+  }
+}
+
+static void test_counts_dropped_entries(void) {
+  static collected c;
+  static gpr_thread_rings *rings;
+  writer_args args;
+  gpr_thd_id id;
+  gpr_event done;
+
+  LOG_TEST_NAME("test_counts_dropped_entries");
+  rings = create_rings(&c, 1);
+  gpr_event_init(&done);
+  /* A full ring drops what comes next... */
+  start_writer(&id, &args, rings, RING_SIZE + 2, &done);
+  GPR_ASSERT(
+      gpr_event_wait(&args.written, gpr_inf_future(GPR_CLOCK_REALTIME)));
+  /* ... and while the one ring is taken, other threads drop everything. */
+  GPR_ASSERT(add_entries(rings, 3) == 0);
+  gpr_event_set(&done, (void *)1);
+  gpr_thd_join(id);
+  GPR_ASSERT(args.added == RING_SIZE);
+
+  drain(rings, &c);
+  GPR_ASSERT(c.entries[1] == RING_SIZE);
+  GPR_ASSERT(c.total_dropped[1] == 2);
+  GPR_ASSERT(c.total_dropped[0] == 3);
+
+  /* Reported once only */
+  drain(rings, &c);
+  GPR_ASSERT(c.dropped[1] == 2);
+  GPR_ASSERT(c.dropped[0] == 3);
+}
+
+static void test_drainer_drains_before_stopping(void) {
+  static collected c;
+  static gpr_thread_rings *rings;
+  writer_args args[4];
+  gpr_thd_id ids[4];
+  gpr_uint32 i;
+
+  LOG_TEST_NAME("test_drainer_drains_before_stopping");
+  rings = create_rings(&c, 4);
+  gpr_mu_lock(&c.mu);
+  gpr_thread_rings_start_drainer_locked(rings, 1);
+  gpr_mu_unlock(&c.mu);
+  for (i = 0; i < 4; i++) {
+    start_writer(&ids[i], &args[i], rings, RING_SIZE, NULL);
+  }
+  for (i = 0; i < 4; i++) {
+    gpr_thd_join(ids[i]);
+  }
+  gpr_thread_rings_stop_drainer(rings);
+  GPR_ASSERT(c.drains >= 1);
+  for (i = 1; i <= 4; i++) {
+    GPR_ASSERT(c.entries[i] == RING_SIZE);
+  }
+}
+
+int main(int argc, char **argv) {
+  grpc_test_init(argc, argv);
+  test_recycles_rings_of_exited_threads();
+  test_counts_dropped_entries();
+  test_drainer_drains_before_stopping();
+  return 0;
+}
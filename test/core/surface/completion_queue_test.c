@@ -33,6 +33,8 @@
 
 #include "src/core/surface/completion_queue.h"
 
+#include <string.h>
+
 #include "src/core/iomgr/iomgr.h"
 #include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
@@ -262,6 +264,50 @@ static void consumer_thread(void *arg) {
   }
 }
 
+/* a cached queue is reused until its thread exits or the library shuts
+   down */
+static void test_thread_cache(void) {
+  grpc_event ev;
+  grpc_completion_queue *cc;
+  grpc_cq_completion completion;
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  grpc_cq_thread_cache exiting;
+  grpc_cq_thread_cache lingering;
+  void *tag = create_test_tag();
+
+  LOG_TEST("test_thread_cache");
+
+  memset(&exiting, 0, sizeof(exiting));
+  memset(&lingering, 0, sizeof(lingering));
+
+  cc = grpc_cq_thread_cache_get(&exiting);
+  GPR_ASSERT(cc != NULL);
+  GPR_ASSERT(grpc_cq_thread_cache_get(&exiting) == cc);
+  GPR_ASSERT(grpc_cq_thread_cache_get(&lingering) != cc);
+
+  grpc_cq_begin_op(cc);
+  grpc_cq_end_op(&exec_ctx, cc, tag, 1, do_nothing_end_completion, NULL,
+                 &completion);
+  grpc_exec_ctx_finish(&exec_ctx);
+  ev = grpc_completion_queue_pluck(cc, tag, gpr_inf_past(GPR_CLOCK_REALTIME),
+                                   NULL);
+  GPR_ASSERT(ev.type == GRPC_OP_COMPLETE);
+  GPR_ASSERT(ev.tag == tag);
+
+  grpc_cq_thread_cache_destroy(&exiting);
+  GPR_ASSERT(exiting.cq == NULL);
+
+  /* the library shutting down takes the remaining queue with it, and the
+     cache starts over once the library is back */
+  grpc_shutdown();
+  GPR_ASSERT(lingering.cq == NULL);
+  grpc_init();
+  GPR_ASSERT(grpc_cq_thread_cache_get(&lingering) != NULL);
+  grpc_cq_thread_cache_destroy(&lingering);
+  grpc_cq_thread_cache_destroy(&lingering);
+  GPR_ASSERT(lingering.cq == NULL);
+}
+
 static void test_threading(size_t producers, size_t consumers) {
   test_thread_options *options =
       gpr_malloc((producers + consumers) * sizeof(test_thread_options));
@@ -347,6 +393,7 @@ int main(int argc, char **argv) {
   test_threading(1, 10);
   test_threading(10, 1);
   test_threading(10, 10);
+  test_thread_cache();
   grpc_shutdown();
   return 0;
 }
@@ -0,0 +1,141 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <grpc/grpc.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/log.h>
+
+#include "test/core/end2end/cq_verifier.h"
+#include "test/core/util/test_config.h"
+
+/* more than a channel keeps for reuse, so some allocations are released */
+#define NUM_CALLS 100
+#define NUM_ROUNDS 5
+
+static void *tag(gpr_intptr x) { return (void *)x; }
+
+static void test_register_is_idempotent(grpc_channel *chan) {
+  void *a = grpc_channel_register_call(chan, "/Foo/Bar", NULL, NULL);
+  void *b = grpc_channel_register_call(chan, "/Foo/Bar", NULL, NULL);
+  void *c = grpc_channel_register_call(chan, "/Foo/Baz", NULL, NULL);
+  void *d = grpc_channel_register_call(chan, "/Foo/Bar", "somewhere", NULL);
+  void *e = grpc_channel_register_call(chan, "/Foo/Bar", "somewhere", NULL);
+  GPR_ASSERT(a == b);
+  GPR_ASSERT(a != c);
+  GPR_ASSERT(a != d);
+  GPR_ASSERT(d == e);
+}
+
+/* Runs a call to completion; on a lame channel it fails right away. */
+static void run_call(grpc_call *call, cq_verifier *cqv) {
+  grpc_op ops[2];
+  grpc_op *op = ops;
+  grpc_metadata_array trailing_metadata_recv;
+  grpc_status_code status;
+  char *details = NULL;
+  size_t details_capacity = 0;
+
+  grpc_metadata_array_init(&trailing_metadata_recv);
+  op->op = GRPC_OP_SEND_INITIAL_METADATA;
+  op->data.send_initial_metadata.count = 0;
+  op->flags = 0;
+  op->reserved = NULL;
+  op++;
+  op->op = GRPC_OP_RECV_STATUS_ON_CLIENT;
+  op->data.recv_status_on_client.trailing_metadata = &trailing_metadata_recv;
+  op->data.recv_status_on_client.status = &status;
+  op->data.recv_status_on_client.status_details = &details;
+  op->data.recv_status_on_client.status_details_capacity = &details_capacity;
+  op->flags = 0;
+  op->reserved = NULL;
+  op++;
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_call_start_batch(call, ops, (size_t)(op - ops), tag(1), NULL));
+  cq_expect_completion(cqv, tag(1), 1);
+  cq_verify(cqv);
+  GPR_ASSERT(status == GRPC_STATUS_UNKNOWN);
+
+  grpc_metadata_array_destroy(&trailing_metadata_recv);
+  gpr_free(details);
+}
+
+/* Creates and destroys batches of calls so that call allocations are
+   recycled, and checks that recycled calls still work. */
+static void test_recycled_calls(grpc_channel *chan, grpc_completion_queue *cq,
+                                cq_verifier *cqv) {
+  void *rc = grpc_channel_register_call(chan, "/Foo/Bar", NULL, NULL);
+  grpc_call *calls[NUM_CALLS];
+  int round;
+  int i;
+
+  for (round = 0; round < NUM_ROUNDS; round++) {
+    for (i = 0; i < NUM_CALLS; i++) {
+      calls[i] = grpc_channel_create_registered_call(
+          chan, NULL, GRPC_PROPAGATE_DEFAULTS, cq, rc,
+          GRPC_TIMEOUT_SECONDS_TO_DEADLINE(100), NULL);
+      GPR_ASSERT(calls[i]);
+    }
+    run_call(calls[round], cqv);
+    for (i = 0; i < NUM_CALLS; i++) {
+      grpc_call_destroy(calls[i]);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  grpc_channel *chan;
+  grpc_completion_queue *cq;
+  cq_verifier *cqv;
+
+  grpc_test_init(argc, argv);
+  grpc_init();
+
+  chan = grpc_lame_client_channel_create(
+      "lampoon:national", GRPC_STATUS_UNKNOWN, "Rpc sent on a lame channel.");
+  GPR_ASSERT(chan);
+  cq = grpc_completion_queue_create(NULL);
+  cqv = cq_verifier_create(cq);
+
+  test_register_is_idempotent(chan);
+  test_recycled_calls(chan, cq, cqv);
+
+  grpc_channel_destroy(chan);
+  cq_verifier_destroy(cqv);
+  grpc_completion_queue_destroy(cq);
+
+  grpc_shutdown();
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "src/core/transport/chttp2/bdp_estimator.h"
+
+#include <grpc/support/log.h>
+#include <grpc/support/useful.h>
+#include "test/core/util/test_config.h"
+
+#define LOG_TEST(x) gpr_log(GPR_INFO, "%s", x)
+
+#define MIN_ESTIMATE 1024
+#define MAX_ESTIMATE (1024 * 1024)
+
+static gpr_timespec ms(int n) {
+  return gpr_time_add(gpr_time_0(GPR_CLOCK_MONOTONIC),
+                      gpr_time_from_millis(n, GPR_TIMESPAN));
+}
+
+/* deliver bytes during a probe that takes rtt_ms; returns whether the estimate
+   changed */
+static int probe(grpc_chttp2_bdp_estimator *est, gpr_int64 bytes, int start_ms,
+                 int rtt_ms) {
+  GPR_ASSERT(grpc_chttp2_bdp_estimator_add_incoming_bytes(est, 1));
+  grpc_chttp2_bdp_estimator_start_ping(est, ms(start_ms));
+  /* no new probe while one is in flight */
+  GPR_ASSERT(!grpc_chttp2_bdp_estimator_add_incoming_bytes(est, bytes - 1));
+  return grpc_chttp2_bdp_estimator_complete_ping(est, ms(start_ms + rtt_ms));
+}
+
+/* test an estimator starts at its minimum and ignores stray acks */
+static void test_no_op(void) {
+  grpc_chttp2_bdp_estimator est;
+
+  LOG_TEST("test_no_op");
+
+  grpc_chttp2_bdp_estimator_init(&est, MIN_ESTIMATE, MAX_ESTIMATE);
+  GPR_ASSERT(est.estimate == MIN_ESTIMATE);
+  GPR_ASSERT(!grpc_chttp2_bdp_estimator_complete_ping(&est, ms(10)));
+  GPR_ASSERT(est.estimate == MIN_ESTIMATE);
+}
+
+/* test a window-limited connection doubles the estimate every round trip
+   until the maximum */
+static void test_grows_to_max(void) {
+  grpc_chttp2_bdp_estimator est;
+  int t = 0;
+  int rounds = 0;
+
+  LOG_TEST("test_grows_to_max");
+
+  grpc_chttp2_bdp_estimator_init(&est, MIN_ESTIMATE, MAX_ESTIMATE);
+  while (est.estimate < MAX_ESTIMATE) {
+    gpr_int64 prev = est.estimate;
+    /* the peer fills the whole window (twice the estimate) each round trip */
+    GPR_ASSERT(probe(&est, 2 * est.estimate, t, 10));
+    GPR_ASSERT(est.estimate == GPR_MIN(MAX_ESTIMATE, 2 * prev));
+    t += 10;
+    rounds++;
+  }
+  GPR_ASSERT(rounds == 10);
+  GPR_ASSERT(!probe(&est, 2 * est.estimate, t, 10));
+  GPR_ASSERT(est.estimate == MAX_ESTIMATE);
+}
+
+/* test a link whose bandwidth does not improve with a bigger window stops
+   growing */
+static void test_plateau(void) {
+  grpc_chttp2_bdp_estimator est;
+
+  LOG_TEST("test_plateau");
+
+  grpc_chttp2_bdp_estimator_init(&est, MIN_ESTIMATE, MAX_ESTIMATE);
+  GPR_ASSERT(probe(&est, 8 * MIN_ESTIMATE, 0, 10));
+  GPR_ASSERT(est.estimate == 8 * MIN_ESTIMATE);
+  /* same bytes in a longer round trip: the link, not the window, is the
+     bottleneck */
+  GPR_ASSERT(!probe(&est, 8 * MIN_ESTIMATE, 10, 20));
+  GPR_ASSERT(!probe(&est, 8 * MIN_ESTIMATE, 30, 20));
+  GPR_ASSERT(est.estimate == 8 * MIN_ESTIMATE);
+}
+
+/* test a trickle of data shrinks the estimate back to its minimum */
+static void test_shrinks_when_idle(void) {
+  grpc_chttp2_bdp_estimator est;
+  int t = 0;
+
+  LOG_TEST("test_shrinks_when_idle");
+
+  grpc_chttp2_bdp_estimator_init(&est, MIN_ESTIMATE, MAX_ESTIMATE);
+  GPR_ASSERT(probe(&est, 64 * MIN_ESTIMATE, t, 10));
+  GPR_ASSERT(est.estimate == 64 * MIN_ESTIMATE);
+  while (est.estimate > MIN_ESTIMATE) {
+    gpr_int64 prev = est.estimate;
+    t += 10;
+    GPR_ASSERT(probe(&est, 100, t, 10));
+    GPR_ASSERT(est.estimate == prev / 2);
+  }
+  t += 10;
+  GPR_ASSERT(!probe(&est, 100, t, 10));
+  GPR_ASSERT(est.estimate == MIN_ESTIMATE);
+  /* and grows again once the data comes back */
+  t += 10;
+  GPR_ASSERT(probe(&est, 2 * MIN_ESTIMATE, t, 10));
+  GPR_ASSERT(est.estimate == 2 * MIN_ESTIMATE);
+}
+
+int main(int argc, char **argv) {
+  grpc_test_init(argc, argv);
+
+  test_no_op();
+  test_grows_to_max();
+  test_plateau();
+  test_shrinks_when_idle();
+
+  return 0;
+}
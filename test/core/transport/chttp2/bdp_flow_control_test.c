@@ -0,0 +1,303 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Downloads a large stream over a socketpair whose endpoints hold every write
+   back for a fixed delay, emulating a high-latency link, and checks that
+   sizing the receive windows from the bandwidth-delay product beats the
+   static windows. */
+
+#include <string.h>
+
+#include <grpc/byte_buffer.h>
+#include <grpc/grpc.h>
+#include <grpc/support/alloc.h>
+#include <grpc/support/log.h>
+#include <grpc/support/time.h>
+#include <grpc/support/useful.h>
+
+#include "src/core/channel/compress_filter.h"
+#include "src/core/channel/connected_channel.h"
+#include "src/core/channel/http_client_filter.h"
+#include "src/core/channel/http_server_filter.h"
+#include "src/core/iomgr/endpoint_pair.h"
+#include "src/core/surface/channel.h"
+#include "src/core/surface/server.h"
+#include "src/core/transport/chttp2_transport.h"
+#include "test/core/util/delayed_endpoint.h"
+#include "test/core/util/test_config.h"
+
+#define ONE_WAY_DELAY_MS 25
+#define MESSAGE_SIZE (64 * 1024)
+#define NUM_MESSAGES 64
+
+static void *tag(gpr_intptr t) { return (void *)t; }
+
+typedef struct {
+  grpc_completion_queue *cq;
+  grpc_server *server;
+  grpc_channel *client;
+} fixture;
+
+static void create_fixture(fixture *f, grpc_channel_args *client_args) {
+  static grpc_channel_filter const *server_filters[] = {
+      &grpc_http_server_filter};
+  static grpc_channel_filter const *client_filters[] = {
+      &grpc_http_client_filter, &grpc_compress_filter,
+      &grpc_connected_channel_filter};
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  grpc_endpoint_pair sfd = grpc_iomgr_create_endpoint_pair("delayed", 65536);
+  grpc_mdctx *server_mdctx = grpc_mdctx_create();
+  grpc_mdctx *client_mdctx = grpc_mdctx_create();
+  gpr_timespec delay = gpr_time_from_millis(ONE_WAY_DELAY_MS, GPR_TIMESPAN);
+  grpc_transport *transport;
+
+  f->cq = grpc_completion_queue_create(NULL);
+
+  f->server = grpc_server_create_from_filters(NULL, 0, NULL);
+  grpc_server_register_completion_queue(f->server, f->cq, NULL);
+  grpc_server_start(f->server);
+  transport = grpc_create_chttp2_transport(
+      &exec_ctx, NULL, grpc_delayed_endpoint_create(sfd.server, delay, 0),
+      server_mdctx, 0);
+  grpc_server_setup_transport(&exec_ctx, f->server, transport, server_filters,
+                              GPR_ARRAY_SIZE(server_filters), server_mdctx,
+                              grpc_server_get_channel_args(f->server));
+  grpc_chttp2_transport_start_reading(&exec_ctx, transport, NULL, 0);
+
+  transport = grpc_create_chttp2_transport(
+      &exec_ctx, client_args,
+      grpc_delayed_endpoint_create(sfd.client, delay, 0), client_mdctx, 1);
+  f->client = grpc_channel_create_from_filters(
+      &exec_ctx, "delayed-target", client_filters,
+      GPR_ARRAY_SIZE(client_filters), client_args, client_mdctx, 1);
+  grpc_connected_channel_bind_transport(
+      grpc_channel_get_channel_stack(f->client), transport);
+  grpc_chttp2_transport_start_reading(&exec_ctx, transport, NULL, 0);
+  grpc_exec_ctx_finish(&exec_ctx);
+}
+
+static void destroy_fixture(fixture *f) {
+  grpc_event ev;
+  grpc_server_shutdown_and_notify(f->server, f->cq, tag(1000));
+  GPR_ASSERT(grpc_completion_queue_pluck(
+                 f->cq, tag(1000), GRPC_TIMEOUT_SECONDS_TO_DEADLINE(5), NULL)
+                 .type == GRPC_OP_COMPLETE);
+  grpc_server_destroy(f->server);
+  grpc_channel_destroy(f->client);
+  grpc_completion_queue_shutdown(f->cq);
+  do {
+    ev = grpc_completion_queue_next(f->cq, GRPC_TIMEOUT_SECONDS_TO_DEADLINE(5),
+                                    NULL);
+  } while (ev.type != GRPC_QUEUE_SHUTDOWN);
+  grpc_completion_queue_destroy(f->cq);
+}
+
+static void start_op(grpc_call *call, grpc_op *op, gpr_intptr t) {
+  op->flags = 0;
+  op->reserved = NULL;
+  GPR_ASSERT(GRPC_CALL_OK == grpc_call_start_batch(call, op, 1, tag(t), NULL));
+}
+
+/* Streams NUM_MESSAGES messages of MESSAGE_SIZE bytes from server to client,
+   keeping one send and one receive outstanding at a time, and returns how
+   long that took in seconds. */
+static double download(int bdp_probe) {
+  grpc_arg arg;
+  grpc_channel_args client_args;
+  fixture f;
+  grpc_call *c;
+  grpc_call *s;
+  grpc_op ops[4];
+  grpc_op *op;
+  grpc_metadata_array initial_metadata_recv;
+  grpc_metadata_array trailing_metadata_recv;
+  grpc_metadata_array request_metadata_recv;
+  grpc_call_details call_details;
+  grpc_status_code status;
+  char *details = NULL;
+  size_t details_capacity = 0;
+  int was_cancelled = 2;
+  grpc_byte_buffer *response_payload = NULL;
+  grpc_byte_buffer *response_payload_recv = NULL;
+  gpr_slice payload_slice = gpr_slice_malloc(MESSAGE_SIZE);
+  gpr_timespec deadline = GRPC_TIMEOUT_SECONDS_TO_DEADLINE(60);
+  gpr_timespec start;
+  gpr_timespec elapsed;
+  grpc_event ev;
+  int sent = 0;
+  int received = 0;
+  int pending_tags = 3; /* client status, server close, server status */
+
+  arg.type = GRPC_ARG_INTEGER;
+  arg.key = GRPC_ARG_HTTP2_BDP_PROBE;
+  arg.value.integer = bdp_probe;
+  client_args.num_args = 1;
+  client_args.args = &arg;
+  create_fixture(&f, &client_args);
+  memset(GPR_SLICE_START_PTR(payload_slice), 'a', MESSAGE_SIZE);
+
+  grpc_metadata_array_init(&initial_metadata_recv);
+  grpc_metadata_array_init(&trailing_metadata_recv);
+  grpc_metadata_array_init(&request_metadata_recv);
+  grpc_call_details_init(&call_details);
+
+  c = grpc_channel_create_call(f.client, NULL, GRPC_PROPAGATE_DEFAULTS, f.cq,
+                               "/download", "foo.test.google.fr", deadline,
+                               NULL);
+  GPR_ASSERT(c);
+  memset(ops, 0, sizeof(ops));
+  op = ops;
+  op->op = GRPC_OP_SEND_INITIAL_METADATA;
+  op->data.send_initial_metadata.count = 0;
+  op++;
+  op->op = GRPC_OP_SEND_CLOSE_FROM_CLIENT;
+  op++;
+  op->op = GRPC_OP_RECV_INITIAL_METADATA;
+  op->data.recv_initial_metadata = &initial_metadata_recv;
+  op++;
+  op->op = GRPC_OP_RECV_STATUS_ON_CLIENT;
+  op->data.recv_status_on_client.trailing_metadata = &trailing_metadata_recv;
+  op->data.recv_status_on_client.status = &status;
+  op->data.recv_status_on_client.status_details = &details;
+  op->data.recv_status_on_client.status_details_capacity = &details_capacity;
+  op++;
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_call_start_batch(c, ops, (size_t)(op - ops), tag(1), NULL));
+
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_server_request_call(f.server, &s, &call_details,
+                                      &request_metadata_recv, f.cq, f.cq,
+                                      tag(100)));
+  GPR_ASSERT(grpc_completion_queue_pluck(f.cq, tag(100), deadline, NULL)
+                 .type == GRPC_OP_COMPLETE);
+
+  memset(ops, 0, sizeof(ops));
+  op = ops;
+  op->op = GRPC_OP_SEND_INITIAL_METADATA;
+  op->data.send_initial_metadata.count = 0;
+  op++;
+  op->op = GRPC_OP_RECV_CLOSE_ON_SERVER;
+  op->data.recv_close_on_server.cancelled = &was_cancelled;
+  op++;
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_call_start_batch(s, ops, (size_t)(op - ops), tag(101), NULL));
+
+  start = gpr_now(GPR_CLOCK_MONOTONIC);
+  response_payload = grpc_raw_byte_buffer_create(&payload_slice, 1);
+  ops[0].op = GRPC_OP_SEND_MESSAGE;
+  ops[0].data.send_message = response_payload;
+  start_op(s, &ops[0], 102);
+  ops[1].op = GRPC_OP_RECV_MESSAGE;
+  ops[1].data.recv_message = &response_payload_recv;
+  start_op(c, &ops[1], 2);
+
+  while (received < NUM_MESSAGES || sent < NUM_MESSAGES || pending_tags > 0) {
+    ev = grpc_completion_queue_next(f.cq, deadline, NULL);
+    GPR_ASSERT(ev.type == GRPC_OP_COMPLETE);
+    GPR_ASSERT(ev.success);
+    switch ((gpr_intptr)ev.tag) {
+      case 1:
+      case 101:
+      case 103:
+        pending_tags--;
+        break;
+      case 102:
+        grpc_byte_buffer_destroy(response_payload);
+        sent++;
+        if (sent < NUM_MESSAGES) {
+          response_payload = grpc_raw_byte_buffer_create(&payload_slice, 1);
+          ops[0].op = GRPC_OP_SEND_MESSAGE;
+          ops[0].data.send_message = response_payload;
+          start_op(s, &ops[0], 102);
+        } else {
+          ops[0].op = GRPC_OP_SEND_STATUS_FROM_SERVER;
+          ops[0].data.send_status_from_server.trailing_metadata_count = 0;
+          ops[0].data.send_status_from_server.status = GRPC_STATUS_OK;
+          ops[0].data.send_status_from_server.status_details = "done";
+          start_op(s, &ops[0], 103);
+        }
+        break;
+      case 2:
+        GPR_ASSERT(response_payload_recv != NULL);
+        GPR_ASSERT(grpc_byte_buffer_length(response_payload_recv) ==
+                   MESSAGE_SIZE);
+        grpc_byte_buffer_destroy(response_payload_recv);
+        response_payload_recv = NULL;
+        received++;
+        if (received == NUM_MESSAGES) {
+          elapsed = gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), start);
+        } else {
+          ops[1].op = GRPC_OP_RECV_MESSAGE;
+          ops[1].data.recv_message = &response_payload_recv;
+          start_op(c, &ops[1], 2);
+        }
+        break;
+      default:
+        GPR_ASSERT(0);
+    }
+  }
+  GPR_ASSERT(status == GRPC_STATUS_OK);
+  GPR_ASSERT(was_cancelled == 0);
+
+  gpr_free(details);
+  grpc_metadata_array_destroy(&initial_metadata_recv);
+  grpc_metadata_array_destroy(&trailing_metadata_recv);
+  grpc_metadata_array_destroy(&request_metadata_recv);
+  grpc_call_details_destroy(&call_details);
+  gpr_slice_unref(payload_slice);
+  grpc_call_destroy(c);
+  grpc_call_destroy(s);
+  destroy_fixture(&f);
+
+  return (double)elapsed.tv_sec + 1e-9 * (double)elapsed.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  double static_windows;
+  double bdp_windows;
+
+  grpc_test_init(argc, argv);
+  grpc_init();
+
+  static_windows = download(0);
+  bdp_windows = download(1);
+  gpr_log(GPR_INFO,
+          "%d x %d bytes with %dms one way delay: static windows %.3fs, "
+          "bdp windows %.3fs",
+          NUM_MESSAGES, MESSAGE_SIZE, ONE_WAY_DELAY_MS, static_windows,
+          bdp_windows);
+  GPR_ASSERT(bdp_windows < static_windows);
+
+  grpc_shutdown();
+  return 0;
+}
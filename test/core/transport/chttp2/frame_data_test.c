@@ -0,0 +1,201 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Checks that the data parser delivers message payloads as sub-slices of the
+   slices it is given rather than copies, whether a message fits within one
+   read or spans several. */
+
+#include "src/core/transport/chttp2/frame_data.h"
+
+#include <string.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/log.h>
+#include <grpc/support/useful.h>
+
+#include "src/core/transport/chttp2/internal.h"
+#include "test/core/util/test_config.h"
+
+#define LOG_TEST(x) gpr_log(GPR_INFO, "%s", x)
+
+typedef struct {
+  grpc_chttp2_transport *transport;
+  grpc_chttp2_stream *stream;
+  grpc_chttp2_data_parser *parser;
+} fixture;
+
+static void fixture_init(fixture *f) {
+  f->transport = gpr_malloc(sizeof(*f->transport));
+  memset(f->transport, 0, sizeof(*f->transport));
+  f->stream = gpr_malloc(sizeof(*f->stream));
+  memset(f->stream, 0, sizeof(*f->stream));
+  f->parser = &f->stream->parsing.data_parser;
+  GPR_ASSERT(grpc_chttp2_data_parser_init(f->parser) == GRPC_CHTTP2_PARSE_OK);
+  GPR_ASSERT(grpc_chttp2_data_parser_begin_frame(f->parser, 0) ==
+             GRPC_CHTTP2_PARSE_OK);
+}
+
+static void fixture_destroy(fixture *f) {
+  grpc_chttp2_data_parser_destroy(f->parser);
+  gpr_free(f->stream);
+  gpr_free(f->transport);
+}
+
+static void parse(fixture *f, gpr_slice slice) {
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  GPR_ASSERT(grpc_chttp2_data_parser_parse(
+                 &exec_ctx, f->parser, &f->transport->parsing,
+                 &f->stream->parsing, slice, 0) == GRPC_CHTTP2_PARSE_OK);
+  grpc_exec_ctx_finish(&exec_ctx);
+}
+
+/* A slice holding the grpc message headers and payloads of the given
+   lengths, back to back. Payload bytes are their index within the message. */
+static gpr_slice make_messages(const size_t *lengths, size_t count) {
+  size_t total = 0;
+  size_t i;
+  size_t j;
+  gpr_slice slice;
+  gpr_uint8 *p;
+
+  for (i = 0; i < count; i++) total += 5 + lengths[i];
+  slice = gpr_slice_malloc(total);
+  p = GPR_SLICE_START_PTR(slice);
+  for (i = 0; i < count; i++) {
+    *p++ = 0;
+    *p++ = (gpr_uint8)(lengths[i] >> 24);
+    *p++ = (gpr_uint8)(lengths[i] >> 16);
+    *p++ = (gpr_uint8)(lengths[i] >> 8);
+    *p++ = (gpr_uint8)lengths[i];
+    for (j = 0; j < lengths[i]; j++) *p++ = (gpr_uint8)j;
+  }
+  return slice;
+}
+
+static void assert_begin_message(grpc_stream_op *op, size_t length) {
+  GPR_ASSERT(op->type == GRPC_OP_BEGIN_MESSAGE);
+  GPR_ASSERT(op->data.begin_message.length == length);
+}
+
+/* op must be a slice referencing (not copying) length bytes of source
+   starting at offset. */
+static void assert_sub_slice(grpc_stream_op *op, gpr_slice source,
+                             size_t offset, size_t length) {
+  GPR_ASSERT(op->type == GRPC_OP_SLICE);
+  GPR_ASSERT(op->data.slice.refcount == source.refcount);
+  GPR_ASSERT(GPR_SLICE_START_PTR(op->data.slice) ==
+             GPR_SLICE_START_PTR(source) + offset);
+  GPR_ASSERT(GPR_SLICE_LENGTH(op->data.slice) == length);
+}
+
+static void test_message_within_one_read(void) {
+  fixture f;
+  size_t length = 65536;
+  gpr_slice read = make_messages(&length, 1);
+
+  LOG_TEST("test_message_within_one_read");
+  fixture_init(&f);
+  parse(&f, read);
+  GPR_ASSERT(f.parser->incoming_sopb.nops == 2);
+  assert_begin_message(&f.parser->incoming_sopb.ops[0], length);
+  assert_sub_slice(&f.parser->incoming_sopb.ops[1], read, 5, length);
+  gpr_slice_unref(read);
+  fixture_destroy(&f);
+}
+
+static void test_messages_sharing_one_read(void) {
+  fixture f;
+  size_t lengths[] = {1000, 70000, 64};
+  gpr_slice read = make_messages(lengths, 3);
+
+  LOG_TEST("test_messages_sharing_one_read");
+  fixture_init(&f);
+  parse(&f, read);
+  GPR_ASSERT(f.parser->incoming_sopb.nops == 6);
+  assert_begin_message(&f.parser->incoming_sopb.ops[0], lengths[0]);
+  assert_sub_slice(&f.parser->incoming_sopb.ops[1], read, 5, lengths[0]);
+  assert_begin_message(&f.parser->incoming_sopb.ops[2], lengths[1]);
+  assert_sub_slice(&f.parser->incoming_sopb.ops[3], read, 10 + lengths[0],
+                   lengths[1]);
+  assert_begin_message(&f.parser->incoming_sopb.ops[4], lengths[2]);
+  assert_sub_slice(&f.parser->incoming_sopb.ops[5], read,
+                   15 + lengths[0] + lengths[1], lengths[2]);
+  gpr_slice_unref(read);
+  fixture_destroy(&f);
+}
+
+static void test_message_spanning_reads(void) {
+  fixture f;
+  /* With its header the message is a whole number of reads: payloads too
+     short to be worth a reference are copied into an inlined slice. */
+  size_t length = 4 * 1024 * 1024 - 5;
+  size_t read_size = 8192;
+  gpr_slice message = make_messages(&length, 1);
+  gpr_slice *reads;
+  size_t num_reads = (GPR_SLICE_LENGTH(message) + read_size - 1) / read_size;
+  size_t i;
+
+  LOG_TEST("test_message_spanning_reads");
+  fixture_init(&f);
+  /* Each read lands in its own allocation, as with the tcp endpoint. */
+  reads = gpr_malloc(num_reads * sizeof(*reads));
+  for (i = 0; i < num_reads; i++) {
+    size_t begin = i * read_size;
+    size_t end = GPR_MIN(begin + read_size, GPR_SLICE_LENGTH(message));
+    reads[i] = gpr_slice_malloc(end - begin);
+    memcpy(GPR_SLICE_START_PTR(reads[i]), GPR_SLICE_START_PTR(message) + begin,
+           end - begin);
+    parse(&f, reads[i]);
+  }
+  GPR_ASSERT(f.parser->incoming_sopb.nops == 1 + num_reads);
+  assert_begin_message(&f.parser->incoming_sopb.ops[0], length);
+  assert_sub_slice(&f.parser->incoming_sopb.ops[1], reads[0], 5,
+                   read_size - 5);
+  for (i = 1; i < num_reads; i++) {
+    assert_sub_slice(&f.parser->incoming_sopb.ops[1 + i], reads[i], 0,
+                     GPR_SLICE_LENGTH(reads[i]));
+    gpr_slice_unref(reads[i]);
+  }
+  gpr_slice_unref(reads[0]);
+  gpr_free(reads);
+  gpr_slice_unref(message);
+  fixture_destroy(&f);
+}
+
+int main(int argc, char **argv) {
+  grpc_test_init(argc, argv);
+  test_message_within_one_read();
+  test_messages_sharing_one_read();
+  test_message_spanning_reads();
+  return 0;
+}
@@ -0,0 +1,226 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Measures how many header bytes the HPACK encoder puts on the wire for a
+   stream of request header sets shaped like those of a busy client: a
+   handful of fixed headers, a long :path drawn from a few dozen methods, a
+   bearer token that is rotated now and then, and per-call request and trace
+   ids. Every header block is decoded again to check it round trips. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/cmdline.h>
+#include <grpc/support/log.h>
+#include <grpc/support/string_util.h>
+
+#include "src/core/transport/chttp2/hpack_parser.h"
+#include "src/core/transport/chttp2/stream_encoder.h"
+#include "test/core/util/slice_splitter.h"
+#include "test/core/util/test_config.h"
+
+#define NUM_METHODS 40
+#define CALLS_PER_TOKEN 500
+#define MAX_HEADERS 16
+
+static const char *services[] = {
+    "google.pubsub.v1.Subscriber", "google.pubsub.v1.Publisher",
+    "google.bigtable.v1.BigtableService",
+    "google.datastore.v1beta3.Datastore"};
+static const char *verbs[] = {"StreamingPull", "ModifyAckDeadline",
+                              "Acknowledge",   "Pull",
+                              "CreateSubscription", "GetSubscription",
+                              "ListSubscriptions", "DeleteSubscription",
+                              "ModifyPushConfig", "GetTopic"};
+
+typedef struct {
+  size_t count;
+  char *keys[MAX_HEADERS];
+  char *values[MAX_HEADERS];
+} header_set;
+
+static unsigned rand_next(unsigned *state) {
+  *state = *state * 1103515245u + 12345u;
+  return *state >> 8;
+}
+
+static char *random_hex(unsigned *state, size_t len) {
+  static const char hex[] = "0123456789abcdef";
+  char *out = gpr_malloc(len + 1);
+  size_t i;
+  for (i = 0; i < len; i++) {
+    out[i] = hex[rand_next(state) & 15];
+  }
+  out[len] = 0;
+  return out;
+}
+
+static void add(header_set *hs, const char *key, char *value) {
+  GPR_ASSERT(hs->count < MAX_HEADERS);
+  hs->keys[hs->count] = gpr_strdup(key);
+  hs->values[hs->count] = value;
+  hs->count++;
+}
+
+/* the headers of call number i */
+static void make_header_set(header_set *hs, int i, unsigned *state) {
+  /* a skewed method mix: low numbered methods are the busy ones */
+  unsigned r = rand_next(state) % NUM_METHODS;
+  unsigned method = r * r / NUM_METHODS;
+  char *path;
+  char *token;
+  char *trace;
+  char *span = random_hex(state, 16);
+  unsigned token_state = (unsigned)(i / CALLS_PER_TOKEN) + 1;
+
+  gpr_asprintf(&path, "/%s/%s", services[method % GPR_ARRAY_SIZE(services)],
+               verbs[method % GPR_ARRAY_SIZE(verbs)]);
+  token = random_hex(&token_state, 180);
+  trace = random_hex(state, 32);
+
+  hs->count = 0;
+  add(hs, ":path", path);
+  add(hs, ":authority", gpr_strdup("pubsub.googleapis.com"));
+  add(hs, ":scheme", gpr_strdup("https"));
+  add(hs, ":method", gpr_strdup("POST"));
+  add(hs, "te", gpr_strdup("trailers"));
+  add(hs, "content-type", gpr_strdup("application/grpc"));
+  add(hs, "user-agent", gpr_strdup("grpc-c/0.11.0 (linux)"));
+  add(hs, "grpc-accept-encoding", gpr_strdup("identity,deflate,gzip"));
+  gpr_asprintf(&hs->values[hs->count], "Bearer %s", token);
+  hs->keys[hs->count++] = gpr_strdup("authorization");
+  add(hs, "x-request-id", random_hex(state, 32));
+  gpr_asprintf(&hs->values[hs->count], "%s/%s;o=1", trace, span);
+  hs->keys[hs->count++] = gpr_strdup("x-cloud-trace-context");
+  gpr_free(token);
+  gpr_free(trace);
+  gpr_free(span);
+}
+
+static void destroy_header_set(header_set *hs) {
+  size_t i;
+  for (i = 0; i < hs->count; i++) {
+    gpr_free(hs->keys[i]);
+    gpr_free(hs->values[i]);
+  }
+}
+
+static void count_header(void *user_data, grpc_mdelem *md) {
+  size_t *count = user_data;
+  (*count)++;
+  GRPC_MDELEM_UNREF(md);
+}
+
+static void run(int calls, gpr_uint32 table_size) {
+  grpc_mdctx *mdctx = grpc_mdctx_create_with_seed(0);
+  grpc_chttp2_hpack_compressor compressor;
+  grpc_chttp2_hpack_parser parser;
+  grpc_linked_mdelem storage[MAX_HEADERS];
+  grpc_stream_op_buffer sopb;
+  grpc_metadata_batch batch;
+  gpr_slice_buffer output;
+  gpr_slice merged;
+  header_set hs;
+  unsigned state = 42;
+  size_t raw_bytes = 0;
+  size_t wire_bytes = 0;
+  size_t decoded;
+  size_t i;
+  int call;
+
+  grpc_chttp2_hpack_compressor_init(&compressor, mdctx);
+  grpc_chttp2_hpack_parser_init(&parser, mdctx);
+  /* as if each side had set GRPC_ARG_HTTP2_HPACK_TABLE_SIZE_* to table_size */
+  grpc_chttp2_hptbl_set_max_bytes_limit(&parser.table, table_size);
+  grpc_chttp2_hpack_compressor_set_max_usable_size(&compressor, table_size);
+  grpc_chttp2_hpack_compressor_set_max_table_size(&compressor, table_size);
+  parser.on_header = count_header;
+  parser.on_header_user_data = &decoded;
+  grpc_sopb_init(&sopb);
+  gpr_slice_buffer_init(&output);
+
+  for (call = 0; call < calls; call++) {
+    make_header_set(&hs, call, &state);
+    grpc_metadata_batch_init(&batch);
+    for (i = 0; i < hs.count; i++) {
+      raw_bytes += strlen(hs.keys[i]) + strlen(hs.values[i]);
+      grpc_metadata_batch_add_tail(
+          &batch, &storage[i],
+          grpc_mdelem_from_strings(mdctx, hs.keys[i], hs.values[i]));
+    }
+    grpc_sopb_add_metadata(&sopb, batch);
+    grpc_chttp2_encode(sopb.ops, sopb.nops, 0, 1, &compressor, &output);
+    sopb.nops = 0;
+
+    /* a single HEADERS frame: skip its 9 byte frame header */
+    merged = grpc_slice_merge(output.slices, output.count);
+    wire_bytes += GPR_SLICE_LENGTH(merged);
+    decoded = 0;
+    GPR_ASSERT(grpc_chttp2_hpack_parser_parse(
+        &parser, GPR_SLICE_START_PTR(merged) + 9, GPR_SLICE_END_PTR(merged)));
+    GPR_ASSERT(decoded == hs.count);
+    gpr_slice_unref(merged);
+    gpr_slice_buffer_reset_and_unref(&output);
+    destroy_header_set(&hs);
+  }
+
+  printf("table_size=%d calls=%d raw_bytes/call=%.1f wire_bytes/call=%.1f\n",
+         (int)table_size, calls, (double)raw_bytes / calls,
+         (double)wire_bytes / calls);
+
+  gpr_slice_buffer_destroy(&output);
+  grpc_sopb_destroy(&sopb);
+  grpc_chttp2_hpack_parser_destroy(&parser);
+  grpc_chttp2_hpack_compressor_destroy(&compressor);
+  grpc_mdctx_unref(mdctx);
+}
+
+int main(int argc, char **argv) {
+  int calls = 10000;
+  gpr_cmdline *cl;
+
+  grpc_test_init(argc, argv);
+
+  cl = gpr_cmdline_create("hpack encoder benchmark");
+  gpr_cmdline_add_int(cl, "calls", "Number of header sets to encode", &calls);
+  gpr_cmdline_parse(cl, argc, argv);
+  gpr_cmdline_destroy(cl);
+  GPR_ASSERT(calls > 0);
+
+  run(calls, 4096);
+  run(calls, 16384);
+  run(calls, 65536);
+  return 0;
+}
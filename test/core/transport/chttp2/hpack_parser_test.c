@@ -212,6 +212,21 @@ static void test_vectors(grpc_slice_split_mode mode) {
               "set-cookie",
               "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1", NULL);
   grpc_chttp2_hpack_parser_destroy(&parser);
+
+  grpc_chttp2_hpack_parser_init(&parser, mdctx);
+  grpc_chttp2_hptbl_set_max_bytes_limit(&parser.table, 8192);
+  /* dynamic table size update to 8192, then C.3.1's literal */
+  test_vector(&parser, mode,
+              "3fe1 3f40 0a63 7573 746f 6d2d 6b65 790d"
+              "6375 7374 6f6d 2d68 6561 6465 72",
+              "custom-key", "custom-header", NULL);
+  GPR_ASSERT(parser.table.max_bytes == 8192);
+  test_vector(&parser, mode, "be", "custom-key", "custom-header", NULL);
+  /* dynamic table size update to 0 flushes the table */
+  test_vector(&parser, mode, "2082", ":method", "GET", NULL);
+  GPR_ASSERT(parser.table.max_bytes == 0);
+  GPR_ASSERT(parser.table.num_ents == 0);
+  grpc_chttp2_hpack_parser_destroy(&parser);
   grpc_mdctx_unref(mdctx);
 }
 
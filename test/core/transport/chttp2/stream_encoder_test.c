@@ -195,6 +195,68 @@ static void test_basic_headers(void) {
   verify_sopb(0, 0, 0, "000004 0104 deadbeef 0f 2f 0176");
 }
 
+static void test_static_table_and_size_updates(void) {
+  add_sopb_headers(2, ":method", "POST", "content-type", "application/grpc");
+  verify_sopb(0, 0, 0,
+              "000013 0104 deadbeef 83 5f 10 6170706c69636174696f6e2f67727063");
+
+  add_sopb_headers(2, ":method", "POST", "content-type", "application/grpc");
+  verify_sopb(0, 0, 0, "000002 0104 deadbeef 83 be");
+
+  /* a zero sized table must be announced, and leaves us with the static
+     table only */
+  grpc_chttp2_hpack_compressor_set_max_table_size(&g_compressor, 0);
+  add_sopb_headers(2, ":method", "POST", "content-type", "application/grpc");
+  verify_sopb(
+      0, 0, 0,
+      "000015 0104 deadbeef 20 83 0f10 10 6170706c69636174696f6e2f67727063");
+
+  grpc_chttp2_hpack_compressor_set_max_table_size(&g_compressor, 8192);
+  add_sopb_headers(2, ":method", "POST", "content-type", "application/grpc");
+  verify_sopb(
+      0, 0, 0,
+      "000016 0104 deadbeef 3fe13f 83 5f 10 6170706c69636174696f6e2f67727063");
+
+  /* and the peer can't make us use more than we're prepared to */
+  grpc_chttp2_hpack_compressor_set_max_usable_size(&g_compressor, 4096);
+  grpc_chttp2_hpack_compressor_set_max_table_size(&g_compressor, 65536);
+  add_sopb_headers(1, ":method", "POST");
+  verify_sopb(0, 0, 0, "000004 0104 deadbeef 3fe11f 83");
+}
+
+static void test_high_entropy_values_not_indexed(void) {
+  int i;
+  char value[32];
+  gpr_uint32 table_elems = 0;
+  gpr_slice_buffer output;
+  gpr_slice merged;
+  grpc_stream_op_buffer encops;
+
+  grpc_sopb_init(&encops);
+  for (i = 0; i < 100; i++) {
+    sprintf(value, "%08x-%d", (unsigned)rand(), i);
+    add_sopb_headers(1, "x-request-id", value);
+    gpr_slice_buffer_init(&output);
+    GPR_ASSERT(0 ==
+               grpc_chttp2_preencode(g_sopb.ops, &g_sopb.nops, 0, &encops));
+    grpc_chttp2_encode(encops.ops, encops.nops, 0, 0xdeadbeef, &g_compressor,
+                       &output);
+    encops.nops = 0;
+    merged = grpc_slice_merge(output.slices, output.count);
+    gpr_slice_buffer_destroy(&output);
+    if (i == 50) {
+      table_elems = g_compressor.table_elems;
+    } else if (i > 50) {
+      /* once the key has shown its values don't repeat they're sent as never
+         indexed literals, and stop displacing the table */
+      GPR_ASSERT(g_compressor.table_elems == table_elems);
+      GPR_ASSERT((GPR_SLICE_START_PTR(merged)[9] & 0xf0) == 0x10);
+    }
+    gpr_slice_unref(merged);
+  }
+  grpc_sopb_destroy(&encops);
+}
+
 static void encode_int_to_str(int i, char *p) {
   p[0] = (char)('a' + i % 26);
   i /= 26;
@@ -340,6 +402,8 @@ int main(int argc, char **argv) {
   grpc_test_init(argc, argv);
   TEST(test_small_data_framing);
   TEST(test_basic_headers);
+  TEST(test_static_table_and_size_updates);
+  TEST(test_high_entropy_values_not_indexed);
   TEST(test_decode_table_overflow);
   TEST(test_decode_random_headers_1);
   TEST(test_decode_random_headers_2);
@@ -0,0 +1,119 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Measures grpc_chttp2_stream_map lookups and stream turnover at a range of
+   live stream counts. Stream ids are allocated like a client does (odd and
+   increasing); the streams that end are picked at random, as they would be
+   for long lived subscriptions. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/cmdline.h>
+#include <grpc/support/log.h>
+#include <grpc/support/time.h>
+
+#include "src/core/transport/chttp2/stream_map.h"
+#include "test/core/util/test_config.h"
+
+static double now_seconds(void) {
+  gpr_timespec now = gpr_now(GPR_CLOCK_MONOTONIC);
+  return (double)now.tv_sec + 1e-9 * (double)now.tv_nsec;
+}
+
+static void run(size_t live, int ops) {
+  grpc_chttp2_stream_map map;
+  gpr_uint32 *ids = gpr_malloc(sizeof(*ids) * live);
+  gpr_uint32 next_id = 1;
+  gpr_uintptr checksum = 0;
+  double start, find_ns, turnover_ns;
+  size_t i;
+  int n;
+
+  grpc_chttp2_stream_map_init(&map, 8);
+  for (i = 0; i < live; i++) {
+    ids[i] = next_id;
+    grpc_chttp2_stream_map_add(&map, next_id, &ids[i]);
+    next_id += 2;
+  }
+
+  /* one lookup per incoming frame */
+  start = now_seconds();
+  for (n = 0; n < ops; n++) {
+    checksum += (gpr_uintptr)grpc_chttp2_stream_map_find(
+        &map, ids[(size_t)rand() % live]);
+  }
+  find_ns = 1e9 * (now_seconds() - start) / ops;
+
+  /* a random stream ends and a new one starts in its place */
+  start = now_seconds();
+  for (n = 0; n < ops; n++) {
+    i = (size_t)rand() % live;
+    GPR_ASSERT(grpc_chttp2_stream_map_delete(&map, ids[i]) == &ids[i]);
+    ids[i] = next_id;
+    grpc_chttp2_stream_map_add(&map, next_id, &ids[i]);
+    next_id += 2;
+  }
+  turnover_ns = 1e9 * (now_seconds() - start) / ops;
+
+  GPR_ASSERT(grpc_chttp2_stream_map_size(&map) == live);
+  GPR_ASSERT(checksum != 0);
+  printf("live_streams=%d find_ns=%.1f turnover_ns=%.1f\n", (int)live,
+         find_ns, turnover_ns);
+  grpc_chttp2_stream_map_destroy(&map);
+  gpr_free(ids);
+}
+
+int main(int argc, char **argv) {
+  int max_streams = 100000;
+  int ops = 1000000;
+  size_t live;
+  gpr_cmdline *cl;
+
+  grpc_test_init(argc, argv);
+
+  cl = gpr_cmdline_create("chttp2 stream map benchmark");
+  gpr_cmdline_add_int(cl, "max_streams", "Largest number of live streams",
+                      &max_streams);
+  gpr_cmdline_add_int(cl, "ops", "Operations timed at each stream count",
+                      &ops);
+  gpr_cmdline_parse(cl, argc, argv);
+  gpr_cmdline_destroy(cl);
+  GPR_ASSERT(max_streams > 0 && ops > 0);
+
+  for (live = 10; live <= (size_t)max_streams; live *= 10) {
+    run(live, ops);
+  }
+  return 0;
+}
@@ -32,6 +32,10 @@
  */
 
 #include "src/core/transport/chttp2/stream_map.h"
+
+#include <stdlib.h>
+
+#include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
 #include "test/core/util/test_config.h"
 
@@ -105,16 +109,18 @@ static void test_basic_add_find(gpr_uint32 n) {
   grpc_chttp2_stream_map_destroy(&map);
 }
 
-/* verify that for_each gets the right values during test_delete_evens_XXX */
+/* verify that for_each gets the right values during test_delete_evens_XXX;
+   the map makes no promise about the order */
 static void verify_for_each(void *user_data, gpr_uint32 stream_id, void *ptr) {
-  gpr_uint32 *for_each_check = user_data;
+  gpr_uint32 *for_each_count = user_data;
   GPR_ASSERT(ptr);
-  GPR_ASSERT(*for_each_check == stream_id);
-  *for_each_check += 2;
+  GPR_ASSERT((gpr_uintptr)ptr == stream_id);
+  GPR_ASSERT(stream_id & 1);
+  *for_each_count += 1;
 }
 
 static void check_delete_evens(grpc_chttp2_stream_map *map, gpr_uint32 n) {
-  gpr_uint32 for_each_check = 1;
+  gpr_uint32 for_each_count = 0;
   gpr_uint32 i;
   size_t got;
 
@@ -129,12 +135,8 @@ static void check_delete_evens(grpc_chttp2_stream_map *map, gpr_uint32 n) {
     }
   }
 
-  grpc_chttp2_stream_map_for_each(map, verify_for_each, &for_each_check);
-  if (n & 1) {
-    GPR_ASSERT(for_each_check == n + 2);
-  } else {
-    GPR_ASSERT(for_each_check == n + 1);
-  }
+  grpc_chttp2_stream_map_for_each(map, verify_for_each, &for_each_count);
+  GPR_ASSERT(for_each_count == (n + 1) / 2);
 }
 
 /* add a bunch of keys, delete the even ones, and make sure the map is
@@ -204,6 +206,73 @@ static void test_periodic_compaction(gpr_uint32 n) {
   grpc_chttp2_stream_map_destroy(&map);
 }
 
+/* keep n streams live, ending random ones and starting new ones in their
+   place, and make sure every live stream can still be found */
+static void test_random_turnover(gpr_uint32 n) {
+  grpc_chttp2_stream_map map;
+  gpr_uint32 *live = gpr_malloc(sizeof(*live) * n);
+  gpr_uint32 next = 1;
+  gpr_uint32 i, j;
+
+  LOG_TEST("test_random_turnover");
+  gpr_log(GPR_INFO, "n = %d", n);
+
+  grpc_chttp2_stream_map_init(&map, 8);
+  for (i = 0; i < n; i++) {
+    live[i] = next;
+    grpc_chttp2_stream_map_add(&map, next, (void *)(gpr_uintptr)next);
+    next += 2;
+  }
+  for (i = 0; i < 4 * n; i++) {
+    j = (gpr_uint32)rand() % n;
+    GPR_ASSERT((void *)(gpr_uintptr)live[j] ==
+               grpc_chttp2_stream_map_delete(&map, live[j]));
+    GPR_ASSERT(NULL == grpc_chttp2_stream_map_find(&map, live[j]));
+    live[j] = next;
+    grpc_chttp2_stream_map_add(&map, next, (void *)(gpr_uintptr)next);
+    next += 2;
+  }
+  GPR_ASSERT(n == grpc_chttp2_stream_map_size(&map));
+  for (i = 0; i < n; i++) {
+    GPR_ASSERT((void *)(gpr_uintptr)live[i] ==
+               grpc_chttp2_stream_map_find(&map, live[i]));
+  }
+  grpc_chttp2_stream_map_destroy(&map);
+  gpr_free(live);
+}
+
+/* move a map of newer streams into one of older streams */
+static void test_move_into(gpr_uint32 n) {
+  grpc_chttp2_stream_map src;
+  grpc_chttp2_stream_map dst;
+  gpr_uint32 i;
+
+  LOG_TEST("test_move_into");
+  gpr_log(GPR_INFO, "n = %d", n);
+
+  grpc_chttp2_stream_map_init(&src, 8);
+  grpc_chttp2_stream_map_init(&dst, 8);
+  for (i = 1; i <= n; i++) {
+    grpc_chttp2_stream_map_add(&dst, i, (void *)(gpr_uintptr)i);
+  }
+  for (i = n + 1; i <= 2 * n; i++) {
+    grpc_chttp2_stream_map_add(&src, i, (void *)(gpr_uintptr)i);
+  }
+  grpc_chttp2_stream_map_move_into(&src, &dst);
+  GPR_ASSERT(0 == grpc_chttp2_stream_map_size(&src));
+  GPR_ASSERT(2 * n == grpc_chttp2_stream_map_size(&dst));
+  for (i = 1; i <= 2 * n; i++) {
+    GPR_ASSERT((void *)(gpr_uintptr)i == grpc_chttp2_stream_map_find(&dst, i));
+    GPR_ASSERT(NULL == grpc_chttp2_stream_map_find(&src, i));
+  }
+  /* both maps keep taking higher keys only */
+  grpc_chttp2_stream_map_add(&src, 2 * n + 1, (void *)1);
+  grpc_chttp2_stream_map_move_into(&src, &dst);
+  GPR_ASSERT(2 * n + 1 == grpc_chttp2_stream_map_size(&dst));
+  grpc_chttp2_stream_map_destroy(&src);
+  grpc_chttp2_stream_map_destroy(&dst);
+}
+
 int main(int argc, char **argv) {
   gpr_uint32 n = 1;
   gpr_uint32 prev = 1;
@@ -220,6 +289,8 @@ int main(int argc, char **argv) {
     test_delete_evens_sweep(n);
     test_delete_evens_incremental(n);
     test_periodic_compaction(n);
+    test_random_turnover(n);
+    test_move_into(n);
 
     tmp = n;
     n += prev;
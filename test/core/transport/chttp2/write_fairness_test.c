@@ -0,0 +1,507 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Runs unary calls on a connection that a bulk upload keeps saturated, over a
+   socketpair whose endpoints emulate a link with fixed delay and bandwidth,
+   and checks that the round robin write scheduler keeps the unary latency
+   within a few round trips, and that it costs a lone bulk upload no
+   throughput. */
+
+#include <string.h>
+
+#include <grpc/byte_buffer.h>
+#include <grpc/grpc.h>
+#include <grpc/support/alloc.h>
+#include <grpc/support/log.h>
+#include <grpc/support/time.h>
+#include <grpc/support/useful.h>
+
+#include "src/core/channel/compress_filter.h"
+#include "src/core/channel/connected_channel.h"
+#include "src/core/channel/http_client_filter.h"
+#include "src/core/channel/http_server_filter.h"
+#include "src/core/iomgr/endpoint_pair.h"
+#include "src/core/surface/channel.h"
+#include "src/core/surface/server.h"
+#include "src/core/transport/chttp2_transport.h"
+#include "test/core/util/delayed_endpoint.h"
+#include "test/core/util/test_config.h"
+
+#define ONE_WAY_DELAY_MS 10
+#define LINK_BYTES_PER_SECOND (8 * 1024 * 1024)
+#define BULK_MESSAGE_SIZE (1024 * 1024)
+#define UNARY_MESSAGE_SIZE 1024
+/* bytes the bulk upload delivers before the first unary call starts */
+#define WARMUP_BYTES (4 * 1024 * 1024)
+#define NUM_UNARY_CALLS 10
+/* bytes a bulk upload with the connection to itself sends */
+#define ALONE_BYTES (16 * 1024 * 1024)
+
+enum {
+  SERVER_NEW_CALL = 1,
+  BULK_CLIENT_STATUS,
+  BULK_CLIENT_SEND,
+  BULK_CLIENT_CLOSE,
+  BULK_SERVER_RECV,
+  BULK_SERVER_CLOSE,
+  BULK_SERVER_STATUS,
+  UNARY_CLIENT,
+  UNARY_SERVER_RECV,
+  UNARY_SERVER_DONE
+};
+
+static void *tag(gpr_intptr t) { return (void *)t; }
+
+typedef struct {
+  grpc_completion_queue *cq;
+  grpc_server *server;
+  grpc_channel *client;
+} fixture;
+
+static void create_fixture(fixture *f, grpc_channel_args *client_args) {
+  static grpc_channel_filter const *server_filters[] = {
+      &grpc_http_server_filter};
+  static grpc_channel_filter const *client_filters[] = {
+      &grpc_http_client_filter, &grpc_compress_filter,
+      &grpc_connected_channel_filter};
+  grpc_exec_ctx exec_ctx = GRPC_EXEC_CTX_INIT;
+  grpc_endpoint_pair sfd = grpc_iomgr_create_endpoint_pair("delayed", 65536);
+  grpc_mdctx *server_mdctx = grpc_mdctx_create();
+  grpc_mdctx *client_mdctx = grpc_mdctx_create();
+  gpr_timespec delay = gpr_time_from_millis(ONE_WAY_DELAY_MS, GPR_TIMESPAN);
+  grpc_transport *transport;
+
+  f->cq = grpc_completion_queue_create(NULL);
+
+  f->server = grpc_server_create_from_filters(NULL, 0, NULL);
+  grpc_server_register_completion_queue(f->server, f->cq, NULL);
+  grpc_server_start(f->server);
+  transport = grpc_create_chttp2_transport(
+      &exec_ctx, NULL,
+      grpc_delayed_endpoint_create(sfd.server, delay, LINK_BYTES_PER_SECOND),
+      server_mdctx, 0);
+  grpc_server_setup_transport(&exec_ctx, f->server, transport, server_filters,
+                              GPR_ARRAY_SIZE(server_filters), server_mdctx,
+                              grpc_server_get_channel_args(f->server));
+  grpc_chttp2_transport_start_reading(&exec_ctx, transport, NULL, 0);
+
+  transport = grpc_create_chttp2_transport(
+      &exec_ctx, client_args,
+      grpc_delayed_endpoint_create(sfd.client, delay, LINK_BYTES_PER_SECOND),
+      client_mdctx, 1);
+  f->client = grpc_channel_create_from_filters(
+      &exec_ctx, "delayed-target", client_filters,
+      GPR_ARRAY_SIZE(client_filters), client_args, client_mdctx, 1);
+  grpc_connected_channel_bind_transport(
+      grpc_channel_get_channel_stack(f->client), transport);
+  grpc_chttp2_transport_start_reading(&exec_ctx, transport, NULL, 0);
+  grpc_exec_ctx_finish(&exec_ctx);
+}
+
+static void destroy_fixture(fixture *f) {
+  grpc_event ev;
+  grpc_server_shutdown_and_notify(f->server, f->cq, tag(1000));
+  GPR_ASSERT(grpc_completion_queue_pluck(
+                 f->cq, tag(1000), GRPC_TIMEOUT_SECONDS_TO_DEADLINE(5), NULL)
+                 .type == GRPC_OP_COMPLETE);
+  grpc_server_destroy(f->server);
+  grpc_channel_destroy(f->client);
+  grpc_completion_queue_shutdown(f->cq);
+  do {
+    ev = grpc_completion_queue_next(f->cq, GRPC_TIMEOUT_SECONDS_TO_DEADLINE(5),
+                                    NULL);
+  } while (ev.type != GRPC_QUEUE_SHUTDOWN);
+  grpc_completion_queue_destroy(f->cq);
+}
+
+/* All the state of one run; ops point into here, so it must outlive them */
+typedef struct {
+  fixture f;
+  gpr_timespec deadline;
+  gpr_slice bulk_slice;
+  gpr_slice unary_slice;
+
+  grpc_call *server_call;
+  grpc_call_details call_details;
+  grpc_metadata_array request_metadata;
+
+  grpc_call *bulk_client;
+  grpc_call *bulk_server;
+  grpc_byte_buffer *bulk_send;
+  grpc_byte_buffer *bulk_recv;
+  grpc_metadata_array bulk_initial_metadata;
+  grpc_metadata_array bulk_trailing_metadata;
+  grpc_status_code bulk_status;
+  char *bulk_details;
+  size_t bulk_details_capacity;
+  int bulk_cancelled;
+  size_t bulk_bytes_received;
+  int bulk_stop;
+  gpr_timespec bulk_start;
+  double bulk_seconds;
+
+  grpc_call *unary_client;
+  grpc_call *unary_server;
+  grpc_byte_buffer *unary_request;
+  grpc_byte_buffer *unary_request_recv;
+  grpc_byte_buffer *unary_response;
+  grpc_byte_buffer *unary_response_recv;
+  grpc_metadata_array unary_initial_metadata;
+  grpc_metadata_array unary_trailing_metadata;
+  grpc_status_code unary_status;
+  char *unary_details;
+  size_t unary_details_capacity;
+  int unary_cancelled;
+  gpr_timespec unary_start;
+  int unary_calls_done;
+  double max_unary_latency;
+  double total_unary_latency;
+} run_state;
+
+static void start_batch(grpc_call *call, grpc_op *ops, size_t nops,
+                        gpr_intptr t) {
+  size_t i;
+  for (i = 0; i < nops; i++) {
+    ops[i].flags = 0;
+    ops[i].reserved = NULL;
+  }
+  GPR_ASSERT(GRPC_CALL_OK == grpc_call_start_batch(call, ops, nops, tag(t),
+                                                   NULL));
+}
+
+static void request_call(run_state *st) {
+  grpc_metadata_array_destroy(&st->request_metadata);
+  grpc_call_details_destroy(&st->call_details);
+  grpc_metadata_array_init(&st->request_metadata);
+  grpc_call_details_init(&st->call_details);
+  GPR_ASSERT(GRPC_CALL_OK ==
+             grpc_server_request_call(st->f.server, &st->server_call,
+                                      &st->call_details, &st->request_metadata,
+                                      st->f.cq, st->f.cq,
+                                      tag(SERVER_NEW_CALL)));
+}
+
+static void send_bulk_message(run_state *st) {
+  grpc_op op;
+  memset(&op, 0, sizeof(op));
+  st->bulk_send = grpc_raw_byte_buffer_create(&st->bulk_slice, 1);
+  op.op = GRPC_OP_SEND_MESSAGE;
+  op.data.send_message = st->bulk_send;
+  start_batch(st->bulk_client, &op, 1, BULK_CLIENT_SEND);
+}
+
+static void recv_bulk_message(run_state *st) {
+  grpc_op op;
+  memset(&op, 0, sizeof(op));
+  op.op = GRPC_OP_RECV_MESSAGE;
+  op.data.recv_message = &st->bulk_recv;
+  start_batch(st->bulk_server, &op, 1, BULK_SERVER_RECV);
+}
+
+static void start_bulk_call(run_state *st) {
+  grpc_op ops[3];
+  memset(ops, 0, sizeof(ops));
+  st->bulk_client = grpc_channel_create_call(
+      st->f.client, NULL, GRPC_PROPAGATE_DEFAULTS, st->f.cq, "/bulk",
+      "foo.test.google.fr", st->deadline, NULL);
+  ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+  ops[1].op = GRPC_OP_RECV_INITIAL_METADATA;
+  ops[1].data.recv_initial_metadata = &st->bulk_initial_metadata;
+  ops[2].op = GRPC_OP_RECV_STATUS_ON_CLIENT;
+  ops[2].data.recv_status_on_client.trailing_metadata =
+      &st->bulk_trailing_metadata;
+  ops[2].data.recv_status_on_client.status = &st->bulk_status;
+  ops[2].data.recv_status_on_client.status_details = &st->bulk_details;
+  ops[2].data.recv_status_on_client.status_details_capacity =
+      &st->bulk_details_capacity;
+  start_batch(st->bulk_client, ops, 3, BULK_CLIENT_STATUS);
+  send_bulk_message(st);
+}
+
+static void start_unary_call(run_state *st) {
+  grpc_op ops[6];
+  memset(ops, 0, sizeof(ops));
+  grpc_metadata_array_destroy(&st->unary_initial_metadata);
+  grpc_metadata_array_destroy(&st->unary_trailing_metadata);
+  grpc_metadata_array_init(&st->unary_initial_metadata);
+  grpc_metadata_array_init(&st->unary_trailing_metadata);
+  st->unary_start = gpr_now(GPR_CLOCK_MONOTONIC);
+  st->unary_client = grpc_channel_create_call(
+      st->f.client, NULL, GRPC_PROPAGATE_DEFAULTS, st->f.cq, "/unary",
+      "foo.test.google.fr", st->deadline, NULL);
+  st->unary_request = grpc_raw_byte_buffer_create(&st->unary_slice, 1);
+  ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+  ops[1].op = GRPC_OP_SEND_MESSAGE;
+  ops[1].data.send_message = st->unary_request;
+  ops[2].op = GRPC_OP_SEND_CLOSE_FROM_CLIENT;
+  ops[3].op = GRPC_OP_RECV_INITIAL_METADATA;
+  ops[3].data.recv_initial_metadata = &st->unary_initial_metadata;
+  ops[4].op = GRPC_OP_RECV_MESSAGE;
+  ops[4].data.recv_message = &st->unary_response_recv;
+  ops[5].op = GRPC_OP_RECV_STATUS_ON_CLIENT;
+  ops[5].data.recv_status_on_client.trailing_metadata =
+      &st->unary_trailing_metadata;
+  ops[5].data.recv_status_on_client.status = &st->unary_status;
+  ops[5].data.recv_status_on_client.status_details = &st->unary_details;
+  ops[5].data.recv_status_on_client.status_details_capacity =
+      &st->unary_details_capacity;
+  start_batch(st->unary_client, ops, 6, UNARY_CLIENT);
+}
+
+static void on_server_new_call(run_state *st) {
+  grpc_op ops[2];
+  memset(ops, 0, sizeof(ops));
+  if (0 == strcmp(st->call_details.method, "/bulk")) {
+    st->bulk_server = st->server_call;
+    ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+    ops[1].op = GRPC_OP_RECV_CLOSE_ON_SERVER;
+    ops[1].data.recv_close_on_server.cancelled = &st->bulk_cancelled;
+    start_batch(st->bulk_server, ops, 2, BULK_SERVER_CLOSE);
+    recv_bulk_message(st);
+  } else {
+    GPR_ASSERT(0 == strcmp(st->call_details.method, "/unary"));
+    st->unary_server = st->server_call;
+    ops[0].op = GRPC_OP_RECV_MESSAGE;
+    ops[0].data.recv_message = &st->unary_request_recv;
+    start_batch(st->unary_server, ops, 1, UNARY_SERVER_RECV);
+  }
+  request_call(st);
+}
+
+static void on_unary_server_recv(run_state *st) {
+  grpc_op ops[4];
+  memset(ops, 0, sizeof(ops));
+  GPR_ASSERT(st->unary_request_recv != NULL);
+  grpc_byte_buffer_destroy(st->unary_request_recv);
+  st->unary_request_recv = NULL;
+  st->unary_response = grpc_raw_byte_buffer_create(&st->unary_slice, 1);
+  ops[0].op = GRPC_OP_SEND_INITIAL_METADATA;
+  ops[1].op = GRPC_OP_SEND_MESSAGE;
+  ops[1].data.send_message = st->unary_response;
+  ops[2].op = GRPC_OP_SEND_STATUS_FROM_SERVER;
+  ops[2].data.send_status_from_server.status = GRPC_STATUS_OK;
+  ops[2].data.send_status_from_server.status_details = "ok";
+  ops[3].op = GRPC_OP_RECV_CLOSE_ON_SERVER;
+  ops[3].data.recv_close_on_server.cancelled = &st->unary_cancelled;
+  start_batch(st->unary_server, ops, 4, UNARY_SERVER_DONE);
+}
+
+static void on_unary_client_done(run_state *st) {
+  gpr_timespec latency =
+      gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), st->unary_start);
+  double latency_s = (double)latency.tv_sec + 1e-9 * (double)latency.tv_nsec;
+  GPR_ASSERT(st->unary_status == GRPC_STATUS_OK);
+  GPR_ASSERT(st->unary_response_recv != NULL);
+  grpc_byte_buffer_destroy(st->unary_request);
+  grpc_byte_buffer_destroy(st->unary_response_recv);
+  st->unary_response_recv = NULL;
+  grpc_call_destroy(st->unary_client);
+  st->max_unary_latency = GPR_MAX(st->max_unary_latency, latency_s);
+  st->total_unary_latency += latency_s;
+  st->unary_calls_done++;
+  if (st->unary_calls_done < NUM_UNARY_CALLS) {
+    start_unary_call(st);
+  } else {
+    st->bulk_stop = 1;
+  }
+}
+
+typedef struct {
+  double max_unary_latency;
+  double mean_unary_latency;
+  double bulk_bytes_per_second;
+} run_result;
+
+/* Runs NUM_UNARY_CALLS unary calls one after another while a bulk upload
+   saturates the connection, or if with_unary_calls is zero just lets the
+   bulk upload send ALONE_BYTES; latencies are in seconds. */
+static run_result run(int write_quantum, int with_unary_calls) {
+  grpc_arg arg;
+  grpc_channel_args client_args;
+  run_state st;
+  grpc_event ev;
+  grpc_op op;
+  int pending = 4; /* both ends of both calls complete */
+  int unary_started = 0;
+  run_result result;
+  gpr_timespec elapsed;
+
+  memset(&st, 0, sizeof(st));
+  arg.type = GRPC_ARG_INTEGER;
+  arg.key = GRPC_ARG_HTTP2_WRITE_QUANTUM;
+  arg.value.integer = write_quantum;
+  client_args.num_args = 1;
+  client_args.args = &arg;
+  create_fixture(&st.f, &client_args);
+  st.deadline = GRPC_TIMEOUT_SECONDS_TO_DEADLINE(60);
+  st.bulk_slice = gpr_slice_malloc(BULK_MESSAGE_SIZE);
+  memset(GPR_SLICE_START_PTR(st.bulk_slice), 'b', BULK_MESSAGE_SIZE);
+  st.unary_slice = gpr_slice_malloc(UNARY_MESSAGE_SIZE);
+  memset(GPR_SLICE_START_PTR(st.unary_slice), 'u', UNARY_MESSAGE_SIZE);
+  grpc_metadata_array_init(&st.bulk_initial_metadata);
+  grpc_metadata_array_init(&st.bulk_trailing_metadata);
+  grpc_metadata_array_init(&st.unary_initial_metadata);
+  grpc_metadata_array_init(&st.unary_trailing_metadata);
+  grpc_metadata_array_init(&st.request_metadata);
+  grpc_call_details_init(&st.call_details);
+
+  request_call(&st);
+  st.bulk_start = gpr_now(GPR_CLOCK_MONOTONIC);
+  start_bulk_call(&st);
+
+  while (pending > 0) {
+    ev = grpc_completion_queue_next(st.f.cq, st.deadline, NULL);
+    GPR_ASSERT(ev.type == GRPC_OP_COMPLETE);
+    GPR_ASSERT(ev.success);
+    switch ((gpr_intptr)ev.tag) {
+      case SERVER_NEW_CALL:
+        on_server_new_call(&st);
+        break;
+      case BULK_CLIENT_SEND:
+        grpc_byte_buffer_destroy(st.bulk_send);
+        if (!st.bulk_stop) {
+          send_bulk_message(&st);
+        } else {
+          memset(&op, 0, sizeof(op));
+          op.op = GRPC_OP_SEND_CLOSE_FROM_CLIENT;
+          start_batch(st.bulk_client, &op, 1, BULK_CLIENT_CLOSE);
+        }
+        break;
+      case BULK_SERVER_RECV:
+        if (st.bulk_recv == NULL) {
+          memset(&op, 0, sizeof(op));
+          op.op = GRPC_OP_SEND_STATUS_FROM_SERVER;
+          op.data.send_status_from_server.status = GRPC_STATUS_OK;
+          op.data.send_status_from_server.status_details = "ok";
+          start_batch(st.bulk_server, &op, 1, BULK_SERVER_STATUS);
+          break;
+        }
+        st.bulk_bytes_received += grpc_byte_buffer_length(st.bulk_recv);
+        grpc_byte_buffer_destroy(st.bulk_recv);
+        st.bulk_recv = NULL;
+        recv_bulk_message(&st);
+        if (!with_unary_calls) {
+          if (!st.bulk_stop && st.bulk_bytes_received >= ALONE_BYTES) {
+            elapsed = gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), st.bulk_start);
+            st.bulk_seconds =
+                (double)elapsed.tv_sec + 1e-9 * (double)elapsed.tv_nsec;
+            st.bulk_stop = 1;
+          }
+        } else if (!unary_started && st.bulk_bytes_received >= WARMUP_BYTES) {
+          unary_started = 1;
+          start_unary_call(&st);
+        }
+        break;
+      case UNARY_SERVER_RECV:
+        on_unary_server_recv(&st);
+        break;
+      case UNARY_SERVER_DONE:
+        grpc_byte_buffer_destroy(st.unary_response);
+        grpc_call_destroy(st.unary_server);
+        break;
+      case UNARY_CLIENT:
+        on_unary_client_done(&st);
+        break;
+      case BULK_CLIENT_STATUS:
+        GPR_ASSERT(st.bulk_status == GRPC_STATUS_OK);
+        pending--;
+        break;
+      case BULK_CLIENT_CLOSE:
+      case BULK_SERVER_CLOSE:
+      case BULK_SERVER_STATUS:
+        pending--;
+        break;
+      default:
+        GPR_ASSERT(0);
+    }
+  }
+
+  grpc_call_destroy(st.bulk_client);
+  grpc_call_destroy(st.bulk_server);
+  gpr_free(st.bulk_details);
+  gpr_free(st.unary_details);
+  grpc_metadata_array_destroy(&st.bulk_initial_metadata);
+  grpc_metadata_array_destroy(&st.bulk_trailing_metadata);
+  grpc_metadata_array_destroy(&st.unary_initial_metadata);
+  grpc_metadata_array_destroy(&st.unary_trailing_metadata);
+  gpr_slice_unref(st.bulk_slice);
+  gpr_slice_unref(st.unary_slice);
+  destroy_fixture(&st.f);
+  grpc_metadata_array_destroy(&st.request_metadata);
+  grpc_call_details_destroy(&st.call_details);
+
+  memset(&result, 0, sizeof(result));
+  if (with_unary_calls) {
+    result.max_unary_latency = st.max_unary_latency;
+    result.mean_unary_latency = st.total_unary_latency / NUM_UNARY_CALLS;
+  } else {
+    result.bulk_bytes_per_second =
+        (double)st.bulk_bytes_received / st.bulk_seconds;
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+  run_result greedy, fair;
+  /* a unary call needs two round trips (request, response) plus some slack
+     for the machine */
+  const double bound = 8 * 2 * ONE_WAY_DELAY_MS * 1e-3;
+
+  grpc_test_init(argc, argv);
+  grpc_init();
+
+  greedy = run(0, 1);
+  fair = run(16384, 1);
+  gpr_log(GPR_INFO,
+          "unary latency under a bulk upload with %dms one way delay: "
+          "greedy writes mean %.3fs max %.3fs, round robin writes mean %.3fs "
+          "max %.3fs",
+          ONE_WAY_DELAY_MS, greedy.mean_unary_latency,
+          greedy.max_unary_latency, fair.mean_unary_latency,
+          fair.max_unary_latency);
+  GPR_ASSERT(fair.max_unary_latency < bound * GRPC_TEST_SLOWDOWN_FACTOR);
+  GPR_ASSERT(fair.mean_unary_latency < greedy.mean_unary_latency);
+
+  /* with nobody to share with, the quantum must not get in the way */
+  greedy = run(0, 0);
+  fair = run(16384, 0);
+  gpr_log(GPR_INFO,
+          "lone bulk upload with %dms one way delay: greedy writes %.2fMB/s, "
+          "round robin writes %.2fMB/s",
+          ONE_WAY_DELAY_MS, greedy.bulk_bytes_per_second / (1024 * 1024),
+          fair.bulk_bytes_per_second / (1024 * 1024));
+  GPR_ASSERT(fair.bulk_bytes_per_second > 0.9 * greedy.bulk_bytes_per_second);
+
+  grpc_shutdown();
+  return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "src/core/tsi/ssl_transport_security.h"
+
+#include <string.h>
+
+#include <grpc/support/log.h>
+#include <grpc/support/time.h>
+
+#include "test/core/end2end/data/ssl_test_data.h"
+#include "test/core/util/test_config.h"
+
+#define SSL_TARGET_NAME "foo.test.google.fr"
+#define NUM_TIMED_HANDSHAKES 50
+
+static const unsigned char *alpn_protocol = (const unsigned char *)"h2";
+static const unsigned char alpn_protocol_length = 2;
+
+static tsi_ssl_handshaker_factory *create_client_factory(
+    size_t session_cache_size) {
+  tsi_ssl_handshaker_factory *factory = NULL;
+  tsi_ssl_session_cache_options options;
+  GPR_ASSERT(tsi_create_ssl_client_handshaker_factory(
+                 NULL, 0, NULL, 0, (const unsigned char *)test_root_cert,
+                 strlen(test_root_cert), NULL, &alpn_protocol,
+                 &alpn_protocol_length, 1, &factory) == TSI_OK);
+  memset(&options, 0, sizeof(options));
+  options.session_cache_size = session_cache_size;
+  GPR_ASSERT(tsi_ssl_handshaker_factory_set_session_cache_options(
+                 factory, &options) == TSI_OK);
+  return factory;
+}
+
+static tsi_ssl_handshaker_factory *create_server_factory(
+    int enable_session_tickets) {
+  tsi_ssl_handshaker_factory *factory = NULL;
+  tsi_ssl_session_cache_options options;
+  const unsigned char *key = (const unsigned char *)test_server1_key;
+  const unsigned char *cert = (const unsigned char *)test_server1_cert;
+  size_t key_size = strlen(test_server1_key);
+  size_t cert_size = strlen(test_server1_cert);
+  GPR_ASSERT(tsi_create_ssl_server_handshaker_factory(
+                 &key, &key_size, &cert, &cert_size, 1, NULL, 0, 0, NULL,
+                 &alpn_protocol, &alpn_protocol_length, 1,
+                 &factory) == TSI_OK);
+  memset(&options, 0, sizeof(options));
+  options.session_cache_size = 128;
+  options.enable_session_tickets = enable_session_tickets;
+  GPR_ASSERT(tsi_ssl_handshaker_factory_set_session_cache_options(
+                 factory, &options) == TSI_OK);
+  return factory;
+}
+
+/* Moves everything the sender has to say into the receiver. Returns the number
+   of bytes moved. */
+static size_t transfer_handshake_bytes(tsi_handshaker *from,
+                                       tsi_handshaker *to) {
+  unsigned char buf[4096];
+  size_t moved = 0;
+  tsi_result result;
+  do {
+    size_t buf_size = sizeof(buf);
+    size_t consumed;
+    result = tsi_handshaker_get_bytes_to_send_to_peer(from, buf, &buf_size);
+    GPR_ASSERT(result == TSI_OK || result == TSI_INCOMPLETE_DATA);
+    if (buf_size == 0) break;
+    consumed = buf_size;
+    result = tsi_handshaker_process_bytes_from_peer(to, buf, &consumed);
+    GPR_ASSERT(result == TSI_OK || result == TSI_INCOMPLETE_DATA);
+    GPR_ASSERT(consumed == buf_size);
+    moved += buf_size;
+  } while (1);
+  return moved;
+}
+
+/* Sends one protected message from the server to the client. With TLS 1.3 the
+   session tickets follow the handshake and only reach the client session
+   cache once the client reads application data. */
+static void exchange_application_data(tsi_frame_protector *server,
+                                      tsi_frame_protector *client) {
+  static const char message[] = "ping";
+  unsigned char frames[16384];
+  unsigned char out[64];
+  size_t message_size = sizeof(message);
+  size_t frames_size = sizeof(frames);
+  size_t flushed_size;
+  size_t still_pending = 0;
+  size_t offset = 0;
+  size_t received = 0;
+  GPR_ASSERT(tsi_frame_protector_protect(
+                 server, (const unsigned char *)message, &message_size, frames,
+                 &frames_size) == TSI_OK);
+  GPR_ASSERT(message_size == sizeof(message));
+  offset = frames_size;
+  do {
+    flushed_size = sizeof(frames) - offset;
+    GPR_ASSERT(tsi_frame_protector_protect_flush(server, frames + offset,
+                                                 &flushed_size,
+                                                 &still_pending) == TSI_OK);
+    offset += flushed_size;
+  } while (still_pending > 0);
+  frames_size = offset;
+  offset = 0;
+  while (offset < frames_size) {
+    size_t consumed = frames_size - offset;
+    size_t out_size = sizeof(out) - received;
+    GPR_ASSERT(tsi_frame_protector_unprotect(client, frames + offset,
+                                             &consumed, out + received,
+                                             &out_size) == TSI_OK);
+    offset += consumed;
+    received += out_size;
+  }
+  GPR_ASSERT(received == sizeof(message));
+  GPR_ASSERT(memcmp(out, message, sizeof(message)) == 0);
+}
+
+/* Runs a client/server handshake in memory and returns 1 if the client
+   resumed a previous session. */
+static int do_handshake(tsi_ssl_handshaker_factory *client_factory,
+                        tsi_ssl_handshaker_factory *server_factory) {
+  tsi_handshaker *client = NULL;
+  tsi_handshaker *server = NULL;
+  tsi_frame_protector *client_protector = NULL;
+  tsi_frame_protector *server_protector = NULL;
+  tsi_peer peer;
+  size_t i;
+  int reused = -1;
+
+  GPR_ASSERT(tsi_ssl_handshaker_factory_create_handshaker(
+                 client_factory, SSL_TARGET_NAME, &client) == TSI_OK);
+  GPR_ASSERT(tsi_ssl_handshaker_factory_create_handshaker(
+                 server_factory, NULL, &server) == TSI_OK);
+  while (tsi_handshaker_is_in_progress(client) ||
+         tsi_handshaker_is_in_progress(server)) {
+    size_t moved = transfer_handshake_bytes(client, server);
+    moved += transfer_handshake_bytes(server, client);
+    GPR_ASSERT(moved > 0);
+  }
+  GPR_ASSERT(tsi_handshaker_get_result(client) == TSI_OK);
+  GPR_ASSERT(tsi_handshaker_get_result(server) == TSI_OK);
+
+  GPR_ASSERT(tsi_handshaker_extract_peer(client, &peer) == TSI_OK);
+  for (i = 0; i < peer.property_count; i++) {
+    const tsi_peer_property *property = &peer.properties[i];
+    if (strcmp(property->name, TSI_SSL_SESSION_REUSED_PEER_PROPERTY) == 0) {
+      reused = property->value.length == 4 &&
+               memcmp(property->value.data, "true", 4) == 0;
+    }
+  }
+  tsi_peer_destruct(&peer);
+  GPR_ASSERT(reused != -1);
+
+  GPR_ASSERT(tsi_handshaker_create_frame_protector(
+                 server, NULL, &server_protector) == TSI_OK);
+  GPR_ASSERT(tsi_handshaker_create_frame_protector(
+                 client, NULL, &client_protector) == TSI_OK);
+  exchange_application_data(server_protector, client_protector);
+
+  tsi_frame_protector_destroy(client_protector);
+  tsi_frame_protector_destroy(server_protector);
+  tsi_handshaker_destroy(client);
+  tsi_handshaker_destroy(server);
+  return reused;
+}
+
+static void test_resumption(int enable_session_tickets) {
+  tsi_ssl_handshaker_factory *client_factory = create_client_factory(16);
+  tsi_ssl_handshaker_factory *server_factory =
+      create_server_factory(enable_session_tickets);
+  GPR_ASSERT(!do_handshake(client_factory, server_factory));
+  GPR_ASSERT(do_handshake(client_factory, server_factory));
+  GPR_ASSERT(do_handshake(client_factory, server_factory));
+  tsi_ssl_handshaker_factory_destroy(client_factory);
+  tsi_ssl_handshaker_factory_destroy(server_factory);
+}
+
+static void test_resumption_disabled(void) {
+  tsi_ssl_handshaker_factory *client_factory = create_client_factory(0);
+  tsi_ssl_handshaker_factory *server_factory = create_server_factory(1);
+  GPR_ASSERT(!do_handshake(client_factory, server_factory));
+  GPR_ASSERT(!do_handshake(client_factory, server_factory));
+  tsi_ssl_handshaker_factory_destroy(client_factory);
+  tsi_ssl_handshaker_factory_destroy(server_factory);
+}
+
+static double time_handshakes_us(size_t session_cache_size) {
+  tsi_ssl_handshaker_factory *client_factory =
+      create_client_factory(session_cache_size);
+  tsi_ssl_handshaker_factory *server_factory = create_server_factory(1);
+  gpr_timespec start;
+  gpr_timespec elapsed;
+  int i;
+  /* Warm up so that the timed handshakes start with a cached session. */
+  do_handshake(client_factory, server_factory);
+  start = gpr_now(GPR_CLOCK_MONOTONIC);
+  for (i = 0; i < NUM_TIMED_HANDSHAKES; i++) {
+    GPR_ASSERT(do_handshake(client_factory, server_factory) ==
+               (session_cache_size > 0));
+  }
+  elapsed = gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), start);
+  tsi_ssl_handshaker_factory_destroy(client_factory);
+  tsi_ssl_handshaker_factory_destroy(server_factory);
+  return (1e6 * (double)elapsed.tv_sec + 1e-3 * elapsed.tv_nsec) /
+         NUM_TIMED_HANDSHAKES;
+}
+
+static void test_handshake_cost(void) {
+  double full_us = time_handshakes_us(0);
+  double resumed_us = time_handshakes_us(16);
+  gpr_log(GPR_INFO, "full handshake: %.1fus, resumed handshake: %.1fus",
+          full_us, resumed_us);
+}
+
+int main(int argc, char **argv) {
+  grpc_test_init(argc, argv);
+  test_resumption(1);
+  test_resumption(0);
+  test_resumption_disabled();
+  test_handshake_cost();
+  return 0;
+}
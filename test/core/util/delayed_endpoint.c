@@ -0,0 +1,309 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "test/core/util/delayed_endpoint.h"
+
+#include <string.h>
+
+#include <grpc/support/alloc.h>
+#include <grpc/support/sync.h>
+
+#include "src/core/iomgr/alarm.h"
+
+/* Bandwidth-limited links send in chunks of this size, so that the start of a
+   large write reaches the reader before the write completes */
+#define LINK_CHUNK_SIZE 16384
+
+typedef struct delayed_write {
+  gpr_slice_buffer slices;
+  /* when the last byte has left the sender: the write completes then */
+  gpr_timespec departed;
+  /* when the last byte reaches the wrapped endpoint */
+  gpr_timespec due;
+  /* completion still owed to the writer, or NULL */
+  grpc_closure *cb;
+  struct delayed_write *next;
+} delayed_write;
+
+typedef struct {
+  grpc_endpoint base;
+  grpc_endpoint *wrapped;
+  gpr_timespec delay;
+  double bytes_per_second;
+  gpr_mu mu;
+  gpr_refcount refs;
+  delayed_write *head;
+  delayed_write *tail;
+  /* when the link finishes sending what has been queued so far */
+  gpr_timespec link_free;
+  /* slices handed to the wrapped endpoint */
+  gpr_slice_buffer writing;
+  int write_in_flight;
+  int alarm_pending;
+  int shutdown;
+  grpc_alarm alarm;
+  grpc_closure write_done;
+} delayed_endpoint;
+
+static void de_unref(grpc_exec_ctx *exec_ctx, delayed_endpoint *de) {
+  delayed_write *w;
+  if (!gpr_unref(&de->refs)) return;
+  while ((w = de->head) != NULL) {
+    de->head = w->next;
+    gpr_slice_buffer_destroy(&w->slices);
+    gpr_free(w);
+  }
+  gpr_slice_buffer_destroy(&de->writing);
+  grpc_endpoint_destroy(exec_ctx, de->wrapped);
+  gpr_mu_destroy(&de->mu);
+  gpr_free(de);
+}
+
+static void on_alarm(grpc_exec_ctx *exec_ctx, void *arg, int success);
+
+/* Completes the writes that have left the sender and hands the ones that
+   have arrived to the wrapped endpoint; then arms the alarm for whichever of
+   those happens next. Departure and arrival times both grow along the queue,
+   and a write always departs before it arrives. */
+static void flush_locked(grpc_exec_ctx *exec_ctx, delayed_endpoint *de) {
+  gpr_timespec now = gpr_now(GPR_CLOCK_MONOTONIC);
+  gpr_timespec next = gpr_inf_future(GPR_CLOCK_MONOTONIC);
+  delayed_write *w;
+  if (de->shutdown) return;
+  for (w = de->head; w != NULL; w = w->next) {
+    if (w->cb == NULL) continue;
+    if (gpr_time_cmp(w->departed, now) > 0) {
+      next = w->departed;
+      break;
+    }
+    grpc_exec_ctx_enqueue(exec_ctx, w->cb, 1);
+    w->cb = NULL;
+  }
+  if (de->write_in_flight) return;
+  while ((w = de->head) != NULL && gpr_time_cmp(w->due, now) <= 0) {
+    de->head = w->next;
+    if (de->head == NULL) de->tail = NULL;
+    gpr_slice_buffer_move_into(&w->slices, &de->writing);
+    gpr_slice_buffer_destroy(&w->slices);
+    gpr_free(w);
+  }
+  if (de->writing.count > 0) {
+    de->write_in_flight = 1;
+    gpr_ref(&de->refs);
+    grpc_endpoint_write(exec_ctx, de->wrapped, &de->writing, &de->write_done);
+  } else if (de->head != NULL) {
+    next = gpr_time_min(next, de->head->due);
+  }
+  if (!de->alarm_pending &&
+      gpr_time_cmp(next, gpr_inf_future(GPR_CLOCK_MONOTONIC)) != 0) {
+    de->alarm_pending = 1;
+    gpr_ref(&de->refs);
+    grpc_alarm_init(exec_ctx, &de->alarm, next, on_alarm, de, now);
+  }
+}
+
+/* Stops the link and fails the writes still owed a completion. Returns
+   whether the alarm needs cancelling, which must be done without mu. */
+static int shutdown_locked(grpc_exec_ctx *exec_ctx, delayed_endpoint *de) {
+  delayed_write *w;
+  de->shutdown = 1;
+  for (w = de->head; w != NULL; w = w->next) {
+    if (w->cb != NULL) {
+      grpc_exec_ctx_enqueue(exec_ctx, w->cb, 0);
+      w->cb = NULL;
+    }
+  }
+  return de->alarm_pending;
+}
+
+static void on_alarm(grpc_exec_ctx *exec_ctx, void *arg, int success) {
+  delayed_endpoint *de = arg;
+  gpr_mu_lock(&de->mu);
+  de->alarm_pending = 0;
+  /* a failed alarm is a cancelled one, or iomgr shutting down: nothing will
+     move the queue any more */
+  if (success) {
+    flush_locked(exec_ctx, de);
+  } else {
+    shutdown_locked(exec_ctx, de);
+  }
+  gpr_mu_unlock(&de->mu);
+  de_unref(exec_ctx, de);
+}
+
+static void on_write_done(grpc_exec_ctx *exec_ctx, void *arg, int success) {
+  delayed_endpoint *de = arg;
+  int cancel_alarm = 0;
+  gpr_mu_lock(&de->mu);
+  de->write_in_flight = 0;
+  gpr_slice_buffer_reset_and_unref(&de->writing);
+  if (success) {
+    flush_locked(exec_ctx, de);
+  } else {
+    cancel_alarm = shutdown_locked(exec_ctx, de);
+  }
+  gpr_mu_unlock(&de->mu);
+  if (cancel_alarm) grpc_alarm_cancel(exec_ctx, &de->alarm);
+  de_unref(exec_ctx, de);
+}
+
+static void de_read(grpc_exec_ctx *exec_ctx, grpc_endpoint *ep,
+                    gpr_slice_buffer *slices, grpc_closure *cb) {
+  delayed_endpoint *de = (delayed_endpoint *)ep;
+  grpc_endpoint_read(exec_ctx, de->wrapped, slices, cb);
+}
+
+static delayed_write *new_write(void) {
+  delayed_write *w = gpr_malloc(sizeof(*w));
+  gpr_slice_buffer_init(&w->slices);
+  w->cb = NULL;
+  w->next = NULL;
+  return w;
+}
+
+static void append_locked(delayed_endpoint *de, delayed_write *w,
+                          gpr_timespec now) {
+  w->departed = now;
+  if (de->bytes_per_second > 0) {
+    w->departed = gpr_time_add(
+        gpr_time_max(now, de->link_free),
+        gpr_time_from_micros(
+            (long)(1e6 * (double)w->slices.length / de->bytes_per_second),
+            GPR_TIMESPAN));
+    de->link_free = w->departed;
+  }
+  w->due = gpr_time_add(w->departed, de->delay);
+  if (de->tail != NULL) {
+    de->tail->next = w;
+  } else {
+    de->head = w;
+  }
+  de->tail = w;
+}
+
+static void de_write(grpc_exec_ctx *exec_ctx, grpc_endpoint *ep,
+                     gpr_slice_buffer *slices, grpc_closure *cb) {
+  delayed_endpoint *de = (delayed_endpoint *)ep;
+  gpr_timespec now = gpr_now(GPR_CLOCK_MONOTONIC);
+  delayed_write *w;
+  gpr_slice s;
+  size_t i;
+
+  gpr_mu_lock(&de->mu);
+  if (de->shutdown) {
+    gpr_mu_unlock(&de->mu);
+    gpr_slice_buffer_reset_and_unref(slices);
+    grpc_exec_ctx_enqueue(exec_ctx, cb, 0);
+    return;
+  }
+  w = new_write();
+  if (de->bytes_per_second <= 0) {
+    gpr_slice_buffer_move_into(slices, &w->slices);
+    append_locked(de, w, now);
+    grpc_exec_ctx_enqueue(exec_ctx, cb, 1);
+  } else {
+    /* cut the write into chunks that arrive one after another */
+    for (i = 0; i < slices->count; i++) {
+      s = gpr_slice_ref(slices->slices[i]);
+      while (w->slices.length + GPR_SLICE_LENGTH(s) > LINK_CHUNK_SIZE) {
+        gpr_slice_buffer_add(
+            &w->slices,
+            gpr_slice_split_head(&s, LINK_CHUNK_SIZE - w->slices.length));
+        append_locked(de, w, now);
+        w = new_write();
+      }
+      if (GPR_SLICE_LENGTH(s) > 0) {
+        gpr_slice_buffer_add(&w->slices, s);
+      } else {
+        gpr_slice_unref(s);
+      }
+    }
+    gpr_slice_buffer_reset_and_unref(slices);
+    w->cb = cb;
+    append_locked(de, w, now);
+  }
+  flush_locked(exec_ctx, de);
+  gpr_mu_unlock(&de->mu);
+}
+
+static void de_add_to_pollset(grpc_exec_ctx *exec_ctx, grpc_endpoint *ep,
+                              grpc_pollset *pollset) {
+  delayed_endpoint *de = (delayed_endpoint *)ep;
+  grpc_endpoint_add_to_pollset(exec_ctx, de->wrapped, pollset);
+}
+
+static void de_add_to_pollset_set(grpc_exec_ctx *exec_ctx, grpc_endpoint *ep,
+                                  grpc_pollset_set *pollset_set) {
+  delayed_endpoint *de = (delayed_endpoint *)ep;
+  grpc_endpoint_add_to_pollset_set(exec_ctx, de->wrapped, pollset_set);
+}
+
+static void de_shutdown(grpc_exec_ctx *exec_ctx, grpc_endpoint *ep) {
+  delayed_endpoint *de = (delayed_endpoint *)ep;
+  int cancel_alarm;
+  gpr_mu_lock(&de->mu);
+  cancel_alarm = shutdown_locked(exec_ctx, de);
+  gpr_mu_unlock(&de->mu);
+  if (cancel_alarm) grpc_alarm_cancel(exec_ctx, &de->alarm);
+  grpc_endpoint_shutdown(exec_ctx, de->wrapped);
+}
+
+static void de_destroy(grpc_exec_ctx *exec_ctx, grpc_endpoint *ep) {
+  de_unref(exec_ctx, (delayed_endpoint *)ep);
+}
+
+static char *de_get_peer(grpc_endpoint *ep) {
+  delayed_endpoint *de = (delayed_endpoint *)ep;
+  return grpc_endpoint_get_peer(de->wrapped);
+}
+
+static const grpc_endpoint_vtable delayed_endpoint_vtable = {
+    de_read, de_write, de_add_to_pollset, de_add_to_pollset_set,
+    de_shutdown, de_destroy, de_get_peer};
+
+grpc_endpoint *grpc_delayed_endpoint_create(grpc_endpoint *wrapped,
+                                            gpr_timespec delay,
+                                            double bytes_per_second) {
+  delayed_endpoint *de = gpr_malloc(sizeof(*de));
+  memset(de, 0, sizeof(*de));
+  de->base.vtable = &delayed_endpoint_vtable;
+  de->wrapped = wrapped;
+  de->delay = delay;
+  de->bytes_per_second = bytes_per_second;
+  de->link_free = gpr_now(GPR_CLOCK_MONOTONIC);
+  gpr_mu_init(&de->mu);
+  gpr_ref_init(&de->refs, 1);
+  gpr_slice_buffer_init(&de->writing);
+  grpc_closure_init(&de->write_done, on_write_done, de);
+  return &de->base;
+}
@@ -775,6 +775,36 @@ TEST_P(End2endTest, NonExistingService) {
   EXPECT_EQ("", s.error_message());
 }
 
+// Metadata echoed by the server is visible through both the multimap and the
+// flat accessors.
+TEST_P(End2endTest, FlatMetadataAccessors) {
+  ResetStub();
+  EchoRequest request;
+  EchoResponse response;
+  request.set_message("Hello");
+  request.mutable_param()->set_echo_metadata(true);
+
+  ClientContext context;
+  const char kBinaryValue[] = "\x00\x01\x02";
+  for (int i = 0; i < 10; i++) {
+    context.AddMetadata("key" + std::to_string(i), "value" + std::to_string(i));
+  }
+  context.AddMetadata("key-bin", grpc::string(kBinaryValue, 3));
+  Status s = stub_->Echo(&context, request, &response);
+  EXPECT_TRUE(s.ok());
+
+  const IncomingMetadata& trailing = context.incoming_trailing_metadata();
+  EXPECT_EQ(context.GetServerTrailingMetadata().size(), trailing.size());
+  grpc::string_ref value;
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(trailing.Find("key" + std::to_string(i), &value));
+    EXPECT_EQ("value" + std::to_string(i), ToString(value));
+  }
+  EXPECT_TRUE(trailing.Find("key-bin", &value));
+  EXPECT_EQ(grpc::string(kBinaryValue, 3), ToString(value));
+  EXPECT_FALSE(trailing.Find("missing", &value));
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Test with and without a proxy.
 class ProxyEnd2endTest : public End2endTest {
@@ -33,6 +33,7 @@
 
 #include <mutex>
 #include <thread>
+#include <vector>
 #include <time.h>
 
 #include <grpc++/channel.h>
@@ -43,6 +44,7 @@
 #include <grpc++/server.h>
 #include <grpc++/server_builder.h>
 #include <grpc++/server_context.h>
+#include <grpc++/support/channel_arguments.h>
 #include <grpc/grpc.h>
 #include <grpc/support/atm.h>
 #include <grpc/support/thd.h>
@@ -193,6 +195,173 @@ TEST_F(End2endTest, StreamingThroughput) {
   receiver.join();
 }
 
+// Reads as fast as possible, so that throughput is bound by the transport
+// rather than by the service.
+class DrainingServiceImpl
+    : public ::grpc::cpp::test::util::TestService::Service {
+ public:
+  Status BidiStream(ServerContext* context,
+                    ServerReaderWriter<EchoResponse, EchoRequest>* stream)
+      GRPC_OVERRIDE {
+    EchoRequest request;
+    while (stream->Read(&request)) {
+    }
+    return Status::OK;
+  }
+};
+
+// Runs several client streams concurrently over one channel whose subchannel
+// may open up to GetParam() connections.
+class PooledStreamingThroughputTest : public ::testing::TestWithParam<int> {
+ protected:
+  static const int kNumStreams = 8;
+  static const int kMessagesPerStream = 2000;
+
+  void SetUp() GRPC_OVERRIDE {
+    int port = grpc_pick_unused_port_or_die();
+    server_address_ << "127.0.0.1:" << port;
+    ServerBuilder builder;
+    builder.AddListeningPort(server_address_.str(),
+                             InsecureServerCredentials());
+    builder.RegisterService(&service_);
+    server_ = builder.BuildAndStart();
+
+    ChannelArguments args;
+    args.SetInt(GRPC_ARG_MAX_SUBCHANNEL_CONNECTIONS, GetParam());
+    std::shared_ptr<Channel> channel = CreateCustomChannel(
+        server_address_.str(), InsecureCredentials(), args);
+    stub_ = grpc::cpp::test::util::TestService::NewStub(channel);
+  }
+
+  void TearDown() GRPC_OVERRIDE { server_->Shutdown(); }
+
+  static void SendStream(grpc::cpp::test::util::TestService::Stub* stub) {
+    grpc::ClientContext context;
+    auto stream = stub->BidiStream(&context);
+    EchoRequest request;
+    request.set_message(kLargeString);
+    for (int i = 0; i < kMessagesPerStream; i++) {
+      ASSERT_TRUE(stream->Write(request));
+    }
+    stream->WritesDone();
+    EXPECT_TRUE(stream->Finish().ok());
+  }
+
+  std::unique_ptr<grpc::cpp::test::util::TestService::Stub> stub_;
+  std::unique_ptr<Server> server_;
+  std::ostringstream server_address_;
+  DrainingServiceImpl service_;
+};
+
+TEST_P(PooledStreamingThroughputTest, ConcurrentStreams) {
+  // Warm up the pool: busy connections make new calls open more of them.
+  SendStream(stub_.get());
+
+  gpr_timespec start = gpr_now(GPR_CLOCK_MONOTONIC);
+  std::vector<std::thread> senders;
+  for (int i = 0; i < kNumStreams; i++) {
+    senders.push_back(std::thread(SendStream, stub_.get()));
+  }
+  for (auto& sender : senders) {
+    sender.join();
+  }
+  double elapsed = gpr_timespec_to_micros(
+                       gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), start)) /
+                   1e6;
+  gpr_log(GPR_INFO, "%d connections: %.0f messages/s", GetParam(),
+          kNumStreams * kMessagesPerStream / elapsed);
+}
+
+INSTANTIATE_TEST_CASE_P(PooledStreamingThroughputTest,
+                        PooledStreamingThroughputTest,
+                        ::testing::Values(1, 2, 4));
+
+// Reads as fast as possible, then reports how many messages it got.
+class CountingServiceImpl
+    : public ::grpc::cpp::test::util::TestService::Service {
+ public:
+  Status BidiStream(ServerContext* context,
+                    ServerReaderWriter<EchoResponse, EchoRequest>* stream)
+      GRPC_OVERRIDE {
+    EchoRequest request;
+    int count = 0;
+    while (stream->Read(&request)) {
+      count++;
+    }
+    EchoResponse response;
+    response.set_message(std::to_string(count));
+    stream->Write(response);
+    return Status::OK;
+  }
+};
+
+// Streams many small messages from the client, either one blocking Write at
+// a time or in batches through WriteAll, whose buffered writes complete
+// without waiting on the transport.
+class PipelinedStreamingThroughputTest : public ::testing::Test {
+ protected:
+  static const int kMessages = 10000;
+  static const int kMessagesPerBatch = 100;
+
+  void SetUp() GRPC_OVERRIDE {
+    int port = grpc_pick_unused_port_or_die();
+    server_address_ << "127.0.0.1:" << port;
+    ServerBuilder builder;
+    builder.AddListeningPort(server_address_.str(),
+                             InsecureServerCredentials());
+    builder.RegisterService(&service_);
+    server_ = builder.BuildAndStart();
+    std::shared_ptr<Channel> channel =
+        CreateChannel(server_address_.str(), InsecureCredentials());
+    stub_ = grpc::cpp::test::util::TestService::NewStub(channel);
+  }
+
+  void TearDown() GRPC_OVERRIDE { server_->Shutdown(); }
+
+  // Returns messages/s
+  double SendStream(bool write_all) {
+    grpc::ClientContext context;
+    auto stream = stub_->BidiStream(&context);
+    std::vector<EchoRequest> batch(kMessagesPerBatch);
+    for (size_t i = 0; i < batch.size(); i++) {
+      batch[i].set_message("a small chunk of a much larger file: " +
+                           std::to_string(i));
+    }
+    gpr_timespec start = gpr_now(GPR_CLOCK_MONOTONIC);
+    for (int i = 0; i < kMessages; i += kMessagesPerBatch) {
+      if (write_all) {
+        EXPECT_TRUE(stream->WriteAll(batch.begin(), batch.end()));
+      } else {
+        for (size_t j = 0; j < batch.size(); j++) {
+          EXPECT_TRUE(stream->Write(batch[j]));
+        }
+      }
+    }
+    EXPECT_TRUE(stream->WritesDone());
+    EchoResponse response;
+    EXPECT_TRUE(stream->Read(&response));
+    double elapsed = gpr_timespec_to_micros(
+                         gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), start)) /
+                     1e6;
+    EXPECT_EQ(std::to_string(kMessages), response.message());
+    EXPECT_TRUE(stream->Finish().ok());
+    return kMessages / elapsed;
+  }
+
+  std::unique_ptr<grpc::cpp::test::util::TestService::Stub> stub_;
+  std::unique_ptr<Server> server_;
+  std::ostringstream server_address_;
+  CountingServiceImpl service_;
+};
+
+TEST_F(PipelinedStreamingThroughputTest, WriteAllBeatsWrite) {
+  double write_rate = SendStream(false);
+  double write_all_rate = SendStream(true);
+  gpr_log(GPR_INFO, "Write: %.0f messages/s, WriteAll: %.0f messages/s",
+          write_rate, write_all_rate);
+  EXPECT_GT(write_all_rate, write_rate);
+}
+
 }  // namespace testing
 }  // namespace grpc
 
@@ -34,7 +34,6 @@
 #ifndef TEST_QPS_CLIENT_H
 #define TEST_QPS_CLIENT_H
 
-#include <condition_variable>
 #include <mutex>
 
 #include "test/cpp/qps/histogram.h"
@@ -77,23 +76,17 @@ class Client {
     }
     request_.set_response_type(grpc::testing::PayloadType::COMPRESSABLE);
     request_.set_response_size(config.payload_size());
+    if (config.load_type() == CLOSED_LOOP) {
+      histogram_.SetExpectedInterval(config.expected_interval_us() * 1e3);
+    }
   }
   virtual ~Client() {}
 
   ClientStats Mark() {
     Histogram latencies;
-    // avoid std::vector for old compilers that expect a copy constructor
-    Histogram* to_merge = new Histogram[threads_.size()];
-    for (size_t i = 0; i < threads_.size(); i++) {
-      threads_[i]->BeginSwap(&to_merge[i]);
-    }
     std::unique_ptr<Timer> timer(new Timer);
     timer_.swap(timer);
-    for (size_t i = 0; i < threads_.size(); i++) {
-      threads_[i]->EndSwap();
-      latencies.Merge(&to_merge[i]);
-    }
-    delete[] to_merge;
+    histogram_.SnapshotAndReset(&latencies);
 
     auto timer_result = timer->Mark();
 
@@ -187,6 +180,16 @@ class Client {
     }
   }
 
+  // Convert a scheduled issue time to the Timer::Now() time base. Open loop
+  // clients measure latency from when an rpc was scheduled to start rather
+  // than from when it actually started, so that a stalled server cannot hide
+  // its stall by delaying the requests that would have observed it.
+  static double ScheduledStart(const grpc_time& scheduled) {
+    double behind = std::chrono::duration_cast<std::chrono::duration<double>>(
+                        grpc_time_source::now() - scheduled).count();
+    return Timer::Now() - (behind > 0 ? behind : 0);
+  }
+
   bool NextIssueTime(int thread_idx, grpc_time* time_delay) {
     if (closed_loop_) {
       return false;
@@ -204,7 +207,6 @@ class Client {
    public:
     Thread(Client* client, size_t idx)
         : done_(false),
-          new_(nullptr),
           client_(client),
           idx_(idx),
           impl_(&Thread::ThreadFunc, this) {}
@@ -217,18 +219,6 @@ class Client {
       impl_.join();
     }
 
-    void BeginSwap(Histogram* n) {
-      std::lock_guard<std::mutex> g(mu_);
-      new_ = n;
-    }
-
-    void EndSwap() {
-      std::unique_lock<std::mutex> g(mu_);
-      while (new_ != nullptr) {
-        cv_.wait(g);
-      };
-    }
-
    private:
     Thread(const Thread&);
     Thread& operator=(const Thread&);
@@ -236,7 +226,8 @@ class Client {
     void ThreadFunc() {
       for (;;) {
         // run the loop body
-        const bool thread_still_ok = client_->ThreadFunc(&histogram_, idx_);
+        const bool thread_still_ok =
+            client_->ThreadFunc(&client_->histogram_, idx_);
         // lock, see if we're done
         std::lock_guard<std::mutex> g(mu_);
         if (!thread_still_ok) {
@@ -246,27 +237,21 @@ class Client {
         if (done_) {
           return;
         }
-        // check if we're marking, swap out the histogram if so
-        if (new_) {
-          new_->Swap(&histogram_);
-          new_ = nullptr;
-          cv_.notify_one();
-        }
       }
     }
 
     TestService::Stub* stub_;
     ClientConfig config_;
     std::mutex mu_;
-    std::condition_variable cv_;
     bool done_;
-    Histogram* new_;
-    Histogram histogram_;
     Client* client_;
     size_t idx_;
     std::thread impl_;
   };
 
+  // Shared by all threads, which record into it without locking; declared
+  // before threads_ so that it outlives them
+  Histogram histogram_;
   std::vector<std::unique_ptr<Thread>> threads_;
   std::unique_ptr<Timer> timer_;
 
@@ -60,7 +60,7 @@ typedef std::list<grpc_time> deadline_list;
 
 class ClientRpcContext {
  public:
-  explicit ClientRpcContext(int ch) : channel_id_(ch) {}
+  explicit ClientRpcContext(int ch) : channel_id_(ch), scheduled_start_(0) {}
   virtual ~ClientRpcContext() {}
   // next state, return false if done. Collect stats when appropriate
   virtual bool RunNextState(bool, Histogram* hist) = 0;
@@ -76,9 +76,13 @@ class ClientRpcContext {
   }
   virtual void Start(CompletionQueue* cq) = 0;
   int channel_id() const { return channel_id_; }
+  // Open loop issue sets the time the rpc was scheduled to start, which
+  // latency is then measured from (rather than from Start())
+  void set_scheduled_start(double t) { scheduled_start_ = t; }
 
  protected:
   int channel_id_;
+  double scheduled_start_;
 
  private:
   deadline_list::iterator deadline_posn_;
@@ -103,7 +107,7 @@ class ClientRpcContextUnaryImpl : public ClientRpcContext {
         callback_(on_done),
         start_req_(start_req) {}
   void Start(CompletionQueue* cq) GRPC_OVERRIDE {
-    start_ = Timer::Now();
+    start_ = scheduled_start_ > 0 ? scheduled_start_ : Timer::Now();
     response_reader_ = start_req_(stub_, &context_, req_, cq);
     response_reader_->Finish(&response_, &status_, ClientRpcContext::tag(this));
   }
@@ -290,6 +294,7 @@ class AsyncClient : public Client {
           auto it = rpc_deadlines_[thread_idx].end();
           --it;
           ctx->set_deadline_posn(it);
+          ctx->set_scheduled_start(ScheduledStart(next_issue_[thread_idx]));
           ctx->Start(cli_cqs_[thread_idx].get());
           issued = true;
           // If we did issue, then next time, try our thread's next
@@ -74,13 +74,17 @@ class SynchronousClient : public Client {
   virtual ~SynchronousClient(){};
 
  protected:
-  void WaitToIssue(int thread_idx) {
+  // Wait until the next rpc may be issued, and return the time latency
+  // should be measured from
+  double WaitToIssue(int thread_idx) {
     grpc_time next_time;
     if (NextIssueTime(thread_idx, &next_time)) {
       gpr_timespec next_timespec;
       TimepointHR2Timespec(next_time, &next_timespec);
       gpr_sleep_until(next_timespec);
+      return ScheduledStart(next_time);
     }
+    return Timer::Now();
   }
 
   size_t num_threads_;
@@ -96,9 +100,8 @@ class SynchronousUnaryClient GRPC_FINAL : public SynchronousClient {
   ~SynchronousUnaryClient() { EndThreads(); }
 
   bool ThreadFunc(Histogram* histogram, size_t thread_idx) GRPC_OVERRIDE {
-    WaitToIssue(thread_idx);
+    double start = WaitToIssue(thread_idx);
     auto* stub = channels_[thread_idx % channels_.size()].get_stub();
-    double start = Timer::Now();
     grpc::ClientContext context;
     grpc::Status s =
         stub->UnaryCall(&context, request_, &responses_[thread_idx]);
@@ -134,8 +137,7 @@ class SynchronousStreamingClient GRPC_FINAL : public SynchronousClient {
   }
 
   bool ThreadFunc(Histogram* histogram, size_t thread_idx) GRPC_OVERRIDE {
-    WaitToIssue(thread_idx);
-    double start = Timer::Now();
+    double start = WaitToIssue(thread_idx);
     if (stream_[thread_idx]->Write(request_) &&
         stream_[thread_idx]->Read(&responses_[thread_idx])) {
       histogram->Add((Timer::Now() - start) * 1e9);
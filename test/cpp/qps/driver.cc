@@ -96,12 +96,76 @@ struct ClientData {
   unique_ptr<Worker::Stub> stub;
   unique_ptr<ClientReaderWriter<ClientArgs, ClientStatus>> stream;
 };
+
+static void AddUsage(ResourceUsage* total, double wall, double user,
+                     double system) {
+  *total = ResourceUsage(total->wall_time() + wall,
+                         total->user_time() + user,
+                         total->system_time() + system);
+}
+
+// Mark all workers, ending the current interval and starting the next.
+// Resource usage for the interval is added to the per-worker totals, and
+// client latencies for the interval are merged into *latencies (all of which
+// may be NULL to discard the interval). Returns the average client wall time
+// of the interval.
+static double MarkWorkers(ServerData* servers, size_t num_servers,
+                          ClientData* clients, size_t num_clients,
+                          vector<ResourceUsage>* server_totals,
+                          vector<ResourceUsage>* client_totals,
+                          Histogram* latencies) {
+  ServerArgs server_mark;
+  server_mark.mutable_mark();
+  ClientArgs client_mark;
+  client_mark.mutable_mark();
+  ServerStatus server_status;
+  ClientStatus client_status;
+  double client_wall = 0;
+  for (size_t i = 0; i < num_servers; i++) {
+    GPR_ASSERT(servers[i].stream->Write(server_mark));
+  }
+  for (size_t i = 0; i < num_clients; i++) {
+    GPR_ASSERT(clients[i].stream->Write(client_mark));
+  }
+  for (size_t i = 0; i < num_servers; i++) {
+    GPR_ASSERT(servers[i].stream->Read(&server_status));
+    const auto& stats = server_status.stats();
+    if (server_totals) {
+      AddUsage(&(*server_totals)[i], stats.time_elapsed(), stats.time_user(),
+               stats.time_system());
+    }
+  }
+  for (size_t i = 0; i < num_clients; i++) {
+    GPR_ASSERT(clients[i].stream->Read(&client_status));
+    const auto& stats = client_status.stats();
+    if (latencies) latencies->MergeProto(stats.latencies());
+    if (client_totals) {
+      AddUsage(&(*client_totals)[i], stats.time_elapsed(), stats.time_user(),
+               stats.time_system());
+    }
+    client_wall += stats.time_elapsed();
+  }
+  return client_wall / num_clients;
+}
+
+static TimeSeriesSample MakeSample(double elapsed, double wall,
+                                   const Histogram& latencies) {
+  TimeSeriesSample sample;
+  sample.elapsed = elapsed;
+  sample.qps = latencies.Completions() / wall;
+  sample.latency_50 = latencies.Percentile(50);
+  sample.latency_90 = latencies.Percentile(90);
+  sample.latency_99 = latencies.Percentile(99);
+  sample.latency_999 = latencies.Percentile(99.9);
+  return sample;
+}
 }  // namespace runsc
 
 std::unique_ptr<ScenarioResult> RunScenario(
     const ClientConfig& initial_client_config, size_t num_clients,
     const ServerConfig& server_config, size_t num_servers, int warmup_seconds,
-    int benchmark_seconds, int spawn_local_worker_count) {
+    int benchmark_seconds, int spawn_local_worker_count,
+    bool collect_time_series) {
   // ClientContext allocations (all are destroyed at scope exit)
   list<ClientContext> contexts;
 
@@ -202,56 +266,50 @@ std::unique_ptr<ScenarioResult> RunScenario(
 
   // Start a run
   gpr_log(GPR_INFO, "Starting");
-  ServerArgs server_mark;
-  server_mark.mutable_mark();
-  ClientArgs client_mark;
-  client_mark.mutable_mark();
-  for (auto server = &servers[0]; server != &servers[num_servers]; server++) {
-    GPR_ASSERT(server->stream->Write(server_mark));
-  }
-  for (auto client = &clients[0]; client != &clients[num_clients]; client++) {
-    GPR_ASSERT(client->stream->Write(client_mark));
-  }
-  ServerStatus server_status;
-  ClientStatus client_status;
-  for (auto server = &servers[0]; server != &servers[num_servers]; server++) {
-    GPR_ASSERT(server->stream->Read(&server_status));
-  }
-  for (auto client = &clients[0]; client != &clients[num_clients]; client++) {
-    GPR_ASSERT(client->stream->Read(&client_status));
-  }
+  runsc::MarkWorkers(servers, num_servers, clients, num_clients, nullptr,
+                     nullptr, nullptr);
+  gpr_timespec run_start = gpr_now(GPR_CLOCK_REALTIME);
 
-  // Wait some time
+  // Wait some time, marking every second if we're collecting a time series
   gpr_log(GPR_INFO, "Running");
-  // Use gpr_sleep_until rather than this_thread::sleep_until to support
-  // compilers that don't work with this_thread
-  gpr_sleep_until(gpr_time_add(
-      start, gpr_time_from_seconds(benchmark_seconds, GPR_TIMESPAN)));
-
-  // Finish a run
   std::unique_ptr<ScenarioResult> result(new ScenarioResult);
   result->client_config = result_client_config;
   result->server_config = result_server_config;
-  gpr_log(GPR_INFO, "Finishing");
-  for (auto server = &servers[0]; server != &servers[num_servers]; server++) {
-    GPR_ASSERT(server->stream->Write(server_mark));
-  }
-  for (auto client = &clients[0]; client != &clients[num_clients]; client++) {
-    GPR_ASSERT(client->stream->Write(client_mark));
-  }
-  for (auto server = &servers[0]; server != &servers[num_servers]; server++) {
-    GPR_ASSERT(server->stream->Read(&server_status));
-    const auto& stats = server_status.stats();
-    result->server_resources.emplace_back(
-        stats.time_elapsed(), stats.time_user(), stats.time_system());
-  }
-  for (auto client = &clients[0]; client != &clients[num_clients]; client++) {
-    GPR_ASSERT(client->stream->Read(&client_status));
-    const auto& stats = client_status.stats();
-    result->latencies.MergeProto(stats.latencies());
-    result->client_resources.emplace_back(
-        stats.time_elapsed(), stats.time_user(), stats.time_system());
+  vector<ResourceUsage> server_totals(num_servers, ResourceUsage(0, 0, 0));
+  vector<ResourceUsage> client_totals(num_clients, ResourceUsage(0, 0, 0));
+  gpr_timespec end = gpr_time_add(
+      start, gpr_time_from_seconds(benchmark_seconds, GPR_TIMESPAN));
+  const gpr_timespec sample_interval = gpr_time_from_seconds(1, GPR_TIMESPAN);
+  gpr_timespec sample_end = run_start;
+  bool finished = false;
+  while (!finished) {
+    if (collect_time_series) {
+      sample_end = gpr_time_min(end, gpr_time_add(sample_end, sample_interval));
+    } else {
+      sample_end = end;
+    }
+    // Use gpr_sleep_until rather than this_thread::sleep_until to support
+    // compilers that don't work with this_thread
+    gpr_sleep_until(sample_end);
+    finished = gpr_time_cmp(sample_end, end) >= 0;
+    if (finished) {
+      // Finish a run
+      gpr_log(GPR_INFO, "Finishing");
+    }
+    Histogram latencies;
+    double wall =
+        runsc::MarkWorkers(servers, num_servers, clients, num_clients,
+                           &server_totals, &client_totals, &latencies);
+    if (collect_time_series) {
+      double elapsed =
+          gpr_timespec_to_micros(gpr_time_sub(sample_end, run_start)) / 1e6;
+      result->time_series.push_back(
+          runsc::MakeSample(elapsed, wall, latencies));
+    }
+    result->latencies.Merge(&latencies);
   }
+  result->server_resources = server_totals;
+  result->client_resources = client_totals;
 
   for (auto client = &clients[0]; client != &clients[num_clients]; client++) {
     GPR_ASSERT(client->stream->WritesDone());
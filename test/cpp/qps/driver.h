@@ -35,6 +35,7 @@
 #define TEST_QPS_DRIVER_H
 
 #include <memory>
+#include <vector>
 
 #include "test/cpp/qps/histogram.h"
 #include "test/cpp/qps/qpstest.grpc.pb.h"
@@ -55,18 +56,32 @@ class ResourceUsage {
   double system_time_;
 };
 
+// Client throughput and latency over one interval of a run
+struct TimeSeriesSample {
+  double elapsed;  // seconds from the start of the run to the end of sample
+  double qps;
+  double latency_50;  // latencies in ns
+  double latency_90;
+  double latency_99;
+  double latency_999;
+};
+
 struct ScenarioResult {
   Histogram latencies;
+  std::vector<TimeSeriesSample> time_series;
   std::vector<ResourceUsage> client_resources;
   std::vector<ResourceUsage> server_resources;
   ClientConfig client_config;
   ServerConfig server_config;
 };
 
+// Run a benchmark scenario. If collect_time_series is set, workers are also
+// sampled once a second and result->time_series records each sample.
 std::unique_ptr<ScenarioResult> RunScenario(
     const grpc::testing::ClientConfig& client_config, size_t num_clients,
     const grpc::testing::ServerConfig& server_config, size_t num_servers,
-    int warmup_seconds, int benchmark_seconds, int spawn_local_worker_count);
+    int warmup_seconds, int benchmark_seconds, int spawn_local_worker_count,
+    bool collect_time_series = false);
 
 }  // namespace testing
 }  // namespace grpc
@@ -34,50 +34,109 @@
 #ifndef TEST_QPS_HISTOGRAM_H
 #define TEST_QPS_HISTOGRAM_H
 
-#include <grpc/support/histogram.h>
+#include <grpc/support/atm.h>
+#include <grpc/support/hdr_histogram.h>
+#include <grpc/support/log.h>
 #include "test/cpp/qps/qpstest.grpc.pb.h"
 
 namespace grpc {
 namespace testing {
 
+// Latency histogram in nanoseconds. Add() is lock-free and may be called from
+// any number of threads concurrently with SnapshotAndReset().
 class Histogram {
  public:
-  Histogram() : impl_(gpr_histogram_create(0.01, 60e9)) {}
+  Histogram()
+      : impl_(gpr_hdr_histogram_create(60000000000, 3)),
+        expected_interval_(0),
+        completions_(0) {}
   ~Histogram() {
-    if (impl_) gpr_histogram_destroy(impl_);
+    if (impl_) gpr_hdr_histogram_destroy(impl_);
+  }
+  Histogram(Histogram&& other)
+      : impl_(other.impl_),
+        expected_interval_(other.expected_interval_),
+        completions_(other.completions_) {
+    other.impl_ = nullptr;
   }
-  Histogram(Histogram&& other) : impl_(other.impl_) { other.impl_ = nullptr; }
 
-  void Merge(Histogram* h) { gpr_histogram_merge(impl_, h->impl_); }
-  void Add(double value) { gpr_histogram_add(impl_, value); }
+  void Merge(Histogram* h) {
+    gpr_hdr_histogram_merge(impl_, h->impl_);
+    gpr_atm_no_barrier_fetch_add(&completions_,
+                                 gpr_atm_no_barrier_load(&h->completions_));
+  }
+  void Add(double value) {
+    gpr_hdr_histogram_record_corrected(impl_,
+                                       static_cast<gpr_int64>(value + 0.5),
+                                       expected_interval_);
+    gpr_atm_no_barrier_fetch_add(&completions_, 1);
+  }
+  // Correct subsequent Add()s for coordinated omission, assuming one value
+  // is expected every interval ns (0 to disable)
+  void SetExpectedInterval(double interval) {
+    expected_interval_ = static_cast<gpr_int64>(interval + 0.5);
+  }
+  // Move everything recorded so far into *dst, leaving this histogram empty
+  void SnapshotAndReset(Histogram* dst) {
+    gpr_hdr_histogram_snapshot_and_reset(impl_, dst->impl_);
+    gpr_atm n = gpr_atm_no_barrier_load(&completions_);
+    gpr_atm_no_barrier_fetch_add(&completions_, -n);
+    gpr_atm_no_barrier_fetch_add(&dst->completions_, n);
+  }
   double Percentile(double pctile) const {
-    return gpr_histogram_percentile(impl_, pctile);
+    return static_cast<double>(
+        gpr_hdr_histogram_value_at_percentile(impl_, pctile));
+  }
+  // Values recorded, including those synthesized by the coordinated omission
+  // correction
+  double Count() const {
+    return static_cast<double>(gpr_hdr_histogram_count(impl_));
+  }
+  // Values actually Add()ed: what throughput is to be computed from
+  double Completions() const {
+    return static_cast<double>(gpr_atm_no_barrier_load(&completions_));
+  }
+  void Swap(Histogram* other) {
+    std::swap(impl_, other->impl_);
+    std::swap(completions_, other->completions_);
   }
-  double Count() const { return gpr_histogram_count(impl_); }
-  void Swap(Histogram* other) { std::swap(impl_, other->impl_); }
   void FillProto(HistogramData* p) {
-    size_t n;
-    const auto* data = gpr_histogram_get_contents(impl_, &n);
+    size_t n = gpr_hdr_histogram_num_buckets(impl_);
     for (size_t i = 0; i < n; i++) {
-      p->add_bucket(data[i]);
+      // Buckets go over the wire as 32 bits; a fuller one is clamped rather
+      // than wrapped around to a small count
+      gpr_int64 bucket = gpr_hdr_histogram_count_at_index(impl_, i);
+      p->add_bucket(bucket > GPR_UINT32_MAX ? GPR_UINT32_MAX
+                                            : static_cast<gpr_uint32>(bucket));
     }
-    p->set_min_seen(gpr_histogram_minimum(impl_));
-    p->set_max_seen(gpr_histogram_maximum(impl_));
-    p->set_sum(gpr_histogram_sum(impl_));
-    p->set_sum_of_squares(gpr_histogram_sum_of_squares(impl_));
-    p->set_count(gpr_histogram_count(impl_));
+    // The HDR histogram keeps only bucket counts; the summary statistics are
+    // derived from them
+    double count = Count();
+    double mean = gpr_hdr_histogram_mean(impl_);
+    double stddev = gpr_hdr_histogram_stddev(impl_);
+    p->set_min_seen(static_cast<double>(gpr_hdr_histogram_min(impl_)));
+    p->set_max_seen(static_cast<double>(gpr_hdr_histogram_max(impl_)));
+    p->set_sum(mean * count);
+    p->set_sum_of_squares(count * (stddev * stddev + mean * mean));
+    p->set_count(count);
+    p->set_completions(Completions());
   }
   void MergeProto(const HistogramData& p) {
-    gpr_histogram_merge_contents(impl_, &*p.bucket().begin(), p.bucket_size(),
-                                 p.min_seen(), p.max_seen(), p.sum(),
-                                 p.sum_of_squares(), p.count());
+    // Fails if p came from a histogram with a different layout, whose
+    // latencies would otherwise be silently dropped from the result
+    GPR_ASSERT(gpr_hdr_histogram_merge_contents(impl_, p.bucket().data(),
+                                                p.bucket_size()));
+    gpr_atm_no_barrier_fetch_add(&completions_,
+                                 static_cast<gpr_atm>(p.completions()));
   }
 
  private:
   Histogram(const Histogram&);
   Histogram& operator=(const Histogram&);
 
-  gpr_histogram* impl_;
+  gpr_hdr_histogram* impl_;
+  gpr_int64 expected_interval_;
+  gpr_atm completions_;
 };
 }
 }
@@ -40,6 +40,7 @@
 
 #include "test/cpp/qps/driver.h"
 #include "test/cpp/qps/report.h"
+#include "test/cpp/qps/stats.h"
 #include "test/cpp/util/benchmark_config.h"
 
 DEFINE_int32(num_clients, 1, "Number of client binaries");
@@ -67,6 +68,22 @@ DEFINE_int32(async_client_threads, 1, "Async client threads");
 DEFINE_string(load_type, "CLOSED_LOOP", "Load type");
 DEFINE_double(load_param_1, 0.0, "Load parameter 1");
 DEFINE_double(load_param_2, 0.0, "Load parameter 2");
+DEFINE_double(expected_interval_us, 0.0,
+              "Closed loop only: correct latencies for coordinated omission "
+              "assuming each outstanding rpc should issue this often");
+
+// Reporting
+DEFINE_bool(time_series, false, "Report QPS and latencies every second");
+
+// Sweep mode: run the scenario once per target QPS, from sweep_start_qps to
+// sweep_end_qps in sweep_steps equal steps, and report the latency vs
+// throughput curve and the point at which the server saturates
+DEFINE_double(sweep_start_qps, 0.0, "Sweep: first target QPS (0 to disable)");
+DEFINE_double(sweep_end_qps, 0.0, "Sweep: last target QPS");
+DEFINE_int32(sweep_steps, 10, "Sweep: number of target QPS values");
+DEFINE_double(sweep_max_latency_ratio, 10.0,
+              "Sweep: the server is saturated once 99th percentile latency "
+              "exceeds this multiple of its value at the first target");
 
 using grpc::testing::ClientConfig;
 using grpc::testing::ServerConfig;
@@ -79,6 +96,74 @@ using grpc::testing::ResourceUsage;
 namespace grpc {
 namespace testing {
 
+// The server is also saturated once it falls this far behind the offered load
+static const double kSweepMinThroughputRatio = 0.95;
+
+static double WallTime(ResourceUsage u) { return u.wall_time(); }
+
+static void SetOfferedLoad(ClientConfig* client_config, double qps) {
+  // offered load is per client
+  double per_client = qps / FLAGS_num_clients;
+  switch (client_config->load_type()) {
+    case grpc::testing::POISSON:
+      client_config->mutable_load_params()->mutable_poisson()->set_offered_load(
+          per_client);
+      break;
+    case grpc::testing::DETERMINISTIC:
+      client_config->mutable_load_params()->mutable_determ()->set_offered_load(
+          per_client);
+      break;
+    default:
+      gpr_log(GPR_ERROR, "Sweeps need a POISSON or DETERMINISTIC load_type");
+      GPR_ASSERT(false);
+      break;
+  }
+}
+
+static void RunSweep(const ClientConfig& initial_client_config,
+                     const ServerConfig& server_config) {
+  GPR_ASSERT(FLAGS_sweep_steps >= 1);
+  GPR_ASSERT(FLAGS_sweep_end_qps >= FLAGS_sweep_start_qps);
+  double step = FLAGS_sweep_steps > 1
+                    ? (FLAGS_sweep_end_qps - FLAGS_sweep_start_qps) /
+                          (FLAGS_sweep_steps - 1)
+                    : 0;
+  double baseline_p99 = 0;
+  double saturation_qps = 0;
+  gpr_log(GPR_INFO,
+          "Sweep: target QPS, achieved QPS, "
+          "latencies (50/90/99/99.9%%-ile) in us");
+  for (int i = 0; i < FLAGS_sweep_steps && saturation_qps == 0; i++) {
+    double target = FLAGS_sweep_start_qps + i * step;
+    ClientConfig client_config = initial_client_config;
+    SetOfferedLoad(&client_config, target);
+    const auto result = RunScenario(
+        client_config, FLAGS_num_clients, server_config, FLAGS_num_servers,
+        FLAGS_warmup_seconds, FLAGS_benchmark_seconds, FLAGS_local_workers,
+        FLAGS_time_series);
+    double achieved = result->latencies.Completions() /
+                      average(result->client_resources, WallTime);
+    double p99 = result->latencies.Percentile(99);
+    gpr_log(GPR_INFO, "Sweep: %.1f, %.1f, %.1f/%.1f/%.1f/%.1f", target,
+            achieved, result->latencies.Percentile(50) / 1000,
+            result->latencies.Percentile(90) / 1000, p99 / 1000,
+            result->latencies.Percentile(99.9) / 1000);
+    GetReporter()->ReportTimeSeries(*result);
+    if (i == 0) baseline_p99 = p99;
+    if (achieved < target * kSweepMinThroughputRatio ||
+        p99 > baseline_p99 * FLAGS_sweep_max_latency_ratio) {
+      saturation_qps = target;
+    }
+  }
+  if (saturation_qps != 0) {
+    gpr_log(GPR_INFO, "Sweep: saturated at a target of %.1f QPS",
+            saturation_qps);
+  } else {
+    gpr_log(GPR_INFO, "Sweep: not saturated up to %.1f QPS",
+            FLAGS_sweep_end_qps);
+  }
+}
+
 static void QpsDriver() {
   RpcType rpc_type;
   GPR_ASSERT(RpcType_Parse(FLAGS_rpc_type, &rpc_type));
@@ -100,6 +185,7 @@ static void QpsDriver() {
   client_config.set_payload_size(FLAGS_payload_size);
   client_config.set_async_client_threads(FLAGS_async_client_threads);
   client_config.set_rpc_type(rpc_type);
+  client_config.set_expected_interval_us(FLAGS_expected_interval_us);
 
   // set up the load parameters
   switch (load_type) {
@@ -107,7 +193,7 @@ static void QpsDriver() {
       break;
     case grpc::testing::POISSON: {
       auto poisson = client_config.mutable_load_params()->mutable_poisson();
-      GPR_ASSERT(FLAGS_load_param_1 != 0.0);
+      GPR_ASSERT(FLAGS_load_param_1 != 0.0 || FLAGS_sweep_start_qps > 0);
       poisson->set_offered_load(FLAGS_load_param_1);
       break;
     }
@@ -121,7 +207,7 @@ static void QpsDriver() {
     }
     case grpc::testing::DETERMINISTIC: {
       auto determ = client_config.mutable_load_params()->mutable_determ();
-      GPR_ASSERT(FLAGS_load_param_1 != 0.0);
+      GPR_ASSERT(FLAGS_load_param_1 != 0.0 || FLAGS_sweep_start_qps > 0);
       determ->set_offered_load(FLAGS_load_param_1);
       break;
     }
@@ -152,14 +238,21 @@ static void QpsDriver() {
                FLAGS_server_threads <
                    FLAGS_client_channels * FLAGS_outstanding_rpcs_per_channel));
 
+  if (FLAGS_sweep_start_qps > 0) {
+    RunSweep(client_config, server_config);
+    return;
+  }
+
   const auto result = RunScenario(
       client_config, FLAGS_num_clients, server_config, FLAGS_num_servers,
-      FLAGS_warmup_seconds, FLAGS_benchmark_seconds, FLAGS_local_workers);
+      FLAGS_warmup_seconds, FLAGS_benchmark_seconds, FLAGS_local_workers,
+      FLAGS_time_series);
 
   GetReporter()->ReportQPS(*result);
   GetReporter()->ReportQPSPerCore(*result);
   GetReporter()->ReportLatency(*result);
   GetReporter()->ReportTimes(*result);
+  GetReporter()->ReportTimeSeries(*result);
 }
 
 }  // namespace testing
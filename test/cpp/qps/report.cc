@@ -72,15 +72,21 @@ void CompositeReporter::ReportTimes(const ScenarioResult& result) {
   }
 }
 
+void CompositeReporter::ReportTimeSeries(const ScenarioResult& result) {
+  for (size_t i = 0; i < reporters_.size(); ++i) {
+    reporters_[i]->ReportTimeSeries(result);
+  }
+}
+
 void GprLogReporter::ReportQPS(const ScenarioResult& result) {
-  gpr_log(
-      GPR_INFO, "QPS: %.1f",
-      result.latencies.Count() / average(result.client_resources, WallTime));
+  gpr_log(GPR_INFO, "QPS: %.1f",
+          result.latencies.Completions() /
+              average(result.client_resources, WallTime));
 }
 
 void GprLogReporter::ReportQPSPerCore(const ScenarioResult& result) {
-  auto qps =
-      result.latencies.Count() / average(result.client_resources, WallTime);
+  auto qps = result.latencies.Completions() /
+             average(result.client_resources, WallTime);
 
   gpr_log(GPR_INFO, "QPS: %.1f (%.1f/server core)", qps,
           qps / result.server_config.threads());
@@ -111,17 +117,28 @@ void GprLogReporter::ReportTimes(const ScenarioResult& result) {
               sum(result.client_resources, WallTime));
 }
 
+void GprLogReporter::ReportTimeSeries(const ScenarioResult& result) {
+  for (auto s = result.time_series.begin(); s != result.time_series.end();
+       s++) {
+    gpr_log(GPR_INFO,
+            "t=%.1fs QPS: %.1f Latencies (50/90/99/99.9%%-ile): "
+            "%.1f/%.1f/%.1f/%.1f us",
+            s->elapsed, s->qps, s->latency_50 / 1000, s->latency_90 / 1000,
+            s->latency_99 / 1000, s->latency_999 / 1000);
+  }
+}
+
 void PerfDbReporter::ReportQPS(const ScenarioResult& result) {
-  auto qps =
-      result.latencies.Count() / average(result.client_resources, WallTime);
+  auto qps = result.latencies.Completions() /
+             average(result.client_resources, WallTime);
 
   perf_db_client_.setQps(qps);
   perf_db_client_.setConfigs(result.client_config, result.server_config);
 }
 
 void PerfDbReporter::ReportQPSPerCore(const ScenarioResult& result) {
-  auto qps =
-      result.latencies.Count() / average(result.client_resources, WallTime);
+  auto qps = result.latencies.Completions() /
+             average(result.client_resources, WallTime);
 
   auto qpsPerCore = qps / result.server_config.threads();
 
@@ -158,6 +175,10 @@ void PerfDbReporter::ReportTimes(const ScenarioResult& result) {
   perf_db_client_.setConfigs(result.client_config, result.server_config);
 }
 
+void PerfDbReporter::ReportTimeSeries(const ScenarioResult& result) {
+  // the performance database only records whole-run summaries
+}
+
 void PerfDbReporter::SendData() {
   // send data to performance database
   bool data_state =
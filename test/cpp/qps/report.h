@@ -72,6 +72,10 @@ class Reporter {
   /** Reports system and user time for client and server systems. */
   virtual void ReportTimes(const ScenarioResult& result) = 0;
 
+  /** Reports QPS and latencies for each sample of the run, if the scenario
+   * collected a time series. */
+  virtual void ReportTimeSeries(const ScenarioResult& result) = 0;
+
  private:
   const string name_;
 };
@@ -88,6 +92,7 @@ class CompositeReporter : public Reporter {
   void ReportQPSPerCore(const ScenarioResult& result) GRPC_OVERRIDE;
   void ReportLatency(const ScenarioResult& result) GRPC_OVERRIDE;
   void ReportTimes(const ScenarioResult& result) GRPC_OVERRIDE;
+  void ReportTimeSeries(const ScenarioResult& result) GRPC_OVERRIDE;
 
  private:
   std::vector<std::unique_ptr<Reporter> > reporters_;
@@ -103,6 +108,7 @@ class GprLogReporter : public Reporter {
   void ReportQPSPerCore(const ScenarioResult& result) GRPC_OVERRIDE;
   void ReportLatency(const ScenarioResult& result) GRPC_OVERRIDE;
   void ReportTimes(const ScenarioResult& result) GRPC_OVERRIDE;
+  void ReportTimeSeries(const ScenarioResult& result) GRPC_OVERRIDE;
 };
 
 /** Reporter for performance database tool */
@@ -131,6 +137,7 @@ class PerfDbReporter : public Reporter {
   void ReportQPSPerCore(const ScenarioResult& result) GRPC_OVERRIDE;
   void ReportLatency(const ScenarioResult& result) GRPC_OVERRIDE;
   void ReportTimes(const ScenarioResult& result) GRPC_OVERRIDE;
+  void ReportTimeSeries(const ScenarioResult& result) GRPC_OVERRIDE;
   void SendData();
 };
 
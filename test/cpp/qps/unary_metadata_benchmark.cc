@@ -0,0 +1,218 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+// Measures the cost of a synchronous unary call carrying ten client headers
+// that the server echoes back as trailing metadata. Messages are plain strings
+// copied in and out of byte buffers so that the numbers are dominated by the
+// call and metadata paths rather than by serialization.
+
+#include <stdio.h>
+#include <sys/resource.h>
+
+#include <memory>
+
+#include <gflags/gflags.h>
+#include <grpc/byte_buffer_reader.h>
+#include <grpc/support/log.h>
+#include <grpc/support/time.h>
+#include <grpc++/channel.h>
+#include <grpc++/client_context.h>
+#include <grpc++/create_channel.h>
+#include <grpc++/impl/client_unary_call.h>
+#include <grpc++/impl/rpc_method.h>
+#include <grpc++/impl/rpc_service_method.h>
+#include <grpc++/impl/service_type.h>
+#include <grpc++/security/credentials.h>
+#include <grpc++/security/server_credentials.h>
+#include <grpc++/server.h>
+#include <grpc++/server_builder.h>
+#include <grpc++/server_context.h>
+#include <grpc++/impl/serialization_traits.h>
+
+#include "test/cpp/util/test_config.h"
+
+DEFINE_int32(calls, 20000, "Number of timed calls.");
+DEFINE_int32(warmup_calls, 2000, "Number of untimed calls made first.");
+DEFINE_int32(headers, 10, "Number of client headers sent on each call.");
+
+namespace grpc {
+namespace testing {
+
+struct Payload {
+  grpc::string data;
+};
+
+}  // namespace testing
+
+template <>
+class SerializationTraits<testing::Payload> {
+ public:
+  static Status Serialize(const testing::Payload& msg,
+                          grpc_byte_buffer** buffer, bool* own_buffer) {
+    gpr_slice slice =
+        gpr_slice_from_copied_buffer(msg.data.data(), msg.data.size());
+    *buffer = grpc_raw_byte_buffer_create(&slice, 1);
+    gpr_slice_unref(slice);
+    *own_buffer = true;
+    return Status::OK;
+  }
+  static Status Deserialize(grpc_byte_buffer* buffer, testing::Payload* msg,
+                            int max_message_size) {
+    if (buffer == nullptr) {
+      return Status(StatusCode::INTERNAL, "No payload");
+    }
+    grpc_byte_buffer_reader reader;
+    grpc_byte_buffer_reader_init(&reader, buffer);
+    gpr_slice slice;
+    msg->data.clear();
+    while (grpc_byte_buffer_reader_next(&reader, &slice)) {
+      msg->data.append(
+          reinterpret_cast<const char*>(GPR_SLICE_START_PTR(slice)),
+          GPR_SLICE_LENGTH(slice));
+      gpr_slice_unref(slice);
+    }
+    grpc_byte_buffer_destroy(buffer);
+    return Status::OK;
+  }
+};
+
+namespace testing {
+namespace {
+
+const char kMethodName[] = "/grpc.testing.MetadataBenchmark/Echo";
+const int kMaxHeaders = 64;
+
+class EchoMetadataService GRPC_FINAL : public SynchronousService {
+ public:
+  RpcService* service() GRPC_OVERRIDE {
+    if (!service_) {
+      service_.reset(new RpcService);
+      service_->AddMethod(new RpcServiceMethod(
+          kMethodName, RpcMethod::NORMAL_RPC,
+          new RpcMethodHandler<EchoMetadataService, Payload, Payload>(
+              std::mem_fn(&EchoMetadataService::Echo), this)));
+    }
+    return service_.get();
+  }
+
+ private:
+  Status Echo(ServerContext* context, const Payload* request,
+              Payload* response) {
+    const IncomingMetadata& metadata = context->incoming_metadata();
+    for (size_t i = 0; i < metadata.size(); i++) {
+      context->AddTrailingMetadata(metadata.key(i), metadata.value(i));
+    }
+    response->data = request->data;
+    return Status::OK;
+  }
+
+  std::unique_ptr<RpcService> service_;
+};
+
+double CpuSeconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         1e-6 * static_cast<double>(usage.ru_utime.tv_usec +
+                                    usage.ru_stime.tv_usec);
+}
+
+void RunBenchmark() {
+  GPR_ASSERT(FLAGS_headers >= 0 && FLAGS_headers <= kMaxHeaders);
+  EchoMetadataService service;
+  ServerBuilder builder;
+  int port = 0;
+  builder.AddListeningPort("localhost:0", InsecureServerCredentials(), &port);
+  builder.RegisterService(&service);
+  std::unique_ptr<Server> server(builder.BuildAndStart());
+  GPR_ASSERT(port != 0);
+
+  char target[64];
+  snprintf(target, sizeof(target), "localhost:%d", port);
+  std::shared_ptr<Channel> channel =
+      CreateChannel(target, InsecureCredentials());
+  RpcMethod method(kMethodName, RpcMethod::NORMAL_RPC, channel);
+
+  grpc::string keys[kMaxHeaders];
+  grpc::string values[kMaxHeaders];
+  for (int i = 0; i < FLAGS_headers; i++) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "x-benchmark-header-%d", i);
+    keys[i] = buf;
+    snprintf(buf, sizeof(buf), "benchmark-header-value-%d", i);
+    values[i] = buf;
+  }
+
+  Payload request;
+  request.data = "ping";
+  Payload response;
+  gpr_timespec start = gpr_inf_past(GPR_CLOCK_MONOTONIC);
+  double cpu_start = 0;
+  for (int i = 0; i < FLAGS_warmup_calls + FLAGS_calls; i++) {
+    if (i == FLAGS_warmup_calls) {
+      start = gpr_now(GPR_CLOCK_MONOTONIC);
+      cpu_start = CpuSeconds();
+    }
+    ClientContext context;
+    for (int j = 0; j < FLAGS_headers; j++) {
+      context.AddMetadata(keys[j], values[j]);
+    }
+    Status status =
+        BlockingUnaryCall(channel.get(), method, &context, request, &response);
+    GPR_ASSERT(status.ok());
+    GPR_ASSERT(context.incoming_trailing_metadata().size() >=
+               static_cast<size_t>(FLAGS_headers));
+  }
+  gpr_timespec elapsed = gpr_time_sub(gpr_now(GPR_CLOCK_MONOTONIC), start);
+  double cpu = CpuSeconds() - cpu_start;
+  double wall = static_cast<double>(elapsed.tv_sec) + 1e-9 * elapsed.tv_nsec;
+
+  gpr_log(GPR_INFO,
+          "%d calls with %d headers: %.2f us/call wall, %.2f us/call cpu "
+          "(client and server)",
+          FLAGS_calls, FLAGS_headers, 1e6 * wall / FLAGS_calls,
+          1e6 * cpu / FLAGS_calls);
+
+  server->Shutdown();
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace grpc
+
+int main(int argc, char** argv) {
+  grpc::testing::InitTest(&argc, &argv, true);
+  grpc::testing::RunBenchmark();
+  return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ *
+ * Copyright 2015, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <grpc++/support/metadata.h>
+
+#include <string.h>
+
+#include <grpc/grpc.h>
+#include <grpc/support/alloc.h>
+#include <gtest/gtest.h>
+
+namespace grpc {
+namespace {
+
+class OutgoingMetadataTest : public ::testing::Test {};
+
+TEST_F(OutgoingMetadataTest, Empty) {
+  OutgoingMetadata md;
+  EXPECT_TRUE(md.empty());
+  EXPECT_EQ(0U, md.size());
+}
+
+TEST_F(OutgoingMetadataTest, KeepsInsertionOrder) {
+  OutgoingMetadata md;
+  md.Add("b", "1");
+  md.Add("a", "2");
+  md.Add("b", "3");
+  ASSERT_EQ(3U, md.size());
+  EXPECT_EQ(string_ref("b"), md.key(0));
+  EXPECT_EQ(string_ref("1"), md.value(0));
+  EXPECT_EQ(string_ref("a"), md.key(1));
+  EXPECT_EQ(string_ref("2"), md.value(1));
+  EXPECT_EQ(string_ref("b"), md.key(2));
+  EXPECT_EQ(string_ref("3"), md.value(2));
+}
+
+TEST_F(OutgoingMetadataTest, CopiesKeysAndValues) {
+  OutgoingMetadata md;
+  grpc::string key("key");
+  grpc::string value("value");
+  md.Add(key, value);
+  key[0] = 'x';
+  value[0] = 'x';
+  EXPECT_EQ(string_ref("key"), md.key(0));
+  EXPECT_EQ(string_ref("value"), md.value(0));
+}
+
+TEST_F(OutgoingMetadataTest, BinaryValue) {
+  const char kValue[] = "a\0b";
+  OutgoingMetadata md;
+  md.Add("key-bin", string_ref(kValue, sizeof(kValue)));
+  EXPECT_EQ(sizeof(kValue), md.value(0).size());
+  EXPECT_EQ(0, memcmp(kValue, md.value(0).data(), sizeof(kValue)));
+}
+
+TEST_F(OutgoingMetadataTest, GrowsPastInlineStorage) {
+  OutgoingMetadata md;
+  grpc::string long_value(1000, 'v');
+  md.Add("first", "x");
+  const char* first_key = md.key(0).data();
+  for (int i = 0; i < 100; i++) {
+    md.Add("key-" + std::to_string(i), long_value);
+  }
+  ASSERT_EQ(101U, md.size());
+  // Data written before the arena grew must not have moved.
+  EXPECT_EQ(first_key, md.key(0).data());
+  EXPECT_EQ(string_ref("first"), md.key(0));
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(string_ref("key-" + std::to_string(i)), md.key(i + 1));
+    EXPECT_EQ(string_ref(long_value), md.value(i + 1));
+  }
+}
+
+class IncomingMetadataTest : public ::testing::Test {};
+
+TEST_F(IncomingMetadataTest, Empty) {
+  IncomingMetadata md;
+  EXPECT_TRUE(md.empty());
+  EXPECT_TRUE(md.map().empty());
+  string_ref value;
+  EXPECT_FALSE(md.Find("key", &value));
+}
+
+}  // namespace
+}  // namespace grpc
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -794,6 +794,7 @@ include/grpc++/support/byte_buffer.h \
 include/grpc++/support/channel_arguments.h \
 include/grpc++/support/config.h \
 include/grpc++/support/config_protobuf.h \
+include/grpc++/support/metadata.h \
 include/grpc++/support/slice.h \
 include/grpc++/support/status.h \
 include/grpc++/support/status_code_enum.h \
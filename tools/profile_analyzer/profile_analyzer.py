@@ -34,6 +34,11 @@ Read GRPC basic profiles, analyze the data.
 Usage:
   bins/basicprof/qps_smoke_test > log
   cat log | tools/profile_analyzer/profile_analyzer.py
+or, for the binary trace written by the collector:
+  GRPC_LATENCY_TRACE=trace bins/basicprof/qps_smoke_test
+  tools/profile_analyzer/profile_analyzer.py trace
+
+Times are reported in microseconds.
 """
 
 
@@ -41,16 +46,23 @@ import collections
 import itertools
 import math
 import re
+import struct
 
 # Create a regex to parse output of the C core basic profiler,
 # as defined in src/core/profiling/basic_timers.c.
 _RE_LINE = re.compile(r'GRPC_LAT_PROF ' +
-                      r'([0-9]+\.[0-9]+) 0x([0-9a-f]+) ([{}.!]) ([0-9]+) ' +
-                      r'([^ ]+) ([^ ]+) ([0-9]+)')
+                      r'([0-9]+\.[0-9]+) +0x([0-9a-f]+) ([{}.!]) ' +
+                      r'([0-9]+)\(([^)]*)\) ([^ ]+) ([^ ]+) ([0-9]+)')
+
+# Records of the binary trace, see src/core/profiling/basic_timers.c.
+_BINARY_MAGIC = 'GRPCLAT1'
+_BINARY_STRING = struct.Struct('<IH')
+_BINARY_DROPPED = struct.Struct('<IQ')
+_BINARY_MARK = struct.Struct('<IIIIIQQ')
 
 Entry = collections.namedtuple(
     'Entry',
-    ['time', 'thread', 'type', 'tag', 'id', 'file', 'line'])
+    ['time', 'thread', 'type', 'tag', 'tagstr', 'id', 'file', 'line'])
 
 
 class ImportantMark(object):
@@ -80,14 +92,17 @@ class ImportantMark(object):
                                    for stack_entry in pre_and_post_stacks)
 
 
-def print_block_statistics(block_times):
-  print '{:<12s}  {:>12s} {:>12s} {:>12s} {:>12s}'.format(
-          'Block tag', '50th p.', '90th p.', '95th p.', '99th p.')
+def print_block_statistics(block_times, tag_names):
+  print '{:<40s}  {:>10s} {:>12s} {:>12s} {:>12s} {:>12s} {:>12s}'.format(
+          'Block tag', 'count', '50th p.', '90th p.', '95th p.', '99th p.',
+          'max')
   for tag, tag_times in sorted(block_times.iteritems()):
     times = sorted(tag_times)
-    print '{:<12d}: {:>12.3f} {:>12.3f} {:>12.3f} {:>12.3f}'.format(
-            tag, percentile(times, 50), percentile(times, 90),
-            percentile(times, 95), percentile(times, 99))
+    print ('{:<40s}: {:>10d} {:>12.3f} {:>12.3f} {:>12.3f} {:>12.3f} '
+           '{:>12.3f}').format(
+            '{} ({})'.format(tag_names.get(tag, ''), tag), len(times),
+            percentile(times, 50), percentile(times, 90),
+            percentile(times, 95), percentile(times, 99), times[-1])
   print
 
 def print_grouped_imark_statistics(group_key, imarks_group):
@@ -124,17 +139,50 @@ def percentile(vals, percent):
   d1 = vals[int(c)] * (k-f)
   return d0 + d1
 
-def entries(f):
-  for line in f:
+def text_entries(lines):
+  for line in lines:
     m = _RE_LINE.match(line)
     if not m: continue
-    yield Entry(time=float(m.group(1)),
+    yield Entry(time=float(m.group(1)) * 1e6,
                 thread=m.group(2),
                 type=m.group(3),
                 tag=int(m.group(4)),
-                id=m.group(5),
-                file=m.group(6),
-                line=m.group(7))
+                tagstr=m.group(5),
+                id=m.group(6),
+                file=m.group(7),
+                line=m.group(8))
+
+def binary_entries(f, dropped):
+  """Yields the marks of a binary trace, filling dropped with the number of
+  marks each thread could not record."""
+  strings = {}
+  while True:
+    kind = f.read(1)
+    if not kind: break
+    if kind == 's':
+      string_id, length = _BINARY_STRING.unpack(f.read(_BINARY_STRING.size))
+      strings[string_id] = f.read(length)
+    elif kind == 'd':
+      thread, count = _BINARY_DROPPED.unpack(f.read(_BINARY_DROPPED.size))
+      dropped[thread] = count
+    else:
+      thread, tag, tagstr, file_id, line, mark_id, time_ns = (
+          _BINARY_MARK.unpack(f.read(_BINARY_MARK.size)))
+      yield Entry(time=time_ns / 1e3,
+                  thread=thread,
+                  type=kind,
+                  tag=tag,
+                  tagstr=strings[tagstr],
+                  id='0x{:x}'.format(mark_id),
+                  file=strings[file_id],
+                  line=line)
+
+def entries(f, dropped):
+  head = f.read(len(_BINARY_MAGIC))
+  if head == _BINARY_MAGIC:
+    return binary_entries(f, dropped)
+  return text_entries(itertools.chain((head + f.readline()).splitlines(True),
+                                      f))
 
 def main(f):
   percentiles = (50, 90, 95, 99)
@@ -142,7 +190,10 @@ def main(f):
   times = collections.defaultdict(list)
   important_marks = collections.defaultdict(list)
   stack_depth = collections.defaultdict(int)
-  for entry in entries(f):
+  tag_names = {}
+  dropped = {}
+  for entry in entries(f, dropped):
+    tag_names[entry.tag] = entry.tagstr
     thread = threads[entry.thread]
     if entry.type == '{':
       thread[entry.tag].append(entry)
@@ -155,6 +206,8 @@ def main(f):
       imark_group_key = '{tag}/{thread}@{file}:{line}'.format(**entry._asdict())
       important_marks[imark_group_key].append(ImportantMark(entry, stack))
     elif entry.type == '}':
+      # The begin mark may have been dropped or be from before the trace.
+      if not thread[entry.tag]: continue
       last = thread[entry.tag].pop()
       times[entry.tag].append(entry.time - last.time)
       # only access the last "depth" imarks for the tag.
@@ -169,7 +222,7 @@ def main(f):
   print
   print 'Block marks:'
   print '============'
-  print_block_statistics(times)
+  print_block_statistics(times, tag_names)
 
   print
   print 'Important marks:'
@@ -177,6 +230,12 @@ def main(f):
   for group_key, imarks_group in important_marks.iteritems():
     print_grouped_imark_statistics(group_key, imarks_group)
 
+  if any(dropped.itervalues()):
+    print 'Dropped marks:'
+    print '=============='
+    for thread, count in sorted(dropped.iteritems()):
+      print 'thread {}: {}'.format(thread, count)
+
 
 if __name__ == '__main__':
   # If invoked without arguments, read off sys.stdin. If one argument is given,
@@ -184,5 +243,5 @@ if __name__ == '__main__':
   import sys
   f = sys.stdin
   if len(sys.argv) == 2:
-    f = open(sys.argv[1], 'r')
+    f = open(sys.argv[1], 'rb')
   main(f)